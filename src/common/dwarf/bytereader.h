@@ -68,6 +68,11 @@ class ByteReader {
   // number, using this ByteReader's endianness.
   uint16 ReadTwoBytes(const uint8_t *buffer) const;
 
+  // Read three bytes from BUFFER and return them as an unsigned 32 bit
+  // number, using this ByteReader's endianness. DWARF 5 uses three-byte
+  // values for the DW_FORM_strx3 and DW_FORM_addrx3 forms.
+  uint64 ReadThreeBytes(const uint8_t *buffer) const;
+
   // Read four bytes from BUFFER and return them as an unsigned 32 bit
   // number, using this ByteReader's endianness. This function returns
   // a uint64 so that it is compatible with ReadAddress and
@@ -88,6 +88,14 @@ TEST_F(Reader, SimpleConstructor) {
   EXPECT_EQ(0xfec319c9, reader.ReadAddress(data + 35));
 }
 
+TEST_F(Reader, ThreeBytes) {
+  static const uint8_t data[] = { 0x12, 0x34, 0x56 };
+  ByteReader little_reader(ENDIANNESS_LITTLE);
+  EXPECT_EQ(0x563412U, little_reader.ReadThreeBytes(data));
+  ByteReader big_reader(ENDIANNESS_BIG);
+  EXPECT_EQ(0x123456U, big_reader.ReadThreeBytes(data));
+}
+
 TEST_F(Reader, ValidEncodings) {
   ByteReader reader(ENDIANNESS_LITTLE);
   EXPECT_TRUE(reader.ValidEncoding(
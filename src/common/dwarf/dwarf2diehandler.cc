@@ -186,6 +186,17 @@ void DIEDispatcher::ProcessAttributeString(uint64 offset,
   current.handler_->ProcessAttributeString(attr, form, data);
 }
 
+void DIEDispatcher::ProcessAttributeStringData(uint64 offset,
+                                               enum DwarfAttribute attr,
+                                               enum DwarfForm form,
+                                               const char* data,
+                                               size_t length) {
+  HandlerStack &current = die_handlers_.top();
+  // This had better be an attribute of the DIE we were meant to handle.
+  assert(offset == current.offset_);
+  current.handler_->ProcessAttributeStringData(attr, form, data, length);
+}
+
 void DIEDispatcher::ProcessAttributeSignature(uint64 offset,
                                               enum DwarfAttribute attr,
                                               enum DwarfForm form,
@@ -217,6 +217,18 @@ class DIEHandler {
                                          enum DwarfForm form,
                                          uint64 signture) { }
 
+  // Like dwarf2reader::Dwarf2Handler::ProcessAttributeStringData, this
+  // is called in place of ProcessAttributeString, with a pointer to the
+  // string in the section rather than a copy of it. The default
+  // definition copies the string and passes it to ProcessAttributeString;
+  // override this instead to avoid the copy.
+  virtual void ProcessAttributeStringData(enum DwarfAttribute attr,
+                                          enum DwarfForm form,
+                                          const char* data,
+                                          size_t length) {
+    ProcessAttributeString(attr, form, string(data, length));
+  }
+
   // Once we have reported all the DIE's attributes' values, we call
   // this member function.  If it returns false, we skip all the DIE's
   // children.  If it returns true, we call FindChildHandler on each
@@ -296,6 +308,8 @@ class DIEDispatcher: public Dwarf2Handler {
                             uint8 offset_size, uint64 cu_length,
                             uint8 dwarf_version);
   bool StartDIE(uint64 offset, enum DwarfTag tag);
+  // A DIE we skip has no handler, so neither do any of its descendants.
+  bool SkipsChildrenOfSkippedDIEs() { return true; }
   void ProcessAttributeUnsigned(uint64 offset,
                                 enum DwarfAttribute attr,
                                 enum DwarfForm form,
@@ -317,6 +331,11 @@ class DIEDispatcher: public Dwarf2Handler {
                               enum DwarfAttribute attr,
                               enum DwarfForm form,
                               const string &data);
+  void ProcessAttributeStringData(uint64 offset,
+                                  enum DwarfAttribute attr,
+                                  enum DwarfForm form,
+                                  const char* data,
+                                  size_t length);
   void ProcessAttributeSignature(uint64 offset,
                                  enum DwarfAttribute attr,
                                  enum DwarfForm form,
@@ -233,6 +233,13 @@ TEST(Dwarf2DIEHandler, PassAttributeValues) {
                                        (DwarfForm) 0x15762fec,
                                        StrEq(str)))
       .WillOnce(Return());
+    // String data should reach the handler's ProcessAttributeString
+    // unless the handler overrides ProcessAttributeStringData.
+    EXPECT_CALL(mock_root_handler,
+                ProcessAttributeString((DwarfAttribute) 0x4e1a6b0f,
+                                       (DwarfForm) 0x0d3a5c67,
+                                       StrEq("zephyr")))
+      .WillOnce(Return());
     EXPECT_CALL(mock_root_handler,
                 ProcessAttributeSignature((DwarfAttribute) 0x58790d72,
                                           (DwarfForm) 0x4159f138,
@@ -278,6 +285,10 @@ TEST(Dwarf2DIEHandler, PassAttributeValues) {
                                         (DwarfAttribute) 0x310ed065,
                                         (DwarfForm) 0x15762fec,
                                         str);
+  die_dispatcher.ProcessAttributeStringData(0xe2222da01e29f2a9LL,
+                                            (DwarfAttribute) 0x4e1a6b0f,
+                                            (DwarfForm) 0x0d3a5c67,
+                                            "zephyr and more", 6);
   die_dispatcher.ProcessAttributeSignature(0xe2222da01e29f2a9LL,
                                            (DwarfAttribute) 0x58790d72,
                                            (DwarfForm) 0x4159f138,
@@ -40,6 +40,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 #include <stack>
 #include <string>
 #include <utility>
@@ -58,11 +59,16 @@ CompilationUnit::CompilationUnit(const string& path,
                                  ByteReader* reader, Dwarf2Handler* handler)
     : path_(path), offset_from_section_start_(offset), reader_(reader),
       sections_(sections), handler_(handler), abbrevs_(),
+      abbrev_cache_(NULL),
       string_buffer_(NULL), string_buffer_length_(0),
       str_offsets_buffer_(NULL), str_offsets_buffer_length_(0),
       addr_buffer_(NULL), addr_buffer_length_(0),
+      line_string_buffer_(NULL), line_string_buffer_length_(0),
+      rnglists_buffer_(NULL), rnglists_buffer_length_(0),
+      loclists_buffer_(NULL), loclists_buffer_length_(0),
       is_split_dwarf_(false), dwo_id_(0), dwo_name_(),
       skeleton_dwo_id_(0), ranges_base_(0), addr_base_(0),
+      str_offsets_base_(0), rnglists_base_(0), loclists_base_(0),
       have_checked_for_dwp_(false), dwp_path_(),
       dwp_byte_reader_(), dwp_reader_() {}
 
@@ -94,10 +100,99 @@ void CompilationUnit::SetSplitDwarf(const uint8_t* addr_buffer,
 // zero for the form.  The entire abbreviation section is terminated
 // by a zero for the code.
 
+std::shared_ptr<const AbbrevCache::AbbrevTable> AbbrevCache::Find(
+    uint64 offset) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<uint64, std::shared_ptr<const AbbrevTable> >::const_iterator it =
+      tables_.find(offset);
+  if (it == tables_.end())
+    return std::shared_ptr<const AbbrevTable>();
+  return it->second;
+}
+
+std::shared_ptr<const AbbrevCache::AbbrevTable> AbbrevCache::Insert(
+    uint64 offset, const std::shared_ptr<const AbbrevTable>& table) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tables_.insert(std::make_pair(offset, table)).first->second;
+}
+
+size_t AbbrevCache::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tables_.size();
+}
+
+// Account for an attribute whose form is FORM in the size of ABBREV's
+// DIEs' attributes, noting if its values' size varies.
+static void AddAttributeSize(enum DwarfForm form,
+                             AbbrevCache::Abbrev* abbrev) {
+  switch (form) {
+    case DW_FORM_flag_present:
+    case DW_FORM_implicit_const:
+      return;
+    case DW_FORM_data1:
+    case DW_FORM_flag:
+    case DW_FORM_ref1:
+    case DW_FORM_strx1:
+    case DW_FORM_addrx1:
+      abbrev->fixed_size += 1;
+      return;
+    case DW_FORM_data2:
+    case DW_FORM_ref2:
+    case DW_FORM_strx2:
+    case DW_FORM_addrx2:
+      abbrev->fixed_size += 2;
+      return;
+    case DW_FORM_strx3:
+    case DW_FORM_addrx3:
+      abbrev->fixed_size += 3;
+      return;
+    case DW_FORM_data4:
+    case DW_FORM_ref4:
+    case DW_FORM_ref_sup4:
+    case DW_FORM_strx4:
+    case DW_FORM_addrx4:
+      abbrev->fixed_size += 4;
+      return;
+    case DW_FORM_data8:
+    case DW_FORM_ref8:
+    case DW_FORM_ref_sig8:
+    case DW_FORM_ref_sup8:
+      abbrev->fixed_size += 8;
+      return;
+    case DW_FORM_data16:
+      abbrev->fixed_size += 16;
+      return;
+    case DW_FORM_addr:
+      abbrev->address_size_forms++;
+      return;
+    case DW_FORM_strp:
+    case DW_FORM_sec_offset:
+    case DW_FORM_line_strp:
+    case DW_FORM_strp_sup:
+      abbrev->offset_size_forms++;
+      return;
+    case DW_FORM_ref_addr:
+      abbrev->ref_addr_forms++;
+      return;
+    default:
+      abbrev->has_fixed_size = false;
+      return;
+  }
+}
+
 void CompilationUnit::ReadAbbrevs() {
   if (abbrevs_)
     return;
 
+  // If another unit has already parsed this table, share it. Parsing
+  // without holding the cache's lock means two threads may both parse a
+  // table new to the cache; the first to insert it wins.
+  if (abbrev_cache_) {
+    abbrevs_ = abbrev_cache_->Find(header_.abbrev_offset);
+    if (abbrevs_)
+      return;
+  }
+
   // First get the debug_abbrev section.  ".debug_abbrev" is the name
   // recommended in the DWARF spec, and used on Linux;
   // "__debug_abbrev" is the name used in Mac OS X Mach-O files.
@@ -106,8 +201,9 @@ void CompilationUnit::ReadAbbrevs() {
     iter = sections_.find("__debug_abbrev");
   assert(iter != sections_.end());
 
-  abbrevs_ = new std::vector<Abbrev>;
-  abbrevs_->resize(1);
+  std::shared_ptr<AbbrevCache::AbbrevTable> abbrevs(
+      new AbbrevCache::AbbrevTable);
+  abbrevs->resize(1);
 
   // The only way to check whether we are reading over the end of the
   // buffer would be to first compute the size of the leb128 data by
@@ -138,6 +234,13 @@ void CompilationUnit::ReadAbbrevs() {
     abbrev.has_children = reader_->ReadOneByte(abbrevptr);
     abbrevptr += 1;
 
+    abbrev.has_sibling = false;
+    abbrev.has_fixed_size = true;
+    abbrev.fixed_size = 0;
+    abbrev.address_size_forms = 0;
+    abbrev.offset_size_forms = 0;
+    abbrev.ref_addr_forms = 0;
+
     assert(abbrevptr < abbrev_start + abbrev_length);
 
     while (1) {
@@ -153,24 +256,143 @@ void CompilationUnit::ReadAbbrevs() {
       const enum DwarfAttribute name =
         static_cast<enum DwarfAttribute>(nametemp);
       const enum DwarfForm form = static_cast<enum DwarfForm>(formtemp);
-      abbrev.attributes.push_back(std::make_pair(name, form));
+
+      // A DW_FORM_implicit_const attribute's value is in the abbreviation,
+      // rather than in each DIE.
+      int64 value = 0;
+      if (form == DW_FORM_implicit_const) {
+        value = reader_->ReadSignedLEB128(abbrevptr, &len);
+        abbrevptr += len;
+      }
+      abbrev.attributes.push_back(Attribute(name, form, value));
+      if (name == DW_AT_sibling)
+        abbrev.has_sibling = true;
+      AddAttributeSize(form, &abbrev);
     }
-    assert(abbrev.number == abbrevs_->size());
-    abbrevs_->push_back(abbrev);
+    assert(abbrev.number == abbrevs->size());
+    abbrevs->push_back(abbrev);
   }
+
+  if (abbrev_cache_)
+    abbrevs_ = abbrev_cache_->Insert(header_.abbrev_offset, abbrevs);
+  else
+    abbrevs_ = abbrevs;
 }
 
 // Skips a single DIE's attributes.
 const uint8_t *CompilationUnit::SkipDIE(const uint8_t* start,
                                         const Abbrev& abbrev) {
+  // If all the attributes' forms have fixed sizes, there's no need to
+  // look at their values.
+  if (abbrev.has_fixed_size) {
+    const uint64 ref_addr_size = header_.version == 2 ?
+        reader_->AddressSize() : reader_->OffsetSize();
+    return start + abbrev.fixed_size
+        + abbrev.address_size_forms * reader_->AddressSize()
+        + abbrev.offset_size_forms * reader_->OffsetSize()
+        + abbrev.ref_addr_forms * ref_addr_size;
+  }
+
   for (AttributeList::const_iterator i = abbrev.attributes.begin();
        i != abbrev.attributes.end();
        i++)  {
-    start = SkipAttribute(start, i->second);
+    start = SkipAttribute(start, i->form);
   }
   return start;
 }
 
+// Skips a DIE and all its descendants.
+const uint8_t *CompilationUnit::SkipSubtree(const uint8_t *start,
+                                            const uint8_t *end,
+                                            const Abbrev& abbrev) {
+  // If the DIE says where its next sibling starts, go straight there.
+  if (abbrev.has_sibling) {
+    const uint8_t *sibling = FindSibling(start, end, abbrev);
+    if (sibling)
+      return sibling;
+  }
+
+  // Otherwise, skip the DIE's descendants one at a time, until we reach
+  // the null entry that ends its list of children. Descendants with
+  // children of their own may let us jump over those, too.
+  start = SkipDIE(start, abbrev);
+  uint64 depth = 1;
+  while (depth > 0 && start && start < end) {
+    size_t len;
+    const uint64 abbrev_num = reader_->ReadUnsignedLEB128(start, &len);
+    start += len;
+    if (abbrev_num == 0) {
+      depth--;
+      continue;
+    }
+    const Abbrev& child = abbrevs_->at(static_cast<size_t>(abbrev_num));
+    if (child.has_children && child.has_sibling) {
+      const uint8_t *sibling = FindSibling(start, end, child);
+      if (sibling) {
+        start = sibling;
+        continue;
+      }
+    }
+    start = SkipDIE(start, child);
+    if (child.has_children)
+      depth++;
+  }
+  return start;
+}
+
+// Finds where a DIE's DW_AT_sibling attribute points.
+const uint8_t *CompilationUnit::FindSibling(const uint8_t *start,
+                                            const uint8_t *end,
+                                            const Abbrev& abbrev) {
+  for (AttributeList::const_iterator i = abbrev.attributes.begin();
+       i != abbrev.attributes.end();
+       i++)  {
+    if (i->name != DW_AT_sibling) {
+      start = SkipAttribute(start, i->form);
+      if (!start)
+        return NULL;
+      continue;
+    }
+
+    // The sibling's offset from the start of this compilation unit.
+    uint64 offset;
+    switch (i->form) {
+      case DW_FORM_ref1:
+        offset = reader_->ReadOneByte(start);
+        break;
+      case DW_FORM_ref2:
+        offset = reader_->ReadTwoBytes(start);
+        break;
+      case DW_FORM_ref4:
+        offset = reader_->ReadFourBytes(start);
+        break;
+      case DW_FORM_ref8:
+        offset = reader_->ReadEightBytes(start);
+        break;
+      case DW_FORM_ref_udata: {
+        size_t len;
+        offset = reader_->ReadUnsignedLEB128(start, &len);
+        break;
+      }
+      case DW_FORM_ref_addr: {
+        const uint64 section_offset = header_.version == 2 ?
+            reader_->ReadAddress(start) : reader_->ReadOffset(start);
+        if (section_offset < offset_from_section_start_)
+          return NULL;
+        offset = section_offset - offset_from_section_start_;
+        break;
+      }
+      default:
+        return NULL;
+    }
+    if (offset > static_cast<uint64>(end - buffer_) ||
+        buffer_ + offset <= start)
+      return NULL;
+    return buffer_ + offset;
+  }
+  return NULL;
+}
+
 // Skips a single attribute form's data.
 const uint8_t *CompilationUnit::SkipAttribute(const uint8_t *start,
                                               enum DwarfForm form) {
@@ -184,27 +406,45 @@ const uint8_t *CompilationUnit::SkipAttribute(const uint8_t *start,
       return SkipAttribute(start, form);
 
     case DW_FORM_flag_present:
+    case DW_FORM_implicit_const:
       return start;
     case DW_FORM_data1:
     case DW_FORM_flag:
     case DW_FORM_ref1:
+    case DW_FORM_strx1:
+    case DW_FORM_addrx1:
       return start + 1;
     case DW_FORM_ref2:
     case DW_FORM_data2:
+    case DW_FORM_strx2:
+    case DW_FORM_addrx2:
       return start + 2;
+    case DW_FORM_strx3:
+    case DW_FORM_addrx3:
+      return start + 3;
     case DW_FORM_ref4:
     case DW_FORM_data4:
+    case DW_FORM_ref_sup4:
+    case DW_FORM_strx4:
+    case DW_FORM_addrx4:
       return start + 4;
     case DW_FORM_ref8:
     case DW_FORM_data8:
     case DW_FORM_ref_sig8:
+    case DW_FORM_ref_sup8:
       return start + 8;
+    case DW_FORM_data16:
+      return start + 16;
     case DW_FORM_string:
       return start + strlen(reinterpret_cast<const char *>(start)) + 1;
     case DW_FORM_udata:
     case DW_FORM_ref_udata:
     case DW_FORM_GNU_str_index:
     case DW_FORM_GNU_addr_index:
+    case DW_FORM_strx:
+    case DW_FORM_addrx:
+    case DW_FORM_loclistx:
+    case DW_FORM_rnglistx:
       reader_->ReadUnsignedLEB128(start, &len);
       return start + len;
 
@@ -237,17 +477,21 @@ const uint8_t *CompilationUnit::SkipAttribute(const uint8_t *start,
     }
     case DW_FORM_strp:
     case DW_FORM_sec_offset:
+    case DW_FORM_line_strp:
+    case DW_FORM_strp_sup:
       return start + reader_->OffsetSize();
   }
   fprintf(stderr,"Unhandled form type");
   return NULL;
 }
 
-// Read a DWARF2/3 header.
+// Read a DWARF2/3/4/5 header.
 // The header is variable length in DWARF3 (and DWARF2 as extended by
 // most compilers), and consists of an length field, a version number,
 // the offset in the .debug_abbrev section for our abbrevs, and an
-// address size.
+// address size. DWARF 5 puts a unit type between the version and the
+// address size, moves the abbrevs' offset after the address size, and
+// follows them with fields that depend on the unit type.
 void CompilationUnit::ReadHeader() {
   const uint8_t *headerptr = buffer_;
   size_t initial_length_size;
@@ -262,16 +506,49 @@ void CompilationUnit::ReadHeader() {
   header_.version = reader_->ReadTwoBytes(headerptr);
   headerptr += 2;
 
-  assert(headerptr + reader_->OffsetSize() < buffer_ + buffer_length_);
-  header_.abbrev_offset = reader_->ReadOffset(headerptr);
-  headerptr += reader_->OffsetSize();
-
-  // Compare against less than or equal because this may be the last
-  // section in the file.
-  assert(headerptr + 1 <= buffer_ + buffer_length_);
-  header_.address_size = reader_->ReadOneByte(headerptr);
-  reader_->SetAddressSize(header_.address_size);
-  headerptr += 1;
+  if (header_.version >= 5) {
+    assert(headerptr + 2 < buffer_ + buffer_length_);
+    header_.unit_type = reader_->ReadOneByte(headerptr);
+    headerptr += 1;
+    header_.address_size = reader_->ReadOneByte(headerptr);
+    reader_->SetAddressSize(header_.address_size);
+    headerptr += 1;
+
+    // Compare against less than or equal because this may be the last
+    // section in the file.
+    assert(headerptr + reader_->OffsetSize() <= buffer_ + buffer_length_);
+    header_.abbrev_offset = reader_->ReadOffset(headerptr);
+    headerptr += reader_->OffsetSize();
+
+    switch (header_.unit_type) {
+      case DW_UT_skeleton:
+      case DW_UT_split_compile:
+        assert(headerptr + 8 <= buffer_ + buffer_length_);
+        dwo_id_ = reader_->ReadEightBytes(headerptr);
+        headerptr += 8;
+        break;
+      case DW_UT_type:
+      case DW_UT_split_type:
+        // Skip the type signature and the offset of the type's DIE.
+        headerptr += 8 + reader_->OffsetSize();
+        break;
+      default:
+        break;
+    }
+  } else {
+    header_.unit_type = DW_UT_compile;
+
+    assert(headerptr + reader_->OffsetSize() < buffer_ + buffer_length_);
+    header_.abbrev_offset = reader_->ReadOffset(headerptr);
+    headerptr += reader_->OffsetSize();
+
+    // Compare against less than or equal because this may be the last
+    // section in the file.
+    assert(headerptr + 1 <= buffer_ + buffer_length_);
+    header_.address_size = reader_->ReadOneByte(headerptr);
+    reader_->SetAddressSize(header_.address_size);
+    headerptr += 1;
+  }
 
   after_header_ = headerptr;
 
@@ -343,6 +620,36 @@ uint64 CompilationUnit::Start() {
     addr_buffer_length_ = iter->second.second;
   }
 
+  // Set the DWARF 5 line string, range list, and location list sections
+  // if we have them.
+  iter = sections_.find(".debug_line_str");
+  if (iter == sections_.end())
+    iter = sections_.find("__debug_line_str");
+  if (iter != sections_.end()) {
+    line_string_buffer_ = iter->second.first;
+    line_string_buffer_length_ = iter->second.second;
+  }
+  iter = sections_.find(".debug_rnglists");
+  if (iter == sections_.end())
+    iter = sections_.find("__debug_rnglists");
+  if (iter != sections_.end()) {
+    rnglists_buffer_ = iter->second.first;
+    rnglists_buffer_length_ = iter->second.second;
+  }
+  iter = sections_.find(".debug_loclists");
+  if (iter == sections_.end())
+    iter = sections_.find("__debug_loclists");
+  if (iter != sections_.end()) {
+    loclists_buffer_ = iter->second.first;
+    loclists_buffer_length_ = iter->second.second;
+  }
+
+  // A DWARF 5 split unit has no DW_AT_str_offsets_base attribute; its
+  // string offsets follow the header of the .debug_str_offsets.dwo
+  // section: a length, a version, and two bytes of padding.
+  if (is_split_dwarf_ && header_.version >= 5)
+    str_offsets_base_ = reader_->OffsetSize() == 8 ? 16 : 8;
+
   // Now that we have our abbreviations, start processing DIE's.
   ProcessDIEs();
 
@@ -362,7 +669,7 @@ uint64 CompilationUnit::Start() {
 // This is all boring data manipulation and calling of the handler.
 const uint8_t *CompilationUnit::ProcessAttribute(
     uint64 dieoffset, const uint8_t *start, enum DwarfAttribute attr,
-    enum DwarfForm form) {
+    enum DwarfForm form, int64 implicit_const) {
   size_t len;
 
   switch (form) {
@@ -372,11 +679,14 @@ const uint8_t *CompilationUnit::ProcessAttribute(
       form = static_cast<enum DwarfForm>(reader_->ReadUnsignedLEB128(start,
                                                                      &len));
       start += len;
-      return ProcessAttribute(dieoffset, start, attr, form);
+      return ProcessAttribute(dieoffset, start, attr, form, implicit_const);
 
     case DW_FORM_flag_present:
       ProcessAttributeUnsigned(dieoffset, attr, form, 1);
       return start;
+    case DW_FORM_implicit_const:
+      ProcessAttributeSigned(dieoffset, attr, form, implicit_const);
+      return start;
     case DW_FORM_data1:
     case DW_FORM_flag:
       ProcessAttributeUnsigned(dieoffset, attr, form,
@@ -487,6 +797,9 @@ const uint8_t *CompilationUnit::ProcessAttribute(
                                        datalen);
       return start + datalen + len;
     }
+    case DW_FORM_data16:
+      handler_->ProcessAttributeBuffer(dieoffset, attr, form, start, 16);
+      return start + 16;
     case DW_FORM_strp: {
       assert(string_buffer_ != NULL);
 
@@ -498,40 +811,167 @@ const uint8_t *CompilationUnit::ProcessAttribute(
       return start + reader_->OffsetSize();
     }
 
-    case DW_FORM_GNU_str_index: {
-      uint64 str_index = reader_->ReadUnsignedLEB128(start, &len);
-      const uint8_t* offset_ptr =
-          str_offsets_buffer_ + str_index * reader_->OffsetSize();
-      const uint64 offset = reader_->ReadOffset(offset_ptr);
-      if (offset >= string_buffer_length_) {
-        return NULL;
+    case DW_FORM_line_strp: {
+      const uint64 offset = reader_->ReadOffset(start);
+      if (line_string_buffer_ && offset < line_string_buffer_length_) {
+        const char *str =
+            reinterpret_cast<const char *>(line_string_buffer_ + offset);
+        ProcessAttributeString(dieoffset, attr, form, str);
       }
+      return start + reader_->OffsetSize();
+    }
 
-      const char* str = reinterpret_cast<const char *>(string_buffer_) + offset;
-      ProcessAttributeString(dieoffset, attr, form, str);
+    case DW_FORM_GNU_str_index:
+    case DW_FORM_strx:
+      ProcessStringIndex(dieoffset, attr, form,
+                         reader_->ReadUnsignedLEB128(start, &len));
       return start + len;
-      break;
-    }
-    case DW_FORM_GNU_addr_index: {
-      uint64 addr_index = reader_->ReadUnsignedLEB128(start, &len);
-      const uint8_t* addr_ptr =
-          addr_buffer_ + addr_base_ + addr_index * reader_->AddressSize();
-      ProcessAttributeUnsigned(dieoffset, attr, form,
-                               reader_->ReadAddress(addr_ptr));
+    case DW_FORM_strx1:
+      ProcessStringIndex(dieoffset, attr, form, reader_->ReadOneByte(start));
+      return start + 1;
+    case DW_FORM_strx2:
+      ProcessStringIndex(dieoffset, attr, form, reader_->ReadTwoBytes(start));
+      return start + 2;
+    case DW_FORM_strx3:
+      ProcessStringIndex(dieoffset, attr, form,
+                         reader_->ReadThreeBytes(start));
+      return start + 3;
+    case DW_FORM_strx4:
+      ProcessStringIndex(dieoffset, attr, form,
+                         reader_->ReadFourBytes(start));
+      return start + 4;
+
+    case DW_FORM_GNU_addr_index:
+    case DW_FORM_addrx:
+      ProcessAddressIndex(dieoffset, attr, form,
+                          reader_->ReadUnsignedLEB128(start, &len));
       return start + len;
-    }
+    case DW_FORM_addrx1:
+      ProcessAddressIndex(dieoffset, attr, form, reader_->ReadOneByte(start));
+      return start + 1;
+    case DW_FORM_addrx2:
+      ProcessAddressIndex(dieoffset, attr, form,
+                          reader_->ReadTwoBytes(start));
+      return start + 2;
+    case DW_FORM_addrx3:
+      ProcessAddressIndex(dieoffset, attr, form,
+                          reader_->ReadThreeBytes(start));
+      return start + 3;
+    case DW_FORM_addrx4:
+      ProcessAddressIndex(dieoffset, attr, form,
+                          reader_->ReadFourBytes(start));
+      return start + 4;
+
+    case DW_FORM_rnglistx:
+      ProcessListIndex(dieoffset, attr, form,
+                       reader_->ReadUnsignedLEB128(start, &len),
+                       rnglists_buffer_, rnglists_buffer_length_,
+                       rnglists_base_);
+      return start + len;
+    case DW_FORM_loclistx:
+      ProcessListIndex(dieoffset, attr, form,
+                       reader_->ReadUnsignedLEB128(start, &len),
+                       loclists_buffer_, loclists_buffer_length_,
+                       loclists_base_);
+      return start + len;
+
+    // These refer to a supplementary object file, which we don't read.
+    case DW_FORM_ref_sup4:
+      return start + 4;
+    case DW_FORM_ref_sup8:
+      return start + 8;
+    case DW_FORM_strp_sup:
+      return start + reader_->OffsetSize();
   }
   fprintf(stderr, "Unhandled form type\n");
   return NULL;
 }
 
+void CompilationUnit::ReadUnitBases(const uint8_t *start,
+                                    const Abbrev& abbrev) {
+  for (AttributeList::const_iterator i = abbrev.attributes.begin();
+       i != abbrev.attributes.end();
+       i++)  {
+    uint64 *base = NULL;
+    switch (i->name) {
+      case DW_AT_str_offsets_base: base = &str_offsets_base_; break;
+      case DW_AT_addr_base:        base = &addr_base_;        break;
+      case DW_AT_rnglists_base:    base = &rnglists_base_;    break;
+      case DW_AT_loclists_base:    base = &loclists_base_;    break;
+      default: break;
+    }
+    if (base && i->form == DW_FORM_sec_offset)
+      *base = reader_->ReadOffset(start);
+    start = SkipAttribute(start, i->form);
+    if (!start)
+      return;
+  }
+}
+
+void CompilationUnit::ProcessStringIndex(uint64 offset,
+                                         enum DwarfAttribute attr,
+                                         enum DwarfForm form,
+                                         uint64 index) {
+  const uint64 offset_size = reader_->OffsetSize();
+  if (!str_offsets_buffer_ || !string_buffer_ ||
+      str_offsets_base_ > str_offsets_buffer_length_ ||
+      index >= (str_offsets_buffer_length_ - str_offsets_base_) / offset_size)
+    return;
+  const uint64 string_offset = reader_->ReadOffset(
+      str_offsets_buffer_ + str_offsets_base_ + index * offset_size);
+  if (string_offset >= string_buffer_length_)
+    return;
+  ProcessAttributeString(
+      offset, attr, form,
+      reinterpret_cast<const char *>(string_buffer_ + string_offset));
+}
+
+void CompilationUnit::ProcessAddressIndex(uint64 offset,
+                                          enum DwarfAttribute attr,
+                                          enum DwarfForm form,
+                                          uint64 index) {
+  const uint64 address_size = reader_->AddressSize();
+  if (!addr_buffer_ || addr_base_ > addr_buffer_length_ ||
+      index >= (addr_buffer_length_ - addr_base_) / address_size)
+    return;
+  ProcessAttributeUnsigned(
+      offset, attr, form,
+      reader_->ReadAddress(addr_buffer_ + addr_base_ + index * address_size));
+}
+
+void CompilationUnit::ProcessListIndex(uint64 offset,
+                                       enum DwarfAttribute attr,
+                                       enum DwarfForm form,
+                                       uint64 index,
+                                       const uint8_t *buffer,
+                                       uint64 buffer_length,
+                                       uint64 base) {
+  // The offsets in the table are relative to the table's start.
+  const uint64 offset_size = reader_->OffsetSize();
+  if (!buffer || base > buffer_length ||
+      index >= (buffer_length - base) / offset_size)
+    return;
+  ProcessAttributeUnsigned(
+      offset, attr, form,
+      base + reader_->ReadOffset(buffer + base + index * offset_size));
+}
+
 const uint8_t *CompilationUnit::ProcessDIE(uint64 dieoffset,
                                            const uint8_t *start,
                                            const Abbrev& abbrev) {
+  // A DWARF 5 unit's root DIE may give the values of attributes with
+  // indexed forms before it gives the bases the indexes are relative to.
+  if (header_.version >= 5 &&
+      (abbrev.tag == DW_TAG_compile_unit ||
+       abbrev.tag == DW_TAG_skeleton_unit ||
+       abbrev.tag == DW_TAG_partial_unit ||
+       abbrev.tag == DW_TAG_type_unit))
+    ReadUnitBases(start, abbrev);
+
   for (AttributeList::const_iterator i = abbrev.attributes.begin();
        i != abbrev.attributes.end();
        i++)  {
-    start = ProcessAttribute(dieoffset, start, i->first, i->second);
+    start = ProcessAttribute(dieoffset, start, i->name, i->form, i->value);
   }
 
   // If this is a compilation unit in a split DWARF object, verify that
@@ -561,9 +1001,15 @@ void CompilationUnit::ProcessDIEs() {
   else
     lengthstart += 4;
 
+  const uint8_t *end = lengthstart + header_.length;
+
+  // If the handler has no use for the descendants of DIEs it skips, we
+  // can step over their subtrees wholesale.
+  const bool skip_children = handler_->SkipsChildrenOfSkippedDIEs();
+
   std::stack<uint64> die_stack;
   
-  while (dieptr < (lengthstart + header_.length)) {
+  while (dieptr < end) {
     // We give the user the absolute offset from the beginning of
     // debug_info, since they need it to deal with ref_addr forms.
     uint64 absolute_offset = (dieptr - buffer_) + offset_from_section_start_;
@@ -587,6 +1033,11 @@ void CompilationUnit::ProcessDIEs() {
     const Abbrev& abbrev = abbrevs_->at(static_cast<size_t>(abbrev_num));
     const enum DwarfTag tag = abbrev.tag;
     if (!handler_->StartDIE(absolute_offset, tag)) {
+      if (abbrev.has_children && skip_children) {
+        dieptr = SkipSubtree(dieptr, end, abbrev);
+        handler_->EndDIE(absolute_offset);
+        continue;
+      }
       dieptr = SkipDIE(dieptr, abbrev);
     } else {
       dieptr = ProcessDIE(absolute_offset, dieptr, abbrev);
@@ -903,13 +1354,25 @@ uint32 DwpReader::LookupCUv2(uint64 dwo_id) {
 
 LineInfo::LineInfo(const uint8_t *buffer, uint64 buffer_length,
                    ByteReader* reader, LineInfoHandler* handler):
-    handler_(handler), reader_(reader), buffer_(buffer) {
+    handler_(handler), reader_(reader), buffer_(buffer),
+    string_buffer_(NULL), string_buffer_length_(0),
+    line_string_buffer_(NULL), line_string_buffer_length_(0) {
 #ifndef NDEBUG
   buffer_length_ = buffer_length;
 #endif
   header_.std_opcode_lengths = NULL;
 }
 
+void LineInfo::SetStringSections(const uint8_t *string_buffer,
+                                 uint64 string_buffer_length,
+                                 const uint8_t *line_string_buffer,
+                                 uint64 line_string_buffer_length) {
+  string_buffer_ = string_buffer;
+  string_buffer_length_ = string_buffer_length;
+  line_string_buffer_ = line_string_buffer;
+  line_string_buffer_length_ = line_string_buffer_length;
+}
+
 uint64 LineInfo::Start() {
   ReadHeader();
   ReadLines();
@@ -936,8 +1399,22 @@ void LineInfo::ReadHeader() {
   header_.version = reader_->ReadTwoBytes(lineptr);
   lineptr += 2;
 
+  if (header_.version >= 5) {
+    // DWARF 5 gives the address size here, too, though it must match
+    // the compilation unit's. We don't support segment selectors.
+    __attribute__((unused)) uint8 address_size =
+        reader_->ReadOneByte(lineptr);
+    ++lineptr;
+    assert(address_size == reader_->AddressSize());
+    __attribute__((unused)) uint8 segment_selector_size =
+        reader_->ReadOneByte(lineptr);
+    ++lineptr;
+    assert(segment_selector_size == 0);
+  }
+
   header_.prologue_length = reader_->ReadOffset(lineptr);
   lineptr += reader_->OffsetSize();
+  const uint8_t *end_of_header = lineptr + header_.prologue_length;
 
   header_.min_insn_length = reader_->ReadOneByte(lineptr);
   lineptr += 1;
@@ -969,6 +1446,18 @@ void LineInfo::ReadHeader() {
     lineptr += 1;
   }
 
+  // DWARF 5 describes the contents of the directory and file name
+  // entries, and numbers both from zero. The header's length tells us
+  // where the line program starts, even if the tables use forms we
+  // can't read.
+  if (header_.version >= 5) {
+    lineptr = ReadEntryTable(lineptr, false);
+    if (lineptr)
+      ReadEntryTable(lineptr, true);
+    after_header_ = end_of_header;
+    return;
+  }
+
   // It is legal for the directory entry table to be empty.
   if (*lineptr) {
     uint32 dirindex = 1;
@@ -1007,6 +1496,101 @@ void LineInfo::ReadHeader() {
   after_header_ = lineptr;
 }
 
+const uint8_t *LineInfo::ReadEntryTable(const uint8_t *lineptr, bool files) {
+  size_t len;
+
+  // The kind of content each field of the entries holds, and its form.
+  const uint8 format_count = reader_->ReadOneByte(lineptr);
+  lineptr += 1;
+  std::vector<std::pair<uint64, enum DwarfForm> > format(format_count);
+  for (uint8 i = 0; i < format_count; i++) {
+    format[i].first = reader_->ReadUnsignedLEB128(lineptr, &len);
+    lineptr += len;
+    format[i].second =
+        static_cast<enum DwarfForm>(reader_->ReadUnsignedLEB128(lineptr, &len));
+    lineptr += len;
+  }
+
+  const uint64 entry_count = reader_->ReadUnsignedLEB128(lineptr, &len);
+  lineptr += len;
+  for (uint64 index = 0; index < entry_count; index++) {
+    const char *name = NULL;
+    uint64 dirindex = 0, mod_time = 0, filelength = 0;
+    for (uint8 i = 0; i < format_count; i++) {
+      const char *string = NULL;
+      uint64 value = 0;
+      lineptr = ReadEntryField(lineptr, format[i].second, &string, &value);
+      if (!lineptr)
+        return NULL;
+      switch (format[i].first) {
+        case DW_LNCT_path:            name = string;      break;
+        case DW_LNCT_directory_index: dirindex = value;   break;
+        case DW_LNCT_timestamp:       mod_time = value;   break;
+        case DW_LNCT_size:            filelength = value; break;
+        default: break;
+      }
+    }
+    if (!name)
+      continue;
+    if (files) {
+      handler_->DefineFile(name, static_cast<int32>(index),
+                           static_cast<uint32>(dirindex), mod_time,
+                           filelength);
+    } else {
+      handler_->DefineDir(name, static_cast<uint32>(index));
+    }
+  }
+  return lineptr;
+}
+
+const uint8_t *LineInfo::ReadEntryField(const uint8_t *lineptr,
+                                        enum DwarfForm form,
+                                        const char **string,
+                                        uint64 *value) {
+  size_t len;
+  switch (form) {
+    case DW_FORM_string:
+      *string = reinterpret_cast<const char *>(lineptr);
+      return lineptr + strlen(*string) + 1;
+    case DW_FORM_line_strp:
+    case DW_FORM_strp: {
+      const uint8_t *buffer = string_buffer_;
+      uint64 buffer_length = string_buffer_length_;
+      if (form == DW_FORM_line_strp) {
+        buffer = line_string_buffer_;
+        buffer_length = line_string_buffer_length_;
+      }
+      const uint64 offset = reader_->ReadOffset(lineptr);
+      if (buffer && offset < buffer_length)
+        *string = reinterpret_cast<const char *>(buffer + offset);
+      return lineptr + reader_->OffsetSize();
+    }
+    case DW_FORM_udata:
+      *value = reader_->ReadUnsignedLEB128(lineptr, &len);
+      return lineptr + len;
+    case DW_FORM_data1:
+      *value = reader_->ReadOneByte(lineptr);
+      return lineptr + 1;
+    case DW_FORM_data2:
+      *value = reader_->ReadTwoBytes(lineptr);
+      return lineptr + 2;
+    case DW_FORM_data4:
+      *value = reader_->ReadFourBytes(lineptr);
+      return lineptr + 4;
+    case DW_FORM_data8:
+      *value = reader_->ReadEightBytes(lineptr);
+      return lineptr + 8;
+    case DW_FORM_data16:
+      return lineptr + 16;
+    case DW_FORM_block: {
+      const uint64 size = reader_->ReadUnsignedLEB128(lineptr, &len);
+      return lineptr + len + size;
+    }
+    default:
+      return NULL;
+  }
+}
+
 /* static */
 bool LineInfo::ProcessOneOpcode(ByteReader* reader,
                                 LineInfoHandler* handler,
@@ -1247,6 +1831,160 @@ void LineInfo::ReadLines() {
   after_header_ = lengthstart + header_.total_length;
 }
 
+RangeListReader::RangeListReader(const uint8_t *buffer, uint64 buffer_length,
+                                 ByteReader *reader,
+                                 RangeListHandler *handler)
+    : buffer_(buffer), buffer_length_(buffer_length),
+      reader_(reader), handler_(handler),
+      addr_buffer_(NULL), addr_buffer_length_(0), addr_base_(0) { }
+
+void RangeListReader::SetAddressTable(const uint8_t *addr_buffer,
+                                      uint64 addr_buffer_length,
+                                      uint64 addr_base) {
+  addr_buffer_ = addr_buffer;
+  addr_buffer_length_ = addr_buffer_length;
+  addr_base_ = addr_base;
+}
+
+bool RangeListReader::ReadRangeList(uint64 offset, uint64 base) {
+  const uint64 max_address =
+    (reader_->AddressSize() == 4) ? 0xffffffffUL
+                                  : 0xffffffffffffffffULL;
+  const uint64 entry_size = reader_->AddressSize() * 2;
+  bool list_end = false;
+
+  do {
+    if (buffer_length_ < entry_size || offset > buffer_length_ - entry_size) {
+      return false; // Invalid range detected
+    }
+
+    uint64 start_address = reader_->ReadAddress(buffer_ + offset);
+    uint64 end_address =
+      reader_->ReadAddress(buffer_ + offset + reader_->AddressSize());
+
+    if (start_address == max_address) { // Base address selection
+      base = end_address;
+      handler_->SetBaseAddress(base);
+    } else if (start_address == 0 && end_address == 0) { // End-of-list
+      handler_->Finish();
+      list_end = true;
+    } else { // Add a range entry
+      handler_->AddRange(start_address + base, end_address + base);
+    }
+
+    offset += entry_size;
+  } while (!list_end);
+
+  return true;
+}
+
+bool RangeListReader::ReadRngList(uint64 offset, uint64 base) {
+  const uint8_t *entry = buffer_ + offset;
+  const uint8_t *end = buffer_ + buffer_length_;
+  const uint64 address_size = reader_->AddressSize();
+  size_t len;
+
+  if (offset >= buffer_length_)
+    return false;
+
+  while (entry < end) {
+    const uint8 kind = reader_->ReadOneByte(entry);
+    entry++;
+
+    // Entries' operands are indexes into the address table, addresses,
+    // lengths, or offsets from the base address.
+    uint64 start, limit;
+    switch (kind) {
+      case DW_RLE_end_of_list:
+        handler_->Finish();
+        return true;
+
+      case DW_RLE_base_addressx:
+        start = reader_->ReadUnsignedLEB128(entry, &len);
+        entry += len;
+        if (entry > end || !ReadIndexedAddress(start, &base))
+          return false;
+        handler_->SetBaseAddress(base);
+        break;
+
+      case DW_RLE_startx_endx:
+        start = reader_->ReadUnsignedLEB128(entry, &len);
+        entry += len;
+        limit = reader_->ReadUnsignedLEB128(entry, &len);
+        entry += len;
+        if (entry > end || !ReadIndexedAddress(start, &start) ||
+            !ReadIndexedAddress(limit, &limit))
+          return false;
+        handler_->AddRange(start, limit);
+        break;
+
+      case DW_RLE_startx_length:
+        start = reader_->ReadUnsignedLEB128(entry, &len);
+        entry += len;
+        limit = reader_->ReadUnsignedLEB128(entry, &len);
+        entry += len;
+        if (entry > end || !ReadIndexedAddress(start, &start))
+          return false;
+        handler_->AddRange(start, start + limit);
+        break;
+
+      case DW_RLE_offset_pair:
+        start = reader_->ReadUnsignedLEB128(entry, &len);
+        entry += len;
+        limit = reader_->ReadUnsignedLEB128(entry, &len);
+        entry += len;
+        if (entry > end)
+          return false;
+        handler_->AddRange(base + start, base + limit);
+        break;
+
+      case DW_RLE_base_address:
+        if (static_cast<uint64>(end - entry) < address_size)
+          return false;
+        base = reader_->ReadAddress(entry);
+        entry += address_size;
+        handler_->SetBaseAddress(base);
+        break;
+
+      case DW_RLE_start_end:
+        if (static_cast<uint64>(end - entry) < 2 * address_size)
+          return false;
+        start = reader_->ReadAddress(entry);
+        limit = reader_->ReadAddress(entry + address_size);
+        entry += 2 * address_size;
+        handler_->AddRange(start, limit);
+        break;
+
+      case DW_RLE_start_length:
+        if (static_cast<uint64>(end - entry) < address_size)
+          return false;
+        start = reader_->ReadAddress(entry);
+        entry += address_size;
+        limit = reader_->ReadUnsignedLEB128(entry, &len);
+        entry += len;
+        if (entry > end)
+          return false;
+        handler_->AddRange(start, start + limit);
+        break;
+
+      default:
+        return false;
+    }
+  }
+
+  return false;
+}
+
+bool RangeListReader::ReadIndexedAddress(uint64 index, uint64 *address) {
+  const uint64 address_size = reader_->AddressSize();
+  if (!addr_buffer_ || addr_base_ > addr_buffer_length_ ||
+      index >= (addr_buffer_length_ - addr_base_) / address_size)
+    return false;
+  *address =
+      reader_->ReadAddress(addr_buffer_ + addr_base_ + index * address_size);
+  return true;
+}
+
 // A DWARF rule for recovering the address or value of a register, or
 // computing the canonical frame address. There is one subclass of this for
 // each '*Rule' member function in CallFrameInfo::Handler.
@@ -41,9 +41,11 @@
 #define COMMON_DWARF_DWARF2READER_H__
 
 #include <stdint.h>
+#include <string.h>
 
 #include <list>
 #include <map>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -64,8 +66,19 @@ class DwpReader;
 // This maps from a string naming a section to a pair containing a
 // the data for the section, and the size of the section.
 typedef std::map<string, std::pair<const uint8_t *, uint64> > SectionMap;
-typedef std::list<std::pair<enum DwarfAttribute, enum DwarfForm> >
-    AttributeList;
+
+// An attribute specification from an abbreviation: the attribute's
+// name and form, and, if the form is DW_FORM_implicit_const, its value,
+// which the abbreviation holds in place of each DIE.
+struct Attribute {
+  Attribute(enum DwarfAttribute name_arg, enum DwarfForm form_arg,
+            int64 value_arg)
+      : name(name_arg), form(form_arg), value(value_arg) { }
+  enum DwarfAttribute name;
+  enum DwarfForm form;
+  int64 value;
+};
+typedef std::list<Attribute> AttributeList;
 typedef AttributeList::iterator AttributeIterator;
 typedef AttributeList::const_iterator ConstAttributeIterator;
 
@@ -99,6 +112,17 @@ class LineInfo {
     }
   }
 
+  // Use the STRING_BUFFER_LENGTH bytes at STRING_BUFFER, the
+  // .debug_str section, and the LINE_STRING_BUFFER_LENGTH bytes at
+  // LINE_STRING_BUFFER, the .debug_line_str section, to find the
+  // directory and file names that a DWARF 5 header gives as offsets
+  // into those sections. Either buffer may be NULL if the file has no
+  // such section.
+  void SetStringSections(const uint8_t *string_buffer,
+                         uint64 string_buffer_length,
+                         const uint8_t *line_string_buffer,
+                         uint64 line_string_buffer_length);
+
   // Start processing line info, and calling callbacks in the handler.
   // Consumes the line number information for a single compilation unit.
   // Returns the number of bytes processed.
@@ -126,6 +150,21 @@ class LineInfo {
   // Reads the DWARF2/3 header for this line info.
   void ReadHeader();
 
+  // Reads a DWARF 5 directory or file name table, starting at LINEPTR:
+  // a description of the entries' contents, followed by the entries
+  // themselves. Calls DefineFile for each entry if FILES is true, or
+  // DefineDir otherwise. Returns a pointer just past the end of the
+  // table, or NULL if it uses a form we can't read.
+  const uint8_t *ReadEntryTable(const uint8_t *lineptr, bool files);
+
+  // Reads the value of FORM at LINEPTR, a field of a DWARF 5 directory
+  // or file name entry. If the value is a string, sets *STRING to point
+  // to it, or to NULL if it can't be found; otherwise sets *VALUE.
+  // Returns a pointer just past the end of the value, or NULL if FORM is
+  // not one we can read.
+  const uint8_t *ReadEntryField(const uint8_t *lineptr, enum DwarfForm form,
+                                const char **string, uint64 *value);
+
   // Reads the DWARF2/3 line information
   void ReadLines();
 
@@ -149,6 +188,12 @@ class LineInfo {
   uint64 buffer_length_;
 #endif
   const uint8_t *after_header_;
+
+  // The .debug_str and .debug_line_str sections, if we have them.
+  const uint8_t *string_buffer_;
+  uint64 string_buffer_length_;
+  const uint8_t *line_string_buffer_;
+  uint64 line_string_buffer_length_;
 };
 
 // This class is the main interface between the line info reader and
@@ -187,6 +232,72 @@ class LineInfoHandler {
                        uint32 file_num, uint32 line_num, uint32 column_num) { }
 };
 
+// This class is the interface between the range list reader and the
+// client.  The virtual functions inside this get called for each
+// entry of a range list.  The default implementation does nothing.
+
+class RangeListHandler {
+ public:
+  RangeListHandler() { }
+
+  virtual ~RangeListHandler() { }
+
+  // Add a range [BEGIN, END), given as absolute addresses.
+  virtual void AddRange(uint64 begin, uint64 end) { }
+
+  // A base address selection entry sets the address that later ranges
+  // are relative to to BASE.
+  virtual void SetBaseAddress(uint64 base) { }
+
+  // Called when the end of the range list is reached.
+  virtual void Finish() { }
+};
+
+// This class reads range lists. A DWARF 2-4 range list, from the
+// .debug_ranges section, is a series of pairs of addresses relative to
+// a base address, ending with a pair of zeros; a pair whose first
+// address is all ones selects a new base address. A DWARF 5 range
+// list, from the .debug_rnglists section, is a series of entries, each
+// starting with a DW_RLE code saying how it gives its range, or the new
+// base address it selects.
+class RangeListReader {
+ public:
+  // Read range lists from the BUFFER_LENGTH bytes at BUFFER, using
+  // READER, which must already have its address size set, and report
+  // them to HANDLER.
+  RangeListReader(const uint8_t *buffer, uint64 buffer_length,
+                  ByteReader *reader, RangeListHandler *handler);
+
+  // Look up the addresses that DWARF 5 range lists give by index in the
+  // ADDR_BUFFER_LENGTH bytes at ADDR_BUFFER, the .debug_addr section,
+  // counting from ADDR_BASE, the unit's DW_AT_addr_base value.
+  void SetAddressTable(const uint8_t *addr_buffer, uint64 addr_buffer_length,
+                       uint64 addr_base);
+
+  // Read the DWARF 2-4 range list at OFFSET in the section, whose ranges
+  // start out relative to BASE.  Return false if the list runs off the
+  // end of the section.
+  bool ReadRangeList(uint64 offset, uint64 base);
+
+  // Read the DWARF 5 range list at OFFSET in the section, whose offset
+  // pairs start out relative to BASE.  Return false if the list runs
+  // off the end of the section, or is otherwise malformed.
+  bool ReadRngList(uint64 offset, uint64 base);
+
+ private:
+  // Set *ADDRESS to the entry at INDEX in the address table. Return
+  // false if there is no such entry.
+  bool ReadIndexedAddress(uint64 index, uint64 *address);
+
+  const uint8_t *buffer_;
+  uint64 buffer_length_;
+  ByteReader *reader_;
+  RangeListHandler *handler_;
+  const uint8_t *addr_buffer_;
+  uint64 addr_buffer_length_;
+  uint64 addr_base_;
+};
+
 // This class is the main interface between the reader and the
 // client.  The virtual functions inside this get called for
 // interesting events that happen during DWARF2 reading.
@@ -221,10 +332,21 @@ class Dwarf2Handler {
   // section. Return false if you would like to skip this DIE.
   virtual bool StartDIE(uint64 offset, enum DwarfTag tag) { return false; }
 
+  // Return true if skipping a DIE by returning false from StartDIE means
+  // skipping all its descendants as well. The reader can then step over
+  // the DIE's whole subtree, using its DW_AT_sibling attribute if it has
+  // one, without calling StartDIE or EndDIE on the descendants. EndDIE is
+  // still called on the skipped DIE itself. The reader asks once per
+  // compilation unit. The default returns false, so that the handler
+  // sees every DIE.
+  virtual bool SkipsChildrenOfSkippedDIEs() { return false; }
+
   // Called when we have an attribute with unsigned data to give to our
   // handler. The attribute is for the DIE at OFFSET from the beginning of the
   // .debug_info section. Its name is ATTR, its form is FORM, and its value is
-  // DATA.
+  // DATA. For the DW_FORM_rnglistx and DW_FORM_loclistx forms, DATA is the
+  // offset of the list in the .debug_rnglists or .debug_loclists section,
+  // not its index.
   virtual void ProcessAttributeUnsigned(uint64 offset,
                                         enum DwarfAttribute attr,
                                         enum DwarfForm form,
@@ -270,6 +392,20 @@ class Dwarf2Handler {
                                       enum DwarfForm form,
                                       const string& data) { }
 
+  // Called in place of ProcessAttributeString, to give the handler a
+  // string attribute's value without copying it. DATA points to the
+  // LENGTH bytes of the string in the section it was read from; they are
+  // followed by a NUL, and remain valid for as long as the section data
+  // does. The default implementation copies the string and passes it to
+  // ProcessAttributeString.
+  virtual void ProcessAttributeStringData(uint64 offset,
+                                          enum DwarfAttribute attr,
+                                          enum DwarfForm form,
+                                          const char* data,
+                                          size_t length) {
+    ProcessAttributeString(offset, attr, form, string(data, length));
+  }
+
   // Called when we have an attribute whose value is the 64-bit signature
   // of a type unit in the .debug_types section. OFFSET is the offset of
   // the DIE whose attribute we're reporting. ATTR and FORM are the
@@ -287,6 +423,64 @@ class Dwarf2Handler {
 
 };
 
+// A cache of the abbreviation tables parsed from a .debug_abbrev
+// section, keyed by their offset in the section. Compilation units
+// often share a table --- LTO links and dwz-processed files commonly
+// give every unit the same one --- so CompilationUnits reading the same
+// file can share a cache to parse each table only once. The cache may
+// be shared by CompilationUnits on different threads.
+class AbbrevCache {
+ public:
+  // This struct represents a single DWARF2/3 abbreviation
+  // The abbreviation tells how to read a DWARF2/3 DIE, and consist of a
+  // tag and a list of attributes, as well as the data form of each
+  // attribute.
+  struct Abbrev {
+    uint64 number;
+    enum DwarfTag tag;
+    bool has_children;
+    AttributeList attributes;
+
+    // True if one of the attributes is DW_AT_sibling.
+    bool has_sibling;
+
+    // True if every attribute's form has a fixed size, so that a DIE
+    // can be skipped without decoding its attributes. If so, they take
+    // up fixed_size bytes, plus the unit's address size for each of
+    // address_size_forms, plus its offset size for each of
+    // offset_size_forms. DW_FORM_ref_addr is address-sized in DWARF 2
+    // and offset-sized after that, so ref_addr_forms counts it apart.
+    bool has_fixed_size;
+    uint64 fixed_size;
+    uint64 address_size_forms;
+    uint64 offset_size_forms;
+    uint64 ref_addr_forms;
+  };
+
+  // A table of abbreviations, indexed by abbreviation number, which
+  // means that element 0 is not valid.
+  typedef std::vector<Abbrev> AbbrevTable;
+
+  AbbrevCache() : tables_() { }
+
+  // Return the table parsed from OFFSET in the .debug_abbrev section,
+  // or NULL if there is none yet.
+  std::shared_ptr<const AbbrevTable> Find(uint64 offset);
+
+  // Record TABLE as the table parsed from OFFSET, and return the table
+  // now cached there. If another thread recorded one first, return
+  // that one, and discard TABLE.
+  std::shared_ptr<const AbbrevTable> Insert(
+      uint64 offset, const std::shared_ptr<const AbbrevTable>& table);
+
+  // Return the number of tables in the cache.
+  size_t size();
+
+ private:
+  std::mutex mutex_;
+  std::map<uint64, std::shared_ptr<const AbbrevTable> > tables_;
+};
+
 // The base of DWARF2/3 debug info is a DIE (Debugging Information
 // Entry.
 // DWARF groups DIE's into a tree and calls the root of this tree a
@@ -330,9 +524,13 @@ class CompilationUnit {
   // ByteReader, and a Dwarf2Handler class to call callbacks in.
   CompilationUnit(const string& path, const SectionMap& sections, uint64 offset,
                   ByteReader* reader, Dwarf2Handler* handler);
-  virtual ~CompilationUnit() {
-    if (abbrevs_) delete abbrevs_;
-  }
+  virtual ~CompilationUnit() { }
+
+  // Look up this unit's abbreviation table in CACHE, parsing it and
+  // adding it to CACHE only if it isn't there already. CACHE must hold
+  // tables from this unit's .debug_abbrev section, and must outlive this
+  // CompilationUnit. Without a cache, the unit parses its own table.
+  void SetAbbrevCache(AbbrevCache* cache) { abbrev_cache_ = cache; }
 
   // Initialize a compilation unit from a .dwo or .dwp file.
   // In this case, we need the .debug_addr section from the
@@ -354,15 +552,7 @@ class CompilationUnit {
 
  private:
 
-  // This struct represents a single DWARF2/3 abbreviation
-  // The abbreviation tells how to read a DWARF2/3 DIE, and consist of a
-  // tag and a list of attributes, as well as the data form of each attribute.
-  struct Abbrev {
-    uint64 number;
-    enum DwarfTag tag;
-    bool has_children;
-    AttributeList attributes;
-  };
+  typedef AbbrevCache::Abbrev Abbrev;
 
   // A DWARF2/3 compilation unit header.  This is not the same size as
   // in the actual file, as the one in the file may have a 32 bit or
@@ -372,9 +562,12 @@ class CompilationUnit {
     uint16 version;
     uint64 abbrev_offset;
     uint8 address_size;
+    // The DW_UT unit type. DWARF 5 headers give this explicitly; we
+    // treat units from earlier versions as DW_UT_compile.
+    uint8 unit_type;
   } header_;
 
-  // Reads the DWARF2/3 header for this compilation unit.
+  // Reads the DWARF2/3/4/5 header for this compilation unit.
   void ReadHeader();
 
   // Reads the DWARF2/3 abbreviations for this compilation unit
@@ -387,11 +580,41 @@ class CompilationUnit {
                             const Abbrev& abbrev);
 
   // Processes a single attribute and return a new pointer just past the
-  // end of it
+  // end of it. IMPLICIT_CONST is the attribute's value if FORM is
+  // DW_FORM_implicit_const.
   const uint8_t *ProcessAttribute(uint64 dieoffset,
                                   const uint8_t *start,
                                   enum DwarfAttribute attr,
-                                  enum DwarfForm form);
+                                  enum DwarfForm form,
+                                  int64 implicit_const);
+
+  // Reads the DW_AT_str_offsets_base, DW_AT_addr_base,
+  // DW_AT_rnglists_base and DW_AT_loclists_base attributes of a DWARF 5
+  // unit's root DIE, whose attributes are specified in ABBREV and start
+  // at START. DWARF 5 doesn't require them to come before the attributes
+  // whose values depend on them, so we read them first.
+  void ReadUnitBases(const uint8_t *start, const Abbrev& abbrev);
+
+  // Passes our handler the string at INDEX in the unit's string offsets
+  // table, as the value of the attribute ATTR, of form FORM, of the DIE
+  // at OFFSET.
+  void ProcessStringIndex(uint64 offset, enum DwarfAttribute attr,
+                          enum DwarfForm form, uint64 index);
+
+  // Passes our handler the address at INDEX in the unit's address
+  // table, as the value of the attribute ATTR, of form FORM, of the DIE
+  // at OFFSET.
+  void ProcessAddressIndex(uint64 offset, enum DwarfAttribute attr,
+                           enum DwarfForm form, uint64 index);
+
+  // Passes our handler the offset in BUFFER, the .debug_rnglists or
+  // .debug_loclists section, BUFFER_LENGTH bytes long, of the list at
+  // INDEX in the offsets table at BASE in that section, as the value of
+  // the attribute ATTR, of form FORM, of the DIE at OFFSET.
+  void ProcessListIndex(uint64 offset, enum DwarfAttribute attr,
+                        enum DwarfForm form, uint64 index,
+                        const uint8_t *buffer, uint64 buffer_length,
+                        uint64 base);
 
   // Called when we have an attribute with unsigned data to give to
   // our handler.  The attribute is for the DIE at OFFSET from the
@@ -412,10 +635,9 @@ class CompilationUnit {
     else if (attr == DW_AT_GNU_ranges_base) {
       ranges_base_ = data;
     }
-    // TODO(yunlian): When we add DW_AT_ranges_base from DWARF-5,
-    // that base will apply to DW_AT_ranges attributes in the
-    // skeleton CU as well as in the .dwo/.dwp files.
-    else if (attr == DW_AT_ranges && is_split_dwarf_) {
+    // DWARF 5's DW_AT_rnglists_base applies only to DW_FORM_rnglistx
+    // values, which ProcessListIndex has already resolved.
+    else if (attr == DW_AT_ranges && is_split_dwarf_ && header_.version < 5) {
       data += ranges_base_;
     }
     handler_->ProcessAttributeUnsigned(offset, attr, form, data);
@@ -451,13 +673,17 @@ class CompilationUnit {
   // FORM, and the actual data of the attribute is in DATA.
   // If we see a DW_AT_GNU_dwo_name attribute, save the value so
   // that we can find the debug info in a .dwo or .dwp file.
+  // The string is passed on to the handler as a pointer into the
+  // section, so DATA must be NUL-terminated and outlive the handler's
+  // use of it.
   void ProcessAttributeString(uint64 offset,
                               enum DwarfAttribute attr,
                               enum DwarfForm form,
                               const char* data) {
-    if (attr == DW_AT_GNU_dwo_name)
+    if (attr == DW_AT_GNU_dwo_name || attr == DW_AT_dwo_name)
       dwo_name_ = data;
-    handler_->ProcessAttributeString(offset, attr, form, data);
+    handler_->ProcessAttributeStringData(offset, attr, form, data,
+                                         strlen(data));
   }
 
   // Processes all DIEs for this compilation unit
@@ -467,6 +693,18 @@ class CompilationUnit {
   // START, and return the new place to position the stream to.
   const uint8_t *SkipDIE(const uint8_t *start, const Abbrev& abbrev);
 
+  // Skips the die with attributes specified in ABBREV starting at
+  // START, and all of its descendants, stopping at END, the end of the
+  // unit's DIEs. Return the new place to position the stream to.
+  const uint8_t *SkipSubtree(const uint8_t *start, const uint8_t *end,
+                             const Abbrev& abbrev);
+
+  // Return the place the DW_AT_sibling attribute of the die with
+  // attributes specified in ABBREV starting at START points to, or NULL
+  // if it doesn't point past START and no further than END.
+  const uint8_t *FindSibling(const uint8_t *start, const uint8_t *end,
+                             const Abbrev& abbrev);
+
   // Skips the attribute starting at START, with FORM, and return the
   // new place to position the stream to.
   const uint8_t *SkipAttribute(const uint8_t *start, enum DwarfForm form);
@@ -503,8 +741,11 @@ class CompilationUnit {
 
   // Set of DWARF2/3 abbreviations for this compilation unit.  Indexed
   // by abbreviation number, which means that abbrevs_[0] is not
-  // valid.
-  std::vector<Abbrev>* abbrevs_;
+  // valid. This may be shared with other units through abbrev_cache_.
+  std::shared_ptr<const AbbrevCache::AbbrevTable> abbrevs_;
+
+  // The cache to find abbrevs_ in, or NULL if this unit parses its own.
+  AbbrevCache* abbrev_cache_;
 
   // String section buffer and length, if we have a string section.
   // This is here to avoid doing a section lookup for strings in
@@ -522,6 +763,15 @@ class CompilationUnit {
   const uint8_t* addr_buffer_;
   uint64 addr_buffer_length_;
 
+  // The DWARF 5 .debug_line_str, .debug_rnglists and .debug_loclists
+  // section buffers and lengths, if we have those sections.
+  const uint8_t* line_string_buffer_;
+  uint64 line_string_buffer_length_;
+  const uint8_t* rnglists_buffer_;
+  uint64 rnglists_buffer_length_;
+  const uint8_t* loclists_buffer_;
+  uint64 loclists_buffer_length_;
+
   // Flag indicating whether this compilation unit is part of a .dwo
   // or .dwp file.  If true, we are reading this unit because a
   // skeleton compilation unit in an executable file had a
@@ -531,10 +781,12 @@ class CompilationUnit {
   // associated with the skeleton compilation unit.
   bool is_split_dwarf_;
 
-  // The value of the DW_AT_GNU_dwo_id attribute, if any.
+  // The value of the DW_AT_GNU_dwo_id attribute, or the DWARF 5 unit
+  // header's dwo_id field, if any.
   uint64 dwo_id_;
 
-  // The value of the DW_AT_GNU_dwo_name attribute, if any.
+  // The value of the DW_AT_GNU_dwo_name or DW_AT_dwo_name attribute, if
+  // any.
   const char* dwo_name_;
 
   // If this is a split DWARF CU, the value of the DW_AT_GNU_dwo_id attribute
@@ -544,9 +796,16 @@ class CompilationUnit {
   // The value of the DW_AT_GNU_ranges_base attribute, if any.
   uint64 ranges_base_;
 
-  // The value of the DW_AT_GNU_addr_base attribute, if any.
+  // The value of the DW_AT_GNU_addr_base or DW_AT_addr_base attribute,
+  // if any.
   uint64 addr_base_;
 
+  // The values of the DWARF 5 DW_AT_str_offsets_base,
+  // DW_AT_rnglists_base and DW_AT_loclists_base attributes, if any.
+  uint64 str_offsets_base_;
+  uint64 rnglists_base_;
+  uint64 loclists_base_;
+
   // True if we have already looked for a .dwp file.
   bool have_checked_for_dwp_;
 
@@ -51,6 +51,7 @@ using google_breakpad::test_assembler::Section;
 using google_breakpad::test_assembler::kBigEndian;
 using google_breakpad::test_assembler::kLittleEndian;
 
+using dwarf2reader::AbbrevCache;
 using dwarf2reader::ByteReader;
 using dwarf2reader::CompilationUnit;
 using dwarf2reader::Dwarf2Handler;
@@ -63,7 +64,9 @@ using dwarf2reader::ENDIANNESS_LITTLE;
 using dwarf2reader::SectionMap;
 
 using std::vector;
+using testing::AnyNumber;
 using testing::InSequence;
+using testing::Invoke;
 using testing::Pointee;
 using testing::Return;
 using testing::Sequence;
@@ -77,6 +80,7 @@ class MockDwarf2Handler: public Dwarf2Handler {
                                           uint8 offset_size, uint64 cu_length,
                                           uint8 dwarf_version));
   MOCK_METHOD2(StartDIE, bool(uint64 offset, enum DwarfTag tag));
+  MOCK_METHOD0(SkipsChildrenOfSkippedDIEs, bool());
   MOCK_METHOD4(ProcessAttributeUnsigned, void(uint64 offset,
                                               DwarfAttribute attr,
                                               enum DwarfForm form,
@@ -98,11 +102,24 @@ class MockDwarf2Handler: public Dwarf2Handler {
                                             enum DwarfAttribute attr,
                                             enum DwarfForm form,
                                             const string& data));
+  MOCK_METHOD5(ProcessAttributeStringData, void(uint64 offset,
+                                                DwarfAttribute attr,
+                                                enum DwarfForm form,
+                                                const char* data,
+                                                size_t length));
   MOCK_METHOD4(ProcessAttributeSignature, void(uint64 offset,
                                                DwarfAttribute attr,
                                                enum DwarfForm form,
                                                uint64 signature));
   MOCK_METHOD1(EndDIE, void(uint64 offset));
+
+  // Pass a string to ProcessAttributeString, as Dwarf2Handler's own
+  // ProcessAttributeStringData does.
+  void CopyStringData(uint64 offset, DwarfAttribute attr, enum DwarfForm form,
+                      const char* data, size_t length) {
+    Dwarf2Handler::ProcessAttributeStringData(offset, attr, form, data,
+                                              length);
+  }
 };
 
 struct DIEFixture {
@@ -121,12 +138,24 @@ struct DIEFixture {
     EXPECT_CALL(handler, ProcessAttributeBuffer(_, _, _, _, _)).Times(0);
     EXPECT_CALL(handler, ProcessAttributeString(_, _, _, _)).Times(0);
     EXPECT_CALL(handler, EndDIE(_)).Times(0);
+    EXPECT_CALL(handler, SkipsChildrenOfSkippedDIEs())
+        .WillRepeatedly(Return(false));
+
+    // Unless a test says otherwise, let string attributes reach
+    // ProcessAttributeString, as they would for most handlers.
+    ON_CALL(handler, ProcessAttributeStringData(_, _, _, _, _))
+        .WillByDefault(Invoke(&handler, &MockDwarf2Handler::CopyStringData));
+    EXPECT_CALL(handler, ProcessAttributeStringData(_, _, _, _, _))
+        .Times(AnyNumber());
   }
 
   // Return a reference to a section map whose .debug_info section refers
-  // to |info|, and whose .debug_abbrev section refers to |abbrevs|. This
-  // function returns a reference to the same SectionMap each time; new
-  // calls wipe out maps established by earlier calls.
+  // to |info|, and whose .debug_abbrev section refers to |abbrevs|. If
+  // |strings|, |line_strings|, |str_offsets| or |addrs| is not empty, the
+  // map's .debug_str, .debug_line_str, .debug_str_offsets or .debug_addr
+  // section refers to it.
+  // This function returns a reference to the same SectionMap each time;
+  // new calls wipe out maps established by earlier calls.
   const SectionMap &MakeSectionMap() {
     // Copy the sections' contents into strings that will live as long as
     // the map itself.
@@ -139,13 +168,30 @@ struct DIEFixture {
     section_map[".debug_abbrev"].first
       = reinterpret_cast<const uint8_t *>(abbrevs_contents.data());
     section_map[".debug_abbrev"].second = abbrevs_contents.size();
+    if (!strings.empty()) {
+      section_map[".debug_str"].first
+        = reinterpret_cast<const uint8_t *>(strings.data());
+      section_map[".debug_str"].second = strings.size();
+    }
+    AddSection(".debug_line_str", line_strings);
+    AddSection(".debug_str_offsets", str_offsets);
+    AddSection(".debug_addr", addrs);
     return section_map;
   }
 
+  void AddSection(const string &name, const string &contents) {
+    if (!contents.empty()) {
+      section_map[name].first
+        = reinterpret_cast<const uint8_t *>(contents.data());
+      section_map[name].second = contents.size();
+    }
+  }
+
   TestCompilationUnit info;
   TestAbbrevTable abbrevs;
   MockDwarf2Handler handler;
-  string abbrevs_contents, info_contents;
+  string abbrevs_contents, info_contents, strings;
+  string line_strings, str_offsets, addrs;
   SectionMap section_map;
 };
 
@@ -228,7 +274,11 @@ INSTANTIATE_TEST_CASE_P(
                       DwarfHeaderParams(kBigEndian,    8, 3, 4),
                       DwarfHeaderParams(kBigEndian,    8, 3, 8),
                       DwarfHeaderParams(kBigEndian,    8, 4, 4),
-                      DwarfHeaderParams(kBigEndian,    8, 4, 8)));
+                      DwarfHeaderParams(kBigEndian,    8, 4, 8),
+                      DwarfHeaderParams(kLittleEndian, 4, 5, 4),
+                      DwarfHeaderParams(kLittleEndian, 8, 5, 8),
+                      DwarfHeaderParams(kBigEndian,    4, 5, 8),
+                      DwarfHeaderParams(kBigEndian,    8, 5, 4)));
 
 struct DwarfFormsFixture: public DIEFixture {
   // Start a compilation unit, as directed by |params|, containing one
@@ -457,8 +507,435 @@ TEST_P(DwarfForms, ref_sig8_not_first) {
   ParseCompilationUnit(GetParam(), 98);
 }
 
+TEST_P(DwarfForms, strp) {
+  strings = string("\0unused\0tornado\0", 16);
+  StartSingleAttributeDIE(GetParam(), (DwarfTag) 0x6d0a6c8b,
+                          dwarf2reader::DW_AT_name,
+                          dwarf2reader::DW_FORM_strp);
+  info.SectionOffset(8);
+  info.Finish();
+
+  ExpectBeginCompilationUnit(GetParam(), (DwarfTag) 0x6d0a6c8b);
+  EXPECT_CALL(handler, ProcessAttributeString(_, dwarf2reader::DW_AT_name,
+                                              dwarf2reader::DW_FORM_strp,
+                                              "tornado"))
+      .InSequence(s)
+      .WillOnce(Return());
+  ExpectEndCompilationUnit();
+
+  ParseCompilationUnit(GetParam());
+}
+
+// A handler that overrides ProcessAttributeStringData should get a
+// pointer into the string section, not a copy.
+TEST_P(DwarfForms, strp_data) {
+  strings = string("\0unused\0tornado\0", 16);
+  StartSingleAttributeDIE(GetParam(), (DwarfTag) 0x6d0a6c8b,
+                          dwarf2reader::DW_AT_name,
+                          dwarf2reader::DW_FORM_strp);
+  info.SectionOffset(8);
+  info.Finish();
+
+  ExpectBeginCompilationUnit(GetParam(), (DwarfTag) 0x6d0a6c8b);
+  EXPECT_CALL(handler,
+              ProcessAttributeStringData(_, dwarf2reader::DW_AT_name,
+                                         dwarf2reader::DW_FORM_strp,
+                                         strings.data() + 8, 7))
+      .InSequence(s)
+      .WillOnce(Return());
+  ExpectEndCompilationUnit();
+
+  ParseCompilationUnit(GetParam());
+}
+
+// Units that share an abbreviation table through an AbbrevCache should
+// only parse it once.
+TEST_P(DwarfForms, SharedAbbrevTable) {
+  StartSingleAttributeDIE(GetParam(), (DwarfTag) 0x1f2ab5c7,
+                          (DwarfAttribute) 0x5a1d35a4,
+                          dwarf2reader::DW_FORM_data1);
+  info.D8(0x3c);
+  info.Finish();
+
+  for (int i = 0; i < 2; i++) {
+    ExpectBeginCompilationUnit(GetParam(), (DwarfTag) 0x1f2ab5c7);
+    EXPECT_CALL(handler,
+                ProcessAttributeUnsigned(_, (DwarfAttribute) 0x5a1d35a4,
+                                         dwarf2reader::DW_FORM_data1, 0x3c))
+        .InSequence(s)
+        .WillOnce(Return());
+    ExpectEndCompilationUnit();
+  }
+
+  ByteReader byte_reader(GetParam().endianness == kLittleEndian ?
+                         ENDIANNESS_LITTLE : ENDIANNESS_BIG);
+  const SectionMap& section_map = MakeSectionMap();
+  AbbrevCache abbrev_cache;
+  CompilationUnit parser1("", section_map, 0, &byte_reader, &handler);
+  parser1.SetAbbrevCache(&abbrev_cache);
+  EXPECT_EQ(parser1.Start(), info_contents.size());
+  EXPECT_EQ(1U, abbrev_cache.size());
+
+  // Clobber the table's tag. The second unit should still use the table
+  // the first one parsed.
+  abbrevs_contents[1] = 0x7f;
+  CompilationUnit parser2("", section_map, 0, &byte_reader, &handler);
+  parser2.SetAbbrevCache(&abbrev_cache);
+  EXPECT_EQ(parser2.Start(), info_contents.size());
+  EXPECT_EQ(1U, abbrev_cache.size());
+}
+
 // Tests for the other attribute forms could go here.
 
+// A skipped DIE whose forms all have fixed sizes should be stepped over
+// without decoding its attributes, landing on the DIE after it.
+TEST_P(DwarfForms, SkipFixedSizeDIE) {
+  Label abbrev_table = abbrevs.Here();
+  abbrevs.Abbrev(1, dwarf2reader::DW_TAG_compile_unit,
+                 dwarf2reader::DW_children_yes)
+      .EndAbbrev()
+      .Abbrev(2, (DwarfTag) 0x4b1e7c6d, dwarf2reader::DW_children_no)
+      .Attribute((DwarfAttribute) 0x2b49, dwarf2reader::DW_FORM_addr)
+      .Attribute((DwarfAttribute) 0x2b4a, dwarf2reader::DW_FORM_data2)
+      .Attribute((DwarfAttribute) 0x2b4b, dwarf2reader::DW_FORM_strp)
+      .Attribute((DwarfAttribute) 0x2b4c, dwarf2reader::DW_FORM_ref_addr)
+      .Attribute((DwarfAttribute) 0x2b4d, dwarf2reader::DW_FORM_flag_present)
+      .Attribute((DwarfAttribute) 0x2b4e, dwarf2reader::DW_FORM_ref_sig8)
+      .EndAbbrev()
+      .Abbrev(3, (DwarfTag) 0x5c6e2a1b, dwarf2reader::DW_children_no)
+      .Attribute((DwarfAttribute) 0x3d1f, dwarf2reader::DW_FORM_data1)
+      .EndAbbrev()
+      .EndTable();
+
+  const DwarfHeaderParams &params = GetParam();
+  const size_t ref_addr_size =
+      params.version == 2 ? params.address_size : params.format_size;
+  info.set_format_size(params.format_size);
+  info.set_endianness(params.endianness);
+  info.Header(params.version, abbrev_table, params.address_size)
+      .ULEB128(1)
+      .ULEB128(2)
+      .Append(params.address_size, 0xa5)   // DW_FORM_addr
+      .D16(0xa5a5)                         // DW_FORM_data2
+      .Append(params.format_size, 0xa5)    // DW_FORM_strp
+      .Append(ref_addr_size, 0xa5)         // DW_FORM_ref_addr
+      .D64(0xa5a5a5a5a5a5a5a5ULL)          // DW_FORM_ref_sig8
+      .ULEB128(3)
+      .D8(0x9d)
+      .D8(0);
+  info.Finish();
+
+  ExpectBeginCompilationUnit(GetParam(), dwarf2reader::DW_TAG_compile_unit);
+  EXPECT_CALL(handler, StartDIE(_, (DwarfTag) 0x4b1e7c6d))
+      .InSequence(s)
+      .WillOnce(Return(false));
+  EXPECT_CALL(handler, EndDIE(_))
+      .InSequence(s)
+      .WillOnce(Return());
+  EXPECT_CALL(handler, StartDIE(_, (DwarfTag) 0x5c6e2a1b))
+      .InSequence(s)
+      .WillOnce(Return(true));
+  EXPECT_CALL(handler, ProcessAttributeUnsigned(_, (DwarfAttribute) 0x3d1f,
+                                                dwarf2reader::DW_FORM_data1,
+                                                0x9d))
+      .InSequence(s)
+      .WillOnce(Return());
+  EXPECT_CALL(handler, EndDIE(_))
+      .InSequence(s)
+      .WillOnce(Return());
+  ExpectEndCompilationUnit();
+
+  ParseCompilationUnit(GetParam());
+}
+
+// Fixture for tests of skipping a DIE's children along with it.
+struct SkipSubtreeFixture: public DwarfFormsFixture {
+  // Expect a compilation unit whose root DIE has two children: a skipped
+  // DIE whose children the handler never sees, and a DIE with one
+  // attribute, DW_AT_byte_size, whose value is 0x9d.
+  void ExpectSkippedSubtree(const DwarfHeaderParams &params) {
+    EXPECT_CALL(handler, SkipsChildrenOfSkippedDIEs())
+        .WillRepeatedly(Return(true));
+    ExpectBeginCompilationUnit(params, dwarf2reader::DW_TAG_compile_unit);
+    EXPECT_CALL(handler, StartDIE(_, (DwarfTag) 0x4b1e7c6d))
+        .InSequence(s)
+        .WillOnce(Return(false));
+    EXPECT_CALL(handler, EndDIE(_))
+        .InSequence(s)
+        .WillOnce(Return());
+    EXPECT_CALL(handler, StartDIE(_, (DwarfTag) 0x5c6e2a1b))
+        .InSequence(s)
+        .WillOnce(Return(true));
+    EXPECT_CALL(handler,
+                ProcessAttributeUnsigned(_, dwarf2reader::DW_AT_byte_size,
+                                         dwarf2reader::DW_FORM_data1, 0x9d))
+        .InSequence(s)
+        .WillOnce(Return());
+    EXPECT_CALL(handler, EndDIE(_))
+        .InSequence(s)
+        .WillOnce(Return());
+    ExpectEndCompilationUnit();
+  }
+};
+
+struct SkipSubtree: public SkipSubtreeFixture,
+                    public TestWithParam<DwarfHeaderParams> { };
+
+// A skipped DIE's DW_AT_sibling attribute should take us straight past
+// its children, without reading them.
+TEST_P(SkipSubtree, Sibling) {
+  Label abbrev_table = abbrevs.Here();
+  abbrevs.Abbrev(1, dwarf2reader::DW_TAG_compile_unit,
+                 dwarf2reader::DW_children_yes)
+      .EndAbbrev()
+      .Abbrev(2, (DwarfTag) 0x4b1e7c6d, dwarf2reader::DW_children_yes)
+      .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+      .Attribute(dwarf2reader::DW_AT_sibling, dwarf2reader::DW_FORM_ref4)
+      .EndAbbrev()
+      .Abbrev(3, (DwarfTag) 0x5c6e2a1b, dwarf2reader::DW_children_no)
+      .Attribute(dwarf2reader::DW_AT_byte_size, dwarf2reader::DW_FORM_data1)
+      .EndAbbrev()
+      .EndTable();
+
+  Label sibling;
+  info.set_format_size(GetParam().format_size);
+  info.set_endianness(GetParam().endianness);
+  info.Header(GetParam().version, abbrev_table, GetParam().address_size)
+      .ULEB128(1)
+      .ULEB128(2)
+      .AppendCString("passed over")
+      .D32(sibling)
+      // A child with an abbreviation code the table doesn't have, which
+      // the reader can't get past if it tries to read it.
+      .ULEB128(0x7e)
+      .D8(0)
+      .Mark(&sibling)
+      .ULEB128(3)
+      .D8(0x9d)
+      .D8(0);
+  info.Finish();
+
+  ExpectSkippedSubtree(GetParam());
+  ParseCompilationUnit(GetParam());
+}
+
+// Without a DW_AT_sibling attribute, the reader should walk over the
+// skipped DIE's descendants without reporting them.
+TEST_P(SkipSubtree, NoSibling) {
+  Label abbrev_table = abbrevs.Here();
+  abbrevs.Abbrev(1, dwarf2reader::DW_TAG_compile_unit,
+                 dwarf2reader::DW_children_yes)
+      .EndAbbrev()
+      .Abbrev(2, (DwarfTag) 0x4b1e7c6d, dwarf2reader::DW_children_yes)
+      .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+      .EndAbbrev()
+      .Abbrev(3, (DwarfTag) 0x5c6e2a1b, dwarf2reader::DW_children_no)
+      .Attribute(dwarf2reader::DW_AT_byte_size, dwarf2reader::DW_FORM_data1)
+      .EndAbbrev()
+      .Abbrev(4, (DwarfTag) 0x1d3c9a4e, dwarf2reader::DW_children_yes)
+      .Attribute(dwarf2reader::DW_AT_const_value, dwarf2reader::DW_FORM_sdata)
+      .EndAbbrev()
+      .EndTable();
+
+  info.set_format_size(GetParam().format_size);
+  info.set_endianness(GetParam().endianness);
+  info.Header(GetParam().version, abbrev_table, GetParam().address_size)
+      .ULEB128(1)
+      .ULEB128(2)
+      .AppendCString("passed over")
+      .ULEB128(4)                       // a child with children
+      .LEB128(-0x3c41)
+      .ULEB128(3)                       // a grandchild
+      .D8(0x11)
+      .ULEB128(4)                       // a grandchild, with no children
+      .LEB128(0x7a)
+      .D8(0)
+      .D8(0)
+      .ULEB128(3)                       // another child
+      .D8(0x22)
+      .D8(0)
+      .ULEB128(3)
+      .D8(0x9d)
+      .D8(0);
+  info.Finish();
+
+  ExpectSkippedSubtree(GetParam());
+  ParseCompilationUnit(GetParam());
+}
+
+// Forms added in DWARF 5, and the unit attributes giving the bases their
+// indexes are relative to.
+struct Dwarf5Forms: public DwarfFormsFixture,
+                    public TestWithParam<DwarfHeaderParams> {
+  // Append |value| to |section| as an entry of |size| bytes.
+  static void Entry(Section *section, size_t size, uint64_t value) {
+    if (size == 4)
+      section->D32(value);
+    else
+      section->D64(value);
+  }
+};
+
+TEST_P(Dwarf5Forms, line_strp) {
+  line_strings = string("\0unused\0avalanche\0", 18);
+  StartSingleAttributeDIE(GetParam(), dwarf2reader::DW_TAG_compile_unit,
+                          dwarf2reader::DW_AT_comp_dir,
+                          dwarf2reader::DW_FORM_line_strp);
+  info.SectionOffset(8);
+  info.Finish();
+
+  ExpectBeginCompilationUnit(GetParam(), dwarf2reader::DW_TAG_compile_unit);
+  EXPECT_CALL(handler, ProcessAttributeString(_, dwarf2reader::DW_AT_comp_dir,
+                                              dwarf2reader::DW_FORM_line_strp,
+                                              "avalanche"))
+      .InSequence(s)
+      .WillOnce(Return());
+  ExpectEndCompilationUnit();
+
+  ParseCompilationUnit(GetParam());
+}
+
+TEST_P(Dwarf5Forms, implicit_const) {
+  Label abbrev_table = abbrevs.Here();
+  abbrevs.Abbrev(1, (DwarfTag) 0x2c4e7d3a, dwarf2reader::DW_children_no)
+      .ImplicitConst((DwarfAttribute) 0x5e0a3f61, -0x1f3b)
+      .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_string)
+      .EndAbbrev()
+      .EndTable();
+
+  info.set_format_size(GetParam().format_size);
+  info.set_endianness(GetParam().endianness);
+  info.Header(GetParam().version, abbrev_table, GetParam().address_size)
+      .ULEB128(1)
+      .AppendCString("blizzard");     // DW_AT_name; the constant has no data
+  info.Finish();
+
+  ExpectBeginCompilationUnit(GetParam(), (DwarfTag) 0x2c4e7d3a);
+  EXPECT_CALL(handler,
+              ProcessAttributeSigned(_, (DwarfAttribute) 0x5e0a3f61,
+                                     dwarf2reader::DW_FORM_implicit_const,
+                                     -0x1f3b))
+      .InSequence(s)
+      .WillOnce(Return());
+  EXPECT_CALL(handler, ProcessAttributeString(_, dwarf2reader::DW_AT_name,
+                                              dwarf2reader::DW_FORM_string,
+                                              "blizzard"))
+      .InSequence(s)
+      .WillOnce(Return());
+  ExpectEndCompilationUnit();
+
+  ParseCompilationUnit(GetParam());
+}
+
+// The root DIE's DW_AT_str_offsets_base applies to strx attributes that
+// precede it.
+TEST_P(Dwarf5Forms, strx1) {
+  strings = string("\0unused\0tornado\0", 16);
+  Section offsets(GetParam().endianness);
+  offsets.start() = 0;
+  // Unit header, padding, and two string offsets.
+  Entry(&offsets, GetParam().format_size, 0xdeadbeef);
+  Entry(&offsets, GetParam().format_size, 0xdeadbeef);
+  Label base = offsets.Here();
+  Entry(&offsets, GetParam().format_size, 1);
+  Entry(&offsets, GetParam().format_size, 8);
+  ASSERT_TRUE(offsets.GetContents(&str_offsets));
+
+  Label abbrev_table = abbrevs.Here();
+  abbrevs.Abbrev(1, dwarf2reader::DW_TAG_compile_unit,
+                 dwarf2reader::DW_children_no)
+      .Attribute(dwarf2reader::DW_AT_name, dwarf2reader::DW_FORM_strx1)
+      .Attribute(dwarf2reader::DW_AT_str_offsets_base,
+                 dwarf2reader::DW_FORM_sec_offset)
+      .EndAbbrev()
+      .EndTable();
+
+  info.set_format_size(GetParam().format_size);
+  info.set_endianness(GetParam().endianness);
+  info.Header(GetParam().version, abbrev_table, GetParam().address_size)
+      .ULEB128(1)
+      .D8(1);                         // DW_AT_name, second string offset
+  info.SectionOffset(base);           // DW_AT_str_offsets_base
+  info.Finish();
+
+  ExpectBeginCompilationUnit(GetParam(), dwarf2reader::DW_TAG_compile_unit);
+  EXPECT_CALL(handler, ProcessAttributeString(_, dwarf2reader::DW_AT_name,
+                                              dwarf2reader::DW_FORM_strx1,
+                                              "tornado"))
+      .InSequence(s)
+      .WillOnce(Return());
+  EXPECT_CALL(handler,
+              ProcessAttributeUnsigned(_, dwarf2reader::DW_AT_str_offsets_base,
+                                       dwarf2reader::DW_FORM_sec_offset,
+                                       2 * GetParam().format_size))
+      .InSequence(s)
+      .WillOnce(Return());
+  ExpectEndCompilationUnit();
+
+  ParseCompilationUnit(GetParam());
+}
+
+TEST_P(Dwarf5Forms, addrx) {
+  Section addresses(GetParam().endianness);
+  addresses.start() = 0;
+  const uint64_t value = GetParam().address_size == 4 ?
+                         0x8f1d6e42 : 0x9a02c3b75e81f164ULL;
+  // Unit header, then two addresses.
+  addresses.D64(0xdeadbeefdeadbeefULL);
+  Label base = addresses.Here();
+  Entry(&addresses, GetParam().address_size, 0x1000);
+  Entry(&addresses, GetParam().address_size, value);
+  ASSERT_TRUE(addresses.GetContents(&addrs));
+
+  Label abbrev_table = abbrevs.Here();
+  abbrevs.Abbrev(1, dwarf2reader::DW_TAG_compile_unit,
+                 dwarf2reader::DW_children_no)
+      .Attribute(dwarf2reader::DW_AT_addr_base,
+                 dwarf2reader::DW_FORM_sec_offset)
+      .Attribute(dwarf2reader::DW_AT_low_pc, dwarf2reader::DW_FORM_addrx)
+      .EndAbbrev()
+      .EndTable();
+
+  info.set_format_size(GetParam().format_size);
+  info.set_endianness(GetParam().endianness);
+  info.Header(GetParam().version, abbrev_table, GetParam().address_size)
+      .ULEB128(1);
+  info.SectionOffset(base);           // DW_AT_addr_base
+  info.ULEB128(1);                    // DW_AT_low_pc, second address
+  info.Finish();
+
+  ExpectBeginCompilationUnit(GetParam(), dwarf2reader::DW_TAG_compile_unit);
+  EXPECT_CALL(handler,
+              ProcessAttributeUnsigned(_, dwarf2reader::DW_AT_addr_base,
+                                       dwarf2reader::DW_FORM_sec_offset, 8))
+      .InSequence(s)
+      .WillOnce(Return());
+  EXPECT_CALL(handler,
+              ProcessAttributeUnsigned(_, dwarf2reader::DW_AT_low_pc,
+                                       dwarf2reader::DW_FORM_addrx, value))
+      .InSequence(s)
+      .WillOnce(Return());
+  ExpectEndCompilationUnit();
+
+  ParseCompilationUnit(GetParam());
+}
+
+INSTANTIATE_TEST_CASE_P(
+    HeaderVariants, Dwarf5Forms,
+    ::testing::Values(DwarfHeaderParams(kLittleEndian, 4, 5, 4),
+                      DwarfHeaderParams(kLittleEndian, 4, 5, 8),
+                      DwarfHeaderParams(kLittleEndian, 8, 5, 8),
+                      DwarfHeaderParams(kBigEndian,    4, 5, 4),
+                      DwarfHeaderParams(kBigEndian,    8, 5, 8)));
+
+INSTANTIATE_TEST_CASE_P(
+    HeaderVariants, SkipSubtree,
+    ::testing::Values(DwarfHeaderParams(kLittleEndian, 4, 2, 4),
+                      DwarfHeaderParams(kLittleEndian, 4, 3, 8),
+                      DwarfHeaderParams(kLittleEndian, 8, 4, 8),
+                      DwarfHeaderParams(kBigEndian,    4, 4, 4),
+                      DwarfHeaderParams(kBigEndian,    8, 2, 8)));
+
 INSTANTIATE_TEST_CASE_P(
     HeaderVariants, DwarfForms,
     ::testing::Values(DwarfHeaderParams(kLittleEndian, 4, 2, 4),
@@ -484,4 +961,8 @@ INSTANTIATE_TEST_CASE_P(
                       DwarfHeaderParams(kBigEndian,    8, 3, 4),
                       DwarfHeaderParams(kBigEndian,    8, 3, 8),
                       DwarfHeaderParams(kBigEndian,    8, 4, 4),
-                      DwarfHeaderParams(kBigEndian,    8, 4, 8)));
+                      DwarfHeaderParams(kBigEndian,    8, 4, 8),
+                      DwarfHeaderParams(kLittleEndian, 4, 5, 4),
+                      DwarfHeaderParams(kLittleEndian, 8, 5, 8),
+                      DwarfHeaderParams(kBigEndian,    4, 5, 8),
+                      DwarfHeaderParams(kBigEndian,    8, 5, 4)));
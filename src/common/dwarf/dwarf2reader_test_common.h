@@ -69,7 +69,8 @@ class TestCompilationUnit: public google_breakpad::test_assembler::Section {
   }
 
   // Append a DWARF compilation unit header to the section, with the given
-  // DWARF version, abbrev table offset, and address size.
+  // DWARF version, abbrev table offset, and address size. DWARF 5 headers
+  // describe a full compilation unit (DW_UT_compile).
   TestCompilationUnit &Header(int version, const Label &abbrev_offset,
                               size_t address_size) {
     if (format_size_ == 4) {
@@ -80,8 +81,14 @@ class TestCompilationUnit: public google_breakpad::test_assembler::Section {
     }
     post_length_offset_ = Size();
     D16(version);
-    SectionOffset(abbrev_offset);
-    D8(address_size);
+    if (version >= 5) {
+      D8(dwarf2reader::DW_UT_compile);
+      D8(address_size);
+      SectionOffset(abbrev_offset);
+    } else {
+      SectionOffset(abbrev_offset);
+      D8(address_size);
+    }
     return *this;
   }
 
@@ -132,6 +139,15 @@ class TestAbbrevTable: public google_breakpad::test_assembler::Section {
     return *this;
   }
 
+  // Add a DW_FORM_implicit_const attribute to the current abbreviation
+  // code whose name is |name| and whose value is |value|.
+  TestAbbrevTable &ImplicitConst(DwarfAttribute name, int64_t value) {
+    ULEB128(static_cast<unsigned>(name));
+    ULEB128(static_cast<unsigned>(dwarf2reader::DW_FORM_implicit_const));
+    LEB128(value);
+    return *this;
+  }
+
   // Finish the current abbreviation code.
   TestAbbrevTable &EndAbbrev() {
     ULEB128(0);
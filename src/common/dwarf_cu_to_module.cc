@@ -56,6 +56,24 @@ using std::pair;
 using std::sort;
 using std::vector;
 
+// Return true if the values of attributes of FORM are addresses. A
+// DW_AT_high_pc attribute may be an address, or an offset from the
+// DIE's DW_AT_low_pc, depending on its form.
+static bool IsAddressForm(enum DwarfForm form) {
+  switch (form) {
+    case dwarf2reader::DW_FORM_addr:
+    case dwarf2reader::DW_FORM_addrx:
+    case dwarf2reader::DW_FORM_addrx1:
+    case dwarf2reader::DW_FORM_addrx2:
+    case dwarf2reader::DW_FORM_addrx3:
+    case dwarf2reader::DW_FORM_addrx4:
+    case dwarf2reader::DW_FORM_GNU_addr_index:
+      return true;
+    default:
+      return false;
+  }
+}
+
 // Data provided by a DWARF specification DIE.
 //
 // In DWARF, the DIE for a definition may contain a DW_AT_specification
@@ -117,12 +135,19 @@ struct DwarfCUToModule::FilePrivate {
   // we will probably need to use pointers to strings held in this set.
   unordered_set<string> common_strings;
 
+  // A buffer for looking strings up in common_strings, reused so that
+  // a lookup needn't allocate a string of its own.
+  string common_strings_key;
+
   // A map from offsets of DIEs within the .debug_info section to
   // Specifications describing those DIEs. Specification references can
   // cross compilation unit boundaries.
   SpecificationByOffset specifications;
 
   AbstractOriginByOffset origins;
+
+  // True if a compilation unit has referred to a DIE in an earlier one.
+  bool cited_earlier_units;
 };
 
 DwarfCUToModule::FileContext::FileContext(const string &filename,
@@ -132,6 +157,7 @@ DwarfCUToModule::FileContext::FileContext(const string &filename,
       module_(module),
       handle_inter_cu_refs_(handle_inter_cu_refs),
       file_private_(new FilePrivate()) {
+  file_private_->cited_earlier_units = false;
 }
 
 DwarfCUToModule::FileContext::~FileContext() {
@@ -163,21 +189,64 @@ bool DwarfCUToModule::FileContext::IsUnhandledInterCUReference(
   return offset < compilation_unit_start;
 }
 
+void DwarfCUToModule::FileContext::NoteReference(
+    uint64 offset, uint64 compilation_unit_start) {
+  if (offset < compilation_unit_start)
+    file_private_->cited_earlier_units = true;
+}
+
+bool DwarfCUToModule::FileContext::ReferencedEarlierUnits() const {
+  return file_private_->cited_earlier_units;
+}
+
+void DwarfCUToModule::FileContext::AddDefinitionsFrom(
+    const FileContext &other) {
+  // map::insert leaves existing entries alone.
+  file_private_->specifications.insert(
+      other.file_private_->specifications.begin(),
+      other.file_private_->specifications.end());
+  file_private_->origins.insert(other.file_private_->origins.begin(),
+                                other.file_private_->origins.end());
+}
+
 // Information global to the particular compilation unit we're
 // parsing. This is for data shared across the CU's entire DIE tree,
 // and parameters from the code invoking the CU parser.
 struct DwarfCUToModule::CUContext {
-  CUContext(FileContext *file_context_arg, WarningReporter *reporter_arg)
+  CUContext(FileContext *file_context_arg, WarningReporter *reporter_arg,
+            RangesHandler *ranges_handler_arg, bool handle_inlines_arg)
       : file_context(file_context_arg),
         reporter(reporter_arg),
-        language(Language::CPlusPlus) {}
+        ranges_handler(ranges_handler_arg),
+        handle_inlines(handle_inlines_arg),
+        language(Language::CPlusPlus),
+        version(0),
+        low_pc(0),
+        addr_base(0) {}
 
   ~CUContext() {
     for (vector<Module::Function *>::iterator it = functions.begin();
          it != functions.end(); ++it) {
       delete *it;
     }
+    for (ForwardOriginByOffset::iterator it = forward_origins.begin();
+         it != forward_origins.end(); ++it) {
+      delete it->second.placeholder;
+    }
+  };
+
+  // An inline origin cited by a DW_AT_abstract_origin attribute before
+  // the DIE it refers to has been seen. GCC puts the abstract instances
+  // of inlined functions after the code they were inlined into.
+  struct ForwardOrigin {
+    // Stands in for the origin in Module::Inline structures until
+    // DwarfCUToModule::Finish replaces it.
+    Module::InlineOrigin *placeholder;
+
+    // The offset of the first DIE citing the origin, for warnings.
+    uint64 referrer;
   };
+  typedef map<uint64, ForwardOrigin> ForwardOriginByOffset;
 
   // The DWARF-bearing file into which this CU was incorporated.
   FileContext *file_context;
@@ -185,15 +254,37 @@ struct DwarfCUToModule::CUContext {
   // For printing error messages.
   WarningReporter *reporter;
 
+  // For reading range lists, or NULL.
+  RangesHandler *ranges_handler;
+
+  // True if we record the code inlined into functions.
+  bool handle_inlines;
+
   // The source language of this compilation unit.
   const Language *language;
 
+  // The compilation unit's DWARF version.
+  uint8 version;
+
+  // The compilation unit's DW_AT_low_pc, which range lists are
+  // relative to.
+  uint64 low_pc;
+
+  // The compilation unit's DW_AT_addr_base, the offset of its entries in
+  // the .debug_addr section.
+  uint64 addr_base;
+
   // The functions defined in this compilation unit. We accumulate
   // them here during parsing. Then, in DwarfCUToModule::Finish, we
   // assign them lines and add them to file_context->module.
   //
   // Destroying this destroys all the functions this vector points to.
   vector<Module::Function *> functions;
+
+  // The origins cited before they were defined, by the offset of the
+  // DIE the citation refers to. Destroying this destroys the
+  // placeholders.
+  ForwardOriginByOffset forward_origins;
 };
 
 // Information about the context of a particular DIE. This is for
@@ -239,11 +330,15 @@ class DwarfCUToModule::GenericDIEHandler: public dwarf2reader::DIEHandler {
                                  enum DwarfForm form,
                                  uint64 data);
 
-  // Derived classes' ProcessAttributeReference can defer to this to
-  // handle DW_AT_specification, or simply not override it.
+  // Derived classes' ProcessAttributeString can defer to this to
+  // handle DW_AT_name and linkage names, or simply not override it.
   void ProcessAttributeString(enum DwarfAttribute attr,
                               enum DwarfForm form,
                               const string &data);
+  void ProcessAttributeStringData(enum DwarfAttribute attr,
+                                  enum DwarfForm form,
+                                  const char *data,
+                                  size_t length);
 
  protected:
   // Compute and return the fully-qualified name of the DIE. If this
@@ -268,6 +363,10 @@ class DwarfCUToModule::GenericDIEHandler: public dwarf2reader::DIEHandler {
   // assumption about how strings are implemented?
   string AddStringToPool(const string &str);
 
+  // As above, for the LENGTH bytes at DATA. This only copies the text
+  // if it isn't in the set already.
+  string AddStringToPool(const char *data, size_t length);
+
   // If this DIE has a DW_AT_declaration attribute, this is its value.
   // It is false on DIEs with no DW_AT_declaration attribute.
   bool declaration_;
@@ -309,6 +408,7 @@ void DwarfCUToModule::GenericDIEHandler::ProcessAttributeReference(
         cu_context_->reporter->UnhandledInterCUReference(offset_, data);
         break;
       }
+      file_context->NoteReference(data, cu_context_->reporter->cu_offset());
       // Find the Specification to which this attribute refers, and
       // set specification_ appropriately. We could do more processing
       // here, but it's better to leave the real work to our
@@ -339,26 +439,46 @@ string DwarfCUToModule::GenericDIEHandler::AddStringToPool(const string &str) {
   return *result.first;
 }
 
+string DwarfCUToModule::GenericDIEHandler::AddStringToPool(const char *data,
+                                                           size_t length) {
+  FilePrivate *file_private = cu_context_->file_context->file_private_.get();
+  file_private->common_strings_key.assign(data, length);
+  pair<unordered_set<string>::iterator, bool> result =
+    file_private->common_strings.insert(file_private->common_strings_key);
+  return *result.first;
+}
+
 void DwarfCUToModule::GenericDIEHandler::ProcessAttributeString(
     enum DwarfAttribute attr,
     enum DwarfForm form,
     const string &data) {
+  ProcessAttributeStringData(attr, form, data.data(), data.size());
+}
+
+// Most string attributes are ignored, so leave them in the section
+// rather than copying them, and copy the rest only as needed.
+void DwarfCUToModule::GenericDIEHandler::ProcessAttributeStringData(
+    enum DwarfAttribute attr,
+    enum DwarfForm form,
+    const char *data,
+    size_t length) {
   switch (attr) {
     case dwarf2reader::DW_AT_name:
-      name_attribute_ = AddStringToPool(data);
+      name_attribute_ = AddStringToPool(data, length);
       break;
     case dwarf2reader::DW_AT_MIPS_linkage_name:
     case dwarf2reader::DW_AT_linkage_name: {
+      const string mangled(data, length);
       string demangled;
       Language::DemangleResult result =
-          cu_context_->language->DemangleName(data, &demangled);
+          cu_context_->language->DemangleName(mangled, &demangled);
       switch (result) {
         case Language::kDemangleSuccess:
           demangled_name_ = AddStringToPool(demangled);
           break;
 
         case Language::kDemangleFailure:
-          cu_context_->reporter->DemangleError(data);
+          cu_context_->reporter->DemangleError(mangled);
           // fallthrough
         case Language::kDontDemangle:
           demangled_name_.clear();
@@ -431,6 +551,64 @@ string DwarfCUToModule::GenericDIEHandler::ComputeQualifiedName() {
   return return_value;
 }
 
+// A handler class for DW_TAG_inlined_subroutine DIEs, which describe
+// a copy of a function's code inlined into the function being handled
+// by some enclosing FuncHandler.
+class DwarfCUToModule::InlineHandler: public GenericDIEHandler {
+ public:
+  // Create a handler for an inline at NEST_LEVEL, that adds what it
+  // finds, and then what its children find, to the end of INLINES.
+  InlineHandler(CUContext *cu_context, DIEContext *parent_context,
+                uint64 offset, int nest_level,
+                vector<Module::Inline> *inlines)
+      : GenericDIEHandler(cu_context, parent_context, offset),
+        nest_level_(nest_level), inlines_(inlines),
+        low_pc_(0), high_pc_(0), high_pc_form_(dwarf2reader::DW_FORM_addr),
+        ranges_(0), has_ranges_(false), abstract_origin_(0),
+        has_abstract_origin_(false), call_file_(0), call_line_(0) { }
+  void ProcessAttributeUnsigned(enum DwarfAttribute attr,
+                                enum DwarfForm form,
+                                uint64 data);
+  void ProcessAttributeSigned(enum DwarfAttribute attr,
+                              enum DwarfForm form,
+                              int64 data);
+  void ProcessAttributeReference(enum DwarfAttribute attr,
+                                 enum DwarfForm form,
+                                 uint64 data);
+  bool EndAttributes();
+  DIEHandler *FindChildHandler(uint64 offset, enum DwarfTag tag);
+
+ private:
+  int nest_level_;
+  vector<Module::Inline> *inlines_;
+  uint64 low_pc_, high_pc_; // DW_AT_low_pc, DW_AT_high_pc
+  DwarfForm high_pc_form_; // DW_AT_high_pc can be length or address.
+  uint64 ranges_; // DW_AT_ranges
+  bool has_ranges_;
+  uint64 abstract_origin_; // DW_AT_abstract_origin
+  bool has_abstract_origin_;
+  uint64 call_file_; // DW_AT_call_file
+  int call_line_; // DW_AT_call_line
+};
+
+// A handler class for DW_TAG_lexical_block DIEs within functions, which
+// may hold inlines at NEST_LEVEL, as if they were children of the
+// block's parent.
+class DwarfCUToModule::LexicalBlockHandler: public GenericDIEHandler {
+ public:
+  LexicalBlockHandler(CUContext *cu_context, DIEContext *parent_context,
+                      uint64 offset, int nest_level,
+                      vector<Module::Inline> *inlines)
+      : GenericDIEHandler(cu_context, parent_context, offset),
+        nest_level_(nest_level), inlines_(inlines) { }
+  bool EndAttributes() { return true; }
+  DIEHandler *FindChildHandler(uint64 offset, enum DwarfTag tag);
+
+ private:
+  int nest_level_;
+  vector<Module::Inline> *inlines_;
+};
+
 // A handler class for DW_TAG_subprogram DIEs.
 class DwarfCUToModule::FuncHandler: public GenericDIEHandler {
  public:
@@ -450,6 +628,7 @@ class DwarfCUToModule::FuncHandler: public GenericDIEHandler {
                                  uint64 data);
 
   bool EndAttributes();
+  DIEHandler *FindChildHandler(uint64 offset, enum DwarfTag tag);
   void Finish();
 
  private:
@@ -460,6 +639,9 @@ class DwarfCUToModule::FuncHandler: public GenericDIEHandler {
   DwarfForm high_pc_form_; // DW_AT_high_pc can be length or address.
   const AbstractOrigin* abstract_origin_;
   bool inline_;
+
+  // The code inlined into this function, gathered by our children.
+  vector<Module::Inline> inlines_;
 };
 
 void DwarfCUToModule::FuncHandler::ProcessAttributeUnsigned(
@@ -505,6 +687,8 @@ void DwarfCUToModule::FuncHandler::ProcessAttributeReference(
     uint64 data) {
   switch (attr) {
     case dwarf2reader::DW_AT_abstract_origin: {
+      cu_context_->file_context->NoteReference(
+          data, cu_context_->reporter->cu_offset());
       const AbstractOriginByOffset& origins =
           cu_context_->file_context->file_private_->origins;
       AbstractOriginByOffset::const_iterator origin = origins.find(data);
@@ -530,9 +714,26 @@ bool DwarfCUToModule::FuncHandler::EndAttributes() {
   return true;
 }
 
+dwarf2reader::DIEHandler *DwarfCUToModule::FuncHandler::FindChildHandler(
+    uint64 offset,
+    enum DwarfTag tag) {
+  if (!cu_context_->handle_inlines)
+    return NULL;
+  switch (tag) {
+    case dwarf2reader::DW_TAG_inlined_subroutine:
+      return new InlineHandler(cu_context_, parent_context_, offset, 0,
+                               &inlines_);
+    case dwarf2reader::DW_TAG_lexical_block:
+      return new LexicalBlockHandler(cu_context_, parent_context_, offset, 0,
+                                     &inlines_);
+    default:
+      return NULL;
+  }
+}
+
 void DwarfCUToModule::FuncHandler::Finish() {
   // Make high_pc_ an address, if it isn't already.
-  if (high_pc_form_ != dwarf2reader::DW_FORM_addr) {
+  if (!IsAddressForm(high_pc_form_)) {
     high_pc_ += low_pc_;
   }
 
@@ -556,6 +757,7 @@ void DwarfCUToModule::FuncHandler::Finish() {
     scoped_ptr<Module::Function> func(new Module::Function(name, low_pc_));
     func->size = high_pc_ - low_pc_;
     func->parameter_size = 0;
+    func->inlines.swap(inlines_);
     if (func->address) {
        // If the function address is zero this is a sign that this function
        // description is just empty debug data and should just be discarded.
@@ -567,6 +769,142 @@ void DwarfCUToModule::FuncHandler::Finish() {
   }
 }
 
+void DwarfCUToModule::InlineHandler::ProcessAttributeUnsigned(
+    enum DwarfAttribute attr,
+    enum DwarfForm form,
+    uint64 data) {
+  switch (attr) {
+    case dwarf2reader::DW_AT_low_pc:      low_pc_  = data; break;
+    case dwarf2reader::DW_AT_high_pc:
+      high_pc_form_ = form;
+      high_pc_ = data;
+      break;
+    case dwarf2reader::DW_AT_ranges:
+      ranges_ = data;
+      has_ranges_ = true;
+      break;
+    case dwarf2reader::DW_AT_call_file:   call_file_ = data; break;
+    case dwarf2reader::DW_AT_call_line:   call_line_ = data; break;
+    default:
+      GenericDIEHandler::ProcessAttributeUnsigned(attr, form, data);
+      break;
+  }
+}
+
+void DwarfCUToModule::InlineHandler::ProcessAttributeSigned(
+    enum DwarfAttribute attr,
+    enum DwarfForm form,
+    int64 data) {
+  switch (attr) {
+    case dwarf2reader::DW_AT_call_file:   call_file_ = data; break;
+    case dwarf2reader::DW_AT_call_line:   call_line_ = data; break;
+    default:
+      break;
+  }
+}
+
+void DwarfCUToModule::InlineHandler::ProcessAttributeReference(
+    enum DwarfAttribute attr,
+    enum DwarfForm form,
+    uint64 data) {
+  switch (attr) {
+    case dwarf2reader::DW_AT_abstract_origin:
+      abstract_origin_ = data;
+      has_abstract_origin_ = true;
+      break;
+    default:
+      GenericDIEHandler::ProcessAttributeReference(attr, form, data);
+      break;
+  }
+}
+
+bool DwarfCUToModule::InlineHandler::EndAttributes() {
+  Module::Inline in;
+  if (has_ranges_) {
+    RangesHandler *ranges_handler = cu_context_->ranges_handler;
+    if (ranges_handler &&
+        !ranges_handler->ReadRanges(ranges_, cu_context_->low_pc,
+                                    &in.ranges)) {
+      cu_context_->reporter->MalformedRangeList(ranges_);
+      in.ranges.clear();
+    }
+  } else {
+    // Make high_pc_ an address, if it isn't already.
+    if (!IsAddressForm(high_pc_form_))
+      high_pc_ += low_pc_;
+    if (low_pc_ < high_pc_)
+      in.ranges.push_back(Module::Range(low_pc_, high_pc_ - low_pc_));
+  }
+
+  // An inline that covers no code can't contain any that does.
+  if (in.ranges.empty())
+    return false;
+
+  if (has_abstract_origin_) {
+    cu_context_->file_context->NoteReference(
+        abstract_origin_, cu_context_->reporter->cu_offset());
+    const AbstractOriginByOffset& origins =
+        cu_context_->file_context->file_private_->origins;
+    AbstractOriginByOffset::const_iterator origin =
+        origins.find(abstract_origin_);
+    if (origin != origins.end()) {
+      if (!origin->second.name.empty()) {
+        in.origin = cu_context_->file_context->module_->FindInlineOrigin(
+            origin->second.name);
+      }
+    } else {
+      // Leave a placeholder to be replaced once the whole compilation
+      // unit has been read.
+      CUContext::ForwardOrigin *forward =
+          &cu_context_->forward_origins[abstract_origin_];
+      if (!forward->placeholder) {
+        forward->placeholder = new Module::InlineOrigin(string());
+        forward->referrer = offset_;
+      }
+      in.origin = forward->placeholder;
+    }
+  }
+  if (!in.origin) {
+    in.origin =
+        cu_context_->file_context->module_->FindInlineOrigin("<name omitted>");
+  }
+  in.call_site_file_id = call_file_;
+  in.call_site_line = call_line_;
+  in.nest_level = nest_level_;
+  inlines_->push_back(in);
+  return true;
+}
+
+dwarf2reader::DIEHandler *DwarfCUToModule::InlineHandler::FindChildHandler(
+    uint64 offset,
+    enum DwarfTag tag) {
+  switch (tag) {
+    case dwarf2reader::DW_TAG_inlined_subroutine:
+      return new InlineHandler(cu_context_, parent_context_, offset,
+                               nest_level_ + 1, inlines_);
+    case dwarf2reader::DW_TAG_lexical_block:
+      return new LexicalBlockHandler(cu_context_, parent_context_, offset,
+                                     nest_level_ + 1, inlines_);
+    default:
+      return NULL;
+  }
+}
+
+dwarf2reader::DIEHandler *
+DwarfCUToModule::LexicalBlockHandler::FindChildHandler(uint64 offset,
+                                                       enum DwarfTag tag) {
+  switch (tag) {
+    case dwarf2reader::DW_TAG_inlined_subroutine:
+      return new InlineHandler(cu_context_, parent_context_, offset,
+                               nest_level_, inlines_);
+    case dwarf2reader::DW_TAG_lexical_block:
+      return new LexicalBlockHandler(cu_context_, parent_context_, offset,
+                                     nest_level_, inlines_);
+    default:
+      return NULL;
+  }
+}
+
 // A handler for DIEs that contain functions and contribute a
 // component to their names: namespaces, classes, etc.
 class DwarfCUToModule::NamedScopeHandler: public GenericDIEHandler {
@@ -605,7 +943,7 @@ dwarf2reader::DIEHandler *DwarfCUToModule::NamedScopeHandler::FindChildHandler(
 void DwarfCUToModule::WarningReporter::CUHeading() {
   if (printed_cu_header_)
     return;
-  fprintf(stderr, "%s: in compilation unit '%s' (offset 0x%llx):\n",
+  fprintf(output_, "%s: in compilation unit '%s' (offset 0x%llx):\n",
           filename_.c_str(), cu_name_.c_str(), cu_offset_);
   printed_cu_header_ = true;
 }
@@ -613,7 +951,7 @@ void DwarfCUToModule::WarningReporter::CUHeading() {
 void DwarfCUToModule::WarningReporter::UnknownSpecification(uint64 offset,
                                                             uint64 target) {
   CUHeading();
-  fprintf(stderr, "%s: the DIE at offset 0x%llx has a DW_AT_specification"
+  fprintf(output_, "%s: the DIE at offset 0x%llx has a DW_AT_specification"
           " attribute referring to the die at offset 0x%llx, which either"
           " was not marked as a declaration, or comes later in the file\n",
           filename_.c_str(), offset, target);
@@ -622,7 +960,7 @@ void DwarfCUToModule::WarningReporter::UnknownSpecification(uint64 offset,
 void DwarfCUToModule::WarningReporter::UnknownAbstractOrigin(uint64 offset,
                                                              uint64 target) {
   CUHeading();
-  fprintf(stderr, "%s: the DIE at offset 0x%llx has a DW_AT_abstract_origin"
+  fprintf(output_, "%s: the DIE at offset 0x%llx has a DW_AT_abstract_origin"
           " attribute referring to the die at offset 0x%llx, which either"
           " was not marked as an inline, or comes later in the file\n",
           filename_.c_str(), offset, target);
@@ -630,13 +968,13 @@ void DwarfCUToModule::WarningReporter::UnknownAbstractOrigin(uint64 offset,
 
 void DwarfCUToModule::WarningReporter::MissingSection(const string &name) {
   CUHeading();
-  fprintf(stderr, "%s: warning: couldn't find DWARF '%s' section\n",
+  fprintf(output_, "%s: warning: couldn't find DWARF '%s' section\n",
           filename_.c_str(), name.c_str());
 }
 
 void DwarfCUToModule::WarningReporter::BadLineInfoOffset(uint64 offset) {
   CUHeading();
-  fprintf(stderr, "%s: warning: line number data offset beyond end"
+  fprintf(output_, "%s: warning: line number data offset beyond end"
           " of '.debug_line' section\n",
           filename_.c_str());
 }
@@ -645,7 +983,7 @@ void DwarfCUToModule::WarningReporter::UncoveredHeading() {
   if (printed_unpaired_header_)
     return;
   CUHeading();
-  fprintf(stderr, "%s: warning: skipping unpaired lines/functions:\n",
+  fprintf(output_, "%s: warning: skipping unpaired lines/functions:\n",
           filename_.c_str());
   printed_unpaired_header_ = true;
 }
@@ -655,7 +993,7 @@ void DwarfCUToModule::WarningReporter::UncoveredFunction(
   if (!uncovered_warnings_enabled_)
     return;
   UncoveredHeading();
-  fprintf(stderr, "    function%s: %s\n",
+  fprintf(output_, "    function%s: %s\n",
           function.size == 0 ? " (zero-length)" : "",
           function.name.c_str());
 }
@@ -664,27 +1002,34 @@ void DwarfCUToModule::WarningReporter::UncoveredLine(const Module::Line &line) {
   if (!uncovered_warnings_enabled_)
     return;
   UncoveredHeading();
-  fprintf(stderr, "    line%s: %s:%d at 0x%" PRIx64 "\n",
+  fprintf(output_, "    line%s: %s:%d at 0x%" PRIx64 "\n",
           (line.size == 0 ? " (zero-length)" : ""),
           line.file->name.c_str(), line.number, line.address);
 }
 
 void DwarfCUToModule::WarningReporter::UnnamedFunction(uint64 offset) {
   CUHeading();
-  fprintf(stderr, "%s: warning: function at offset 0x%llx has no name\n",
+  fprintf(output_, "%s: warning: function at offset 0x%llx has no name\n",
           filename_.c_str(), offset);
 }
 
 void DwarfCUToModule::WarningReporter::DemangleError(const string &input) {
   CUHeading();
-  fprintf(stderr, "%s: warning: failed to demangle %s\n",
+  fprintf(output_, "%s: warning: failed to demangle %s\n",
           filename_.c_str(), input.c_str());
 }
 
+void DwarfCUToModule::WarningReporter::MalformedRangeList(uint64 offset) {
+  CUHeading();
+  fprintf(output_, "%s: warning: the range list at offset 0x%llx in"
+          " '.debug_ranges' is malformed\n",
+          filename_.c_str(), offset);
+}
+
 void DwarfCUToModule::WarningReporter::UnhandledInterCUReference(
     uint64 offset, uint64 target) {
   CUHeading();
-  fprintf(stderr, "%s: warning: the DIE at offset 0x%llx has a "
+  fprintf(output_, "%s: warning: the DIE at offset 0x%llx has a "
                   "DW_FORM_ref_addr attribute with an inter-CU reference to "
                   "0x%llx, but inter-CU reference handling is turned off.\n",
                   filename_.c_str(), offset, target);
@@ -692,11 +1037,15 @@ void DwarfCUToModule::WarningReporter::UnhandledInterCUReference(
 
 DwarfCUToModule::DwarfCUToModule(FileContext *file_context,
                                  LineToModuleHandler *line_reader,
-                                 WarningReporter *reporter)
+                                 WarningReporter *reporter,
+                                 RangesHandler *ranges_handler,
+                                 bool handle_inlines)
     : line_reader_(line_reader),
-      cu_context_(new CUContext(file_context, reporter)),
+      cu_context_(new CUContext(file_context, reporter, ranges_handler,
+                                handle_inlines)),
       child_context_(new DIEContext()),
-      has_source_line_info_(false) {
+      has_source_line_info_(false),
+      collected_functions_(NULL) {
 }
 
 DwarfCUToModule::~DwarfCUToModule() {
@@ -722,6 +1071,13 @@ void DwarfCUToModule::ProcessAttributeUnsigned(enum DwarfAttribute attr,
       has_source_line_info_ = true;
       source_line_offset_ = data;
       break;
+    case dwarf2reader::DW_AT_low_pc: // base address for range lists
+      cu_context_->low_pc = data;
+      break;
+    case dwarf2reader::DW_AT_addr_base:
+    case dwarf2reader::DW_AT_GNU_addr_base:
+      cu_context_->addr_base = data;
+      break;
     case dwarf2reader::DW_AT_language: // source language of this CU
       SetLanguage(static_cast<DwarfLanguage>(data));
       break;
@@ -746,6 +1102,10 @@ void DwarfCUToModule::ProcessAttributeString(enum DwarfAttribute attr,
 }
 
 bool DwarfCUToModule::EndAttributes() {
+  if (cu_context_->ranges_handler) {
+    cu_context_->ranges_handler->StartCompilationUnit(cu_context_->version,
+                                                      cu_context_->addr_base);
+  }
   return true;
 }
 
@@ -830,7 +1190,8 @@ void DwarfCUToModule::ReadSourceLines(uint64 offset) {
     return;
   }
   line_reader_->ReadProgram(section_start + offset, section_length - offset,
-                            cu_context_->file_context->module_, &lines_);
+                            cu_context_->file_context->module_, &lines_,
+                            &files_);
 }
 
 namespace {
@@ -1035,6 +1396,51 @@ void DwarfCUToModule::AssignLinesToFunctions() {
   }
 }
 
+void DwarfCUToModule::ResolveInlines() {
+  Module *module = cu_context_->file_context->module_;
+
+  // Find the origins that were cited before they were defined.
+  map<const Module::InlineOrigin *, Module::InlineOrigin *> resolved;
+  const AbstractOriginByOffset& origins =
+      cu_context_->file_context->file_private_->origins;
+  CUContext::ForwardOriginByOffset *forward_origins =
+      &cu_context_->forward_origins;
+  for (CUContext::ForwardOriginByOffset::const_iterator forward_it =
+           forward_origins->begin();
+       forward_it != forward_origins->end(); ++forward_it) {
+    AbstractOriginByOffset::const_iterator origin =
+        origins.find(forward_it->first);
+    const string *name = NULL;
+    if (origin == origins.end()) {
+      cu_context_->reporter->UnknownAbstractOrigin(
+          forward_it->second.referrer, forward_it->first);
+    } else if (!origin->second.name.empty()) {
+      name = &origin->second.name;
+    }
+    resolved[forward_it->second.placeholder] =
+        module->FindInlineOrigin(name ? *name : string("<name omitted>"));
+  }
+
+  vector<Module::Function *> *functions = &cu_context_->functions;
+  for (vector<Module::Function *>::iterator func_it = functions->begin();
+       func_it != functions->end(); ++func_it) {
+    vector<Module::Inline> *inlines = &(*func_it)->inlines;
+    for (vector<Module::Inline>::iterator inline_it = inlines->begin();
+         inline_it != inlines->end(); ++inline_it) {
+      if (!resolved.empty()) {
+        map<const Module::InlineOrigin *, Module::InlineOrigin *>::iterator
+            origin = resolved.find(inline_it->origin);
+        if (origin != resolved.end())
+          inline_it->origin = origin->second;
+      }
+      std::map<uint32, Module::File *>::const_iterator file =
+          files_.find(inline_it->call_site_file_id);
+      if (file != files_.end())
+        inline_it->call_site_file = file->second;
+    }
+  }
+}
+
 void DwarfCUToModule::Finish() {
   // Assembly language files have no function data, and that gives us
   // no place to store our line numbers (even though the GNU toolchain
@@ -1053,10 +1459,18 @@ void DwarfCUToModule::Finish() {
   // Dole out lines to the appropriate functions.
   AssignLinesToFunctions();
 
+  if (cu_context_->handle_inlines)
+    ResolveInlines();
+
   // Add our functions, which now have source lines assigned to them,
-  // to module_.
-  cu_context_->file_context->module_->AddFunctions(functions->begin(),
-                                                   functions->end());
+  // to module_, or hand them to whoever is collecting them.
+  if (collected_functions_) {
+    collected_functions_->insert(collected_functions_->end(),
+                                 functions->begin(), functions->end());
+  } else {
+    cu_context_->file_context->module_->AddFunctions(functions->begin(),
+                                                     functions->end());
+  }
 
   // Ownership of the function objects has shifted from cu_context to
   // the Module.
@@ -1070,13 +1484,16 @@ bool DwarfCUToModule::StartCompilationUnit(uint64 offset,
                                            uint8 offset_size,
                                            uint64 cu_length,
                                            uint8 dwarf_version) {
+  cu_context_->version = dwarf_version;
   return dwarf_version >= 2;
 }
 
 bool DwarfCUToModule::StartRootDIE(uint64 offset, enum DwarfTag tag) {
   // We don't deal with partial compilation units (the only other tag
-  // likely to be used for root DIE).
-  return tag == dwarf2reader::DW_TAG_compile_unit;
+  // likely to be used for root DIE). A DWARF 5 skeleton unit stands in
+  // for a compilation unit whose DIEs are in a .dwo file.
+  return tag == dwarf2reader::DW_TAG_compile_unit ||
+         tag == dwarf2reader::DW_TAG_skeleton_unit;
 }
 
 } // namespace google_breakpad
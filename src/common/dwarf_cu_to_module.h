@@ -40,7 +40,9 @@
 #define COMMON_LINUX_DWARF_CU_TO_MODULE_H__
 
 #include <stdint.h>
+#include <stdio.h>
 
+#include <map>
 #include <string>
 
 #include "common/language.h"
@@ -94,6 +96,16 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
 
     const dwarf2reader::SectionMap& section_map() const;
 
+    // Return true if a compilation unit read with this context has
+    // referred to a DIE in a compilation unit before it. Such a unit
+    // can only be read correctly after the units before it.
+    bool ReferencedEarlierUnits() const;
+
+    // Add the specifications and abstract origins recorded in OTHER, a
+    // context for another part of the same file, to this context's.
+    // Where both contexts describe the same DIE, keep this context's.
+    void AddDefinitionsFrom(const FileContext &other);
+
    private:
     friend class DwarfCUToModule;
 
@@ -106,6 +118,10 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
     bool IsUnhandledInterCUReference(uint64 offset,
                                      uint64 compilation_unit_start) const;
 
+    // Note a reference to the DIE at OFFSET from the compilation unit
+    // that starts at COMPILATION_UNIT_START.
+    void NoteReference(uint64 offset, uint64 compilation_unit_start);
+
     // The name of this file, for use in error messages.
     const string filename_;
 
@@ -141,9 +157,36 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
     // Populate MODULE and LINES with source file names and code/line
     // mappings, given a pointer to some DWARF line number data
     // PROGRAM, and an overestimate of its size. Add no zero-length
-    // lines to LINES.
+    // lines to LINES. Fill FILES with the program's file table, mapping
+    // its file numbers to MODULE's files.
     virtual void ReadProgram(const uint8_t *program, uint64 length,
-                             Module *module, vector<Module::Line> *lines) = 0;
+                             Module *module, vector<Module::Line> *lines,
+                             std::map<uint32, Module::File *> *files) = 0;
+  };
+
+  // An abstract base class for handlers that read DWARF range lists
+  // for DwarfCUToModule, decoupled from dwarf2reader::RangeListReader
+  // for the same reason as LineToModuleHandler.
+  class RangesHandler {
+   public:
+    RangesHandler() { }
+    virtual ~RangesHandler() { }
+
+    // Called at the beginning of a new compilation unit, once its root
+    // DIE's attributes have been read, prior to calling ReadRanges() for
+    // it. DWARF_VERSION is the unit's DWARF version: DWARF 5 units' range
+    // lists are in the .debug_rnglists section, rather than
+    // .debug_ranges. ADDR_BASE is the offset of the unit's entries in
+    // the .debug_addr section, which DWARF 5 range lists may refer to.
+    virtual void StartCompilationUnit(uint8 dwarf_version,
+                                      uint64 addr_base) = 0;
+
+    // Append the ranges of the range list at OFFSET in the
+    // .debug_ranges or .debug_rnglists section to RANGES, taking its
+    // addresses to be relative to BASE_ADDRESS unless it says
+    // otherwise. Return false if the list is malformed.
+    virtual bool ReadRanges(uint64 offset, Module::Address base_address,
+                            vector<Module::Range> *ranges) = 0;
   };
 
   // The interface DwarfCUToModule uses to report warnings. The member
@@ -153,11 +196,12 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
   class WarningReporter {
    public:
     // Warn about problems in the DWARF file FILENAME, in the
-    // compilation unit at OFFSET.
-    WarningReporter(const string &filename, uint64 cu_offset)
+    // compilation unit at OFFSET. Print the warnings to OUTPUT.
+    WarningReporter(const string &filename, uint64 cu_offset,
+                    FILE *output = stderr)
         : filename_(filename), cu_offset_(cu_offset), printed_cu_header_(false),
           printed_unpaired_header_(false),
-          uncovered_warnings_enabled_(false) { }
+          uncovered_warnings_enabled_(false), output_(output) { }
     virtual ~WarningReporter() { }
 
     // Set the name of the compilation unit we're processing to NAME.
@@ -208,6 +252,9 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
     // FilePrivate did not retain the inter-CU specification data.
     virtual void UnhandledInterCUReference(uint64 offset, uint64 target);
 
+    // The range list at OFFSET in the .debug_ranges section is malformed.
+    virtual void MalformedRangeList(uint64 offset);
+
     uint64 cu_offset() const {
       return cu_offset_;
     }
@@ -219,6 +266,7 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
     bool printed_cu_header_;
     bool printed_unpaired_header_;
     bool uncovered_warnings_enabled_;
+    FILE *output_;
 
    private:
     // Print a per-CU heading, once.
@@ -232,10 +280,14 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
   // dwarf2reader::CompilationUnit DWARF parser to populate
   // FILE_CONTEXT->module. Use LINE_READER to handle the compilation
   // unit's line number data. Use REPORTER to report problems with the
-  // data we find.
+  // data we find. If HANDLE_INLINES is true, record the code inlined
+  // into each function, using RANGES_HANDLER, if it is not NULL, to read
+  // the address ranges of inlines that aren't contiguous.
   DwarfCUToModule(FileContext *file_context,
                   LineToModuleHandler *line_reader,
-                  WarningReporter *reporter);
+                  WarningReporter *reporter,
+                  RangesHandler *ranges_handler = NULL,
+                  bool handle_inlines = false);
   ~DwarfCUToModule();
 
   void ProcessAttributeSigned(enum DwarfAttribute attr,
@@ -254,6 +306,13 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
   // addresses, and then add them to module_.
   void Finish();
 
+  // Have Finish append our functions to FUNCTIONS, instead of adding
+  // them to module_. The caller takes ownership of the functions, and
+  // can add them to the module later, in an order of its choosing.
+  void CollectFunctions(vector<Module::Function *> *functions) {
+    collected_functions_ = functions;
+  }
+
   bool StartCompilationUnit(uint64 offset, uint8 address_size,
                             uint8 offset_size, uint64 cu_length,
                             uint8 dwarf_version);
@@ -267,6 +326,8 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
   struct Specification;
   class GenericDIEHandler;
   class FuncHandler;
+  class InlineHandler;
+  class LexicalBlockHandler;
   class NamedScopeHandler;
 
   // A map from section offsets to specifications.
@@ -287,6 +348,11 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
   // lines belong to which functions, beyond their addresses.)
   void AssignLinesToFunctions();
 
+  // Point the inlines of the functions in functions_ at the files their
+  // call sites' file numbers refer to in files_, and at the origins
+  // they cited before those were defined.
+  void ResolveInlines();
+
   // The only reason cu_context_ and child_context_ are pointers is
   // that we want to keep their definitions private to
   // dwarf_cu_to_module.cc, instead of listing them all here. They are
@@ -313,6 +379,13 @@ class DwarfCUToModule: public dwarf2reader::RootDIEHandler {
   // during parsing.  Then, in Finish, we call AssignLinesToFunctions
   // to dole them out to the appropriate functions.
   vector<Module::Line> lines_;
+
+  // The line number program's file table, mapping file numbers to the
+  // files they refer to.
+  std::map<uint32, Module::File *> files_;
+
+  // If not NULL, the vector to which Finish appends our functions.
+  vector<Module::Function *> *collected_functions_;
 };
 
 }  // namespace google_breakpad
@@ -33,6 +33,7 @@
 
 #include <stdint.h>
 
+#include <map>
 #include <string>
 #include <utility>
 #include <vector>
@@ -42,6 +43,7 @@
 #include "common/using_std_string.h"
 
 using std::make_pair;
+using std::map;
 using std::vector;
 
 using dwarf2reader::DIEHandler;
@@ -55,8 +57,10 @@ using google_breakpad::Module;
 
 using ::testing::_;
 using ::testing::AtMost;
+using ::testing::DoAll;
 using ::testing::Invoke;
 using ::testing::Return;
+using ::testing::SetArgPointee;
 using ::testing::Test;
 using ::testing::TestWithParam;
 using ::testing::Values;
@@ -67,8 +71,17 @@ using ::testing::ValuesIn;
 class MockLineToModuleHandler: public DwarfCUToModule::LineToModuleHandler {
  public:
   MOCK_METHOD1(StartCompilationUnit, void(const string& compilation_dir));
-  MOCK_METHOD4(ReadProgram, void(const uint8_t *program, uint64 length,
-                                 Module *module, vector<Module::Line> *lines));
+  MOCK_METHOD5(ReadProgram, void(const uint8_t *program, uint64 length,
+                                 Module *module, vector<Module::Line> *lines,
+                                 map<uint32, Module::File *> *files));
+};
+
+class MockRangesHandler: public DwarfCUToModule::RangesHandler {
+ public:
+  MOCK_METHOD2(StartCompilationUnit, void(uint8 dwarf_version,
+                                          uint64 addr_base));
+  MOCK_METHOD3(ReadRanges, bool(uint64 offset, Module::Address base_address,
+                                vector<Module::Range> *ranges));
 };
 
 class MockWarningReporter: public DwarfCUToModule::WarningReporter {
@@ -85,6 +98,7 @@ class MockWarningReporter: public DwarfCUToModule::WarningReporter {
   MOCK_METHOD1(UnnamedFunction, void(uint64 offset));
   MOCK_METHOD1(DemangleError, void(const string &input));
   MOCK_METHOD2(UnhandledInterCUReference, void(uint64 offset, uint64 target));
+  MOCK_METHOD1(MalformedRangeList, void(uint64 offset));
 };
 
 // A fixture class including all the objects needed to handle a
@@ -99,36 +113,43 @@ class CUFixtureBase {
   //
   // then doing:
   //
-  //   appender(line_program, length, module, line_vector);
+  //   appender(line_program, length, module, line_vector, file_map);
   //
-  // will append lines to the end of line_vector.  We can use this with
+  // will append lines to the end of line_vector, and set file_map to
+  // the files given to the functor.  We can use this with
   // MockLineToModuleHandler like this:
   //
   //   MockLineToModuleHandler l2m;
-  //   EXPECT_CALL(l2m, ReadProgram(_,_,_,_))
+  //   EXPECT_CALL(l2m, ReadProgram(_,_,_,_,_))
   //       .WillOnce(DoAll(Invoke(appender), Return()));
   //
   // in which case calling l2m with some line vector will append lines.
   class AppendLinesFunctor {
    public:
-    explicit AppendLinesFunctor(
-        const vector<Module::Line> *lines) : lines_(lines) { }
+    AppendLinesFunctor(const vector<Module::Line> *lines,
+                       const map<uint32, Module::File *> *files)
+        : lines_(lines), files_(files) { }
     void operator()(const uint8_t *program, uint64 length,
-                    Module *module, vector<Module::Line> *lines) {
+                    Module *module, vector<Module::Line> *lines,
+                    map<uint32, Module::File *> *files) {
       lines->insert(lines->end(), lines_->begin(), lines_->end());
+      *files = *files_;
     }
    private:
     const vector<Module::Line> *lines_;
+    const map<uint32, Module::File *> *files_;
   };
 
-  CUFixtureBase()
+  // If HANDLE_INLINES is true, have root_handler_ record inlines.
+  explicit CUFixtureBase(bool handle_inlines = false)
       : module_("module-name", "module-os", "module-arch", "module-id"),
         file_context_("dwarf-filename", &module_, true),
         language_(dwarf2reader::DW_LANG_none),
         language_signed_(false),
-        appender_(&lines_),
+        appender_(&lines_, &line_files_),
         reporter_("dwarf-filename", 0xcf8f9bb6443d29b5LL),
-        root_handler_(&file_context_, &line_reader_, &reporter_),
+        root_handler_(&file_context_, &line_reader_, &reporter_,
+                      &ranges_handler_, handle_inlines),
         functions_filled_(false) {
     // By default, expect no warnings to be reported, and expect the
     // compilation unit's name to be provided. The test can override
@@ -142,11 +163,15 @@ class CUFixtureBase {
     EXPECT_CALL(reporter_, UncoveredLine(_)).Times(0);
     EXPECT_CALL(reporter_, UnnamedFunction(_)).Times(0);
     EXPECT_CALL(reporter_, UnhandledInterCUReference(_, _)).Times(0);
+    EXPECT_CALL(reporter_, MalformedRangeList(_)).Times(0);
 
     // By default, expect the line program reader not to be invoked. We
     // may override this in StartCU.
     EXPECT_CALL(line_reader_, StartCompilationUnit(_)).Times(0);
-    EXPECT_CALL(line_reader_, ReadProgram(_,_,_,_)).Times(0);
+    EXPECT_CALL(line_reader_, ReadProgram(_,_,_,_,_)).Times(0);
+
+    // Expect no range lists to be read, unless the test says otherwise.
+    EXPECT_CALL(ranges_handler_, ReadRanges(_,_,_)).Times(0);
 
     // The handler will consult this section map to decide what to
     // pass to our line reader.
@@ -162,6 +187,12 @@ class CUFixtureBase {
   void PushLine(Module::Address address, Module::Address size,
                 const string &filename, int line_number);
 
+  // Have the line program the handler reads define FILENAME as its
+  // file number NUMBER. Call this before calling StartCU.
+  void DefineLineFile(uint32 number, const string &filename) {
+    line_files_[number] = module_.FindFile(filename);
+  }
+
   // Use LANGUAGE for the compilation unit. More precisely, arrange
   // for StartCU to pass the compilation unit's root DIE a
   // DW_AT_language attribute whose value is LANGUAGE.
@@ -198,10 +229,10 @@ class CUFixtureBase {
                                 uint64 specification, const char *name = NULL);
 
   // Define a function as a child of PARENT with the given name, address, and
-  // size. If high_pc_form is DW_FORM_addr then the DW_AT_high_pc attribute
-  // will be written as an address; otherwise it will be written as the
-  // function's size. Call EndAttributes and Finish; one cannot define
-  // children of the defined function's DIE.
+  // size. If high_pc_form is DW_FORM_addr or DW_FORM_addrx then the
+  // DW_AT_high_pc attribute will be written as an address; otherwise it
+  // will be written as the function's size. Call EndAttributes and Finish;
+  // one cannot define children of the defined function's DIE.
   void DefineFunction(DIEHandler *parent, const string &name,
                       Module::Address address, Module::Address size,
                       const char* mangled_name,
@@ -239,6 +270,24 @@ class CUFixtureBase {
                                uint64 origin, Module::Address address,
                                Module::Address size);
 
+  // Start a DW_TAG_subprogram DIE as a child of PARENT with the given
+  // name, address, and size. Leave the handler ready to hear about
+  // children: call EndAttributes, but not Finish.
+  DIEHandler *StartFunctionDIE(DIEHandler *parent, const string &name,
+                               Module::Address address, Module::Address size);
+
+  // Start a DW_TAG_inlined_subroutine DIE as a child of PARENT that
+  // refers to ORIGIN in its DW_AT_abstract_origin attribute, and whose
+  // call site is line CALL_LINE of file number CALL_FILE. If SIZE is
+  // non-zero, record ADDRESS and SIZE as low_pc/high_pc attributes;
+  // otherwise, give it a DW_AT_ranges attribute whose value is
+  // ADDRESS. Call EndAttributes, expecting it to return
+  // EXPECT_CHILDREN, but not Finish.
+  DIEHandler *StartInlineDIE(DIEHandler *parent, uint64 origin,
+                             uint64 call_file, int call_line,
+                             Module::Address address, Module::Address size,
+                             bool expect_children = true);
+
   // The following Test* functions should be called after calling
   // this.root_handler_.Finish. After that point, no further calls
   // should be made on the handler.
@@ -263,6 +312,18 @@ class CUFixtureBase {
   void TestLine(int i, int j, Module::Address address, Module::Address size,
                 const string &filename, int number);
 
+  // Test that the number of inlines in the I'th function in the module
+  // this.module_ is equal to EXPECTED.
+  void TestInlineCount(int i, size_t expected);
+
+  // Test that the J'th inline of the I'th function (ordered by address)
+  // inlines the function named NAME at NEST_LEVEL, from line CALL_LINE of
+  // CALL_FILE, or of no file if CALL_FILE is empty, and that its first
+  // range has the given address and size.
+  void TestInline(int i, int j, const string &name, int nest_level,
+                  const string &call_file, int call_line,
+                  Module::Address address, Module::Address size);
+
   // Actual objects under test.
   Module module_;
   DwarfCUToModule::FileContext file_context_;
@@ -284,6 +345,9 @@ class CUFixtureBase {
   // provided lines array.
   vector<Module::Line> lines_;
 
+  // The file table line_reader_ reports along with lines_.
+  map<uint32, Module::File *> line_files_;
+
   // Mock line program reader.
   MockLineToModuleHandler line_reader_;
   AppendLinesFunctor appender_;
@@ -291,6 +355,7 @@ class CUFixtureBase {
   static const size_t dummy_line_size_;
 
   MockWarningReporter reporter_;
+  MockRangesHandler ranges_handler_;
   DwarfCUToModule root_handler_;
 
  private:
@@ -331,10 +396,14 @@ void CUFixtureBase::StartCU() {
   if (!lines_.empty())
     EXPECT_CALL(line_reader_,
                 ReadProgram(&dummy_line_program_[0], dummy_line_size_,
-                            &module_, _))
+                            &module_, _, _))
         .Times(AtMost(1))
         .WillOnce(DoAll(Invoke(appender_), Return()));
 
+  // Once the root DIE's attributes are known, the range list reader
+  // hears the unit's version.
+  EXPECT_CALL(ranges_handler_, StartCompilationUnit(3, 0)).Times(1);
+
   ASSERT_TRUE(root_handler_
               .StartCompilationUnit(0x51182ec307610b51ULL, 0x81, 0x44,
                                     0x4241b4f33720dd5cULL, 3));
@@ -447,7 +516,8 @@ void CUFixtureBase::DefineFunction(dwarf2reader::DIEHandler *parent,
                                  address);
 
   Module::Address high_pc = size;
-  if (high_pc_form == dwarf2reader::DW_FORM_addr) {
+  if (high_pc_form == dwarf2reader::DW_FORM_addr ||
+      high_pc_form == dwarf2reader::DW_FORM_addrx) {
     high_pc += address;
   }
   func->ProcessAttributeUnsigned(dwarf2reader::DW_AT_high_pc,
@@ -574,6 +644,66 @@ void CUFixtureBase::DefineInlineInstanceDIE(DIEHandler *parent,
   delete func;
 }
 
+DIEHandler *CUFixtureBase::StartFunctionDIE(DIEHandler *parent,
+                                            const string &name,
+                                            Module::Address address,
+                                            Module::Address size) {
+  dwarf2reader::DIEHandler *func
+      = parent->FindChildHandler(0x2a3ac3a0c9a5d0e6LL,
+                                 dwarf2reader::DW_TAG_subprogram);
+  EXPECT_TRUE(func != NULL);
+  if (!func)
+    return NULL;
+  func->ProcessAttributeString(dwarf2reader::DW_AT_name,
+                               dwarf2reader::DW_FORM_strp,
+                               name);
+  func->ProcessAttributeUnsigned(dwarf2reader::DW_AT_low_pc,
+                                 dwarf2reader::DW_FORM_addr,
+                                 address);
+  func->ProcessAttributeUnsigned(dwarf2reader::DW_AT_high_pc,
+                                 dwarf2reader::DW_FORM_data4,
+                                 size);
+  EXPECT_TRUE(func->EndAttributes());
+  return func;
+}
+
+DIEHandler *CUFixtureBase::StartInlineDIE(DIEHandler *parent, uint64 origin,
+                                          uint64 call_file, int call_line,
+                                          Module::Address address,
+                                          Module::Address size,
+                                          bool expect_children) {
+  dwarf2reader::DIEHandler *die
+      = parent->FindChildHandler(0x6e2b9d7b5c8e0a13LL,
+                                 dwarf2reader::DW_TAG_inlined_subroutine);
+  EXPECT_TRUE(die != NULL);
+  if (!die)
+    return NULL;
+  die->ProcessAttributeReference(dwarf2reader::DW_AT_abstract_origin,
+                                 dwarf2reader::DW_FORM_ref4,
+                                 origin);
+  die->ProcessAttributeUnsigned(dwarf2reader::DW_AT_call_file,
+                                dwarf2reader::DW_FORM_data1,
+                                call_file);
+  die->ProcessAttributeUnsigned(dwarf2reader::DW_AT_call_line,
+                                dwarf2reader::DW_FORM_data2,
+                                call_line);
+  if (size) {
+    die->ProcessAttributeUnsigned(dwarf2reader::DW_AT_low_pc,
+                                  dwarf2reader::DW_FORM_addr,
+                                  address);
+    die->ProcessAttributeUnsigned(dwarf2reader::DW_AT_high_pc,
+                                  dwarf2reader::DW_FORM_data4,
+                                  size);
+  } else {
+    die->ProcessAttributeUnsigned(dwarf2reader::DW_AT_ranges,
+                                  dwarf2reader::DW_FORM_sec_offset,
+                                  address);
+  }
+  ProcessStrangeAttributes(die);
+  EXPECT_EQ(expect_children, die->EndAttributes());
+  return die;
+}
+
 void CUFixtureBase::FillFunctions() {
   if (functions_filled_)
     return;
@@ -622,6 +752,36 @@ void CUFixtureBase::TestLine(int i, int j,
   EXPECT_EQ(number,   line->number);
 }
 
+void CUFixtureBase::TestInlineCount(int i, size_t expected) {
+  FillFunctions();
+  ASSERT_LT((size_t) i, functions_.size());
+
+  ASSERT_EQ(expected, functions_[i]->inlines.size());
+}
+
+void CUFixtureBase::TestInline(int i, int j, const string &name,
+                               int nest_level, const string &call_file,
+                               int call_line, Module::Address address,
+                               Module::Address size) {
+  FillFunctions();
+  ASSERT_LT((size_t) i, functions_.size());
+  ASSERT_LT((size_t) j, functions_[i]->inlines.size());
+
+  Module::Inline *in = &functions_[i]->inlines[j];
+  EXPECT_EQ(name,       in->origin->name);
+  EXPECT_EQ(nest_level, in->nest_level);
+  if (call_file.empty()) {
+    EXPECT_TRUE(in->call_site_file == NULL);
+  } else {
+    ASSERT_TRUE(in->call_site_file != NULL);
+    EXPECT_EQ(call_file, in->call_site_file->name);
+  }
+  EXPECT_EQ(call_line,  in->call_site_line);
+  ASSERT_LE(1U, in->ranges.size());
+  EXPECT_EQ(address,    in->ranges[0].address);
+  EXPECT_EQ(size,       in->ranges[0].size);
+}
+
 // Include caller locations for our test subroutines.
 #define TRACE(call) do { SCOPED_TRACE("called from here"); call; } while (0)
 #define PushLine(a,b,c,d)         TRACE(PushLine((a),(b),(c),(d)))
@@ -638,6 +798,9 @@ void CUFixtureBase::TestLine(int i, int j,
 #define TestFunction(a,b,c,d)     TRACE(TestFunction((a),(b),(c),(d)))
 #define TestLineCount(a,b)        TRACE(TestLineCount((a),(b)))
 #define TestLine(a,b,c,d,e,f)     TRACE(TestLine((a),(b),(c),(d),(e),(f)))
+#define TestInlineCount(a,b)      TRACE(TestInlineCount((a),(b)))
+#define TestInline(a,b,c,d,e,f,g,h) \
+    TRACE(TestInline((a),(b),(c),(d),(e),(f),(g),(h)))
 
 class SimpleCU: public CUFixtureBase, public Test {
 };
@@ -681,6 +844,19 @@ TEST_F(SimpleCU, OneFuncHighPcIsLength) {
            246571772);
 }
 
+TEST_F(SimpleCU, OneFuncHighPcIsAddrx) {
+  PushLine(0x938cf8c07def4d34ULL, 0x55592d727f6cd01fLL, "line-file", 246571772);
+
+  StartCU();
+  DefineFunction6(&root_handler_, "function1",
+                  0x938cf8c07def4d34ULL, 0x55592d727f6cd01fLL, NULL,
+                  dwarf2reader::DW_FORM_addrx);
+  root_handler_.Finish();
+
+  TestFunctionCount(1);
+  TestFunction(0, "function1", 0x938cf8c07def4d34ULL, 0x55592d727f6cd01fLL);
+}
+
 TEST_F(SimpleCU, MangledName) {
   PushLine(0x938cf8c07def4d34ULL, 0x55592d727f6cd01fLL, "line-file", 246571772);
 
@@ -787,6 +963,24 @@ TEST_F(SimpleCU, UnknownAbstractOrigin) {
                0x1758a0f941b71efbULL, 0x1cf154f1f545e146ULL);
 }
 
+// Without inline handling, DW_TAG_inlined_subroutine DIEs are skipped.
+TEST_F(SimpleCU, InlinesIgnored) {
+  PushLine(0x4000, 0x100, "outer.cc", 1);
+  StartCU();
+  DIEHandler *func = StartFunctionDIE(&root_handler_, "outer",
+                                      0x4000, 0x100);
+  ASSERT_TRUE(func != NULL);
+  EXPECT_TRUE(func->FindChildHandler(0x9f51a2c4d3b60e87ULL,
+                                     dwarf2reader::DW_TAG_inlined_subroutine)
+              == NULL);
+  func->Finish();
+  delete func;
+  root_handler_.Finish();
+
+  TestFunctionCount(1);
+  TestInlineCount(0, 0);
+}
+
 TEST_F(SimpleCU, UnnamedFunction) {
   EXPECT_CALL(reporter_, UnnamedFunction(0xe34797c7e68590a8LL))
     .WillOnce(Return());
@@ -803,6 +997,198 @@ TEST_F(SimpleCU, UnnamedFunction) {
 }
 
 // An address range.
+class InlineCU: public CUFixtureBase, public Test {
+ public:
+  InlineCU() : CUFixtureBase(true) { }
+};
+
+TEST_F(InlineCU, Nested) {
+  PushLine(0x4000, 0x100, "outer.cc", 1);
+  DefineLineFile(1, "outer.cc");
+  DefineLineFile(2, "inline.h");
+
+  StartCU();
+  AbstractInstanceDIE(&root_handler_, 0x100, dwarf2reader::DW_INL_inlined,
+                      0, "inlined");
+  AbstractInstanceDIE(&root_handler_, 0x200, dwarf2reader::DW_INL_inlined,
+                      0, "inlined_twice");
+  DIEHandler *func = StartFunctionDIE(&root_handler_, "outer",
+                                      0x4000, 0x100);
+  ASSERT_TRUE(func != NULL);
+  DIEHandler *inlined = StartInlineDIE(func, 0x100, 1, 10, 0x4010, 0x30);
+  ASSERT_TRUE(inlined != NULL);
+  DIEHandler *inlined_twice = StartInlineDIE(inlined, 0x200, 2, 20,
+                                             0x4020, 0x10);
+  ASSERT_TRUE(inlined_twice != NULL);
+  inlined_twice->Finish();
+  delete inlined_twice;
+  inlined->Finish();
+  delete inlined;
+
+  // Inlines in lexical blocks belong to the enclosing function or inline.
+  DIEHandler *block = func->FindChildHandler(0x5a1e,
+                                             dwarf2reader::DW_TAG_lexical_block);
+  ASSERT_TRUE(block != NULL);
+  EXPECT_TRUE(block->EndAttributes());
+  DIEHandler *in_block = StartInlineDIE(block, 0x200, 7, 30, 0x4080, 0x8);
+  ASSERT_TRUE(in_block != NULL);
+  in_block->Finish();
+  delete in_block;
+  block->Finish();
+  delete block;
+
+  func->Finish();
+  delete func;
+  root_handler_.Finish();
+
+  TestFunctionCount(1);
+  TestFunction(0, "outer", 0x4000, 0x100);
+  TestInlineCount(0, 3);
+  TestInline(0, 0, "inlined", 0, "outer.cc", 10, 0x4010, 0x30);
+  TestInline(0, 1, "inlined_twice", 1, "inline.h", 20, 0x4020, 0x10);
+  // File number 7 isn't in the line program's file table.
+  TestInline(0, 2, "inlined_twice", 0, "", 30, 0x4080, 0x8);
+}
+
+TEST_F(InlineCU, Ranges) {
+  vector<Module::Range> ranges;
+  ranges.push_back(Module::Range(0x4010, 0x10));
+  ranges.push_back(Module::Range(0x4080, 0x20));
+  EXPECT_CALL(ranges_handler_, ReadRanges(0x60, 0x3000, _))
+      .WillOnce(DoAll(SetArgPointee<2>(ranges), Return(true)));
+  EXPECT_CALL(ranges_handler_, ReadRanges(0x90, 0x3000, _))
+      .WillOnce(Return(false));
+  EXPECT_CALL(reporter_, MalformedRangeList(0x90)).WillOnce(Return());
+  PushLine(0x4000, 0x100, "outer.cc", 1);
+
+  StartCU();
+  root_handler_.ProcessAttributeUnsigned(dwarf2reader::DW_AT_low_pc,
+                                         dwarf2reader::DW_FORM_addr,
+                                         0x3000);
+  AbstractInstanceDIE(&root_handler_, 0x100, dwarf2reader::DW_INL_inlined,
+                      0, "inlined");
+  DIEHandler *func = StartFunctionDIE(&root_handler_, "outer",
+                                      0x4000, 0x100);
+  ASSERT_TRUE(func != NULL);
+  DIEHandler *inlined = StartInlineDIE(func, 0x100, 1, 10, 0x60, 0);
+  ASSERT_TRUE(inlined != NULL);
+  inlined->Finish();
+  delete inlined;
+  // An inline whose ranges can't be read covers no code, so its children
+  // are skipped.
+  DIEHandler *bad = StartInlineDIE(func, 0x100, 1, 11, 0x90, 0, false);
+  ASSERT_TRUE(bad != NULL);
+  bad->Finish();
+  delete bad;
+  func->Finish();
+  delete func;
+  root_handler_.Finish();
+
+  TestFunctionCount(1);
+  TestInlineCount(0, 1);
+  TestInline(0, 0, "inlined", 0, "", 10, 0x4010, 0x10);
+  vector<Module::Function *> functions;
+  module_.GetFunctions(&functions, functions.end());
+  ASSERT_EQ(1U, functions.size());
+  EXPECT_EQ(2U, functions[0]->inlines[0].ranges.size());
+}
+
+TEST_F(InlineCU, Dwarf5Ranges) {
+  vector<Module::Range> ranges;
+  ranges.push_back(Module::Range(0x4010, 0x10));
+  ranges.push_back(Module::Range(0x4080, 0x20));
+  EXPECT_CALL(ranges_handler_, StartCompilationUnit(5, 0x28))
+      .WillOnce(Return());
+  EXPECT_CALL(ranges_handler_, ReadRanges(0x14, 0x3000, _))
+      .WillOnce(DoAll(SetArgPointee<2>(ranges), Return(true)));
+  PushLine(0x4000, 0x100, "outer.cc", 1);
+  EXPECT_CALL(line_reader_, ReadProgram(_,_,_,_,_))
+      .WillOnce(DoAll(Invoke(appender_), Return()));
+
+  // A DWARF 5 unit's range lists need its DW_AT_addr_base.
+  ASSERT_TRUE(root_handler_
+              .StartCompilationUnit(0x51182ec307610b51ULL, 0x81, 0x44,
+                                    0x4241b4f33720dd5cULL, 5));
+  ASSERT_TRUE(root_handler_.StartRootDIE(0x02e56bfbda9e7337ULL,
+                                         dwarf2reader::DW_TAG_compile_unit));
+  root_handler_.ProcessAttributeString(dwarf2reader::DW_AT_name,
+                                       dwarf2reader::DW_FORM_strx1,
+                                       "compilation-unit-name");
+  root_handler_.ProcessAttributeUnsigned(dwarf2reader::DW_AT_stmt_list,
+                                         dwarf2reader::DW_FORM_sec_offset,
+                                         0);
+  root_handler_.ProcessAttributeUnsigned(dwarf2reader::DW_AT_low_pc,
+                                         dwarf2reader::DW_FORM_addrx,
+                                         0x3000);
+  root_handler_.ProcessAttributeUnsigned(dwarf2reader::DW_AT_addr_base,
+                                         dwarf2reader::DW_FORM_sec_offset,
+                                         0x28);
+  ASSERT_TRUE(root_handler_.EndAttributes());
+  AbstractInstanceDIE(&root_handler_, 0x100, dwarf2reader::DW_INL_inlined,
+                      0, "inlined");
+  DIEHandler *func = StartFunctionDIE(&root_handler_, "outer",
+                                      0x4000, 0x100);
+  ASSERT_TRUE(func != NULL);
+  DIEHandler *inlined = StartInlineDIE(func, 0x100, 1, 10, 0x14, 0);
+  ASSERT_TRUE(inlined != NULL);
+  inlined->Finish();
+  delete inlined;
+  func->Finish();
+  delete func;
+  root_handler_.Finish();
+
+  TestFunctionCount(1);
+  TestInlineCount(0, 1);
+  vector<Module::Function *> functions;
+  module_.GetFunctions(&functions, functions.end());
+  ASSERT_EQ(1U, functions.size());
+  EXPECT_EQ(2U, functions[0]->inlines[0].ranges.size());
+}
+
+TEST_F(InlineCU, UnknownAbstractOrigin) {
+  EXPECT_CALL(reporter_, UnknownAbstractOrigin(_, 0x300ULL))
+      .WillOnce(Return());
+  PushLine(0x4000, 0x100, "outer.cc", 1);
+
+  StartCU();
+  DIEHandler *func = StartFunctionDIE(&root_handler_, "outer",
+                                      0x4000, 0x100);
+  ASSERT_TRUE(func != NULL);
+  DIEHandler *inlined = StartInlineDIE(func, 0x300, 1, 10, 0x4010, 0x30);
+  ASSERT_TRUE(inlined != NULL);
+  inlined->Finish();
+  delete inlined;
+  func->Finish();
+  delete func;
+  root_handler_.Finish();
+
+  TestInlineCount(0, 1);
+  TestInline(0, 0, "<name omitted>", 0, "", 10, 0x4010, 0x30);
+}
+
+// GCC puts the abstract instances of inlined functions after the code
+// they were inlined into.
+TEST_F(InlineCU, ForwardAbstractOrigin) {
+  PushLine(0x4000, 0x100, "outer.cc", 1);
+
+  StartCU();
+  DIEHandler *func = StartFunctionDIE(&root_handler_, "outer",
+                                      0x4000, 0x100);
+  ASSERT_TRUE(func != NULL);
+  DIEHandler *inlined = StartInlineDIE(func, 0x300, 1, 10, 0x4010, 0x30);
+  ASSERT_TRUE(inlined != NULL);
+  inlined->Finish();
+  delete inlined;
+  func->Finish();
+  delete func;
+  AbstractInstanceDIE(&root_handler_, 0x300, dwarf2reader::DW_INL_inlined,
+                      0, "inner");
+  root_handler_.Finish();
+
+  TestInlineCount(0, 1);
+  TestInline(0, 0, "inner", 0, "", 10, 0x4010, 0x30);
+}
+
 struct Range {
   Module::Address start, end;
 };
@@ -1508,7 +1894,7 @@ TEST_F(Specifications, InterCU) {
   DwarfCUToModule::FileContext fc("dwarf-filename", &m, true);
   EXPECT_CALL(reporter_, UncoveredFunction(_)).WillOnce(Return());
   MockLineToModuleHandler lr;
-  EXPECT_CALL(lr, ReadProgram(_,_,_,_)).Times(0);
+  EXPECT_CALL(lr, ReadProgram(_,_,_,_,_)).Times(0);
 
   // Kludge: satisfy reporter_'s expectation.
   reporter_.SetCUName("compilation-unit-name");
@@ -1562,12 +1948,84 @@ TEST_F(Specifications, InterCU) {
   EXPECT_STREQ("class_A::member_func_B", functions[0]->name.c_str());
 }
 
+TEST_F(Specifications, InterCUSeparateContexts) {
+  Module m("module-name", "module-os", "module-arch", "module-id");
+  DwarfCUToModule::FileContext fc1("dwarf-filename", &m, true);
+  DwarfCUToModule::FileContext fc2("dwarf-filename", &m, true);
+  EXPECT_CALL(reporter_, UncoveredFunction(_)).Times(2);
+  MockLineToModuleHandler lr;
+  EXPECT_CALL(lr, ReadProgram(_,_,_,_,_)).Times(0);
+
+  // Kludge: satisfy reporter_'s expectation.
+  reporter_.SetCUName("compilation-unit-name");
+
+  // First CU, read in its own context.  Declares func_A.
+  {
+    DwarfCUToModule root1_handler(&fc1, &lr, &reporter_);
+    ASSERT_TRUE(root1_handler.StartCompilationUnit(0, 1, 2, 3, 3));
+    ASSERT_TRUE(root1_handler.StartRootDIE(1,
+                                           dwarf2reader::DW_TAG_compile_unit));
+    ASSERT_TRUE(root1_handler.EndAttributes());
+    DeclarationDIE(&root1_handler, 0x7c64f4d9a2f1bb1cULL,
+                   dwarf2reader::DW_TAG_subprogram, "func_A", "");
+    root1_handler.Finish();
+  }
+  EXPECT_FALSE(fc1.ReferencedEarlierUnits());
+
+  // Second CU, read in a context of its own.  Defines func_A, without the
+  // first CU's declaration to name it.
+  vector<Module::Function *> functions;
+  {
+    DwarfCUToModule root2_handler(&fc2, &lr, &reporter_);
+    root2_handler.CollectFunctions(&functions);
+    ASSERT_TRUE(root2_handler.StartCompilationUnit(0, 1, 2, 3, 3));
+    ASSERT_TRUE(root2_handler.StartRootDIE(1,
+                                           dwarf2reader::DW_TAG_compile_unit));
+    ASSERT_TRUE(root2_handler.EndAttributes());
+    EXPECT_CALL(reporter_, UnknownSpecification(_, 0x7c64f4d9a2f1bb1cULL))
+        .Times(1);
+    EXPECT_CALL(reporter_, UnnamedFunction(_)).Times(1);
+    DefinitionDIE(&root2_handler, dwarf2reader::DW_TAG_subprogram,
+                  0x7c64f4d9a2f1bb1cULL, "",
+                  0x2618f00a1a711e53ULL, 0x4fd94b76d7c2caf5ULL);
+    root2_handler.Finish();
+  }
+  EXPECT_TRUE(fc2.ReferencedEarlierUnits());
+  ASSERT_EQ(1U, functions.size());
+  EXPECT_STREQ("<name omitted>", functions[0]->name.c_str());
+  delete functions[0];
+  functions.clear();
+
+  // Read the second CU again, with the first CU's definitions.
+  fc2.AddDefinitionsFrom(fc1);
+  {
+    DwarfCUToModule root2_handler(&fc2, &lr, &reporter_);
+    root2_handler.CollectFunctions(&functions);
+    ASSERT_TRUE(root2_handler.StartCompilationUnit(0, 1, 2, 3, 3));
+    ASSERT_TRUE(root2_handler.StartRootDIE(1,
+                                           dwarf2reader::DW_TAG_compile_unit));
+    ASSERT_TRUE(root2_handler.EndAttributes());
+    DefinitionDIE(&root2_handler, dwarf2reader::DW_TAG_subprogram,
+                  0x7c64f4d9a2f1bb1cULL, "",
+                  0x2618f00a1a711e53ULL, 0x4fd94b76d7c2caf5ULL);
+    root2_handler.Finish();
+  }
+  ASSERT_EQ(1U, functions.size());
+  EXPECT_STREQ("func_A", functions[0]->name.c_str());
+
+  // The collected functions were not added to the module.
+  vector<Module::Function *> module_functions;
+  m.GetFunctions(&module_functions, module_functions.end());
+  EXPECT_TRUE(module_functions.empty());
+  delete functions[0];
+}
+
 TEST_F(Specifications, UnhandledInterCU) {
   Module m("module-name", "module-os", "module-arch", "module-id");
   DwarfCUToModule::FileContext fc("dwarf-filename", &m, false);
   EXPECT_CALL(reporter_, UncoveredFunction(_)).WillOnce(Return());
   MockLineToModuleHandler lr;
-  EXPECT_CALL(lr, ReadProgram(_,_,_,_)).Times(0);
+  EXPECT_CALL(lr, ReadProgram(_,_,_,_,_)).Times(0);
 
   // Kludge: satisfy reporter_'s expectation.
   reporter_.SetCUName("compilation-unit-name");
@@ -139,10 +139,14 @@ class DwarfLineToModule: public dwarf2reader::LineInfoHandler {
   void AddLine(uint64 address, uint64 length,
                uint32 file_num, uint32 line_num, uint32 column_num);
 
+  typedef std::map<uint32, Module::File *> FileTable;
+
+  // The files the line program has defined so far, by file number.
+  const FileTable &files() const { return files_; }
+
  private:
 
   typedef std::map<uint32, string> DirectoryTable;
-  typedef std::map<uint32, Module::File *> FileTable;
 
   // The module we're contributing debugging info to. Owned by our
   // client.
@@ -32,6 +32,10 @@
 // dump_symbols.cc: implement google_breakpad::WriteSymbolFile:
 // Find all the debugging info in a file and dump it as a Breakpad symbol file.
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include "common/linux/dump_symbols.h"
 
 #include <assert.h>
@@ -46,13 +50,24 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <map>
 #include <set>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "common/basictypes.h"
 #include "common/dwarf/bytereader-inl.h"
 #include "common/dwarf/dwarf2diehandler.h"
 #include "common/dwarf_cfi_to_module.h"
@@ -102,6 +117,17 @@ using google_breakpad::wasteful_vector;
 #define EM_AARCH64      183
 #endif
 
+// Define section compression constants if host machine does not include them.
+#ifndef SHF_COMPRESSED
+#define SHF_COMPRESSED  (1 << 11)
+#endif
+#ifndef ELFCOMPRESS_ZLIB
+#define ELFCOMPRESS_ZLIB  1
+#endif
+#ifndef ELFCOMPRESS_ZSTD
+#define ELFCOMPRESS_ZSTD  2
+#endif
+
 //
 // FDWrapper
 //
@@ -207,87 +233,604 @@ bool LoadStabs(const typename ElfClass::Ehdr* elf_header,
 }
 #endif  // NO_STABS_SUPPORT
 
+// The compression header that starts an ELF section flagged
+// SHF_COMPRESSED, for each ELF class.
+template<typename ElfClass> struct ElfCompressionHeader;
+template<> struct ElfCompressionHeader<ElfClass32> {
+  typedef Elf32_Chdr Chdr;
+};
+template<> struct ElfCompressionHeader<ElfClass64> {
+  typedef Elf64_Chdr Chdr;
+};
+
+// A section whose contents are stored compressed.
+struct CompressedSection {
+  string name;               // The section's name, as if uncompressed.
+  uint32_t type;             // ELFCOMPRESS_ZLIB, ELFCOMPRESS_ZSTD, etc.
+  const uint8_t* data;       // The compressed data, and its size.
+  uint64 size;
+  uint64 uncompressed_size;  // The size of the section's contents.
+  uint8_t* contents;         // The decompressed contents, or NULL.
+};
+
+// If SECTION, named NAME, holds compressed contents, fill in *COMPRESSED
+// to describe them and return true; otherwise, return false. Sections
+// may either be flagged SHF_COMPRESSED, or follow the older GNU
+// convention of a ".zdebug" name and a "ZLIB" header.
+template<typename ElfClass>
+bool GetCompressedSection(const typename ElfClass::Ehdr* elf_header,
+                          const typename ElfClass::Shdr* section,
+                          const string& name,
+                          CompressedSection* compressed) {
+  typedef typename ElfCompressionHeader<ElfClass>::Chdr Chdr;
+
+  const uint8_t* contents =
+      GetOffset<ElfClass, uint8_t>(elf_header, section->sh_offset);
+  compressed->contents = NULL;
+  if (section->sh_flags & SHF_COMPRESSED) {
+    compressed->name = name;
+    if (section->sh_size < sizeof(Chdr)) {
+      // Leave a type DecompressSection rejects.
+      compressed->type = 0;
+      compressed->data = contents;
+      compressed->size = 0;
+      compressed->uncompressed_size = 0;
+      return true;
+    }
+    Chdr header;
+    memcpy(&header, contents, sizeof(header));
+    compressed->type = header.ch_type;
+    compressed->data = contents + sizeof(header);
+    compressed->size = section->sh_size - sizeof(header);
+    compressed->uncompressed_size = header.ch_size;
+    return true;
+  }
+
+  // A ".zdebug" section holds "ZLIB", the uncompressed size as a 64-bit
+  // big-endian number, and the zlib stream.
+  if (name.compare(0, 8, ".zdebug_") == 0 && section->sh_size >= 12 &&
+      memcmp(contents, "ZLIB", 4) == 0) {
+    compressed->name = "." + name.substr(2);
+    compressed->type = ELFCOMPRESS_ZLIB;
+    compressed->data = contents + 12;
+    compressed->size = section->sh_size - 12;
+    compressed->uncompressed_size = 0;
+    for (int i = 4; i < 12; i++)
+      compressed->uncompressed_size =
+          (compressed->uncompressed_size << 8) | contents[i];
+    return true;
+  }
+  return false;
+}
+
+// Return true if this dump_syms can decompress sections compressed in
+// the format TYPE.
+bool IsSupportedCompression(uint32_t type) {
+  switch (type) {
+#ifdef HAVE_LIBZ
+    case ELFCOMPRESS_ZLIB:
+      return true;
+#endif
+#ifdef HAVE_LIBZSTD
+    case ELFCOMPRESS_ZSTD:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+// Decompress SECTION's contents into an anonymous mapping of their own,
+// and set its contents member to point to them. Return true on success.
+bool DecompressSection(CompressedSection* section) {
+  const uint64 size = section->uncompressed_size;
+  if (!IsSupportedCompression(section->type) || size == 0 ||
+      size != static_cast<size_t>(size))
+    return false;
+  void* buffer = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffer == MAP_FAILED)
+    return false;
+
+  bool decompressed = false;
+  switch (section->type) {
+#ifdef HAVE_LIBZ
+    case ELFCOMPRESS_ZLIB: {
+      uLongf length = size;
+      decompressed =
+          uncompress(static_cast<Bytef*>(buffer), &length, section->data,
+                     section->size) == Z_OK && length == size;
+      break;
+    }
+#endif
+#ifdef HAVE_LIBZSTD
+    case ELFCOMPRESS_ZSTD: {
+      size_t length = ZSTD_decompress(buffer, size, section->data,
+                                      section->size);
+      decompressed = !ZSTD_isError(length) && length == size;
+      break;
+    }
+#endif
+    default:
+      break;
+  }
+  if (!decompressed) {
+    munmap(buffer, size);
+    return false;
+  }
+  section->contents = static_cast<uint8_t*>(buffer);
+  return true;
+}
+
+// Decompress the sections in SECTIONS, claiming each by taking the next
+// index from NEXT_SECTION, until all have been claimed.
+void DecompressSections(std::vector<CompressedSection>* sections,
+                        std::atomic<size_t>* next_section) {
+  for (size_t i = (*next_section)++; i < sections->size();
+       i = (*next_section)++) {
+    DecompressSection(&(*sections)[i]);
+  }
+}
+
+// A set of compressed sections, decompressed together on several threads.
+// Their decompressed contents last as long as the set does.
+class DecompressedSections {
+ public:
+  DecompressedSections() { }
+  ~DecompressedSections() {
+    for (size_t i = 0; i < sections_.size(); i++) {
+      if (sections_[i].contents)
+        munmap(sections_[i].contents, sections_[i].uncompressed_size);
+    }
+  }
+
+  void Add(const CompressedSection& section) {
+    sections_.push_back(section);
+  }
+
+  // Decompress the sections added so far, on this thread and up to
+  // THREADS - 1 others. Report those that can't be decompressed as
+  // problems with FILENAME. Return true if all were decompressed.
+  bool Decompress(const string& filename, unsigned int threads) {
+    std::atomic<size_t> next_section(0);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min<size_t>(threads, sections_.size()); i++)
+      workers.push_back(std::thread(DecompressSections, &sections_,
+                                    &next_section));
+    DecompressSections(&sections_, &next_section);
+    for (size_t i = 0; i < workers.size(); i++)
+      workers[i].join();
+
+    bool all_decompressed = true;
+    for (size_t i = 0; i < sections_.size(); i++) {
+      const CompressedSection& section = sections_[i];
+      if (section.contents)
+        continue;
+      if (IsSupportedCompression(section.type)) {
+        fprintf(stderr, "%s: failed to decompress section '%s'\n",
+                filename.c_str(), section.name.c_str());
+      } else {
+        fprintf(stderr, "%s: section '%s' is compressed in an unsupported"
+                " format (%u)\n", filename.c_str(), section.name.c_str(),
+                section.type);
+      }
+      all_decompressed = false;
+    }
+    return all_decompressed;
+  }
+
+  const std::vector<CompressedSection>& sections() const { return sections_; }
+
+ private:
+  std::vector<CompressedSection> sections_;
+
+  DISALLOW_COPY_AND_ASSIGN(DecompressedSections);
+};
+
+// The sections the DWARF readers LoadDwarf creates refer to. Compressed
+// sections other than these are left compressed.
+const char* const kDwarfReaderSections[] = {
+  ".debug_abbrev",
+  ".debug_addr",
+  ".debug_info",
+  ".debug_line",
+  ".debug_line_str",
+  ".debug_loc",
+  ".debug_loclists",
+  ".debug_ranges",
+  ".debug_rnglists",
+  ".debug_str",
+  ".debug_str_offsets",
+};
+
+bool IsDwarfReaderSection(const string& name) {
+  for (size_t i = 0;
+       i < sizeof(kDwarfReaderSections) / sizeof(kDwarfReaderSections[0]);
+       i++) {
+    if (name == kDwarfReaderSections[i])
+      return true;
+  }
+  return false;
+}
+
+// The contents and size of a DWARF section.
+typedef std::pair<const uint8_t *, uint64> DwarfSection;
+
+// Return the contents and size of the section named NAME in
+// SECTION_MAP, or a NULL pointer and zero if there is none.
+DwarfSection FindDwarfSection(const dwarf2reader::SectionMap& section_map,
+                              const string& name) {
+  dwarf2reader::SectionMap::const_iterator it = section_map.find(name);
+  if (it == section_map.end())
+    return DwarfSection(NULL, 0);
+  return it->second;
+}
+
 // A line-to-module loader that accepts line number info parsed by
 // dwarf2reader::LineInfo and populates a Module and a line vector
 // with the results.
 class DumperLineToModule: public DwarfCUToModule::LineToModuleHandler {
  public:
-  // Create a line-to-module converter using BYTE_READER.
-  explicit DumperLineToModule(dwarf2reader::ByteReader *byte_reader)
-      : byte_reader_(byte_reader) { }
+  // Create a line-to-module converter using BYTE_READER, finding the
+  // file names that DWARF 5 line number programs refer to in the string
+  // sections in SECTION_MAP.
+  DumperLineToModule(const dwarf2reader::SectionMap& section_map,
+                     dwarf2reader::ByteReader *byte_reader)
+      : strings_(FindDwarfSection(section_map, ".debug_str")),
+        line_strings_(FindDwarfSection(section_map, ".debug_line_str")),
+        byte_reader_(byte_reader) { }
   void StartCompilationUnit(const string& compilation_dir) {
     compilation_dir_ = compilation_dir;
   }
   void ReadProgram(const uint8_t *program, uint64 length,
-                   Module* module, std::vector<Module::Line>* lines) {
+                   Module* module, std::vector<Module::Line>* lines,
+                   std::map<uint32, Module::File*>* files) {
+    // Line number programs spend about four bytes on each row they add,
+    // so size LINES for the whole program up front rather than letting
+    // it grow a row at a time.
+    size_t initial_length_size;
+    const uint64 program_length =
+        byte_reader_->ReadInitialLength(program, &initial_length_size);
+    if (program_length <= length)
+      lines->reserve(lines->size() + program_length / 4);
     DwarfLineToModule handler(module, compilation_dir_, lines);
     dwarf2reader::LineInfo parser(program, length, byte_reader_, &handler);
+    parser.SetStringSections(strings_.first, strings_.second,
+                             line_strings_.first, line_strings_.second);
     parser.Start();
+    *files = handler.files();
   }
  private:
   string compilation_dir_;
+  const DwarfSection strings_;
+  const DwarfSection line_strings_;
   dwarf2reader::ByteReader *byte_reader_;
 };
 
+// A range list reader that reads range lists parsed by
+// dwarf2reader::RangeListReader from a file's .debug_ranges section, or,
+// for DWARF 5 compilation units, its .debug_rnglists section.
+class DumperRangesHandler: public DwarfCUToModule::RangesHandler {
+ public:
+  // Read range lists from the sections in SECTION_MAP using BYTE_READER.
+  DumperRangesHandler(const dwarf2reader::SectionMap& section_map,
+                      dwarf2reader::ByteReader *byte_reader)
+      : ranges_(FindDwarfSection(section_map, ".debug_ranges")),
+        rnglists_(FindDwarfSection(section_map, ".debug_rnglists")),
+        addr_(FindDwarfSection(section_map, ".debug_addr")),
+        byte_reader_(byte_reader), dwarf_version_(0), addr_base_(0) { }
+
+  // Return true if SECTION_MAP has any range lists for us to read.
+  static bool HasRanges(const dwarf2reader::SectionMap& section_map) {
+    return section_map.count(".debug_ranges") ||
+           section_map.count(".debug_rnglists");
+  }
+
+  void StartCompilationUnit(uint8 dwarf_version, uint64 addr_base) {
+    dwarf_version_ = dwarf_version;
+    addr_base_ = addr_base;
+  }
+  bool ReadRanges(uint64 offset, Module::Address base_address,
+                  std::vector<Module::Range>* ranges) {
+    RangeAppender appender(ranges);
+    if (dwarf_version_ >= 5) {
+      dwarf2reader::RangeListReader reader(rnglists_.first, rnglists_.second,
+                                           byte_reader_, &appender);
+      reader.SetAddressTable(addr_.first, addr_.second, addr_base_);
+      return reader.ReadRngList(offset, base_address);
+    }
+    dwarf2reader::RangeListReader reader(ranges_.first, ranges_.second,
+                                         byte_reader_, &appender);
+    return reader.ReadRangeList(offset, base_address);
+  }
+ private:
+  // Appends each non-empty range of a range list to a vector.
+  class RangeAppender: public dwarf2reader::RangeListHandler {
+   public:
+    explicit RangeAppender(std::vector<Module::Range>* ranges)
+        : ranges_(ranges) { }
+    void AddRange(uint64 begin, uint64 end) {
+      if (begin < end)
+        ranges_->push_back(Module::Range(begin, end - begin));
+    }
+   private:
+    std::vector<Module::Range>* ranges_;
+  };
+
+  const DwarfSection ranges_;
+  const DwarfSection rnglists_;
+  const DwarfSection addr_;
+  dwarf2reader::ByteReader *byte_reader_;
+  uint8 dwarf_version_;
+  uint64 addr_base_;
+};
+
+// Reads DWARF compilation units into a module, one after another. Each
+// compilation unit's header sets the address and offset sizes of the
+// byte reader used to read it, so threads reading units at the same time
+// each need a reader of their own.
+class DumperUnitReader {
+ public:
+  // Read units from the DWARF file DWARF_FILENAME, whose sections are in
+  // SECTION_MAP, in ENDIANNESS, finding their abbreviation tables in
+  // ABBREV_CACHE. If HANDLE_INLINES is true, record the code inlined into
+  // each function.
+  DumperUnitReader(const string& dwarf_filename,
+                   const dwarf2reader::SectionMap& section_map,
+                   dwarf2reader::Endianness endianness,
+                   dwarf2reader::AbbrevCache* abbrev_cache,
+                   bool handle_inlines)
+      : dwarf_filename_(dwarf_filename),
+        byte_reader_(endianness),
+        line_to_module_(section_map, &byte_reader_),
+        abbrev_cache_(abbrev_cache),
+        handle_inlines_(handle_inlines) {
+    if (DumperRangesHandler::HasRanges(section_map))
+      ranges_handler_.reset(new DumperRangesHandler(section_map,
+                                                    &byte_reader_));
+  }
+
+  // Read the compilation unit at OFFSET using FILE_CONTEXT, and return
+  // its size. If FUNCTIONS is not NULL, append the unit's functions to it
+  // instead of adding them to the module. Print warnings to OUTPUT.
+  uint64 ReadUnit(DwarfCUToModule::FileContext* file_context, uint64 offset,
+                  std::vector<Module::Function*>* functions, FILE* output) {
+    // Make a handler for the root DIE that populates the module with the
+    // data that was found.
+    DwarfCUToModule::WarningReporter reporter(dwarf_filename_, offset,
+                                              output);
+    DwarfCUToModule root_handler(file_context, &line_to_module_, &reporter,
+                                 ranges_handler_.get(), handle_inlines_);
+    if (functions)
+      root_handler.CollectFunctions(functions);
+    // Make a Dwarf2Handler that drives the DIEHandler.
+    dwarf2reader::DIEDispatcher die_dispatcher(&root_handler);
+    // Make a DWARF parser for the compilation unit at OFFSET.
+    dwarf2reader::CompilationUnit reader(dwarf_filename_,
+                                         file_context->section_map(),
+                                         offset,
+                                         &byte_reader_,
+                                         &die_dispatcher);
+    reader.SetAbbrevCache(abbrev_cache_);
+    // Process the entire compilation unit; get the offset of the next.
+    return reader.Start();
+  }
+
+ private:
+  const string dwarf_filename_;
+  dwarf2reader::ByteReader byte_reader_;
+  DumperLineToModule line_to_module_;
+  scoped_ptr<DumperRangesHandler> ranges_handler_;
+  dwarf2reader::AbbrevCache* abbrev_cache_;
+  const bool handle_inlines_;
+};
+
+// A compilation unit read apart from the others, with a file context of
+// its own, and the functions and warnings it produced.
+struct DumperUnit {
+  uint64 offset;
+  DwarfCUToModule::FileContext* file_context;
+  std::vector<Module::Function*> functions;
+  char* warnings;
+  size_t warnings_size;
+};
+
+// The number of compilation units per thread to read before adding their
+// functions to the module. This bounds the memory held by functions read
+// but not yet handed over, which a memory budget doesn't account for.
+const size_t kUnitsPerThread = 32;
+
+// Read the units in UNITS before END_UNIT with a reader of our own,
+// claiming each by taking the next index from NEXT_UNIT, until all have
+// been claimed.
+void ReadDumperUnits(const string* dwarf_filename,
+                     const dwarf2reader::SectionMap* section_map,
+                     dwarf2reader::Endianness endianness,
+                     dwarf2reader::AbbrevCache* abbrev_cache,
+                     bool handle_inlines,
+                     std::vector<DumperUnit>* units,
+                     size_t end_unit,
+                     std::atomic<size_t>* next_unit) {
+  DumperUnitReader reader(*dwarf_filename, *section_map, endianness,
+                          abbrev_cache, handle_inlines);
+  for (size_t i = (*next_unit)++; i < end_unit; i = (*next_unit)++) {
+    DumperUnit* unit = &(*units)[i];
+    // Hold the unit's warnings until its functions are added to the
+    // module, so they come out in the same order as a serial read's.
+    FILE* output = open_memstream(&unit->warnings, &unit->warnings_size);
+    reader.ReadUnit(unit->file_context, unit->offset, &unit->functions,
+                    output ? output : stderr);
+    if (output)
+      fclose(output);
+  }
+}
+
 template<typename ElfClass>
 bool LoadDwarf(const string& dwarf_filename,
                const typename ElfClass::Ehdr* elf_header,
                const bool big_endian,
                bool handle_inter_cu_refs,
+               bool handle_inlines,
+               unsigned int threads,
                Module* module) {
   typedef typename ElfClass::Shdr Shdr;
 
   const dwarf2reader::Endianness endianness = big_endian ?
       dwarf2reader::ENDIANNESS_BIG : dwarf2reader::ENDIANNESS_LITTLE;
-  dwarf2reader::ByteReader byte_reader(endianness);
 
   // Construct a context for this file.
   DwarfCUToModule::FileContext file_context(dwarf_filename,
                                             module,
                                             handle_inter_cu_refs);
 
-  // Build a map of the ELF file's sections.
+  if (threads == 0)
+    threads = std::thread::hardware_concurrency();
+
+  // Build a map of the ELF file's sections. Decompress the compressed
+  // sections the readers below use, several at a time. Map the rest as
+  // they are, so that they are still known to be present.
   const Shdr* sections =
       GetOffset<ElfClass, Shdr>(elf_header, elf_header->e_shoff);
   int num_sections = elf_header->e_shnum;
   const Shdr* section_names = sections + elf_header->e_shstrndx;
+  DecompressedSections decompressed;
   for (int i = 0; i < num_sections; i++) {
     const Shdr* section = &sections[i];
     string name = GetOffset<ElfClass, char>(elf_header,
                                             section_names->sh_offset) +
                   section->sh_name;
+    CompressedSection compressed;
+    if (GetCompressedSection<ElfClass>(elf_header, section, name,
+                                       &compressed) &&
+        IsDwarfReaderSection(compressed.name)) {
+      decompressed.Add(compressed);
+      continue;
+    }
     const uint8_t *contents = GetOffset<ElfClass, uint8_t>(elf_header,
                                                            section->sh_offset);
     file_context.AddSectionToSectionMap(name, contents, section->sh_size);
   }
+  // Drop the sections that can't be decompressed, as if they were absent.
+  if (!decompressed.Decompress(dwarf_filename, threads)) {
+    fprintf(stderr, "%s: dropping the DWARF sections that could not be"
+            " decompressed\n", dwarf_filename.c_str());
+  }
+  for (size_t i = 0; i < decompressed.sections().size(); i++) {
+    const CompressedSection& section = decompressed.sections()[i];
+    if (section.contents) {
+      file_context.AddSectionToSectionMap(section.name, section.contents,
+                                          section.uncompressed_size);
+    }
+  }
 
-  // Parse all the compilation units in the .debug_info section.
-  DumperLineToModule line_to_module(&byte_reader);
+  // Parse all the compilation units in the .debug_info section, parsing
+  // each abbreviation table they use only once.
+  dwarf2reader::AbbrevCache abbrev_cache;
+  DumperUnitReader reader(dwarf_filename, file_context.section_map(),
+                          endianness, &abbrev_cache, handle_inlines);
   dwarf2reader::SectionMap::const_iterator debug_info_entry =
       file_context.section_map().find(".debug_info");
-  assert(debug_info_entry != file_context.section_map().end());
+  // The section may have been compressed in a way we couldn't undo.
+  if (debug_info_entry == file_context.section_map().end())
+    return false;
   const std::pair<const uint8_t *, uint64>& debug_info_section =
       debug_info_entry->second;
   // This should never have been called if the file doesn't have a
   // .debug_info section.
   assert(debug_info_section.first);
   uint64 debug_info_length = debug_info_section.second;
-  for (uint64 offset = 0; offset < debug_info_length;) {
-    // Make a handler for the root DIE that populates MODULE with the
-    // data that was found.
-    DwarfCUToModule::WarningReporter reporter(dwarf_filename, offset);
-    DwarfCUToModule root_handler(&file_context, &line_to_module, &reporter);
-    // Make a Dwarf2Handler that drives the DIEHandler.
-    dwarf2reader::DIEDispatcher die_dispatcher(&root_handler);
-    // Make a DWARF parser for the compilation unit at OFFSET.
-    dwarf2reader::CompilationUnit reader(dwarf_filename,
-                                         file_context.section_map(),
-                                         offset,
-                                         &byte_reader,
-                                         &die_dispatcher);
-    // Process the entire compilation unit; get the offset of the next.
-    offset += reader.Start();
+
+  // Find where the compilation units start, so they can be read on
+  // several threads. If the units' lengths don't add up, leave it to a
+  // serial read to make what it can of them.
+  std::vector<DumperUnit> units;
+  if (threads > 1) {
+    dwarf2reader::ByteReader length_reader(endianness);
+    for (uint64 offset = 0; offset < debug_info_length;) {
+      uint64 remaining = debug_info_length - offset;
+      size_t initial_length_size;
+      if (remaining < 4 ||
+          (length_reader.ReadFourBytes(debug_info_section.first + offset) ==
+               0xffffffff && remaining < 12)) {
+        units.clear();
+        break;
+      }
+      uint64 length = length_reader.ReadInitialLength(
+          debug_info_section.first + offset, &initial_length_size);
+      if (length > remaining - initial_length_size) {
+        units.clear();
+        break;
+      }
+      DumperUnit unit = { offset, NULL, std::vector<Module::Function*>(),
+                          NULL, 0 };
+      units.push_back(unit);
+      offset += initial_length_size + length;
+    }
+  }
+
+  if (units.size() < 2) {
+    for (uint64 offset = 0; offset < debug_info_length;)
+      offset += reader.ReadUnit(&file_context, offset, NULL, stderr);
+    return true;
+  }
+
+  // Read each unit with a file context of its own, on this thread and
+  // THREADS - 1 others, a window of units at a time. After each window,
+  // add the units' functions to the module in the order a serial read
+  // would have. A unit that refers to DIEs in the units before it was
+  // read without their definitions, so read it again, this time with
+  // them, in FILE_CONTEXT.
+  const size_t window = threads * kUnitsPerThread;
+  size_t merged_units = 0;
+  for (size_t begin = 0; begin < units.size(); begin += window) {
+    const size_t end = std::min(units.size(), begin + window);
+    for (size_t i = begin; i < end; i++) {
+      units[i].file_context =
+          new DwarfCUToModule::FileContext(dwarf_filename, module,
+                                           handle_inter_cu_refs);
+      for (dwarf2reader::SectionMap::const_iterator it =
+               file_context.section_map().begin();
+           it != file_context.section_map().end(); ++it) {
+        units[i].file_context->AddSectionToSectionMap(it->first,
+                                                      it->second.first,
+                                                      it->second.second);
+      }
+    }
+    std::atomic<size_t> next_unit(begin);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min<size_t>(threads, end - begin); i++) {
+      workers.push_back(std::thread(ReadDumperUnits, &dwarf_filename,
+                                    &file_context.section_map(), endianness,
+                                    &abbrev_cache, handle_inlines, &units,
+                                    end, &next_unit));
+    }
+    ReadDumperUnits(&dwarf_filename, &file_context.section_map(), endianness,
+                    &abbrev_cache, handle_inlines, &units, end, &next_unit);
+    for (size_t i = 0; i < workers.size(); i++)
+      workers[i].join();
+
+    for (size_t i = begin; i < end; i++) {
+      DumperUnit* unit = &units[i];
+      if (!unit->file_context->ReferencedEarlierUnits()) {
+        if (unit->warnings)
+          fwrite(unit->warnings, 1, unit->warnings_size, stderr);
+        module->AddFunctions(unit->functions.begin(),
+                             unit->functions.end());
+      } else {
+        for (; merged_units < i; merged_units++)
+          file_context.AddDefinitionsFrom(*units[merged_units].file_context);
+        for (size_t j = 0; j < unit->functions.size(); j++)
+          delete unit->functions[j];
+        reader.ReadUnit(&file_context, unit->offset, NULL, stderr);
+        merged_units = i + 1;
+      }
+      std::vector<Module::Function*>().swap(unit->functions);
+      free(unit->warnings);
+      unit->warnings = NULL;
+    }
   }
+  for (size_t i = 0; i < units.size(); i++)
+    delete units[i].file_context;
   return true;
 }
 
@@ -343,10 +886,21 @@ bool LoadDwarfCFI(const string& dwarf_filename,
   const dwarf2reader::Endianness endianness = big_endian ?
       dwarf2reader::ENDIANNESS_BIG : dwarf2reader::ENDIANNESS_LITTLE;
 
-  // Find the call frame information and its size.
+  // Find the call frame information and its size, decompressing it if
+  // need be.
   const uint8_t *cfi =
       GetOffset<ElfClass, uint8_t>(elf_header, section->sh_offset);
   size_t cfi_size = section->sh_size;
+  DecompressedSections decompressed;
+  CompressedSection compressed;
+  if (GetCompressedSection<ElfClass>(elf_header, section, section_name,
+                                     &compressed)) {
+    decompressed.Add(compressed);
+    if (!decompressed.Decompress(dwarf_filename, 1))
+      return false;
+    cfi = decompressed.sections()[0].contents;
+    cfi_size = decompressed.sections()[0].uncompressed_size;
+  }
 
   // Plug together the parser, handler, and their entourages.
   DwarfCFIToModule::Reporter module_reporter(dwarf_filename, section_name);
@@ -655,12 +1209,22 @@ bool LoadSymbols(const string& obj_file,
                                        elf_header->e_shnum);
     }
 
+    // Older toolchains compress sections by giving them ".zdebug" names.
+    if (!dwarf_section) {
+      dwarf_section =
+        FindElfSectionByName<ElfClass>(".zdebug_info", SHT_PROGBITS,
+                                       sections, names, names_end,
+                                       elf_header->e_shnum);
+    }
+
     if (dwarf_section) {
       found_debug_info_section = true;
       found_usable_info = true;
       info->LoadedSection(".debug_info");
       if (!LoadDwarf<ElfClass>(obj_file, elf_header, big_endian,
-                               options.handle_inter_cu_refs, module)) {
+                               options.handle_inter_cu_refs,
+                               options.handle_inlines, options.threads,
+                               module)) {
         fprintf(stderr, "%s: \".debug_info\" section found, but failed to load "
                 "DWARF debugging information\n", obj_file.c_str());
       }
@@ -742,13 +1306,22 @@ bool LoadSymbols(const string& obj_file,
                                         elf_header->e_shnum);
     }
 
+    const char* dwarf_cfi_section_name = ".debug_frame";
+    if (!dwarf_cfi_section) {
+      dwarf_cfi_section =
+          FindElfSectionByName<ElfClass>(".zdebug_frame", SHT_PROGBITS,
+                                         sections, names, names_end,
+                                         elf_header->e_shnum);
+      dwarf_cfi_section_name = ".zdebug_frame";
+    }
+
     if (dwarf_cfi_section) {
       // Ignore the return value of this function; even without call frame
       // information, the other debugging information could be perfectly
       // useful.
       info->LoadedSection(".debug_frame");
       bool result =
-          LoadDwarfCFI<ElfClass>(obj_file, elf_header, ".debug_frame",
+          LoadDwarfCFI<ElfClass>(obj_file, elf_header, dwarf_cfi_section_name,
                                  dwarf_cfi_section, false, 0, 0, big_endian,
                                  module);
       found_usable_info = found_usable_info || result;
@@ -925,6 +1498,7 @@ bool ReadSymbolDataElfClass(const typename ElfClass::Ehdr* elf_header,
   if (!InitModuleForElfClass<ElfClass>(elf_header, obj_filename, module)) {
     return false;
   }
+  module->SetMemoryBudget(options.memory_budget);
 
   // Figure out what endianness this file is.
   bool big_endian;
@@ -47,13 +47,30 @@ namespace google_breakpad {
 class Module;
 
 struct DumpOptions {
-  DumpOptions(SymbolData symbol_data, bool handle_inter_cu_refs)
+  DumpOptions(SymbolData symbol_data, bool handle_inter_cu_refs,
+              bool handle_inlines = false, unsigned int threads = 1,
+              size_t memory_budget = 0)
       : symbol_data(symbol_data),
-        handle_inter_cu_refs(handle_inter_cu_refs) {
+        handle_inter_cu_refs(handle_inter_cu_refs),
+        handle_inlines(handle_inlines),
+        threads(threads),
+        memory_budget(memory_budget) {
   }
 
   SymbolData symbol_data;
   bool handle_inter_cu_refs;
+
+  // Write INLINE_ORIGIN and INLINE records describing inlined code.
+  bool handle_inlines;
+
+  // The number of threads to read DWARF compilation units on, or zero to
+  // use one per processor. The symbol file is the same however many
+  // threads read it.
+  unsigned int threads;
+
+  // The most memory, in bytes, to hold functions in before spilling them
+  // to temporary files, or zero for no limit; see Module::SetMemoryBudget.
+  size_t memory_budget;
 };
 
 // Find all the debugging information in OBJ_FILE, an ELF executable
@@ -32,14 +32,22 @@
 // dump_symbols_unittest.cc:
 // Unittests for google_breakpad::DumpSymbols
 
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <elf.h>
 #include <link.h>
 #include <stdio.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
 #include <sstream>
 #include <vector>
 
 #include "breakpad_googletest_includes.h"
+#include "common/dwarf/cfi_assembler.h"
 #include "common/linux/elf_gnu_compat.h"
 #include "common/linux/elfutils.h"
 #include "common/linux/dump_symbols.h"
@@ -55,10 +63,12 @@ bool ReadSymbolDataInternal(const uint8_t* obj_file,
                             const DumpOptions& options,
                             Module** module);
 
+using google_breakpad::CFISection;
 using google_breakpad::synth_elf::ELF;
 using google_breakpad::synth_elf::Notes;
 using google_breakpad::synth_elf::StringTable;
 using google_breakpad::synth_elf::SymbolTable;
+using google_breakpad::test_assembler::Label;
 using google_breakpad::test_assembler::kLittleEndian;
 using google_breakpad::test_assembler::Section;
 using std::stringstream;
@@ -201,4 +211,242 @@ TYPED_TEST(DumpSymbols, SimpleBuildID) {
   delete module;
 }
 
+#ifdef HAVE_LIBZ
+// Return CONTENTS compressed with zlib.
+string Compress(const string& contents) {
+  uLongf compressed_size = compressBound(contents.size());
+  string compressed(compressed_size, '\0');
+  EXPECT_EQ(Z_OK,
+            compress(reinterpret_cast<Bytef*>(&compressed[0]),
+                     &compressed_size,
+                     reinterpret_cast<const Bytef*>(contents.data()),
+                     contents.size()));
+  compressed.resize(compressed_size);
+  return compressed;
+}
+
+// Return the contents of a section flagged SHF_COMPRESSED in an ELF file
+// of class ElfClass, holding CONTENTS compressed with zlib, whose
+// compression header gives TYPE.
+template<typename ElfClass>
+string CompressedSectionContents(const string& contents, uint32_t type) {
+  // An ELF compression header, then the zlib stream.
+  Section section(kLittleEndian);
+  section.D32(type);
+  if (ElfClass::kClass == ELFCLASS64) {
+    section.D32(0)          // ch_reserved
+        .D64(contents.size())
+        .D64(1);
+  } else {
+    section.D32(contents.size())
+        .D32(1);
+  }
+  section.Append(Compress(contents));
+  string section_contents;
+  EXPECT_TRUE(section.GetContents(&section_contents));
+  return section_contents;
+}
+
+// Return the symbol file dump_syms writes for an ELF file of class
+// ElfClass holding only a .text section and a call frame information
+// section with the given NAME, CONTENTS, and FLAGS.
+template<typename ElfClass>
+string DumpCFISection(const string& name, const string& contents,
+                      uint32_t flags) {
+  ELF elf(ElfClass::kMachine, ElfClass::kClass, kLittleEndian);
+  Section text(kLittleEndian);
+  text.Append(4096, 0);
+  elf.AddSection(".text", text, SHT_PROGBITS);
+  Section cfi(kLittleEndian);
+  cfi.Append(contents);
+  elf.AddSection(name, cfi, SHT_PROGBITS, flags);
+  elf.Finish();
+
+  string elf_contents;
+  EXPECT_TRUE(elf.GetContents(&elf_contents));
+  vector<uint8_t> elfdata(elf_contents.begin(), elf_contents.end());
+  Module* module;
+  DumpOptions options(ONLY_CFI, true);
+  if (!ReadSymbolDataInternal(&elfdata[0], "foo", vector<string>(), options,
+                              &module))
+    return "";
+  stringstream s;
+  module->Write(s, ONLY_CFI);
+  delete module;
+  return s.str();
+}
+
+// Compressed call frame information should produce the same STACK CFI
+// records as uncompressed, whether the section is flagged SHF_COMPRESSED
+// or named ".zdebug_frame".
+TYPED_TEST(DumpSymbols, CompressedDebugFrame) {
+  CFISection frame(kLittleEndian, TypeParam::kAddrSize);
+  Label cie;
+  frame
+      .Mark(&cie)
+      .CIEHeader(1, -8, 8, 3, "")
+      .D8(dwarf2reader::DW_CFA_def_cfa).ULEB128(4).ULEB128(8)
+      .FinishEntry()
+      .FDEHeader(cie, 0x1000, 0x10)
+      .D8(dwarf2reader::DW_CFA_advance_loc | 4)
+      .D8(dwarf2reader::DW_CFA_def_cfa_offset).ULEB128(16)
+      .FinishEntry();
+  string contents;
+  ASSERT_TRUE(frame.GetContents(&contents));
+
+  // "ZLIB", the big-endian size, then the zlib stream.
+  Section legacy(kLittleEndian);
+  legacy.Append("ZLIB")
+      .B64(contents.size())
+      .Append(Compress(contents));
+  string legacy_contents;
+  ASSERT_TRUE(legacy.GetContents(&legacy_contents));
+
+  const string expected =
+      DumpCFISection<TypeParam>(".debug_frame", contents, 0);
+  EXPECT_NE(string::npos, expected.find("STACK CFI INIT 1000 10 "));
+  EXPECT_EQ(expected,
+            DumpCFISection<TypeParam>(
+                ".debug_frame",
+                CompressedSectionContents<TypeParam>(contents,
+                                                     ELFCOMPRESS_ZLIB),
+                SHF_COMPRESSED));
+  EXPECT_EQ(expected,
+            DumpCFISection<TypeParam>(".zdebug_frame", legacy_contents, 0));
+}
+
+// Return a .debug_info section for an ELF file of class ElfClass,
+// describing a function "f" at 0x1000, 0x10 bytes long, in "a.c".
+template<typename ElfClass>
+string DebugInfoContents() {
+  Section info(kLittleEndian);
+  Label info_length, info_start, info_end;
+  info
+      .D32(info_length)
+      .Mark(&info_start)
+      .D16(2)
+      .D32(0)                       // debug_abbrev_offset
+      .D8(ElfClass::kAddrSize)
+      .ULEB128(1).AppendCString("a.c").D32(0)
+      .ULEB128(2).AppendCString("f")
+      .Append(kLittleEndian, ElfClass::kAddrSize, 0x1000)
+      .Append(kLittleEndian, ElfClass::kAddrSize, 0x1010)
+      .ULEB128(0)
+      .Mark(&info_end);
+  info_length = info_end - info_start;
+  string contents;
+  EXPECT_TRUE(info.GetContents(&contents));
+  return contents;
+}
+
+// Return the symbol file dump_syms writes for an ELF file of class
+// ElfClass holding a .text section, the .debug_abbrev and .debug_line
+// sections DebugInfoContents's section refers to, placing "f" on line 10,
+// and a .debug_info section with the given CONTENTS and FLAGS.
+template<typename ElfClass>
+string DumpDebugInfo(const string& contents, uint32_t flags) {
+  const size_t address_size = ElfClass::kAddrSize;
+  ELF elf(ElfClass::kMachine, ElfClass::kClass, kLittleEndian);
+  Section text(kLittleEndian);
+  text.Append(4096, 0);
+  elf.AddSection(".text", text, SHT_PROGBITS);
+
+  // A compilation unit holding a subprogram.
+  Section abbrev(kLittleEndian);
+  abbrev
+      .ULEB128(1).ULEB128(dwarf2reader::DW_TAG_compile_unit).D8(1)
+      .ULEB128(dwarf2reader::DW_AT_name)
+      .ULEB128(dwarf2reader::DW_FORM_string)
+      .ULEB128(dwarf2reader::DW_AT_stmt_list)
+      .ULEB128(dwarf2reader::DW_FORM_data4)
+      .ULEB128(0).ULEB128(0)
+      .ULEB128(2).ULEB128(dwarf2reader::DW_TAG_subprogram).D8(0)
+      .ULEB128(dwarf2reader::DW_AT_name)
+      .ULEB128(dwarf2reader::DW_FORM_string)
+      .ULEB128(dwarf2reader::DW_AT_low_pc)
+      .ULEB128(dwarf2reader::DW_FORM_addr)
+      .ULEB128(dwarf2reader::DW_AT_high_pc)
+      .ULEB128(dwarf2reader::DW_FORM_addr)
+      .ULEB128(0).ULEB128(0)
+      .ULEB128(0);
+  elf.AddSection(".debug_abbrev", abbrev, SHT_PROGBITS);
+
+  // A version 2 line number program.
+  static const uint8_t kStandardOpcodeLengths[] = {
+    0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1
+  };
+  Section line(kLittleEndian);
+  Label line_length, line_start, header_length, header_start, line_end;
+  line
+      .D32(line_length)
+      .Mark(&line_start)
+      .D16(2)
+      .D32(header_length)
+      .Mark(&header_start)
+      .D8(1)                        // minimum_instruction_length
+      .D8(1)                        // default_is_stmt
+      .D8(0xfb)                     // line_base: -5
+      .D8(14)                       // line_range
+      .D8(13)                       // opcode_base
+      .Append(kStandardOpcodeLengths, sizeof(kStandardOpcodeLengths))
+      .D8(0)                        // no include_directories
+      .AppendCString("a.c").ULEB128(0).ULEB128(0).ULEB128(0)
+      .D8(0);
+  header_length = line.Here() - header_start;
+  line
+      .D8(0).ULEB128(1 + address_size).D8(dwarf2reader::DW_LNE_set_address)
+      .Append(kLittleEndian, address_size, 0x1000)
+      .D8(dwarf2reader::DW_LNS_advance_line).LEB128(9)
+      .D8(dwarf2reader::DW_LNS_copy)
+      .D8(dwarf2reader::DW_LNS_advance_pc).ULEB128(0x10)
+      .D8(0).ULEB128(1).D8(dwarf2reader::DW_LNE_end_sequence)
+      .Mark(&line_end);
+  line_length = line_end - line_start;
+  elf.AddSection(".debug_line", line, SHT_PROGBITS);
+
+  Section info(kLittleEndian);
+  info.Append(contents);
+  elf.AddSection(".debug_info", info, SHT_PROGBITS, flags);
+  elf.Finish();
+
+  string elf_contents;
+  EXPECT_TRUE(elf.GetContents(&elf_contents));
+  vector<uint8_t> elfdata(elf_contents.begin(), elf_contents.end());
+  Module* module;
+  DumpOptions options(NO_CFI, true);
+  if (!ReadSymbolDataInternal(&elfdata[0], "foo", vector<string>(), options,
+                              &module))
+    return "";
+  stringstream s;
+  module->Write(s, NO_CFI);
+  delete module;
+  return s.str();
+}
+
+// A compressed .debug_info section should produce the same functions and
+// lines as an uncompressed one.
+TYPED_TEST(DumpSymbols, CompressedDebugInfo) {
+  const string contents = DebugInfoContents<TypeParam>();
+  const string expected = DumpDebugInfo<TypeParam>(contents, 0);
+  EXPECT_NE(string::npos, expected.find("\nFUNC 1000 10 0 f\n1000 10 10 "));
+  EXPECT_EQ(expected,
+            DumpDebugInfo<TypeParam>(
+                CompressedSectionContents<TypeParam>(contents,
+                                                     ELFCOMPRESS_ZLIB),
+                SHF_COMPRESSED));
+}
+
+// A .debug_info section compressed in a format dump_syms doesn't know
+// yields no functions, but doesn't stop the dump.
+TYPED_TEST(DumpSymbols, UnsupportedCompressedDebugInfo) {
+  const string dump =
+      DumpDebugInfo<TypeParam>(
+          CompressedSectionContents<TypeParam>(DebugInfoContents<TypeParam>(),
+                                               0x7fffffff),
+          SHF_COMPRESSED);
+  EXPECT_EQ(0U, dump.find("MODULE "));
+  EXPECT_EQ(string::npos, dump.find("FUNC "));
+}
+#endif  // HAVE_LIBZ
+
 }  // namespace google_breakpad
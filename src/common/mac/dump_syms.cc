@@ -309,22 +309,48 @@ string DumpSymbols::Identifier() {
 class DumpSymbols::DumperLineToModule:
       public DwarfCUToModule::LineToModuleHandler {
  public:
-  // Create a line-to-module converter using BYTE_READER.
-  DumperLineToModule(dwarf2reader::ByteReader *byte_reader)
-      : byte_reader_(byte_reader) { }
+  // Create a line-to-module converter using BYTE_READER, finding the
+  // file names that DWARF 5 line number programs refer to in the string
+  // sections in SECTION_MAP.
+  DumperLineToModule(const dwarf2reader::SectionMap& section_map,
+                     dwarf2reader::ByteReader *byte_reader)
+      : strings_(NULL, 0), line_strings_(NULL, 0),
+        byte_reader_(byte_reader) {
+    dwarf2reader::SectionMap::const_iterator it =
+        section_map.find("__debug_str");
+    if (it != section_map.end())
+      strings_ = it->second;
+    it = section_map.find("__debug_line_str");
+    if (it != section_map.end())
+      line_strings_ = it->second;
+  }
 
   void StartCompilationUnit(const string& compilation_dir) {
     compilation_dir_ = compilation_dir;
   }
 
   void ReadProgram(const uint8_t *program, uint64 length,
-                   Module *module, vector<Module::Line> *lines) {
+                   Module *module, vector<Module::Line> *lines,
+                   std::map<uint32, Module::File *> *files) {
+    // Line number programs spend about four bytes on each row they add,
+    // so size LINES for the whole program up front rather than letting
+    // it grow a row at a time.
+    size_t initial_length_size;
+    const uint64 program_length =
+        byte_reader_->ReadInitialLength(program, &initial_length_size);
+    if (program_length <= length)
+      lines->reserve(lines->size() + program_length / 4);
     DwarfLineToModule handler(module, compilation_dir_, lines);
     dwarf2reader::LineInfo parser(program, length, byte_reader_, &handler);
+    parser.SetStringSections(strings_.first, strings_.second,
+                             line_strings_.first, line_strings_.second);
     parser.Start();
+    *files = handler.files();
   }
  private:
   string compilation_dir_;
+  std::pair<const uint8_t *, uint64> strings_;
+  std::pair<const uint8_t *, uint64> line_strings_;
   dwarf2reader::ByteReader *byte_reader_;  // WEAK
 };
 
@@ -423,9 +449,11 @@ bool DumpSymbols::ReadDwarf(google_breakpad::Module *module,
   }
 
   // Build a line-to-module loader for the root handler to use.
-  DumperLineToModule line_to_module(&byte_reader);
+  DumperLineToModule line_to_module(file_context.section_map(), &byte_reader);
 
-  // Walk the __debug_info section, one compilation unit at a time.
+  // Walk the __debug_info section, one compilation unit at a time,
+  // parsing each abbreviation table the units use only once.
+  dwarf2reader::AbbrevCache abbrev_cache;
   uint64 debug_info_length = debug_info_section.second;
   for (uint64 offset = 0; offset < debug_info_length;) {
     // Make a handler for the root DIE that populates MODULE with the
@@ -441,6 +469,7 @@ bool DumpSymbols::ReadDwarf(google_breakpad::Module *module,
                                                offset,
                                                &byte_reader,
                                                &die_dispatcher);
+    dwarf_reader.SetAbbrevCache(&abbrev_cache);
     // Process the entire compilation unit; get the offset of the next.
     offset += dwarf_reader.Start();
   }
@@ -47,6 +47,265 @@ using std::dec;
 using std::endl;
 using std::hex;
 
+namespace {
+
+// Functions and CFI entries spilled to temporary files are written in
+// this process's own byte order, with File and InlineOrigin pointers
+// stored as they are: only the module that wrote them reads them back,
+// and it owns those objects until it is destroyed.
+
+template<typename T>
+bool PutValue(FILE *file, const T &value) {
+  return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+bool PutString(FILE *file, const string &str) {
+  uint64_t size = str.size();
+  return PutValue(file, size) &&
+         fwrite(str.data(), 1, str.size(), file) == str.size();
+}
+
+template<typename T>
+bool GetValue(FILE *file, T *value) {
+  return fread(value, sizeof(*value), 1, file) == 1;
+}
+
+bool GetString(FILE *file, string *str) {
+  uint64_t size;
+  if (!GetValue(file, &size))
+    return false;
+  str->resize(size);
+  return size == 0 || fread(&(*str)[0], 1, size, file) == size;
+}
+
+bool PutRuleMap(FILE *file, const Module::RuleMap &rule_map) {
+  if (!PutValue(file, static_cast<uint64_t>(rule_map.size())))
+    return false;
+  for (Module::RuleMap::const_iterator it = rule_map.begin();
+       it != rule_map.end(); ++it) {
+    if (!PutString(file, it->first) || !PutString(file, it->second))
+      return false;
+  }
+  return true;
+}
+
+bool GetRuleMap(FILE *file, Module::RuleMap *rule_map) {
+  uint64_t count;
+  if (!GetValue(file, &count))
+    return false;
+  for (uint64_t i = 0; i < count; i++) {
+    string reg, rule;
+    if (!GetString(file, &reg) || !GetString(file, &rule))
+      return false;
+    (*rule_map)[reg] = rule;
+  }
+  return true;
+}
+
+bool PutFunction(FILE *file, const Module::Function &func) {
+  if (!PutString(file, func.name) ||
+      !PutValue(file, func.address) ||
+      !PutValue(file, func.size) ||
+      !PutValue(file, func.parameter_size) ||
+      !PutValue(file, static_cast<uint64_t>(func.lines.size())) ||
+      !PutValue(file, static_cast<uint64_t>(func.inlines.size())))
+    return false;
+  for (size_t i = 0; i < func.lines.size(); i++) {
+    if (!PutValue(file, func.lines[i]))
+      return false;
+  }
+  for (size_t i = 0; i < func.inlines.size(); i++) {
+    const Module::Inline &in = func.inlines[i];
+    if (!PutValue(file, in.origin) ||
+        !PutValue(file, in.call_site_file) ||
+        !PutValue(file, in.call_site_file_id) ||
+        !PutValue(file, in.call_site_line) ||
+        !PutValue(file, in.nest_level) ||
+        !PutValue(file, static_cast<uint64_t>(in.ranges.size())))
+      return false;
+    for (size_t j = 0; j < in.ranges.size(); j++) {
+      if (!PutValue(file, in.ranges[j]))
+        return false;
+    }
+  }
+  return true;
+}
+
+// Read a function written by PutFunction from FILE, or return NULL at
+// the end of the file or if an error occurs.
+Module::Function *GetFunction(FILE *file) {
+  string name;
+  Module::Address address;
+  if (!GetString(file, &name) || !GetValue(file, &address))
+    return NULL;
+  Module::Function *func = new Module::Function(name, address);
+  uint64_t line_count, inline_count;
+  bool ok = GetValue(file, &func->size) &&
+            GetValue(file, &func->parameter_size) &&
+            GetValue(file, &line_count) &&
+            GetValue(file, &inline_count);
+  if (ok) {
+    func->lines.resize(line_count);
+    for (uint64_t i = 0; ok && i < line_count; i++)
+      ok = GetValue(file, &func->lines[i]);
+    func->inlines.resize(inline_count);
+    for (uint64_t i = 0; ok && i < inline_count; i++) {
+      Module::Inline *in = &func->inlines[i];
+      uint64_t range_count;
+      ok = GetValue(file, &in->origin) &&
+           GetValue(file, &in->call_site_file) &&
+           GetValue(file, &in->call_site_file_id) &&
+           GetValue(file, &in->call_site_line) &&
+           GetValue(file, &in->nest_level) &&
+           GetValue(file, &range_count);
+      if (ok) {
+        in->ranges.resize(range_count, Module::Range(0, 0));
+        for (uint64_t j = 0; ok && j < range_count; j++)
+          ok = GetValue(file, &in->ranges[j]);
+      }
+    }
+  }
+  if (!ok) {
+    delete func;
+    return NULL;
+  }
+  return func;
+}
+
+bool PutStackFrameEntry(FILE *file, const Module::StackFrameEntry &entry) {
+  if (!PutValue(file, entry.address) ||
+      !PutValue(file, entry.size) ||
+      !PutRuleMap(file, entry.initial_rules) ||
+      !PutValue(file, static_cast<uint64_t>(entry.rule_changes.size())))
+    return false;
+  for (Module::RuleChangeMap::const_iterator it = entry.rule_changes.begin();
+       it != entry.rule_changes.end(); ++it) {
+    if (!PutValue(file, it->first) || !PutRuleMap(file, it->second))
+      return false;
+  }
+  return true;
+}
+
+// Read a CFI entry written by PutStackFrameEntry from FILE into ENTRY.
+// Return false at the end of the file or if an error occurs.
+bool GetStackFrameEntry(FILE *file, Module::StackFrameEntry *entry) {
+  uint64_t change_count;
+  if (!GetValue(file, &entry->address) ||
+      !GetValue(file, &entry->size) ||
+      !GetRuleMap(file, &entry->initial_rules) ||
+      !GetValue(file, &change_count))
+    return false;
+  for (uint64_t i = 0; i < change_count; i++) {
+    Module::Address address;
+    if (!GetValue(file, &address) ||
+        !GetRuleMap(file, &entry->rule_changes[address]))
+      return false;
+  }
+  return true;
+}
+
+// Return an estimate of the memory FUNC uses, including its set node.
+size_t FunctionMemory(const Module::Function &func) {
+  size_t memory = sizeof(func) + 4 * sizeof(void *) + func.name.capacity() +
+                  func.lines.capacity() * sizeof(Module::Line) +
+                  func.inlines.capacity() * sizeof(Module::Inline);
+  for (size_t i = 0; i < func.inlines.size(); i++)
+    memory += func.inlines[i].ranges.capacity() * sizeof(Module::Range);
+  return memory;
+}
+
+}  // namespace
+
+// Reads the module's functions back in the order Write prints them: a
+// k-way merge of the runs in function_runs_ and the functions still in
+// functions_. Where runs hold functions with the same address and name,
+// only the one from the earliest run is kept, as AddFunction would have.
+class Module::FunctionMerger {
+ public:
+  explicit FunctionMerger(Module *module)
+      : module_(module),
+        heads_(module->function_runs_.size() + 1),
+        resident_(module->functions_.begin()),
+        returned_(NULL),
+        failed_(false) {
+    for (size_t i = 0; i < module_->function_runs_.size(); i++) {
+      rewind(module_->function_runs_[i]);
+      Advance(i);
+    }
+    Advance(heads_.size() - 1);
+  }
+
+  ~FunctionMerger() {
+    DeleteIfSpilled(returned_);
+    for (size_t i = 0; i < heads_.size(); i++)
+      DeleteIfSpilled(heads_[i]);
+  }
+
+  // Return the next function, or NULL once all have been returned. The
+  // function is valid until the next call.
+  const Function *Next() {
+    DeleteIfSpilled(returned_);
+    returned_ = NULL;
+    size_t next = heads_.size();
+    for (size_t i = 0; i < heads_.size(); i++) {
+      if (heads_[i] &&
+          (next == heads_.size() || FunctionCompare()(heads_[i], heads_[next])))
+        next = i;
+    }
+    if (next == heads_.size())
+      return NULL;
+    returned_ = heads_[next];
+    Advance(next);
+    for (size_t i = next + 1; i < heads_.size(); i++) {
+      if (heads_[i] && !FunctionCompare()(returned_, heads_[i])) {
+        DeleteIfSpilled(heads_[i]);
+        Advance(i);
+      }
+    }
+    return returned_;
+  }
+
+  // Return true if a spilled run could not be read back.
+  bool failed() const { return failed_; }
+
+ private:
+  // Set the head of run I to its next function, or NULL if it has none.
+  void Advance(size_t i) {
+    if (i == heads_.size() - 1) {
+      heads_[i] = resident_ == module_->functions_.end() ? NULL : *resident_++;
+      return;
+    }
+    FILE *run = module_->function_runs_[i];
+    heads_[i] = GetFunction(run);
+    if (!heads_[i] && !feof(run))
+      failed_ = true;
+  }
+
+  // Delete FUNC if it was read back from a run, rather than being one of
+  // the module's own.
+  void DeleteIfSpilled(Function *func) {
+    if (!func)
+      return;
+    FunctionSet::const_iterator it = module_->functions_.find(func);
+    if (it == module_->functions_.end() || *it != func)
+      delete func;
+  }
+
+  Module *module_;
+
+  // The next function from each run, or NULL if the run is exhausted.
+  // The last run is functions_.
+  vector<Function *> heads_;
+
+  // The next function in functions_ after the last run's head.
+  FunctionSet::const_iterator resident_;
+
+  // The function Next last returned.
+  Function *returned_;
+
+  bool failed_;
+};
+
 
 Module::Module(const string &name, const string &os,
                const string &architecture, const string &id,
@@ -56,11 +315,19 @@ Module::Module(const string &name, const string &os,
     architecture_(architecture),
     id_(id),
     code_id_(code_id),
-    load_address_(0) { }
+    load_address_(0),
+    memory_budget_(0),
+    functions_memory_(0),
+    stack_frame_spill_(NULL),
+    stack_frame_spill_failed_(false) { }
 
 Module::~Module() {
   for (FileByNameMap::iterator it = files_.begin(); it != files_.end(); ++it)
     delete it->second;
+  for (InlineOriginByNameMap::iterator it = inline_origins_.begin();
+       it != inline_origins_.end(); ++it) {
+    delete it->second;
+  }
   for (FunctionSet::iterator it = functions_.begin();
        it != functions_.end(); ++it) {
     delete *it;
@@ -71,6 +338,69 @@ Module::~Module() {
   }
   for (ExternSet::iterator it = externs_.begin(); it != externs_.end(); ++it)
     delete *it;
+  for (size_t i = 0; i < function_runs_.size(); i++)
+    fclose(function_runs_[i]);
+  if (stack_frame_spill_)
+    fclose(stack_frame_spill_);
+}
+
+void Module::SetMemoryBudget(size_t budget) {
+  memory_budget_ = budget;
+  if (memory_budget_) {
+    SpillStackFrameEntries();
+    SpillFunctionsIfOverBudget();
+  }
+}
+
+void Module::SpillFunctionsIfOverBudget() {
+  if (!memory_budget_ || functions_memory_ <= memory_budget_)
+    return;
+  FILE *run = tmpfile();
+  bool ok = run != NULL;
+  for (FunctionSet::const_iterator it = functions_.begin();
+       ok && it != functions_.end(); ++it) {
+    ok = PutFunction(run, **it);
+  }
+  if (!ok || fflush(run) != 0) {
+    // Carry on in memory.
+    fprintf(stderr, "warning: couldn't spill functions to a temporary file:"
+            " %s\n", strerror(errno));
+    if (run)
+      fclose(run);
+    memory_budget_ = 0;
+    return;
+  }
+  function_runs_.push_back(run);
+  for (FunctionSet::iterator it = functions_.begin();
+       it != functions_.end(); ++it) {
+    delete *it;
+  }
+  functions_.clear();
+  functions_memory_ = 0;
+}
+
+void Module::SpillStackFrameEntries() {
+  if (!stack_frame_spill_) {
+    stack_frame_spill_ = tmpfile();
+    if (!stack_frame_spill_) {
+      fprintf(stderr, "warning: couldn't create a temporary file for CFI:"
+              " %s\n", strerror(errno));
+      memory_budget_ = 0;
+      return;
+    }
+  }
+  for (size_t i = 0; i < stack_frame_entries_.size(); i++) {
+    // The entries already in the file must stay ahead of this one, so
+    // it can't simply be kept in memory instead; Write reports the loss.
+    if (!stack_frame_spill_failed_ &&
+        !PutStackFrameEntry(stack_frame_spill_, *stack_frame_entries_[i])) {
+      fprintf(stderr, "error spilling CFI to a temporary file: %s\n",
+              strerror(errno));
+      stack_frame_spill_failed_ = true;
+    }
+    delete stack_frame_entries_[i];
+  }
+  stack_frame_entries_.clear();
 }
 
 void Module::SetLoadAddress(Address address) {
@@ -112,6 +442,9 @@ void Module::AddFunction(Function *function) {
     // Free the duplicate that was not inserted because this Module
     // now owns it.
     delete function;
+  } else if (ret.second && memory_budget_) {
+    functions_memory_ += FunctionMemory(*function);
+    SpillFunctionsIfOverBudget();
   }
 }
 
@@ -123,6 +456,8 @@ void Module::AddFunctions(vector<Function *>::iterator begin,
 
 void Module::AddStackFrameEntry(StackFrameEntry *stack_frame_entry) {
   stack_frame_entries_.push_back(stack_frame_entry);
+  if (memory_budget_)
+    SpillStackFrameEntries();
 }
 
 void Module::AddExtern(Extern *ext) {
@@ -155,6 +490,7 @@ Module::File *Module::FindFile(const string &name) {
   // created our file.  lower_bound does the lookup without doing an
   // insertion, and returns a good hint iterator to pass to insert.
   // Our "destiny" is where we belong, whether we're there or not now.
+  std::lock_guard<std::mutex> lock(names_mutex_);
   FileByNameMap::iterator destiny = files_.lower_bound(&name);
   if (destiny == files_.end()
       || *destiny->first != name) {  // Repeated string comparison, boo hoo.
@@ -176,6 +512,18 @@ Module::File *Module::FindExistingFile(const string &name) {
   return (it == files_.end()) ? NULL : it->second;
 }
 
+Module::InlineOrigin *Module::FindInlineOrigin(const string &name) {
+  // See FindFile for why this doesn't simply use operator[].
+  std::lock_guard<std::mutex> lock(names_mutex_);
+  InlineOriginByNameMap::iterator destiny = inline_origins_.lower_bound(&name);
+  if (destiny == inline_origins_.end() || *destiny->first != name) {
+    InlineOrigin *origin = new InlineOrigin(name);
+    destiny = inline_origins_.insert(
+        destiny, InlineOriginByNameMap::value_type(&origin->name, origin));
+  }
+  return destiny->second;
+}
+
 void Module::GetFiles(vector<File *> *vec) {
   vec->clear();
   for (FileByNameMap::iterator it = files_.begin(); it != files_.end(); ++it)
@@ -187,20 +535,30 @@ void Module::GetStackFrameEntries(vector<StackFrameEntry *> *vec) const {
 }
 
 void Module::AssignSourceIds() {
-  // First, give every source file an id of -1.
+  // First, give every source file and inline origin an id of -1.
   for (FileByNameMap::iterator file_it = files_.begin();
        file_it != files_.end(); ++file_it) {
     file_it->second->source_id = -1;
   }
+  for (InlineOriginByNameMap::iterator origin_it = inline_origins_.begin();
+       origin_it != inline_origins_.end(); ++origin_it) {
+    origin_it->second->id = -1;
+  }
 
   // Next, mark all files actually cited by our functions' line number
-  // info, by setting each one's source id to zero.
-  for (FunctionSet::const_iterator func_it = functions_.begin();
-       func_it != functions_.end(); ++func_it) {
-    Function *func = *func_it;
-    for (vector<Line>::iterator line_it = func->lines.begin();
+  // info or inline call sites, and all origins of those inlines, by
+  // setting each one's id to zero.
+  FunctionMerger merger(this);
+  while (const Function *func = merger.Next()) {
+    for (vector<Line>::const_iterator line_it = func->lines.begin();
          line_it != func->lines.end(); ++line_it)
       line_it->file->source_id = 0;
+    for (vector<Inline>::const_iterator inline_it = func->inlines.begin();
+         inline_it != func->inlines.end(); ++inline_it) {
+      inline_it->origin->id = 0;
+      if (inline_it->call_site_file)
+        inline_it->call_site_file->source_id = 0;
+    }
   }
 
   // Finally, assign source ids to those files that have been marked.
@@ -213,6 +571,12 @@ void Module::AssignSourceIds() {
     if (!file_it->second->source_id)
       file_it->second->source_id = next_source_id++;
   }
+  int next_origin_id = 0;
+  for (InlineOriginByNameMap::iterator origin_it = inline_origins_.begin();
+       origin_it != inline_origins_.end(); ++origin_it) {
+    if (!origin_it->second->id)
+      origin_it->second->id = next_origin_id++;
+  }
 }
 
 bool Module::ReportError() {
@@ -231,6 +595,71 @@ bool Module::WriteRuleMap(const RuleMap &rule_map, std::ostream &stream) {
   return stream.good();
 }
 
+bool Module::WriteFunction(const Function &func, std::ostream &stream) {
+  stream << "FUNC " << hex
+         << (func.address - load_address_) << " "
+         << func.size << " "
+         << func.parameter_size << " "
+         << func.name << dec << endl;
+  if (!stream.good())
+    return false;
+
+  for (vector<Inline>::const_iterator inline_it = func.inlines.begin();
+       inline_it != func.inlines.end(); ++inline_it) {
+    stream << "INLINE " << inline_it->nest_level << " "
+           << inline_it->call_site_line << " "
+           << (inline_it->call_site_file ?
+               inline_it->call_site_file->source_id : -1) << " "
+           << inline_it->origin->id << hex;
+    for (vector<Range>::const_iterator range_it = inline_it->ranges.begin();
+         range_it != inline_it->ranges.end(); ++range_it) {
+      stream << " " << (range_it->address - load_address_)
+             << " " << range_it->size;
+    }
+    stream << dec << endl;
+    if (!stream.good())
+      return false;
+  }
+
+  for (vector<Line>::const_iterator line_it = func.lines.begin();
+       line_it != func.lines.end(); ++line_it) {
+    stream << hex
+           << (line_it->address - load_address_) << " "
+           << line_it->size << " "
+           << dec
+           << line_it->number << " "
+           << line_it->file->source_id << endl;
+    if (!stream.good())
+      return false;
+  }
+  return true;
+}
+
+bool Module::WriteStackFrameEntry(const StackFrameEntry &entry,
+                                  std::ostream &stream) {
+  stream << "STACK CFI INIT " << hex
+         << (entry.address - load_address_) << " "
+         << entry.size << " " << dec;
+  if (!stream.good()
+      || !WriteRuleMap(entry.initial_rules, stream))
+    return false;
+
+  stream << endl;
+
+  // Write out this entry's delta rules as 'STACK CFI' records.
+  for (RuleChangeMap::const_iterator delta_it = entry.rule_changes.begin();
+       delta_it != entry.rule_changes.end(); ++delta_it) {
+    stream << "STACK CFI " << hex
+           << (delta_it->first - load_address_) << " " << dec;
+    if (!stream.good()
+        || !WriteRuleMap(delta_it->second, stream))
+      return false;
+
+    stream << endl;
+  }
+  return stream.good();
+}
+
 bool Module::Write(std::ostream &stream, SymbolData symbol_data) {
   stream << "MODULE " << os_ << " " << architecture_ << " "
          << id_ << " " << name_ << endl;
@@ -255,31 +684,29 @@ bool Module::Write(std::ostream &stream, SymbolData symbol_data) {
       }
     }
 
-    // Write out functions and their lines.
-    for (FunctionSet::const_iterator func_it = functions_.begin();
-         func_it != functions_.end(); ++func_it) {
-      Function *func = *func_it;
-      stream << "FUNC " << hex
-             << (func->address - load_address_) << " "
-             << func->size << " "
-             << func->parameter_size << " "
-             << func->name << dec << endl;
-      if (!stream.good())
-        return ReportError();
-
-      for (vector<Line>::iterator line_it = func->lines.begin();
-           line_it != func->lines.end(); ++line_it) {
-        stream << hex
-               << (line_it->address - load_address_) << " "
-               << line_it->size << " "
-               << dec
-               << line_it->number << " "
-               << line_it->file->source_id << endl;
+    // Write out inline origins.
+    for (InlineOriginByNameMap::iterator origin_it = inline_origins_.begin();
+         origin_it != inline_origins_.end(); ++origin_it) {
+      InlineOrigin *origin = origin_it->second;
+      if (origin->id >= 0) {
+        stream << "INLINE_ORIGIN " << origin->id << " " << origin->name << endl;
         if (!stream.good())
           return ReportError();
       }
     }
 
+    // Write out functions and their lines.
+    FunctionMerger merger(this);
+    while (const Function *func = merger.Next()) {
+      if (!WriteFunction(*func, stream))
+        return ReportError();
+    }
+    if (merger.failed()) {
+      fprintf(stderr, "error reading back functions spilled to a temporary"
+              " file\n");
+      return false;
+    }
+
     // Write out 'PUBLIC' records.
     for (ExternSet::const_iterator extern_it = externs_.begin();
          extern_it != externs_.end(); ++extern_it) {
@@ -291,31 +718,34 @@ bool Module::Write(std::ostream &stream, SymbolData symbol_data) {
   }
 
   if (symbol_data != NO_CFI) {
-    // Write out 'STACK CFI INIT' and 'STACK CFI' records.
+    // Write out 'STACK CFI INIT' and 'STACK CFI' records, first those
+    // spilled to a temporary file, then those still in memory.
+    if (stack_frame_spill_) {
+      if (stack_frame_spill_failed_) {
+        fprintf(stderr, "error writing symbol file: some CFI could not be"
+                " spilled to a temporary file\n");
+        return false;
+      }
+      rewind(stack_frame_spill_);
+      StackFrameEntry entry;
+      while (GetStackFrameEntry(stack_frame_spill_, &entry)) {
+        if (!WriteStackFrameEntry(entry, stream))
+          return ReportError();
+        entry = StackFrameEntry();
+      }
+      if (!feof(stack_frame_spill_)) {
+        fprintf(stderr, "error reading back CFI spilled to a temporary"
+                " file\n");
+        return false;
+      }
+      // Later entries are appended.
+      fseek(stack_frame_spill_, 0, SEEK_END);
+    }
     vector<StackFrameEntry *>::const_iterator frame_it;
     for (frame_it = stack_frame_entries_.begin();
          frame_it != stack_frame_entries_.end(); ++frame_it) {
-      StackFrameEntry *entry = *frame_it;
-      stream << "STACK CFI INIT " << hex
-             << (entry->address - load_address_) << " "
-             << entry->size << " " << dec;
-      if (!stream.good()
-          || !WriteRuleMap(entry->initial_rules, stream))
+      if (!WriteStackFrameEntry(**frame_it, stream))
         return ReportError();
-
-      stream << endl;
-
-      // Write out this entry's delta rules as 'STACK CFI' records.
-      for (RuleChangeMap::const_iterator delta_it = entry->rule_changes.begin();
-           delta_it != entry->rule_changes.end(); ++delta_it) {
-        stream << "STACK CFI " << hex
-               << (delta_it->first - load_address_) << " " << dec;
-        if (!stream.good()
-            || !WriteRuleMap(delta_it->second, stream))
-          return ReportError();
-
-        stream << endl;
-      }
     }
   }
 
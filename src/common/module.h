@@ -38,8 +38,11 @@
 #ifndef COMMON_LINUX_MODULE_H__
 #define COMMON_LINUX_MODULE_H__
 
+#include <stdio.h>
+
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
@@ -66,6 +69,8 @@ class Module {
   struct Function;
   struct Line;
   struct Extern;
+  struct InlineOrigin;
+  struct Inline;
 
   // Addresses appearing in File, Function, and Line structures are
   // absolute, not relative to the the module's load address.  That
@@ -109,6 +114,54 @@ class Module {
     // Source lines belonging to this function, sorted by increasing
     // address.
     vector<Line> lines;
+
+    // Code inlined into this function, each inline following the one
+    // it is inlined into, if any.
+    vector<Inline> inlines;
+  };
+
+  // A range of addresses.
+  struct Range {
+    Range(const Address &address_input, const Address &size_input) :
+        address(address_input), size(size_input) { }
+
+    Address address, size;
+  };
+
+  // A function that has been inlined somewhere.
+  struct InlineOrigin {
+    explicit InlineOrigin(const string &name_input) :
+        name(name_input), id(-1) { }
+
+    // The function's name.
+    const string name;
+
+    // The origin's id.  Like File::source_id, the Write member function
+    // assigns these afresh.
+    int id;
+  };
+
+  // A copy of an inlined function's code within another function.
+  struct Inline {
+    Inline() : origin(NULL), call_site_file(NULL), call_site_file_id(0),
+               call_site_line(0), nest_level(0) { }
+
+    // The function whose code this is.
+    InlineOrigin *origin;
+
+    // The code's address ranges; an inline need not be contiguous.
+    vector<Range> ranges;
+
+    // The source file and line of the call that was inlined, or NULL
+    // and zero if unknown.  The file is given by its number in the
+    // DWARF line number program until that has been read.
+    File *call_site_file;
+    uint64_t call_site_file_id;
+    int call_site_line;
+
+    // Zero for code inlined directly into the function, one for code
+    // inlined into that, and so on.
+    int nest_level;
   };
 
   // A source line.
@@ -196,6 +249,16 @@ class Module {
   // Write is used.
   void SetLoadAddress(Address load_address);
 
+  // Keep no more than about BUDGET bytes of functions in memory, and no
+  // STACK CFI entries at all: write CFI entries to a temporary file as
+  // they are added, and whenever the functions outgrow BUDGET, move them
+  // to a temporary file of their own, sorted. Write merges the files
+  // back in, so the symbol file is the same whatever the budget. Only
+  // functions and CFI entries still in memory are visible to
+  // GetFunctions and GetStackFrameEntries. A BUDGET of zero, the
+  // default, keeps everything in memory.
+  void SetMemoryBudget(size_t budget);
+
   // Add FUNCTION to the module. FUNCTION's name must not be empty.
   // This module owns all Function objects added with this function:
   // destroying the module destroys them as well.
@@ -220,7 +283,8 @@ class Module {
   // If this module has a file named NAME, return a pointer to it. If
   // it has none, then create one and return a pointer to the new
   // file. This module owns all File objects created using these
-  // functions; destroying the module destroys them as well.
+  // functions; destroying the module destroys them as well. FindFile
+  // and FindInlineOrigin may be called from several threads at once.
   File *FindFile(const string &name);
   File *FindFile(const char *name);
 
@@ -228,6 +292,12 @@ class Module {
   // Otherwise, return NULL.
   File *FindExistingFile(const string &name);
 
+  // If this module has an inline origin named NAME, return a pointer to
+  // it. If it has none, then create one and return a pointer to the new
+  // origin. This module owns all InlineOrigin objects; destroying the
+  // module destroys them as well.
+  InlineOrigin *FindInlineOrigin(const string &name);
+
   // Insert pointers to the functions added to this module at I in
   // VEC. The pointed-to Functions are still owned by this module.
   // (Since this is effectively a copy of the function list, this is
@@ -257,10 +327,11 @@ class Module {
   void GetStackFrameEntries(vector<StackFrameEntry *> *vec) const;
 
   // Find those files in this module that are actually referred to by
-  // functions' line number data, and assign them source id numbers.
-  // Set the source id numbers for all other files --- unused by the
-  // source line data --- to -1.  We do this before writing out the
-  // symbol file, at which point we omit any unused files.
+  // functions' line number data or inlines' call sites, and assign them
+  // source id numbers. Set the source id numbers for all other files
+  // --- unused by the source line data --- to -1.  Number the inline
+  // origins the same way.  We do this before writing out the symbol
+  // file, at which point we omit any unused files and origins.
   void AssignSourceIds();
 
   // Call AssignSourceIds, and write this module to STREAM in the
@@ -269,7 +340,9 @@ class Module {
   // - a header based on the values given to the constructor,
   // If symbol_data is not ONLY_CFI then:
   // - the source files added via FindFile,
-  // - the functions added via AddFunctions, each with its lines,
+  // - the inline origins added via FindInlineOrigin,
+  // - the functions added via AddFunctions, each with its inlines and
+  //   lines,
   // - all public records,
   // If symbol_data is not NO_CFI then:
   // - all CFI records.
@@ -293,6 +366,28 @@ class Module {
   // if an error occurs, return false, and leave errno set.
   static bool WriteRuleMap(const RuleMap &rule_map, std::ostream &stream);
 
+  // Write FUNC, with its inlines and lines, to STREAM. Return true if
+  // all goes well; if an error occurs, return false, and leave errno set.
+  bool WriteFunction(const Function &func, std::ostream &stream);
+
+  // Write ENTRY to STREAM as a 'STACK CFI INIT' record followed by
+  // 'STACK CFI' records. Return true if all goes well; if an error
+  // occurs, return false, and leave errno set.
+  bool WriteStackFrameEntry(const StackFrameEntry &entry,
+                            std::ostream &stream);
+
+  // If the functions in functions_ have outgrown memory_budget_, move
+  // them to a new temporary file in function_runs_.
+  void SpillFunctionsIfOverBudget();
+
+  // Move the entries in stack_frame_entries_ to stack_frame_spill_,
+  // creating it if need be.
+  void SpillStackFrameEntries();
+
+  // Reads back the module's functions in address order, merging the
+  // runs in function_runs_ with functions_. Defined in module.cc.
+  class FunctionMerger;
+
   // Module header entries.
   string name_, os_, architecture_, id_, code_id_;
 
@@ -311,6 +406,11 @@ class Module {
   // pointers to the Files' names.
   typedef map<const string *, File *, CompareStringPtrs> FileByNameMap;
 
+  // A map from function names to InlineOrigin structures, keyed the
+  // same way.
+  typedef map<const string *, InlineOrigin *, CompareStringPtrs>
+      InlineOriginByNameMap;
+
   // A set containing Function structures, sorted by address.
   typedef set<Function *, FunctionCompare> FunctionSet;
 
@@ -322,11 +422,35 @@ class Module {
   // point to.
   FileByNameMap files_;    // This module's source files.
   FunctionSet functions_;  // This module's functions.
+  InlineOriginByNameMap inline_origins_;  // Functions inlined into them.
+
+  // Serializes FindFile and FindInlineOrigin, for threads reading
+  // separate compilation units into the module.
+  std::mutex names_mutex_;
 
   // The module owns all the call frame info entries that have been
   // added to it.
   vector<StackFrameEntry *> stack_frame_entries_;
 
+  // The most memory to use for functions before spilling them, as set by
+  // SetMemoryBudget, or zero for no limit.
+  size_t memory_budget_;
+
+  // An estimate of the memory used by the functions in functions_.
+  size_t functions_memory_;
+
+  // Temporary files holding the functions moved out of functions_, in
+  // the order they were moved. Each holds one run of functions, sorted
+  // the same way as functions_.
+  vector<FILE *> function_runs_;
+
+  // A temporary file holding the CFI entries added since a memory budget
+  // was set, in the order they were added, or NULL.
+  FILE *stack_frame_spill_;
+
+  // True if a CFI entry could not be written to stack_frame_spill_.
+  bool stack_frame_spill_failed_;
+
   // The module owns all the externs that have been added to it;
   // destroying the module frees the Externs these point to.
   ExternSet externs_;
@@ -215,6 +215,54 @@ TEST(Write, OmitUnusedFiles) {
                contents.c_str());
 }
 
+TEST(Write, Inlines) {
+  Module m(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
+  m.SetLoadAddress(0x1000);
+
+  Module::File *file1 = m.FindFile("filename1");
+  Module::File *file2 = m.FindFile("filename2");
+  m.FindInlineOrigin("unused");  // not inlined anywhere
+  Module::InlineOrigin *origin1 = m.FindInlineOrigin("origin1");
+  Module::InlineOrigin *origin2 = m.FindInlineOrigin("origin2");
+  EXPECT_EQ(origin1, m.FindInlineOrigin("origin1"));
+
+  Module::Function *function = new Module::Function("function_name", 0x2000);
+  function->size = 0x100;
+  Module::Line line = { 0x2000, 0x100, file1, 67519080 };
+  function->lines.push_back(line);
+
+  // origin2 is inlined into origin1, which is inlined in two pieces
+  // into the function, called from a line of filename2.
+  Module::Inline inline1;
+  inline1.origin = origin1;
+  inline1.ranges.push_back(Module::Range(0x2010, 0x30));
+  inline1.ranges.push_back(Module::Range(0x2080, 0x10));
+  inline1.call_site_file = file2;
+  inline1.call_site_line = 41;
+  function->inlines.push_back(inline1);
+  Module::Inline inline2;
+  inline2.origin = origin2;
+  inline2.ranges.push_back(Module::Range(0x2020, 0x8));
+  inline2.call_site_line = 42;
+  inline2.nest_level = 1;
+  function->inlines.push_back(inline2);
+  m.AddFunction(function);
+
+  stringstream s;
+  m.Write(s, ALL_SYMBOL_DATA);
+  string contents = s.str();
+  EXPECT_STREQ("MODULE os-name architecture id-string name with spaces\n"
+               "FILE 0 filename1\n"
+               "FILE 1 filename2\n"
+               "INLINE_ORIGIN 0 origin1\n"
+               "INLINE_ORIGIN 1 origin2\n"
+               "FUNC 1000 100 0 function_name\n"
+               "INLINE 0 41 1 0 1010 30 1080 10\n"
+               "INLINE 1 42 -1 1 1020 8\n"
+               "1000 100 67519080 0\n",
+               contents.c_str());
+}
+
 TEST(Write, NoCFI) {
   stringstream s;
   Module m(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
@@ -555,3 +603,94 @@ TEST(Construct, FunctionsAndThumbExternsWithSameAddress) {
                "PUBLIC cc00 0 arm_func\n",
                contents.c_str());
 }
+
+// Add functions, some of them duplicates, and CFI entries to M.
+static void PopulateForSpilling(Module *m) {
+  Module::File *file_a = m->FindFile("file-a.cc");
+  Module::File *file_b = m->FindFile("file-b.cc");
+  Module::File *file_c = m->FindFile("file-c.cc");
+  Module::InlineOrigin *origin = m->FindInlineOrigin("inlined_function");
+  for (int i = 0; i < 20; i++) {
+    // Add the functions out of address order.
+    Module::Address address = 0x1000 + ((i * 7) % 20) * 0x100;
+    Module::Function *function = new Module::Function(
+        i % 3 ? "function" : "other_function", address);
+    function->size = 0x80;
+    Module::Line line = { address, 0x10, i % 2 ? file_a : file_b, i + 1 };
+    function->lines.push_back(line);
+    Module::Inline in;
+    in.origin = origin;
+    in.ranges.push_back(Module::Range(address + 0x10, 0x8));
+    in.call_site_file = file_a;
+    in.call_site_line = 100 + i;
+    function->inlines.push_back(in);
+    m->AddFunction(function);
+  }
+
+  // A duplicate of a function added earlier, whose line cites a file
+  // nothing else does. The first function added should win.
+  Module::Function *duplicate = new Module::Function("other_function",
+                                                     0x1000);
+  duplicate->size = 0x40;
+  Module::Line line = { 0x1000, 0x10, file_c, 7 };
+  duplicate->lines.push_back(line);
+  m->AddFunction(duplicate);
+
+  for (int i = 0; i < 5; i++) {
+    Module::StackFrameEntry *entry = new Module::StackFrameEntry();
+    entry->address = 0x3000 - i * 0x100;
+    entry->size = 0x100;
+    entry->initial_rules[".cfa"] = "$sp 8 +";
+    entry->rule_changes[entry->address + 4][".ra"] = ".cfa -8 + ^";
+    m->AddStackFrameEntry(entry);
+  }
+}
+
+TEST(Write, MemoryBudget) {
+  Module in_memory(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
+  PopulateForSpilling(&in_memory);
+  in_memory.SetLoadAddress(0x800);
+  stringstream expected;
+  ASSERT_TRUE(in_memory.Write(expected, ALL_SYMBOL_DATA));
+  EXPECT_EQ(string::npos, expected.str().find("file-c.cc"));
+
+  // A budget too small for even one function spills each function as it
+  // is added.
+  Module spilled(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
+  spilled.SetMemoryBudget(1);
+  PopulateForSpilling(&spilled);
+  spilled.SetLoadAddress(0x800);
+  vector<Module::Function *> functions;
+  spilled.GetFunctions(&functions, functions.end());
+  EXPECT_TRUE(functions.empty());
+  vector<Module::StackFrameEntry *> entries;
+  spilled.GetStackFrameEntries(&entries);
+  EXPECT_TRUE(entries.empty());
+
+  stringstream s;
+  ASSERT_TRUE(spilled.Write(s, ALL_SYMBOL_DATA));
+  EXPECT_EQ(expected.str(), s.str());
+
+  // Writing again reads the spilled data again.
+  stringstream again;
+  ASSERT_TRUE(spilled.Write(again, ALL_SYMBOL_DATA));
+  EXPECT_EQ(expected.str(), again.str());
+}
+
+TEST(Write, MemoryBudgetSetLate) {
+  Module in_memory(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
+  PopulateForSpilling(&in_memory);
+  PopulateForSpilling(&in_memory);
+  stringstream expected;
+  ASSERT_TRUE(in_memory.Write(expected, ALL_SYMBOL_DATA));
+
+  // Data added before the budget is set is spilled along with the rest,
+  // and a budget that holds a few functions spills several at a time.
+  Module spilled(MODULE_NAME, MODULE_OS, MODULE_ARCH, MODULE_ID);
+  PopulateForSpilling(&spilled);
+  spilled.SetMemoryBudget(1000);
+  PopulateForSpilling(&spilled);
+  stringstream s;
+  ASSERT_TRUE(spilled.Write(s, ALL_SYMBOL_DATA));
+  EXPECT_EQ(expected.str(), s.str());
+}
@@ -40,6 +40,8 @@
 
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/using_std_string.h"
 #include "google_breakpad/processor/source_line_resolver_base.h"
@@ -60,9 +62,19 @@ class BasicSourceLineResolver : public SourceLineResolverBase {
   using SourceLineResolverBase::UnloadModule;
   using SourceLineResolverBase::HasModule;
   using SourceLineResolverBase::IsModuleCorrupt;
+  using SourceLineResolverBase::GetModuleMemoryUsage;
+  using SourceLineResolverBase::FillInlinedFrames;
   using SourceLineResolverBase::FillSourceLineInfo;
+  using SourceLineResolverBase::LookupAddresses;
   using SourceLineResolverBase::FindWindowsFrameInfo;
   using SourceLineResolverBase::FindCFIFrameInfo;
+  using SourceLineResolverBase::IsThreadSafe;
+
+  // Parses symbol files of more than a few hundred kilobytes on up to
+  // |threads| threads at once; 0 uses one thread per processor.  The
+  // default, 1, parses them on the loading thread alone.  Modules load the
+  // same either way.  Set it before loading any module.
+  void set_load_threads(unsigned int threads) { load_threads_ = threads; }
 
  private:
   // friend declarations:
@@ -76,6 +88,9 @@ class BasicSourceLineResolver : public SourceLineResolverBase {
   // Module implements SourceLineResolverBase::Module interface.
   class Module;
 
+  // The number of threads to parse a symbol file on, see set_load_threads.
+  unsigned int load_threads_;
+
   // Disallow unwanted copy ctor and assignment operator
   BasicSourceLineResolver(const BasicSourceLineResolver&);
   void operator=(const BasicSourceLineResolver&);
@@ -94,6 +109,31 @@ class SymbolParseHelper {
                         long *index,       // out
                         char **filename);  // out
 
+  // Parses an |inline_origin_line| declaration.  Returns true on success.
+  // Format: INLINE_ORIGIN <id> <name>.
+  // Notice, that this method modifies the input |inline_origin_line|.  On
+  // success, <id> and <name> are stored in |*origin_id| and |*name|.  No
+  // allocation is done, |*name| simply points inside |inline_origin_line|.
+  static bool ParseInlineOrigin(char *inline_origin_line,  // in
+                                long *origin_id,           // out
+                                char **name);              // out
+
+  // Parses an |inline_line| declaration.  Returns true on success.
+  // Format: INLINE <nest_level> <call_site_line> <call_site_file_id>
+  //         <origin_id> <address> <size> [<address> <size> ...]
+  // Notice, that this method modifies the input |inline_line|.  On
+  // success, the numbers are stored in |*nest_level|, |*call_site_line|,
+  // |*call_site_file_id| and |*origin_id|, and the address and size of
+  // each range in |*ranges|.  A <call_site_file_id> of -1 means the file
+  // is unknown.
+  static bool ParseInline(
+      char *inline_line,                                         // in
+      long *nest_level,                                          // out
+      long *call_site_line,                                      // out
+      long *call_site_file_id,                                   // out
+      long *origin_id,                                           // out
+      std::vector<std::pair<uint64_t, uint64_t> > *ranges);      // out
+
   // Parses a |function_line| declaration.  Returns true on success.
   // Format:  FUNC [<multiple>] <address> <size> <stack_param_size> <name>.
   // Notice, that this method modifies the input |function_line| which is why it
@@ -59,14 +59,18 @@ class FastSourceLineResolver : public SourceLineResolverBase {
   FastSourceLineResolver();
   virtual ~FastSourceLineResolver() { }
 
+  using SourceLineResolverBase::FillInlinedFrames;
   using SourceLineResolverBase::FillSourceLineInfo;
   using SourceLineResolverBase::FindCFIFrameInfo;
   using SourceLineResolverBase::FindWindowsFrameInfo;
+  using SourceLineResolverBase::GetModuleMemoryUsage;
   using SourceLineResolverBase::HasModule;
   using SourceLineResolverBase::IsModuleCorrupt;
+  using SourceLineResolverBase::IsThreadSafe;
   using SourceLineResolverBase::LoadModule;
   using SourceLineResolverBase::LoadModuleUsingMapBuffer;
   using SourceLineResolverBase::LoadModuleUsingMemoryBuffer;
+  using SourceLineResolverBase::LookupAddresses;
   using SourceLineResolverBase::UnloadModule;
 
  private:
@@ -87,6 +87,7 @@
 
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -541,12 +542,24 @@ class MinidumpModuleList : public MinidumpStream,
 
   bool Read(uint32_t expected_size);
 
+  // Fills range_map_ from modules_ on the first lookup by address or
+  // sequence, rather than in Read, as many users of a module list never
+  // look modules up that way.  Safe to call from several threads at once.
+  // Returns false if the modules could not all be stored, because they
+  // overlap, in which case range_map_ is left empty and lookups fall back
+  // to scanning modules_.
+  bool BuildRangeMap() const;
+
   // The largest number of modules that will be read from a minidump.  The
   // default is 1024.
   static uint32_t max_modules_;
 
-  // Access to modules using addresses as the key.
+  // Access to modules using addresses as the key.  Built lazily by
+  // BuildRangeMap, under range_map_lock_.
   RangeMap<uint64_t, unsigned int> *range_map_;
+  mutable bool range_map_built_;
+  mutable bool range_map_usable_;
+  mutable std::mutex range_map_lock_;
 
   MinidumpModules *modules_;
   uint32_t module_count_;
@@ -598,12 +611,21 @@ class MinidumpMemoryList : public MinidumpStream {
 
   bool Read(uint32_t expected_size) override;
 
+  // Fills range_map_ from descriptors_ on the first call to
+  // GetMemoryRegionForAddress.  Safe to call from several threads at once.
+  // Returns false if the regions could not all be stored, in which case
+  // range_map_ is left empty.
+  bool BuildRangeMap();
+
   // The largest number of memory regions that will be read from a minidump.
   // The default is 256.
   static uint32_t max_regions_;
 
-  // Access to memory regions using addresses as the key.
+  // Access to memory regions using addresses as the key.  Built lazily by
+  // BuildRangeMap, under range_map_lock_.
   RangeMap<uint64_t, unsigned int> *range_map_;
+  bool range_map_built_;
+  std::mutex range_map_lock_;
 
   // The list of descriptors.  This is maintained separately from the list
   // of regions, because MemoryRegion doesn't own its MemoryDescriptor, it
@@ -1138,7 +1160,9 @@ class MinidumpCrashpadInfo : public MinidumpStream {
 // and provides access to the minidump's top-level stream directory.
 class Minidump {
  public:
-  // path is the pathname of a file containing the minidump.
+  // path is the pathname of a file containing the minidump.  Where mmap is
+  // available, the file is mapped into memory, and memory regions are read
+  // in place rather than copied out of the file (see MapBytes).
   explicit Minidump(const string& path,
                     bool hexdump=false,
                     unsigned int hexdump_width=16);
@@ -1223,6 +1247,12 @@ class Minidump {
   // Returns the current position of the minidump file.
   off_t Tell();
 
+  // Returns a pointer to the count bytes at offset in the minidump, which
+  // remain valid as long as the Minidump object is, if the minidump file
+  // is memory-mapped.  Returns NULL if it is not, or if the bytes are not
+  // all within the file.  The file position is not changed.
+  const uint8_t* MapBytes(off_t offset, size_t count) const;
+
   // Medium-level I/O routines.
 
   // ReadString returns a string which is owned by the caller!  offset
@@ -1286,6 +1316,10 @@ class Minidump {
   // Opens the minidump file, or if already open, seeks to the beginning.
   bool Open();
 
+  // Maps the file at path_ into memory.  Returns false if it cannot be
+  // mapped, in which case it is read through stream_.
+  bool MapFile();
+
   // The largest number of top-level streams that will be read from a minidump.
   // Note that streams are only read (and only consume memory) as needed,
   // when directed by the caller.  The default is 128.
@@ -1313,6 +1347,13 @@ class Minidump {
   // Set based on the path in Open, or directly in the constructor.
   std::istream*             stream_;
 
+  // The contents of the file at path_ when it could be memory-mapped, in
+  // which case stream_ is not used, and ReadBytes and SeekSet work on
+  // mapped_position_ instead.
+  const uint8_t*            mapped_data_;
+  size_t                    mapped_size_;
+  off_t                     mapped_position_;
+
   // swap_ is true if the minidump file should be byte-swapped.  If the
   // minidump was produced by a CPU that is other-endian than the CPU
   // processing the minidump, this will be true.  If the two CPUs are
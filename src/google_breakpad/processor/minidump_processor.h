@@ -127,6 +127,15 @@ class MinidumpProcessor {
 
   void set_enable_objdump(bool enabled) { enable_objdump_ = enabled; }
 
+  // Walks the stacks of up to |threads| minidump threads at once.  The
+  // default, 1, walks them one after the other on the calling thread.  The
+  // resulting ProcessState does not depend on it.  With more than one
+  // thread, the StackFrameSymbolizer is called concurrently: a subclass
+  // passed to the constructor must be thread-safe, as the base class is.
+  void set_stackwalk_threads(unsigned int threads) {
+    stackwalk_threads_ = threads ? threads : 1;
+  }
+
  private:
   StackFrameSymbolizer* frame_symbolizer_;
   // Indicate whether resolver_helper_ is owned by this instance.
@@ -140,6 +149,9 @@ class MinidumpProcessor {
   // This flag permits the exploitability scanner to shell out to objdump
   // for purposes of disassembly.
   bool enable_objdump_;
+
+  // The number of threads walking stacks, see set_stackwalk_threads.
+  unsigned int stackwalk_threads_;
 };
 
 }  // namespace google_breakpad
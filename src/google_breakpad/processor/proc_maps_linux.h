@@ -55,6 +55,11 @@ struct MappedMemoryRegion {
 bool ParseProcMaps(const string& input,
                    std::vector<MappedMemoryRegion>* regions);
 
+// Same, for the |input_size| bytes at |input|, which need not be
+// NUL-terminated.
+bool ParseProcMaps(const char* input, size_t input_size,
+                   std::vector<MappedMemoryRegion>* regions);
+
 }  // namespace google_breakpad
 
 #endif  // BASE_DEBUG_PROC_MAPS_LINUX_H_
@@ -36,6 +36,13 @@
 // See "google_breakpad/processor/source_line_resolver_interface.h" for more
 // documentation.
 
+// SourceLineResolverBase is thread-safe: lookups in loaded modules take no
+// lock, and while a module is being loaded, other threads loading it wait
+// for that load rather than parsing the symbols again.  Modules are parsed
+// outside of any lock, so distinct modules load in parallel.  UnloadModule
+// may run during lookups in the module it unloads: it waits for them to
+// finish before deleting the module.
+//
 // Author: Siyang Xie (lambxsy@google.com)
 
 #ifndef GOOGLE_BREAKPAD_PROCESSOR_SOURCE_LINE_RESOLVER_BASE_H__
@@ -44,6 +51,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "google_breakpad/processor/source_line_resolver_interface.h"
 
@@ -84,12 +92,20 @@ class SourceLineResolverBase : public SourceLineResolverInterface {
   virtual void UnloadModule(const CodeModule *module);
   virtual bool HasModule(const CodeModule *module);
   virtual bool IsModuleCorrupt(const CodeModule *module);
+  virtual size_t GetModuleMemoryUsage(const CodeModule *module);
   virtual void FillSourceLineInfo(StackFrame *frame);
+  virtual bool LookupAddresses(const CodeModule *module,
+                               const MemAddr *addresses, size_t count,
+                               SourceLineInfo *infos);
+  virtual void FillInlinedFrames(StackFrame *frame,
+                                 std::vector<StackFrame> *inlined_frames);
   virtual WindowsFrameInfo *FindWindowsFrameInfo(const StackFrame *frame);
   virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame);
+  virtual bool IsThreadSafe();
 
   // Nested structs and classes.
   struct Line;
+  struct Inline;
   struct Function;
   struct PublicSymbol;
   struct CompareString {
@@ -99,7 +115,8 @@ class SourceLineResolverBase : public SourceLineResolverInterface {
   class Module;
   class AutoFileCloser;
 
-  // All of the modules that are loaded.
+  // All of the modules that are loaded.  Lookups go through module_table_
+  // instead, this map is only updated with module_table_'s mutex held.
   typedef map<string, Module*, CompareString> ModuleMap;
   ModuleMap *modules_;
 
@@ -108,6 +125,7 @@ class SourceLineResolverBase : public SourceLineResolverInterface {
   ModuleSet *corrupt_modules_;
 
   // All of heap-allocated buffers that are owned locally by resolver.
+  // Guarded by module_table_'s mutex.
   typedef std::map<string, char*, CompareString> MemoryMap;
   MemoryMap *memory_buffers_;
 
@@ -118,6 +136,26 @@ class SourceLineResolverBase : public SourceLineResolverInterface {
   // ModuleFactory needs to have access to protected type Module.
   friend class ModuleFactory;
 
+  // The index of modules, by code file, that lookups read without
+  // locking.  Defined in source_line_resolver_base.cc.
+  class ModuleTable;
+
+  // Does the work of LoadModuleUsingMemoryBuffer.  If |buffer_kept| is not
+  // NULL and the resolver keeps buffers, |memory_buffer| is recorded in
+  // memory_buffers_ as the module is published, under the same lock, so
+  // that a concurrent UnloadModule frees it along with the module.
+  // *buffer_kept tells whether the resolver now owns |memory_buffer|.
+  bool LoadModuleFromBuffer(const CodeModule *module,
+                            char *memory_buffer,
+                            size_t memory_buffer_size,
+                            bool *buffer_kept);
+
+  // Returns true if the debug identifiers |x| and |y| are the same,
+  // ignoring case and dashes.
+  static bool SameDebugIdentifier(const string &x, const string &y);
+
+  ModuleTable *module_table_;
+
   // Disallow unwanted copy ctor and assignment operator
   SourceLineResolverBase(const SourceLineResolverBase&);
   void operator=(const SourceLineResolverBase&);
@@ -35,6 +35,7 @@
 #define GOOGLE_BREAKPAD_PROCESSOR_SOURCE_LINE_RESOLVER_INTERFACE_H__
 
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
@@ -50,6 +51,25 @@ class SourceLineResolverInterface {
  public:
   typedef uint64_t MemAddr;
 
+  // The source line information for one address: what FillSourceLineInfo
+  // fills in a StackFrame.  The names belong to the resolver's module, and
+  // are valid until it is unloaded.  A name is NULL if nothing covers the
+  // address.
+  struct SourceLineInfo {
+    SourceLineInfo()
+        : function_base(0),
+          function_name(NULL),
+          source_file_name(NULL),
+          source_line(0),
+          source_line_base(0) { }
+
+    MemAddr function_base;
+    const char *function_name;
+    const char *source_file_name;
+    int source_line;
+    MemAddr source_line_base;
+  };
+
   virtual ~SourceLineResolverInterface() {}
 
   // Adds a module to this resolver, returning true on success.
@@ -89,11 +109,42 @@ class SourceLineResolverInterface {
   // Returns true if the module has been loaded and it is corrupt.
   virtual bool IsModuleCorrupt(const CodeModule *module) = 0;
 
+  // Returns roughly the bytes of memory the loaded symbols of |module|
+  // take, not counting a memory buffer the resolver keeps for it (see
+  // ShouldDeleteMemoryBufferAfterLoadModule).  Returns 0 if the module
+  // hasn't been loaded, or the resolver can't tell.
+  virtual size_t GetModuleMemoryUsage(const CodeModule *module) { return 0; }
+
   // Fills in the function_base, function_name, source_file_name,
   // and source_line fields of the StackFrame.  The instruction and
   // module_name fields must already be filled in.
   virtual void FillSourceLineInfo(StackFrame *frame) = 0;
 
+  // Fills in infos[i] with the source line information for addresses[i],
+  // for |count| addresses in |module|, as FillSourceLineInfo would for
+  // frames with those instruction addresses.  The addresses may come in
+  // any order; they are looked up in ascending order, in one pass over
+  // the module's functions and lines, so a batch costs much less than
+  // looking each address up on its own.  Returns false, filling in
+  // nothing, if |module| hasn't been loaded or the resolver can't look up
+  // batches.
+  virtual bool LookupAddresses(const CodeModule *module,
+                               const MemAddr *addresses, size_t count,
+                               SourceLineInfo *infos) {
+    return false;
+  }
+
+  // Expands |frame|, whose source line information FillSourceLineInfo has
+  // filled in, into the functions inlined at its instruction.  Appends a
+  // frame for each inlined function to |inlined_frames|, innermost first,
+  // giving the source position within that function, and moves |frame|'s
+  // source position out to the call of the outermost one; |frame| keeps
+  // the function the code was inlined into.  Changes nothing if no
+  // inlined code covers the instruction, or the resolver has no inline
+  // information.
+  virtual void FillInlinedFrames(StackFrame *frame,
+                                 std::vector<StackFrame> *inlined_frames) { }
+
   // If Windows stack walking information is available covering
   // FRAME's instruction address, return a WindowsFrameInfo structure
   // describing it. If the information is not available, returns NULL.
@@ -107,6 +158,13 @@ class SourceLineResolverInterface {
   // returned CFIFrameInfo object.
   virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame) = 0;
 
+  // Returns true if the methods above may be called from several threads
+  // at once, UnloadModule included: it waits for lookups in the module it
+  // unloads to finish.  What those lookups return that belongs to the
+  // module, like the names in a SourceLineInfo, is still invalid once it
+  // is unloaded.
+  virtual bool IsThreadSafe() { return false; }
+
  protected:
   // SourceLineResolverInterface cannot be instantiated except by subclasses
   SourceLineResolverInterface() {}
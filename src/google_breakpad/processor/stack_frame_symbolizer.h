@@ -51,6 +51,20 @@ struct StackFrame;
 struct SystemInfo;
 struct WindowsFrameInfo;
 
+// A StackFrameSymbolizer may be shared by several threads walking stacks at
+// once (see MinidumpProcessor::set_stackwalk_threads): lookups in modules
+// that are already loaded run concurrently, while symbol loads, and every
+// call to the SymbolSupplier, are serialized.  A module is loaded only once,
+// by the first thread that needs it.  If the resolver is thread-safe (see
+// SourceLineResolverInterface::IsThreadSafe), lookups take no lock, and the
+// resolver may also be shared with other symbolizers.
+//
+// The modules loaded by a symbolizer stay loaded in its resolver unless a
+// symbol cache budget is set (see set_symbol_cache_budget), in which case the
+// least recently or least frequently used ones are unloaded to stay within
+// it.  Lookups then always take a shared lock.  A thread-safe resolver may
+// still be shared: its UnloadModule waits for the lookups other symbolizers
+// are making in the module, which then load it again if they need it.
 class StackFrameSymbolizer {
  public:
   enum SymbolizerResult {
@@ -71,7 +85,7 @@ class StackFrameSymbolizer {
   StackFrameSymbolizer(SymbolSupplier* supplier,
                        SourceLineResolverInterface* resolver);
 
-  virtual ~StackFrameSymbolizer() { }
+  virtual ~StackFrameSymbolizer();
 
   // Encapsulate the step of resolving source line info for a stack frame.
   // "frame" must not be NULL.
@@ -89,7 +103,7 @@ class StackFrameSymbolizer {
   // A typical case is to call Reset() after processing an individual report
   // before start to process next one, in order to reset internal information
   // about missing symbols found so far.
-  virtual void Reset() { no_symbol_modules_.clear(); }
+  virtual void Reset();
 
   // Returns true if there is valid implementation for stack symbolization.
   virtual bool HasImplementation() { return resolver_ && supplier_; }
@@ -97,12 +111,72 @@ class StackFrameSymbolizer {
   SourceLineResolverInterface* resolver() { return resolver_; }
   SymbolSupplier* supplier() { return supplier_; }
 
+  // Bounds the memory the modules this symbolizer keeps loaded take to
+  // |bytes|, 0 meaning no bound, which is the default.  Each module counts
+  // for the memory the resolver reports its symbols take, plus the symbol
+  // data if the resolver keeps it; for a resolver that can't tell, it
+  // counts for the size of the symbol data the supplier returned.  A module
+  // larger than the budget is still loaded, alone.  Must be called before
+  // the symbolizer is first used.
+  void set_symbol_cache_budget(uint64_t bytes);
+
+  // Which modules are unloaded first when the budget is exceeded.
+  enum SymbolCachePolicy {
+    // The module whose symbols were used longest ago.
+    kLeastRecentlyUsed,
+    // The module whose symbols were used for the fewest frames, or of
+    // those, the least recently used.
+    kLeastFrequentlyUsed
+  };
+
+  // Sets the eviction policy, kLeastRecentlyUsed by default.  Must be
+  // called before the symbolizer is first used.
+  void set_symbol_cache_policy(SymbolCachePolicy policy);
+
+  struct CacheStats {
+    // Frames whose module was already loaded.
+    uint64_t hits;
+    // Frames whose module's symbols were requested from the supplier.
+    uint64_t misses;
+    // Modules unloaded to stay within the budget.
+    uint64_t evictions;
+    // Modules loaded by this symbolizer, and the memory they are counted
+    // for against the budget.
+    uint64_t modules;
+    uint64_t bytes;
+  };
+
+  CacheStats GetCacheStats() const;
+
  protected:
   SymbolSupplier* supplier_;
   SourceLineResolverInterface* resolver_;
   // A list of modules known to have symbols missing. This helps avoid
   // repeated lookups for the missing symbols within one minidump.
   std::set<string> no_symbol_modules_;
+
+ private:
+  // The locks behind the thread-safety guarantees above, and the modules
+  // loaded by this symbolizer, defined in stack_frame_symbolizer.cc.
+  class Locks;
+  class Cache;
+
+  // If |frame|'s module is loaded in the resolver, or known to have no
+  // symbols, sets |result| and returns true.  The caller must hold a
+  // shared lock.
+  bool FillFromLoadedModule(StackFrame* frame, SymbolizerResult* result);
+
+  // The locks to hold around calls to the resolver: none if it is
+  // thread-safe and no module is ever unloaded.
+  Locks* ResolverLocks();
+
+  // Records that |module| was loaded and takes |size| bytes, then unloads
+  // other modules, in the order the policy gives, until the budget is met.
+  // The caller must hold the load mutex and an exclusive lock.
+  void AddToCache(const CodeModule* module, size_t size);
+
+  Locks* locks_;
+  Cache* cache_;
 };
 
 }  // namespace google_breakpad
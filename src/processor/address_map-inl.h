@@ -48,14 +48,15 @@ template<typename AddressType, typename EntryType>
 bool AddressMap<AddressType, EntryType>::Store(const AddressType &address,
                                                const EntryType &entry) {
   // Ensure that the specified address doesn't conflict with something already
-  // in the map.
-  if (map_.find(address) != map_.end()) {
+  // in the map.  lower_bound also finds where the entry goes.
+  MapConstIterator iterator = map_.lower_bound(address);
+  if (iterator != map_.end() && iterator->first == address) {
     BPLOG(INFO) << "Store failed, address " << HexString(address) <<
                    " is already present";
     return false;
   }
 
-  map_.insert(MapValue(address, entry));
+  map_.insert(iterator, MapValue(address, entry));
   return true;
 }
 
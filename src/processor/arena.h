@@ -0,0 +1,219 @@
+// Copyright 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// arena.h: Memory for objects that are all destroyed together.
+//
+// An Arena allocates objects from large blocks and destroys them all at
+// once, running the destructors of those that have them in the reverse
+// of the order they were made.  It also keeps a string pool: interning a
+// string copies it into the arena the first time, and returns the same
+// copy every time after that.  The pool's index is only needed while
+// strings are being interned, and FinishInterning frees it.
+//
+// A module's symbols are made as its symbol file is loaded and last until
+// the module is unloaded, so making them in an arena saves a heap
+// allocation, and its overhead, per record, and unloading the module
+// frees a few large blocks.
+//
+// An Arena is not thread-safe.  Arenas filled on separate threads may be
+// merged afterwards with Absorb.
+
+#ifndef PROCESSOR_ARENA_H__
+#define PROCESSOR_ARENA_H__
+
+#include <stddef.h>
+#include <string.h>
+
+#include <new>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace google_breakpad {
+
+class Arena {
+ public:
+  Arena()
+      : blocks_(), block_(NULL), block_used_(0), block_size_(0),
+        finalizers_(), strings_(), allocated_(0) { }
+  ~Arena() { Clear(); }
+
+  // Makes a T in the arena, passing |args| to its constructor.  The
+  // object lasts until the arena is cleared or destroyed.
+  template<typename T, typename... Args>
+  T *New(Args&&... args) {
+    T *object = new(Allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value) {
+      Finalizer finalizer = { &Destroy<T>, object };
+      finalizers_.push_back(finalizer);
+    }
+    return object;
+  }
+
+  // Returns a null-terminated copy in the arena of the |length|
+  // characters at |str|.  Interning the same characters again returns
+  // the same copy.
+  const char *Intern(const char *str, size_t length) {
+    StringKey key = { str, length };
+    StringSet::const_iterator interned = strings_.find(key);
+    if (interned != strings_.end())
+      return interned->str;
+    char *copy = static_cast<char*>(Allocate(length + 1, 1));
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    key.str = copy;
+    strings_.insert(key);
+    return copy;
+  }
+  const char *Intern(const char *str) { return Intern(str, strlen(str)); }
+
+  // Frees the index of the interned strings.  The strings themselves stay
+  // in the arena.  Interning a string after this makes a new copy, even
+  // if it was interned before.
+  void FinishInterning() { StringSet().swap(strings_); }
+
+  // Takes over the objects and strings of |other|, leaving it empty.
+  // The strings are not pooled with this arena's: interning one of them
+  // here makes another copy.
+  void Absorb(Arena *other) {
+    blocks_.insert(blocks_.end(), other->blocks_.begin(),
+                   other->blocks_.end());
+    finalizers_.insert(finalizers_.end(), other->finalizers_.begin(),
+                       other->finalizers_.end());
+    allocated_ += other->allocated_;
+    other->blocks_.clear();
+    other->finalizers_.clear();
+    other->Clear();
+  }
+
+  // Destroys all the objects in the arena and frees its memory.
+  void Clear() {
+    for (size_t i = finalizers_.size(); i > 0; --i)
+      finalizers_[i - 1].destroy(finalizers_[i - 1].object);
+    for (size_t i = 0; i < blocks_.size(); ++i)
+      delete [] blocks_[i];
+    blocks_.clear();
+    block_ = NULL;
+    block_used_ = block_size_ = 0;
+    finalizers_.clear();
+    strings_.clear();
+    allocated_ = 0;
+  }
+
+  // Returns the number of bytes of memory the arena holds.
+  size_t allocated() const { return allocated_; }
+
+ private:
+  // The size of the blocks objects are allocated from.  Objects larger
+  // than a quarter of this get blocks of their own.
+  static const size_t kBlockSize = 64 * 1024;
+
+  struct Finalizer {
+    void (*destroy)(void *object);
+    void *object;
+  };
+
+  // A string in the pool, or one being looked up.
+  struct StringKey {
+    const char *str;
+    size_t length;
+  };
+  struct StringKeyHash {
+    size_t operator()(const StringKey &key) const {
+      // FNV-1a.
+      size_t hash = static_cast<size_t>(14695981039346656037ULL);
+      for (size_t i = 0; i < key.length; ++i) {
+        hash ^= static_cast<unsigned char>(key.str[i]);
+        hash *= static_cast<size_t>(1099511628211ULL);
+      }
+      return hash;
+    }
+  };
+  struct StringKeyEqual {
+    bool operator()(const StringKey &x, const StringKey &y) const {
+      return x.length == y.length && memcmp(x.str, y.str, x.length) == 0;
+    }
+  };
+  typedef std::unordered_set<StringKey, StringKeyHash, StringKeyEqual>
+      StringSet;
+
+  template<typename T>
+  static void Destroy(void *object) { static_cast<T*>(object)->~T(); }
+
+  // Returns |size| bytes of memory aligned to |alignment|, which must be
+  // a power of two no greater than that of the memory new[] returns.
+  void *Allocate(size_t size, size_t alignment) {
+    size_t offset = (block_used_ + alignment - 1) & ~(alignment - 1);
+    if (block_ && offset <= block_size_ && size <= block_size_ - offset) {
+      block_used_ = offset + size;
+      return block_ + offset;
+    }
+    if (size > kBlockSize / 4) {
+      // Leave the current block to the objects that follow.
+      char *block = new char[size];
+      blocks_.push_back(block);
+      allocated_ += size;
+      return block;
+    }
+    block_ = new char[kBlockSize];
+    blocks_.push_back(block_);
+    allocated_ += kBlockSize;
+    block_size_ = kBlockSize;
+    block_used_ = size;
+    return block_;
+  }
+
+  // All the memory the arena holds.
+  std::vector<char*> blocks_;
+
+  // The block being filled, the bytes of it in use, and its size.
+  char *block_;
+  size_t block_used_;
+  size_t block_size_;
+
+  // The objects to destroy, in the order they were made.
+  std::vector<Finalizer> finalizers_;
+
+  // The strings interned in the arena.
+  StringSet strings_;
+
+  // The total size of blocks_.
+  size_t allocated_;
+
+  // Disallow copy constructor and assignment operator.
+  Arena(const Arena&);
+  void operator=(const Arena&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_ARENA_H__
@@ -0,0 +1,166 @@
+// Copyright 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// arena_unittest.cc: Unit tests for Arena.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "processor/arena.h"
+
+namespace {
+
+using google_breakpad::Arena;
+using std::string;
+using std::vector;
+
+// Records its destruction in a list, so the order can be checked.
+class Tracked {
+ public:
+  Tracked(int id, vector<int> *destroyed) : id_(id), destroyed_(destroyed) { }
+  ~Tracked() { destroyed_->push_back(id_); }
+  int id() const { return id_; }
+
+ private:
+  int id_;
+  vector<int> *destroyed_;
+};
+
+struct Plain {
+  Plain(char tag, uint64_t value) : tag(tag), value(value) { }
+  char tag;
+  uint64_t value;
+};
+
+TEST(ArenaTest, Empty) {
+  Arena arena;
+  EXPECT_EQ(0U, arena.allocated());
+}
+
+TEST(ArenaTest, Objects) {
+  Arena arena;
+  vector<Plain*> plains;
+  for (int i = 0; i < 10000; ++i) {
+    Plain *plain = arena.New<Plain>(static_cast<char>(i), i * 3ULL);
+    EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(plain) % alignof(Plain));
+    plains.push_back(plain);
+  }
+  for (int i = 0; i < 10000; ++i) {
+    EXPECT_EQ(static_cast<char>(i), plains[i]->tag);
+    EXPECT_EQ(i * 3ULL, plains[i]->value);
+  }
+  // Many objects share each block.
+  EXPECT_LT(arena.allocated(), 10000 * sizeof(Plain) * 2);
+}
+
+TEST(ArenaTest, Destructors) {
+  vector<int> destroyed;
+  {
+    Arena arena;
+    for (int i = 0; i < 3; ++i)
+      EXPECT_EQ(i, arena.New<Tracked>(i, &destroyed)->id());
+    EXPECT_TRUE(destroyed.empty());
+  }
+  ASSERT_EQ(3U, destroyed.size());
+  EXPECT_EQ(2, destroyed[0]);
+  EXPECT_EQ(1, destroyed[1]);
+  EXPECT_EQ(0, destroyed[2]);
+}
+
+TEST(ArenaTest, LargeObjects) {
+  Arena arena;
+  char *small = arena.New<char>('a');
+  struct Large { char bytes[100000]; };
+  Large *large = arena.New<Large>();
+  memset(large->bytes, 'b', sizeof(large->bytes));
+  // The large object gets its own block, leaving room in the current one.
+  char *after = arena.New<char>('c');
+  EXPECT_EQ(small + 1, after);
+  EXPECT_EQ('a', *small);
+  EXPECT_EQ('c', *after);
+}
+
+TEST(ArenaTest, Intern) {
+  Arena arena;
+  const char *hello = arena.Intern("hello");
+  EXPECT_STREQ("hello", hello);
+  string copy("hello");
+  EXPECT_EQ(hello, arena.Intern(copy.c_str()));
+  EXPECT_EQ(hello, arena.Intern("hello, world", 5));
+  const char *world = arena.Intern("world");
+  EXPECT_NE(hello, world);
+  EXPECT_STREQ("world", world);
+  const char *empty = arena.Intern("");
+  EXPECT_STREQ("", empty);
+  EXPECT_EQ(empty, arena.Intern("", 0));
+}
+
+TEST(ArenaTest, FinishInterning) {
+  Arena arena;
+  const char *name = arena.Intern("name");
+  size_t allocated = arena.allocated();
+  arena.FinishInterning();
+  EXPECT_STREQ("name", name);
+  EXPECT_EQ(allocated, arena.allocated());
+  // Interning again still works, but makes another copy.
+  const char *again = arena.Intern("name");
+  EXPECT_NE(name, again);
+  EXPECT_STREQ("name", again);
+  EXPECT_EQ(again, arena.Intern("name"));
+}
+
+TEST(ArenaTest, Absorb) {
+  vector<int> destroyed;
+  Arena arena;
+  const char *first = arena.Intern("name");
+  {
+    Arena other;
+    other.New<Tracked>(1, &destroyed);
+    const char *name = other.Intern("name");
+    EXPECT_NE(first, name);
+    size_t allocated = arena.allocated() + other.allocated();
+    arena.Absorb(&other);
+    EXPECT_EQ(0U, other.allocated());
+    EXPECT_EQ(allocated, arena.allocated());
+    // The absorbed strings survive the arena they came from.
+    EXPECT_STREQ("name", name);
+  }
+  EXPECT_TRUE(destroyed.empty());
+  EXPECT_EQ(first, arena.Intern("name"));
+  arena.Clear();
+  ASSERT_EQ(1U, destroyed.size());
+  EXPECT_EQ(0U, arena.allocated());
+}
+
+}  // namespace
@@ -104,14 +104,16 @@ unsigned int BasicCodeModules::module_count() const {
 
 const CodeModule* BasicCodeModules::GetModuleForAddress(
     uint64_t address) const {
-  linked_ptr<const CodeModule> module;
+  // Point at the stored linked_ptr rather than copying it: copies are not
+  // safe to make from the several threads walking stacks.
+  const linked_ptr<const CodeModule>* module;
   if (!map_.RetrieveRange(address, &module, NULL /* base */, NULL /* delta */,
                           NULL /* size */)) {
     BPLOG(INFO) << "No module at " << HexString(address);
     return NULL;
   }
 
-  return module.get();
+  return module->get();
 }
 
 const CodeModule* BasicCodeModules::GetMainModule() const {
@@ -120,14 +122,14 @@ const CodeModule* BasicCodeModules::GetMainModule() const {
 
 const CodeModule* BasicCodeModules::GetModuleAtSequence(
     unsigned int sequence) const {
-  linked_ptr<const CodeModule> module;
+  const linked_ptr<const CodeModule>* module;
   if (!map_.RetrieveRangeAtIndex(sequence, &module, NULL /* base */,
                                  NULL /* delta */, NULL /* size */)) {
     BPLOG(ERROR) << "RetrieveRangeAtIndex failed for sequence " << sequence;
     return NULL;
   }
 
-  return module.get();
+  return module->get();
 }
 
 const CodeModule* BasicCodeModules::GetModuleAtIndex(
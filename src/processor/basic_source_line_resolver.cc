@@ -38,13 +38,16 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <limits>
 #include <map>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "google_breakpad/processor/basic_source_line_resolver.h"
 #include "processor/basic_source_line_resolver_types.h"
+#include "processor/binary_symbol_file.h"
 #include "processor/module_factory.h"
 
 #include "processor/tokenize.h"
@@ -96,14 +99,105 @@ bool TokenizeWithOptionalField(char *line,
   return true;
 }
 
+// Returns the start of the first FUNC, PUBLIC or STACK record to follow
+// |position| in a null-terminated buffer, or NULL if there is none.
+char *FindRunStart(char *position) {
+  while ((position = strchr(position, '\n')) != NULL) {
+    ++position;
+    if (strncmp(position, "FUNC ", 5) == 0 ||
+        strncmp(position, "PUBLIC ", 7) == 0 ||
+        strncmp(position, "STACK ", 6) == 0) {
+      return position;
+    }
+  }
+  return NULL;
+}
+
+// Roughly the heap a std::map node holding a |Value| takes: the value,
+// three links and a color, and the allocator's header.
+template<typename Value>
+size_t TreeNodeSize() {
+  return sizeof(Value) + 6 * sizeof(void*);
+}
+
 }  // namespace
 
 static const char *kWhitespace = " \r\n";
 static const int kMaxErrorsPrinted = 5;
 static const int kMaxErrorsBeforeBailing = 100;
 
+// The least symbol data worth parsing on a thread of its own.
+static const size_t kMinLoadRunSize = 256 * 1024;
+
+struct BasicSourceLineResolver::Module::Record {
+  enum Type {
+    RECORD_NONE,
+    RECORD_ERROR,               // |text| describes the error.
+    RECORD_FILE,                // File |index| is named |text|.
+    RECORD_INLINE_ORIGIN,       // Inline origin |index| is named |text|.
+    RECORD_FUNCTION,            // |function|, holding its line records.
+    RECORD_INLINE,              // |inline_record|, or NULL if unparsable.
+    RECORD_LINE,                // |line|, or NULL if it failed to parse.
+    RECORD_PUBLIC,              // |public_symbol|.
+    RECORD_WINDOWS_FRAME_INFO,  // |windows_frame_info| of type |index|.
+    RECORD_CFI_INITIAL_RULES,   // Rules |text|, at |address| for |size|.
+    RECORD_CFI_DELTA_RULES      // Rules |text|, from |address|.
+  };
+
+  Record()
+      : type(RECORD_NONE), line_number(0), index(0), address(0), size(0),
+        text(NULL), function(NULL), inline_record(NULL), line(NULL),
+        public_symbol(NULL), windows_frame_info(NULL) { }
+
+  void SetError(const char *message) {
+    type = RECORD_ERROR;
+    text = message;
+  }
+
+  Type type;
+
+  // The record's line, counting from the start of its run.
+  int line_number;
+
+  long index;
+  MemAddr address;
+  MemAddr size;
+  const char *text;
+
+  // Symbols in the run's arena.
+  Function *function;
+  Inline *inline_record;
+  Line *line;
+  PublicSymbol *public_symbol;
+  WindowsFrameInfo *windows_frame_info;
+};
+
+struct BasicSourceLineResolver::Module::RecordRun {
+  RecordRun()
+      : records(), arena(), line_count(0), ends_without_function(false) { }
+
+  vector<Record> records;
+
+  // The functions, lines, inlines, public symbols and Windows frame info
+  // of the run, and their names.
+  Arena arena;
+
+  // The number of lines in the run.
+  int line_count;
+
+  // True if line records following the run belong to no function: its
+  // last FUNC or PUBLIC record is a PUBLIC record, or failed to parse.
+  bool ends_without_function;
+
+ private:
+  // Disallow unwanted copy ctor and assignment operator
+  RecordRun(const RecordRun&);
+  void operator=(const RecordRun&);
+};
+
 BasicSourceLineResolver::BasicSourceLineResolver() :
-    SourceLineResolverBase(new BasicModuleFactory) { }
+    SourceLineResolverBase(new BasicModuleFactory(this)),
+    load_threads_(1) { }
 
 // static
 void BasicSourceLineResolver::Module::LogParseError(
@@ -122,10 +216,8 @@ void BasicSourceLineResolver::Module::LogParseError(
 bool BasicSourceLineResolver::Module::LoadMapFromMemory(
     char *memory_buffer,
     size_t memory_buffer_size) {
-  linked_ptr<Function> cur_func;
   int line_number = 0;
   int num_errors = 0;
-  char *save_ptr;
 
   // If the length is 0, we can still pretend we have a symbol file. This is
   // for scenarios that want to test symbol lookup, but don't necessarily care
@@ -134,6 +226,15 @@ bool BasicSourceLineResolver::Module::LoadMapFromMemory(
     return true;
   }
 
+  // Binary symbol files are only used in place, by FastSourceLineResolver;
+  // they may be mapped read-only.
+  if (IsBinarySymbolFile(memory_buffer, memory_buffer_size)) {
+    BPLOG(ERROR) << "Symbols for " << name_ << " are a binary symbol file, "
+                    "which needs FastSourceLineResolver";
+    is_corrupt_ = true;
+    return false;
+  }
+
   // Make sure the last character is null terminator.
   size_t last_null_terminator = memory_buffer_size - 1;
   if (memory_buffer[last_null_terminator] != '\0') {
@@ -160,68 +261,298 @@ bool BasicSourceLineResolver::Module::LoadMapFromMemory(
        &num_errors);
   }
 
-  char *buffer;
-  buffer = strtok_r(memory_buffer, "\r\n", &save_ptr);
+  // Split the symbol data into runs of about the same size, one per
+  // thread, each starting at a FUNC, PUBLIC or STACK record.  Ending a run
+  // with a null terminator in place of its last newline doesn't change how
+  // the lines are split.
+  size_t threads = load_threads_ ? load_threads_
+                                 : std::thread::hardware_concurrency();
+  threads = std::min(threads, last_null_terminator / kMinLoadRunSize);
+  vector<char*> run_starts(1, memory_buffer);
+  for (size_t i = 1; i < threads; ++i) {
+    char *start = FindRunStart(
+        std::max(memory_buffer + last_null_terminator / threads * i,
+                 run_starts.back()));
+    if (!start) {
+      break;
+    }
+    start[-1] = '\0';
+    run_starts.push_back(start);
+  }
+
+  vector<RecordRun> runs(run_starts.size());
+  vector<std::thread> workers;
+  for (size_t i = 1; i < runs.size(); ++i) {
+    workers.push_back(std::thread(&Module::ParseRecords, this, run_starts[i],
+                                  &runs[i]));
+  }
+  ParseRecords(run_starts[0], &runs[0]);
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i].join();
+  }
+
+  Function *cur_func = NULL;
+  for (size_t i = 0; i < runs.size(); ++i) {
+    arena_.Absorb(&runs[i].arena);
+    if (!StoreRecords(&runs[i], &line_number, &cur_func, &num_errors)) {
+      break;
+    }
+  }
+
+  // The module is complete; index its ranges for lookups.
+  functions_.Freeze();
+  Function *func;
+  for (int i = 0; i < functions_.GetCount(); ++i) {
+    if (functions_.RetrieveRangeAtIndex(i, &func, NULL, NULL, NULL)) {
+      func->lines.Freeze();
+      func->inlines.Freeze();
+    }
+  }
+  cfi_initial_rules_.Freeze();
+
+  // Nothing is interned once the module is loaded.
+  arena_.FinishInterning();
+
+  is_corrupt_ = num_errors > 0;
+  return true;
+}
+
+size_t BasicSourceLineResolver::Module::MemoryUsage() const {
+  size_t bytes = sizeof(*this) + arena_.allocated() + heap_bytes_ +
+                 functions_.MemoryUsage() + cfi_initial_rules_.MemoryUsage();
+  Function *func;
+  for (int i = 0; i < functions_.GetCount(); ++i) {
+    if (functions_.RetrieveRangeAtIndex(i, &func, NULL, NULL, NULL))
+      bytes += func->lines.MemoryUsage() + func->inlines.MemoryUsage();
+  }
+  return bytes;
+}
+
+void BasicSourceLineResolver::Module::ParseRecords(char *buffer,
+                                                   RecordRun *run) const {
+  // Whether the run has had a FUNC or PUBLIC record yet, and if so the
+  // function line records belong to.
+  bool have_func = false;
+  Function *cur_func = NULL;
+  int num_errors = 0;
+  char *save_ptr;
 
-  while (buffer != NULL) {
-    ++line_number;
+  for (char *buffer_line = strtok_r(buffer, "\r\n", &save_ptr);
+       buffer_line != NULL;
+       buffer_line = strtok_r(NULL, "\r\n", &save_ptr)) {
+    Record record;
+    record.line_number = ++run->line_count;
 
-    if (strncmp(buffer, "FILE ", 5) == 0) {
-      if (!ParseFile(buffer)) {
-        LogParseError("ParseFile on buffer failed", line_number, &num_errors);
+    if (strncmp(buffer_line, "FILE ", 5) == 0) {
+      if (!ParseFile(buffer_line, &record)) {
+        record.SetError("ParseFile on buffer failed");
       }
-    } else if (strncmp(buffer, "STACK ", 6) == 0) {
-      if (!ParseStackInfo(buffer)) {
-        LogParseError("ParseStackInfo failed", line_number, &num_errors);
+    } else if (strncmp(buffer_line, "INLINE_ORIGIN ", 14) == 0) {
+      if (!ParseInlineOrigin(buffer_line, &record)) {
+        record.SetError("ParseInlineOrigin failed");
       }
-    } else if (strncmp(buffer, "FUNC ", 5) == 0) {
-      cur_func.reset(ParseFunction(buffer));
-      if (!cur_func.get()) {
-        LogParseError("ParseFunction failed", line_number, &num_errors);
+    } else if (strncmp(buffer_line, "STACK ", 6) == 0) {
+      if (!ParseStackInfo(buffer_line, &run->arena, &record)) {
+        record.SetError("ParseStackInfo failed");
+      }
+    } else if (strncmp(buffer_line, "FUNC ", 5) == 0) {
+      have_func = true;
+      cur_func = ParseFunction(buffer_line, &run->arena);
+      if (!cur_func) {
+        record.SetError("ParseFunction failed");
       } else {
-        // StoreRange will fail if the function has an invalid address or size.
-        // We'll silently ignore this, the function and any corresponding lines
-        // will be destroyed when cur_func is released.
-        functions_.StoreRange(cur_func->address, cur_func->size, cur_func);
+        record.type = Record::RECORD_FUNCTION;
+        record.function = cur_func;
       }
-    } else if (strncmp(buffer, "PUBLIC ", 7) == 0) {
+    } else if (strncmp(buffer_line, "PUBLIC ", 7) == 0) {
       // Clear cur_func: public symbols don't contain line number information.
-      cur_func.reset();
+      have_func = true;
+      cur_func = NULL;
 
-      if (!ParsePublicSymbol(buffer)) {
-        LogParseError("ParsePublicSymbol failed", line_number, &num_errors);
+      if (!ParsePublicSymbol(buffer_line, &run->arena, &record)) {
+        record.SetError("ParsePublicSymbol failed");
       }
-    } else if (strncmp(buffer, "MODULE ", 7) == 0) {
+    } else if (strncmp(buffer_line, "MODULE ", 7) == 0) {
       // Ignore these.  They're not of any use to BasicSourceLineResolver,
       // which is fed modules by a SymbolSupplier.  These lines are present to
       // aid other tools in properly placing symbol files so that they can
       // be accessed by a SymbolSupplier.
       //
       // MODULE <guid> <age> <filename>
-    } else if (strncmp(buffer, "INFO ", 5) == 0) {
+    } else if (strncmp(buffer_line, "INFO ", 5) == 0) {
       // Ignore these as well, they're similarly just for housekeeping.
       //
       // INFO CODE_ID <code id> <filename>
+    } else if (strncmp(buffer_line, "INLINE ", 7) == 0) {
+      Inline *inline_record = ParseInline(buffer_line, &run->arena);
+      if (!have_func) {
+        // As with line records, the function may be in an earlier run.
+        record.type = Record::RECORD_INLINE;
+        record.inline_record = inline_record;
+      } else if (!cur_func) {
+        record.SetError("Found inline data without a function");
+      } else if (!inline_record) {
+        record.SetError("ParseInline failed");
+      } else {
+        StoreInline(cur_func, inline_record);
+      }
+    } else if (!have_func) {
+      // The function this line belongs to, if any, is in an earlier run.
+      record.type = Record::RECORD_LINE;
+      record.line = ParseLine(buffer_line, &run->arena);
+    } else if (!cur_func) {
+      record.SetError("Found source line data without a function");
     } else {
-      if (!cur_func.get()) {
-        LogParseError("Found source line data without a function",
-                       line_number, &num_errors);
+      Line *line = ParseLine(buffer_line, &run->arena);
+      if (!line) {
+        record.SetError("ParseLine failed");
       } else {
-        Line *line = ParseLine(buffer);
-        if (!line) {
-          LogParseError("ParseLine failed", line_number, &num_errors);
+        cur_func->lines.StoreRange(line->address, line->size, line);
+      }
+    }
+
+    if (record.type != Record::RECORD_NONE) {
+      run->records.push_back(record);
+    }
+    // StoreRecords gives up after this many errors in a run, if not before.
+    if (record.type == Record::RECORD_ERROR &&
+        ++num_errors > kMaxErrorsBeforeBailing) {
+      break;
+    }
+  }
+  run->ends_without_function = have_func && !cur_func;
+}
+
+bool BasicSourceLineResolver::Module::StoreRecords(
+    RecordRun *run, int *line_number, Function **cur_func,
+    int *num_errors) {
+  for (size_t i = 0; i < run->records.size(); ++i) {
+    Record &record = run->records[i];
+    int record_line_number = *line_number + record.line_number;
+
+    switch (record.type) {
+      case Record::RECORD_NONE:
+        break;
+
+      case Record::RECORD_ERROR:
+        LogParseError(record.text, record_line_number, num_errors);
+        break;
+
+      case Record::RECORD_FILE:
+        files_.insert(files_.end(),
+                      make_pair(static_cast<int>(record.index),
+                                arena_.Intern(record.text)));
+        heap_bytes_ += TreeNodeSize<FileMap::value_type>();
+        break;
+
+      case Record::RECORD_INLINE_ORIGIN:
+        inline_origins_.insert(inline_origins_.end(),
+                               make_pair(static_cast<int>(record.index),
+                                         arena_.Intern(record.text)));
+        heap_bytes_ += TreeNodeSize<InlineOriginMap::value_type>();
+        break;
+
+      case Record::RECORD_FUNCTION:
+        *cur_func = record.function;
+        // StoreRange will fail if the function has an invalid address or size.
+        // We'll silently ignore this; the function and any corresponding lines
+        // stay unreachable in the arena until the module is destroyed.
+        functions_.StoreRange((*cur_func)->address, (*cur_func)->size,
+                              *cur_func);
+        break;
+
+      case Record::RECORD_INLINE:
+        if (!*cur_func) {
+          LogParseError("Found inline data without a function",
+                        record_line_number, num_errors);
+        } else if (!record.inline_record) {
+          LogParseError("ParseInline failed", record_line_number, num_errors);
+        } else {
+          StoreInline(*cur_func, record.inline_record);
+        }
+        break;
+
+      case Record::RECORD_LINE:
+        if (!*cur_func) {
+          LogParseError("Found source line data without a function",
+                        record_line_number, num_errors);
+        } else if (!record.line) {
+          LogParseError("ParseLine failed", record_line_number, num_errors);
+        } else {
+          (*cur_func)->lines.StoreRange(record.line->address,
+                                        record.line->size, record.line);
+        }
+        break;
+
+      case Record::RECORD_PUBLIC:
+        if (!public_symbols_.Store(record.public_symbol->address,
+                                   record.public_symbol)) {
+          LogParseError("ParsePublicSymbol failed", record_line_number,
+                        num_errors);
         } else {
-          cur_func->lines.StoreRange(line->address, line->size,
-                                     linked_ptr<Line>(line));
+          heap_bytes_ += TreeNodeSize<std::pair<MemAddr, PublicSymbol*> >();
         }
+        break;
+
+      case Record::RECORD_WINDOWS_FRAME_INFO:
+        // TODO(mmentovai): I wanted to use StoreRange's return value as this
+        // method's return value, but MSVC infrequently outputs stack info that
+        // violates the containment rules.  This happens with a section of code
+        // in strncpy_s in test_app.cc (testdata/minidump2).  There, problem
+        // looks like this:
+        //   STACK WIN 4 4242 1a a 0 ...  (STACK WIN 4 base size prolog 0 ...)
+        //   STACK WIN 4 4243 2e 9 0 ...
+        // ContainedRangeMap treats these two blocks as conflicting.  In
+        // reality, when the prolog lengths are taken into account, the actual
+        // code of these blocks doesn't conflict.  However, we can't take the
+        // prolog lengths into account directly here because we'd wind up with
+        // a different set of range conflicts when MSVC outputs stack info like
+        // this:
+        //   STACK WIN 4 1040 73 33 0 ...
+        //   STACK WIN 4 105a 59 19 0 ...
+        // because in both of these entries, the beginning of the code after
+        // the prolog is at 0x1073, and the last byte of contained code is at
+        // 0x10b2.  Perhaps we could get away with storing ranges by rva +
+        // prolog_size if ContainedRangeMap were modified to allow replacement
+        // of already-stored values.
+        // Each range is a node of the map it is stored in, and the map of
+        // the ranges it contains.
+        // A range that fails to store stays unreachable in the arena.
+        heap_bytes_ +=
+            TreeNodeSize<std::pair<MemAddr, void*> >() +
+            sizeof(ContainedRangeMap<MemAddr, WindowsFrameInfo*>) +
+            record.windows_frame_info->program_string.capacity() +
+            record.windows_frame_info->program.MemoryUsage();
+        windows_frame_info_[record.index].StoreRange(
+            record.address, record.size, record.windows_frame_info);
+        break;
+
+      case Record::RECORD_CFI_INITIAL_RULES:
+        cfi_initial_rules_.StoreRange(record.address, record.size,
+                                      arena_.Intern(record.text));
+        break;
+
+      case Record::RECORD_CFI_DELTA_RULES: {
+        // A later record for the same address replaces an earlier one.
+        map<MemAddr, const char*>::iterator delta =
+            cfi_delta_rules_.insert(cfi_delta_rules_.end(),
+                                    make_pair(record.address,
+                                              static_cast<const char*>(NULL)));
+        delta->second = arena_.Intern(record.text);
+        heap_bytes_ += TreeNodeSize<std::pair<MemAddr, const char*> >();
+        break;
       }
     }
-    if (num_errors > kMaxErrorsBeforeBailing) {
-      break;
+
+    if (*num_errors > kMaxErrorsBeforeBailing) {
+      return false;
     }
-    buffer = strtok_r(NULL, "\r\n", &save_ptr);
   }
-  is_corrupt_ = num_errors > 0;
+
+  if (run->ends_without_function) {
+    *cur_func = NULL;
+  }
+  *line_number += run->line_count;
   return true;
 }
 
@@ -234,8 +565,8 @@ void BasicSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
   // extent of the PUBLIC symbol we find, below. This does mean we
   // need to check that address indeed falls within the function we
   // find; do the range comparison in an overflow-friendly way.
-  linked_ptr<Function> func;
-  linked_ptr<PublicSymbol> public_symbol;
+  Function *func = NULL;
+  PublicSymbol *public_symbol;
   MemAddr function_base;
   MemAddr function_size;
   MemAddr public_address;
@@ -245,7 +576,7 @@ void BasicSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
     frame->function_name = func->name;
     frame->function_base = frame->module->base_address() + function_base;
 
-    linked_ptr<Line> line;
+    Line *line;
     MemAddr line_base;
     if (func->lines.RetrieveRange(address, &line, &line_base, NULL /* delta */,
                                   NULL /* size */)) {
@@ -258,12 +589,140 @@ void BasicSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
     }
   } else if (public_symbols_.Retrieve(address,
                                       &public_symbol, &public_address) &&
-             (!func.get() || public_address > function_base)) {
+             (!func || public_address > function_base)) {
     frame->function_name = public_symbol->name;
     frame->function_base = frame->module->base_address() + public_address;
   }
 }
 
+void BasicSourceLineResolver::Module::LookupAddresses(
+    MemAddr base_address, const MemAddr *addresses, const size_t *order,
+    size_t count, SourceLineInfo *infos) const {
+  // The addresses are looked up in ascending order, merging them with the
+  // functions, and each function's lines, as they go: the cursors hold the
+  // positions the previous address reached.  The function and line the
+  // previous address fell in, if any, need no lookup for the next.
+  int function_cursor = 0;
+  const Function *func = NULL;
+  MemAddr function_base = 0;
+  MemAddr function_size = 0;
+  int line_cursor = 0;
+  const Line *line = NULL;
+  MemAddr line_base = 0;
+  MemAddr line_size = 0;
+  const char *source_file_name = NULL;
+
+  for (size_t i = 0; i < count; ++i) {
+    size_t index = order ? order[i] : i;
+    MemAddr address = addresses[index] - base_address;
+    SourceLineInfo *info = &infos[index];
+    *info = SourceLineInfo();
+
+    if (!func || address < function_base ||
+        address - function_base >= function_size) {
+      // As in LookupAddress, the nearest function bounds the extent of a
+      // PUBLIC symbol if no function covers the address.
+      Function *const *nearest_func = NULL;
+      bool found = functions_.RetrieveNearestRangeFrom(address,
+                                                       &function_cursor,
+                                                       &nearest_func,
+                                                       &function_base,
+                                                       NULL /* delta */,
+                                                       &function_size);
+      line = NULL;
+      line_cursor = 0;
+      if (found && address >= function_base &&
+          address - function_base < function_size) {
+        func = *nearest_func;
+      } else {
+        func = NULL;
+        PublicSymbol *public_symbol;
+        MemAddr public_address;
+        if (public_symbols_.Retrieve(address, &public_symbol,
+                                     &public_address) &&
+            (!found || public_address > function_base)) {
+          info->function_name = public_symbol->name;
+          info->function_base = base_address + public_address;
+        }
+        continue;
+      }
+    }
+
+    info->function_name = func->name;
+    info->function_base = base_address + function_base;
+
+    if (!line || address < line_base || address - line_base >= line_size) {
+      Line *const *found_line;
+      if (func->lines.RetrieveRangeFrom(address, &line_cursor, &found_line,
+                                        &line_base, NULL /* delta */,
+                                        &line_size)) {
+        line = *found_line;
+        FileMap::const_iterator it = files_.find(line->source_file_id);
+        source_file_name = it != files_.end() ? it->second : NULL;
+      } else {
+        line = NULL;
+      }
+    }
+    if (line) {
+      info->source_file_name = source_file_name;
+      info->source_line = line->line;
+      info->source_line_base = base_address + line_base;
+    }
+  }
+}
+
+void BasicSourceLineResolver::Module::LookupInlinedFrames(
+    StackFrame *frame, vector<StackFrame> *inlined_frames) const {
+  MemAddr address = frame->instruction - frame->module->base_address();
+
+  Function *func;
+  MemAddr function_base;
+  MemAddr function_size;
+  if (!functions_.RetrieveNearestRange(address, &func, &function_base,
+                                       NULL /* delta */, &function_size) ||
+      address < function_base || address - function_base >= function_size) {
+    return;
+  }
+
+  vector<Inline* const*> inlines;
+  vector<MemAddr> inline_bases;
+  if (!func->inlines.RetrieveRanges(address, &inlines, &inline_bases)) {
+    return;
+  }
+
+  // The frame's source position is in the innermost inlined function.
+  // Give each inlined function, from the inside out, the position the
+  // frame has, and then move the frame to the call the function's code
+  // stands for, in the function enclosing it.
+  for (size_t i = 0; i < inlines.size(); ++i) {
+    const Inline &inlined = **inlines[i];
+    StackFrame inlined_frame;
+    inlined_frame.instruction = frame->instruction;
+    inlined_frame.module = frame->module;
+    inlined_frame.trust = frame->trust;
+    InlineOriginMap::const_iterator origin =
+        inline_origins_.find(inlined.origin_id);
+    if (origin != inline_origins_.end()) {
+      inlined_frame.function_name = origin->second;
+    }
+    inlined_frame.function_base =
+        frame->module->base_address() + inline_bases[i];
+    inlined_frame.source_file_name = frame->source_file_name;
+    inlined_frame.source_line = frame->source_line;
+    inlined_frame.source_line_base = frame->source_line_base;
+    inlined_frames->push_back(inlined_frame);
+
+    FileMap::const_iterator file = files_.find(inlined.call_site_file_id);
+    if (file != files_.end()) {
+      frame->source_file_name = file->second;
+    } else {
+      frame->source_file_name.clear();
+    }
+    frame->source_line = inlined.call_site_line;
+    frame->source_line_base = 0;
+  }
+}
+
 WindowsFrameInfo *BasicSourceLineResolver::Module::FindWindowsFrameInfo(
     const StackFrame *frame) const {
   MemAddr address = frame->instruction - frame->module->base_address();
@@ -275,12 +734,12 @@ WindowsFrameInfo *BasicSourceLineResolver::Module::FindWindowsFrameInfo(
   // includes its own program string.
   // WindowsFrameInfo::STACK_INFO_FPO is the older type
   // corresponding to the FPO_DATA struct. See stackwalker_x86.cc.
-  linked_ptr<WindowsFrameInfo> frame_info;
+  WindowsFrameInfo *frame_info;
   if ((windows_frame_info_[WindowsFrameInfo::STACK_INFO_FRAME_DATA]
        .RetrieveRange(address, &frame_info))
       || (windows_frame_info_[WindowsFrameInfo::STACK_INFO_FPO]
           .RetrieveRange(address, &frame_info))) {
-    result->CopyFrom(*frame_info.get());
+    result->CopyFrom(*frame_info);
     return result.release();
   }
 
@@ -291,7 +750,7 @@ WindowsFrameInfo *BasicSourceLineResolver::Module::FindWindowsFrameInfo(
   // below. However, this does mean we need to check that ADDRESS
   // falls within the retrieved function's range; do the range
   // comparison in an overflow-friendly way.
-  linked_ptr<Function> function;
+  Function *function = NULL;
   MemAddr function_base, function_size;
   if (functions_.RetrieveNearestRange(address, &function, &function_base,
                                       NULL /* delta */, &function_size) &&
@@ -303,10 +762,10 @@ WindowsFrameInfo *BasicSourceLineResolver::Module::FindWindowsFrameInfo(
 
   // PUBLIC symbols might have a parameter size. Use the function we
   // found above to limit the range the public symbol covers.
-  linked_ptr<PublicSymbol> public_symbol;
+  PublicSymbol *public_symbol;
   MemAddr public_address;
   if (public_symbols_.Retrieve(address, &public_symbol, &public_address) &&
-      (!function.get() || public_address > function_base)) {
+      (!function || public_address > function_base)) {
     result->parameter_size = public_symbol->parameter_size;
   }
 
@@ -317,48 +776,102 @@ CFIFrameInfo *BasicSourceLineResolver::Module::FindCFIFrameInfo(
     const StackFrame *frame) const {
   MemAddr address = frame->instruction - frame->module->base_address();
   MemAddr initial_base, initial_size;
-  string initial_rules;
+  const char *initial_rules;
 
-  // Find the initial rule whose range covers this address. That
-  // provides an initial set of register recovery rules. Then, walk
-  // forward from the initial rule's starting address to frame's
-  // instruction address, applying delta rules.
+  // Find the initial rule whose range covers this address. Its rules,
+  // with the delta rules up to and including the frame's address applied,
+  // are the register recovery rules in effect there.
   if (!cfi_initial_rules_.RetrieveRange(address, &initial_rules, &initial_base,
                                         NULL /* delta */, &initial_size)) {
     return NULL;
   }
 
-  // Create a frame info structure, and populate it with the rules from
-  // the STACK CFI INIT record.
-  scoped_ptr<CFIFrameInfo> rules(new CFIFrameInfo());
-  if (!ParseCFIRuleSet(initial_rules, rules.get()))
-    return NULL;
+  return GetCFIFrameInfo(initial_base, initial_size, initial_rules, address);
+}
 
-  // Find the first delta rule that falls within the initial rule's range.
-  map<MemAddr, string>::const_iterator delta =
-    cfi_delta_rules_.lower_bound(initial_base);
+bool BasicSourceLineResolver::Module::CompileCFIRuleSet(
+    MemAddr initial_base, MemAddr initial_size, const char *initial_rules,
+    CFIRuleSet *rule_set) const {
+  if (!rule_set->AddRules(initial_rules))
+    return false;
 
-  // Apply delta rules up to and including the frame's address.
-  while (delta != cfi_delta_rules_.end() && delta->first <= address) {
-    ParseCFIRuleSet(delta->second, rules.get());
-    delta++;
+  // Add the delta rules that fall within the initial rule's range.
+  for (map<MemAddr, const char*>::const_iterator delta =
+           cfi_delta_rules_.lower_bound(initial_base);
+       delta != cfi_delta_rules_.end() &&
+           delta->first - initial_base < initial_size;
+       ++delta) {
+    rule_set->MarkDelta(delta->first);
+    rule_set->AddRules(delta->second);
   }
 
-  return rules.release();
+  return true;
 }
 
-bool BasicSourceLineResolver::Module::ParseFile(char *file_line) {
+// static
+bool BasicSourceLineResolver::Module::ParseFile(char *file_line,
+                                                Record *record) {
   long index;
   char *filename;
   if (SymbolParseHelper::ParseFile(file_line, &index, &filename)) {
-    files_.insert(make_pair(index, string(filename)));
+    record->type = Record::RECORD_FILE;
+    record->index = index;
+    record->text = filename;
+    return true;
+  }
+  return false;
+}
+
+// static
+bool BasicSourceLineResolver::Module::ParseInlineOrigin(
+    char *inline_origin_line, Record *record) {
+  long origin_id;
+  char *name;
+  if (SymbolParseHelper::ParseInlineOrigin(inline_origin_line, &origin_id,
+                                           &name)) {
+    record->type = Record::RECORD_INLINE_ORIGIN;
+    record->index = origin_id;
+    record->text = name;
     return true;
   }
   return false;
 }
 
+// static
+BasicSourceLineResolver::Inline*
+BasicSourceLineResolver::Module::ParseInline(char *inline_line,
+                                             Arena *arena) {
+  long nest_level;
+  long call_site_line;
+  long call_site_file_id;
+  long origin_id;
+  vector<std::pair<uint64_t, uint64_t> > ranges;
+  if (SymbolParseHelper::ParseInline(inline_line, &nest_level,
+                                     &call_site_line, &call_site_file_id,
+                                     &origin_id, &ranges)) {
+    Inline *inline_record = arena->New<Inline>(nest_level, call_site_line,
+                                               call_site_file_id, origin_id);
+    inline_record->ranges.assign(ranges.begin(), ranges.end());
+    return inline_record;
+  }
+  return NULL;
+}
+
+// static
+void BasicSourceLineResolver::Module::StoreInline(Function *function,
+                                                  Inline *inline_record) {
+  for (size_t i = 0; i < inline_record->ranges.size(); ++i) {
+    // As with lines, ranges that are empty or wrap around are ignored.
+    function->inlines.StoreRange(inline_record->ranges[i].first,
+                                 inline_record->ranges[i].second,
+                                 inline_record);
+  }
+}
+
+// static
 BasicSourceLineResolver::Function*
-BasicSourceLineResolver::Module::ParseFunction(char *function_line) {
+BasicSourceLineResolver::Module::ParseFunction(char *function_line,
+                                               Arena *arena) {
   bool is_multiple;
   uint64_t address;
   uint64_t size;
@@ -366,13 +879,15 @@ BasicSourceLineResolver::Module::ParseFunction(char *function_line) {
   char *name;
   if (SymbolParseHelper::ParseFunction(function_line, &is_multiple, &address,
                                        &size, &stack_param_size, &name)) {
-    return new Function(name, address, size, stack_param_size, is_multiple);
+    return arena->New<Function>(arena->Intern(name), address, size,
+                                stack_param_size, is_multiple);
   }
   return NULL;
 }
 
+// static
 BasicSourceLineResolver::Line* BasicSourceLineResolver::Module::ParseLine(
-    char *line_line) {
+    char *line_line, Arena *arena) {
   uint64_t address;
   uint64_t size;
   long line_number;
@@ -380,12 +895,15 @@ BasicSourceLineResolver::Line* BasicSourceLineResolver::Module::ParseLine(
 
   if (SymbolParseHelper::ParseLine(line_line, &address, &size, &line_number,
                                    &source_file)) {
-    return new Line(address, size, source_file, line_number);
+    return arena->New<Line>(address, size, source_file, line_number);
   }
   return NULL;
 }
 
-bool BasicSourceLineResolver::Module::ParsePublicSymbol(char *public_line) {
+// static
+bool BasicSourceLineResolver::Module::ParsePublicSymbol(char *public_line,
+                                                        Arena *arena,
+                                                        Record *record) {
   bool is_multiple;
   uint64_t address;
   long stack_param_size;
@@ -403,15 +921,19 @@ bool BasicSourceLineResolver::Module::ParsePublicSymbol(char *public_line) {
       return true;
     }
 
-    linked_ptr<PublicSymbol> symbol(new PublicSymbol(name, address,
+    record->type = Record::RECORD_PUBLIC;
+    record->public_symbol = arena->New<PublicSymbol>(arena->Intern(name),
+                                                     address,
                                                      stack_param_size,
-                                                     is_multiple));
-    return public_symbols_.Store(address, symbol);
+                                                     is_multiple);
+    return true;
   }
   return false;
 }
 
-bool BasicSourceLineResolver::Module::ParseStackInfo(char *stack_info_line) {
+bool BasicSourceLineResolver::Module::ParseStackInfo(char *stack_info_line,
+                                                     Arena *arena,
+                                                     Record *record) const {
   // Skip "STACK " prefix.
   stack_info_line += 6;
 
@@ -428,39 +950,22 @@ bool BasicSourceLineResolver::Module::ParseStackInfo(char *stack_info_line) {
   if (strcmp(platform, "WIN") == 0) {
     int type = 0;
     uint64_t rva, code_size;
-    linked_ptr<WindowsFrameInfo>
-      stack_frame_info(WindowsFrameInfo::ParseFromString(stack_info_line,
-                                                         type,
-                                                         rva,
-                                                         code_size));
-    if (stack_frame_info == NULL)
+    scoped_ptr<WindowsFrameInfo> stack_frame_info(
+        WindowsFrameInfo::ParseFromString(stack_info_line, type, rva,
+                                          code_size));
+    if (!stack_frame_info.get())
       return false;
 
-    // TODO(mmentovai): I wanted to use StoreRange's return value as this
-    // method's return value, but MSVC infrequently outputs stack info that
-    // violates the containment rules.  This happens with a section of code
-    // in strncpy_s in test_app.cc (testdata/minidump2).  There, problem looks
-    // like this:
-    //   STACK WIN 4 4242 1a a 0 ...  (STACK WIN 4 base size prolog 0 ...)
-    //   STACK WIN 4 4243 2e 9 0 ...
-    // ContainedRangeMap treats these two blocks as conflicting.  In reality,
-    // when the prolog lengths are taken into account, the actual code of
-    // these blocks doesn't conflict.  However, we can't take the prolog lengths
-    // into account directly here because we'd wind up with a different set
-    // of range conflicts when MSVC outputs stack info like this:
-    //   STACK WIN 4 1040 73 33 0 ...
-    //   STACK WIN 4 105a 59 19 0 ...
-    // because in both of these entries, the beginning of the code after the
-    // prolog is at 0x1073, and the last byte of contained code is at 0x10b2.
-    // Perhaps we could get away with storing ranges by rva + prolog_size
-    // if ContainedRangeMap were modified to allow replacement of
-    // already-stored values.
-
-    windows_frame_info_[type].StoreRange(rva, code_size, stack_frame_info);
+    record->type = Record::RECORD_WINDOWS_FRAME_INFO;
+    record->index = type;
+    record->address = rva;
+    record->size = code_size;
+    record->windows_frame_info =
+        arena->New<WindowsFrameInfo>(std::move(*stack_frame_info));
     return true;
   } else if (strcmp(platform, "CFI") == 0) {
     // DWARF CFI stack frame info
-    return ParseCFIFrameInfo(stack_info_line);
+    return ParseCFIFrameInfo(stack_info_line, record);
   } else {
     // Something unrecognized.
     return false;
@@ -468,7 +973,7 @@ bool BasicSourceLineResolver::Module::ParseStackInfo(char *stack_info_line) {
 }
 
 bool BasicSourceLineResolver::Module::ParseCFIFrameInfo(
-    char *stack_info_line) {
+    char *stack_info_line, Record *record) const {
   char *cursor;
 
   // Is this an INIT record or a delta record?
@@ -487,9 +992,10 @@ bool BasicSourceLineResolver::Module::ParseCFIFrameInfo(
     char *initial_rules = strtok_r(NULL, "\r\n", &cursor);
     if (!initial_rules) return false;
 
-    MemAddr address = strtoul(address_field, NULL, 16);
-    MemAddr size    = strtoul(size_field,    NULL, 16);
-    cfi_initial_rules_.StoreRange(address, size, initial_rules);
+    record->type = Record::RECORD_CFI_INITIAL_RULES;
+    record->address = strtoul(address_field, NULL, 16);
+    record->size = strtoul(size_field, NULL, 16);
+    record->text = initial_rules;
     return true;
   }
 
@@ -497,8 +1003,9 @@ bool BasicSourceLineResolver::Module::ParseCFIFrameInfo(
   char *address_field = init_or_address;
   char *delta_rules = strtok_r(NULL, "\r\n", &cursor);
   if (!delta_rules) return false;
-  MemAddr address = strtoul(address_field, NULL, 16);
-  cfi_delta_rules_[address] = delta_rules;
+  record->type = Record::RECORD_CFI_DELTA_RULES;
+  record->address = strtoul(address_field, NULL, 16);
+  record->text = delta_rules;
   return true;
 }
 
@@ -529,6 +1036,85 @@ bool SymbolParseHelper::ParseFile(char *file_line, long *index,
   return true;
 }
 
+// static
+bool SymbolParseHelper::ParseInlineOrigin(char *inline_origin_line,
+                                          long *origin_id, char **name) {
+  // INLINE_ORIGIN <id> <name>
+  assert(strncmp(inline_origin_line, "INLINE_ORIGIN ", 14) == 0);
+  inline_origin_line += 14;  // skip prefix
+
+  vector<char*> tokens;
+  if (!Tokenize(inline_origin_line, kWhitespace, 2, &tokens)) {
+    return false;
+  }
+
+  char *after_number;
+  *origin_id = strtol(tokens[0], &after_number, 10);
+  if (!IsValidAfterNumber(after_number) || *origin_id < 0 ||
+      *origin_id == std::numeric_limits<long>::max()) {
+    return false;
+  }
+
+  *name = tokens[1];
+  return *name != NULL;
+}
+
+// static
+bool SymbolParseHelper::ParseInline(
+    char *inline_line, long *nest_level, long *call_site_line,
+    long *call_site_file_id, long *origin_id,
+    vector<std::pair<uint64_t, uint64_t> > *ranges) {
+  // INLINE <nest_level> <call_site_line> <call_site_file_id> <origin_id>
+  //     <address> <size> [<address> <size> ...]
+  assert(strncmp(inline_line, "INLINE ", 7) == 0);
+  inline_line += 7;  // skip prefix
+
+  vector<char*> tokens;
+  if (!Tokenize(inline_line, kWhitespace, 5, &tokens)) {
+    return false;
+  }
+
+  long *numbers[] = { nest_level, call_site_line, call_site_file_id,
+                      origin_id };
+  for (int i = 0; i < 4; ++i) {
+    char *after_number;
+    *numbers[i] = strtol(tokens[i], &after_number, 10);
+    if (!IsValidAfterNumber(after_number) ||
+        *numbers[i] == std::numeric_limits<long>::max()) {
+      return false;
+    }
+  }
+  if (*nest_level < 0 || *call_site_line < 0 || *call_site_file_id < -1 ||
+      *origin_id < 0) {
+    return false;
+  }
+
+  ranges->clear();
+  char *cursor;
+  for (char *address_field = strtok_r(tokens[4], kWhitespace, &cursor);
+       address_field != NULL;
+       address_field = strtok_r(NULL, kWhitespace, &cursor)) {
+    char *size_field = strtok_r(NULL, kWhitespace, &cursor);
+    if (!size_field) {
+      return false;
+    }
+    char *after_number;
+    uint64_t address = strtoull(address_field, &after_number, 16);
+    if (!IsValidAfterNumber(after_number) ||
+        address == std::numeric_limits<unsigned long long>::max()) {
+      return false;
+    }
+    uint64_t size = strtoull(size_field, &after_number, 16);
+    if (!IsValidAfterNumber(after_number) ||
+        size == std::numeric_limits<unsigned long long>::max()) {
+      return false;
+    }
+    ranges->push_back(make_pair(address, size));
+  }
+
+  return !ranges->empty();
+}
+
 // static
 bool SymbolParseHelper::ParseFunction(char *function_line, bool *is_multiple,
                                       uint64_t *address, uint64_t *size,
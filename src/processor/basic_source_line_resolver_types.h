@@ -39,16 +39,18 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "common/scoped_ptr.h"
 #include "google_breakpad/processor/basic_source_line_resolver.h"
 #include "processor/source_line_resolver_base_types.h"
 
 #include "processor/address_map-inl.h"
+#include "processor/arena.h"
 #include "processor/range_map-inl.h"
 #include "processor/contained_range_map-inl.h"
+#include "processor/nested_range_map-inl.h"
 
-#include "processor/linked_ptr.h"
 #include "google_breakpad/processor/stack_frame.h"
 #include "processor/cfi_frame_info.h"
 #include "processor/windows_frame_info.h"
@@ -57,7 +59,7 @@ namespace google_breakpad {
 
 struct
 BasicSourceLineResolver::Function : public SourceLineResolverBase::Function {
-  Function(const string &function_name,
+  Function(const char *function_name,
            MemAddr function_address,
            MemAddr code_size,
            int set_parameter_size,
@@ -66,8 +68,15 @@ BasicSourceLineResolver::Function : public SourceLineResolverBase::Function {
                                    code_size,
                                    set_parameter_size,
                                    is_mutiple),
-                              lines() { }
-  RangeMap< MemAddr, linked_ptr<Line> > lines;
+                              lines(),
+                              inlines() { }
+  // The function's lines and inlines are in its module's arena.
+  RangeMap<MemAddr, Line*> lines;
+
+  // The code inlined into this function, stored once for each range of
+  // each INLINE record, so that the ranges of functions inlined at an
+  // address come out innermost first.
+  NestedRangeMap<MemAddr, Inline*> inlines;
  private:
   typedef SourceLineResolverBase::Function Base;
 };
@@ -75,7 +84,11 @@ BasicSourceLineResolver::Function : public SourceLineResolverBase::Function {
 
 class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
  public:
-  explicit Module(const string &name) : name_(name), is_corrupt_(false) { }
+  // |load_threads| is the number of threads LoadMapFromMemory may parse
+  // the symbol data on; see BasicSourceLineResolver::set_load_threads.
+  explicit Module(const string &name, unsigned int load_threads = 1)
+      : name_(name), is_corrupt_(false), load_threads_(load_threads),
+        heap_bytes_(0) { }
   virtual ~Module() { }
 
   // Loads a map from the given buffer in char* type.
@@ -83,6 +96,12 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
   // The passed in |memory buffer| is of size |memory_buffer_size|.  If it is
   // not null terminated, LoadMapFromMemory() will null terminate it by
   // modifying the passed in buffer.
+  //
+  // If the module may use more than one thread, large buffers are split
+  // into runs of records, each beginning with a FUNC, PUBLIC or STACK
+  // record, which are parsed on several threads at once.  The records are
+  // then stored in the maps in file order, so the module is the same however
+  // many threads parsed it.
   virtual bool LoadMapFromMemory(char *memory_buffer,
                                  size_t memory_buffer_size);
 
@@ -90,10 +109,24 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
   // undefined, if the symbol data hasn't been loaded yet.
   virtual bool IsCorrupt() const { return is_corrupt_; }
 
+  // Returns roughly the bytes of memory the module takes: its arena, the
+  // storage of its maps, and its frame information.
+  virtual size_t MemoryUsage() const;
+
   // Looks up the given relative address, and fills the StackFrame struct
   // with the result.
   virtual void LookupAddress(StackFrame *frame) const;
 
+  // Looks up a batch of addresses.  See SourceLineResolverBase::Module.
+  virtual void LookupAddresses(MemAddr base_address, const MemAddr *addresses,
+                               const size_t *order, size_t count,
+                               SourceLineInfo *infos) const;
+
+  // Expands a frame into the functions inlined at its instruction.  See
+  // SourceLineResolverBase::Module.
+  virtual void LookupInlinedFrames(
+      StackFrame *frame, std::vector<StackFrame> *inlined_frames) const;
+
   // If Windows stack walking information is available covering ADDRESS,
   // return a WindowsFrameInfo structure describing it. If the information
   // is not available, returns NULL. A NULL return value does not indicate
@@ -107,13 +140,20 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
   // returned CFIFrameInfo object.
   virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame) const;
 
+ protected:
+  virtual bool CompileCFIRuleSet(MemAddr initial_base, MemAddr initial_size,
+                                 const char *initial_rules,
+                                 CFIRuleSet *rule_set) const;
+
  private:
   // Friend declarations.
   friend class BasicSourceLineResolver;
   friend class ModuleComparer;
   friend class ModuleSerializer;
 
-  typedef std::map<int, string> FileMap;
+  // File and inline origin names are interned in arena_.
+  typedef std::map<int, const char*> FileMap;
+  typedef std::map<int, const char*> InlineOriginMap;
 
   // Logs parse errors.  |*num_errors| is increased every time LogParseError is
   // called.
@@ -122,56 +162,107 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
       int line_number,
       int *num_errors);
 
-  // Parses a file declaration
-  bool ParseFile(char *file_line);
+  // A record of the symbol data, parsed but not yet stored in the maps.
+  struct Record;
+
+  // The records parsed from a run of lines of the symbol data, in order.
+  struct RecordRun;
+
+  // Parses the lines of the null-terminated |buffer| into |run|, making
+  // the symbols in the run's arena.  This does not touch the module's
+  // maps, so the runs of a buffer may be parsed concurrently.  Line
+  // records are stored in their function as they are parsed, unless they
+  // precede the run's first FUNC or PUBLIC record.
+  void ParseRecords(char *buffer, RecordRun *run) const;
+
+  // Stores the records of |run| in the maps, and logs its errors.  The
+  // run's arena must have been absorbed into arena_.
+  // |*line_number| is the number of lines before the run, and |*cur_func|
+  // the function its leading line records belong to; both are updated to
+  // follow the run.  Returns false, having stored only some of the
+  // records, once there have been too many errors to go on.
+  bool StoreRecords(RecordRun *run, int *line_number,
+                    Function **cur_func, int *num_errors);
 
-  // Parses a function declaration, returning a new Function object.
-  Function* ParseFunction(char *function_line);
+  // Parses a file declaration.
+  static bool ParseFile(char *file_line, Record *record);
 
-  // Parses a line declaration, returning a new Line object.
-  Line* ParseLine(char *line_line);
+  // Parses an INLINE_ORIGIN record.
+  static bool ParseInlineOrigin(char *inline_origin_line, Record *record);
 
-  // Parses a PUBLIC symbol declaration, storing it in public_symbols_.
+  // Parses an INLINE record, returning a new Inline object in |arena|.
+  static Inline* ParseInline(char *inline_line, Arena *arena);
+
+  // Stores |inline_record| in |function| under each of its ranges.
+  static void StoreInline(Function *function, Inline *inline_record);
+
+  // Parses a function declaration, returning a new Function object in
+  // |arena|.
+  static Function* ParseFunction(char *function_line, Arena *arena);
+
+  // Parses a line declaration, returning a new Line object in |arena|.
+  static Line* ParseLine(char *line_line, Arena *arena);
+
+  // Parses a PUBLIC symbol declaration, making the symbol in |arena|.
   // Returns false if an error occurs.
-  bool ParsePublicSymbol(char *public_line);
+  static bool ParsePublicSymbol(char *public_line, Arena *arena,
+                                Record *record);
 
-  // Parses a STACK WIN or STACK CFI frame info declaration, storing
-  // it in the appropriate table.
-  bool ParseStackInfo(char *stack_info_line);
+  // Parses a STACK WIN or STACK CFI frame info declaration, making any
+  // WindowsFrameInfo in |arena|.
+  bool ParseStackInfo(char *stack_info_line, Arena *arena,
+                      Record *record) const;
 
-  // Parses a STACK CFI record, storing it in cfi_frame_info_.
-  bool ParseCFIFrameInfo(char *stack_info_line);
+  // Parses a STACK CFI record.
+  bool ParseCFIFrameInfo(char *stack_info_line, Record *record) const;
 
   string name_;
+
+  // The module's functions, lines, inlines, public symbols and Windows
+  // frame info, the strings they name, and the text of its CFI rules,
+  // live here until the module is destroyed.
+  Arena arena_;
+
   FileMap files_;
-  RangeMap< MemAddr, linked_ptr<Function> > functions_;
-  AddressMap< MemAddr, linked_ptr<PublicSymbol> > public_symbols_;
+  InlineOriginMap inline_origins_;
+  RangeMap<MemAddr, Function*> functions_;
+  AddressMap<MemAddr, PublicSymbol*> public_symbols_;
   bool is_corrupt_;
 
   // Each element in the array is a ContainedRangeMap for a type
   // listed in WindowsFrameInfoTypes. These are split by type because
   // there may be overlaps between maps of different types, but some
   // information is only available as certain types.
-  ContainedRangeMap< MemAddr, linked_ptr<WindowsFrameInfo> >
+  ContainedRangeMap<MemAddr, WindowsFrameInfo*>
     windows_frame_info_[WindowsFrameInfo::STACK_INFO_LAST];
 
   // DWARF CFI stack walking data. The Module stores the initial rule sets
   // and rule deltas as strings, just as they appear in the symbol file:
   // although the file may contain hundreds of thousands of STACK CFI
   // records, walking a stack will only ever use a few of them, so it's
-  // best to delay parsing a record until it's actually needed.
+  // best to delay parsing a record until it's actually needed.  The
+  // strings are interned in arena_: many records share the same rules.
 
   // STACK CFI INIT records: for each range, an initial set of register
   // recovery rules. The RangeMap's itself gives the starting and ending
   // addresses.
-  RangeMap<MemAddr, string> cfi_initial_rules_;
+  RangeMap<MemAddr, const char*> cfi_initial_rules_;
 
   // STACK CFI records: at a given address, the changes to the register
   // recovery rules that take effect at that address. The map key is the
   // starting address; the ending address is the key of the next entry in
   // this map, or the end of the range as given by the cfi_initial_rules_
   // entry (which FindCFIFrameInfo looks up first).
-  std::map<MemAddr, string> cfi_delta_rules_;
+  std::map<MemAddr, const char*> cfi_delta_rules_;
+
+  // The number of threads LoadMapFromMemory may use: 1 by default, or 0
+  // to use one per processor.
+  unsigned int load_threads_;
+
+  // The heap taken by the entries of the maps that do not report their
+  // own storage, and by what those entries point to outside arena_:
+  // counted by StoreRecords as it stores them.
+  size_t heap_bytes_;
 };
 
 }  // namespace google_breakpad
@@ -30,7 +30,10 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include <atomic>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "breakpad_googletest_includes.h"
 #include "common/scoped_ptr.h"
@@ -50,6 +53,7 @@ using google_breakpad::BasicSourceLineResolver;
 using google_breakpad::CFIFrameInfo;
 using google_breakpad::CodeModule;
 using google_breakpad::MemoryRegion;
+using google_breakpad::SourceLineResolverInterface;
 using google_breakpad::StackFrame;
 using google_breakpad::WindowsFrameInfo;
 using google_breakpad::linked_ptr;
@@ -58,10 +62,11 @@ using google_breakpad::SymbolParseHelper;
 
 class TestCodeModule : public CodeModule {
  public:
-  TestCodeModule(string code_file) : code_file_(code_file) {}
+  TestCodeModule(string code_file, uint64_t base_address = 0)
+      : code_file_(code_file), base_address_(base_address) {}
   virtual ~TestCodeModule() {}
 
-  virtual uint64_t base_address() const { return 0; }
+  virtual uint64_t base_address() const { return base_address_; }
   virtual uint64_t size() const { return 0xb000; }
   virtual string code_file() const { return code_file_; }
   virtual string code_identifier() const { return ""; }
@@ -69,7 +74,7 @@ class TestCodeModule : public CodeModule {
   virtual string debug_identifier() const { return ""; }
   virtual string version() const { return ""; }
   virtual CodeModule* Copy() const {
-    return new TestCodeModule(code_file_);
+    return new TestCodeModule(code_file_, base_address_);
   }
   virtual bool is_unloaded() const { return false; }
   virtual uint64_t shrink_down_delta() const { return 0; }
@@ -77,6 +82,7 @@ class TestCodeModule : public CodeModule {
 
  private:
   string code_file_;
+  uint64_t base_address_;
 };
 
 // A mock memory region object, for use by the STACK CFI tests.
@@ -413,6 +419,376 @@ TEST_F(TestBasicSourceLineResolver, TestUnload)
   ASSERT_TRUE(resolver.HasModule(&module1));
 }
 
+// Threads loading the same modules at once parse each of them only once,
+// and look addresses up while other modules load.
+TEST_F(TestBasicSourceLineResolver, TestConcurrentLoadAndResolve)
+{
+  ASSERT_TRUE(resolver.IsThreadSafe());
+  TestCodeModule module1("module1");
+  TestCodeModule module2("module2");
+  const int kThreadCount = 8;
+  std::atomic<int> loads(0);
+  std::atomic<int> failed_lookups(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadCount; ++i) {
+    threads.push_back(std::thread([&, i]() {
+      TestCodeModule *module = i % 2 ? &module1 : &module2;
+      const char *file = i % 2 ? "/module1.out" : "/module2.out";
+      if (resolver.LoadModule(module, testdata_dir + file))
+        ++loads;
+      if (!resolver.HasModule(module))
+        ++failed_lookups;
+      StackFrame frame;
+      frame.instruction = 0x1000;
+      frame.module = &module1;
+      if (resolver.HasModule(&module1)) {
+        resolver.FillSourceLineInfo(&frame);
+        if (frame.function_name != "Function1_1")
+          ++failed_lookups;
+      }
+    }));
+  }
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+
+  EXPECT_EQ(2, loads);
+  EXPECT_EQ(0, failed_lookups);
+
+  StackFrame frame;
+  frame.instruction = 0x2181;
+  frame.module = &module2;
+  resolver.FillSourceLineInfo(&frame);
+  EXPECT_EQ("Function2_2", frame.function_name);
+}
+
+// Lookups may run while another thread unloads and reloads their module,
+// as when a symbolizer with a symbol cache budget evicts it: each finds the
+// module or doesn't, and UnloadModule waits for those that found it.
+TEST_F(TestBasicSourceLineResolver, TestConcurrentLookupAndUnload)
+{
+  TestCodeModule module1("module1");
+  ASSERT_TRUE(resolver.LoadModule(&module1, testdata_dir + "/module1.out"));
+  const int kThreadCount = 4;
+  std::atomic<bool> done(false);
+  std::atomic<int> wrong_lookups(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadCount; ++i) {
+    threads.push_back(std::thread([&]() {
+      while (!done) {
+        StackFrame frame;
+        frame.instruction = 0x1000;
+        frame.module = &module1;
+        resolver.FillSourceLineInfo(&frame);
+        if (!frame.function_name.empty() &&
+            frame.function_name != "Function1_1")
+          ++wrong_lookups;
+        scoped_ptr<WindowsFrameInfo> windows_frame_info(
+            resolver.FindWindowsFrameInfo(&frame));
+        frame.instruction = 0x3d40;
+        scoped_ptr<CFIFrameInfo> cfi_frame_info(
+            resolver.FindCFIFrameInfo(&frame));
+        if (cfi_frame_info.get() &&
+            cfi_frame_info->Serialize() != ".cfa: $esp 4 + .ra: .cfa 4 - ^")
+          ++wrong_lookups;
+      }
+    }));
+  }
+  int failed_loads = 0;
+  for (int i = 0; i < 200; ++i) {
+    resolver.UnloadModule(&module1);
+    if (!resolver.LoadModule(&module1, testdata_dir + "/module1.out"))
+      ++failed_loads;
+  }
+  done = true;
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+
+  EXPECT_EQ(0, failed_loads);
+  EXPECT_EQ(0, wrong_lookups);
+}
+
+// Expects every lookup between |start| and |end| to give the same answer
+// from |expected| and |actual|, which have both loaded |module|.
+static void ExpectSameLookups(BasicSourceLineResolver *expected,
+                              BasicSourceLineResolver *actual,
+                              const CodeModule *module,
+                              uint64_t start, uint64_t end, uint64_t step) {
+  for (uint64_t address = start; address < end; address += step) {
+    StackFrame expected_frame, actual_frame;
+    expected_frame.instruction = actual_frame.instruction = address;
+    expected_frame.module = actual_frame.module = module;
+    expected->FillSourceLineInfo(&expected_frame);
+    actual->FillSourceLineInfo(&actual_frame);
+    ASSERT_EQ(expected_frame.function_name, actual_frame.function_name)
+        << std::hex << address;
+    ASSERT_EQ(expected_frame.function_base, actual_frame.function_base);
+    ASSERT_EQ(expected_frame.source_file_name, actual_frame.source_file_name);
+    ASSERT_EQ(expected_frame.source_line, actual_frame.source_line);
+    ASSERT_EQ(expected_frame.source_line_base, actual_frame.source_line_base);
+
+    scoped_ptr<WindowsFrameInfo> expected_windows(
+        expected->FindWindowsFrameInfo(&expected_frame));
+    scoped_ptr<WindowsFrameInfo> actual_windows(
+        actual->FindWindowsFrameInfo(&actual_frame));
+    ASSERT_EQ(!expected_windows.get(), !actual_windows.get());
+    if (expected_windows.get()) {
+      ASSERT_EQ(expected_windows->type_, actual_windows->type_);
+      ASSERT_EQ(expected_windows->prolog_size, actual_windows->prolog_size);
+      ASSERT_EQ(expected_windows->program_string,
+                actual_windows->program_string);
+    }
+
+    scoped_ptr<CFIFrameInfo> expected_cfi(
+        expected->FindCFIFrameInfo(&expected_frame));
+    scoped_ptr<CFIFrameInfo> actual_cfi(
+        actual->FindCFIFrameInfo(&actual_frame));
+    ASSERT_EQ(!expected_cfi.get(), !actual_cfi.get());
+    if (expected_cfi.get())
+      ASSERT_EQ(expected_cfi->Serialize(), actual_cfi->Serialize());
+  }
+}
+
+// Symbol files parsed on several threads load as they do on one.
+TEST_F(TestBasicSourceLineResolver, TestParallelLoad)
+{
+  BasicSourceLineResolver serial_resolver;
+  serial_resolver.set_load_threads(1);
+  resolver.set_load_threads(8);
+
+  TestCodeModule linux_module("breakpad_unittests");
+  string linux_file = testdata_dir + "/symbols/microdump/breakpad_unittests/"
+      "D6D1FEC9A15DE7F38A236898871A2E770/breakpad_unittests.sym";
+  ASSERT_TRUE(serial_resolver.LoadModule(&linux_module, linux_file));
+  ASSERT_TRUE(resolver.LoadModule(&linux_module, linux_file));
+  EXPECT_FALSE(resolver.IsModuleCorrupt(&linux_module));
+  ExpectSameLookups(&serial_resolver, &resolver, &linux_module,
+                    0, 0xa6000, 17);
+
+  TestCodeModule windows_module("test_app");
+  string windows_file = testdata_dir + "/symbols/test_app.pdb/"
+      "5A9832E5287241C1838ED98914E9B7FF1/test_app.sym";
+  ASSERT_TRUE(serial_resolver.LoadModule(&windows_module, windows_file));
+  ASSERT_TRUE(resolver.LoadModule(&windows_module, windows_file));
+  EXPECT_FALSE(resolver.IsModuleCorrupt(&windows_module));
+  ExpectSameLookups(&serial_resolver, &resolver, &windows_module,
+                    0, 0x40000, 5);
+
+  // Line records that follow a STACK record belong to the function before
+  // it, even when the STACK record starts a run.
+  string symbols;
+  char record[100];
+  for (int i = 0; i < 40000; ++i) {
+    snprintf(record, sizeof(record), "FUNC %x 40 0 Function%d\n",
+             i * 0x40, i);
+    symbols += record;
+    for (int j = 0; j < 4; ++j) {
+      snprintf(record, sizeof(record),
+               "STACK CFI %x .cfa: $esp %d +\n"
+               "%x 10 %d 0\n",
+               i * 0x40 + j * 0x10, j + 4, i * 0x40 + j * 0x10, i * 4 + j);
+      symbols += record;
+    }
+  }
+  symbols += "FILE 0 file.cc\n";
+  TestCodeModule generated_module("generated");
+  ASSERT_TRUE(serial_resolver.LoadModuleUsingMapBuffer(&generated_module,
+                                                       symbols));
+  ASSERT_TRUE(resolver.LoadModuleUsingMapBuffer(&generated_module, symbols));
+  EXPECT_FALSE(resolver.IsModuleCorrupt(&generated_module));
+  ExpectSameLookups(&serial_resolver, &resolver, &generated_module,
+                    0, 40000 * 0x40, 23);
+  StackFrame frame;
+  frame.instruction = 39999 * 0x40 + 0x38;
+  frame.module = &generated_module;
+  resolver.FillSourceLineInfo(&frame);
+  EXPECT_EQ("Function39999", frame.function_name);
+  EXPECT_EQ("file.cc", frame.source_file_name);
+  EXPECT_EQ(159999, frame.source_line);
+}
+
+// Expects LookupAddresses to give for each of |addresses| in |module| what
+// FillSourceLineInfo gives for a frame at that address.
+static void ExpectSameAsFrames(SourceLineResolverInterface *resolver,
+                               const CodeModule *module,
+                               const std::vector<uint64_t> &addresses) {
+  std::vector<SourceLineResolverInterface::SourceLineInfo> infos(
+      addresses.size());
+  ASSERT_TRUE(resolver->LookupAddresses(module, &addresses[0],
+                                        addresses.size(), &infos[0]));
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    StackFrame frame;
+    frame.instruction = addresses[i];
+    frame.module = module;
+    resolver->FillSourceLineInfo(&frame);
+    const SourceLineResolverInterface::SourceLineInfo &info = infos[i];
+    ASSERT_EQ(frame.function_name,
+              info.function_name ? info.function_name : "")
+        << std::hex << addresses[i];
+    ASSERT_EQ(frame.function_base, info.function_base);
+    ASSERT_EQ(frame.source_file_name,
+              info.source_file_name ? info.source_file_name : "");
+    ASSERT_EQ(frame.source_line, info.source_line);
+    ASSERT_EQ(frame.source_line_base, info.source_line_base);
+  }
+}
+
+// Sorted, reversed and shuffled batches of the addresses from |start| to
+// |end|, with some outside the module, look up as single frames do.
+static void ExpectBatchesSameAsFrames(SourceLineResolverInterface *resolver,
+                                      const CodeModule *module,
+                                      uint64_t start, uint64_t end,
+                                      uint64_t step) {
+  std::vector<uint64_t> addresses;
+  for (uint64_t address = start; address < end; address += step)
+    addresses.push_back(module->base_address() + address);
+  ExpectSameAsFrames(resolver, module, addresses);
+
+  std::vector<uint64_t> reversed(addresses.rbegin(), addresses.rend());
+  reversed.push_back(module->base_address() - 1);
+  reversed.push_back(0);
+  reversed.push_back(~0ULL);
+  ExpectSameAsFrames(resolver, module, reversed);
+
+  std::vector<uint64_t> shuffled;
+  for (size_t i = 0; i < addresses.size(); ++i)
+    shuffled.push_back(addresses[(i * 7919) % addresses.size()]);
+  shuffled.insert(shuffled.end(), addresses.begin(), addresses.end());
+  ExpectSameAsFrames(resolver, module, shuffled);
+}
+
+TEST_F(TestBasicSourceLineResolver, TestLookupAddresses)
+{
+  TestCodeModule module1("module1");
+  ASSERT_TRUE(resolver.LoadModule(&module1, testdata_dir + "/module1.out"));
+  ExpectBatchesSameAsFrames(&resolver, &module1, 0, 0x6000, 3);
+
+  // The same module, loaded elsewhere.
+  TestCodeModule moved_module1("module1", 0x400000);
+  ExpectBatchesSameAsFrames(&resolver, &moved_module1, 0, 0x6000, 7);
+
+  TestCodeModule linux_module("breakpad_unittests");
+  ASSERT_TRUE(resolver.LoadModule(&linux_module, testdata_dir +
+      "/symbols/microdump/breakpad_unittests/"
+      "D6D1FEC9A15DE7F38A236898871A2E770/breakpad_unittests.sym"));
+  ExpectBatchesSameAsFrames(&resolver, &linux_module, 0, 0xa6000, 5);
+
+  // An address in a function with no line for it, then one covered only
+  // by a PUBLIC symbol.
+  uint64_t addresses[] = { 0x1280, 0x2900 };
+  SourceLineResolverInterface::SourceLineInfo infos[2];
+  ASSERT_TRUE(resolver.LookupAddresses(&module1, addresses, 2, infos));
+  EXPECT_STREQ("Function1_3", infos[0].function_name);
+  EXPECT_EQ(0x1200U, infos[0].function_base);
+  EXPECT_TRUE(infos[0].source_file_name == NULL);
+  EXPECT_STREQ("PublicSymbol", infos[1].function_name);
+  EXPECT_EQ(0x2800U, infos[1].function_base);
+
+  uint64_t address = 0x1000;
+  SourceLineResolverInterface::SourceLineInfo info;
+
+  TestCodeModule unloaded_module("unloaded");
+  EXPECT_FALSE(resolver.LookupAddresses(&unloaded_module, &address, 1,
+                                        &info));
+}
+
+TEST_F(TestBasicSourceLineResolver, TestInlinedFrames)
+{
+  // Outer inlines Inlined at a.cc:10, in two pieces, and Inlined inlines
+  // InlinedTwice at b.h:20.
+  string symbols =
+      "MODULE Linux x86_64 000000000000000000000000000000000 inlines\n"
+      "FILE 0 a.cc\n"
+      "FILE 1 b.h\n"
+      "FILE 2 c.h\n"
+      "INLINE_ORIGIN 0 Inlined\n"
+      "INLINE_ORIGIN 1 InlinedTwice\n"
+      "FUNC 1000 100 0 Outer\n"
+      "INLINE 0 10 0 0 1010 30 1080 10\n"
+      "INLINE 1 20 1 1 1020 10\n"
+      "1000 10 5 0\n"
+      "1010 10 15 1\n"
+      "1020 10 25 2\n"
+      "1030 10 16 1\n"
+      "1040 40 11 0\n"
+      "1080 10 17 1\n"
+      "FUNC 2000 10 0 Plain\n"
+      "2000 10 30 0\n";
+  TestCodeModule module("inlines", 0x10000);
+  ASSERT_TRUE(resolver.LoadModuleUsingMapBuffer(&module, symbols));
+  ASSERT_FALSE(resolver.IsModuleCorrupt(&module));
+
+  StackFrame frame;
+  frame.module = &module;
+  frame.instruction = 0x11024;
+  resolver.FillSourceLineInfo(&frame);
+  EXPECT_EQ("Outer", frame.function_name);
+  EXPECT_EQ("c.h", frame.source_file_name);
+  EXPECT_EQ(25, frame.source_line);
+
+  std::vector<StackFrame> inlined;
+  resolver.FillInlinedFrames(&frame, &inlined);
+  ASSERT_EQ(2U, inlined.size());
+  EXPECT_EQ("InlinedTwice", inlined[0].function_name);
+  EXPECT_EQ(0x11020U, inlined[0].function_base);
+  EXPECT_EQ(0x11024U, inlined[0].instruction);
+  EXPECT_EQ("c.h", inlined[0].source_file_name);
+  EXPECT_EQ(25, inlined[0].source_line);
+  EXPECT_EQ("Inlined", inlined[1].function_name);
+  EXPECT_EQ(0x11010U, inlined[1].function_base);
+  EXPECT_EQ("b.h", inlined[1].source_file_name);
+  EXPECT_EQ(20, inlined[1].source_line);
+  EXPECT_EQ("Outer", frame.function_name);
+  EXPECT_EQ(0x11000U, frame.function_base);
+  EXPECT_EQ("a.cc", frame.source_file_name);
+  EXPECT_EQ(10, frame.source_line);
+
+  // The second piece of Inlined.
+  frame = StackFrame();
+  frame.module = &module;
+  frame.instruction = 0x11085;
+  resolver.FillSourceLineInfo(&frame);
+  inlined.clear();
+  resolver.FillInlinedFrames(&frame, &inlined);
+  ASSERT_EQ(1U, inlined.size());
+  EXPECT_EQ("Inlined", inlined[0].function_name);
+  EXPECT_EQ(0x11080U, inlined[0].function_base);
+  EXPECT_EQ("b.h", inlined[0].source_file_name);
+  EXPECT_EQ(17, inlined[0].source_line);
+  EXPECT_EQ("a.cc", frame.source_file_name);
+  EXPECT_EQ(10, frame.source_line);
+
+  // Code that isn't inlined leaves the frame alone.
+  frame = StackFrame();
+  frame.module = &module;
+  frame.instruction = 0x11045;
+  resolver.FillSourceLineInfo(&frame);
+  inlined.clear();
+  resolver.FillInlinedFrames(&frame, &inlined);
+  EXPECT_TRUE(inlined.empty());
+  EXPECT_EQ("a.cc", frame.source_file_name);
+  EXPECT_EQ(11, frame.source_line);
+
+  frame = StackFrame();
+  frame.module = &module;
+  frame.instruction = 0x12005;
+  resolver.FillSourceLineInfo(&frame);
+  resolver.FillInlinedFrames(&frame, &inlined);
+  EXPECT_TRUE(inlined.empty());
+  EXPECT_EQ("Plain", frame.function_name);
+
+  frame.instruction = 0x15000;
+  resolver.FillInlinedFrames(&frame, &inlined);
+  EXPECT_TRUE(inlined.empty());
+
+  // INLINE records outside a function make the module corrupt.
+  TestCodeModule stray_module("stray");
+  ASSERT_TRUE(resolver.LoadModuleUsingMapBuffer(&stray_module,
+      "INLINE_ORIGIN 0 Inlined\n"
+      "INLINE 0 10 0 0 1010 30\n"
+      "FUNC 1000 100 0 Outer\n"));
+  EXPECT_TRUE(resolver.IsModuleCorrupt(&stray_module));
+}
+
 // Test parsing of valid FILE lines.  The format is:
 // FILE <id> <filename>
 TEST(SymbolParseHelper, ParseFileValid) {
@@ -736,6 +1112,113 @@ TEST(SymbolParseHelper, ParsePublicSymbolInvalid) {
                                                     &name));
 }
 
+// Test parsing of valid INLINE_ORIGIN lines.  The format is:
+// INLINE_ORIGIN <origin_id> <name>
+TEST(SymbolParseHelper, ParseInlineOriginValid) {
+  long origin_id;
+  char *name;
+
+  char kTestLine[] = "INLINE_ORIGIN 3 std::vector<int>::size() const";
+  ASSERT_TRUE(SymbolParseHelper::ParseInlineOrigin(kTestLine, &origin_id,
+                                                   &name));
+  EXPECT_EQ(3, origin_id);
+  EXPECT_EQ("std::vector<int>::size() const", string(name));
+}
+
+// Test parsing of invalid INLINE_ORIGIN lines.
+TEST(SymbolParseHelper, ParseInlineOriginInvalid) {
+  long origin_id;
+  char *name;
+
+  // Test missing name.
+  char kTestLine[] = "INLINE_ORIGIN 3";
+  ASSERT_FALSE(SymbolParseHelper::ParseInlineOrigin(kTestLine, &origin_id,
+                                                    &name));
+  // Test negative id.
+  char kTestLine1[] = "INLINE_ORIGIN -3 f";
+  ASSERT_FALSE(SymbolParseHelper::ParseInlineOrigin(kTestLine1, &origin_id,
+                                                    &name));
+  // Test bad id.
+  char kTestLine2[] = "INLINE_ORIGIN x3 f";
+  ASSERT_FALSE(SymbolParseHelper::ParseInlineOrigin(kTestLine2, &origin_id,
+                                                    &name));
+}
+
+// Test parsing of valid INLINE lines.  The format is:
+// INLINE <nest_level> <call_site_line> <call_site_file_id> <origin_id>
+//   <address> <size> [<address> <size> ...]
+TEST(SymbolParseHelper, ParseInlineValid) {
+  long nest_level;
+  long call_site_line;
+  long call_site_file_id;
+  long origin_id;
+  std::vector<std::pair<uint64_t, uint64_t> > ranges;
+
+  char kTestLine[] = "INLINE 1 20 2 7 1a2b 10 3c4d 8";
+  ASSERT_TRUE(SymbolParseHelper::ParseInline(kTestLine, &nest_level,
+                                             &call_site_line,
+                                             &call_site_file_id, &origin_id,
+                                             &ranges));
+  EXPECT_EQ(1, nest_level);
+  EXPECT_EQ(20, call_site_line);
+  EXPECT_EQ(2, call_site_file_id);
+  EXPECT_EQ(7, origin_id);
+  ASSERT_EQ(2U, ranges.size());
+  EXPECT_EQ(0x1a2bULL, ranges[0].first);
+  EXPECT_EQ(0x10ULL, ranges[0].second);
+  EXPECT_EQ(0x3c4dULL, ranges[1].first);
+  EXPECT_EQ(0x8ULL, ranges[1].second);
+
+  // An unknown call site file.
+  char kTestLine1[] = "INLINE 0 0 -1 0 100 1";
+  ASSERT_TRUE(SymbolParseHelper::ParseInline(kTestLine1, &nest_level,
+                                             &call_site_line,
+                                             &call_site_file_id, &origin_id,
+                                             &ranges));
+  EXPECT_EQ(-1, call_site_file_id);
+  ASSERT_EQ(1U, ranges.size());
+}
+
+// Test parsing of invalid INLINE lines.
+TEST(SymbolParseHelper, ParseInlineInvalid) {
+  long nest_level;
+  long call_site_line;
+  long call_site_file_id;
+  long origin_id;
+  std::vector<std::pair<uint64_t, uint64_t> > ranges;
+
+  // Test missing ranges.
+  char kTestLine[] = "INLINE 0 10 0 0";
+  ASSERT_FALSE(SymbolParseHelper::ParseInline(kTestLine, &nest_level,
+                                              &call_site_line,
+                                              &call_site_file_id, &origin_id,
+                                              &ranges));
+  // Test a range without a size.
+  char kTestLine1[] = "INLINE 0 10 0 0 100 10 200";
+  ASSERT_FALSE(SymbolParseHelper::ParseInline(kTestLine1, &nest_level,
+                                              &call_site_line,
+                                              &call_site_file_id, &origin_id,
+                                              &ranges));
+  // Test negative nest level.
+  char kTestLine2[] = "INLINE -1 10 0 0 100 10";
+  ASSERT_FALSE(SymbolParseHelper::ParseInline(kTestLine2, &nest_level,
+                                              &call_site_line,
+                                              &call_site_file_id, &origin_id,
+                                              &ranges));
+  // Test bad call site file.
+  char kTestLine3[] = "INLINE 0 10 -2 0 100 10";
+  ASSERT_FALSE(SymbolParseHelper::ParseInline(kTestLine3, &nest_level,
+                                              &call_site_line,
+                                              &call_site_file_id, &origin_id,
+                                              &ranges));
+  // Test bad address.
+  char kTestLine4[] = "INLINE 0 10 0 0 10z 10";
+  ASSERT_FALSE(SymbolParseHelper::ParseInline(kTestLine4, &nest_level,
+                                              &call_site_line,
+                                              &call_site_file_id, &origin_id,
+                                              &ranges));
+}
+
 }  // namespace
 
 int main(int argc, char *argv[]) {
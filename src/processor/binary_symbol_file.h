@@ -0,0 +1,150 @@
+// Copyright 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// binary_symbol_file.h: The header of binary symbol files.
+//
+// A binary symbol file holds a module serialized by ModuleSerializer, in
+// the layout FastSourceLineResolver uses in place: the table of source
+// file names, then maps sorted by address of the functions (with their
+// lines), public symbols, Windows stack frame info, and STACK CFI rules.
+// It starts with a BinarySymbolFileHeader, which tells it apart from a
+// text symbol file, followed by the identity of the module: the fields of
+// the text symbol file's MODULE and INFO CODE_ID records.  Loading a
+// binary symbol file for a module whose debug identifier differs from the
+// file's fails.
+//
+// The file is written in the byte order of the machine that wrote it. A
+// machine of the other byte order reads a version it doesn't know, and
+// rejects the file.
+//
+// STACK CFI rules are kept as text, as BasicSourceLineResolver keeps them:
+// FastSourceLineResolver compiles the rules of a STACK CFI INIT record the
+// first time it looks up an address the record covers.
+//
+// INLINE and INLINE_ORIGIN records can't be kept; symbol files that have
+// them can't be serialized.
+//
+// dump_syms -b writes binary symbol files, and SimpleSymbolSupplier maps
+// them into memory rather than reading them.  dump_syms writes the text
+// symbol file into memory first and loads it there with
+// BasicSourceLineResolver, so it holds the text, the loaded module and the
+// binary file at once.
+
+#ifndef PROCESSOR_BINARY_SYMBOL_FILE_H__
+#define PROCESSOR_BINARY_SYMBOL_FILE_H__
+
+#include <stddef.h>
+#include <string.h>
+
+#include <string>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
+
+namespace google_breakpad {
+
+static const char kBinarySymbolFileMagic[8] = {
+  'B', 'P', 'S', 'Y', 'M', 'B', 'I', 'N'
+};
+
+// The version of the serialized module layout.  Bump it whenever
+// ModuleSerializer changes what it writes.
+//
+// Version 2 adds search indexes to the maps; readers of version 2 read
+// version 1 files too.  Version 3 adds the module's identity after the
+// header; files of earlier versions have none.
+static const uint32_t kBinarySymbolFileVersion = 3;
+
+// The oldest version FastSourceLineResolver still reads.
+static const uint32_t kOldestBinarySymbolFileVersion = 1;
+
+struct BinarySymbolFileHeader {
+  char magic[8];         // kBinarySymbolFileMagic
+  uint32_t version;      // kBinarySymbolFileVersion
+  uint32_t info_size;    // The size of the module's identity that follows.
+                         // A multiple of 8; zero before version 3.
+  uint64_t module_size;  // The size of the serialized module that follows
+                         // the identity.
+};
+
+// The identity of the module a binary symbol file holds.  It follows the
+// header as the fields' null-terminated strings, in this order, padded
+// with zeros to a multiple of 8 bytes.  A field the text symbol file had
+// no record for is empty.
+struct BinarySymbolFileModuleInfo {
+  string os;        // MODULE <os> <arch> <debug id> <name>
+  string arch;
+  string debug_id;
+  string name;
+  string code_id;   // INFO CODE_ID <code id> [<code file>]
+};
+
+// Returns true if the |size| bytes at |data| start with a binary symbol
+// file header.  The header may still be of an unknown version.
+inline bool IsBinarySymbolFile(const char *data, size_t size) {
+  return data && size >= sizeof(BinarySymbolFileHeader) &&
+         memcmp(data, kBinarySymbolFileMagic,
+                sizeof(kBinarySymbolFileMagic)) == 0;
+}
+
+// Reads the header and module identity of the binary symbol file of
+// |size| bytes at |data| into *header and *info.  Returns false if the
+// file is not a binary symbol file, or is too short to hold them.  The
+// header may still be of an unknown version.
+inline bool ReadBinarySymbolFileHeader(const char *data, size_t size,
+                                       BinarySymbolFileHeader *header,
+                                       BinarySymbolFileModuleInfo *info) {
+  if (!IsBinarySymbolFile(data, size))
+    return false;
+  memcpy(header, data, sizeof(*header));
+  if (header->info_size > size - sizeof(*header))
+    return false;
+  const char *cursor = data + sizeof(*header);
+  const char *end = cursor + header->info_size;
+  string *fields[] = {
+    &info->os, &info->arch, &info->debug_id, &info->name, &info->code_id
+  };
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+    const char *terminator =
+        cursor < end ? static_cast<const char*>(
+                           memchr(cursor, '\0', end - cursor))
+                     : NULL;
+    if (!terminator) {
+      fields[i]->clear();
+      continue;
+    }
+    fields[i]->assign(cursor, terminator - cursor);
+    cursor = terminator + 1;
+  }
+  return true;
+}
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_BINARY_SYMBOL_FILE_H__
@@ -36,10 +36,25 @@
 #ifndef PROCESSOR_CFI_FRAME_INFO_INL_H_
 #define PROCESSOR_CFI_FRAME_INFO_INL_H_
 
+#include <assert.h>
 #include <string.h>
 
 namespace google_breakpad {
 
+template <typename RegisterType, class RawContextType>
+SimpleCFIWalker<RegisterType, RawContextType>::SimpleCFIWalker(
+    const RegisterSet *register_map, size_t map_size)
+    : register_map_(register_map),
+      map_size_(map_size),
+      names_(2 * map_size) {
+  assert(names_.size() <=
+         static_cast<size_t>(PostfixProgram::kMaxIdentifiers));
+  for (size_t i = 0; i < map_size_; i++) {
+    names_[i] = register_map_[i].name;
+    names_[map_size_ + i] = register_map_[i].alternate_name;
+  }
+}
+
 template <typename RegisterType, class RawContextType>
 bool SimpleCFIWalker<RegisterType, RawContextType>::FindCallerRegisters(
     const MemoryRegion &memory,
@@ -48,22 +63,20 @@ bool SimpleCFIWalker<RegisterType, RawContextType>::FindCallerRegisters(
     int callee_validity,
     RawContextType *caller_context,
     int *caller_validity) const {
-  typedef CFIFrameInfo::RegisterValueMap<RegisterType> ValueMap;
-  ValueMap callee_registers;
-  ValueMap caller_registers;
-  // Just for brevity.
-  typename ValueMap::const_iterator caller_none = caller_registers.end();
+  PostfixRegisterFile<RegisterType> callee_registers;
+  PostfixRegisterFile<RegisterType> caller_registers;
 
   // Populate callee_registers with register values from callee_context.
   for (size_t i = 0; i < map_size_; i++) {
     const RegisterSet &r = register_map_[i];
     if (callee_validity & r.validity_flag)
-      callee_registers[r.name] = callee_context.*r.context_member;
+      callee_registers.Set(i, callee_context.*r.context_member);
   }
 
   // Apply the rules, and see what register values they yield.
-  if (!cfi_frame_info.FindCallerRegs<RegisterType>(callee_registers, memory,
-                                                   &caller_registers))
+  if (!cfi_frame_info.FindCallerRegs<RegisterType>(
+          &names_[0], static_cast<int>(names_.size()), callee_registers,
+          memory, &caller_registers))
     return false;
 
   // Populate *caller_context with the values the rules placed in
@@ -72,27 +85,17 @@ bool SimpleCFIWalker<RegisterType, RawContextType>::FindCallerRegisters(
   *caller_validity = 0;
   for (size_t i = 0; i < map_size_; i++) {
     const RegisterSet &r = register_map_[i];
-    typename ValueMap::const_iterator caller_entry;
+    RegisterType value;
 
-    // Did the rules provide a value for this register by its name?
-    caller_entry = caller_registers.find(r.name);
-    if (caller_entry != caller_none) {
-      caller_context->*r.context_member = caller_entry->second;
+    // Did the rules provide a value for this register by its name, or
+    // under its alternate name?
+    if (caller_registers.Get(i, &value) ||
+        caller_registers.Get(map_size_ + i, &value)) {
+      caller_context->*r.context_member = value;
       *caller_validity |= r.validity_flag;
       continue;
     }
 
-    // Did the rules provide a value for this register under its
-    // alternate name?
-    if (r.alternate_name) {
-      caller_entry = caller_registers.find(r.alternate_name);
-      if (caller_entry != caller_none) {
-        caller_context->*r.context_member = caller_entry->second;
-        *caller_validity |= r.validity_flag;
-        continue;
-      }
-    }
-
     // Is this a callee-saves register? The walker assumes that these
     // still hold the caller's value if the CFI doesn't mention them.
     //
@@ -36,10 +36,10 @@
 
 #include <string.h>
 
+#include <algorithm>
 #include <sstream>
 
 #include "common/scoped_ptr.h"
-#include "processor/postfix_evaluator-inl.h"
 
 namespace google_breakpad {
 
@@ -47,48 +47,275 @@ namespace google_breakpad {
 #define strtok_r strtok_s
 #endif
 
+namespace {
+
+// A handler for rule set parsing that adds the rules to a CFIRuleSet.
+class CFIRuleSetParseHandler: public CFIRuleParser::Handler {
+ public:
+  explicit CFIRuleSetParseHandler(CFIRuleSet *rule_set)
+      : rule_set_(rule_set) { }
+
+  void CFARule(const string &expression) {
+    rule_set_->AddCFARule(expression);
+  }
+  void RARule(const string &expression) {
+    rule_set_->AddRARule(expression);
+  }
+  void RegisterRule(const string &name, const string &expression) {
+    rule_set_->AddRegisterRule(name, expression);
+  }
+
+ private:
+  CFIRuleSet *rule_set_;
+};
+
+// Stores the values FindCallerRegs recovers in a map, by name.
+template<typename V>
+class StoreByName {
+ public:
+  StoreByName(const std::vector<string> &targets,
+              CFIFrameInfo::RegisterValueMap<V> *registers)
+      : targets_(targets), registers_(registers) { }
+
+  void Set(size_t target, V value) { (*registers_)[targets_[target]] = value; }
+
+ private:
+  const std::vector<string> &targets_;
+  CFIFrameInfo::RegisterValueMap<V> *registers_;
+};
+
+// Returns the number NAMES gives NAME, or -1 if it has none.
+int NameNumber(const char *const *names, int name_count, const string &name) {
+  for (int i = 0; i < name_count; ++i) {
+    if (names[i] && name == names[i])
+      return i;
+  }
+  return -1;
+}
+
+// Stores the values FindCallerRegs recovers in a register file, by the
+// number a caller's table of names gives them.
+template<typename V>
+class StoreByNumber {
+ public:
+  StoreByNumber(const std::vector<string> &targets,
+                const char *const *names, int name_count,
+                PostfixRegisterFile<V> *registers)
+      : targets_(targets), names_(names), name_count_(name_count),
+        registers_(registers) { }
+
+  void Set(size_t target, V value) {
+    int number = NameNumber(names_, name_count_, targets_[target]);
+    if (number >= 0)
+      registers_->Set(number, value);
+  }
+
+ private:
+  const std::vector<string> &targets_;
+  const char *const *names_;
+  int name_count_;
+  PostfixRegisterFile<V> *registers_;
+};
+
+}  // namespace
+
+CFIRuleSet::CFIRuleSet() : cfa_identifier_(-1) {
+  targets_.push_back(".cfa");
+  targets_.push_back(".ra");
+}
+
+CFIRuleSet::CFIRuleSet(const CFIRuleSet &other, size_t rule_count)
+    : targets_(other.targets_),
+      identifiers_(other.identifiers_),
+      cfa_identifier_(other.cfa_identifier_),
+      rules_(other.rules_.begin(), other.rules_.begin() + rule_count) { }
+
+void CFIRuleSet::AddRegisterRule(const string &name,
+                                 const string &expression) {
+  size_t target = 0;
+  while (target < targets_.size() && targets_[target] != name)
+    ++target;
+  if (target == targets_.size())
+    targets_.push_back(name);
+  AddRule(static_cast<int>(target), expression);
+}
+
+bool CFIRuleSet::AddRules(const string &rule_set) {
+  CFIRuleSetParseHandler handler(this);
+  CFIRuleParser parser(&handler);
+  return parser.Parse(rule_set);
+}
+
+void CFIRuleSet::MarkDelta(uint64_t address) {
+  deltas_.push_back(std::make_pair(address, rules_.size()));
+}
+
+size_t CFIRuleSet::RuleCountAt(uint64_t address) const {
+  std::vector<std::pair<uint64_t, size_t> >::const_iterator delta =
+      std::upper_bound(deltas_.begin(), deltas_.end(),
+                       std::make_pair(address, rules_.size()));
+  return delta == deltas_.end() ? rules_.size() : delta->second;
+}
+
+void CFIRuleSet::AddRule(int target, const string &expression) {
+  std::vector<const char *> names(identifiers_.size());
+  for (size_t i = 0; i < identifiers_.size(); ++i)
+    names[i] = identifiers_[i].c_str();
+
+  Rule rule;
+  rule.target = target;
+  rule.program.Compile(expression, names.empty() ? NULL : &names[0],
+                       static_cast<int>(names.size()));
+
+  // Compile numbers the identifiers not yet in the table after it, in
+  // order of first appearance; add them in that order.
+  size_t known = identifiers_.size();
+  for (int i = 0; i < rule.program.identifier_count(); ++i) {
+    size_t number = rule.program.identifier_number(i);
+    if (number < known)
+      continue;
+    if (identifiers_.size() <= number)
+      identifiers_.resize(number + 1);
+    identifiers_[number] = rule.program.identifier_name(i);
+    if (identifiers_[number] == ".cfa")
+      cfa_identifier_ = static_cast<int>(number);
+  }
+
+  rules_.push_back(rule);
+}
+
+CFIFrameInfo::CFIFrameInfo()
+    : rules_(new CFIRuleSet), rule_count_(0), owns_rules_(true) { }
+
+CFIFrameInfo::CFIFrameInfo(const std::shared_ptr<const CFIRuleSet> &rules,
+                           uint64_t address)
+    : rules_(rules),
+      rule_count_(rules->RuleCountAt(address)),
+      owns_rules_(false) { }
+
+void CFIFrameInfo::SetCFARule(const string &expression) {
+  MutableRules()->AddCFARule(expression);
+  ++rule_count_;
+}
+
+void CFIFrameInfo::SetRARule(const string &expression) {
+  MutableRules()->AddRARule(expression);
+  ++rule_count_;
+}
+
+void CFIFrameInfo::SetRegisterRule(const string &register_name,
+                                   const string &expression) {
+  MutableRules()->AddRegisterRule(register_name, expression);
+  ++rule_count_;
+}
+
+CFIRuleSet *CFIFrameInfo::MutableRules() {
+  // Copy rules that are shared, or that are only partly in effect.
+  if (!owns_rules_ || rules_.use_count() != 1) {
+    rules_.reset(new CFIRuleSet(*rules_, rule_count_));
+    owns_rules_ = true;
+  }
+  return const_cast<CFIRuleSet *>(rules_.get());
+}
+
+void CFIFrameInfo::FindEffectiveRules(std::vector<int> *effective) const {
+  effective->assign(rules_->targets_.size(), -1);
+  for (size_t i = 0; i < rule_count_; ++i)
+    (*effective)[rules_->rules_[i].target] = static_cast<int>(i);
+}
+
+template<typename V, class Store>
+bool CFIFrameInfo::ApplyRules(const std::vector<int> &effective,
+                              PostfixRegisterFile<V> *callee,
+                              const MemoryRegion &memory,
+                              Store *store) const {
+  const CFIRuleSet &rules = *rules_;
+
+  // First, compute the CFA. Each rule is evaluated on its own copy of the
+  // registers, so that assignments only affect that evaluation.
+  PostfixRegisterFile<V> working(*callee);
+  V cfa;
+  if (!rules.rules_[effective[CFIRuleSet::kCFATarget]].program.Evaluate(
+          &working, &memory, &cfa))
+    return false;
+  if (rules.cfa_identifier_ >= 0)
+    callee->Set(rules.cfa_identifier_, cfa);
+
+  // Then, compute the return address and the registers with rules.
+  for (size_t target = CFIRuleSet::kRATarget; target < effective.size();
+       ++target) {
+    if (effective[target] < 0)
+      continue;
+    working = *callee;
+    V value;
+    if (!rules.rules_[effective[target]].program.Evaluate(&working, &memory,
+                                                          &value))
+      return false;
+    store->Set(target, value);
+  }
+
+  store->Set(CFIRuleSet::kCFATarget, cfa);
+
+  return true;
+}
+
 template<typename V>
 bool CFIFrameInfo::FindCallerRegs(const RegisterValueMap<V> &registers,
                                   const MemoryRegion &memory,
                                   RegisterValueMap<V> *caller_registers) const {
+  const CFIRuleSet &rules = *rules_;
+  std::vector<int> effective;
+  FindEffectiveRules(&effective);
+
   // If there are not rules for both .ra and .cfa in effect at this address,
   // don't use this CFI data for stack walking.
-  if (cfa_rule_.empty() || ra_rule_.empty())
+  if (effective[CFIRuleSet::kCFATarget] < 0 ||
+      effective[CFIRuleSet::kRATarget] < 0)
     return false;
 
-  RegisterValueMap<V> working;
-  PostfixEvaluator<V> evaluator(&working, &memory);
-
   caller_registers->clear();
 
-  // First, compute the CFA.
-  V cfa;
-  working = registers;
-  if (!evaluator.EvaluateForValue(cfa_rule_, &cfa))
-    return false;
+  // Look up each register the rules name once, for all the rules.
+  PostfixRegisterFile<V> callee;
+  for (size_t i = 0; i < rules.identifiers_.size(); ++i) {
+    typename RegisterValueMap<V>::const_iterator it =
+        registers.find(rules.identifiers_[i]);
+    if (it != registers.end())
+      callee.Set(static_cast<int>(i), it->second);
+  }
+
+  StoreByName<V> store(rules.targets_, caller_registers);
+  return ApplyRules(effective, &callee, memory, &store);
+}
 
-  // Then, compute the return address.
-  V ra;
-  working = registers;
-  working[".cfa"] = cfa;
-  if (!evaluator.EvaluateForValue(ra_rule_, &ra))
+template<typename V>
+bool CFIFrameInfo::FindCallerRegs(const char *const *names, int name_count,
+                                  const PostfixRegisterFile<V> &registers,
+                                  const MemoryRegion &memory,
+                                  PostfixRegisterFile<V> *caller_registers)
+    const {
+  const CFIRuleSet &rules = *rules_;
+  std::vector<int> effective;
+  FindEffectiveRules(&effective);
+
+  if (effective[CFIRuleSet::kCFATarget] < 0 ||
+      effective[CFIRuleSet::kRATarget] < 0)
     return false;
 
-  // Now, compute values for all the registers register_rules_ mentions.
-  for (RuleMap::const_iterator it = register_rules_.begin();
-       it != register_rules_.end(); it++) {
+  *caller_registers = PostfixRegisterFile<V>();
+
+  // Renumber the registers the rules name from the caller's numbering to
+  // the rules'.
+  PostfixRegisterFile<V> callee;
+  for (size_t i = 0; i < rules.identifiers_.size(); ++i) {
+    int number = NameNumber(names, name_count, rules.identifiers_[i]);
     V value;
-    working = registers;
-    working[".cfa"] = cfa;
-    if (!evaluator.EvaluateForValue(it->second, &value))
-      return false;
-    (*caller_registers)[it->first] = value;
+    if (number >= 0 && registers.Get(number, &value))
+      callee.Set(static_cast<int>(i), value);
   }
 
-  (*caller_registers)[".ra"] = ra;
-  (*caller_registers)[".cfa"] = cfa;
-
-  return true;
+  StoreByNumber<V> store(rules.targets_, names, name_count, caller_registers);
+  return ApplyRules(effective, &callee, memory, &store);
 }
 
 // Explicit instantiations for 32-bit and 64-bit architectures.
@@ -100,24 +327,50 @@ template bool CFIFrameInfo::FindCallerRegs<uint64_t>(
     const RegisterValueMap<uint64_t> &registers,
     const MemoryRegion &memory,
     RegisterValueMap<uint64_t> *caller_registers) const;
+template bool CFIFrameInfo::FindCallerRegs<uint32_t>(
+    const char *const *names, int name_count,
+    const PostfixRegisterFile<uint32_t> &registers,
+    const MemoryRegion &memory,
+    PostfixRegisterFile<uint32_t> *caller_registers) const;
+template bool CFIFrameInfo::FindCallerRegs<uint64_t>(
+    const char *const *names, int name_count,
+    const PostfixRegisterFile<uint64_t> &registers,
+    const MemoryRegion &memory,
+    PostfixRegisterFile<uint64_t> *caller_registers) const;
 
 string CFIFrameInfo::Serialize() const {
+  std::vector<int> effective;
+  FindEffectiveRules(&effective);
+
+  // List .cfa and .ra first, then the registers by name.
+  map<string, int> register_rules;
+  for (size_t target = CFIRuleSet::kRATarget + 1; target < effective.size();
+       ++target) {
+    if (effective[target] >= 0)
+      register_rules[rules_->targets_[target]] = effective[target];
+  }
+
   std::ostringstream stream;
 
-  if (!cfa_rule_.empty()) {
-    stream << ".cfa: " << cfa_rule_;
+  if (effective[CFIRuleSet::kCFATarget] >= 0) {
+    stream << ".cfa: "
+           << rules_->rules_[effective[CFIRuleSet::kCFATarget]]
+                  .program.expression();
   }
-  if (!ra_rule_.empty()) {
+  if (effective[CFIRuleSet::kRATarget] >= 0) {
     if (static_cast<std::streamoff>(stream.tellp()) != 0)
       stream << " ";
-    stream << ".ra: " << ra_rule_;
+    stream << ".ra: "
+           << rules_->rules_[effective[CFIRuleSet::kRATarget]]
+                  .program.expression();
   }
-  for (RuleMap::const_iterator iter = register_rules_.begin();
-       iter != register_rules_.end();
+  for (map<string, int>::const_iterator iter = register_rules.begin();
+       iter != register_rules.end();
        ++iter) {
     if (static_cast<std::streamoff>(stream.tellp()) != 0)
       stream << " ";
-    stream << iter->first << ": " << iter->second;
+    stream << iter->first << ": "
+           << rules_->rules_[iter->second].program.expression();
   }
 
   return stream.str();
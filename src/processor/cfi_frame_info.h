@@ -39,10 +39,14 @@
 #define PROCESSOR_CFI_FRAME_INFO_H_
 
 #include <map>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
+#include "processor/postfix_program.h"
 
 namespace google_breakpad {
 
@@ -50,6 +54,82 @@ using std::map;
 
 class MemoryRegion;
 
+// The rules of a 'STACK CFI INIT' record and the 'STACK CFI' records
+// that follow it, compiled once so that they can be applied at any
+// instruction the INIT record covers.
+//
+// The register names the rules' expressions mention are numbered in one
+// table shared by all the rules, so that a caller resolves each name to
+// its value once per frame, rather than once per rule. Rules are held in
+// the order they were added; the rules in effect at an address are those
+// added before the first delta marked past it, with later rules for a
+// register replacing earlier ones.
+class CFIRuleSet {
+ public:
+  CFIRuleSet();
+
+  // Copy the first RULE_COUNT rules of OTHER, without its delta marks.
+  CFIRuleSet(const CFIRuleSet &other, size_t rule_count);
+
+  // Add a rule computing the call frame address, the return address, or
+  // the value of the register named NAME. A rule whose expression fails to
+  // compile, for example because the rule set names more than
+  // PostfixProgram::kMaxIdentifiers registers, is kept, but fails to
+  // evaluate.
+  void AddCFARule(const string &expression) { AddRule(kCFATarget, expression); }
+  void AddRARule(const string &expression) { AddRule(kRATarget, expression); }
+  void AddRegisterRule(const string &name, const string &expression);
+
+  // Parse RULE_SET, in the format of a STACK CFI record, and add its rules.
+  // Return false if it doesn't parse; any rules before the error are kept.
+  bool AddRules(const string &rule_set);
+
+  // Record that the rules added from here on take effect at ADDRESS.
+  // Deltas must be marked in increasing address order.
+  void MarkDelta(uint64_t address);
+
+  // Return the number of rules in effect at ADDRESS.
+  size_t RuleCountAt(uint64_t address) const;
+
+  // Return the number of rules added so far.
+  size_t rule_count() const { return rules_.size(); }
+
+ private:
+  friend class CFIFrameInfo;
+
+  // The targets of the CFA and RA rules in targets_.
+  static const int kCFATarget = 0;
+  static const int kRATarget = 1;
+
+  struct Rule {
+    // The rule's target, as an index into targets_.
+    int target;
+
+    // The rule's expression, with the identifiers it names numbered by
+    // their position in identifiers_.
+    PostfixProgram program;
+  };
+
+  void AddRule(int target, const string &expression);
+
+  // The names of the registers rules compute, starting with ".cfa" and
+  // ".ra".
+  std::vector<string> targets_;
+
+  // The names of the identifiers the rules' expressions mention. Names are
+  // only ever added, so the numbering of rules already compiled holds.
+  std::vector<string> identifiers_;
+
+  // The position of ".cfa" in identifiers_, or -1 if no rule mentions it.
+  int cfa_identifier_;
+
+  std::vector<Rule> rules_;
+
+  // The address of each delta marked, and the number of rules added
+  // before it.
+  std::vector<std::pair<uint64_t, size_t> > deltas_;
+};
+
 // A set of rules for recovering the calling frame's registers'
 // values, when the PC is at a given address in the current frame's
 // function. See the description of 'STACK CFI' records at:
@@ -57,26 +137,32 @@ class MemoryRegion;
 // https://chromium.googlesource.com/breakpad/breakpad/+/master/docs/symbol_files.md
 //
 // To prepare an instance of CFIFrameInfo for use at a given
-// instruction, first populate it with the rules from the 'STACK CFI
-// INIT' record that covers that instruction, and then apply the
-// changes given by the 'STACK CFI' records up to our instruction's
-// address. Then, use the FindCallerRegs member function to apply the
-// rules to the callee frame's register values, yielding the caller
-// frame's register values.
+// instruction, either populate it with the rules from the 'STACK CFI
+// INIT' record that covers that instruction and then apply the changes
+// given by the 'STACK CFI' records up to our instruction's address, or
+// construct it from a CFIRuleSet holding those records, compiled. Then,
+// use the FindCallerRegs member function to apply the rules to the
+// callee frame's register values, yielding the caller frame's register
+// values.
 class CFIFrameInfo {
  public:
   // A map from register names onto values.
   template<typename ValueType> class RegisterValueMap: 
     public map<string, ValueType> { };
 
+  // An empty set of rules.
+  CFIFrameInfo();
+
+  // The rules of RULES in effect at ADDRESS. RULES is shared, not copied.
+  CFIFrameInfo(const std::shared_ptr<const CFIRuleSet> &rules,
+               uint64_t address);
+
   // Set the expression for computing a call frame address, return
   // address, or register's value. At least the CFA rule and the RA
   // rule must be set before calling FindCallerRegs.
-  void SetCFARule(const string &expression) { cfa_rule_ = expression; }
-  void SetRARule(const string &expression)  { ra_rule_ = expression; }
-  void SetRegisterRule(const string &register_name, const string &expression) {
-    register_rules_[register_name] = expression;
-  }
+  void SetCFARule(const string &expression);
+  void SetRARule(const string &expression);
+  void SetRegisterRule(const string &register_name, const string &expression);
 
   // Compute the values of the calling frame's registers, according to
   // this rule set. Use ValueType in expression evaluation; this
@@ -100,38 +186,49 @@ class CFIFrameInfo {
                       const MemoryRegion &memory,
                       RegisterValueMap<ValueType> *caller_registers) const;
 
+  // The same, for a stack walker that numbers registers itself, and so can
+  // fill REGISTERS straight from its context rather than build a map of
+  // names. NAMES[i], for i less than NAME_COUNT, is the name of the
+  // register numbered i, or NULL if no name has that number; NAME_COUNT
+  // must not exceed PostfixProgram::kMaxIdentifiers. REGISTERS holds the
+  // current frame's known values by number. CALLER_REGISTERS is set to the
+  // values recovered for the names in NAMES, ".ra" and ".cfa" included.
+  template<typename ValueType>
+  bool FindCallerRegs(const char *const *names, int name_count,
+                      const PostfixRegisterFile<ValueType> &registers,
+                      const MemoryRegion &memory,
+                      PostfixRegisterFile<ValueType> *caller_registers) const;
+
   // Serialize the rules in this object into a string in the format
   // of STACK CFI records.
   string Serialize() const;
 
  private:
-
-  // A map from register names onto evaluation rules. 
-  typedef map<string, string> RuleMap;
-
-  // In this type, a "postfix expression" is an expression of the sort
-  // interpreted by google_breakpad::PostfixEvaluator.
-
-  // A postfix expression for computing the current frame's CFA (call
-  // frame address). The CFA is a reference address for the frame that
-  // remains unchanged throughout the frame's lifetime. You should
-  // evaluate this expression with a dictionary initially populated
-  // with the values of the current frame's known registers.
-  string cfa_rule_;
-
-  // The following expressions should be evaluated with a dictionary
-  // initially populated with the values of the current frame's known
-  // registers, and with ".cfa" set to the result of evaluating the
-  // cfa_rule expression, above.
-
-  // A postfix expression for computing the current frame's return
-  // address. 
-  string ra_rule_;
-
-  // For a register named REG, rules[REG] is a postfix expression
-  // which leaves the value of REG in the calling frame on the top of
-  // the stack. You should evaluate this expression
-  RuleMap register_rules_;
+  // Return a rule set this object alone holds, to add a rule to.
+  CFIRuleSet *MutableRules();
+
+  // Set (*effective)[TARGET] to the index in rules_ of the rule in effect
+  // for each target, or -1 if there is none.
+  void FindEffectiveRules(std::vector<int> *effective) const;
+
+  // Compute the caller's registers with the rules EFFECTIVE lists, given
+  // CALLEE, the values of the rules' identifiers, numbered as in rules_.
+  // Pass each target's number in rules_ and value to STORE->Set.
+  template<typename ValueType, class Store>
+  bool ApplyRules(const std::vector<int> &effective,
+                  PostfixRegisterFile<ValueType> *callee,
+                  const MemoryRegion &memory, Store *store) const;
+
+  // The rules, possibly shared with the resolver that compiled them and
+  // other CFIFrameInfo objects.
+  std::shared_ptr<const CFIRuleSet> rules_;
+
+  // The number of rules_' rules in effect.
+  size_t rule_count_;
+
+  // True if this object made rules_, and may add to it if nothing else
+  // shares it.
+  bool owns_rules_;
 };
 
 // A parser for STACK CFI-style rule sets.
@@ -240,8 +337,7 @@ class SimpleCFIWalker {
   // architecture's register set. REGISTER_MAP is an array of
   // RegisterSet structures; MAP_SIZE is the number of elements in the
   // array.
-  SimpleCFIWalker(const RegisterSet *register_map, size_t map_size)
-      : register_map_(register_map), map_size_(map_size) { }
+  SimpleCFIWalker(const RegisterSet *register_map, size_t map_size);
 
   // Compute the calling frame's raw context given the callee's raw
   // context.
@@ -266,6 +362,10 @@ class SimpleCFIWalker {
  private:
   const RegisterSet *register_map_;
   size_t map_size_;
+
+  // The names CFIFrameInfo::FindCallerRegs numbers registers by: that of
+  // register_map_[i] is numbered i, and its alternate name map_size_ + i.
+  std::vector<const char *> names_;
 };
 
 }  // namespace google_breakpad
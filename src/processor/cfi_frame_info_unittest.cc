@@ -42,7 +42,10 @@
 using google_breakpad::CFIFrameInfo;
 using google_breakpad::CFIFrameInfoParseHandler;
 using google_breakpad::CFIRuleParser;
+using google_breakpad::CFIRuleSet;
 using google_breakpad::MemoryRegion;
+using google_breakpad::PostfixProgram;
+using google_breakpad::PostfixRegisterFile;
 using google_breakpad::SimpleCFIWalker;
 using testing::_;
 using testing::A;
@@ -290,6 +293,243 @@ TEST_F(Scope, SeparateTempsRA) {
                                              &caller_registers));
 }
 
+// The index-based FindCallerRegs reads and writes registers by the
+// numbers the caller's table of names gives them.
+class Numbered: public CFIFixture, public Test { };
+
+TEST_F(Numbered, RegsSeeRegs) {
+  ExpectNoMemoryReferences();
+
+  static const char *const names[] = { "$r0", "$r1", NULL, "$r2", ".cfa",
+                                       ".ra" };
+  PostfixRegisterFile<uint64_t> callee, caller;
+  callee.Set(1, 0x6ed3582c4bedb9adULL);
+  callee.Set(3, 0xd27d9e742b8df6d0ULL);
+  cfi.SetCFARule("$r1 8 +");
+  cfi.SetRARule(".cfa 30503835 +");
+  cfi.SetRegisterRule("$r1", "$r1 42175211 = $r2");
+  cfi.SetRegisterRule("$r2", "$r2 21357221 = $r1");
+  cfi.SetRegisterRule("$r9", "1");
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(names, 6, callee, memory,
+                                            &caller));
+  uint64_t value;
+  EXPECT_FALSE(caller.Get(0, &value));
+  ASSERT_TRUE(caller.Get(1, &value));
+  EXPECT_EQ(0xd27d9e742b8df6d0ULL, value);
+  EXPECT_FALSE(caller.Get(2, &value));
+  ASSERT_TRUE(caller.Get(3, &value));
+  EXPECT_EQ(0x6ed3582c4bedb9adULL, value);
+  ASSERT_TRUE(caller.Get(4, &value));
+  EXPECT_EQ(0x6ed3582c4bedb9b5ULL, value);
+  ASSERT_TRUE(caller.Get(5, &value));
+  EXPECT_EQ(0x6ed3582c4bedb9b5ULL + 30503835, value);
+
+  // The same rules, through the named form.
+  registers["$r1"] = 0x6ed3582c4bedb9adULL;
+  registers["$r2"] = 0xd27d9e742b8df6d0ULL;
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                            &caller_registers));
+  EXPECT_EQ(caller_registers["$r1"], caller.value(1));
+  EXPECT_EQ(caller_registers["$r2"], caller.value(3));
+  EXPECT_EQ(caller_registers[".cfa"], caller.value(4));
+  EXPECT_EQ(caller_registers[".ra"], caller.value(5));
+}
+
+TEST_F(Numbered, NoRA) {
+  ExpectNoMemoryReferences();
+
+  static const char *const names[] = { ".cfa", ".ra" };
+  PostfixRegisterFile<uint64_t> callee, caller;
+  cfi.SetCFARule("1");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(names, 2, callee, memory,
+                                             &caller));
+}
+
+// Rules are compiled when set; check that evaluating them follows
+// PostfixEvaluator.
+class Compiled: public CFIFixture, public Test { };
+
+TEST_F(Compiled, Operators) {
+  ExpectNoMemoryReferences();
+
+  registers["$r1"] = 100;
+  cfi.SetCFARule("$r1 7 * 3 - 4 /");
+  cfi.SetRARule(".cfa 4 %");
+  cfi.SetRegisterRule("$r2", "-5 $r1 +");
+  cfi.SetRegisterRule("$r3", "$r1 16 @");
+  cfi.SetRegisterRule("$r4", "+5 -+3 +");
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                            &caller_registers));
+  ASSERT_EQ(174U, caller_registers[".cfa"]);
+  ASSERT_EQ(2U, caller_registers[".ra"]);
+  ASSERT_EQ(95U, caller_registers["$r2"]);
+  ASSERT_EQ(96U, caller_registers["$r3"]);
+  ASSERT_EQ(2U, caller_registers["$r4"]);
+
+  // "0x10" is not a literal, but a register no one defines.
+  cfi.SetRARule(".cfa 0x10 @");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                             &caller_registers));
+}
+
+TEST_F(Compiled, Dereference) {
+  EXPECT_CALL(memory, GetMemoryAtAddress(0x1010, A<uint64_t *>()))
+      .WillRepeatedly(DoAll(SetArgumentPointee<1>(0xfeedbeefULL),
+                            Return(true)));
+  EXPECT_CALL(memory, GetMemoryAtAddress(0x2000, A<uint64_t *>()))
+      .WillRepeatedly(Return(false));
+
+  registers["$sp"] = 0x1000;
+  cfi.SetCFARule("$sp 16 +");
+  cfi.SetRARule(".cfa ^");
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                            &caller_registers));
+  ASSERT_EQ(0xfeedbeefU, caller_registers[".ra"]);
+
+  cfi.SetRARule("8192 ^");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                             &caller_registers));
+}
+
+TEST_F(Compiled, Assignment) {
+  ExpectNoMemoryReferences();
+
+  // The assignment operator may be smashed up against the next token.
+  registers["$r1"] = 10;
+  cfi.SetCFARule("$t $r1 5 + =$u $t 2 * = $u");
+  cfi.SetRARule("$r1");
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                            &caller_registers));
+  ASSERT_EQ(30U, caller_registers[".cfa"]);
+
+  // Only names starting with '$' can be assigned to.
+  cfi.SetCFARule("t 5 = 0");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                             &caller_registers));
+  cfi.SetCFARule("5 5 = 0");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                             &caller_registers));
+}
+
+TEST_F(Compiled, Errors) {
+  ExpectNoMemoryReferences();
+
+  cfi.SetRARule("0");
+  const char *bad_rules[] = {
+    "1 +", "1 2", "", "^", "1 0 /", "1 0 %", "$undefined",
+    "18446744073709551616"
+  };
+  for (size_t i = 0; i < sizeof(bad_rules) / sizeof(*bad_rules); ++i) {
+    cfi.SetCFARule(bad_rules[i]);
+    ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                               &caller_registers))
+        << bad_rules[i];
+  }
+
+  // A literal too large for the address size is not a literal.
+  CFIFrameInfo::RegisterValueMap<uint32_t> registers32, caller_registers32;
+  cfi.SetCFARule("4294967296");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint32_t>(registers32, memory,
+                                             &caller_registers32));
+  cfi.SetCFARule("4294967295 -1 +");
+  ASSERT_TRUE(cfi.FindCallerRegs<uint32_t>(registers32, memory,
+                                            &caller_registers32));
+  ASSERT_EQ(4294967294U, caller_registers32[".cfa"]);
+}
+
+TEST_F(Compiled, Limits) {
+  ExpectNoMemoryReferences();
+
+  const int kMaxStackDepth = PostfixProgram::kMaxStackDepth;
+  const int kMaxIdentifiers = PostfixProgram::kMaxIdentifiers;
+  cfi.SetRARule("0");
+  string deep, wide;
+  for (int i = 0; i < kMaxStackDepth; ++i)
+    deep += "1 ";
+  for (int i = 1; i < kMaxStackDepth; ++i)
+    deep += "+ ";
+  for (int i = 0; i < kMaxIdentifiers; ++i) {
+    wide += "$r" + std::to_string(i) + " ";
+    registers["$r" + std::to_string(i)] = i;
+  }
+  for (int i = 1; i < kMaxIdentifiers; ++i)
+    wide += "+ ";
+  cfi.SetCFARule(deep);
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                            &caller_registers));
+  ASSERT_EQ(static_cast<uint64_t>(kMaxStackDepth), caller_registers[".cfa"]);
+  cfi.SetCFARule(wide);
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                            &caller_registers));
+  ASSERT_EQ(static_cast<uint64_t>(kMaxIdentifiers * (kMaxIdentifiers - 1) / 2),
+            caller_registers[".cfa"]);
+
+  // Beyond the limits, the rules compile to programs that always fail.
+  cfi.SetCFARule("1 " + deep + "+");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                             &caller_registers));
+  string extra = "$r" + std::to_string(kMaxIdentifiers);
+  registers[extra] = kMaxIdentifiers;
+  cfi.SetCFARule(extra + " " + wide + "+");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                             &caller_registers));
+  ASSERT_EQ(".cfa: " + extra + " " + wide + "+ .ra: 0", cfi.Serialize());
+}
+
+class RuleSet: public CFIFixture, public Test {
+ public:
+  RuleSet() : rules(new CFIRuleSet) {
+    EXPECT_TRUE(rules->AddRules(".cfa: $sp 8 + .ra: .cfa 8 -"));
+    rules->MarkDelta(0x10);
+    EXPECT_TRUE(rules->AddRules(".cfa: $sp 16 + $rbx: .cfa 16 -"));
+    rules->MarkDelta(0x20);
+    EXPECT_TRUE(rules->AddRules("$rbx: $rbx"));
+  }
+
+  std::shared_ptr<CFIRuleSet> rules;
+};
+
+// Each CFIFrameInfo sharing a rule set sees the rules in effect at its
+// address.
+TEST_F(RuleSet, Deltas) {
+  ExpectNoMemoryReferences();
+
+  ASSERT_EQ(2U, rules->RuleCountAt(0x0f));
+  ASSERT_EQ(4U, rules->RuleCountAt(0x10));
+  ASSERT_EQ(5U, rules->RuleCountAt(0x20));
+  ASSERT_EQ(".cfa: $sp 8 + .ra: .cfa 8 -",
+            CFIFrameInfo(rules, 0x0f).Serialize());
+  ASSERT_EQ(".cfa: $sp 16 + .ra: .cfa 8 - $rbx: .cfa 16 -",
+            CFIFrameInfo(rules, 0x1f).Serialize());
+  ASSERT_EQ(".cfa: $sp 16 + .ra: .cfa 8 - $rbx: $rbx",
+            CFIFrameInfo(rules, 0x30).Serialize());
+
+  registers["$sp"] = 0x1000;
+  registers["$rbx"] = 0x2000;
+  ASSERT_TRUE(CFIFrameInfo(rules, 0x1f).FindCallerRegs<uint64_t>(
+      registers, memory, &caller_registers));
+  ASSERT_EQ(3U, caller_registers.size());
+  ASSERT_EQ(0x1010U, caller_registers[".cfa"]);
+  ASSERT_EQ(0x1008U, caller_registers[".ra"]);
+  ASSERT_EQ(0x1000U, caller_registers["$rbx"]);
+  ASSERT_TRUE(CFIFrameInfo(rules, 0x30).FindCallerRegs<uint64_t>(
+      registers, memory, &caller_registers));
+  ASSERT_EQ(0x2000U, caller_registers["$rbx"]);
+}
+
+// Setting a rule on a CFIFrameInfo sharing a rule set leaves the set alone.
+TEST_F(RuleSet, SetCopies) {
+  ExpectNoMemoryReferences();
+
+  CFIFrameInfo early(rules, 0x10);
+  early.SetRegisterRule("$rbp", ".cfa");
+  ASSERT_EQ(".cfa: $sp 16 + .ra: .cfa 8 - $rbp: .cfa $rbx: .cfa 16 -",
+            early.Serialize());
+  ASSERT_EQ(5U, rules->rule_count());
+  ASSERT_EQ(".cfa: $sp 16 + .ra: .cfa 8 - $rbx: $rbx",
+            CFIFrameInfo(rules, 0x30).Serialize());
+}
+
 class MockCFIRuleParserHandler: public CFIRuleParser::Handler {
  public:
   MOCK_METHOD1(CFARule, void(const string &));
@@ -154,6 +154,21 @@ bool ContainedRangeMap<AddressType, EntryType>::RetrieveRange(
                              "|entry|";
   assert(entry);
 
+  const EntryType *stored_entry;
+  if (!RetrieveRange(address, &stored_entry))
+    return false;
+  *entry = *stored_entry;
+  return true;
+}
+
+
+template<typename AddressType, typename EntryType>
+bool ContainedRangeMap<AddressType, EntryType>::RetrieveRange(
+    const AddressType &address, const EntryType **entry) const {
+  BPLOG_IF(ERROR, !entry) << "ContainedRangeMap::RetrieveRange requires "
+                             "|entry|";
+  assert(entry);
+
   // If nothing was ever stored, then there's nothing to retrieve.
   if (!map_)
     return false;
@@ -172,7 +187,7 @@ bool ContainedRangeMap<AddressType, EntryType>::RetrieveRange(
   // if it has a more-specific descendant that also contains it.  If it does,
   // it will set |entry| appropriately.  If not, set |entry| to the child.
   if (!iterator->second->RetrieveRange(address, entry))
-    *entry = iterator->second->entry_;
+    *entry = &iterator->second->entry_;
 
   return true;
 }
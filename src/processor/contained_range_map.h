@@ -97,6 +97,11 @@ class ContainedRangeMap {
   // encompasses the address, returns false.
   bool RetrieveRange(const AddressType &address, EntryType *entry) const;
 
+  // Same as above, but sets |entry| to point at the stored entry instead
+  // of copying it.  The pointer is valid until the map is next changed.
+  bool RetrieveRange(const AddressType &address,
+                     const EntryType **entry) const;
+
   // Removes all children.  Note that Clear only removes descendants,
   // leaving the node on which it is called intact.  Because the only
   // meaningful things contained by a root node are descendants, this
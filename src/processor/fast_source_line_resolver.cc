@@ -40,12 +40,17 @@
 #include "google_breakpad/processor/fast_source_line_resolver.h"
 #include "processor/fast_source_line_resolver_types.h"
 
+#include <string.h>
+
 #include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "common/scoped_ptr.h"
 #include "common/using_std_string.h"
+#include "processor/binary_symbol_file.h"
+#include "processor/logging.h"
 #include "processor/module_factory.h"
 #include "processor/simple_serializer-inl.h"
 
@@ -54,6 +59,190 @@ using std::make_pair;
 
 namespace google_breakpad {
 
+namespace {
+
+// Structural checks of the serialized maps of a Module, so that a corrupt
+// or truncated symbol file is rejected at load, rather than read out of
+// bounds at lookup.  Each checks that a map fits in the |size| bytes at
+// |raw|, which are in the buffer, and that each of its values is laid out
+// as the Module reads it.  The contents of the values aren't checked.
+
+// Returns the number of bytes the string at |raw| takes up, counting its
+// terminating NUL, or 0 if there is no NUL in the |size| bytes at |raw|.
+size_t StringSize(const char *raw, size_t size) {
+  const void *nul = memchr(raw, '\0', size);
+  return nul ? static_cast<const char*>(nul) - raw + 1 : 0;
+}
+
+// Sets |map| to the StaticMap in the |size| bytes at |raw|, and returns
+// true if it fits in them.
+template<typename Key>
+bool CheckStaticMap(const char *raw, uint64_t size,
+                    StaticMap<Key, char> *map) {
+  if (size < sizeof(uint32_t) || size > 0xffffffffUL)
+    return false;
+  *map = StaticMap<Key, char>(raw);
+  return map->ValidateInMemoryStructure(static_cast<uint32_t>(size));
+}
+
+// Sets |value| and |value_size| to the value at |index| in |map|, which
+// takes up the |size| bytes at |raw|.  A value runs up to the next one, or
+// to the end of the map.
+template<typename Key>
+void GetValue(const StaticMap<Key, char> &map, const char *raw,
+              uint64_t size, int index, const char **value,
+              uint64_t *value_size) {
+  *value = map.IteratorAtIndex(index).GetValueRawPtr();
+  const char *end = index + 1 < static_cast<int>(map.size()) ?
+      map.IteratorAtIndex(index + 1).GetValueRawPtr() : raw + size;
+  *value_size = end - *value;
+}
+
+// A StaticMap of NUL-terminated strings, like FastSourceLineResolver's
+// files and CFI delta rules.
+template<typename Key>
+bool CheckStringMap(const char *raw, uint64_t size) {
+  StaticMap<Key, char> map;
+  if (!CheckStaticMap(raw, size, &map))
+    return false;
+  for (int i = 0; i < static_cast<int>(map.size()); ++i) {
+    const char *value;
+    uint64_t value_size;
+    GetValue(map, raw, size, i, &value, &value_size);
+    if (!StringSize(value, value_size))
+      return false;
+  }
+  return true;
+}
+
+// A StaticRangeMap, whose values are a base address followed by the
+// entry.  Sets |entries| to the address and size of each entry.
+bool CheckRangeMap(const char *raw, uint64_t size,
+                   std::vector<std::pair<const char*, uint64_t> > *entries) {
+  StaticMap<MemAddr, char> map;
+  if (!CheckStaticMap(raw, size, &map))
+    return false;
+  entries->clear();
+  entries->reserve(map.size());
+  for (int i = 0; i < static_cast<int>(map.size()); ++i) {
+    const char *value;
+    uint64_t value_size;
+    GetValue(map, raw, size, i, &value, &value_size);
+    if (value_size < sizeof(MemAddr))
+      return false;
+    entries->push_back(std::make_pair(value + sizeof(MemAddr),
+                                      value_size - sizeof(MemAddr)));
+  }
+  return true;
+}
+
+// A StaticRangeMap of CFI initial rules.
+bool CheckCFIRangeMap(const char *raw, uint64_t size) {
+  std::vector<std::pair<const char*, uint64_t> > entries;
+  if (!CheckRangeMap(raw, size, &entries))
+    return false;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (!StringSize(entries[i].first, entries[i].second))
+      return false;
+  }
+  return true;
+}
+
+// The StaticRangeMap of Functions, and their StaticRangeMaps of Lines.
+bool CheckFunctionMap(const char *raw, uint64_t size) {
+  // A Function's name is followed by its address, size and parameter size.
+  const uint64_t kFunctionFieldsSize = 2 * sizeof(MemAddr) + sizeof(int32_t);
+  // A Line's address and size, source file and line number.
+  const uint64_t kLineSize = 2 * sizeof(MemAddr) + 2 * sizeof(int32_t);
+
+  std::vector<std::pair<const char*, uint64_t> > functions;
+  std::vector<std::pair<const char*, uint64_t> > lines;
+  if (!CheckRangeMap(raw, size, &functions))
+    return false;
+  for (size_t i = 0; i < functions.size(); ++i) {
+    const char *function = functions[i].first;
+    uint64_t function_size = functions[i].second;
+    size_t name_size = StringSize(function, function_size);
+    if (!name_size || function_size - name_size < kFunctionFieldsSize)
+      return false;
+    const char *lines_data = function + name_size + kFunctionFieldsSize;
+    if (!CheckRangeMap(lines_data, function + function_size - lines_data,
+                       &lines))
+      return false;
+    for (size_t j = 0; j < lines.size(); ++j) {
+      if (lines[j].second < kLineSize)
+        return false;
+    }
+  }
+  return true;
+}
+
+// The StaticAddressMap of PublicSymbols.
+bool CheckPublicSymbolMap(const char *raw, uint64_t size) {
+  // A PublicSymbol's name is followed by its address and parameter size.
+  const uint64_t kPublicSymbolFieldsSize = sizeof(MemAddr) + sizeof(int32_t);
+
+  StaticMap<MemAddr, char> map;
+  if (!CheckStaticMap(raw, size, &map))
+    return false;
+  for (int i = 0; i < static_cast<int>(map.size()); ++i) {
+    const char *value;
+    uint64_t value_size;
+    GetValue(map, raw, size, i, &value, &value_size);
+    size_t name_size = StringSize(value, value_size);
+    if (!name_size || value_size - name_size < kPublicSymbolFieldsSize)
+      return false;
+  }
+  return true;
+}
+
+// A StaticContainedRangeMap of WindowsFrameInfo, as CopyWFI reads it.
+// Each range is its base address, the size of its entry, the entry, and
+// the StaticMap of its children.  The ranges nest as deep as the file
+// says, so walk them with a stack of our own rather than recursing.
+bool CheckWindowsFrameInfoMap(const char *raw, uint64_t size) {
+  const uint64_t kRangeHeaderSize = sizeof(MemAddr) + sizeof(uint32_t);
+  // A WindowsFrameInfo's type and validity, six sizes and a flag, then
+  // its program string.
+  const uint64_t kFrameInfoFieldsSize =
+      2 * sizeof(int32_t) + 6 * sizeof(uint32_t) + 1;
+
+  std::vector<std::pair<const char*, uint64_t> > ranges;
+  ranges.push_back(std::make_pair(raw, size));
+  while (!ranges.empty()) {
+    const char *range = ranges.back().first;
+    uint64_t range_size = ranges.back().second;
+    ranges.pop_back();
+    if (range_size < kRangeHeaderSize)
+      return false;
+    uint32_t entry_size =
+        *reinterpret_cast<const uint32_t*>(range + sizeof(MemAddr));
+    if (entry_size > range_size - kRangeHeaderSize)
+      return false;
+    const char *entry = range + kRangeHeaderSize;
+    if (entry_size &&
+        (entry_size <= kFrameInfoFieldsSize ||
+         !StringSize(entry + kFrameInfoFieldsSize,
+                     entry_size - kFrameInfoFieldsSize)))
+      return false;
+
+    const char *children = entry + entry_size;
+    uint64_t children_size = range_size - kRangeHeaderSize - entry_size;
+    StaticMap<MemAddr, char> map;
+    if (!CheckStaticMap(children, children_size, &map))
+      return false;
+    for (int i = 0; i < static_cast<int>(map.size()); ++i) {
+      const char *child;
+      uint64_t child_size;
+      GetValue(map, children, children_size, i, &child, &child_size);
+      ranges.push_back(std::make_pair(child, child_size));
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
 FastSourceLineResolver::FastSourceLineResolver()
   : SourceLineResolverBase(new FastModuleFactory) { }
 
@@ -107,6 +296,87 @@ void FastSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
   }
 }
 
+void FastSourceLineResolver::Module::LookupAddresses(
+    MemAddr base_address, const MemAddr *addresses, const size_t *order,
+    size_t count, SourceLineInfo *infos) const {
+  // The addresses are looked up in ascending order, merging them with the
+  // functions, and each function's lines, as they go: the cursors hold the
+  // positions the previous address reached.  The function and line the
+  // previous address fell in, if any, need no lookup for the next.  Names
+  // point into the serialized data, so nothing is copied.
+  int function_cursor = 0;
+  const char *func = NULL;
+  MemAddr function_base = 0;
+  MemAddr function_size = 0;
+  StaticRangeMap<MemAddr, Line> lines;
+  int line_cursor = 0;
+  const Line *line_ptr = NULL;
+  MemAddr line_base = 0;
+  MemAddr line_size = 0;
+  Line line;
+  const char *source_file_name = NULL;
+
+  for (size_t i = 0; i < count; ++i) {
+    size_t index = order ? order[i] : i;
+    MemAddr address = addresses[index] - base_address;
+    SourceLineInfo *info = &infos[index];
+    *info = SourceLineInfo();
+
+    if (!func || address < function_base ||
+        address - function_base >= function_size) {
+      // As in LookupAddress, the nearest function bounds the extent of a
+      // PUBLIC symbol if no function covers the address.
+      const Function *func_ptr = NULL;
+      bool found = functions_.RetrieveNearestRangeFrom(address,
+                                                       &function_cursor,
+                                                       func_ptr,
+                                                       &function_base,
+                                                       &function_size);
+      line_ptr = NULL;
+      line_cursor = 0;
+      if (found && address >= function_base &&
+          address - function_base < function_size) {
+        func = reinterpret_cast<const char*>(func_ptr);
+        lines = StaticRangeMap<MemAddr, Line>(Function::LinesData(func));
+      } else {
+        func = NULL;
+        const PublicSymbol *public_symbol_ptr = NULL;
+        MemAddr public_address;
+        if (public_symbols_.Retrieve(address, public_symbol_ptr,
+                                     &public_address) &&
+            (!func_ptr || public_address > function_base)) {
+          // A serialized PublicSymbol starts with its name.
+          info->function_name =
+              reinterpret_cast<const char*>(public_symbol_ptr);
+          info->function_base = base_address + public_address;
+        }
+        continue;
+      }
+    }
+
+    // A serialized Function starts with its name.
+    info->function_name = func;
+    info->function_base = base_address + function_base;
+
+    if (!line_ptr || address < line_base ||
+        address - line_base >= line_size) {
+      if (lines.RetrieveRangeFrom(address, &line_cursor, line_ptr, &line_base,
+                                  &line_size)) {
+        line.CopyFrom(line_ptr);
+        FileMap::iterator it = files_.find(line.source_file_id);
+        source_file_name = it != files_.end() ? it.GetValuePtr() : NULL;
+      } else {
+        line_ptr = NULL;
+      }
+    }
+    if (line_ptr) {
+      info->source_file_name = source_file_name;
+      info->source_line = line.line;
+      info->source_line_base = base_address + line_base;
+    }
+  }
+}
+
 // WFI: WindowsFrameInfo.
 // Returns a WFI object reading from a raw memory chunk of data
 WindowsFrameInfo FastSourceLineResolver::CopyWFI(const char *raw) {
@@ -147,7 +417,45 @@ WindowsFrameInfo FastSourceLineResolver::CopyWFI(const char *raw) {
 bool FastSourceLineResolver::Module::LoadMapFromMemory(
     char *memory_buffer,
     size_t memory_buffer_size) {
-  if (!memory_buffer) return false;
+  if (!memory_buffer) {
+    is_corrupt_ = true;
+    return false;
+  }
+
+  // A binary symbol file holds the serialized module after its header and
+  // the module's identity.
+  if (IsBinarySymbolFile(memory_buffer, memory_buffer_size)) {
+    BinarySymbolFileHeader file_header;
+    BinarySymbolFileModuleInfo file_info;
+    if (!ReadBinarySymbolFileHeader(memory_buffer, memory_buffer_size,
+                                    &file_header, &file_info)) {
+      BPLOG(ERROR) << "Truncated binary symbol file for " << name_;
+      is_corrupt_ = true;
+      return false;
+    }
+    if (file_header.version < kOldestBinarySymbolFileVersion ||
+        file_header.version > kBinarySymbolFileVersion) {
+      BPLOG(ERROR) << "Unsupported binary symbol file version "
+                   << file_header.version << " for " << name_;
+      is_corrupt_ = true;
+      return false;
+    }
+    size_t prefix_size = sizeof(file_header) + file_header.info_size;
+    if (file_header.module_size > memory_buffer_size - prefix_size) {
+      BPLOG(ERROR) << "Truncated binary symbol file for " << name_;
+      is_corrupt_ = true;
+      return false;
+    }
+    memory_buffer += prefix_size;
+    memory_buffer_size = file_header.module_size;
+  }
+
+  unsigned int header_size = kNumberMaps_ * sizeof(unsigned int);
+  if (memory_buffer_size < sizeof(bool) + header_size) {
+    BPLOG(ERROR) << "Serialized symbol data too small for " << name_;
+    is_corrupt_ = true;
+    return false;
+  }
 
   // Read the "is_corrupt" flag.
   const char *mem_buffer = memory_buffer;
@@ -155,20 +463,53 @@ bool FastSourceLineResolver::Module::LoadMapFromMemory(
 
   const uint32_t *map_sizes = reinterpret_cast<const uint32_t*>(mem_buffer);
 
-  unsigned int header_size = kNumberMaps_ * sizeof(unsigned int);
-
   // offsets[]: an array of offset addresses (with respect to mem_buffer),
   // for each "Static***Map" component of Module.
   // "Static***Map": static version of std::map or map wrapper, i.e., StaticMap,
   // StaticAddressMap, StaticContainedRangeMap, and StaticRangeMap.
-  unsigned int offsets[kNumberMaps_];
+  uint64_t offsets[kNumberMaps_];
   offsets[0] = header_size;
-  for (int i = 1; i < kNumberMaps_; ++i) {
-    offsets[i] = offsets[i - 1] + map_sizes[i - 1];
+  uint64_t data_size = sizeof(bool) + header_size;
+  for (int i = 0; i < kNumberMaps_; ++i) {
+    if (i > 0)
+      offsets[i] = offsets[i - 1] + map_sizes[i - 1];
+    data_size += map_sizes[i];
+  }
+  if (data_size > memory_buffer_size) {
+    BPLOG(ERROR) << "Serialized symbol data for " << name_ << " needs "
+                 << data_size << " bytes, has " << memory_buffer_size;
+    is_corrupt_ = true;
+    return false;
   }
 
-  // Use pointers to construct Static*Map data members in Module:
+  // Check each map against its size before anything reads it.
   int map_id = 0;
+  bool valid =
+      CheckStringMap<int>(mem_buffer + offsets[map_id], map_sizes[map_id]);
+  ++map_id;
+  valid = valid &&
+      CheckFunctionMap(mem_buffer + offsets[map_id], map_sizes[map_id]);
+  ++map_id;
+  valid = valid &&
+      CheckPublicSymbolMap(mem_buffer + offsets[map_id], map_sizes[map_id]);
+  ++map_id;
+  for (int i = 0; i < WindowsFrameInfo::STACK_INFO_LAST; ++i, ++map_id) {
+    valid = valid && CheckWindowsFrameInfoMap(mem_buffer + offsets[map_id],
+                                              map_sizes[map_id]);
+  }
+  valid = valid &&
+      CheckCFIRangeMap(mem_buffer + offsets[map_id], map_sizes[map_id]);
+  ++map_id;
+  valid = valid &&
+      CheckStringMap<MemAddr>(mem_buffer + offsets[map_id], map_sizes[map_id]);
+  if (!valid) {
+    BPLOG(ERROR) << "Malformed serialized symbol data for " << name_;
+    is_corrupt_ = true;
+    return false;
+  }
+
+  // Use pointers to construct Static*Map data members in Module:
+  map_id = 0;
   files_ = StaticMap<int, char>(mem_buffer + offsets[map_id++]);
   functions_ =
       StaticRangeMap<MemAddr, Function>(mem_buffer + offsets[map_id++]);
@@ -244,32 +585,34 @@ CFIFrameInfo *FastSourceLineResolver::Module::FindCFIFrameInfo(
   MemAddr initial_base, initial_size;
   const char* initial_rules = NULL;
 
-  // Find the initial rule whose range covers this address. That
-  // provides an initial set of register recovery rules. Then, walk
-  // forward from the initial rule's starting address to frame's
-  // instruction address, applying delta rules.
+  // Find the initial rule whose range covers this address. Its rules,
+  // with the delta rules up to and including the frame's address applied,
+  // are the register recovery rules in effect there.
   if (!cfi_initial_rules_.RetrieveRange(address, initial_rules,
                                         &initial_base, &initial_size)) {
     return NULL;
   }
 
-  // Create a frame info structure, and populate it with the rules from
-  // the STACK CFI INIT record.
-  scoped_ptr<CFIFrameInfo> rules(new CFIFrameInfo());
-  if (!ParseCFIRuleSet(initial_rules, rules.get()))
-    return NULL;
-
-  // Find the first delta rule that falls within the initial rule's range.
-  StaticMap<MemAddr, char>::iterator delta =
-    cfi_delta_rules_.lower_bound(initial_base);
+  return GetCFIFrameInfo(initial_base, initial_size, initial_rules, address);
+}
 
-  // Apply delta rules up to and including the frame's address.
-  while (delta != cfi_delta_rules_.end() && delta.GetKey() <= address) {
-    ParseCFIRuleSet(delta.GetValuePtr(), rules.get());
-    delta++;
+bool FastSourceLineResolver::Module::CompileCFIRuleSet(
+    MemAddr initial_base, MemAddr initial_size, const char *initial_rules,
+    CFIRuleSet *rule_set) const {
+  if (!rule_set->AddRules(initial_rules))
+    return false;
+
+  // Add the delta rules that fall within the initial rule's range.
+  for (StaticMap<MemAddr, char>::iterator delta =
+           cfi_delta_rules_.lower_bound(initial_base);
+       delta != cfi_delta_rules_.end() &&
+           delta.GetKey() - initial_base < initial_size;
+       delta++) {
+    rule_set->MarkDelta(delta.GetKey());
+    rule_set->AddRules(delta.GetValuePtr());
   }
 
-  return rules.release();
+  return true;
 }
 
 }  // namespace google_breakpad
@@ -86,8 +86,13 @@ public SourceLineResolverBase::Function {
         raw + name_size + sizeof(MemAddr)));
     parameter_size = *(reinterpret_cast<const int32_t*>(
         raw + name_size + 2 * sizeof(MemAddr)));
-    lines = StaticRangeMap<MemAddr, Line>(
-        raw + name_size + 2 * sizeof(MemAddr) + sizeof(int32_t));
+    lines = StaticRangeMap<MemAddr, Line>(LinesData(raw));
+  }
+
+  // Returns the serialized line map of the Function at |raw|, which
+  // follows its name, address, size and parameter size.
+  static const char *LinesData(const char *raw) {
+    return raw + strlen(raw) + 1 + 2 * sizeof(MemAddr) + sizeof(int32_t);
   }
 
   StaticRangeMap<MemAddr, Line> lines;
@@ -119,6 +124,15 @@ class FastSourceLineResolver::Module: public SourceLineResolverBase::Module {
   // with the result.
   virtual void LookupAddress(StackFrame *frame) const;
 
+  // Looks up a batch of addresses.  See SourceLineResolverBase::Module.
+  virtual void LookupAddresses(MemAddr base_address, const MemAddr *addresses,
+                               const size_t *order, size_t count,
+                               SourceLineInfo *infos) const;
+
+  // Serialized modules carry no inline records, so this changes nothing.
+  virtual void LookupInlinedFrames(
+      StackFrame *frame, std::vector<StackFrame> *inlined_frames) const { }
+
   // Loads a map from the given buffer in char* type.
   virtual bool LoadMapFromMemory(char *memory_buffer,
                                  size_t memory_buffer_size);
@@ -143,6 +157,11 @@ class FastSourceLineResolver::Module: public SourceLineResolverBase::Module {
   // Number of serialized map components of Module.
   static const int kNumberMaps_ = 5 + WindowsFrameInfo::STACK_INFO_LAST;
 
+ protected:
+  virtual bool CompileCFIRuleSet(MemAddr initial_base, MemAddr initial_size,
+                                 const char *initial_rules,
+                                 CFIRuleSet *rule_set) const;
+
  private:
   friend class FastSourceLineResolver;
   friend class ModuleComparer;
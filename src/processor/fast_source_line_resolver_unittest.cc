@@ -39,22 +39,40 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <sys/stat.h>
 
+#include <fstream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "breakpad_googletest_includes.h"
+#include "common/tests/auto_tempdir.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/processor/code_module.h"
 #include "google_breakpad/processor/stack_frame.h"
 #include "google_breakpad/processor/memory_region.h"
+#include "processor/basic_code_module.h"
+#include "processor/binary_symbol_file.h"
 #include "processor/logging.h"
 #include "processor/module_serializer.h"
 #include "processor/module_comparer.h"
+#include "processor/simple_symbol_supplier.h"
+#include "processor/static_map_search_index.h"
 
 namespace {
 
+using google_breakpad::AutoTempDir;
+using google_breakpad::BasicCodeModule;
+using google_breakpad::BinarySymbolFileHeader;
+using google_breakpad::BinarySymbolFileModuleInfo;
+using google_breakpad::ReadBinarySymbolFileHeader;
+using google_breakpad::kStaticMapSearchIndexFlag;
+using google_breakpad::SimpleSymbolSupplier;
 using google_breakpad::SourceLineResolverBase;
+using google_breakpad::SourceLineResolverInterface;
+using google_breakpad::SymbolSupplier;
+using google_breakpad::scoped_array;
 using google_breakpad::BasicSourceLineResolver;
 using google_breakpad::FastSourceLineResolver;
 using google_breakpad::ModuleSerializer;
@@ -69,18 +87,21 @@ using google_breakpad::scoped_ptr;
 
 class TestCodeModule : public CodeModule {
  public:
-  explicit TestCodeModule(string code_file) : code_file_(code_file) {}
+  explicit TestCodeModule(string code_file, uint64_t base_address = 0,
+                          string debug_identifier = "")
+      : code_file_(code_file), base_address_(base_address),
+        debug_identifier_(debug_identifier) {}
   virtual ~TestCodeModule() {}
 
-  virtual uint64_t base_address() const { return 0; }
+  virtual uint64_t base_address() const { return base_address_; }
   virtual uint64_t size() const { return 0xb000; }
   virtual string code_file() const { return code_file_; }
   virtual string code_identifier() const { return ""; }
   virtual string debug_file() const { return ""; }
-  virtual string debug_identifier() const { return ""; }
+  virtual string debug_identifier() const { return debug_identifier_; }
   virtual string version() const { return ""; }
   virtual CodeModule* Copy() const {
-    return new TestCodeModule(code_file_);
+    return new TestCodeModule(code_file_, base_address_, debug_identifier_);
   }
   virtual bool is_unloaded() const { return false; }
   virtual uint64_t shrink_down_delta() const { return 0; }
@@ -88,6 +109,8 @@ class TestCodeModule : public CodeModule {
 
  private:
   string code_file_;
+  uint64_t base_address_;
+  string debug_identifier_;
 };
 
 // A mock memory region object, for use by the STACK CFI tests.
@@ -186,6 +209,20 @@ class TestFastSourceLineResolver : public ::testing::Test {
     return ss.str();
   }
 
+  // Returns module FILE_INDEX as a binary symbol file.
+  string binary_symbol_file(int file_index) {
+    char *symbol_data;
+    size_t symbol_data_size;
+    if (!SourceLineResolverBase::ReadSymbolFile(
+            symbol_file(file_index), &symbol_data, &symbol_data_size))
+      return "";
+    string text(symbol_data, symbol_data_size);
+    delete [] symbol_data;
+    size_t size;
+    scoped_array<char> data(serializer.SerializeBinarySymbolFile(text, &size));
+    return data.get() ? string(data.get(), size) : "";
+  }
+
   ModuleSerializer serializer;
   BasicSourceLineResolver basic_resolver;
   FastSourceLineResolver fast_resolver;
@@ -408,6 +445,82 @@ TEST_F(TestFastSourceLineResolver, TestLoadAndResolve) {
   ASSERT_EQ(frame.function_name, "Public2_2");
 }
 
+// Expects LookupAddresses to give for each of |addresses| in |module| what
+// FillSourceLineInfo gives for a frame at that address.
+static void ExpectSameAsFrames(SourceLineResolverInterface *resolver,
+                               const CodeModule *module,
+                               const std::vector<uint64_t> &addresses) {
+  std::vector<SourceLineResolverInterface::SourceLineInfo> infos(
+      addresses.size());
+  ASSERT_TRUE(resolver->LookupAddresses(module, &addresses[0],
+                                        addresses.size(), &infos[0]));
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    StackFrame frame;
+    frame.instruction = addresses[i];
+    frame.module = module;
+    resolver->FillSourceLineInfo(&frame);
+    const SourceLineResolverInterface::SourceLineInfo &info = infos[i];
+    ASSERT_EQ(frame.function_name,
+              info.function_name ? info.function_name : "")
+        << std::hex << addresses[i];
+    ASSERT_EQ(frame.function_base, info.function_base);
+    ASSERT_EQ(frame.source_file_name,
+              info.source_file_name ? info.source_file_name : "");
+    ASSERT_EQ(frame.source_line, info.source_line);
+    ASSERT_EQ(frame.source_line_base, info.source_line_base);
+  }
+}
+
+// Sorted, reversed and shuffled batches of the addresses from |start| to
+// |end|, with some outside the module, look up as single frames do.
+static void ExpectBatchesSameAsFrames(SourceLineResolverInterface *resolver,
+                                      const CodeModule *module,
+                                      uint64_t start, uint64_t end,
+                                      uint64_t step) {
+  std::vector<uint64_t> addresses;
+  for (uint64_t address = start; address < end; address += step)
+    addresses.push_back(module->base_address() + address);
+  ExpectSameAsFrames(resolver, module, addresses);
+
+  std::vector<uint64_t> reversed(addresses.rbegin(), addresses.rend());
+  reversed.push_back(module->base_address() - 1);
+  reversed.push_back(0);
+  reversed.push_back(~0ULL);
+  ExpectSameAsFrames(resolver, module, reversed);
+
+  std::vector<uint64_t> shuffled;
+  for (size_t i = 0; i < addresses.size(); ++i)
+    shuffled.push_back(addresses[(i * 7919) % addresses.size()]);
+  shuffled.insert(shuffled.end(), addresses.begin(), addresses.end());
+  ExpectSameAsFrames(resolver, module, shuffled);
+}
+
+TEST_F(TestFastSourceLineResolver, TestLookupAddresses) {
+  TestCodeModule module1("module1");
+  ASSERT_TRUE(basic_resolver.LoadModule(&module1, symbol_file(1)));
+  ASSERT_TRUE(serializer.ConvertOneModule(
+      module1.code_file(), &basic_resolver, &fast_resolver));
+  ExpectBatchesSameAsFrames(&fast_resolver, &module1, 0, 0x6000, 3);
+
+  // The same module, loaded elsewhere.
+  TestCodeModule moved_module1("module1", 0x400000);
+  ExpectBatchesSameAsFrames(&fast_resolver, &moved_module1, 0, 0x6000, 7);
+
+  TestCodeModule linux_module("breakpad_unittests");
+  ASSERT_TRUE(basic_resolver.LoadModule(&linux_module, testdata_dir +
+      "/symbols/microdump/breakpad_unittests/"
+      "D6D1FEC9A15DE7F38A236898871A2E770/breakpad_unittests.sym"));
+  ASSERT_TRUE(serializer.ConvertOneModule(
+      linux_module.code_file(), &basic_resolver, &fast_resolver));
+  ExpectBatchesSameAsFrames(&fast_resolver, &linux_module, 0, 0xa6000, 5);
+
+  uint64_t address = 0x1000;
+  SourceLineResolverInterface::SourceLineInfo info;
+  TestCodeModule unloaded_module("unloaded");
+  EXPECT_FALSE(fast_resolver.LookupAddresses(&unloaded_module, &address, 1,
+                                             &info));
+}
+
 TEST_F(TestFastSourceLineResolver, TestInvalidLoads) {
   TestCodeModule module3("module3");
   ASSERT_TRUE(basic_resolver.LoadModule(&module3,
@@ -466,6 +579,261 @@ TEST_F(TestFastSourceLineResolver, TestUnload) {
   ASSERT_TRUE(fast_resolver.HasModule(&module1));
 }
 
+// A FastSourceLineResolver that tells how many symbol buffers it keeps,
+// and that can unload a module as soon as its load has published it, the
+// way another thread might.
+class BufferCountingResolver : public FastSourceLineResolver {
+ public:
+  BufferCountingResolver() : unload_after_publish_(NULL) { }
+
+  size_t kept_buffer_count() const { return memory_buffers_->size(); }
+
+  void set_unload_after_publish(const CodeModule *module) {
+    unload_after_publish_ = module;
+  }
+
+  virtual bool ShouldDeleteMemoryBufferAfterLoadModule() {
+    if (unload_after_publish_ && HasModule(unload_after_publish_)) {
+      const CodeModule *module = unload_after_publish_;
+      unload_after_publish_ = NULL;
+      UnloadModule(module);
+    }
+    // FastSourceLineResolver keeps the buffers.
+    return false;
+  }
+
+ private:
+  const CodeModule *unload_after_publish_;
+};
+
+// A buffer is kept exactly as long as its module is loaded, even when the
+// module is unloaded while its load is still finishing.
+TEST_F(TestFastSourceLineResolver, TestUnloadDuringLoad) {
+  string file_data = binary_symbol_file(1);
+  ASSERT_FALSE(file_data.empty());
+
+  BufferCountingResolver resolver;
+  TestCodeModule module1("module1");
+  resolver.set_unload_after_publish(&module1);
+  resolver.LoadModuleUsingMapBuffer(&module1, file_data);
+  EXPECT_EQ(resolver.HasModule(&module1) ? 1U : 0U,
+            resolver.kept_buffer_count());
+
+  resolver.UnloadModule(&module1);
+  EXPECT_EQ(0U, resolver.kept_buffer_count());
+  ASSERT_TRUE(resolver.LoadModuleUsingMapBuffer(&module1, file_data));
+  EXPECT_EQ(1U, resolver.kept_buffer_count());
+  resolver.UnloadModule(&module1);
+  EXPECT_EQ(0U, resolver.kept_buffer_count());
+}
+
+TEST_F(TestFastSourceLineResolver, TestBinarySymbolFile) {
+  string file_data = binary_symbol_file(1);
+  ASSERT_FALSE(file_data.empty());
+
+  TestCodeModule module1("module1");
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMapBuffer(&module1, file_data));
+  ASSERT_TRUE(fast_resolver.HasModule(&module1));
+  ASSERT_FALSE(fast_resolver.IsModuleCorrupt(&module1));
+
+  StackFrame frame;
+  frame.instruction = 0x1000;
+  frame.module = &module1;
+  fast_resolver.FillSourceLineInfo(&frame);
+  ASSERT_EQ(frame.function_name, "Function1_1");
+  ASSERT_EQ(frame.source_file_name, "file1_1.cc");
+  ASSERT_EQ(frame.source_line, 44);
+  frame.instruction = 0x3d40;
+  scoped_ptr<CFIFrameInfo> cfi_frame_info(
+      fast_resolver.FindCFIFrameInfo(&frame));
+  ASSERT_TRUE(cfi_frame_info.get());
+  ASSERT_EQ(cfi_frame_info->Serialize(), ".cfa: $esp 4 + .ra: .cfa 4 - ^");
+
+  // BasicSourceLineResolver can't use binary symbol files.
+  ASSERT_TRUE(basic_resolver.LoadModuleUsingMapBuffer(&module1, file_data));
+  ASSERT_TRUE(basic_resolver.IsModuleCorrupt(&module1));
+}
+
+TEST_F(TestFastSourceLineResolver, TestBinarySymbolFileModuleInfo) {
+  string file_data = binary_symbol_file(1);
+  ASSERT_FALSE(file_data.empty());
+  BinarySymbolFileHeader header;
+  BinarySymbolFileModuleInfo info;
+  ASSERT_TRUE(ReadBinarySymbolFileHeader(file_data.data(), file_data.size(),
+                                         &header, &info));
+  EXPECT_EQ(0U, header.info_size % 8);
+  EXPECT_EQ("windows", info.os);
+  EXPECT_EQ("x86", info.arch);
+  EXPECT_EQ("111111111111111111111111111111111", info.debug_id);
+  EXPECT_EQ("module1.pdb", info.name);
+  EXPECT_EQ("FFFFFFFF", info.code_id);
+
+  // The file loads for a module with its debug identifier, or none.
+  TestCodeModule module1("module1", 0, "111111111111111111111111111111111");
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMapBuffer(&module1, file_data));
+  ASSERT_FALSE(fast_resolver.IsModuleCorrupt(&module1));
+
+  // It doesn't load for another module.
+  TestCodeModule module2("module2", 0, "222222222222222222222222222222222");
+  ASSERT_FALSE(fast_resolver.LoadModuleUsingMapBuffer(&module2, file_data));
+  ASSERT_FALSE(fast_resolver.HasModule(&module2));
+}
+
+TEST_F(TestFastSourceLineResolver, TestInlineRecordsNotSerialized) {
+  string text = "MODULE Linux x86_64 333333333333333333333333333333333 m\n"
+                "INLINE_ORIGIN 0 inlined\n"
+                "FUNC 1000 10 0 f\n"
+                "INLINE 0 1 0 0 1004 4\n";
+  size_t size;
+  scoped_array<char> data(serializer.SerializeBinarySymbolFile(text, &size));
+  ASSERT_FALSE(data.get());
+  ASSERT_EQ(0U, size);
+}
+
+TEST_F(TestFastSourceLineResolver, TestInvalidBinarySymbolFile) {
+  string file_data = binary_symbol_file(1);
+  ASSERT_FALSE(file_data.empty());
+  BinarySymbolFileHeader header;
+  memcpy(&header, file_data.data(), sizeof(header));
+
+  // An unknown version.
+  BinarySymbolFileHeader bad_header = header;
+  bad_header.version++;
+  string bad_version = file_data;
+  bad_version.replace(0, sizeof(bad_header),
+                      reinterpret_cast<const char*>(&bad_header),
+                      sizeof(bad_header));
+  TestCodeModule module1("module1");
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMapBuffer(&module1, bad_version));
+  ASSERT_TRUE(fast_resolver.IsModuleCorrupt(&module1));
+
+  // A file cut short.
+  TestCodeModule module2("module2");
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMapBuffer(
+      &module2, file_data.substr(0, file_data.size() / 2)));
+  ASSERT_TRUE(fast_resolver.IsModuleCorrupt(&module2));
+
+  // A header claiming more map data than the file holds.
+  bad_header = header;
+  bad_header.module_size = 64;
+  string bad_size = file_data.substr(0, sizeof(header) + 64);
+  bad_size.replace(0, sizeof(bad_header),
+                   reinterpret_cast<const char*>(&bad_header),
+                   sizeof(bad_header));
+  TestCodeModule module3("module3");
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMapBuffer(&module3, bad_size));
+  ASSERT_TRUE(fast_resolver.IsModuleCorrupt(&module3));
+}
+
+TEST_F(TestFastSourceLineResolver, TestCorruptBinarySymbolFile) {
+  string file_data = binary_symbol_file(1);
+  ASSERT_FALSE(file_data.empty());
+  BinarySymbolFileHeader header;
+  BinarySymbolFileModuleInfo info;
+  ASSERT_TRUE(ReadBinarySymbolFileHeader(file_data.data(), file_data.size(),
+                                         &header, &info));
+  // The module's is_corrupt flag and map sizes come before its maps, the
+  // first of which is the files map.
+  size_t module_offset = sizeof(header) + header.info_size;
+  size_t maps_offset = module_offset + 1 +
+      (5 + WindowsFrameInfo::STACK_INFO_LAST) * sizeof(uint32_t);
+  ASSERT_LT(maps_offset + sizeof(uint32_t), file_data.size());
+
+  // A map claiming more nodes than fit in it.
+  string bad_count = file_data;
+  uint32_t count = 0x7fffffff;
+  bad_count.replace(maps_offset, sizeof(count),
+                    reinterpret_cast<const char*>(&count), sizeof(count));
+  TestCodeModule module1("module1");
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMapBuffer(&module1, bad_count));
+  ASSERT_TRUE(fast_resolver.IsModuleCorrupt(&module1));
+
+  // A map claiming a search index it's too small for.
+  string bad_index = file_data;
+  memcpy(&count, &bad_index[maps_offset], sizeof(count));
+  count |= kStaticMapSearchIndexFlag;
+  bad_index.replace(maps_offset, sizeof(count),
+                    reinterpret_cast<const char*>(&count), sizeof(count));
+  TestCodeModule module2("module2");
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMapBuffer(&module2, bad_index));
+  ASSERT_TRUE(fast_resolver.IsModuleCorrupt(&module2));
+
+  // Corrupt each byte of the module in turn.  Whatever the resolver makes
+  // of it, looking addresses up must stay within the file.
+  TestCodeModule module3("module3");
+  int rejected = 0;
+  for (size_t i = module_offset; i < file_data.size(); ++i) {
+    string corrupt = file_data;
+    corrupt[i] ^= 0xff;
+    ASSERT_TRUE(fast_resolver.LoadModuleUsingMapBuffer(&module3, corrupt));
+    if (fast_resolver.IsModuleCorrupt(&module3))
+      ++rejected;
+    for (uint64_t address = 0; address < 0xb000; address += 0x20) {
+      StackFrame frame;
+      frame.instruction = address;
+      frame.module = &module3;
+      fast_resolver.FillSourceLineInfo(&frame);
+      scoped_ptr<WindowsFrameInfo> windows_frame_info(
+          fast_resolver.FindWindowsFrameInfo(&frame));
+      scoped_ptr<CFIFrameInfo> cfi_frame_info(
+          fast_resolver.FindCFIFrameInfo(&frame));
+    }
+    fast_resolver.UnloadModule(&module3);
+  }
+  EXPECT_GT(rejected, 0);
+}
+
+TEST_F(TestFastSourceLineResolver, TestMappedBinarySymbolFile) {
+  string file_data = binary_symbol_file(1);
+  ASSERT_FALSE(file_data.empty());
+
+  // Lay the file out as SimpleSymbolSupplier expects.
+  AutoTempDir temp_dir;
+  string path = temp_dir.path() + "/module1.pdb";
+  ASSERT_EQ(0, mkdir(path.c_str(), 0755));
+  path += "/111111111111111111111111111111111";
+  ASSERT_EQ(0, mkdir(path.c_str(), 0755));
+  path += "/module1.sym";
+  std::ofstream file(path.c_str(), std::ios::binary);
+  file.write(file_data.data(), file_data.size());
+  file.close();
+  ASSERT_TRUE(file.good());
+
+  BasicCodeModule module1(0, 0xb000, "module1", "", "module1.pdb",
+                          "111111111111111111111111111111111", "");
+  SimpleSymbolSupplier supplier(temp_dir.path());
+  string symbol_file;
+  char *symbol_data = NULL;
+  size_t symbol_data_size = 0;
+  ASSERT_EQ(SymbolSupplier::FOUND,
+            supplier.GetCStringSymbolData(&module1, NULL, &symbol_file,
+                                          &symbol_data, &symbol_data_size));
+  ASSERT_EQ(path, symbol_file);
+  ASSERT_EQ(file_data.size(), symbol_data_size);
+  ASSERT_EQ(0, memcmp(file_data.data(), symbol_data, symbol_data_size));
+
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMemoryBuffer(
+      &module1, symbol_data, symbol_data_size));
+  ASSERT_FALSE(fast_resolver.IsModuleCorrupt(&module1));
+  StackFrame frame;
+  frame.instruction = 0x1000;
+  frame.module = &module1;
+  fast_resolver.FillSourceLineInfo(&frame);
+  ASSERT_EQ(frame.function_name, "Function1_1");
+  fast_resolver.UnloadModule(&module1);
+  supplier.FreeSymbolData(&module1);
+
+  // The mapping is read-only: BasicSourceLineResolver must reject it
+  // without writing to it.
+  ASSERT_EQ(SymbolSupplier::FOUND,
+            supplier.GetCStringSymbolData(&module1, NULL, &symbol_file,
+                                          &symbol_data, &symbol_data_size));
+  ASSERT_TRUE(basic_resolver.LoadModuleUsingMemoryBuffer(
+      &module1, symbol_data, symbol_data_size));
+  ASSERT_TRUE(basic_resolver.IsModuleCorrupt(&module1));
+  supplier.FreeSymbolData(&module1);
+}
+
 TEST_F(TestFastSourceLineResolver, CompareModule) {
   char *symbol_data;
   size_t symbol_data_size;
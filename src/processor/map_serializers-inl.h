@@ -57,6 +57,10 @@ size_t StdMapSerializer<Key, Value>::SizeOf(
   size_t size = 0;
   size_t header_size = (1 + m.size()) * sizeof(uint32_t);
   size += header_size;
+  if (HasSearchIndex(m.size())) {
+    size += sizeof(Key) *
+            (StaticMapSearchIndex<Key>::StoredKeys(m.size()) - m.size());
+  }
 
   typename std::map<Key, Value>::const_iterator iter;
   for (iter = m.begin(); iter != m.end(); ++iter) {
@@ -76,14 +80,18 @@ char *StdMapSerializer<Key, Value>::Write(const std::map<Key, Value> &m,
   char *start_address = dest;
 
   // Write header:
-  // Number of nodes.
-  dest = SimpleSerializer<uint32_t>::Write(m.size(), dest);
+  // Number of nodes, and whether the keys have a search index.
+  bool search_index = HasSearchIndex(m.size());
+  dest = SimpleSerializer<uint32_t>::Write(
+      m.size() | (search_index ? kStaticMapSearchIndexFlag : 0), dest);
   // Nodes offsets.
   uint32_t *offsets = reinterpret_cast<uint32_t*>(dest);
   dest += sizeof(uint32_t) * m.size();
 
   char *key_address = dest;
-  dest += sizeof(Key) * m.size();
+  Key *keys = reinterpret_cast<Key*>(dest);
+  dest += sizeof(Key) * (search_index ?
+      StaticMapSearchIndex<Key>::StoredKeys(m.size()) : m.size());
 
   // Traverse map.
   typename std::map<Key, Value>::const_iterator iter;
@@ -93,6 +101,8 @@ char *StdMapSerializer<Key, Value>::Write(const std::map<Key, Value> &m,
     key_address = key_serializer_.Write(iter->first, key_address);
     dest = value_serializer_.Write(iter->second, dest);
   }
+  if (search_index)
+    StaticMapSearchIndex<Key>::Write(keys, m.size());
   return dest;
 }
 
@@ -119,11 +129,16 @@ template<typename Address, typename Entry>
 size_t RangeMapSerializer<Address, Entry>::SizeOf(
     const RangeMap<Address, Entry> &m) const {
   size_t size = 0;
-  size_t header_size = (1 + m.map_.size()) * sizeof(uint32_t);
+  size_t header_size = (1 + m.GetCount()) * sizeof(uint32_t);
   size += header_size;
+  if (HasSearchIndex(m.GetCount())) {
+    size += sizeof(Address) *
+            (StaticMapSearchIndex<Address>::StoredKeys(m.GetCount()) -
+             m.GetCount());
+  }
 
-  typename std::map<Address, Range>::const_iterator iter;
-  for (iter = m.map_.begin(); iter != m.map_.end(); ++iter) {
+  typename RangeMap<Address, Entry>::ConstIterator iter = m.begin();
+  for (; iter != m.end(); ++iter) {
     // Size of key (high address).
     size += address_serializer_.SizeOf(iter->first);
     // Size of base (low address).
@@ -144,24 +159,30 @@ char *RangeMapSerializer<Address, Entry>::Write(
   char *start_address = dest;
 
   // Write header:
-  // Number of nodes.
-  dest = SimpleSerializer<uint32_t>::Write(m.map_.size(), dest);
+  // Number of nodes, and whether the keys have a search index.
+  bool search_index = HasSearchIndex(m.GetCount());
+  dest = SimpleSerializer<uint32_t>::Write(
+      m.GetCount() | (search_index ? kStaticMapSearchIndexFlag : 0), dest);
   // Nodes offsets.
   uint32_t *offsets = reinterpret_cast<uint32_t*>(dest);
-  dest += sizeof(uint32_t) * m.map_.size();
+  dest += sizeof(uint32_t) * m.GetCount();
 
   char *key_address = dest;
-  dest += sizeof(Address) * m.map_.size();
+  Address *keys = reinterpret_cast<Address*>(dest);
+  dest += sizeof(Address) * (search_index ?
+      StaticMapSearchIndex<Address>::StoredKeys(m.GetCount()) : m.GetCount());
 
   // Traverse map.
-  typename std::map<Address, Range>::const_iterator iter;
+  typename RangeMap<Address, Entry>::ConstIterator iter = m.begin();
   int index = 0;
-  for (iter = m.map_.begin(); iter != m.map_.end(); ++iter, ++index) {
+  for (; iter != m.end(); ++iter, ++index) {
     offsets[index] = static_cast<uint32_t>(dest - start_address);
     key_address = address_serializer_.Write(iter->first, key_address);
     dest = address_serializer_.Write(iter->second.base(), dest);
     dest = entry_serializer_.Write(iter->second.entry(), dest);
   }
+  if (search_index)
+    StaticMapSearchIndex<Address>::Write(keys, m.GetCount());
   return dest;
 }
 
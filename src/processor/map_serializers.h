@@ -40,6 +40,7 @@
 #include <string>
 
 #include "processor/simple_serializer.h"
+#include "processor/static_map_search_index.h"
 
 #include "processor/address_map-inl.h"
 #include "processor/range_map-inl.h"
@@ -52,6 +53,13 @@ namespace google_breakpad {
 template<typename Key, typename Value>
 class StdMapSerializer {
  public:
+  // If |search_index| is true, maps of integer keys that don't fit in a
+  // single block are written with a search index (see
+  // static_map_search_index.h), which makes lookups in large maps faster
+  // at the cost of about one extra key in seven.
+  explicit StdMapSerializer(bool search_index = false)
+      : search_index_(search_index) { }
+
   // Calculate the memory size of serialized data.
   size_t SizeOf(const std::map<Key, Value> &m) const;
 
@@ -69,6 +77,12 @@ class StdMapSerializer {
   char* Serialize(const std::map<Key, Value> &m, unsigned int *size) const;
 
  private:
+  // Returns true if a map of |num_nodes| keys gets a search index.
+  bool HasSearchIndex(size_t num_nodes) const {
+    return search_index_ && StaticMapSearchIndex<Key>::Wanted(num_nodes);
+  }
+
+  bool search_index_;
   SimpleSerializer<Key> key_serializer_;
   SimpleSerializer<Value> value_serializer_;
 };
@@ -78,6 +92,10 @@ class StdMapSerializer {
 template<typename Addr, typename Entry>
 class AddressMapSerializer {
  public:
+  // See StdMapSerializer for |search_index|.
+  explicit AddressMapSerializer(bool search_index = false)
+      : std_map_serializer_(search_index) { }
+
   // Calculate the memory size of serialized data.
   size_t SizeOf(const AddressMap<Addr, Entry> &m) const {
     return std_map_serializer_.SizeOf(m.map_);
@@ -109,6 +127,10 @@ class AddressMapSerializer {
 template<typename Address, typename Entry>
 class RangeMapSerializer {
  public:
+  // See StdMapSerializer for |search_index|.
+  explicit RangeMapSerializer(bool search_index = false)
+      : search_index_(search_index) { }
+
   // Calculate the memory size of serialized data.
   size_t SizeOf(const RangeMap<Address, Entry> &m) const;
 
@@ -127,6 +149,13 @@ class RangeMapSerializer {
   // Convenient type name for Range.
   typedef typename RangeMap<Address, Entry>::Range Range;
 
+  // Returns true if a map of |num_nodes| ranges gets a search index.
+  bool HasSearchIndex(size_t num_nodes) const {
+    return search_index_ && StaticMapSearchIndex<Address>::Wanted(num_nodes);
+  }
+
+  bool search_index_;
+
   // Serializer for RangeMap's key and Range::base_.
   SimpleSerializer<Address> address_serializer_;
   // Serializer for RangeMap::Range::entry_.
@@ -44,6 +44,8 @@
 #ifdef _WIN32
 #include <io.h>
 #else  // _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif  // _WIN32
 
@@ -1254,11 +1256,6 @@ const uint8_t* MinidumpMemoryRegion::GetMemory() const {
       return NULL;
     }
 
-    if (!minidump_->SeekSet(descriptor_->memory.rva)) {
-      BPLOG(ERROR) << "MinidumpMemoryRegion could not seek to memory region";
-      return NULL;
-    }
-
     if (descriptor_->memory.data_size > max_bytes_) {
       BPLOG(ERROR) << "MinidumpMemoryRegion size " <<
                       descriptor_->memory.data_size << " exceeds maximum " <<
@@ -1266,6 +1263,21 @@ const uint8_t* MinidumpMemoryRegion::GetMemory() const {
       return NULL;
     }
 
+    // A memory-mapped minidump is read in place: only the pages the caller
+    // touches are brought in.  This path does not move the file position,
+    // so several threads may walk stacks in a mapped minidump at once.
+    const uint8_t* mapped_memory =
+        minidump_->MapBytes(descriptor_->memory.rva,
+                            descriptor_->memory.data_size);
+    if (mapped_memory) {
+      return mapped_memory;
+    }
+
+    if (!minidump_->SeekSet(descriptor_->memory.rva)) {
+      BPLOG(ERROR) << "MinidumpMemoryRegion could not seek to memory region";
+      return NULL;
+    }
+
     scoped_ptr< vector<uint8_t> > memory(
         new vector<uint8_t>(descriptor_->memory.data_size));
 
@@ -2595,6 +2607,8 @@ uint32_t MinidumpModuleList::max_modules_ = 2048;
 MinidumpModuleList::MinidumpModuleList(Minidump* minidump)
     : MinidumpStream(minidump),
       range_map_(new RangeMap<uint64_t, unsigned int>()),
+      range_map_built_(false),
+      range_map_usable_(false),
       modules_(NULL),
       module_count_(0) {
   range_map_->SetEnableShrinkDown(minidump_->IsAndroid());
@@ -2610,6 +2624,8 @@ MinidumpModuleList::~MinidumpModuleList() {
 bool MinidumpModuleList::Read(uint32_t expected_size) {
   // Invalidate cached data.
   range_map_->Clear();
+  range_map_built_ = false;
+  range_map_usable_ = false;
   delete modules_;
   modules_ = NULL;
   module_count_ = 0;
@@ -2678,12 +2694,13 @@ bool MinidumpModuleList::Read(uint32_t expected_size) {
       }
     }
 
-    // Loop through the module list once more to read additional data and
-    // build the range map.  This is done in a second pass because
+    // Loop through the module list once more to read additional data.
+    // This is done in a second pass because
     // MinidumpModule::ReadAuxiliaryData seeks around, and if it were
     // included in the loop above, additional seeks would be needed where
-    // none are now to read contiguous data.
-    uint64_t last_end_address = 0;
+    // none are now to read contiguous data.  The range map is not built
+    // here, but on the first lookup by address (see BuildRangeMap), so that
+    // callers that do not need it do not pay for it.
     for (unsigned int module_index = 0;
          module_index < module_count;
          ++module_index) {
@@ -2704,63 +2721,85 @@ bool MinidumpModuleList::Read(uint32_t expected_size) {
       // It is safe to use module->code_file() after successfully calling
       // module->ReadAuxiliaryData or noting that the module is valid.
 
-      uint64_t base_address = module->base_address();
-      uint64_t module_size = module->size();
-      if (base_address == static_cast<uint64_t>(-1)) {
+      if (module->base_address() == static_cast<uint64_t>(-1)) {
         BPLOG(ERROR) << "MinidumpModuleList found bad base address "
                         "for module " << module_index << "/" << module_count <<
                         ", " << module->code_file();
         return false;
       }
+    }
 
-      if (!range_map_->StoreRange(base_address, module_size, module_index)) {
-        // Android's shared memory implementation /dev/ashmem can contain
-        // duplicate entries for JITted code, so ignore these.
-        // TODO(wfh): Remove this code when Android is fixed.
-        // See https://crbug.com/439531
-        const string kDevAshmem("/dev/ashmem/");
-        if (module->code_file().compare(
-            0, kDevAshmem.length(), kDevAshmem) != 0) {
-          if (base_address < last_end_address) {
-            // If failed due to apparent range overlap the cause may be
-            // the client correction applied for Android packed relocations.
-            // If this is the case, back out the client correction and retry.
-            module_size -= last_end_address - base_address;
-            base_address = last_end_address;
-            if (!range_map_->StoreRange(base_address,
-                                        module_size, module_index)) {
-              BPLOG(ERROR) << "MinidumpModuleList could not store module " <<
-                              module_index << "/" << module_count << ", " <<
-                              module->code_file() << ", " <<
-                              HexString(base_address) << "+" <<
-                              HexString(module_size) << ", after adjusting";
-              return false;
-            }
-          } else {
+    modules_ = modules.release();
+  }
+
+  module_count_ = module_count;
+
+  valid_ = true;
+  return true;
+}
+
+
+bool MinidumpModuleList::BuildRangeMap() const {
+  std::lock_guard<std::mutex> lock(range_map_lock_);
+  if (range_map_built_) {
+    return range_map_usable_;
+  }
+  range_map_built_ = true;
+
+  uint64_t last_end_address = 0;
+  for (unsigned int module_index = 0;
+       module_index < module_count_;
+       ++module_index) {
+    const MinidumpModule* module = &(*modules_)[module_index];
+
+    uint64_t base_address = module->base_address();
+    uint64_t module_size = module->size();
+    if (!range_map_->StoreRange(base_address, module_size, module_index)) {
+      // Android's shared memory implementation /dev/ashmem can contain
+      // duplicate entries for JITted code, so ignore these.
+      // TODO(wfh): Remove this code when Android is fixed.
+      // See https://crbug.com/439531
+      const string kDevAshmem("/dev/ashmem/");
+      if (module->code_file().compare(
+          0, kDevAshmem.length(), kDevAshmem) != 0) {
+        if (base_address < last_end_address) {
+          // If failed due to apparent range overlap the cause may be
+          // the client correction applied for Android packed relocations.
+          // If this is the case, back out the client correction and retry.
+          module_size -= last_end_address - base_address;
+          base_address = last_end_address;
+          if (!range_map_->StoreRange(base_address,
+                                      module_size, module_index)) {
             BPLOG(ERROR) << "MinidumpModuleList could not store module " <<
-                            module_index << "/" << module_count << ", " <<
+                            module_index << "/" << module_count_ << ", " <<
                             module->code_file() << ", " <<
                             HexString(base_address) << "+" <<
-                            HexString(module_size);
+                            HexString(module_size) << ", after adjusting" <<
+                            ", looking modules up by scanning instead";
+            range_map_->Clear();
             return false;
           }
         } else {
-          BPLOG(INFO) << "MinidumpModuleList ignoring overlapping module " <<
-                          module_index << "/" << module_count << ", " <<
+          BPLOG(ERROR) << "MinidumpModuleList could not store module " <<
+                          module_index << "/" << module_count_ << ", " <<
                           module->code_file() << ", " <<
                           HexString(base_address) << "+" <<
-                          HexString(module_size);
+                          HexString(module_size) <<
+                          ", looking modules up by scanning instead";
+          range_map_->Clear();
+          return false;
         }
+      } else {
+        BPLOG(INFO) << "MinidumpModuleList ignoring overlapping module " <<
+                        module_index << "/" << module_count_ << ", " <<
+                        module->code_file() << ", " <<
+                        HexString(base_address) << "+" <<
+                        HexString(module_size);
       }
-      last_end_address = base_address + module_size;
     }
-
-    modules_ = modules.release();
+    last_end_address = base_address + module_size;
   }
-
-  module_count_ = module_count;
-
-  valid_ = true;
+  range_map_usable_ = true;
   return true;
 }
 
@@ -2772,6 +2811,22 @@ const MinidumpModule* MinidumpModuleList::GetModuleForAddress(
     return NULL;
   }
 
+  if (!BuildRangeMap()) {
+    // The modules overlap.  Take the first one containing |address|.
+    for (unsigned int module_index = 0;
+         module_index < module_count_;
+         ++module_index) {
+      const MinidumpModule* module = &(*modules_)[module_index];
+      if (address >= module->base_address() &&
+          address - module->base_address() < module->size()) {
+        return module;
+      }
+    }
+    BPLOG(INFO) << "MinidumpModuleList has no module at " <<
+                   HexString(address);
+    return NULL;
+  }
+
   unsigned int module_index;
   if (!range_map_->RetrieveRange(address, &module_index, NULL /* base */,
                                  NULL /* delta */, NULL /* size */)) {
@@ -2809,6 +2864,12 @@ const MinidumpModule* MinidumpModuleList::GetModuleAtSequence(
     return NULL;
   }
 
+  if (!BuildRangeMap()) {
+    // The modules overlap and cannot be ordered by address; use the order
+    // they appear in the minidump.
+    return GetModuleAtIndex(sequence);
+  }
+
   unsigned int module_index;
   if (!range_map_->RetrieveRangeAtIndex(sequence, &module_index,
                                         NULL /* base */, NULL /* delta */,
@@ -2882,6 +2943,7 @@ uint32_t MinidumpMemoryList::max_regions_ = 4096;
 MinidumpMemoryList::MinidumpMemoryList(Minidump* minidump)
     : MinidumpStream(minidump),
       range_map_(new RangeMap<uint64_t, unsigned int>()),
+      range_map_built_(false),
       descriptors_(NULL),
       regions_(NULL),
       region_count_(0) {
@@ -2902,6 +2964,7 @@ bool MinidumpMemoryList::Read(uint32_t expected_size) {
   delete regions_;
   regions_ = NULL;
   range_map_->Clear();
+  range_map_built_ = false;
   region_count_ = 0;
 
   valid_ = false;
@@ -2988,14 +3051,6 @@ bool MinidumpMemoryList::Read(uint32_t expected_size) {
         return false;
       }
 
-      if (!range_map_->StoreRange(base_address, region_size, region_index)) {
-        BPLOG(ERROR) << "MinidumpMemoryList could not store memory region " <<
-                        region_index << "/" << region_count << ", " <<
-                        HexString(base_address) << "+" <<
-                        HexString(region_size);
-        return false;
-      }
-
       (*regions)[region_index].SetDescriptor(descriptor);
     }
 
@@ -3027,6 +3082,34 @@ MinidumpMemoryRegion* MinidumpMemoryList::GetMemoryRegionAtIndex(
 }
 
 
+bool MinidumpMemoryList::BuildRangeMap() {
+  std::lock_guard<std::mutex> lock(range_map_lock_);
+  // A map that could not be built was cleared, lookups find nothing in it.
+  if (range_map_built_) {
+    return true;
+  }
+  range_map_built_ = true;
+
+  for (unsigned int region_index = 0;
+       region_index < region_count_;
+       ++region_index) {
+    const MDMemoryDescriptor* descriptor = &(*descriptors_)[region_index];
+    uint64_t base_address = descriptor->start_of_memory_range;
+    uint32_t region_size = descriptor->memory.data_size;
+
+    if (!range_map_->StoreRange(base_address, region_size, region_index)) {
+      BPLOG(ERROR) << "MinidumpMemoryList could not store memory region " <<
+                      region_index << "/" << region_count_ << ", " <<
+                      HexString(base_address) << "+" <<
+                      HexString(region_size);
+      range_map_->Clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+
 MinidumpMemoryRegion* MinidumpMemoryList::GetMemoryRegionForAddress(
     uint64_t address) {
   if (!valid_) {
@@ -3035,7 +3118,8 @@ MinidumpMemoryRegion* MinidumpMemoryList::GetMemoryRegionForAddress(
   }
 
   unsigned int region_index;
-  if (!range_map_->RetrieveRange(address, &region_index, NULL /* base */,
+  if (!BuildRangeMap() ||
+      !range_map_->RetrieveRange(address, &region_index, NULL /* base */,
                                  NULL /* delta */, NULL /* size */)) {
     BPLOG(INFO) << "MinidumpMemoryList has no memory region at " <<
                    HexString(address);
@@ -4714,18 +4798,23 @@ bool MinidumpLinuxMapsList::Read(uint32_t expected_size) {
     return false;
   }
 
-  // Create a vector to read stream data. The vector needs to have
-  // at least enough capacity to read all the data.
-  vector<char> mapping_bytes(length);
-  if (!minidump_->ReadBytes(&mapping_bytes[0], length)) {
-    BPLOG(ERROR) << "MinidumpLinuxMapsList failed to read bytes";
-    return false;
+  // The stream is text and is parsed as is: in place when the minidump is
+  // memory-mapped, from a copy otherwise.
+  const char* map_text = reinterpret_cast<const char*>(
+      minidump_->MapBytes(minidump_->Tell(), length));
+  string map_string;
+  if (!map_text) {
+    map_string.resize(length);
+    if (length && !minidump_->ReadBytes(&map_string[0], length)) {
+      BPLOG(ERROR) << "MinidumpLinuxMapsList failed to read bytes";
+      return false;
+    }
+    map_text = map_string.data();
   }
-  string map_string(mapping_bytes.begin(), mapping_bytes.end());
   vector<MappedMemoryRegion> all_regions;
 
   // Parse string into mapping data.
-  if (!ParseProcMaps(map_string, &all_regions)) {
+  if (!ParseProcMaps(map_text, length, &all_regions)) {
     return false;
   }
 
@@ -4957,6 +5046,9 @@ Minidump::Minidump(const string& path, bool hexdump, unsigned int hexdump_width)
       stream_map_(new MinidumpStreamMap()),
       path_(path),
       stream_(NULL),
+      mapped_data_(NULL),
+      mapped_size_(0),
+      mapped_position_(0),
       swap_(false),
       valid_(false),
       hexdump_(hexdump),
@@ -4969,6 +5061,9 @@ Minidump::Minidump(istream& stream)
       stream_map_(new MinidumpStreamMap()),
       path_(),
       stream_(&stream),
+      mapped_data_(NULL),
+      mapped_size_(0),
+      mapped_position_(0),
       swap_(false),
       valid_(false),
       hexdump_(false),
@@ -4976,19 +5071,24 @@ Minidump::Minidump(istream& stream)
 }
 
 Minidump::~Minidump() {
-  if (stream_) {
+  if (stream_ || mapped_data_) {
     BPLOG(INFO) << "Minidump closing minidump";
   }
   if (!path_.empty()) {
     delete stream_;
   }
+#ifndef _WIN32
+  if (mapped_data_) {
+    munmap(const_cast<uint8_t*>(mapped_data_), mapped_size_);
+  }
+#endif  // _WIN32
   delete directory_;
   delete stream_map_;
 }
 
 
 bool Minidump::Open() {
-  if (stream_ != NULL) {
+  if (stream_ != NULL || mapped_data_ != NULL) {
     BPLOG(INFO) << "Minidump reopening minidump " << path_;
 
     // The file is already open.  Seek to the beginning, which is the position
@@ -4996,6 +5096,11 @@ bool Minidump::Open() {
     return SeekSet(0);
   }
 
+  if (MapFile()) {
+    BPLOG(INFO) << "Minidump mapped minidump " << path_;
+    return true;
+  }
+
   stream_ = new ifstream(path_.c_str(), std::ios::in | std::ios::binary);
   if (!stream_ || !stream_->good()) {
     string error_string;
@@ -5009,6 +5114,35 @@ bool Minidump::Open() {
   return true;
 }
 
+bool Minidump::MapFile() {
+#ifdef _WIN32
+  return false;
+#else  // _WIN32
+  int fd = open(path_.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+
+  // Empty files and non-regular files (pipes, devices) are left to the
+  // stream, which reports errors on them the way it always did.
+  struct stat st;
+  void* data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+      static_cast<uint64_t>(st.st_size) <= numeric_limits<size_t>::max()) {
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  mapped_data_ = static_cast<const uint8_t*>(data);
+  mapped_size_ = st.st_size;
+  mapped_position_ = 0;
+  return true;
+#endif  // _WIN32
+}
+
 bool Minidump::GetContextCPUFlagsFromSystemInfo(uint32_t *context_cpu_flags) {
   // Initialize output parameters
   *context_cpu_flags = 0;
@@ -5447,6 +5581,17 @@ const MDRawDirectory* Minidump::GetDirectoryEntryAtIndex(unsigned int index)
 bool Minidump::ReadBytes(void* bytes, size_t count) {
   // Can't check valid_ because Read needs to call this method before
   // validity can be determined.
+  if (mapped_data_) {
+    const uint8_t* mapped_bytes = MapBytes(mapped_position_, count);
+    if (!mapped_bytes) {
+      BPLOG(ERROR) << "ReadBytes: read past the end of the minidump, " <<
+                      count << " bytes at " << mapped_position_;
+      return false;
+    }
+    memcpy(bytes, mapped_bytes, count);
+    mapped_position_ += count;
+    return true;
+  }
   if (!stream_) {
     return false;
   }
@@ -5479,6 +5624,15 @@ bool Minidump::ReadBytes(void* bytes, size_t count) {
 bool Minidump::SeekSet(off_t offset) {
   // Can't check valid_ because Read needs to call this method before
   // validity can be determined.
+  if (mapped_data_) {
+    // Like a stream, seeking past the end succeeds and reading fails.
+    if (offset < 0) {
+      BPLOG(ERROR) << "SeekSet: negative offset " << offset;
+      return false;
+    }
+    mapped_position_ = offset;
+    return true;
+  }
   if (!stream_) {
     return false;
   }
@@ -5493,6 +5647,9 @@ bool Minidump::SeekSet(off_t offset) {
 }
 
 off_t Minidump::Tell() {
+  if (valid_ && mapped_data_) {
+    return mapped_position_;
+  }
   if (!valid_ || !stream_) {
     return (off_t)-1;
   }
@@ -5509,6 +5666,16 @@ off_t Minidump::Tell() {
 }
 
 
+const uint8_t* Minidump::MapBytes(off_t offset, size_t count) const {
+  if (!mapped_data_ || offset < 0 ||
+      static_cast<uint64_t>(offset) > mapped_size_ ||
+      count > mapped_size_ - static_cast<size_t>(offset)) {
+    return NULL;
+  }
+  return mapped_data_ + offset;
+}
+
+
 string* Minidump::ReadString(off_t offset) {
   if (!valid_) {
     BPLOG(ERROR) << "Invalid Minidump for ReadString";
@@ -31,7 +31,11 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <atomic>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "common/scoped_ptr.h"
 #include "common/stdio_wrapper.h"
@@ -47,12 +51,77 @@
 
 namespace google_breakpad {
 
+namespace {
+
+// A stack to walk, gathered from the minidump before any walking starts.
+struct ThreadWalk {
+  // Identifies the thread in log messages.
+  string thread_string;
+  uint32_t thread_id;
+  DumpContext *context;
+  MemoryRegion *memory;
+  // Owned by the ProcessState.
+  CallStack *stack;
+  // Where the walk records modules lacking symbols.  These point into the
+  // ProcessState when walking one thread at a time, into the vectors below
+  // otherwise.
+  vector<const CodeModule*> *modules_without_symbols;
+  vector<const CodeModule*> *modules_with_corrupt_symbols;
+  vector<const CodeModule*> own_modules_without_symbols;
+  vector<const CodeModule*> own_modules_with_corrupt_symbols;
+  bool interrupted;
+};
+
+void WalkThread(const SystemInfo *system_info,
+                const CodeModules *modules,
+                const CodeModules *unloaded_modules,
+                StackFrameSymbolizer *frame_symbolizer,
+                ThreadWalk *walk) {
+  scoped_ptr<Stackwalker> stackwalker(
+      Stackwalker::StackwalkerForCPU(system_info,
+                                     walk->context,
+                                     walk->memory,
+                                     modules,
+                                     unloaded_modules,
+                                     frame_symbolizer));
+
+  if (stackwalker.get()) {
+    if (!stackwalker->Walk(walk->stack,
+                           walk->modules_without_symbols,
+                           walk->modules_with_corrupt_symbols)) {
+      BPLOG(INFO) << "Stackwalker interrupt (missing symbols?) at "
+                  << walk->thread_string;
+      walk->interrupted = true;
+    }
+  } else {
+    // Threads with missing CPU contexts will hit this, but
+    // don't abort processing the rest of the dump just for
+    // one bad thread.
+    BPLOG(ERROR) << "No stackwalker for " << walk->thread_string;
+  }
+  walk->stack->set_tid(walk->thread_id);
+}
+
+// Appends the modules of |from| missing from |to|, keeping their order.
+void MergeModules(const vector<const CodeModule*> &from,
+                  vector<const CodeModule*> *to) {
+  for (vector<const CodeModule*>::const_iterator iter = from.begin();
+       iter != from.end();
+       ++iter) {
+    if (std::find(to->begin(), to->end(), *iter) == to->end())
+      to->push_back(*iter);
+  }
+}
+
+}  // namespace
+
 MinidumpProcessor::MinidumpProcessor(SymbolSupplier *supplier,
                                      SourceLineResolverInterface *resolver)
     : frame_symbolizer_(new StackFrameSymbolizer(supplier, resolver)),
       own_frame_symbolizer_(true),
       enable_exploitability_(false),
-      enable_objdump_(false) {
+      enable_objdump_(false),
+      stackwalk_threads_(1) {
 }
 
 MinidumpProcessor::MinidumpProcessor(SymbolSupplier *supplier,
@@ -61,7 +130,8 @@ MinidumpProcessor::MinidumpProcessor(SymbolSupplier *supplier,
     : frame_symbolizer_(new StackFrameSymbolizer(supplier, resolver)),
       own_frame_symbolizer_(true),
       enable_exploitability_(enable_exploitability),
-      enable_objdump_(false) {
+      enable_objdump_(false),
+      stackwalk_threads_(1) {
 }
 
 MinidumpProcessor::MinidumpProcessor(StackFrameSymbolizer *frame_symbolizer,
@@ -69,7 +139,8 @@ MinidumpProcessor::MinidumpProcessor(StackFrameSymbolizer *frame_symbolizer,
     : frame_symbolizer_(frame_symbolizer),
       own_frame_symbolizer_(false),
       enable_exploitability_(enable_exploitability),
-      enable_objdump_(false) {
+      enable_objdump_(false),
+      stackwalk_threads_(1) {
   assert(frame_symbolizer_);
 }
 
@@ -177,6 +248,13 @@ ProcessResult MinidumpProcessor::Process(
   // Reset frame_symbolizer_ at the beginning of stackwalk for each minidump.
   frame_symbolizer_->Reset();
 
+  // The stacks are walked once all the threads have been looked at.  The
+  // walks then only read what was already read from the minidump, so that
+  // they may run concurrently.
+  bool concurrent = stackwalk_threads_ > 1 && thread_count > 1;
+  vector<ThreadWalk> walks;
+  walks.reserve(thread_count);
+
   for (unsigned int thread_index = 0;
        thread_index < thread_count;
        ++thread_index) {
@@ -253,42 +331,83 @@ ProcessResult MinidumpProcessor::Process(
     }
     if (!thread_memory) {
       BPLOG(ERROR) << "No memory region for " << thread_string;
+    } else if (concurrent) {
+      // Reads the stack into memory, unless the minidump is mapped.
+      thread_memory->GetMemory();
     }
 
-    // Use process_state->modules_ instead of module_list, because the
-    // |modules| argument will be used to populate the |module| fields in
-    // the returned StackFrame objects, which will be placed into the
-    // returned ProcessState object.  module_list's lifetime is only as
-    // long as the Minidump object: it will be deleted when this function
-    // returns.  process_state->modules_ is owned by the ProcessState object
-    // (just like the StackFrame objects), and is much more suitable for this
-    // task.
-    scoped_ptr<Stackwalker> stackwalker(
-        Stackwalker::StackwalkerForCPU(process_state->system_info(),
-                                       context,
-                                       thread_memory,
-                                       process_state->modules_,
-                                       process_state->unloaded_modules_,
-                                       frame_symbolizer_));
-
-    scoped_ptr<CallStack> stack(new CallStack());
-    if (stackwalker.get()) {
-      if (!stackwalker->Walk(stack.get(),
-                             &process_state->modules_without_symbols_,
-                             &process_state->modules_with_corrupt_symbols_)) {
-        BPLOG(INFO) << "Stackwalker interrupt (missing symbols?) at "
-                    << thread_string;
-        interrupted = true;
-      }
+    CallStack *stack = new CallStack();
+    process_state->threads_.push_back(stack);
+    process_state->thread_memory_regions_.push_back(thread_memory);
+
+    ThreadWalk walk;
+    walk.thread_string = thread_string;
+    walk.thread_id = thread_id;
+    walk.context = context;
+    walk.memory = thread_memory;
+    walk.stack = stack;
+    walk.interrupted = false;
+    walks.push_back(walk);
+    if (concurrent) {
+      walks.back().modules_without_symbols =
+          &walks.back().own_modules_without_symbols;
+      walks.back().modules_with_corrupt_symbols =
+          &walks.back().own_modules_with_corrupt_symbols;
     } else {
-      // Threads with missing CPU contexts will hit this, but
-      // don't abort processing the rest of the dump just for
-      // one bad thread.
-      BPLOG(ERROR) << "No stackwalker for " << thread_string;
+      walks.back().modules_without_symbols =
+          &process_state->modules_without_symbols_;
+      walks.back().modules_with_corrupt_symbols =
+          &process_state->modules_with_corrupt_symbols_;
     }
-    stack->set_tid(thread_id);
-    process_state->threads_.push_back(stack.release());
-    process_state->thread_memory_regions_.push_back(thread_memory);
+  }
+
+  // Use process_state->modules_ instead of module_list, because the
+  // |modules| argument will be used to populate the |module| fields in
+  // the returned StackFrame objects, which will be placed into the
+  // returned ProcessState object.  module_list's lifetime is only as
+  // long as the Minidump object: it will be deleted when this function
+  // returns.  process_state->modules_ is owned by the ProcessState object
+  // (just like the StackFrame objects), and is much more suitable for this
+  // task.
+  if (!concurrent) {
+    for (size_t i = 0; i < walks.size(); ++i) {
+      WalkThread(process_state->system_info(), process_state->modules_,
+                 process_state->unloaded_modules_, frame_symbolizer_,
+                 &walks[i]);
+    }
+  } else {
+    // Each worker takes the next walk that has not been started.
+    std::atomic<size_t> next_walk(0);
+    vector<std::thread> workers;
+    unsigned int worker_count = stackwalk_threads_ < walks.size() ?
+        stackwalk_threads_ : walks.size();
+    for (unsigned int i = 0; i < worker_count; ++i) {
+      workers.push_back(std::thread([&]() {
+        size_t index;
+        while ((index = next_walk++) < walks.size()) {
+          WalkThread(process_state->system_info(), process_state->modules_,
+                     process_state->unloaded_modules_, frame_symbolizer_,
+                     &walks[index]);
+        }
+      }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+      workers[i].join();
+    }
+
+    // Report the modules in the order a single thread would have found
+    // them.
+    for (size_t i = 0; i < walks.size(); ++i) {
+      MergeModules(walks[i].own_modules_without_symbols,
+                   &process_state->modules_without_symbols_);
+      MergeModules(walks[i].own_modules_with_corrupt_symbols,
+                   &process_state->modules_with_corrupt_symbols_);
+    }
+  }
+
+  for (size_t i = 0; i < walks.size(); ++i) {
+    if (walks[i].interrupted)
+      interrupted = true;
   }
 
   if (interrupted) {
@@ -647,6 +647,91 @@ TEST_F(MinidumpProcessorTest, TestThreadMissingMemory) {
   ASSERT_EQ(kExpectedEIP, state.threads()->at(0)->frames()->at(0)->instruction);
 }
 
+TEST_F(MinidumpProcessorTest, TestConcurrentStackwalk) {
+  MockMinidump dump;
+  EXPECT_CALL(dump, path()).WillRepeatedly(Return("mock minidump"));
+  EXPECT_CALL(dump, Read()).WillRepeatedly(Return(true));
+
+  MDRawHeader fake_header;
+  fake_header.time_date_stamp = 0;
+  EXPECT_CALL(dump, header()).WillRepeatedly(Return(&fake_header));
+
+  MDRawSystemInfo raw_system_info;
+  memset(&raw_system_info, 0, sizeof(raw_system_info));
+  raw_system_info.processor_architecture = MD_CPU_ARCHITECTURE_X86;
+  raw_system_info.platform_id = MD_OS_WIN32_NT;
+  TestMinidumpSystemInfo dump_system_info(raw_system_info);
+
+  EXPECT_CALL(dump, GetSystemInfo()).
+      WillRepeatedly(Return(&dump_system_info));
+
+  MockMinidumpThreadList thread_list;
+  EXPECT_CALL(dump, GetThreadList()).
+      WillRepeatedly(Return(&thread_list));
+
+  // Each thread has its own stack and a context pointing at a distinct
+  // instruction, so that results landing in the wrong thread show.
+  const unsigned int kThreadCount = 16;
+  const uint32_t kFirstEIP = 0xabcd0000;
+  MockMinidumpThread threads[kThreadCount];
+  scoped_ptr<TestMinidumpContext> contexts[kThreadCount];
+  scoped_ptr<MockMinidumpMemoryRegion> stacks[kThreadCount];
+  for (unsigned int i = 0; i < kThreadCount; ++i) {
+    EXPECT_CALL(threads[i], GetThreadID(_)).
+      WillRepeatedly(DoAll(SetArgumentPointee<0>(100 + i),
+                           Return(true)));
+
+    stacks[i].reset(new MockMinidumpMemoryRegion(0x10000 * (i + 1),
+                                                 string(64, '\0')));
+    EXPECT_CALL(threads[i], GetMemory()).
+      WillRepeatedly(Return(stacks[i].get()));
+
+    MDRawContextX86 raw_context;
+    memset(&raw_context, 0, sizeof(raw_context));
+    raw_context.context_flags = MD_CONTEXT_X86_FULL;
+    raw_context.eip = kFirstEIP + i;
+    raw_context.esp = 0x10000 * (i + 1);
+    contexts[i].reset(new TestMinidumpContext(raw_context));
+    EXPECT_CALL(threads[i], GetContext()).
+      WillRepeatedly(Return(contexts[i].get()));
+
+    EXPECT_CALL(thread_list, GetThreadAtIndex(i)).
+      WillRepeatedly(Return(&threads[i]));
+  }
+  EXPECT_CALL(thread_list, thread_count()).
+    WillRepeatedly(Return(kThreadCount));
+
+  MinidumpProcessor processor(reinterpret_cast<SymbolSupplier*>(NULL), NULL);
+  ProcessState serial_state;
+  EXPECT_EQ(processor.Process(&dump, &serial_state),
+            google_breakpad::PROCESS_OK);
+
+  processor.set_stackwalk_threads(4);
+  ProcessState state;
+  EXPECT_EQ(processor.Process(&dump, &state),
+            google_breakpad::PROCESS_OK);
+
+  // The stacks come out in the minidump's order, whichever thread walked
+  // them.
+  ASSERT_EQ(kThreadCount, state.threads()->size());
+  ASSERT_EQ(kThreadCount, serial_state.threads()->size());
+  for (unsigned int i = 0; i < kThreadCount; ++i) {
+    CallStack *stack = state.threads()->at(i);
+    CallStack *serial_stack = serial_state.threads()->at(i);
+    EXPECT_EQ(100 + i, stack->tid());
+    EXPECT_EQ(stacks[i].get(), state.thread_memory_regions()->at(i));
+    ASSERT_EQ(serial_stack->frames()->size(), stack->frames()->size());
+    ASSERT_LE(1U, stack->frames()->size());
+    EXPECT_EQ(kFirstEIP + i, stack->frames()->at(0)->instruction);
+    for (size_t j = 0; j < stack->frames()->size(); ++j) {
+      EXPECT_EQ(serial_stack->frames()->at(j)->instruction,
+                stack->frames()->at(j)->instruction);
+      EXPECT_EQ(serial_stack->frames()->at(j)->trust,
+                stack->frames()->at(j)->trust);
+    }
+  }
+}
+
 TEST_F(MinidumpProcessorTest, GetProcessCreateTime) {
   const uint32_t kProcessCreateTime = 2000;
   const uint32_t kTimeDateStamp = 5000;
@@ -33,6 +33,7 @@
 // Author: Mark Mentovai
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -57,6 +58,7 @@ namespace {
 struct Options {
   bool machine_readable;
   bool output_stack_contents;
+  unsigned int stackwalk_threads;
 
   string minidump_file;
   std::vector<string> symbol_paths;
@@ -91,6 +93,7 @@ bool PrintMinidumpProcess(const Options& options) {
 
   BasicSourceLineResolver resolver;
   MinidumpProcessor minidump_processor(symbol_supplier.get(), &resolver);
+  minidump_processor.set_stackwalk_threads(options.stackwalk_threads);
 
   // Increase the maximum number of threads and regions.
   MinidumpThreadList::set_max_threads(std::numeric_limits<uint32_t>::max());
@@ -127,6 +130,7 @@ static void Usage(int argc, const char *argv[], bool error) {
           "\n"
           "Options:\n"
           "\n"
+          "  -j <jobs>  Walk up to <jobs> thread stacks at once\n"
           "  -m         Output in machine-readable format\n"
           "  -s         Output stack contents\n",
           google_breakpad::BaseName(argv[0]).c_str());
@@ -137,14 +141,26 @@ static void SetupOptions(int argc, const char *argv[], Options* options) {
 
   options->machine_readable = false;
   options->output_stack_contents = false;
+  options->stackwalk_threads = 1;
 
-  while ((ch = getopt(argc, (char * const *)argv, "hms")) != -1) {
+  while ((ch = getopt(argc, (char * const *)argv, "hj:ms")) != -1) {
     switch (ch) {
       case 'h':
         Usage(argc, argv, false);
         exit(0);
         break;
 
+      case 'j': {
+        int jobs = atoi(optarg);
+        if (jobs < 1) {
+          fprintf(stderr, "%s: Invalid job count: %s\n", argv[0], optarg);
+          Usage(argc, argv, true);
+          exit(1);
+        }
+        options->stackwalk_threads = jobs;
+        break;
+      }
+
       case 'm':
         options->machine_readable = true;
         break;
@@ -30,11 +30,13 @@
 // Unit test for Minidump.  Uses a pre-generated minidump and
 // verifies that certain streams are correct.
 
+#include <atomic>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <stdlib.h>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "breakpad_googletest_includes.h"
@@ -131,6 +133,54 @@ TEST_F(MinidumpTest, TestMinidumpFromStream) {
   //TODO: add more checks here
 }
 
+TEST_F(MinidumpTest, TestMappedMinidumpMatchesStream) {
+  ifstream file_stream(minidump_file_.c_str(), std::ios::in | std::ios::binary);
+  ASSERT_TRUE(file_stream.good());
+  Minidump streamed(file_stream);
+  ASSERT_TRUE(streamed.Read());
+  ASSERT_EQ(NULL, streamed.MapBytes(0, sizeof(MDRawHeader)));
+
+  Minidump mapped(minidump_file_);
+  ASSERT_TRUE(mapped.Read());
+  ASSERT_TRUE(mapped.MapBytes(0, sizeof(MDRawHeader)) != NULL);
+  ASSERT_EQ(NULL, mapped.MapBytes(0, 1U << 30));
+
+  MinidumpThreadList* streamed_threads = streamed.GetThreadList();
+  MinidumpThreadList* mapped_threads = mapped.GetThreadList();
+  ASSERT_TRUE(streamed_threads != NULL);
+  ASSERT_TRUE(mapped_threads != NULL);
+  ASSERT_EQ(streamed_threads->thread_count(), mapped_threads->thread_count());
+  for (unsigned int i = 0; i < mapped_threads->thread_count(); ++i) {
+    MinidumpMemoryRegion* streamed_stack =
+        streamed_threads->GetThreadAtIndex(i)->GetMemory();
+    MinidumpMemoryRegion* mapped_stack =
+        mapped_threads->GetThreadAtIndex(i)->GetMemory();
+    ASSERT_TRUE(streamed_stack != NULL);
+    ASSERT_TRUE(mapped_stack != NULL);
+    ASSERT_EQ(streamed_stack->GetSize(), mapped_stack->GetSize());
+    ASSERT_EQ(0, memcmp(streamed_stack->GetMemory(), mapped_stack->GetMemory(),
+                        mapped_stack->GetSize()));
+
+    // The stack of the mapped minidump is a view into the file.
+    const MDRawThread* raw_thread =
+        mapped_threads->GetThreadAtIndex(i)->thread();
+    ASSERT_EQ(mapped.MapBytes(raw_thread->stack.memory.rva,
+                              raw_thread->stack.memory.data_size),
+              mapped_stack->GetMemory());
+  }
+
+  MinidumpException* streamed_exception = streamed.GetException();
+  MinidumpException* mapped_exception = mapped.GetException();
+  ASSERT_TRUE(streamed_exception != NULL);
+  ASSERT_TRUE(mapped_exception != NULL);
+  uint64_t streamed_ip, mapped_ip;
+  ASSERT_TRUE(streamed_exception->GetContext()->GetInstructionPointer(
+      &streamed_ip));
+  ASSERT_TRUE(mapped_exception->GetContext()->GetInstructionPointer(
+      &mapped_ip));
+  ASSERT_EQ(streamed_ip, mapped_ip);
+}
+
 TEST(Dump, ReadBackEmpty) {
   Dump dump(0);
   dump.Finish();
@@ -218,6 +268,82 @@ TEST(Dump, OneMemory) {
   ASSERT_TRUE(memcmp("memory contents", region1_bytes, 15) == 0);
 }
 
+// Memory regions are only indexed by address on the first lookup, so
+// overlapping regions do not keep the list from being read.
+TEST(Dump, OverlappingMemory) {
+  Dump dump(0, kLittleEndian);
+  Memory memory1(dump, 0x1000);
+  memory1.Append("first region");
+  dump.Add(&memory1);
+  Memory memory2(dump, 0x1004);
+  memory2.Append("second region");
+  dump.Add(&memory2);
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  istringstream minidump_stream(contents);
+  Minidump minidump(minidump_stream);
+  ASSERT_TRUE(minidump.Read());
+
+  MinidumpMemoryList *memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(memory_list != NULL);
+  ASSERT_EQ(2U, memory_list->region_count());
+
+  MinidumpMemoryRegion *region2 = memory_list->GetMemoryRegionAtIndex(1);
+  ASSERT_TRUE(region2 != NULL);
+  EXPECT_EQ(0x1004U, region2->GetBase());
+  EXPECT_TRUE(memcmp("second region", region2->GetMemory(), 13) == 0);
+
+  EXPECT_TRUE(memory_list->GetMemoryRegionForAddress(0x1000) == NULL);
+}
+
+// The memory list's range map is built by whichever thread looks a region
+// up first; the others must wait for it rather than see it half built.
+TEST(Dump, ConcurrentMemoryLookups) {
+  Dump dump(0, kLittleEndian);
+  const int kRegionCount = 64;
+  std::vector<Memory*> memories;
+  for (int i = 0; i < kRegionCount; ++i) {
+    Memory* memory = new Memory(dump, 0x10000 + i * 0x100);
+    memory->Append(16, i);
+    dump.Add(memory);
+    memories.push_back(memory);
+  }
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  istringstream minidump_stream(contents);
+  Minidump minidump(minidump_stream);
+  ASSERT_TRUE(minidump.Read());
+  MinidumpMemoryList *memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(memory_list != NULL);
+  ASSERT_EQ(static_cast<unsigned int>(kRegionCount),
+            memory_list->region_count());
+
+  const int kThreadCount = 8;
+  std::atomic<int> failed_lookups(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadCount; ++i) {
+    threads.push_back(std::thread([&, i]() {
+      for (int j = 0; j < kRegionCount; ++j) {
+        int region = (i + j) % kRegionCount;
+        MinidumpMemoryRegion *found = memory_list->GetMemoryRegionForAddress(
+            0x10000 + region * 0x100 + 8);
+        if (!found || found->GetBase() != 0x10000U + region * 0x100)
+          ++failed_lookups;
+      }
+    }));
+  }
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+  EXPECT_EQ(0, failed_lookups);
+
+  for (size_t i = 0; i < memories.size(); ++i)
+    delete memories[i];
+}
+
 // One thread --- and its requisite entourage.
 TEST(Dump, OneThread) {
   Dump dump(0, kLittleEndian);
@@ -532,6 +658,45 @@ TEST(Dump, OneModule) {
                      sizeof(fixed_file_info)) == 0);
 }
 
+// Modules are only indexed by address on the first lookup.  If they
+// overlap too much to be indexed, lookups scan the list instead of
+// finding nothing.
+TEST(Dump, OverlappingModules) {
+  Dump dump(0, kLittleEndian);
+  String module1_name(dump, "module one");
+  Module module1(dump, 0x2000, 0x1000, module1_name);
+  dump.Add(&module1_name);
+  dump.Add(&module1);
+  String module2_name(dump, "module two");
+  Module module2(dump, 0x1000, 0x2000, module2_name);
+  dump.Add(&module2_name);
+  dump.Add(&module2);
+  dump.Finish();
+
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+  istringstream minidump_stream(contents);
+  Minidump minidump(minidump_stream);
+  ASSERT_TRUE(minidump.Read());
+
+  MinidumpModuleList *md_module_list = minidump.GetModuleList();
+  ASSERT_TRUE(md_module_list != NULL);
+  ASSERT_EQ(2U, md_module_list->module_count());
+
+  const MinidumpModule *md_module =
+      md_module_list->GetModuleForAddress(0x2800);
+  ASSERT_TRUE(md_module != NULL);
+  EXPECT_EQ("module one", md_module->code_file());
+  md_module = md_module_list->GetModuleForAddress(0x1800);
+  ASSERT_TRUE(md_module != NULL);
+  EXPECT_EQ("module two", md_module->code_file());
+  EXPECT_TRUE(md_module_list->GetModuleForAddress(0x3000) == NULL);
+
+  md_module = md_module_list->GetModuleAtSequence(1);
+  ASSERT_TRUE(md_module != NULL);
+  EXPECT_EQ("module two", md_module->code_file());
+}
+
 // Test that a module with a MDCVInfoELF CV record is handled properly.
 TEST(Dump, OneModuleCVELF) {
   Dump dump(0, kLittleEndian);
@@ -34,6 +34,8 @@
 
 #include "processor/module_comparer.h"
 
+#include <string.h>
+
 #include <map>
 #include <string>
 
@@ -96,8 +98,7 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
     while (iter1 != basic_module->files_.end()
         && iter2 != fast_module->files_.end()) {
       ASSERT_TRUE(iter1->first == iter2.GetKey());
-      string tmp(iter2.GetValuePtr());
-      ASSERT_TRUE(iter1->second == tmp);
+      ASSERT_TRUE(strcmp(iter1->second, iter2.GetValuePtr()) == 0);
       ++iter1;
       ++iter2;
     }
@@ -107,26 +108,26 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
 
   // Compare functions_:
   {
-    RangeMap<MemAddr, linked_ptr<BasicFunc> >::MapConstIterator iter1;
+    RangeMap<MemAddr, BasicFunc*>::ConstIterator iter1 =
+        basic_module->functions_.begin();
     StaticRangeMap<MemAddr, FastFunc>::MapConstIterator iter2;
-    iter1 = basic_module->functions_.map_.begin();
     iter2 = fast_module->functions_.map_.begin();
-    while (iter1 != basic_module->functions_.map_.end()
+    while (iter1 != basic_module->functions_.end()
         && iter2 != fast_module->functions_.map_.end()) {
       ASSERT_TRUE(iter1->first == iter2.GetKey());
       ASSERT_TRUE(iter1->second.base() == iter2.GetValuePtr()->base());
       ASSERT_TRUE(CompareFunction(
-          iter1->second.entry().get(), iter2.GetValuePtr()->entryptr()));
+          iter1->second.entry(), iter2.GetValuePtr()->entryptr()));
       ++iter1;
       ++iter2;
     }
-    ASSERT_TRUE(iter1 == basic_module->functions_.map_.end());
+    ASSERT_TRUE(iter1 == basic_module->functions_.end());
     ASSERT_TRUE(iter2 == fast_module->functions_.map_.end());
   }
 
   // Compare public_symbols_:
   {
-    AddressMap<MemAddr, linked_ptr<BasicPubSymbol> >::MapConstIterator iter1;
+    AddressMap<MemAddr, BasicPubSymbol*>::MapConstIterator iter1;
     StaticAddressMap<MemAddr, FastPubSymbol>::MapConstIterator iter2;
     iter1 = basic_module->public_symbols_.map_.begin();
     iter2 = fast_module->public_symbols_.map_.begin();
@@ -134,7 +135,7 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
           && iter2 != fast_module->public_symbols_.map_.end()) {
       ASSERT_TRUE(iter1->first == iter2.GetKey());
       ASSERT_TRUE(ComparePubSymbol(
-          iter1->second.get(), iter2.GetValuePtr()));
+          iter1->second, iter2.GetValuePtr()));
       ++iter1;
       ++iter2;
     }
@@ -150,26 +151,26 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
 
   // Compare cfi_initial_rules_:
   {
-    RangeMap<MemAddr, string>::MapConstIterator iter1;
+    RangeMap<MemAddr, const char*>::ConstIterator iter1 =
+        basic_module->cfi_initial_rules_.begin();
     StaticRangeMap<MemAddr, char>::MapConstIterator iter2;
-    iter1 = basic_module->cfi_initial_rules_.map_.begin();
     iter2 = fast_module->cfi_initial_rules_.map_.begin();
-    while (iter1 != basic_module->cfi_initial_rules_.map_.end()
+    while (iter1 != basic_module->cfi_initial_rules_.end()
         && iter2 != fast_module->cfi_initial_rules_.map_.end()) {
       ASSERT_TRUE(iter1->first == iter2.GetKey());
       ASSERT_TRUE(iter1->second.base() == iter2.GetValuePtr()->base());
-      string tmp(iter2.GetValuePtr()->entryptr());
-      ASSERT_TRUE(iter1->second.entry() == tmp);
+      ASSERT_TRUE(strcmp(iter1->second.entry(),
+                         iter2.GetValuePtr()->entryptr()) == 0);
       ++iter1;
       ++iter2;
     }
-    ASSERT_TRUE(iter1 == basic_module->cfi_initial_rules_.map_.end());
+    ASSERT_TRUE(iter1 == basic_module->cfi_initial_rules_.end());
     ASSERT_TRUE(iter2 == fast_module->cfi_initial_rules_.map_.end());
   }
 
   // Compare cfi_delta_rules_:
   {
-    map<MemAddr, string>::const_iterator iter1;
+    map<MemAddr, const char*>::const_iterator iter1;
     StaticMap<MemAddr, char>::iterator iter2;
     iter1 = basic_module->cfi_delta_rules_.begin();
     iter2 = fast_module->cfi_delta_rules_.begin();
@@ -192,25 +193,25 @@ bool ModuleComparer::CompareFunction(const BasicFunc *basic_func,
                                     const FastFunc *fast_func_raw) const {
   FastFunc* fast_func = new FastFunc();
   fast_func->CopyFrom(fast_func_raw);
-  ASSERT_TRUE(basic_func->name == fast_func->name);
+  ASSERT_TRUE(strcmp(basic_func->name, fast_func->name) == 0);
   ASSERT_TRUE(basic_func->address == fast_func->address);
   ASSERT_TRUE(basic_func->size == fast_func->size);
 
   // compare range map of lines:
-  RangeMap<MemAddr, linked_ptr<BasicLine> >::MapConstIterator iter1;
+  RangeMap<MemAddr, BasicLine*>::ConstIterator iter1 =
+      basic_func->lines.begin();
   StaticRangeMap<MemAddr, FastLine>::MapConstIterator iter2;
-  iter1 = basic_func->lines.map_.begin();
   iter2 = fast_func->lines.map_.begin();
-  while (iter1 != basic_func->lines.map_.end()
+  while (iter1 != basic_func->lines.end()
       && iter2 != fast_func->lines.map_.end()) {
     ASSERT_TRUE(iter1->first == iter2.GetKey());
     ASSERT_TRUE(iter1->second.base() == iter2.GetValuePtr()->base());
-    ASSERT_TRUE(CompareLine(iter1->second.entry().get(),
+    ASSERT_TRUE(CompareLine(iter1->second.entry(),
                             iter2.GetValuePtr()->entryptr()));
     ++iter1;
     ++iter2;
   }
-  ASSERT_TRUE(iter1 == basic_func->lines.map_.end());
+  ASSERT_TRUE(iter1 == basic_func->lines.end());
   ASSERT_TRUE(iter2 == fast_func->lines.map_.end());
 
   delete fast_func;
@@ -235,7 +236,7 @@ bool ModuleComparer::ComparePubSymbol(const BasicPubSymbol* basic_ps,
                                      const FastPubSymbol* fastps_raw) const {
   FastPubSymbol *fast_ps = new FastPubSymbol;
   fast_ps->CopyFrom(fastps_raw);
-  ASSERT_TRUE(basic_ps->name == fast_ps->name);
+  ASSERT_TRUE(strcmp(basic_ps->name, fast_ps->name) == 0);
   ASSERT_TRUE(basic_ps->address == fast_ps->address);
   ASSERT_TRUE(basic_ps->parameter_size == fast_ps->parameter_size);
   delete fast_ps;
@@ -259,17 +260,17 @@ bool ModuleComparer::CompareWFI(const WindowsFrameInfo& wfi1,
 
 // Compare ContainedRangeMap
 bool ModuleComparer::CompareCRM(
-    const ContainedRangeMap<MemAddr, linked_ptr<WFI> >* basic_crm,
+    const ContainedRangeMap<MemAddr, WFI*>* basic_crm,
     const StaticContainedRangeMap<MemAddr, char>* fast_crm) const {
   ASSERT_TRUE(basic_crm->base_ == fast_crm->base_);
 
-  if (!basic_crm->entry_.get() || !fast_crm->entry_ptr_) {
+  if (!basic_crm->entry_ || !fast_crm->entry_ptr_) {
     // empty entry:
-    ASSERT_TRUE(!basic_crm->entry_.get() && !fast_crm->entry_ptr_);
+    ASSERT_TRUE(!basic_crm->entry_ && !fast_crm->entry_ptr_);
   } else {
     WFI newwfi;
     newwfi.CopyFrom(fast_resolver_->CopyWFI(fast_crm->entry_ptr_));
-    ASSERT_TRUE(CompareWFI(*(basic_crm->entry_.get()), newwfi));
+    ASSERT_TRUE(CompareWFI(*(basic_crm->entry_), newwfi));
   }
 
   if ((!basic_crm->map_ || basic_crm->map_->empty())
@@ -277,7 +278,7 @@ bool ModuleComparer::CompareCRM(
     ASSERT_TRUE((!basic_crm->map_ || basic_crm->map_->empty())
                && fast_crm->map_.empty());
   } else {
-    ContainedRangeMap<MemAddr, linked_ptr<WFI> >::MapConstIterator iter1;
+    ContainedRangeMap<MemAddr, WFI*>::MapConstIterator iter1;
     StaticContainedRangeMap<MemAddr, char>::MapConstIterator iter2;
     iter1 = basic_crm->map_->begin();
     iter2 = fast_crm->map_.begin();
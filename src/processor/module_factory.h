@@ -51,11 +51,17 @@ class ModuleFactory {
 
 class BasicModuleFactory : public ModuleFactory {
  public:
+  // Modules are loaded on as many threads as |resolver| is set to use.
+  explicit BasicModuleFactory(const BasicSourceLineResolver *resolver)
+      : resolver_(resolver) { }
   virtual ~BasicModuleFactory() { }
   virtual BasicSourceLineResolver::Module* CreateModule(
       const string &name) const {
-    return new BasicSourceLineResolver::Module(name);
+    return new BasicSourceLineResolver::Module(name, resolver_->load_threads_);
   }
+
+ private:
+  const BasicSourceLineResolver *resolver_;
 };
 
 class FastModuleFactory : public ModuleFactory {
@@ -35,18 +35,74 @@
 
 #include "processor/module_serializer.h"
 
+#include <string.h>
+
 #include <map>
 #include <string>
 
 #include "processor/basic_code_module.h"
+#include "processor/binary_symbol_file.h"
 #include "processor/logging.h"
 
 namespace google_breakpad {
 
+namespace {
+
+// Reads the module's identity from the MODULE and INFO records at the
+// start of the |size| bytes of text symbol file at |symbol_data|.
+void ReadModuleInfo(const char *symbol_data, size_t size,
+                    BinarySymbolFileModuleInfo *info) {
+  const char *end = symbol_data + size;
+  for (const char *cursor = symbol_data; cursor < end;) {
+    const char *line_end =
+        static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+    if (!line_end)
+      line_end = end;
+    string line(cursor, line_end - cursor);
+    cursor = line_end + 1;
+    size_t line_length = line.find_last_not_of(string(" \t\r\0", 4));
+    line.erase(line_length == string::npos ? 0 : line_length + 1);
+
+    if (line.compare(0, 7, "MODULE ") == 0) {
+      // MODULE <os> <arch> <debug id> <name>, where the name may hold spaces.
+      string *fields[] = { &info->os, &info->arch, &info->debug_id };
+      size_t start = 7;
+      for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+        size_t space = line.find(' ', start);
+        fields[i]->assign(line, start, space - start);
+        start = space == string::npos ? line.size() : space + 1;
+      }
+      info->name.assign(line, start, string::npos);
+    } else if (line.compare(0, 13, "INFO CODE_ID ") == 0) {
+      // INFO CODE_ID <code id> [<code file>]
+      info->code_id.assign(line, 13, line.find(' ', 13) - 13);
+    } else if (line.compare(0, 5, "INFO ") != 0) {
+      break;
+    }
+  }
+}
+
+// Returns |info| as it follows a BinarySymbolFileHeader.
+string EncodeModuleInfo(const BinarySymbolFileModuleInfo &info) {
+  string encoded;
+  const string *fields[] = {
+    &info.os, &info.arch, &info.debug_id, &info.name, &info.code_id
+  };
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+    encoded += *fields[i];
+    encoded += '\0';
+  }
+  encoded.resize((encoded.size() + 7) & ~static_cast<size_t>(7), '\0');
+  return encoded;
+}
+
+}  // namespace
+
 // Definition of static member variable in SimplerSerializer<Funcion>, which
 // is declared in file "simple_serializer-inl.h"
-RangeMapSerializer< MemAddr, linked_ptr<BasicSourceLineResolver::Line> >
-SimpleSerializer<BasicSourceLineResolver::Function>::range_map_serializer_;
+RangeMapSerializer<MemAddr, BasicSourceLineResolver::Line*>
+SimpleSerializer<BasicSourceLineResolver::Function>::range_map_serializer_(
+    true);
 
 size_t ModuleSerializer::SizeOf(const BasicSourceLineResolver::Module &module) {
   size_t total_size_alloc_ = 0;
@@ -190,8 +246,8 @@ bool ModuleSerializer::ConvertOneModule(
   return SerializeModuleAndLoadIntoFastResolver(iter, fast_resolver);
 }
 
-char* ModuleSerializer::SerializeSymbolFileData(
-    const string &symbol_data, unsigned int *size) {
+BasicSourceLineResolver::Module* ModuleSerializer::LoadSymbolFileData(
+    const string &symbol_data) {
   scoped_ptr<BasicSourceLineResolver::Module> module(
       new BasicSourceLineResolver::Module("no name"));
   scoped_array<char> buffer(new char[symbol_data.size() + 1]);
@@ -200,8 +256,82 @@ char* ModuleSerializer::SerializeSymbolFileData(
   if (!module->LoadMapFromMemory(buffer.get(), symbol_data.size() + 1)) {
     return NULL;
   }
-  buffer.reset(NULL);
+  return module.release();
+}
+
+char* ModuleSerializer::SerializeSymbolFileData(
+    const string &symbol_data, unsigned int *size) {
+  scoped_ptr<BasicSourceLineResolver::Module> module(
+      LoadSymbolFileData(symbol_data));
+  if (!module.get())
+    return NULL;
   return Serialize(*(module.get()), size);
 }
 
+char* ModuleSerializer::SerializeBinarySymbolFile(
+    const string &symbol_data, size_t *size) {
+  scoped_array<char> buffer(new char[symbol_data.size() + 1]);
+  memcpy(buffer.get(), symbol_data.c_str(), symbol_data.size());
+  buffer.get()[symbol_data.size()] = '\0';
+  return SerializeBinarySymbolFile(buffer.get(), symbol_data.size() + 1, 1,
+                                   size);
+}
+
+char* ModuleSerializer::SerializeBinarySymbolFile(
+    char *symbol_data, size_t symbol_data_size, unsigned int load_threads,
+    size_t *size) {
+  if (size)
+    *size = 0;
+
+  // Loading the module modifies the text, so read its identity first.
+  BinarySymbolFileModuleInfo info;
+  ReadModuleInfo(symbol_data, symbol_data_size, &info);
+  string encoded_info = EncodeModuleInfo(info);
+
+  scoped_ptr<BasicSourceLineResolver::Module> module(
+      new BasicSourceLineResolver::Module("no name", load_threads));
+  if (!module->LoadMapFromMemory(symbol_data, symbol_data_size))
+    return NULL;
+  if (HasInlineRecords(*module)) {
+    BPLOG(ERROR) << "Symbols for " << info.name << " have INLINE records, "
+                    "which binary symbol files can't hold";
+    return NULL;
+  }
+
+  BinarySymbolFileHeader header;
+  memcpy(header.magic, kBinarySymbolFileMagic, sizeof(header.magic));
+  header.version = kBinarySymbolFileVersion;
+  header.info_size = encoded_info.size();
+  header.module_size = SizeOf(*(module.get()));
+
+  size_t file_size = sizeof(header) + header.info_size + header.module_size;
+  char *file_data = new char[file_size];
+  memcpy(file_data, &header, sizeof(header));
+  memcpy(file_data + sizeof(header), encoded_info.data(), header.info_size);
+  char *end_address = Write(*(module.get()),
+                            file_data + sizeof(header) + header.info_size);
+  size_t size_written = end_address - file_data;
+  if (file_size != size_written) {
+    BPLOG(ERROR) << "file_size differs from size_written: "
+                 << file_size << " vs " << size_written;
+  }
+
+  if (size)
+    *size = file_size;
+  return file_data;
+}
+
+bool ModuleSerializer::HasInlineRecords(
+    const BasicSourceLineResolver::Module &module) {
+  if (!module.inline_origins_.empty())
+    return true;
+  BasicSourceLineResolver::Function *func;
+  for (int i = 0; i < module.functions_.GetCount(); ++i) {
+    if (module.functions_.RetrieveRangeAtIndex(i, &func, NULL, NULL, NULL) &&
+        !func->inlines.empty())
+      return true;
+  }
+  return false;
+}
+
 }  // namespace google_breakpad
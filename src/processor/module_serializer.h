@@ -44,7 +44,6 @@
 #include "google_breakpad/processor/fast_source_line_resolver.h"
 #include "processor/basic_source_line_resolver_types.h"
 #include "processor/fast_source_line_resolver_types.h"
-#include "processor/linked_ptr.h"
 #include "processor/map_serializers-inl.h"
 #include "processor/simple_serializer-inl.h"
 #include "processor/windows_frame_info.h"
@@ -59,6 +58,15 @@ namespace google_breakpad {
 // FastSourceLineResolver::Module.
 class ModuleSerializer {
  public:
+  // Maps are written with search indexes (see static_map_search_index.h),
+  // except for the Windows stack frame info.
+  ModuleSerializer()
+      : files_serializer_(true),
+        functions_serializer_(true),
+        pubsym_serializer_(true),
+        cfi_init_rules_serializer_(true),
+        cfi_delta_rules_serializer_(true) { }
+
   // Compute the size of memory required to serialize a module.  Return the
   // total size needed for serialization.
   size_t SizeOf(const BasicSourceLineResolver::Module &module);
@@ -81,6 +89,25 @@ class ModuleSerializer {
   char* SerializeSymbolFileData(const string &symbol_data,
                                 unsigned int *size = NULL);
 
+  // Given the string format symbol_data, produces a binary symbol file: the
+  // serialized data, preceded by a BinarySymbolFileHeader and the module
+  // identity from the MODULE and INFO CODE_ID records (see
+  // binary_symbol_file.h).  Returns NULL if the data has INLINE or
+  // INLINE_ORIGIN records, which binary symbol files can't hold.  If
+  // size != NULL, *size is set to the size of the file.  Caller takes
+  // ownership of the file data (on heap), and owner should call delete [] to
+  // free the memory after use.
+  char* SerializeBinarySymbolFile(const string &symbol_data,
+                                  size_t *size = NULL);
+
+  // As above, but loads the |symbol_data_size| bytes at |symbol_data| in
+  // place rather than copying them first, on up to |load_threads| threads
+  // (see BasicSourceLineResolver::set_load_threads).  The data must end
+  // with a '\0', and is modified.
+  char* SerializeBinarySymbolFile(char *symbol_data, size_t symbol_data_size,
+                                  unsigned int load_threads,
+                                  size_t *size = NULL);
+
   // Serializes one loaded module with given moduleid in the basic source line
   // resolver, and loads the serialized data into the fast source line resolver.
   // Return false if the basic source line doesn't have a module with the given
@@ -100,6 +127,14 @@ class ModuleSerializer {
   typedef BasicSourceLineResolver::Function Function;
   typedef BasicSourceLineResolver::PublicSymbol PublicSymbol;
 
+  // Returns true if |module| has INLINE or INLINE_ORIGIN records.
+  static bool HasInlineRecords(const BasicSourceLineResolver::Module &module);
+
+  // Loads the string format symbol_data into a new Module, which the caller
+  // owns.  Returns NULL if the data is corrupt.
+  static BasicSourceLineResolver::Module* LoadSymbolFileData(
+      const string &symbol_data);
+
   // Internal implementation for ConvertOneModule and ConvertAllModules methods.
   bool SerializeModuleAndLoadIntoFastResolver(
       const BasicSourceLineResolver::ModuleMap::const_iterator &iter,
@@ -113,13 +148,12 @@ class ModuleSerializer {
   uint32_t map_sizes_[kNumberMaps_];
 
   // Serializers for each individual map component in Module class.
-  StdMapSerializer<int, string> files_serializer_;
-  RangeMapSerializer<MemAddr, linked_ptr<Function> > functions_serializer_;
-  AddressMapSerializer<MemAddr, linked_ptr<PublicSymbol> > pubsym_serializer_;
-  ContainedRangeMapSerializer<MemAddr,
-                              linked_ptr<WindowsFrameInfo> > wfi_serializer_;
-  RangeMapSerializer<MemAddr, string> cfi_init_rules_serializer_;
-  StdMapSerializer<MemAddr, string> cfi_delta_rules_serializer_;
+  StdMapSerializer<int, const char*> files_serializer_;
+  RangeMapSerializer<MemAddr, Function*> functions_serializer_;
+  AddressMapSerializer<MemAddr, PublicSymbol*> pubsym_serializer_;
+  ContainedRangeMapSerializer<MemAddr, WindowsFrameInfo*> wfi_serializer_;
+  RangeMapSerializer<MemAddr, const char*> cfi_init_rules_serializer_;
+  StdMapSerializer<MemAddr, const char*> cfi_delta_rules_serializer_;
 };
 
 }  // namespace google_breakpad
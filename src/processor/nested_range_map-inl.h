@@ -0,0 +1,162 @@
+// Copyright 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// nested_range_map-inl.h: Nested range map implementation.
+//
+// See nested_range_map.h for documentation.
+
+#ifndef PROCESSOR_NESTED_RANGE_MAP_INL_H__
+#define PROCESSOR_NESTED_RANGE_MAP_INL_H__
+
+#include <assert.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "processor/nested_range_map.h"
+#include "processor/logging.h"
+
+namespace google_breakpad {
+
+template<typename AddressType, typename EntryType>
+bool NestedRangeMap<AddressType, EntryType>::StoreRange(
+    const AddressType &base, const AddressType &size, const EntryType &entry) {
+  AddressType high = base + size - 1;
+
+  // Check for undersize or overflow.
+  if (size <= 0 || high < base) {
+    return false;
+  }
+
+  Range range;
+  range.base = base;
+  range.size = size;
+  range.entry = entry;
+  range.parent = kNoParent;
+  ranges_.push_back(range);
+  frozen_ = false;
+  return true;
+}
+
+template<typename AddressType, typename EntryType>
+void NestedRangeMap<AddressType, EntryType>::Freeze() {
+  if (frozen_)
+    return;
+
+  // A stable sort keeps equal ranges in the order they were stored.
+  std::stable_sort(ranges_.begin(), ranges_.end(), RangeLess);
+
+  // Sweep the ranges in order, keeping a stack of those that enclose the
+  // current one.  Ranges are compacted in place as bad ones are dropped.
+  std::vector<int> enclosing;
+  size_t kept = 0;
+  for (size_t i = 0; i < ranges_.size(); ++i) {
+    Range range = ranges_[i];
+    while (!enclosing.empty() &&
+           range.base - ranges_[enclosing.back()].base >=
+               ranges_[enclosing.back()].size) {
+      enclosing.pop_back();
+    }
+    range.parent = kNoParent;
+    if (!enclosing.empty()) {
+      const Range &outer = ranges_[enclosing.back()];
+      if (range.size > outer.size - (range.base - outer.base)) {
+        // The range starts within |outer| but ends beyond it.
+        continue;
+      }
+      range.parent = enclosing.back();
+    }
+    enclosing.push_back(static_cast<int>(kept));
+    ranges_[kept++] = range;
+  }
+  ranges_.resize(kept);
+  frozen_ = true;
+}
+
+template<typename AddressType, typename EntryType>
+bool NestedRangeMap<AddressType, EntryType>::RetrieveRanges(
+    const AddressType &address,
+    std::vector<const EntryType*> *entries,
+    std::vector<AddressType> *entry_bases) const {
+  BPLOG_IF(ERROR, !entries) << "NestedRangeMap::RetrieveRanges requires "
+                               "|entries|";
+  assert(entries);
+
+  if (!frozen_) {
+    BPLOG(ERROR) << "NestedRangeMap::RetrieveRanges called before Freeze";
+    return false;
+  }
+
+  // Find the last range to start at or before |address|.  If it doesn't
+  // contain the address, the innermost range that does encloses it.
+  typename std::vector<Range>::const_iterator iterator =
+      std::upper_bound(ranges_.begin(), ranges_.end(), address, AddressLess);
+  if (iterator == ranges_.begin())
+    return false;
+  int index = static_cast<int>(iterator - ranges_.begin()) - 1;
+  while (index != kNoParent &&
+         address - ranges_[index].base >= ranges_[index].size) {
+    index = ranges_[index].parent;
+  }
+  if (index == kNoParent)
+    return false;
+
+  for (; index != kNoParent; index = ranges_[index].parent) {
+    entries->push_back(&ranges_[index].entry);
+    if (entry_bases)
+      entry_bases->push_back(ranges_[index].base);
+  }
+  return true;
+}
+
+template<typename AddressType, typename EntryType>
+void NestedRangeMap<AddressType, EntryType>::Clear() {
+  ranges_.clear();
+  frozen_ = true;
+}
+
+// static
+template<typename AddressType, typename EntryType>
+bool NestedRangeMap<AddressType, EntryType>::RangeLess(const Range &x,
+                                                       const Range &y) {
+  if (x.base != y.base)
+    return x.base < y.base;
+  return x.size > y.size;
+}
+
+// static
+template<typename AddressType, typename EntryType>
+bool NestedRangeMap<AddressType, EntryType>::AddressLess(
+    const AddressType &address, const Range &range) {
+  return address < range.base;
+}
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_NESTED_RANGE_MAP_INL_H__
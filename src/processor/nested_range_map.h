@@ -0,0 +1,118 @@
+// Copyright 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// nested_range_map.h: A map of ranges that nest within one another.
+//
+// A nested range map holds ranges that may contain one another, like the
+// code of functions inlined into functions that are themselves inlined,
+// and finds every range that contains an address, innermost first.  Two
+// ranges must not partially overlap, but they may be equal.
+//
+// Unlike ContainedRangeMap, which keeps a tree of maps, a nested range
+// map keeps its ranges in one array sorted by base address, each with
+// the index of its innermost enclosing range.  The innermost range that
+// contains an address encloses the last range to start at or before it,
+// or is that range, so a lookup is one binary search followed by a walk
+// out through the enclosing ranges.
+//
+// Ranges may be stored in any order, but the map must be frozen before
+// it is searched, and thawed again by storing more ranges.
+
+#ifndef PROCESSOR_NESTED_RANGE_MAP_H__
+#define PROCESSOR_NESTED_RANGE_MAP_H__
+
+#include <vector>
+
+namespace google_breakpad {
+
+template<typename AddressType, typename EntryType>
+class NestedRangeMap {
+ public:
+  NestedRangeMap() : ranges_(), frozen_(true) { }
+
+  // Stores |entry| for the |size| bytes starting at |base|.  Returns
+  // false if the range is empty or wraps around the address space.
+  // Ranges stored at the same base with the same size enclose one
+  // another in the order they are stored.
+  bool StoreRange(const AddressType &base,
+                  const AddressType &size,
+                  const EntryType &entry);
+
+  // Sorts the ranges and links each to the range enclosing it, making the
+  // map ready to search.  A range that starts within another but ends
+  // beyond it is dropped.
+  void Freeze();
+
+  // Appends pointers to the entries of all the ranges containing
+  // |address| to |entries|, innermost first, and, if |entry_bases| is not
+  // NULL, their base addresses to |entry_bases|.  Returns false if no
+  // range contains the address, or the map isn't frozen.
+  bool RetrieveRanges(const AddressType &address,
+                      std::vector<const EntryType*> *entries,
+                      std::vector<AddressType> *entry_bases) const;
+
+  // Returns true if the map holds no ranges.
+  bool empty() const { return ranges_.empty(); }
+
+  // Returns the bytes of heap the ranges take, not counting the map
+  // itself or anything its entries point to.
+  size_t MemoryUsage() const { return ranges_.capacity() * sizeof(Range); }
+
+  // Removes all ranges.
+  void Clear();
+
+ private:
+  struct Range {
+    AddressType base;
+    AddressType size;
+    EntryType entry;
+
+    // The index in ranges_ of the innermost range enclosing this one, or
+    // kNoParent.
+    int parent;
+  };
+
+  static const int kNoParent = -1;
+
+  // Orders ranges by base address, with enclosing ranges first.
+  static bool RangeLess(const Range &x, const Range &y);
+
+  // Returns true if |address| is below the base of |range|.
+  static bool AddressLess(const AddressType &address, const Range &range);
+
+  // The ranges, sorted by RangeLess once the map is frozen.
+  std::vector<Range> ranges_;
+
+  // True if ranges_ is sorted and linked to the enclosing ranges.
+  bool frozen_;
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_NESTED_RANGE_MAP_H__
@@ -0,0 +1,181 @@
+// Copyright 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// nested_range_map_unittest.cc: Unit tests for NestedRangeMap.
+
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "processor/nested_range_map-inl.h"
+
+namespace {
+
+using google_breakpad::NestedRangeMap;
+using std::vector;
+
+typedef NestedRangeMap<unsigned int, int> TestMap;
+
+// Returns the entries of the ranges of |map| containing |address|,
+// innermost first, checking that their bases come back with them.
+vector<int> Retrieve(const TestMap &map, unsigned int address) {
+  vector<const int*> entries;
+  vector<unsigned int> bases;
+  vector<int> result;
+  if (!map.RetrieveRanges(address, &entries, &bases)) {
+    EXPECT_TRUE(entries.empty());
+    return result;
+  }
+  EXPECT_EQ(entries.size(), bases.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EXPECT_LE(bases[i], address);
+    result.push_back(*entries[i]);
+  }
+  return result;
+}
+
+vector<int> Entries(int a = -1, int b = -1, int c = -1) {
+  vector<int> result;
+  int entries[] = { a, b, c };
+  for (int i = 0; i < 3 && entries[i] >= 0; ++i)
+    result.push_back(entries[i]);
+  return result;
+}
+
+TEST(NestedRangeMapTest, Empty) {
+  TestMap map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(Entries(), Retrieve(map, 0));
+  EXPECT_EQ(Entries(), Retrieve(map, 100));
+}
+
+TEST(NestedRangeMapTest, BadRanges) {
+  TestMap map;
+  EXPECT_FALSE(map.StoreRange(10, 0, 1));
+  EXPECT_FALSE(map.StoreRange(0xfffffff0, 0x20, 2));
+  EXPECT_TRUE(map.empty());
+}
+
+TEST(NestedRangeMapTest, Nesting) {
+  TestMap map;
+  // Stored inner ranges first, and out of address order.
+  ASSERT_TRUE(map.StoreRange(40, 5, 3));     // [40, 45) in 2
+  ASSERT_TRUE(map.StoreRange(30, 20, 2));    // [30, 50) in 1
+  ASSERT_TRUE(map.StoreRange(60, 10, 4));    // [60, 70) in 1
+  ASSERT_TRUE(map.StoreRange(20, 60, 1));    // [20, 80)
+  ASSERT_TRUE(map.StoreRange(100, 10, 5));   // [100, 110)
+  map.Freeze();
+
+  EXPECT_EQ(Entries(), Retrieve(map, 19));
+  EXPECT_EQ(Entries(1), Retrieve(map, 20));
+  EXPECT_EQ(Entries(2, 1), Retrieve(map, 30));
+  EXPECT_EQ(Entries(3, 2, 1), Retrieve(map, 40));
+  EXPECT_EQ(Entries(3, 2, 1), Retrieve(map, 44));
+  EXPECT_EQ(Entries(2, 1), Retrieve(map, 45));
+  EXPECT_EQ(Entries(1), Retrieve(map, 50));
+  EXPECT_EQ(Entries(4, 1), Retrieve(map, 69));
+  EXPECT_EQ(Entries(1), Retrieve(map, 70));
+  EXPECT_EQ(Entries(1), Retrieve(map, 79));
+  EXPECT_EQ(Entries(), Retrieve(map, 80));
+  EXPECT_EQ(Entries(), Retrieve(map, 99));
+  EXPECT_EQ(Entries(5), Retrieve(map, 105));
+  EXPECT_EQ(Entries(), Retrieve(map, 110));
+
+  vector<const int*> entries;
+  vector<unsigned int> bases;
+  ASSERT_TRUE(map.RetrieveRanges(41, &entries, &bases));
+  ASSERT_EQ(3U, bases.size());
+  EXPECT_EQ(40U, bases[0]);
+  EXPECT_EQ(30U, bases[1]);
+  EXPECT_EQ(20U, bases[2]);
+
+  // Bases are optional, and results are appended.
+  ASSERT_TRUE(map.RetrieveRanges(105, &entries, NULL));
+  ASSERT_EQ(4U, entries.size());
+  EXPECT_EQ(5, *entries[3]);
+}
+
+TEST(NestedRangeMapTest, EqualRanges) {
+  TestMap map;
+  // Equal ranges enclose one another in the order they are stored.
+  ASSERT_TRUE(map.StoreRange(10, 10, 1));
+  ASSERT_TRUE(map.StoreRange(10, 10, 2));
+  ASSERT_TRUE(map.StoreRange(10, 5, 3));
+  ASSERT_TRUE(map.StoreRange(10, 10, 4));
+  map.Freeze();
+  vector<const int*> entries;
+  ASSERT_TRUE(map.RetrieveRanges(12, &entries, NULL));
+  ASSERT_EQ(4U, entries.size());
+  EXPECT_EQ(3, *entries[0]);
+  EXPECT_EQ(4, *entries[1]);
+  EXPECT_EQ(2, *entries[2]);
+  EXPECT_EQ(1, *entries[3]);
+  EXPECT_EQ(Entries(4, 2, 1), Retrieve(map, 15));
+}
+
+TEST(NestedRangeMapTest, PartialOverlap) {
+  TestMap map;
+  ASSERT_TRUE(map.StoreRange(10, 10, 1));   // [10, 20)
+  ASSERT_TRUE(map.StoreRange(15, 10, 2));   // [15, 25): dropped
+  ASSERT_TRUE(map.StoreRange(12, 3, 3));    // [12, 15) in 1
+  ASSERT_TRUE(map.StoreRange(20, 10, 4));   // [20, 30)
+  map.Freeze();
+  EXPECT_EQ(Entries(3, 1), Retrieve(map, 12));
+  EXPECT_EQ(Entries(1), Retrieve(map, 17));
+  EXPECT_EQ(Entries(4), Retrieve(map, 22));
+}
+
+TEST(NestedRangeMapTest, Freeze) {
+  TestMap map;
+  ASSERT_TRUE(map.StoreRange(10, 10, 1));
+  // An unfrozen map can't be searched.
+  EXPECT_EQ(Entries(), Retrieve(map, 12));
+  map.Freeze();
+  EXPECT_EQ(Entries(1), Retrieve(map, 12));
+
+  // Storing another range thaws the map.
+  ASSERT_TRUE(map.StoreRange(11, 2, 2));
+  EXPECT_EQ(Entries(), Retrieve(map, 12));
+  map.Freeze();
+  EXPECT_EQ(Entries(2, 1), Retrieve(map, 12));
+
+  map.Clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(Entries(), Retrieve(map, 12));
+}
+
+TEST(NestedRangeMapTest, TopOfAddressSpace) {
+  TestMap map;
+  ASSERT_TRUE(map.StoreRange(0xffffff00, 0x100, 1));
+  ASSERT_TRUE(map.StoreRange(0xfffffff0, 0x10, 2));
+  map.Freeze();
+  EXPECT_EQ(Entries(2, 1), Retrieve(map, 0xffffffff));
+  EXPECT_EQ(Entries(1), Retrieve(map, 0xffffff00));
+}
+
+}  // namespace
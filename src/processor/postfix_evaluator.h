@@ -60,6 +60,16 @@
 // values remaining on the stack are treated as evidence of incomplete
 // execution and cause the evaluator to indicate failure.
 //
+// Expressions are evaluated by compiling them into a PostfixProgram.  Each
+// identifier an expression names is looked up in the dictionary once, and
+// the variables it assigns are stored back into the dictionary when
+// evaluation ends.  An evaluator keeps the program it compiled last, and
+// compiles an expression passed as a string only if it differs from the
+// previous one.  Callers that alternate between expressions should compile
+// each once and pass the PostfixProgram to Evaluate instead.  Expressions
+// that stack up more than PostfixProgram::kMaxStackDepth values, or name more
+// than PostfixProgram::kMaxIdentifiers identifiers, fail.
+//
 // PostfixEvaluator is intended to support evaluation of "program strings"
 // obtained from MSVC frame data debugging information in pdb files as
 // returned by the DIA APIs.
@@ -72,14 +82,13 @@
 
 #include <map>
 #include <string>
-#include <vector>
 
 #include "common/using_std_string.h"
+#include "processor/postfix_program.h"
 
 namespace google_breakpad {
 
 using std::map;
-using std::vector;
 
 class MemoryRegion;
 
@@ -96,22 +105,29 @@ class PostfixEvaluator {
   // will fail in that case unless set_dictionary is used before calling
   // Evaluate.
   PostfixEvaluator(DictionaryType *dictionary, const MemoryRegion *memory)
-      : dictionary_(dictionary), memory_(memory), stack_() {}
+      : dictionary_(dictionary), memory_(memory), program_() {
+    program_.Compile(string());
+  }
 
   // Evaluate the expression, starting with an empty stack. The results of
   // execution will be stored in one (or more) variables in the dictionary.
+  // An expression given as a string is compiled unless it is the same as
+  // the last one given as a string.
   // Returns false if any failures occur during execution, leaving
   // variables in the dictionary in an indeterminate state. If assigned is
   // non-NULL, any keys set in the dictionary as a result of evaluation
   // will also be set to true in assigned, providing a way to determine if
   // an expression modifies any of its input variables.
   bool Evaluate(const string &expression, DictionaryValidityType *assigned);
+  bool Evaluate(const PostfixProgram &program,
+                DictionaryValidityType *assigned);
 
   // Like Evaluate, but provides the value left on the stack to the
   // caller. If evaluation succeeds and leaves exactly one value on
   // the stack, pop that value, store it in *result, and return true.
   // Otherwise, return false.
   bool EvaluateForValue(const string &expression, ValueType *result);
+  bool EvaluateForValue(const PostfixProgram &program, ValueType *result);
 
   DictionaryType* dictionary() const { return dictionary_; }
 
@@ -119,44 +135,18 @@ class PostfixEvaluator {
   void set_dictionary(DictionaryType *dictionary) {dictionary_ = dictionary; }
 
  private:
-  // Return values for PopValueOrIdentifier
-  enum PopResult {
-    POP_RESULT_FAIL = 0,
-    POP_RESULT_VALUE,
-    POP_RESULT_IDENTIFIER
-  };
-
-  // Retrieves the topmost literal value, constant, or variable from the
-  // stack.  Returns POP_RESULT_VALUE if the topmost entry is a literal
-  // value, and sets |value| accordingly.  Returns POP_RESULT_IDENTIFIER
-  // if the topmost entry is a constant or variable identifier, and sets
-  // |identifier| accordingly.  Returns POP_RESULT_FAIL on failure, such
-  // as when the stack is empty.
-  PopResult PopValueOrIdentifier(ValueType *value, string *identifier);
-
-  // Retrieves the topmost value on the stack.  If the topmost entry is
-  // an identifier, the dictionary is queried for the identifier's value.
-  // Returns false on failure, such as when the stack is empty or when
-  // a nonexistent identifier is named.
-  bool PopValue(ValueType *value);
-
-  // Retrieves the top two values on the stack, in the style of PopValue.
-  // value2 is popped before value1, so that value1 corresponds to the
-  // entry that was pushed prior to value2.  Returns false on failure.
-  bool PopValues(ValueType *value1, ValueType *value2);
-
-  // Pushes a new value onto the stack.
-  void PushValue(const ValueType &value);
-
-  // Evaluate expression, updating *assigned if it is non-zero. Return
-  // true if evaluation completes successfully. Do not clear the stack
-  // upon successful evaluation.
-  bool EvaluateInternal(const string &expression,
-                        DictionaryValidityType *assigned);
-
-  bool EvaluateToken(const string &token,
-                     const string &expression,
-                     DictionaryValidityType *assigned);
+  // Evaluate program with the values of its identifiers from the
+  // dictionary, then store the variables it assigned in the dictionary,
+  // and in *assigned if it is non-NULL.  If result is NULL, the program
+  // must leave the stack empty, otherwise it must leave one value, which
+  // is stored in *result.  Return true if evaluation succeeds.
+  bool EvaluateInternal(const PostfixProgram &program,
+                        DictionaryValidityType *assigned,
+                        ValueType *result);
+
+  // Return the program compiled from expression, compiling it into
+  // program_ unless that already holds it.
+  const PostfixProgram &CompiledProgram(const string &expression);
 
   // The dictionary mapping constant and variable identifiers (strings) to
   // values.  Keys beginning with '$' are treated as variable names, and
@@ -167,10 +157,8 @@ class PostfixEvaluator {
   // If NULL, dereferencing is unsupported and will fail.  Weak pointer.
   const MemoryRegion *memory_;
 
-  // The stack contains state information as execution progresses.  Values
-  // are pushed on to it as the expression string is read and as operations
-  // yield values; values are popped when used as operands to operators.
-  vector<string> stack_;
+  // The program compiled from the last expression given as a string.
+  PostfixProgram program_;
 };
 
 }  // namespace google_breakpad
@@ -0,0 +1,423 @@
+// Copyright 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// postfix_evaluator_benchmark.cc: Times the STACK WIN program strings and
+// STACK CFI rules of symbol files, evaluated as the stack walkers evaluate
+// them: once per frame, with fresh register values.  Each set is timed
+// through TokenizingEvaluator, a copy of the evaluator that re-tokenized
+// the expression and looked identifiers up by name on every evaluation,
+// and through PostfixProgram, compiled as WindowsFrameInfo and
+// CFIFrameInfo compile them.
+//
+// Usage: postfix_evaluator_benchmark [iterations [symbol-file...]]
+// Defaults to 20 iterations over the Windows and Linux symbol files in
+// $srcdir/src/processor/testdata.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
+#include "google_breakpad/processor/memory_region.h"
+#include "processor/cfi_frame_info.h"
+#include "processor/logging.h"
+#include "processor/postfix_program.h"
+#include "processor/windows_frame_info.h"
+
+namespace {
+
+using google_breakpad::CFIFrameInfo;
+using google_breakpad::CFIRuleParser;
+using google_breakpad::MemoryRegion;
+using google_breakpad::PostfixProgram;
+using google_breakpad::PostfixRegisterFile;
+using google_breakpad::WindowsFrameInfo;
+using std::istringstream;
+using std::map;
+using std::ostringstream;
+using std::vector;
+
+const char *kDefaultSymbolFiles[] = {
+  "kernel32.pdb/BCE8785C57B44245A669896B6A19B9542/kernel32.sym",
+  "test_app.pdb/5A9832E5287241C1838ED98914E9B7FF1/test_app.sym",
+  "libc-2.13.so/F4F8DFCD5A5FB5A7CE64717E9E6AE3890/libc-2.13.so.sym",
+  "ld-2.13.so/C32AD7E235EA6112E02A5B9D6219C4850/ld-2.13.so.sym"
+};
+
+// The evaluator PostfixEvaluator was before it compiled expressions into
+// PostfixPrograms, kept here as the baseline to compare against.  It
+// splits the expression into tokens with an istringstream, keeps its stack
+// as strings, and parses each operand and looks each identifier up in the
+// dictionary as it pops it.  Its logging is left out, as it is not what is
+// being timed.
+template<typename ValueType>
+class TokenizingEvaluator {
+ public:
+  typedef map<string, ValueType> DictionaryType;
+
+  TokenizingEvaluator(DictionaryType *dictionary, const MemoryRegion *memory)
+      : dictionary_(dictionary), memory_(memory) { }
+
+  // Evaluates |expression|, which must leave the stack empty.
+  bool Evaluate(const string &expression) {
+    stack_.clear();
+    return EvaluateInternal(expression) && stack_.empty();
+  }
+
+  // Evaluates |expression|, which must leave exactly one value.
+  bool EvaluateForValue(const string &expression, ValueType *result) {
+    stack_.clear();
+    return EvaluateInternal(expression) && stack_.size() == 1 &&
+           PopValue(result);
+  }
+
+ private:
+  bool EvaluateInternal(const string &expression) {
+    istringstream stream(expression);
+    string token;
+    while (stream >> token) {
+      if (token.size() > 1 && token[0] == '=') {
+        if (!EvaluateToken("=") || !EvaluateToken(token.substr(1)))
+          return false;
+      } else if (!EvaluateToken(token)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool EvaluateToken(const string &token) {
+    if (token == "+" || token == "-" || token == "*" || token == "/" ||
+        token == "%" || token == "@") {
+      ValueType operand1, operand2;
+      if (!PopValue(&operand2) || !PopValue(&operand1))
+        return false;
+      ValueType result;
+      switch (token[0]) {
+        case '+': result = operand1 + operand2; break;
+        case '-': result = operand1 - operand2; break;
+        case '*': result = operand1 * operand2; break;
+        case '/': result = operand1 / operand2; break;
+        case '%': result = operand1 % operand2; break;
+        default:
+          result = operand1 & (static_cast<ValueType>(-1) ^ (operand2 - 1));
+          break;
+      }
+      PushValue(result);
+    } else if (token == "^") {
+      ValueType address, value;
+      if (!memory_ || !PopValue(&address) ||
+          !memory_->GetMemoryAtAddress(address, &value))
+        return false;
+      PushValue(value);
+    } else if (token == "=") {
+      ValueType value;
+      string identifier;
+      if (!PopValue(&value) || PopValueOrIdentifier(NULL, &identifier) ||
+          identifier.empty() || identifier[0] != '$')
+        return false;
+      (*dictionary_)[identifier] = value;
+    } else {
+      stack_.push_back(token);
+    }
+    return true;
+  }
+
+  // Pops the top of the stack.  Returns true and sets *value if it is a
+  // literal; otherwise returns false and sets *identifier.  Sets neither
+  // and returns false if the stack is empty.
+  bool PopValueOrIdentifier(ValueType *value, string *identifier) {
+    if (stack_.empty())
+      return false;
+    string token = stack_.back();
+    stack_.pop_back();
+    istringstream token_stream(token);
+    ValueType literal = ValueType();
+    bool negative = token_stream.peek() == '-';
+    if (negative)
+      token_stream.get();
+    if (token_stream >> literal && token_stream.peek() == EOF) {
+      if (value)
+        *value = negative ? -literal : literal;
+      return true;
+    }
+    if (identifier)
+      *identifier = token;
+    return false;
+  }
+
+  bool PopValue(ValueType *value) {
+    string identifier;
+    if (PopValueOrIdentifier(value, &identifier))
+      return true;
+    if (identifier.empty())
+      return false;
+    typename DictionaryType::const_iterator it = dictionary_->find(identifier);
+    if (it == dictionary_->end())
+      return false;
+    *value = it->second;
+    return true;
+  }
+
+  void PushValue(const ValueType &value) {
+    ostringstream token_stream;
+    token_stream << value;
+    stack_.push_back(token_stream.str());
+  }
+
+  DictionaryType *dictionary_;
+  const MemoryRegion *memory_;
+  vector<string> stack_;
+};
+
+// Every address is readable, and holds a value derived from it.
+class FakeMemoryRegion : public MemoryRegion {
+ public:
+  virtual uint64_t GetBase() const { return 0; }
+  virtual uint32_t GetSize() const { return 0; }
+  virtual bool GetMemoryAtAddress(uint64_t address, uint8_t *value) const {
+    *value = address ^ 0x5a;
+    return true;
+  }
+  virtual bool GetMemoryAtAddress(uint64_t address, uint16_t *value) const {
+    *value = address ^ 0x5a5a;
+    return true;
+  }
+  virtual bool GetMemoryAtAddress(uint64_t address, uint32_t *value) const {
+    *value = address ^ 0x5a5a5a5a;
+    return true;
+  }
+  virtual bool GetMemoryAtAddress(uint64_t address, uint64_t *value) const {
+    *value = address ^ 0x5a5a5a5a5a5a5a5aULL;
+    return true;
+  }
+  virtual void Print() const { }
+};
+
+// Collects the expressions of the STACK CFI rule sets it is given.
+class ExpressionCollector : public CFIRuleParser::Handler {
+ public:
+  explicit ExpressionCollector(vector<string> *expressions)
+      : expressions_(expressions) { }
+  void CFARule(const string &expression) { Add(expression); }
+  void RARule(const string &expression) { Add(expression); }
+  void RegisterRule(const string &name, const string &expression) {
+    Add(expression);
+  }
+
+ private:
+  void Add(const string &expression) { expressions_->push_back(expression); }
+  vector<string> *expressions_;
+};
+
+// Appends the STACK WIN program strings of the symbol file at PATH to
+// *PROGRAMS, and the expressions of its STACK CFI rules to *RULES.
+bool ReadSymbolFile(const string &path, vector<string> *programs,
+                    vector<string> *rules) {
+  std::ifstream file(path.c_str());
+  if (!file) {
+    fprintf(stderr, "Couldn't open %s\n", path.c_str());
+    return false;
+  }
+  ExpressionCollector collector(rules);
+  CFIRuleParser parser(&collector);
+  string line;
+  while (std::getline(file, line)) {
+    if (line.compare(0, 12, "STACK WIN 4 ") == 0) {
+      // STACK WIN 4 rva size prolog epilog params saved locals max_stack
+      // has_program_string program_string_or_allocates_base_pointer
+      size_t field = 0, position = 0;
+      while (field < 11 && position != string::npos) {
+        position = line.find(' ', position + 1);
+        ++field;
+      }
+      if (position != string::npos && line.compare(position + 1, 2, "1 ") == 0)
+        programs->push_back(line.substr(position + 3));
+    } else if (line.compare(0, 15, "STACK CFI INIT ") == 0) {
+      // STACK CFI INIT address size rules
+      size_t position = line.find(' ', 15);
+      if (position != string::npos)
+        position = line.find(' ', position + 1);
+      if (position != string::npos)
+        parser.Parse(line.substr(position + 1));
+    } else if (line.compare(0, 10, "STACK CFI ") == 0) {
+      // STACK CFI address rules
+      size_t position = line.find(' ', 10);
+      if (position != string::npos)
+        parser.Parse(line.substr(position + 1));
+    }
+  }
+  return true;
+}
+
+double NowNs() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+void Report(const char *what, size_t evaluations, size_t successes,
+            double elapsed_ns) {
+  printf("%-28s %9zu evaluations, %9zu succeeded, %8.1f ns each\n",
+         what, evaluations, successes,
+         evaluations ? elapsed_ns / evaluations : 0.0);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  BPLOG_INIT(&argc, &argv);
+  int iterations = argc > 1 ? atoi(argv[1]) : 20;
+  vector<string> paths;
+  for (int i = 2; i < argc; ++i)
+    paths.push_back(argv[i]);
+  if (paths.empty()) {
+    const char *srcdir = getenv("srcdir");
+    string symbols = string(srcdir ? srcdir : ".") +
+                     "/src/processor/testdata/symbols/";
+    for (size_t i = 0;
+         i < sizeof(kDefaultSymbolFiles) / sizeof(*kDefaultSymbolFiles); ++i)
+      paths.push_back(symbols + kDefaultSymbolFiles[i]);
+  }
+
+  vector<string> programs, rules;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    if (!ReadSymbolFile(paths[i], &programs, &rules))
+      return 1;
+  }
+
+  FakeMemoryRegion memory;
+
+  // STACK WIN program strings, with the values StackwalkerX86 sets up.
+  size_t successes = 0;
+  double start = NowNs();
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    for (size_t i = 0; i < programs.size(); ++i) {
+      TokenizingEvaluator<uint32_t>::DictionaryType dictionary;
+      dictionary["$ebp"] = 0xbfff0010;
+      dictionary["$esp"] = 0xbfff0000;
+      dictionary["$ebx"] = 0x10203040;
+      dictionary[".cbCalleeParams"] = 8;
+      dictionary[".cbSavedRegs"] = 4;
+      dictionary[".cbLocals"] = 16;
+      dictionary[".cbParams"] = 8;
+      dictionary[".raSearchStart"] = 0xbfff0020;
+      dictionary[".raSearch"] = 0xbfff0020;
+      TokenizingEvaluator<uint32_t> evaluator(&dictionary, &memory);
+      if (evaluator.Evaluate(programs[i]))
+        ++successes;
+    }
+  }
+  Report("STACK WIN, tokenized", iterations * programs.size(), successes,
+         NowNs() - start);
+
+  // WindowsFrameInfo compiles its program once, when it is loaded.
+  vector<PostfixProgram> compiled_programs(programs.size());
+  for (size_t i = 0; i < programs.size(); ++i)
+    WindowsFrameInfo::CompileProgram(programs[i], &compiled_programs[i]);
+  successes = 0;
+  start = NowNs();
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    for (size_t i = 0; i < compiled_programs.size(); ++i) {
+      PostfixRegisterFile<uint32_t> registers;
+      registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_EBP, 0xbfff0010);
+      registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_ESP, 0xbfff0000);
+      registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_EBX, 0x10203040);
+      registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_CB_CALLEE_PARAMS, 8);
+      registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_CB_SAVED_REGS, 4);
+      registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_CB_LOCALS, 16);
+      registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_CB_PARAMS, 8);
+      registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_RA_SEARCH_START,
+                    0xbfff0020);
+      registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_RA_SEARCH, 0xbfff0020);
+      if (compiled_programs[i].Evaluate(&registers, &memory,
+                                        static_cast<uint32_t *>(NULL)))
+        ++successes;
+    }
+  }
+  Report("STACK WIN, compiled", iterations * programs.size(), successes,
+         NowNs() - start);
+
+  // STACK CFI rules, with the registers CFI rules for x86-64 name.
+  CFIFrameInfo::RegisterValueMap<uint64_t> registers;
+  const char *kRegisters[] = {
+    "$rax", "$rdx", "$rcx", "$rbx", "$rsi", "$rdi", "$rbp", "$rsp",
+    "$r8", "$r9", "$r10", "$r11", "$r12", "$r13", "$r14", "$r15", "$rip",
+    ".cfa"
+  };
+  for (size_t i = 0; i < sizeof(kRegisters) / sizeof(*kRegisters); ++i)
+    registers[kRegisters[i]] = 0x7fff0000 + i * 8;
+
+  successes = 0;
+  start = NowNs();
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    for (size_t i = 0; i < rules.size(); ++i) {
+      TokenizingEvaluator<uint64_t>::DictionaryType dictionary = registers;
+      TokenizingEvaluator<uint64_t> evaluator(&dictionary, &memory);
+      uint64_t value;
+      if (evaluator.EvaluateForValue(rules[i], &value))
+        ++successes;
+    }
+  }
+  Report("STACK CFI, tokenized", iterations * rules.size(), successes,
+         NowNs() - start);
+
+  // CFIFrameInfo compiles the rules in effect at an address when they are
+  // looked up, and binds each rule's identifiers to the caller's registers
+  // by name before evaluating it.
+  successes = 0;
+  start = NowNs();
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    for (size_t i = 0; i < rules.size(); ++i) {
+      PostfixProgram rule;
+      rule.Compile(rules[i]);
+      PostfixRegisterFile<uint64_t> working;
+      for (int j = 0; j < rule.identifier_count(); ++j) {
+        CFIFrameInfo::RegisterValueMap<uint64_t>::const_iterator it =
+            registers.find(rule.identifier_name(j));
+        if (it != registers.end())
+          working.Set(rule.identifier_number(j), it->second);
+      }
+      uint64_t value;
+      if (rule.Evaluate(&working, &memory, &value))
+        ++successes;
+    }
+  }
+  Report("STACK CFI, compiled", iterations * rules.size(), successes,
+         NowNs() - start);
+
+  return 0;
+}
@@ -51,6 +51,7 @@ namespace {
 using std::map;
 using google_breakpad::MemoryRegion;
 using google_breakpad::PostfixEvaluator;
+using google_breakpad::PostfixProgram;
 
 
 // FakeMemoryRegion is used to test PostfixEvaluator's dereference (^)
@@ -323,12 +324,17 @@ static bool RunTests() {
     { "28907223",               true,  28907223 },      // simple constant
     { "89854293 40010015 +",    true,  89854293 + 40010015 }, // arithmetic
     { "-870245 8769343 +",      true,  7899098 },       // negative constants
+    { "+5 -+3 +",               true,  2 },             // explicit signs
     { "$ebp $esp - $eip +",     true,  0x10000010 },    // variable references
     { "18929794 34015074",      false, 0 },             // too many values
     { "$ebp $ebp 4 - =",        false, 0 },             // too few values
     { "$new $eip = $new",       true,  0x10000000 },    // make new variable
     { "$new 4 +",               true,  0x10000004 },    // see prior assignments
-    { ".cfa 42 = 10",           false, 0 }              // can't set constants
+    { "$new $new + $new -",     true,  0x10000000 },    // reuse identifiers
+    { ".cfa 42 = 10",           false, 0 },             // can't set constants
+    { "4 0 /",                  false, 0 },             // division by zero
+    { "4 0 %",                  false, 0 },             // modulus by zero
+    { "4294967296",             false, 0 }              // too large, unknown
   };
   const int evaluate_for_value_tests_2_size
       = (sizeof (evaluate_for_value_tests_2)
@@ -362,6 +368,66 @@ static bool RunTests() {
     }
   }
 
+  // Expressions deeper than the evaluator's stack fail, rather than
+  // overflow it.
+  string deep_expression;
+  for (int i = 0; i < 1000; i++)
+    deep_expression += "1 ";
+  for (int i = 1; i < 1000; i++)
+    deep_expression += "+ ";
+  unsigned int deep_result;
+  if (postfix_evaluator.EvaluateForValue(deep_expression, &deep_result)) {
+    fprintf(stderr, "FAIL: evaluate for value of a deep expression, "
+            "expected evaluation to fail, but it succeeded\n");
+    return false;
+  }
+
+  // A compiled program may be evaluated with several dictionaries.
+  PostfixProgram program;
+  program.Compile("$ebp $ebp .cbSavedRegs + =");
+  for (unsigned int saved_regs = 4; saved_regs <= 8; saved_regs += 4) {
+    PostfixEvaluator<unsigned int>::DictionaryType dictionary_3;
+    dictionary_3["$ebp"] = 0xbfff0010;
+    dictionary_3[".cbSavedRegs"] = saved_regs;
+    PostfixEvaluator<unsigned int> program_evaluator(&dictionary_3,
+                                                     &fake_memory);
+    PostfixEvaluator<unsigned int>::DictionaryValidityType assigned;
+    if (!program_evaluator.Evaluate(program, &assigned) ||
+        dictionary_3["$ebp"] != 0xbfff0010 + saved_regs ||
+        !assigned["$ebp"]) {
+      fprintf(stderr, "FAIL: compiled program with .cbSavedRegs %u, "
+              "expected $ebp to be assigned 0x%x, but it was 0x%x\n",
+              saved_regs, 0xbfff0010 + saved_regs, dictionary_3["$ebp"]);
+      return false;
+    }
+  }
+
+  // An expression evaluated again as a string sees the dictionary's
+  // current values, though it is not compiled again.
+  PostfixEvaluator<unsigned int>::DictionaryType dictionary_4;
+  PostfixEvaluator<unsigned int> string_evaluator(&dictionary_4, &fake_memory);
+  unsigned int string_result;
+  if (string_evaluator.EvaluateForValue("", &string_result)) {
+    fprintf(stderr, "FAIL: evaluate for value of an empty expression, "
+            "expected evaluation to fail, but it succeeded\n");
+    return false;
+  }
+  for (unsigned int ebp = 0x10; ebp <= 0x20; ebp += 0x10) {
+    dictionary_4["$ebp"] = ebp;
+    if (!string_evaluator.EvaluateForValue("$ebp 4 +", &string_result) ||
+        string_result != ebp + 4) {
+      fprintf(stderr, "FAIL: repeated evaluation with $ebp 0x%x, "
+              "expected 0x%x, but it was 0x%x\n", ebp, ebp + 4,
+              string_result);
+      return false;
+    }
+  }
+  if (!string_evaluator.Evaluate("", NULL)) {
+    fprintf(stderr, "FAIL: evaluate an empty expression, "
+            "expected evaluation to succeed, but it failed\n");
+    return false;
+  }
+
   for (map<string, unsigned int>::iterator v = validate_data_2.begin();
        v != validate_data_2.end(); v++) {
     map<string, unsigned int>::iterator a = dictionary_2.find(v->first);
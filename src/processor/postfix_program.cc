@@ -0,0 +1,470 @@
+// Copyright 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// postfix_program.cc: A compiled postfix (reverse Polish) notation
+// expression.
+//
+// See postfix_program.h for documentation.
+
+#include "processor/postfix_program.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include "google_breakpad/processor/memory_region.h"
+#include "processor/logging.h"
+
+namespace google_breakpad {
+
+namespace {
+
+// The operations of a PostfixProgram.
+enum PostfixOperation {
+  // Push a literal; one byte of operand follows.
+  POSTFIX_OP_SMALL_LITERAL,
+  // Push a literal, or its negation; eight bytes of operand follow.
+  POSTFIX_OP_LITERAL,
+  POSTFIX_OP_NEGATED_LITERAL,
+  // Push an identifier; its one-byte number follows.  The identifier is
+  // only resolved when popped, so that it may be assigned to.
+  POSTFIX_OP_IDENTIFIER,
+  POSTFIX_OP_ADD,
+  POSTFIX_OP_SUBTRACT,
+  POSTFIX_OP_MULTIPLY,
+  POSTFIX_OP_DIVIDE_QUOTIENT,
+  POSTFIX_OP_DIVIDE_MODULUS,
+  POSTFIX_OP_ALIGN,
+  POSTFIX_OP_DEREFERENCE,
+  POSTFIX_OP_ASSIGN
+};
+
+// The size of an entry in the identifier table at the start of the code.
+const size_t kIdentifierEntrySize = 4;
+
+// Parses the literal |token|, which has |length| characters: a decimal
+// number, optionally preceded by '-' and then by '+'.  Returns false if
+// |token| is not a literal, or does not fit in 64 bits; it is then an
+// identifier.
+bool ParseLiteral(const char *token, size_t length,
+                  uint64_t *magnitude, bool *negative) {
+  size_t i = 0;
+  *negative = length > 0 && token[0] == '-';
+  if (*negative)
+    ++i;
+  if (i < length && token[i] == '+')
+    ++i;
+  if (i == length)
+    return false;
+
+  const uint64_t kMax = ~static_cast<uint64_t>(0);
+  uint64_t value = 0;
+  for (; i < length; ++i) {
+    if (token[i] < '0' || token[i] > '9')
+      return false;
+    uint64_t digit = token[i] - '0';
+    if (value > (kMax - digit) / 10)
+      return false;
+    value = value * 10 + digit;
+  }
+  *magnitude = value;
+  return true;
+}
+
+// Returns the number of the register in |register_names| called |name|,
+// which has |length| characters, or -1 if there is none.
+int FindRegister(const char *name, size_t length,
+                 const char *const *register_names, int register_count) {
+  for (int i = 0; i < register_count; ++i) {
+    if (strncmp(register_names[i], name, length) == 0 &&
+        register_names[i][length] == '\0')
+      return i;
+  }
+  return -1;
+}
+
+// The stack of one evaluation of a PostfixProgram.  Entries are values,
+// or identifiers that are resolved in |registers| when they are popped, so
+// that they may be assigned to.
+template<typename ValueType>
+class EvaluationStack {
+ public:
+  EvaluationStack(const PostfixProgram &program,
+                  const PostfixRegisterFile<ValueType> &registers)
+      : program_(program), registers_(registers), depth_(0) { }
+
+  int depth() const { return depth_; }
+
+  // The program's maximum depth was checked when it was compiled, so
+  // pushing can't overflow the stack.
+  void PushValue(ValueType value) {
+    stack_[depth_].value = value;
+    stack_[depth_++].identifier = -1;
+  }
+
+  void PushIdentifier(int number) {
+    stack_[depth_].value = ValueType();
+    stack_[depth_++].identifier = number;
+  }
+
+  // Pops the topmost entry into *value, resolving it if it is an
+  // identifier.  Returns false if the stack is empty or the identifier has
+  // no value.
+  bool PopValue(ValueType *value) {
+    if (depth_ == 0) {
+      BPLOG(ERROR) << "Too few operands: " << program_.expression();
+      return false;
+    }
+    const Entry &entry = stack_[--depth_];
+    if (entry.identifier < 0) {
+      *value = entry.value;
+      return true;
+    }
+    if (!registers_.Get(entry.identifier, value)) {
+      BPLOG(INFO) << "Identifier " << NameOf(entry.identifier) <<
+                     " not in dictionary";
+      return false;
+    }
+    return true;
+  }
+
+  // Pops the topmost entry, which must be an identifier, and stores its
+  // number in *number.
+  bool PopIdentifier(int *number) {
+    if (depth_ == 0 || stack_[depth_ - 1].identifier < 0)
+      return false;
+    *number = stack_[--depth_].identifier;
+    return true;
+  }
+
+ private:
+  struct Entry {
+    ValueType value;
+    int identifier;  // The identifier's number, or -1 for a value.
+  };
+
+  string NameOf(int number) const {
+    for (int index = 0; index < program_.identifier_count(); ++index) {
+      if (program_.identifier_number(index) == number)
+        return program_.identifier_name(index);
+    }
+    return string();
+  }
+
+  const PostfixProgram &program_;
+  const PostfixRegisterFile<ValueType> &registers_;
+  Entry stack_[PostfixProgram::kMaxStackDepth];
+  int depth_;
+};
+
+}  // namespace
+
+bool PostfixProgram::Compile(const string &expression,
+                             const char *const *register_names,
+                             int register_count) {
+  expression_ = expression;
+  code_.assign(1, '\0');
+  variables_ = 0;
+
+  int depth = 0, max_depth = 0;
+  size_t length = expression_.size();
+  size_t offset = 0;
+  for (;;) {
+    while (offset < length &&
+           isspace(static_cast<unsigned char>(expression_[offset])))
+      ++offset;
+    if (offset == length)
+      return true;
+    size_t token_length = 0;
+    while (offset + token_length < length &&
+           !isspace(static_cast<unsigned char>(
+               expression_[offset + token_length])))
+      ++token_length;
+
+    // Normally, tokens are whitespace-separated, but occasionally, the
+    // assignment operator is smashed up against the next token, i.e.
+    // $T0 $ebp 128 + =$eip $T0 4 + ^ =$ebp $T0 ^ =
+    // This has been observed in program strings produced by MSVS 2010 in LTO
+    // mode.
+    bool compiled;
+    if (token_length > 1 && expression_[offset] == '=') {
+      compiled = CompileToken(offset, 1, register_names, register_count,
+                              &depth, &max_depth) &&
+                 CompileToken(offset + 1, token_length - 1, register_names,
+                              register_count, &depth, &max_depth);
+    } else {
+      compiled = CompileToken(offset, token_length, register_names,
+                              register_count, &depth, &max_depth);
+    }
+    if (!compiled || max_depth > kMaxStackDepth) {
+      BPLOG(ERROR) << "Could not compile: " << expression_;
+      code_.clear();
+      variables_ = 0;
+      return false;
+    }
+    offset += token_length;
+  }
+}
+
+bool PostfixProgram::CompileToken(size_t offset, size_t length,
+                                  const char *const *register_names,
+                                  int register_count,
+                                  int *depth, int *max_depth) {
+  const char *token = expression_.data() + offset;
+
+  // All operators are a single character.
+  if (length == 1 && token[0] != '\0' && strchr("+-*/%@^=", token[0])) {
+    int pops = 1;
+    char operation = POSTFIX_OP_ASSIGN;
+    switch (token[0]) {
+      case '+': operation = POSTFIX_OP_ADD; break;
+      case '-': operation = POSTFIX_OP_SUBTRACT; break;
+      case '*': operation = POSTFIX_OP_MULTIPLY; break;
+      case '/': operation = POSTFIX_OP_DIVIDE_QUOTIENT; break;
+      case '%': operation = POSTFIX_OP_DIVIDE_MODULUS; break;
+      case '@': operation = POSTFIX_OP_ALIGN; break;
+      case '^': operation = POSTFIX_OP_DEREFERENCE; pops = 0; break;
+      case '=': pops = 2; break;
+    }
+    code_ += operation;
+    // Too few operands is an evaluation error.
+    *depth = *depth > pops ? *depth - pops : 0;
+    return true;
+  }
+
+  uint64_t magnitude;
+  bool negative;
+  if (ParseLiteral(token, length, &magnitude, &negative)) {
+    if (!negative && magnitude <= 0xff) {
+      code_ += static_cast<char>(POSTFIX_OP_SMALL_LITERAL);
+      code_ += static_cast<char>(magnitude);
+    } else {
+      code_ += static_cast<char>(negative ? POSTFIX_OP_NEGATED_LITERAL :
+                                            POSTFIX_OP_LITERAL);
+      for (int i = 0; i < 8; ++i)
+        code_ += static_cast<char>(magnitude >> (i * 8));
+    }
+  } else {
+    // Find the identifier in the table at the start of code_, or add it.
+    int count = identifier_count();
+    int index;
+    for (index = 0; index < count; ++index) {
+      const char *entry = code_.data() + 1 + index * kIdentifierEntrySize;
+      size_t entry_offset = static_cast<uint8_t>(entry[1]) |
+                            static_cast<uint8_t>(entry[2]) << 8;
+      if (static_cast<uint8_t>(entry[3]) == length &&
+          expression_.compare(entry_offset, length, token, length) == 0)
+        break;
+    }
+    int number;
+    if (index < count) {
+      number = identifier_number(index);
+    } else {
+      number = FindRegister(token, length, register_names, register_count);
+      if (number < 0) {
+        // Number it after the registers and the other identifiers not
+        // among them.
+        number = register_count;
+        for (int i = 0; i < count; ++i) {
+          if (identifier_number(i) >= number)
+            number = identifier_number(i) + 1;
+        }
+      }
+      if (number >= kMaxIdentifiers || offset > 0xffff || length > 0xff)
+        return false;
+      char entry[kIdentifierEntrySize] = {
+        static_cast<char>(number),
+        static_cast<char>(offset),
+        static_cast<char>(offset >> 8),
+        static_cast<char>(length)
+      };
+      code_.insert(1 + count * kIdentifierEntrySize, entry,
+                   kIdentifierEntrySize);
+      code_[0] = static_cast<char>(count + 1);
+      if (token[0] == '$')
+        variables_ |= static_cast<uint64_t>(1) << number;
+    }
+    code_ += static_cast<char>(POSTFIX_OP_IDENTIFIER);
+    code_ += static_cast<char>(number);
+  }
+
+  if (++*depth > *max_depth)
+    *max_depth = *depth;
+  return true;
+}
+
+int PostfixProgram::identifier_count() const {
+  return code_.empty() ? 0 : static_cast<uint8_t>(code_[0]);
+}
+
+int PostfixProgram::identifier_number(int index) const {
+  return static_cast<uint8_t>(code_[1 + index * kIdentifierEntrySize]);
+}
+
+string PostfixProgram::identifier_name(int index) const {
+  const char *entry = code_.data() + 1 + index * kIdentifierEntrySize;
+  size_t offset = static_cast<uint8_t>(entry[1]) |
+                  static_cast<uint8_t>(entry[2]) << 8;
+  return string(expression_, offset, static_cast<uint8_t>(entry[3]));
+}
+
+template<typename ValueType>
+bool PostfixProgram::Evaluate(PostfixRegisterFile<ValueType> *registers,
+                              const MemoryRegion *memory,
+                              ValueType *result) const {
+  if (code_.empty()) {
+    BPLOG(ERROR) << "Could not compile: " << expression_;
+    return false;
+  }
+
+  EvaluationStack<ValueType> stack(*this, *registers);
+  const uint8_t *code = reinterpret_cast<const uint8_t *>(code_.data());
+  const uint8_t *end = code + code_.size();
+  code += 1 + *code * kIdentifierEntrySize;
+
+  while (code < end) {
+    uint8_t operation = *code++;
+    switch (operation) {
+      case POSTFIX_OP_SMALL_LITERAL:
+        stack.PushValue(*code++);
+        break;
+
+      case POSTFIX_OP_LITERAL:
+      case POSTFIX_OP_NEGATED_LITERAL: {
+        uint64_t magnitude = 0;
+        for (int i = 0; i < 8; ++i)
+          magnitude |= static_cast<uint64_t>(code[i]) << (i * 8);
+        code += 8;
+        // A literal too large for ValueType is taken to be an identifier,
+        // which nothing can define.
+        if (magnitude > static_cast<ValueType>(-1)) {
+          BPLOG(INFO) << "Identifier " << magnitude << " not in dictionary";
+          return false;
+        }
+        ValueType value = static_cast<ValueType>(magnitude);
+        stack.PushValue(operation == POSTFIX_OP_NEGATED_LITERAL ?
+                        -value : value);
+        break;
+      }
+
+      case POSTFIX_OP_IDENTIFIER:
+        stack.PushIdentifier(*code++);
+        break;
+
+      case POSTFIX_OP_DEREFERENCE: {
+        // Can't dereference without memory.
+        if (!memory) {
+          BPLOG(ERROR) << "Attempt to dereference without memory: " <<
+                          expression_;
+          return false;
+        }
+        ValueType address, value;
+        if (!stack.PopValue(&address))
+          return false;
+        if (!memory->GetMemoryAtAddress(address, &value)) {
+          BPLOG(ERROR) << "Could not dereference memory at address " <<
+                          HexString(address) << ": " << expression_;
+          return false;
+        }
+        stack.PushValue(value);
+        break;
+      }
+
+      case POSTFIX_OP_ASSIGN: {
+        // Assignment is only meaningful when assigning into an identifier.
+        // The identifier must name a variable, not a constant.  Variables
+        // begin with '$'.
+        ValueType value;
+        int number;
+        if (!stack.PopValue(&value))
+          return false;
+        if (!stack.PopIdentifier(&number) ||
+            !(variables_ & static_cast<uint64_t>(1) << number)) {
+          BPLOG(ERROR) << "Can't assign " << HexString(value) << ": " <<
+                          expression_;
+          return false;
+        }
+        registers->Assign(number, value);
+        break;
+      }
+
+      default: {
+        // A binary operation.
+        ValueType operand1, operand2;
+        if (!stack.PopValue(&operand2) || !stack.PopValue(&operand1))
+          return false;
+        ValueType value;
+        switch (operation) {
+          case POSTFIX_OP_ADD:
+            value = operand1 + operand2;
+            break;
+          case POSTFIX_OP_SUBTRACT:
+            value = operand1 - operand2;
+            break;
+          case POSTFIX_OP_MULTIPLY:
+            value = operand1 * operand2;
+            break;
+          case POSTFIX_OP_ALIGN:
+            value = operand1 & (static_cast<ValueType>(-1) ^ (operand2 - 1));
+            break;
+          default:
+            if (operand2 == 0) {
+              BPLOG(ERROR) << "Division by zero: " << expression_;
+              return false;
+            }
+            value = operation == POSTFIX_OP_DIVIDE_QUOTIENT ?
+                    operand1 / operand2 : operand1 % operand2;
+            break;
+        }
+        stack.PushValue(value);
+        break;
+      }
+    }
+  }
+
+  // Anything left on the stack but the result indicates incomplete
+  // execution.
+  if (stack.depth() != (result ? 1 : 0)) {
+    BPLOG(ERROR) << "Expression yielded bad number of results: '" <<
+                    expression_ << "'";
+    return false;
+  }
+  return !result || stack.PopValue(result);
+}
+
+// Explicit instantiations for 32-bit and 64-bit values.
+template bool PostfixProgram::Evaluate<uint32_t>(
+    PostfixRegisterFile<uint32_t> *registers,
+    const MemoryRegion *memory,
+    uint32_t *result) const;
+template bool PostfixProgram::Evaluate<uint64_t>(
+    PostfixRegisterFile<uint64_t> *registers,
+    const MemoryRegion *memory,
+    uint64_t *result) const;
+
+}  // namespace google_breakpad
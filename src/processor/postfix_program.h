@@ -0,0 +1,182 @@
+// Copyright 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// postfix_program.h: A postfix (reverse Polish) notation expression,
+// compiled so that it can be evaluated repeatedly.
+//
+// PostfixProgram compiles an expression in the language documented in
+// postfix_evaluator.h once, so that evaluating it does not tokenize it
+// again.  PostfixEvaluator evaluates STACK WIN program strings through it,
+// and CFIFrameInfo evaluates STACK CFI rules through it.
+//
+// The identifiers an expression names are numbered when it is compiled.
+// A caller that knows the identifiers it provides may pass their names to
+// Compile, and they are numbered by their position in that list; any other
+// identifiers, such as the temporaries $T0, $T1 and so on, are numbered
+// after them in order of first appearance.  A program is evaluated against
+// a PostfixRegisterFile, a flat array of values indexed by those numbers,
+// so that evaluation does not look anything up by name.
+
+#ifndef PROCESSOR_POSTFIX_PROGRAM_H__
+#define PROCESSOR_POSTFIX_PROGRAM_H__
+
+#include <string>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
+
+namespace google_breakpad {
+
+class MemoryRegion;
+
+template<typename ValueType> class PostfixRegisterFile;
+
+class PostfixProgram {
+ public:
+  // The largest number of values an expression may stack up, and one more
+  // than the largest number an identifier may have.  Expressions beyond
+  // these limits fail to compile.
+  static const int kMaxStackDepth = 128;
+  static const int kMaxIdentifiers = 64;
+
+  PostfixProgram() : expression_(), code_(), variables_(0) { }
+
+  // Compiles |expression|, replacing this program.  An identifier equal to
+  // register_names[i], for i less than |register_count|, is numbered i.
+  // Returns false if the expression has too many identifiers or is too
+  // deep to compile; evaluating it then fails.  Operator errors, such as
+  // too few operands, are only reported when the program is evaluated.
+  bool Compile(const string &expression,
+               const char *const *register_names,
+               int register_count);
+  bool Compile(const string &expression) {
+    return Compile(expression, NULL, 0);
+  }
+
+  // Returns the expression this program was compiled from.  A program that
+  // was never compiled has an empty expression.
+  const string &expression() const { return expression_; }
+  bool empty() const { return expression_.empty(); }
+
+  // Returns the bytes of heap the program takes, not counting the
+  // PostfixProgram itself.
+  size_t MemoryUsage() const {
+    return expression_.capacity() + code_.capacity();
+  }
+
+  // Returns the number of distinct identifiers the expression names, and
+  // the number and name of the |index|th of them.
+  int identifier_count() const;
+  int identifier_number(int index) const;
+  string identifier_name(int index) const;
+
+  // Evaluates the program, with the values of its identifiers in
+  // |registers|.  Assignments update |registers|, even if evaluation
+  // fails later.  |memory| may be NULL, in which case dereferencing (^)
+  // fails.  If |result| is NULL, the program must leave the stack empty;
+  // otherwise, it must leave exactly one value, which is stored in
+  // *result.  Returns false if any of this fails.  ValueType may be
+  // uint32_t or uint64_t.
+  template<typename ValueType>
+  bool Evaluate(PostfixRegisterFile<ValueType> *registers,
+                const MemoryRegion *memory,
+                ValueType *result) const;
+
+ private:
+  // Appends the operation for the |length| characters at |offset| in
+  // expression_ to code_, updating the stack depth *depth and the deepest
+  // it has been, *max_depth.  Returns false if the token names an
+  // identifier that can't be numbered.
+  bool CompileToken(size_t offset, size_t length,
+                    const char *const *register_names, int register_count,
+                    int *depth, int *max_depth);
+
+  string expression_;
+
+  // The number of identifiers, then for each its number, the offset of its
+  // first appearance in expression_ (two bytes, little-endian) and its
+  // length, then the operations and their operands.  Empty if the
+  // expression could not be compiled.
+  string code_;
+
+  // A bit for each identifier number whose name begins with '$', which may
+  // be assigned to.
+  uint64_t variables_;
+};
+
+// The values of the identifiers a PostfixProgram names, indexed by their
+// numbers.  An identifier has no value until one is set.
+template<typename ValueType>
+class PostfixRegisterFile {
+ public:
+  PostfixRegisterFile() : known_(0), assigned_(0) { }
+
+  // Gives the identifier numbered |number| the value |value|.
+  void Set(int number, ValueType value) {
+    values_[number] = value;
+    known_ |= Bit(number);
+  }
+
+  // Gives the identifier numbered |number| the value |value|, and records
+  // that the program assigned it.
+  void Assign(int number, ValueType value) {
+    Set(number, value);
+    assigned_ |= Bit(number);
+  }
+
+  // If the identifier numbered |number| has a value, stores it in *value
+  // and returns true.
+  bool Get(int number, ValueType *value) const {
+    if (!(known_ & Bit(number)))
+      return false;
+    *value = values_[number];
+    return true;
+  }
+
+  // Returns the value of the identifier numbered |number|, or 0 if it has
+  // none.
+  ValueType value(int number) const {
+    return (known_ & Bit(number)) ? values_[number] : 0;
+  }
+
+  // Returns true if a program assigned the identifier numbered |number|.
+  bool assigned(int number) const { return (assigned_ & Bit(number)) != 0; }
+
+ private:
+  static uint64_t Bit(int number) { return static_cast<uint64_t>(1) << number; }
+
+  ValueType values_[PostfixProgram::kMaxIdentifiers];
+  uint64_t known_;
+  uint64_t assigned_;
+};
+
+}  // namespace google_breakpad
+
+
+#endif  // PROCESSOR_POSTFIX_PROGRAM_H__
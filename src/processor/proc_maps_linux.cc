@@ -28,6 +28,11 @@ namespace google_breakpad {
 
 bool ParseProcMaps(const string& input,
                    std::vector<MappedMemoryRegion>* regions_out) {
+  return ParseProcMaps(input.data(), input.size(), regions_out);
+}
+
+bool ParseProcMaps(const char* input, size_t input_size,
+                   std::vector<MappedMemoryRegion>* regions_out) {
   std::vector<MappedMemoryRegion> regions;
 
   // This isn't async safe nor terribly efficient, but it doesn't need to be at
@@ -36,7 +41,7 @@ bool ParseProcMaps(const string& input,
   // Split the string by newlines.
   std::vector<string> lines;
   string l = "";
-  for (size_t i = 0; i < input.size(); i++) {
+  for (size_t i = 0; i < input_size; i++) {
     if (input[i] != '\n' && input[i] != '\r') {
       l.push_back(input[i]);
     } else if (l.size() > 0) {
@@ -38,6 +38,7 @@
       'sources': [
         'address_map-inl.h',
         'address_map.h',
+        'arena.h',
         'basic_code_module.h',
         'basic_code_modules.cc',
         'basic_code_modules.h',
@@ -73,6 +74,8 @@
         'module_factory.h',
         'module_serializer.cc',
         'module_serializer.h',
+        'nested_range_map-inl.h',
+        'nested_range_map.h',
         'pathname_stripper.cc',
         'pathname_stripper.h',
         'postfix_evaluator-inl.h',
@@ -119,6 +122,7 @@
         'static_map.h',
         'static_map_iterator-inl.h',
         'static_map_iterator.h',
+        'static_map_search_index.h',
         'static_range_map-inl.h',
         'static_range_map.h',
         'symbolic_constants_win.cc',
@@ -142,6 +146,7 @@
       'type': 'executable',
       'sources': [
         'address_map_unittest.cc',
+        'arena_unittest.cc',
         'basic_source_line_resolver_unittest.cc',
         'cfi_frame_info_unittest.cc',
         'contained_range_map_unittest.cc',
@@ -152,6 +157,7 @@
         'microdump_processor_unittest.cc',
         'minidump_processor_unittest.cc',
         'minidump_unittest.cc',
+        'nested_range_map_unittest.cc',
         'pathname_stripper_unittest.cc',
         'postfix_evaluator_unittest.cc',
         'range_map_shrink_down_unittest.cc',
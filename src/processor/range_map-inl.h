@@ -39,6 +39,11 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 #include "processor/range_map.h"
 #include "processor/linked_ptr.h"
 #include "processor/logging.h"
@@ -82,6 +87,21 @@ bool RangeMap<AddressType, EntryType>::StoreRangeInternal(
     return false;
   }
 
+  // Symbol files list most ranges in address order.  A range above every
+  // range in the map can't overlap any of them, so append it directly.
+  if (map_.empty() && (ranges_.empty() || base > ranges_.back().first)) {
+    search_tree_.clear();
+    ranges_.push_back(MapValue(high, Range(base, delta, entry)));
+    return true;
+  }
+  Thaw();
+  if (base > map_.rbegin()->first) {
+    map_.emplace_hint(map_.end(), std::piecewise_construct,
+                      std::forward_as_tuple(high),
+                      std::forward_as_tuple(base, delta, entry));
+    return true;
+  }
+
   // Ensure that this range does not overlap with another one already in the
   // map.
   MapConstIterator iterator_base = map_.lower_bound(base);
@@ -155,11 +175,67 @@ bool RangeMap<AddressType, EntryType>::StoreRangeInternal(
 
   // Store the range in the map by its high address, so that lower_bound can
   // be used to quickly locate a range by address.
-  map_.insert(MapValue(high, Range(base, delta, entry)));
+  map_.emplace_hint(iterator_high, std::piecewise_construct,
+                    std::forward_as_tuple(high),
+                    std::forward_as_tuple(base, delta, entry));
   return true;
 }
 
 
+template<typename AddressType, typename EntryType>
+void RangeMap<AddressType, EntryType>::Thaw() {
+  if (ranges_.empty())
+    return;
+
+  for (RangeVectorConstIterator range = ranges_.begin();
+       range != ranges_.end(); ++range) {
+    map_.insert(map_.end(), *range);
+  }
+  RangeVector().swap(ranges_);
+  search_tree_.clear();
+}
+
+
+template<typename AddressType, typename EntryType>
+const typename RangeMap<AddressType, EntryType>::MapValue *
+RangeMap<AddressType, EntryType>::LowerBound(
+    const AddressType &address, const MapValue **previous) const {
+  if (!map_.empty()) {
+    MapConstIterator iterator = map_.lower_bound(address);
+    if (previous) {
+      *previous = NULL;
+      if (iterator != map_.begin()) {
+        MapConstIterator previous_iterator = iterator;
+        --previous_iterator;
+        *previous = &*previous_iterator;
+      }
+    }
+    return iterator == map_.end() ? NULL : &*iterator;
+  }
+
+  size_t index;
+  if (!search_tree_.empty()) {
+    // The last node on the way down whose range ends at or above |address|
+    // is the lower bound.
+    index = ranges_.size();
+    size_t node = 0;
+    while (node < search_tree_.size()) {
+      bool at_or_above = search_tree_[node].high >= address;
+      if (at_or_above)
+        index = search_tree_[node].index;
+      node = 2 * node + (at_or_above ? 1 : 2);
+    }
+  } else {
+    index = std::lower_bound(ranges_.begin(), ranges_.end(), address,
+                             HighIsLess) - ranges_.begin();
+  }
+
+  if (previous)
+    *previous = index == 0 ? NULL : &ranges_[index - 1];
+  return index == ranges_.size() ? NULL : &ranges_[index];
+}
+
+
 template<typename AddressType, typename EntryType>
 bool RangeMap<AddressType, EntryType>::RetrieveRange(
     const AddressType &address, EntryType *entry, AddressType *entry_base,
@@ -167,8 +243,26 @@ bool RangeMap<AddressType, EntryType>::RetrieveRange(
   BPLOG_IF(ERROR, !entry) << "RangeMap::RetrieveRange requires |entry|";
   assert(entry);
 
-  MapConstIterator iterator = map_.lower_bound(address);
-  if (iterator == map_.end())
+  const EntryType *stored_entry;
+  if (!RetrieveRange(address, &stored_entry, entry_base, entry_delta,
+                     entry_size)) {
+    return false;
+  }
+  *entry = *stored_entry;
+  return true;
+}
+
+
+template<typename AddressType, typename EntryType>
+bool RangeMap<AddressType, EntryType>::RetrieveRange(
+    const AddressType &address, const EntryType **entry,
+    AddressType *entry_base, AddressType *entry_delta,
+    AddressType *entry_size) const {
+  BPLOG_IF(ERROR, !entry) << "RangeMap::RetrieveRange requires |entry|";
+  assert(entry);
+
+  const MapValue *range = LowerBound(address, NULL);
+  if (!range)
     return false;
 
   // The map is keyed by the high address of each range, so |address| is
@@ -176,16 +270,16 @@ bool RangeMap<AddressType, EntryType>::RetrieveRange(
   // not directly preceded by another range, it's possible for address to
   // be below the range's low address, though.  When that happens, address
   // references something not within any range, so return false.
-  if (address < iterator->second.base())
+  if (address < range->second.base())
     return false;
 
-  *entry = iterator->second.entry();
+  *entry = &range->second.entry();
   if (entry_base)
-    *entry_base = iterator->second.base();
+    *entry_base = range->second.base();
   if (entry_delta)
-    *entry_delta = iterator->second.delta();
+    *entry_delta = range->second.delta();
   if (entry_size)
-    *entry_size = iterator->first - iterator->second.base() + 1;
+    *entry_size = range->first - range->second.base() + 1;
 
   return true;
 }
@@ -199,31 +293,109 @@ bool RangeMap<AddressType, EntryType>::RetrieveNearestRange(
   assert(entry);
 
   // If address is within a range, RetrieveRange can handle it.
-  if (RetrieveRange(address, entry, entry_base, entry_delta, entry_size))
-    return true;
+  const MapValue *range;
+  const MapValue *previous;
+  range = LowerBound(address, &previous);
+  if (range && address >= range->second.base()) {
+    // |address| is within |range|.
+    previous = range;
+  }
 
-  // upper_bound gives the first element whose key is greater than address,
-  // but we want the first element whose key is less than or equal to address.
-  // Decrement the iterator to get there, but not if the upper_bound already
-  // points to the beginning of the map - in that case, address is lower than
-  // the lowest stored key, so return false.
-  MapConstIterator iterator = map_.upper_bound(address);
-  if (iterator == map_.begin())
+  // Otherwise, |address| is between ranges, and the nearest range below it
+  // is the one before the lower bound - unless the lower bound is the
+  // first range, in which case address is lower than the lowest stored
+  // range, so return false.
+  if (!previous)
     return false;
-  --iterator;
 
-  *entry = iterator->second.entry();
+  *entry = previous->second.entry();
   if (entry_base)
-    *entry_base = iterator->second.base();
+    *entry_base = previous->second.base();
   if (entry_delta)
-    *entry_delta = iterator->second.delta();
+    *entry_delta = previous->second.delta();
   if (entry_size)
-    *entry_size = iterator->first - iterator->second.base() + 1;
+    *entry_size = previous->first - previous->second.base() + 1;
 
   return true;
 }
 
 
+template<typename AddressType, typename EntryType>
+const typename RangeMap<AddressType, EntryType>::MapValue *
+RangeMap<AddressType, EntryType>::LowerBoundFrom(
+    const AddressType &address, int *cursor,
+    const MapValue **previous) const {
+  // Positions in the tree aren't worth keeping; it is only used until the
+  // map is frozen.
+  if (!map_.empty())
+    return LowerBound(address, previous);
+
+  // Every range before |index| ends below |address|.
+  size_t size = ranges_.size();
+  size_t index = *cursor;
+  if (index > size || (index > 0 && !HighIsLess(ranges_[index - 1], address)))
+    index = 0;
+  size_t step = 1;
+  while (index + step <= size && HighIsLess(ranges_[index + step - 1],
+                                            address)) {
+    index += step;
+    step *= 2;
+  }
+  index = std::lower_bound(ranges_.begin() + index,
+                           ranges_.begin() + std::min(index + step, size),
+                           address, HighIsLess) - ranges_.begin();
+  *cursor = static_cast<int>(index);
+
+  if (previous)
+    *previous = index == 0 ? NULL : &ranges_[index - 1];
+  return index == size ? NULL : &ranges_[index];
+}
+
+
+// static
+template<typename AddressType, typename EntryType>
+void RangeMap<AddressType, EntryType>::GetRange(
+    const MapValue &range, const EntryType **entry, AddressType *entry_base,
+    AddressType *entry_delta, AddressType *entry_size) {
+  *entry = &range.second.entry();
+  if (entry_base)
+    *entry_base = range.second.base();
+  if (entry_delta)
+    *entry_delta = range.second.delta();
+  if (entry_size)
+    *entry_size = range.first - range.second.base() + 1;
+}
+
+
+template<typename AddressType, typename EntryType>
+bool RangeMap<AddressType, EntryType>::RetrieveRangeFrom(
+    const AddressType &address, int *cursor, const EntryType **entry,
+    AddressType *entry_base, AddressType *entry_delta,
+    AddressType *entry_size) const {
+  const MapValue *range = LowerBoundFrom(address, cursor, NULL);
+  if (!range || address < range->second.base())
+    return false;
+  GetRange(*range, entry, entry_base, entry_delta, entry_size);
+  return true;
+}
+
+
+template<typename AddressType, typename EntryType>
+bool RangeMap<AddressType, EntryType>::RetrieveNearestRangeFrom(
+    const AddressType &address, int *cursor, const EntryType **entry,
+    AddressType *entry_base, AddressType *entry_delta,
+    AddressType *entry_size) const {
+  const MapValue *previous;
+  const MapValue *range = LowerBoundFrom(address, cursor, &previous);
+  if (range && address >= range->second.base())
+    previous = range;
+  if (!previous)
+    return false;
+  GetRange(*previous, entry, entry_base, entry_delta, entry_size);
+  return true;
+}
+
+
 template<typename AddressType, typename EntryType>
 bool RangeMap<AddressType, EntryType>::RetrieveRangeAtIndex(
     int index, EntryType *entry, AddressType *entry_base,
@@ -231,24 +403,47 @@ bool RangeMap<AddressType, EntryType>::RetrieveRangeAtIndex(
   BPLOG_IF(ERROR, !entry) << "RangeMap::RetrieveRangeAtIndex requires |entry|";
   assert(entry);
 
+  const EntryType *stored_entry;
+  if (!RetrieveRangeAtIndex(index, &stored_entry, entry_base, entry_delta,
+                            entry_size)) {
+    return false;
+  }
+  *entry = *stored_entry;
+  return true;
+}
+
+
+template<typename AddressType, typename EntryType>
+bool RangeMap<AddressType, EntryType>::RetrieveRangeAtIndex(
+    int index, const EntryType **entry, AddressType *entry_base,
+    AddressType *entry_delta, AddressType *entry_size) const {
+  BPLOG_IF(ERROR, !entry) << "RangeMap::RetrieveRangeAtIndex requires |entry|";
+  assert(entry);
+
   if (index >= GetCount()) {
     BPLOG(ERROR) << "Index out of range: " << index << "/" << GetCount();
     return false;
   }
 
-  // Walk through the map.  Although it's ordered, it's not a vector, so it
-  // can't be addressed directly by index.
-  MapConstIterator iterator = map_.begin();
-  for (int this_index = 0; this_index < index; ++this_index)
-    ++iterator;
+  const MapValue *range;
+  if (map_.empty()) {
+    range = &ranges_[index];
+  } else {
+    // Walk through the map.  Although it's ordered, it's not a vector, so
+    // it can't be addressed directly by index.
+    MapConstIterator iterator = map_.begin();
+    for (int this_index = 0; this_index < index; ++this_index)
+      ++iterator;
+    range = &*iterator;
+  }
 
-  *entry = iterator->second.entry();
+  *entry = &range->second.entry();
   if (entry_base)
-    *entry_base = iterator->second.base();
+    *entry_base = range->second.base();
   if (entry_delta)
-    *entry_delta = iterator->second.delta();
+    *entry_delta = range->second.delta();
   if (entry_size)
-    *entry_size = iterator->first - iterator->second.base() + 1;
+    *entry_size = range->first - range->second.base() + 1;
 
   return true;
 }
@@ -256,13 +451,55 @@ bool RangeMap<AddressType, EntryType>::RetrieveRangeAtIndex(
 
 template<typename AddressType, typename EntryType>
 int RangeMap<AddressType, EntryType>::GetCount() const {
-  return static_cast<int>(map_.size());
+  return static_cast<int>(map_.size() + ranges_.size());
+}
+
+
+template<typename AddressType, typename EntryType>
+size_t RangeMap<AddressType, EntryType>::MemoryUsage() const {
+  // A tree node holds its value along with three links and a color.
+  return map_.size() * (sizeof(MapValue) + 4 * sizeof(void*)) +
+         ranges_.capacity() * sizeof(MapValue) +
+         search_tree_.capacity() * sizeof(SearchNode);
 }
 
 
 template<typename AddressType, typename EntryType>
 void RangeMap<AddressType, EntryType>::Clear() {
   map_.clear();
+  RangeVector().swap(ranges_);
+  search_tree_.clear();
+}
+
+
+template<typename AddressType, typename EntryType>
+void RangeMap<AddressType, EntryType>::Freeze() {
+  if (!map_.empty()) {
+    ranges_.reserve(map_.size());
+    for (MapConstIterator iterator = map_.begin(); iterator != map_.end();
+         ++iterator) {
+      ranges_.push_back(*iterator);
+    }
+    map_.clear();
+  }
+
+  search_tree_.resize(ranges_.size());
+  FillSearchTree(0, 0);
+}
+
+
+template<typename AddressType, typename EntryType>
+size_t RangeMap<AddressType, EntryType>::FillSearchTree(size_t node,
+                                                        size_t next) {
+  if (node < search_tree_.size()) {
+    // In-order: the ranges below this node's, this node's, then those
+    // above.
+    next = FillSearchTree(2 * node + 1, next);
+    search_tree_[node].high = ranges_[next].first;
+    search_tree_[node].index = next;
+    next = FillSearchTree(2 * node + 2, next + 1);
+  }
+  return next;
 }
 
 
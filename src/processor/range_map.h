@@ -35,6 +35,11 @@
 // associated with a specific address, which may be any address within the
 // range associated with an object.
 //
+// Ranges stored in address order, as symbol files list them, are appended
+// to a sorted array.  A range stored out of order moves them all into a
+// tree.  Freeze() moves them back into the array and indexes it for fast
+// lookups, once the map is complete.
+//
 // Author: Mark Mentovai
 
 #ifndef PROCESSOR_RANGE_MAP_H__
@@ -42,6 +47,7 @@
 
 
 #include <map>
+#include <vector>
 
 
 namespace google_breakpad {
@@ -52,7 +58,8 @@ template<class, class> class RangeMapSerializer;
 template<typename AddressType, typename EntryType>
 class RangeMap {
  public:
-  RangeMap() : enable_shrink_down_(false), map_() {}
+  RangeMap()
+      : enable_shrink_down_(false), map_(), ranges_(), search_tree_() {}
 
   // |enable_shrink_down| tells whether overlapping ranges can be shrunk down.
   // If true, then adding a new range that overlaps with an existing one can
@@ -79,6 +86,14 @@ class RangeMap {
                      AddressType *entry_base, AddressType *entry_delta,
                      AddressType *entry_size) const;
 
+  // Same as above, but sets |entry| to point at the stored entry instead
+  // of copying it.  The pointer is valid until the map is next changed.
+  // Lookups that may run on several threads use this, so that they do not
+  // copy entries such as linked_ptr<>s, whose copies are not thread safe.
+  bool RetrieveRange(const AddressType &address, const EntryType **entry,
+                     AddressType *entry_base, AddressType *entry_delta,
+                     AddressType *entry_size) const;
+
   // Locates the range encompassing the supplied address, if one exists.
   // If no range encompasses the supplied address, locates the nearest range
   // to the supplied address that is lower than the address.  Returns false
@@ -90,6 +105,23 @@ class RangeMap {
                             AddressType *entry_base, AddressType *entry_delta,
                             AddressType *entry_size) const;
 
+  // RetrieveRange and RetrieveNearestRange, for a series of addresses
+  // looked up in ascending order.  |*cursor| is where the previous lookup
+  // left off, and must be 0 before the first one.  Each lookup searches
+  // forward from there, in steps that double and then by bisection, so
+  // that m sorted lookups among n ranges cost O(m log(n/m)) rather than
+  // O(m log n).  An address lower than the one before starts over from
+  // the first range.  |entry| points at the stored entry, as above.
+  bool RetrieveRangeFrom(const AddressType &address, int *cursor,
+                         const EntryType **entry, AddressType *entry_base,
+                         AddressType *entry_delta,
+                         AddressType *entry_size) const;
+  bool RetrieveNearestRangeFrom(const AddressType &address, int *cursor,
+                                const EntryType **entry,
+                                AddressType *entry_base,
+                                AddressType *entry_delta,
+                                AddressType *entry_size) const;
+
   // Treating all ranges as a list ordered by the address spaces that they
   // occupy, locates the range at the index specified by index.  Returns
   // false if index is larger than the number of ranges stored.  entry_base,
@@ -103,13 +135,30 @@ class RangeMap {
                             AddressType *entry_base, AddressType *entry_delta,
                             AddressType *entry_size) const;
 
+  // Same as above, but sets |entry| to point at the stored entry, as the
+  // second form of RetrieveRange does.
+  bool RetrieveRangeAtIndex(int index, const EntryType **entry,
+                            AddressType *entry_base, AddressType *entry_delta,
+                            AddressType *entry_size) const;
+
   // Returns the number of ranges stored in the RangeMap.
   int GetCount() const;
 
+  // Returns roughly the bytes of heap the ranges take, not counting the
+  // RangeMap itself or anything its entries point to.
+  size_t MemoryUsage() const;
+
   // Empties the range map, restoring it to the state it was when it was
   // initially created.
   void Clear();
 
+  // Moves the ranges into a sorted array of just the right size, indexed
+  // in Eytzinger (breadth-first) order so that the first steps of every
+  // lookup share the same few cache lines.  Lookups find the same ranges
+  // as before.  Storing another range is allowed, but undoes the index,
+  // and moves the ranges back into a tree if it is out of order.
+  void Freeze();
+
  private:
   // Friend declarations.
   friend class ModuleComparer;
@@ -120,6 +169,13 @@ class RangeMap {
   bool StoreRangeInternal(const AddressType &base, const AddressType &delta,
                           const AddressType &size, const EntryType &entry);
 
+  // Moves the ranges from the sorted array into the tree.
+  void Thaw();
+
+  // Fills the search tree's |node| and its children with the ranges from
+  // index |next| on, returning the index of the next range to place.
+  size_t FillSearchTree(size_t node, size_t next);
+
   class Range {
    public:
     Range(const AddressType &base, const AddressType &delta,
@@ -128,7 +184,7 @@ class RangeMap {
 
     AddressType base() const { return base_; }
     AddressType delta() const { return delta_; }
-    EntryType entry() const { return entry_; }
+    const EntryType &entry() const { return entry_; }
 
    private:
     // The base address of the range.  The high address does not need to
@@ -142,16 +198,96 @@ class RangeMap {
     const EntryType entry_;
   };
 
+  // A node of the search tree over ranges_.
+  struct SearchNode {
+    AddressType high;
+    size_t index;
+  };
+
   // Convenience types.
   typedef std::map<AddressType, Range> AddressToRangeMap;
   typedef typename AddressToRangeMap::const_iterator MapConstIterator;
   typedef typename AddressToRangeMap::value_type MapValue;
+  typedef std::vector<MapValue> RangeVector;
+  typedef typename RangeVector::const_iterator RangeVectorConstIterator;
+
+  // Walks the ranges in address order, whether they are in map_ or in
+  // ranges_.  Friends serialize and compare maps with it.
+  class ConstIterator {
+   public:
+    ConstIterator(const RangeMap *range_map, MapConstIterator map_iterator,
+                  size_t index)
+        : range_map_(range_map), map_iterator_(map_iterator), index_(index) {}
+
+    const MapValue &operator*() const {
+      return range_map_->map_.empty() ? range_map_->ranges_[index_]
+                                      : *map_iterator_;
+    }
+    const MapValue *operator->() const { return &**this; }
+
+    ConstIterator &operator++() {
+      if (range_map_->map_.empty())
+        ++index_;
+      else
+        ++map_iterator_;
+      return *this;
+    }
+
+    bool operator==(const ConstIterator &other) const {
+      return map_iterator_ == other.map_iterator_ && index_ == other.index_;
+    }
+    bool operator!=(const ConstIterator &other) const {
+      return !(*this == other);
+    }
+
+   private:
+    const RangeMap *range_map_;
+    MapConstIterator map_iterator_;
+    size_t index_;
+  };
+
+  ConstIterator begin() const {
+    return ConstIterator(this, map_.begin(), 0);
+  }
+  ConstIterator end() const {
+    return ConstIterator(this, map_.end(), ranges_.size());
+  }
+
+  // Returns the range with the lowest high address at or above |address|,
+  // or NULL if there is none.  If |previous| is not NULL, sets it to the
+  // range below that one, or to NULL if there is none.
+  const MapValue *LowerBound(const AddressType &address,
+                             const MapValue **previous) const;
+
+  // LowerBound, searching forward from the index |*cursor| and setting
+  // |*cursor| to the index of the range it finds.  See RetrieveRangeFrom.
+  const MapValue *LowerBoundFrom(const AddressType &address, int *cursor,
+                                 const MapValue **previous) const;
+
+  // Sets the entry, base, delta and size of |range| in the manner of
+  // RetrieveRange.
+  static void GetRange(const MapValue &range, const EntryType **entry,
+                       AddressType *entry_base, AddressType *entry_delta,
+                       AddressType *entry_size);
+
+  static bool HighIsLess(const MapValue &range, const AddressType &address) {
+    return range.first < address;
+  }
 
   // Whether overlapping ranges can be shrunk down.
   bool enable_shrink_down_;
 
-  // Maps the high address of each range to a EntryType.
+  // Maps the high address of each range to a EntryType.  Empty while the
+  // ranges are in ranges_.
   AddressToRangeMap map_;
+
+  // The ranges sorted by address, while they have all been stored in order
+  // or since the map was frozen.  Empty while they are in map_.
+  RangeVector ranges_;
+
+  // If the map is frozen, ranges_ in Eytzinger order: the children of node
+  // i are nodes 2i + 1 and 2i + 2.  Empty otherwise.
+  std::vector<SearchNode> search_tree_;
 };
 
 
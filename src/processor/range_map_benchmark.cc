@@ -0,0 +1,248 @@
+// Copyright 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// range_map_benchmark.cc: Times building RangeMaps from the FUNC, line and
+// STACK CFI INIT records of symbol files, and looking addresses up in them,
+// with the ranges in a tree, in the sorted array they are appended to, and
+// frozen.
+//
+// Usage: range_map_benchmark [iterations [symbol-file...]]
+// Defaults to 20 iterations over the symbol files in
+// $srcdir/src/processor/testdata.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
+#include "processor/logging.h"
+#include "processor/range_map-inl.h"
+
+namespace {
+
+using google_breakpad::RangeMap;
+using std::vector;
+
+const char *kDefaultSymbolFiles[] = {
+  "kernel32.pdb/BCE8785C57B44245A669896B6A19B9542/kernel32.sym",
+  "test_app.pdb/5A9832E5287241C1838ED98914E9B7FF1/test_app.sym",
+  "libc-2.13.so/F4F8DFCD5A5FB5A7CE64717E9E6AE3890/libc-2.13.so.sym",
+  "microdump/breakpad_unittests/D6D1FEC9A15DE7F38A236898871A2E770/"
+      "breakpad_unittests.sym"
+};
+
+struct Range {
+  uint64_t base;
+  uint64_t size;
+};
+
+// The ranges of one kind of record, in the order the symbol files list
+// them.
+struct RangeList {
+  explicit RangeList(const char *name) : name(name), ranges() { }
+  const char *name;
+  vector<Range> ranges;
+};
+
+// Appends the ranges of the FUNC, line and STACK CFI INIT records of the
+// symbol file at PATH to *FUNCTIONS, *LINES and *CFI.
+bool ReadSymbolFile(const string &path, RangeList *functions,
+                    RangeList *lines, RangeList *cfi) {
+  std::ifstream file(path.c_str());
+  if (!file) {
+    fprintf(stderr, "Couldn't open %s\n", path.c_str());
+    return false;
+  }
+  string line;
+  while (std::getline(file, line)) {
+    const char *fields = line.c_str();
+    RangeList *list = lines;
+    if (line.compare(0, 5, "FUNC ") == 0) {
+      // FUNC [m] address size param_size name
+      fields += 5;
+      if (strncmp(fields, "m ", 2) == 0)
+        fields += 2;
+      list = functions;
+    } else if (line.compare(0, 15, "STACK CFI INIT ") == 0) {
+      // STACK CFI INIT address size rules
+      fields += 15;
+      list = cfi;
+    } else if (!isxdigit(line[0])) {
+      continue;
+    }
+    // address size ...
+    char *end;
+    Range range;
+    range.base = strtoull(fields, &end, 16);
+    if (*end != ' ')
+      continue;
+    range.size = strtoull(end + 1, &end, 16);
+    // RangeMap doesn't store empty ranges.
+    if (*end != ' ' || range.size == 0)
+      continue;
+    list->ranges.push_back(range);
+  }
+  return true;
+}
+
+double NowNs() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+typedef RangeMap<uint64_t, int> IntRangeMap;
+
+// Stores RANGES in MAP, in order or, if REVERSED, in reverse order, which
+// keeps them in a tree.
+void Build(const vector<Range> &ranges, bool reversed, IntRangeMap *map) {
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    size_t index = reversed ? ranges.size() - 1 - i : i;
+    map->StoreRange(ranges[index].base, ranges[index].size,
+                    static_cast<int>(index));
+  }
+}
+
+// Returns the number of ADDRESSES that MAP has a range for.
+size_t Lookup(const IntRangeMap &map, const vector<uint64_t> &addresses) {
+  size_t found = 0;
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    int entry;
+    if (map.RetrieveRange(addresses[i], &entry, NULL, NULL, NULL))
+      ++found;
+  }
+  return found;
+}
+
+void Benchmark(const RangeList &list, int iterations) {
+  const vector<Range> &ranges = list.ranges;
+  if (ranges.empty())
+    return;
+
+  // Addresses within randomly chosen ranges, in an order no cache can
+  // guess.
+  vector<uint64_t> addresses(1 << 16);
+  uint64_t random = 1;
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    random = random * 6364136223846793005ULL + 1442695040888963407ULL;
+    const Range &range = ranges[(random >> 16) % ranges.size()];
+    random = random * 6364136223846793005ULL + 1442695040888963407ULL;
+    addresses[i] = range.base + (random >> 16) % range.size;
+  }
+
+  printf("%s: %zu ranges\n", list.name, ranges.size());
+
+  double tree_ns = 0, array_ns = 0, freeze_ns = 0;
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    IntRangeMap tree, array;
+    double start = NowNs();
+    Build(ranges, true, &tree);
+    tree_ns += NowNs() - start;
+    start = NowNs();
+    Build(ranges, false, &array);
+    array_ns += NowNs() - start;
+    start = NowNs();
+    array.Freeze();
+    freeze_ns += NowNs() - start;
+  }
+  printf("  %-28s %8.1f ns per range\n", "build in reverse (tree)",
+         tree_ns / iterations / ranges.size());
+  printf("  %-28s %8.1f ns per range\n", "build in order (array)",
+         array_ns / iterations / ranges.size());
+  printf("  %-28s %8.1f ns per range\n", "freeze",
+         freeze_ns / iterations / ranges.size());
+
+  IntRangeMap tree, array, frozen;
+  Build(ranges, true, &tree);
+  Build(ranges, false, &array);
+  Build(ranges, false, &frozen);
+  frozen.Freeze();
+  const IntRangeMap *maps[] = { &tree, &array, &frozen };
+  const char *names[] = { "lookup, tree", "lookup, sorted array",
+                          "lookup, frozen" };
+  for (int i = 0; i < 3; ++i) {
+    size_t found = 0;
+    double start = NowNs();
+    for (int iteration = 0; iteration < iterations; ++iteration)
+      found += Lookup(*maps[i], addresses);
+    double elapsed_ns = NowNs() - start;
+    printf("  %-28s %8.1f ns per lookup, %zu found\n", names[i],
+           elapsed_ns / iterations / addresses.size(), found / iterations);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  BPLOG_INIT(&argc, &argv);
+  int iterations = argc > 1 ? atoi(argv[1]) : 20;
+  vector<string> paths;
+  for (int i = 2; i < argc; ++i)
+    paths.push_back(argv[i]);
+  if (paths.empty()) {
+    const char *srcdir = getenv("srcdir");
+    string symbols = string(srcdir ? srcdir : ".") +
+                     "/src/processor/testdata/symbols/";
+    for (size_t i = 0;
+         i < sizeof(kDefaultSymbolFiles) / sizeof(*kDefaultSymbolFiles); ++i)
+      paths.push_back(symbols + kDefaultSymbolFiles[i]);
+  }
+
+  RangeList functions("FUNC records"), lines("line records"),
+      cfi("STACK CFI INIT records");
+  for (size_t i = 0; i < paths.size(); ++i) {
+    // Each file is a module of its own; give it its own address space.
+    RangeList file_functions(functions.name), file_lines(lines.name),
+        file_cfi(cfi.name);
+    if (!ReadSymbolFile(paths[i], &file_functions, &file_lines, &file_cfi))
+      return 1;
+    uint64_t offset = static_cast<uint64_t>(i) << 40;
+    RangeList *file_lists[] = { &file_functions, &file_lines, &file_cfi };
+    RangeList *lists[] = { &functions, &lines, &cfi };
+    for (int list = 0; list < 3; ++list) {
+      for (size_t j = 0; j < file_lists[list]->ranges.size(); ++j) {
+        Range range = file_lists[list]->ranges[j];
+        range.base += offset;
+        lists[list]->ranges.push_back(range);
+      }
+    }
+  }
+
+  Benchmark(functions, iterations);
+  Benchmark(lines, iterations);
+  Benchmark(cfi, iterations);
+  return 0;
+}
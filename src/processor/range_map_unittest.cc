@@ -34,6 +34,7 @@
 
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "processor/range_map-inl.h"
 
@@ -369,6 +370,128 @@ static bool RetriveAtIndexTest2() {
 }
 
 
+// Stores ranges in a frozen map, in order and out of order, and checks that
+// lookups find all of them, before and after freezing it again.
+static bool FreezeTest() {
+  scoped_ptr<TestMap> range_map(new TestMap());
+
+  // Ranges 10 to 19, 30 to 39, ... 190 to 199, stored in order.
+  for (int object_id = 0; object_id < 10; ++object_id) {
+    linked_ptr<CountedObject> object(new CountedObject(object_id));
+    range_map->StoreRange(20 * object_id + 10, 10, object);
+  }
+  range_map->Freeze();
+
+  const int kStoreAfterFreeze[][2] = {
+    { 200, 10 },  // Above every range: appended.
+    { 0, 10 },    // Below every range.
+    { 25, 5 },    // Between two ranges.
+    { 15, 10 }    // Overlapping two ranges: not stored.
+  };
+  for (int i = 0; i < 4; ++i) {
+    linked_ptr<CountedObject> object(new CountedObject(10 + i));
+    bool stored = range_map->StoreRange(kStoreAfterFreeze[i][0],
+                                        kStoreAfterFreeze[i][1], object);
+    if (stored != (i < 3)) {
+      fprintf(stderr, "FAILED: FreezeTest store %d, expected %s\n", i,
+              i < 3 ? "storable" : "not storable");
+      return false;
+    }
+  }
+
+  for (int pass = 0; pass < 2; ++pass) {
+    if (range_map->GetCount() != 13) {
+      fprintf(stderr, "FAILED: FreezeTest pass %d, expected 13 ranges, "
+              "observed %d\n", pass, range_map->GetCount());
+      return false;
+    }
+    for (AddressType address = 0; address < 220; ++address) {
+      int expected_id = -1;
+      if (address >= 200 && address < 210)
+        expected_id = 10;
+      else if (address < 10)
+        expected_id = 11;
+      else if (address >= 25 && address < 30)
+        expected_id = 12;
+      else if (address >= 10 && address < 200 && address % 20 >= 10)
+        expected_id = address / 20;
+
+      linked_ptr<CountedObject> object;
+      bool found = range_map->RetrieveRange(address, &object, NULL, NULL,
+                                            NULL);
+      if (found != (expected_id != -1) ||
+          (found && object->id() != expected_id)) {
+        fprintf(stderr, "FAILED: FreezeTest pass %d, address %d, "
+                "expected id %d, observed %d\n", pass, address, expected_id,
+                found ? object->id() : -1);
+        return false;
+      }
+    }
+    range_map->Freeze();
+  }
+
+  return true;
+}
+
+
+// Looks addresses up in runs that ascend, with small and large strides,
+// and that go back, and checks that the cursor lookups agree with the
+// plain ones.
+static bool CursorTest() {
+  scoped_ptr<TestMap> range_map(new TestMap());
+
+  // Ranges 10 to 19, 30 to 39, ... 1990 to 1999.
+  for (int object_id = 0; object_id < 100; ++object_id) {
+    linked_ptr<CountedObject> object(new CountedObject(object_id));
+    range_map->StoreRange(20 * object_id + 10, 10, object);
+  }
+  range_map->Freeze();
+
+  const int kStrides[] = { 1, 7, 20, 333, -1, -45 };
+  for (int i = 0; i < 6; ++i) {
+    int stride = kStrides[i];
+    int range_cursor = 0;
+    int nearest_cursor = 0;
+    for (int step = 0; step * abs(stride) < 2020; ++step) {
+      AddressType address = stride > 0 ? step * stride : 2019 + step * stride;
+
+      linked_ptr<CountedObject> expected;
+      bool expected_found = range_map->RetrieveRange(address, &expected,
+                                                     NULL, NULL, NULL);
+      const linked_ptr<CountedObject> *object;
+      bool found = range_map->RetrieveRangeFrom(address, &range_cursor,
+                                                &object, NULL, NULL, NULL);
+      if (found != expected_found ||
+          (found && object->get() != expected.get())) {
+        fprintf(stderr, "FAILED: CursorTest stride %d, address %d, "
+                "RetrieveRangeFrom expected id %d, observed %d\n", stride,
+                address, expected_found ? expected->id() : -1,
+                found ? (*object)->id() : -1);
+        return false;
+      }
+
+      AddressType expected_base, base;
+      expected_found = range_map->RetrieveNearestRange(address, &expected,
+                                                       &expected_base, NULL,
+                                                       NULL);
+      found = range_map->RetrieveNearestRangeFrom(address, &nearest_cursor,
+                                                  &object, &base, NULL, NULL);
+      if (found != expected_found ||
+          (found && (object->get() != expected.get() ||
+                     base != expected_base))) {
+        fprintf(stderr, "FAILED: CursorTest stride %d, address %d, "
+                "RetrieveNearestRangeFrom expected id %d, observed %d\n",
+                stride, address, expected_found ? expected->id() : -1,
+                found ? (*object)->id() : -1);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+
 // RunTests runs a series of test sets.
 static bool RunTests() {
   // These tests will be run sequentially.  The first set of tests exercises
@@ -517,6 +640,27 @@ static bool RunTests() {
         return false;
     }
 
+    if (!RetrieveIndexTest(range_map.get(), range_test_set_index))
+      return false;
+
+    // Freezing the map must not change what it finds.
+    range_map->Freeze();
+    if (range_map->GetCount() != stored_count ||
+        CountedObject::count() != stored_count) {
+      fprintf(stderr, "FAILED: stored object count changed after Freeze, "
+              "expected %d, observed %d\n",
+              stored_count, range_map->GetCount());
+
+      return false;
+    }
+    for (unsigned int range_test_index = 0;
+         range_test_index < range_test_count;
+         ++range_test_index) {
+      const RangeTest *range_test = &range_tests[range_test_index];
+      if (!RetrieveTest(range_map.get(), range_test))
+        return false;
+    }
+
     if (!RetrieveIndexTest(range_map.get(), range_test_set_index))
       return false;
 
@@ -545,6 +689,12 @@ static bool RunTests() {
     return false;
   }
 
+  if (!FreezeTest())
+    return false;
+
+  if (!CursorTest())
+    return false;
+
   return true;
 }
 
@@ -45,7 +45,6 @@
 
 #include "google_breakpad/processor/basic_source_line_resolver.h"
 #include "processor/basic_source_line_resolver_types.h"
-#include "processor/linked_ptr.h"
 #include "processor/windows_frame_info.h"
 
 namespace google_breakpad {
@@ -119,12 +118,12 @@ class SimpleSerializer<BasicSourceLineResolver::PublicSymbol> {
   typedef BasicSourceLineResolver::PublicSymbol PublicSymbol;
  public:
   static size_t SizeOf(const PublicSymbol &pubsymbol) {
-    return SimpleSerializer<string>::SizeOf(pubsymbol.name)
+    return SimpleSerializer<const char*>::SizeOf(pubsymbol.name)
          + SimpleSerializer<MemAddr>::SizeOf(pubsymbol.address)
          + SimpleSerializer<int32_t>::SizeOf(pubsymbol.parameter_size);
   }
   static char *Write(const PublicSymbol &pubsymbol, char *dest) {
-    dest = SimpleSerializer<string>::Write(pubsymbol.name, dest);
+    dest = SimpleSerializer<const char*>::Write(pubsymbol.name, dest);
     dest = SimpleSerializer<MemAddr>::Write(pubsymbol.address, dest);
     dest = SimpleSerializer<int32_t>::Write(pubsymbol.parameter_size, dest);
     return dest;
@@ -164,19 +163,20 @@ class SimpleSerializer<WindowsFrameInfo> {
   }
 };
 
-// Specializations of SimpleSerializer: Linked_ptr version of
-// Line, Function, PublicSymbol, WindowsFrameInfo.
+// Specializations of SimpleSerializer: pointer version of Line, Function
+// and PublicSymbol, which BasicSourceLineResolver::Module keeps in its
+// arena.
 template<>
-class SimpleSerializer< linked_ptr<BasicSourceLineResolver::Line> > {
+class SimpleSerializer<BasicSourceLineResolver::Line*> {
   typedef BasicSourceLineResolver::Line Line;
  public:
-  static size_t SizeOf(const linked_ptr<Line> &lineptr) {
-    if (lineptr.get() == NULL) return 0;
-    return SimpleSerializer<Line>::SizeOf(*(lineptr.get()));
+  static size_t SizeOf(const Line *line) {
+    if (line == NULL) return 0;
+    return SimpleSerializer<Line>::SizeOf(*line);
   }
-  static char *Write(const linked_ptr<Line> &lineptr, char *dest) {
-    if (lineptr.get())
-      dest = SimpleSerializer<Line>::Write(*(lineptr.get()), dest);
+  static char *Write(const Line *line, char *dest) {
+    if (line)
+      dest = SimpleSerializer<Line>::Write(*line, dest);
     return dest;
   }
 };
@@ -189,7 +189,7 @@ class SimpleSerializer<BasicSourceLineResolver::Function> {
  public:
   static size_t SizeOf(const Function &func) {
     unsigned int size = 0;
-    size += SimpleSerializer<string>::SizeOf(func.name);
+    size += SimpleSerializer<const char*>::SizeOf(func.name);
     size += SimpleSerializer<MemAddr>::SizeOf(func.address);
     size += SimpleSerializer<MemAddr>::SizeOf(func.size);
     size += SimpleSerializer<int32_t>::SizeOf(func.parameter_size);
@@ -198,7 +198,7 @@ class SimpleSerializer<BasicSourceLineResolver::Function> {
   }
 
   static char *Write(const Function &func, char *dest) {
-    dest = SimpleSerializer<string>::Write(func.name, dest);
+    dest = SimpleSerializer<const char*>::Write(func.name, dest);
     dest = SimpleSerializer<MemAddr>::Write(func.address, dest);
     dest = SimpleSerializer<MemAddr>::Write(func.size, dest);
     dest = SimpleSerializer<int32_t>::Write(func.parameter_size, dest);
@@ -207,50 +207,52 @@ class SimpleSerializer<BasicSourceLineResolver::Function> {
   }
  private:
   // This static member is defined in module_serializer.cc.
-  static RangeMapSerializer< MemAddr, linked_ptr<Line> > range_map_serializer_;
+  static RangeMapSerializer<MemAddr, Line*> range_map_serializer_;
 };
 
 template<>
-class SimpleSerializer< linked_ptr<BasicSourceLineResolver::Function> > {
+class SimpleSerializer<BasicSourceLineResolver::Function*> {
   typedef BasicSourceLineResolver::Function Function;
  public:
-  static size_t SizeOf(const linked_ptr<Function> &func) {
-    if (!func.get()) return 0;
-    return SimpleSerializer<Function>::SizeOf(*(func.get()));
+  static size_t SizeOf(const Function *func) {
+    if (!func) return 0;
+    return SimpleSerializer<Function>::SizeOf(*func);
   }
 
-  static char *Write(const linked_ptr<Function> &func, char *dest) {
-    if (func.get())
-      dest = SimpleSerializer<Function>::Write(*(func.get()), dest);
+  static char *Write(const Function *func, char *dest) {
+    if (func)
+      dest = SimpleSerializer<Function>::Write(*func, dest);
     return dest;
   }
 };
 
 template<>
-class SimpleSerializer< linked_ptr<BasicSourceLineResolver::PublicSymbol> > {
+class SimpleSerializer<BasicSourceLineResolver::PublicSymbol*> {
   typedef BasicSourceLineResolver::PublicSymbol PublicSymbol;
  public:
-  static size_t SizeOf(const linked_ptr<PublicSymbol> &pubsymbol) {
-    if (pubsymbol.get() == NULL) return 0;
-    return SimpleSerializer<PublicSymbol>::SizeOf(*(pubsymbol.get()));
+  static size_t SizeOf(const PublicSymbol *pubsymbol) {
+    if (pubsymbol == NULL) return 0;
+    return SimpleSerializer<PublicSymbol>::SizeOf(*pubsymbol);
   }
-  static char *Write(const linked_ptr<PublicSymbol> &pubsymbol, char *dest) {
-    if (pubsymbol.get())
-      dest = SimpleSerializer<PublicSymbol>::Write(*(pubsymbol.get()), dest);
+  static char *Write(const PublicSymbol *pubsymbol, char *dest) {
+    if (pubsymbol)
+      dest = SimpleSerializer<PublicSymbol>::Write(*pubsymbol, dest);
     return dest;
   }
 };
 
+// Specializations of SimpleSerializer: pointer version of
+// WindowsFrameInfo.
 template<>
-class SimpleSerializer< linked_ptr<WindowsFrameInfo> > {
+class SimpleSerializer<WindowsFrameInfo*> {
  public:
-  static size_t SizeOf(const linked_ptr<WindowsFrameInfo> &wfi) {
-    if (wfi.get() == NULL) return 0;
-    return SimpleSerializer<WindowsFrameInfo>::SizeOf(*(wfi.get()));
+  static size_t SizeOf(const WindowsFrameInfo *wfi) {
+    if (wfi == NULL) return 0;
+    return SimpleSerializer<WindowsFrameInfo>::SizeOf(*wfi);
   }
-  static char *Write(const linked_ptr<WindowsFrameInfo> &wfi, char *dest) {
-    if (wfi.get())
-      dest = SimpleSerializer<WindowsFrameInfo>::Write(*(wfi.get()), dest);
+  static char *Write(const WindowsFrameInfo *wfi, char *dest) {
+    if (wfi)
+      dest = SimpleSerializer<WindowsFrameInfo>::Write(*wfi, dest);
     return dest;
   }
 };
@@ -36,9 +36,12 @@
 #include "processor/simple_symbol_supplier.h"
 
 #include <assert.h>
+#include <fcntl.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <iostream>
@@ -47,6 +50,7 @@
 #include "common/using_std_string.h"
 #include "google_breakpad/processor/code_module.h"
 #include "google_breakpad/processor/system_info.h"
+#include "processor/binary_symbol_file.h"
 #include "processor/logging.h"
 #include "processor/pathname_stripper.h"
 
@@ -104,23 +108,69 @@ SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetCStringSymbolData(
   assert(symbol_data);
   assert(symbol_data_size);
 
-  string symbol_data_string;
-  SymbolSupplier::SymbolResult s =
-      GetSymbolFile(module, system_info, symbol_file, &symbol_data_string);
+  SymbolSupplier::SymbolResult s = GetSymbolFile(module, system_info,
+                                                 symbol_file);
+  if (s != FOUND)
+    return s;
 
-  if (s == FOUND) {
-    *symbol_data_size = symbol_data_string.size() + 1;
-    *symbol_data = new char[*symbol_data_size];
-    if (*symbol_data == NULL) {
-      BPLOG(ERROR) << "Memory allocation for size " << *symbol_data_size
-                   << " failed";
-      return INTERRUPT;
+  SymbolDataBuffer buffer;
+  if (!LoadSymbolData(*symbol_file, &buffer, symbol_data_size))
+    return NOT_FOUND;
+  *symbol_data = buffer.data;
+  memory_buffers_.insert(make_pair(module->code_file(), buffer));
+  return FOUND;
+}
+
+// static
+bool SimpleSymbolSupplier::LoadSymbolData(const string &path,
+                                          SymbolDataBuffer *buffer,
+                                          size_t *symbol_data_size) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    BPLOG(ERROR) << "Could not open symbol file " << path;
+    return false;
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) != 0) {
+    BPLOG(ERROR) << "Could not stat symbol file " << path;
+    close(fd);
+    return false;
+  }
+  size_t size = sb.st_size;
+
+  // Binary symbol files are used in place, so map them rather than
+  // reading them.
+  char header[sizeof(BinarySymbolFileHeader)];
+  if (pread(fd, header, sizeof(header), 0) ==
+          static_cast<ssize_t>(sizeof(header)) &&
+      IsBinarySymbolFile(header, sizeof(header))) {
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      BPLOG(ERROR) << "Could not map binary symbol file " << path;
+      return false;
     }
-    memcpy(*symbol_data, symbol_data_string.c_str(), symbol_data_string.size());
-    (*symbol_data)[symbol_data_string.size()] = '\0';
-    memory_buffers_.insert(make_pair(module->code_file(), *symbol_data));
+    buffer->data = static_cast<char*>(data);
+    buffer->mapped_size = size;
+    *symbol_data_size = size;
+    return true;
   }
-  return s;
+
+  char *data = new char[size + 1];
+  size_t offset = 0;
+  while (offset < size) {
+    ssize_t count = pread(fd, data + offset, size - offset, offset);
+    if (count <= 0)
+      break;
+    offset += count;
+  }
+  close(fd);
+  data[offset] = '\0';
+  buffer->data = data;
+  buffer->mapped_size = 0;
+  *symbol_data_size = offset + 1;
+  return true;
 }
 
 void SimpleSymbolSupplier::FreeSymbolData(const CodeModule *module) {
@@ -129,13 +179,17 @@ void SimpleSymbolSupplier::FreeSymbolData(const CodeModule *module) {
     return;
   }
 
-  map<string, char *>::iterator it = memory_buffers_.find(module->code_file());
+  map<string, SymbolDataBuffer>::iterator it =
+      memory_buffers_.find(module->code_file());
   if (it == memory_buffers_.end()) {
     BPLOG(INFO) << "Cannot find symbol data buffer for module "
                 << module->code_file();
     return;
   }
-  delete [] it->second;
+  if (it->second.mapped_size)
+    munmap(it->second.data, it->second.mapped_size);
+  else
+    delete [] it->second.data;
   memory_buffers_.erase(it);
 }
 
@@ -65,6 +65,11 @@
 // SimpleSymbolSupplier will iterate over all root paths searching for
 // a symbol file existing in that path.
 //
+// Symbol files may be text, or binary symbol files written by dump_syms -b
+// (see processor/binary_symbol_file.h).  GetCStringSymbolData maps binary
+// symbol files into memory read-only instead of reading them, so they are
+// only usable with FastSourceLineResolver.
+//
 // SimpleSymbolSupplier supports any debugging file which can be identified
 // by a CodeModule object's debug_file and debug_identifier accessors.  The
 // expected ultimate source of these CodeModule objects are MinidumpModule
@@ -113,7 +118,8 @@ class SimpleSymbolSupplier : public SymbolSupplier {
                                      string *symbol_file,
                                      string *symbol_data);
 
-  // Allocates data buffer on heap and writes symbol data into buffer.
+  // Allocates data buffer on heap and writes symbol data into buffer, or
+  // for binary symbol files, maps the file read-only.
   // Symbol supplier ALWAYS takes ownership of the data buffer.
   virtual SymbolResult GetCStringSymbolData(const CodeModule *module,
                                             const SystemInfo *system_info,
@@ -121,7 +127,8 @@ class SimpleSymbolSupplier : public SymbolSupplier {
                                             char **symbol_data,
                                             size_t *symbol_data_size);
 
-  // Free the data buffer allocated in the above GetCStringSymbolData();
+  // Free the data buffer allocated, or unmap the file mapped, in the above
+  // GetCStringSymbolData();
   virtual void FreeSymbolData(const CodeModule *module);
 
  protected:
@@ -131,7 +138,22 @@ class SimpleSymbolSupplier : public SymbolSupplier {
                                            string *symbol_file);
 
  private:
-  map<string, char *> memory_buffers_;
+  // A buffer handed out by GetCStringSymbolData.  |mapped_size| is the
+  // size of the mapping for a mapped binary symbol file, or zero for a
+  // buffer allocated with new[].
+  struct SymbolDataBuffer {
+    char *data;
+    size_t mapped_size;
+  };
+
+  // Opens the symbol file at |path| once and loads it into |*buffer|: a
+  // binary symbol file, recognized by its header, is mapped, and a text
+  // one is read into a new[] buffer followed by a '\0'.  Sets
+  // |*symbol_data_size| to the size of the data, including any '\0'.
+  static bool LoadSymbolData(const string &path, SymbolDataBuffer *buffer,
+                             size_t *symbol_data_size);
+
+  map<string, SymbolDataBuffer> memory_buffers_;
   vector<string> paths_;
 };
 
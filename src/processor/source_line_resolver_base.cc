@@ -34,15 +34,25 @@
 //
 // Author: Siyang Xie (lambxsy@google.com)
 
+#include <ctype.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "google_breakpad/processor/source_line_resolver_base.h"
 #include "processor/source_line_resolver_base_types.h"
+#include "processor/binary_symbol_file.h"
 #include "processor/module_factory.h"
 
 using std::map;
@@ -50,12 +60,125 @@ using std::make_pair;
 
 namespace google_breakpad {
 
+// A hash table of code files with a fixed number of buckets, each a linked
+// list that only ever grows at its head.  Entries are never removed, an
+// unloaded module only clears its entry's module pointer, so readers can
+// walk the lists while another thread inserts.
+class SourceLineResolverBase::ModuleTable {
+ public:
+  struct Entry {
+    Entry(const string &name, Entry *next)
+        : name(name), module(NULL), corrupt(false), holds(0), loading(false),
+          next(next) { }
+
+    const string name;
+    // NULL unless the module is loaded.
+    std::atomic<Module*> module;
+    std::atomic<bool> corrupt;
+    // The number of Holds on the entry.  See Hold.
+    std::atomic<int> holds;
+    // True while a thread parses the module.  Guarded by mutex.
+    bool loading;
+    Entry *const next;
+  };
+
+  ModuleTable() {
+    for (size_t i = 0; i < kBucketCount; ++i)
+      buckets_[i].store(NULL, std::memory_order_relaxed);
+  }
+
+  ~ModuleTable() {
+    for (size_t i = 0; i < kBucketCount; ++i) {
+      Entry *entry = buckets_[i].load(std::memory_order_relaxed);
+      while (entry) {
+        Entry *next = entry->next;
+        delete entry;
+        entry = next;
+      }
+    }
+  }
+
+  // Returns the entry for |name|, or NULL.  Takes no lock.
+  Entry *Find(const string &name) const {
+    Entry *entry = buckets_[Bucket(name)].load(std::memory_order_acquire);
+    while (entry && entry->name != name)
+      entry = entry->next;
+    return entry;
+  }
+
+  // Returns the entry for |name|, adding it if needed.  The caller must
+  // hold mutex.
+  Entry *FindOrInsert(const string &name) {
+    Entry *entry = Find(name);
+    if (!entry) {
+      std::atomic<Entry*> &bucket = buckets_[Bucket(name)];
+      entry = new Entry(name, bucket.load(std::memory_order_relaxed));
+      bucket.store(entry, std::memory_order_release);
+    }
+    return entry;
+  }
+
+  // Holds the module loaded for a code file, if any, while a lookup uses
+  // it.  UnloadModule clears the entry's module, then waits for the holds
+  // on the entry to go before deleting the module, so a lookup that got
+  // the module can finish with it.  Takes no lock.
+  class Hold {
+   public:
+    Hold(const ModuleTable *table, const CodeModule *module)
+        : entry_(module ? table->Find(module->code_file()) : NULL),
+          module_(NULL) {
+      if (entry_) {
+        // Count the hold before reading the module, and UnloadModule
+        // clears the module before reading the count: either it sees the
+        // hold, or the hold sees no module.
+        entry_->holds.fetch_add(1, std::memory_order_seq_cst);
+        module_ = entry_->module.load(std::memory_order_seq_cst);
+      }
+    }
+
+    ~Hold() {
+      if (entry_)
+        entry_->holds.fetch_sub(1, std::memory_order_release);
+    }
+
+    // The module, or NULL if it isn't loaded.
+    Module *get() const { return module_; }
+
+    bool corrupt() const {
+      return module_ && entry_->corrupt.load(std::memory_order_relaxed);
+    }
+
+   private:
+    Entry *entry_;
+    Module *module_;
+
+    // Disallow unwanted copy ctor and assignment operator
+    Hold(const Hold&);
+    void operator=(const Hold&);
+  };
+
+  // Guards insertions, Entry::loading, and the resolver's maps.
+  std::mutex mutex;
+  // Signaled when a load completes.
+  std::condition_variable load_done;
+
+ private:
+  static const size_t kBucketCount = 1024;
+
+  static size_t Bucket(const string &name) {
+    return std::hash<string>()(name) % kBucketCount;
+  }
+
+  std::atomic<Entry*> buckets_[kBucketCount];
+};
+
 SourceLineResolverBase::SourceLineResolverBase(
     ModuleFactory *module_factory)
   : modules_(new ModuleMap),
     corrupt_modules_(new ModuleSet),
     memory_buffers_(new MemoryMap),
-    module_factory_(module_factory) {
+    module_factory_(module_factory),
+    module_table_(new ModuleTable) {
 }
 
 SourceLineResolverBase::~SourceLineResolverBase() {
@@ -83,6 +206,9 @@ SourceLineResolverBase::~SourceLineResolverBase() {
 
   delete module_factory_;
   module_factory_ = NULL;
+
+  delete module_table_;
+  module_table_ = NULL;
 }
 
 bool SourceLineResolverBase::ReadSymbolFile(const string &map_file,
@@ -154,7 +280,7 @@ bool SourceLineResolverBase::LoadModule(const CodeModule *module,
     return false;
 
   // Make sure we don't already have a module with the given name.
-  if (modules_->find(module->code_file()) != modules_->end()) {
+  if (HasModule(module)) {
     BPLOG(INFO) << "Symbols for module " << module->code_file()
                 << " already loaded";
     return false;
@@ -170,13 +296,12 @@ bool SourceLineResolverBase::LoadModule(const CodeModule *module,
 
   BPLOG(INFO) << "Read symbol file " << map_file << " succeeded";
 
-  bool load_result = LoadModuleUsingMemoryBuffer(module, memory_buffer,
-                                                 memory_buffer_size);
+  bool buffer_kept;
+  bool load_result = LoadModuleFromBuffer(module, memory_buffer,
+                                          memory_buffer_size, &buffer_kept);
 
-  if (load_result && !ShouldDeleteMemoryBufferAfterLoadModule()) {
-    // memory_buffer has to stay alive as long as the module.
-    memory_buffers_->insert(make_pair(module->code_file(), memory_buffer));
-  } else {
+  // Otherwise memory_buffer has to stay alive as long as the module.
+  if (!buffer_kept) {
     delete [] memory_buffer;
   }
 
@@ -189,7 +314,7 @@ bool SourceLineResolverBase::LoadModuleUsingMapBuffer(
     return false;
 
   // Make sure we don't already have a module with the given name.
-  if (modules_->find(module->code_file()) != modules_->end()) {
+  if (HasModule(module)) {
     BPLOG(INFO) << "Symbols for module " << module->code_file()
                 << " already loaded";
     return false;
@@ -206,13 +331,12 @@ bool SourceLineResolverBase::LoadModuleUsingMapBuffer(
   memcpy(memory_buffer, map_buffer.c_str(), map_buffer.size());
   memory_buffer[map_buffer.size()] = '\0';
 
-  bool load_result = LoadModuleUsingMemoryBuffer(module, memory_buffer,
-                                                 memory_buffer_size);
+  bool buffer_kept;
+  bool load_result = LoadModuleFromBuffer(module, memory_buffer,
+                                          memory_buffer_size, &buffer_kept);
 
-  if (load_result && !ShouldDeleteMemoryBufferAfterLoadModule()) {
-    // memory_buffer has to stay alive as long as the module.
-    memory_buffers_->insert(make_pair(module->code_file(), memory_buffer));
-  } else {
+  // Otherwise memory_buffer has to stay alive as long as the module.
+  if (!buffer_kept) {
     delete [] memory_buffer;
   }
 
@@ -223,16 +347,54 @@ bool SourceLineResolverBase::LoadModuleUsingMemoryBuffer(
     const CodeModule *module,
     char *memory_buffer,
     size_t memory_buffer_size) {
+  return LoadModuleFromBuffer(module, memory_buffer, memory_buffer_size,
+                              NULL /* buffer_kept */);
+}
+
+bool SourceLineResolverBase::LoadModuleFromBuffer(
+    const CodeModule *module,
+    char *memory_buffer,
+    size_t memory_buffer_size,
+    bool *buffer_kept) {
+  bool keep_buffer = false;
+  if (buffer_kept) {
+    *buffer_kept = false;
+    keep_buffer = !ShouldDeleteMemoryBufferAfterLoadModule();
+  }
+
   if (!module)
     return false;
 
-  // Make sure we don't already have a module with the given name.
-  if (modules_->find(module->code_file()) != modules_->end()) {
-    BPLOG(INFO) << "Symbols for module " << module->code_file()
-                << " already loaded";
+  // A symbol file is found by its module's debug identifier.  A binary
+  // symbol file also records it, so make sure it is the module's.
+  BinarySymbolFileHeader file_header;
+  BinarySymbolFileModuleInfo file_info;
+  if (ReadBinarySymbolFileHeader(memory_buffer, memory_buffer_size,
+                                 &file_header, &file_info) &&
+      !file_info.debug_id.empty() && !module->debug_identifier().empty() &&
+      !SameDebugIdentifier(file_info.debug_id, module->debug_identifier())) {
+    BPLOG(ERROR) << "Symbols for module " << module->code_file()
+                 << " are for debug identifier " << file_info.debug_id
+                 << ", not " << module->debug_identifier();
     return false;
   }
 
+  // Make sure we don't already have a module with the given name, and that
+  // no other thread is loading it.
+  ModuleTable::Entry *entry;
+  {
+    std::unique_lock<std::mutex> lock(module_table_->mutex);
+    entry = module_table_->FindOrInsert(module->code_file());
+    while (entry->loading)
+      module_table_->load_done.wait(lock);
+    if (entry->module.load(std::memory_order_relaxed)) {
+      BPLOG(INFO) << "Symbols for module " << module->code_file()
+                  << " already loaded";
+      return false;
+    }
+    entry->loading = true;
+  }
+
   BPLOG(INFO) << "Loading symbols for module " << module->code_file()
              << " from memory buffer";
 
@@ -248,10 +410,20 @@ bool SourceLineResolverBase::LoadModuleUsingMemoryBuffer(
     assert(basic_module->IsCorrupt());
   }
 
+  std::lock_guard<std::mutex> lock(module_table_->mutex);
   modules_->insert(make_pair(module->code_file(), basic_module));
   if (basic_module->IsCorrupt()) {
     corrupt_modules_->insert(module->code_file());
   }
+  if (keep_buffer) {
+    memory_buffers_->insert(make_pair(module->code_file(), memory_buffer));
+    *buffer_kept = true;
+  }
+  entry->corrupt.store(basic_module->IsCorrupt(), std::memory_order_relaxed);
+  // Publishes the parsed module to lookups.
+  entry->module.store(basic_module, std::memory_order_release);
+  entry->loading = false;
+  module_table_->load_done.notify_all();
   return true;
 }
 
@@ -263,6 +435,18 @@ void SourceLineResolverBase::UnloadModule(const CodeModule *code_module) {
   if (!code_module)
     return;
 
+  std::unique_lock<std::mutex> lock(module_table_->mutex);
+  ModuleTable::Entry *entry = module_table_->Find(code_module->code_file());
+  if (entry) {
+    while (entry->loading)
+      module_table_->load_done.wait(lock);
+    entry->module.store(NULL, std::memory_order_seq_cst);
+    entry->corrupt.store(false, std::memory_order_relaxed);
+    // Let the lookups that got the module finish with it.
+    while (entry->holds.load(std::memory_order_seq_cst))
+      std::this_thread::yield();
+  }
+
   ModuleMap::iterator mod_iter = modules_->find(code_module->code_file());
   if (mod_iter != modules_->end()) {
     Module *symbol_module = mod_iter->second;
@@ -284,46 +468,116 @@ void SourceLineResolverBase::UnloadModule(const CodeModule *code_module) {
 }
 
 bool SourceLineResolverBase::HasModule(const CodeModule *module) {
-  if (!module)
-    return false;
-  return modules_->find(module->code_file()) != modules_->end();
+  ModuleTable::Hold hold(module_table_, module);
+  return hold.get() != NULL;
 }
 
 bool SourceLineResolverBase::IsModuleCorrupt(const CodeModule *module) {
-  if (!module)
-    return false;
-  return corrupt_modules_->find(module->code_file()) != corrupt_modules_->end();
+  ModuleTable::Hold hold(module_table_, module);
+  return hold.corrupt();
+}
+
+size_t SourceLineResolverBase::GetModuleMemoryUsage(
+    const CodeModule *module) {
+  ModuleTable::Hold hold(module_table_, module);
+  return hold.get() ? hold.get()->MemoryUsage() : 0;
 }
 
 void SourceLineResolverBase::FillSourceLineInfo(StackFrame *frame) {
-  if (frame->module) {
-    ModuleMap::const_iterator it = modules_->find(frame->module->code_file());
-    if (it != modules_->end()) {
-      it->second->LookupAddress(frame);
+  ModuleTable::Hold hold(module_table_, frame->module);
+  if (hold.get()) {
+    hold.get()->LookupAddress(frame);
+  }
+}
+
+namespace {
+
+// Orders the indexes of addresses by address.
+class AddressOrder {
+ public:
+  explicit AddressOrder(const SourceLineResolverInterface::MemAddr *addresses)
+      : addresses_(addresses) { }
+
+  bool operator()(size_t a, size_t b) const {
+    return addresses_[a] < addresses_[b];
+  }
+
+ private:
+  const SourceLineResolverInterface::MemAddr *addresses_;
+};
+
+}  // namespace
+
+bool SourceLineResolverBase::LookupAddresses(const CodeModule *module,
+                                             const MemAddr *addresses,
+                                             size_t count,
+                                             SourceLineInfo *infos) {
+  ModuleTable::Hold hold(module_table_, module);
+  Module *loaded_module = hold.get();
+  if (!loaded_module) {
+    return false;
+  }
+
+  // Look the addresses up in ascending order, so addresses in the same
+  // function follow one another.  Only a batch that isn't sorted already
+  // needs the order, which is its one allocation.
+  std::vector<size_t> order;
+  if (!std::is_sorted(addresses, addresses + count)) {
+    order.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+      order[i] = i;
     }
+    std::sort(order.begin(), order.end(), AddressOrder(addresses));
+  }
+  loaded_module->LookupAddresses(module->base_address(), addresses,
+                                 order.empty() ? NULL : &order[0], count,
+                                 infos);
+  return true;
+}
+
+void SourceLineResolverBase::FillInlinedFrames(
+    StackFrame *frame, std::vector<StackFrame> *inlined_frames) {
+  ModuleTable::Hold hold(module_table_, frame->module);
+  if (hold.get()) {
+    hold.get()->LookupInlinedFrames(frame, inlined_frames);
   }
 }
 
 WindowsFrameInfo *SourceLineResolverBase::FindWindowsFrameInfo(
     const StackFrame *frame) {
-  if (frame->module) {
-    ModuleMap::const_iterator it = modules_->find(frame->module->code_file());
-    if (it != modules_->end()) {
-      return it->second->FindWindowsFrameInfo(frame);
-    }
-  }
-  return NULL;
+  ModuleTable::Hold hold(module_table_, frame->module);
+  return hold.get() ? hold.get()->FindWindowsFrameInfo(frame) : NULL;
 }
 
 CFIFrameInfo *SourceLineResolverBase::FindCFIFrameInfo(
     const StackFrame *frame) {
-  if (frame->module) {
-    ModuleMap::const_iterator it = modules_->find(frame->module->code_file());
-    if (it != modules_->end()) {
-      return it->second->FindCFIFrameInfo(frame);
-    }
+  ModuleTable::Hold hold(module_table_, frame->module);
+  return hold.get() ? hold.get()->FindCFIFrameInfo(frame) : NULL;
+}
+
+bool SourceLineResolverBase::IsThreadSafe() {
+  return true;
+}
+
+// static
+bool SourceLineResolverBase::SameDebugIdentifier(const string &x,
+                                                 const string &y) {
+  // Identifiers are written in upper or lower case, with or without
+  // dashes, depending on where they come from.
+  size_t i = 0, j = 0;
+  for (;;) {
+    while (i < x.size() && x[i] == '-')
+      ++i;
+    while (j < y.size() && y[j] == '-')
+      ++j;
+    if (i == x.size() || j == y.size())
+      return i == x.size() && j == y.size();
+    if (toupper(static_cast<unsigned char>(x[i])) !=
+        toupper(static_cast<unsigned char>(y[j])))
+      return false;
+    ++i;
+    ++j;
   }
-  return NULL;
 }
 
 bool SourceLineResolverBase::CompareString::operator()(
@@ -331,11 +585,36 @@ bool SourceLineResolverBase::CompareString::operator()(
   return strcmp(s1.c_str(), s2.c_str()) < 0;
 }
 
-bool SourceLineResolverBase::Module::ParseCFIRuleSet(
-    const string &rule_set, CFIFrameInfo *frame_info) const {
-  CFIFrameInfoParseHandler handler(frame_info);
-  CFIRuleParser parser(&handler);
-  return parser.Parse(rule_set);
+CFIFrameInfo *SourceLineResolverBase::Module::GetCFIFrameInfo(
+    MemAddr initial_base, MemAddr initial_size, const char *initial_rules,
+    MemAddr address) const {
+  std::shared_ptr<const CFIRuleSet> rule_set;
+  bool compiled = false;
+  {
+    std::lock_guard<std::mutex> lock(cfi_rule_sets_lock_);
+    std::map<MemAddr, std::shared_ptr<const CFIRuleSet> >::const_iterator it =
+        cfi_rule_sets_.find(initial_base);
+    if (it != cfi_rule_sets_.end()) {
+      rule_set = it->second;
+      compiled = true;
+    }
+  }
+
+  if (!compiled) {
+    // Compile without holding the lock.  If another thread compiles the
+    // same records meanwhile, whichever is cached first is used.
+    std::shared_ptr<CFIRuleSet> new_rule_set(new CFIRuleSet);
+    if (!CompileCFIRuleSet(initial_base, initial_size, initial_rules,
+                           new_rule_set.get()))
+      new_rule_set.reset();
+    std::lock_guard<std::mutex> lock(cfi_rule_sets_lock_);
+    rule_set = cfi_rule_sets_.insert(
+        std::make_pair(initial_base, new_rule_set)).first->second;
+  }
+
+  if (!rule_set)
+    return NULL;
+  return new CFIFrameInfo(rule_set, address);
 }
 
 }  // namespace google_breakpad
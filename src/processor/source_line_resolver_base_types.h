@@ -41,7 +41,11 @@
 #include <stdio.h>
 
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "google_breakpad/common/breakpad_types.h"
 #include "google_breakpad/processor/source_line_resolver_base.h"
@@ -80,9 +84,39 @@ struct SourceLineResolverBase::Line {
   int32_t line;
 };
 
+// The code of a function inlined into a FUNC, or into a function inlined
+// there, as an INLINE record gives it.
+struct SourceLineResolverBase::Inline {
+  Inline() { }
+  Inline(int level, int line, int file_id, int origin)
+      : nest_level(level),
+        call_site_line(line),
+        call_site_file_id(file_id),
+        origin_id(origin),
+        ranges() { }
+
+  // 0 for a function inlined into the FUNC itself, 1 for one inlined into
+  // that, and so on.
+  int32_t nest_level;
+
+  // The source position of the call the inlined code stands for.  The
+  // file id is -1 if the call's file is unknown.
+  int32_t call_site_line;
+  int32_t call_site_file_id;
+
+  // The id of the INLINE_ORIGIN record naming the inlined function.
+  int32_t origin_id;
+
+  // The address and size of each range of the inlined code.
+  std::vector<std::pair<MemAddr, MemAddr> > ranges;
+};
+
+// The name of a Function or PublicSymbol is held by the module: by its
+// arena in a BasicSourceLineResolver::Module, or in the serialized data of
+// a FastSourceLineResolver::Module.
 struct SourceLineResolverBase::Function {
-  Function() { }
-  Function(const string &function_name,
+  Function() : name("") { }
+  Function(const char *function_name,
            MemAddr function_address,
            MemAddr code_size,
            int set_parameter_size,
@@ -90,7 +124,7 @@ struct SourceLineResolverBase::Function {
       : name(function_name), address(function_address), size(code_size),
         parameter_size(set_parameter_size), is_multiple(is_multiple) { }
 
-  string name;
+  const char *name;
   MemAddr address;
   MemAddr size;
 
@@ -102,8 +136,8 @@ struct SourceLineResolverBase::Function {
 };
 
 struct SourceLineResolverBase::PublicSymbol {
-  PublicSymbol() { }
-  PublicSymbol(const string& set_name,
+  PublicSymbol() : name("") { }
+  PublicSymbol(const char *set_name,
                MemAddr set_address,
                int set_parameter_size,
                bool is_multiple)
@@ -112,7 +146,7 @@ struct SourceLineResolverBase::PublicSymbol {
         parameter_size(set_parameter_size),
         is_multiple(is_multiple) {}
 
-  string name;
+  const char *name;
   MemAddr address;
 
   // If the public symbol is used as a function entry point, parameter_size
@@ -140,10 +174,34 @@ class SourceLineResolverBase::Module {
   // undefined, if the symbol data hasn't been loaded yet.
   virtual bool IsCorrupt() const = 0;
 
+  // Returns roughly the bytes of memory the module takes, not counting
+  // the memory buffer it was loaded from, or 0 if unknown.
+  virtual size_t MemoryUsage() const { return 0; }
+
   // Looks up the given relative address, and fills the StackFrame struct
   // with the result.
   virtual void LookupAddress(StackFrame *frame) const = 0;
 
+  // Looks up |count| addresses, in the order addresses[order[0]],
+  // addresses[order[1]], ..., or in the order given if |order| is NULL,
+  // and fills in the matching elements of |infos|.  The addresses and the
+  // bases in |infos| are in the address space where the module is loaded
+  // at |base_address|.  Functions and lines are found by walking forward
+  // from where the previous address's were, so that addresses in
+  // ascending order are merged with them in one pass; PUBLIC symbols,
+  // needed only where no function covers an address, are looked up
+  // individually.
+  virtual void LookupAddresses(MemAddr base_address, const MemAddr *addresses,
+                               const size_t *order, size_t count,
+                               SourceLineInfo *infos) const = 0;
+
+  // Appends a frame for each function inlined at |frame|'s instruction to
+  // |inlined_frames|, innermost first, and moves |frame|'s source position
+  // to the call of the outermost one.  See
+  // SourceLineResolverInterface::FillInlinedFrames.
+  virtual void LookupInlinedFrames(
+      StackFrame *frame, std::vector<StackFrame> *inlined_frames) const = 0;
+
   // If Windows stack walking information is available covering ADDRESS,
   // return a WindowsFrameInfo structure describing it. If the information
   // is not available, returns NULL. A NULL return value does not indicate
@@ -157,9 +215,35 @@ class SourceLineResolverBase::Module {
   // is not available, return NULL. The caller takes ownership of any
   // returned CFIFrameInfo object.
   virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame) const = 0;
+
  protected:
-  virtual bool ParseCFIRuleSet(const string &rule_set,
-                               CFIFrameInfo *frame_info) const;
+  // Returns the rules in effect at |address| of the STACK CFI INIT record
+  // |initial_rules|, covering |initial_size| bytes at |initial_base|, and
+  // the STACK CFI records within it, or NULL if the INIT record does not
+  // parse.  The records are compiled by CompileCFIRuleSet on the first
+  // lookup in the INIT record's range, and the compiled rule set is kept
+  // and shared by all the CFIFrameInfo objects returned for it.
+  CFIFrameInfo *GetCFIFrameInfo(MemAddr initial_base, MemAddr initial_size,
+                                const char *initial_rules,
+                                MemAddr address) const;
+
+  // Adds the rules of the STACK CFI INIT record |initial_rules| and those
+  // of the STACK CFI records in [initial_base, initial_base + initial_size)
+  // to |rule_set|, marking a delta at each STACK CFI record.  Returns false
+  // if the INIT record does not parse.
+  virtual bool CompileCFIRuleSet(MemAddr initial_base, MemAddr initial_size,
+                                 const char *initial_rules,
+                                 CFIRuleSet *rule_set) const {
+    return false;
+  }
+
+ private:
+  // The compiled rule sets, by the base address of their STACK CFI INIT
+  // record; NULL for an INIT record that does not parse.  Guarded by
+  // cfi_rule_sets_lock_.
+  mutable std::map<MemAddr, std::shared_ptr<const CFIRuleSet> >
+      cfi_rule_sets_;
+  mutable std::mutex cfi_rule_sets_lock_;
 };
 
 }  // namespace google_breakpad
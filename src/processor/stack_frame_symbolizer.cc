@@ -36,6 +36,14 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
 #include "common/scoped_ptr.h"
 #include "google_breakpad/processor/code_module.h"
 #include "google_breakpad/processor/code_modules.h"
@@ -43,15 +51,242 @@
 #include "google_breakpad/processor/stack_frame.h"
 #include "google_breakpad/processor/symbol_supplier.h"
 #include "google_breakpad/processor/system_info.h"
+#include "processor/basic_code_module.h"
 #include "processor/linked_ptr.h"
 #include "processor/logging.h"
 
 namespace google_breakpad {
 
+// A readers-writer lock over the resolver's module table and
+// no_symbol_modules_, and a mutex serializing symbol loads.  Waiting writers
+// hold off new readers, so a load is not starved by a steady stream of
+// lookups.
+class StackFrameSymbolizer::Locks {
+ public:
+  Locks() : readers_(0), writers_waiting_(0), writing_(false) { }
+
+  void LockShared() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (writing_ || writers_waiting_)
+      changed_.wait(lock);
+    ++readers_;
+  }
+
+  void UnlockShared() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--readers_ == 0)
+      changed_.notify_all();
+  }
+
+  void Lock() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++writers_waiting_;
+    while (writing_ || readers_)
+      changed_.wait(lock);
+    --writers_waiting_;
+    writing_ = true;
+  }
+
+  void Unlock() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writing_ = false;
+    changed_.notify_all();
+  }
+
+  // Scoped holders of the lock above.  They do nothing if |locks| is NULL.
+  class Shared {
+   public:
+    explicit Shared(Locks* locks) : locks_(locks) {
+      if (locks_) locks_->LockShared();
+    }
+    ~Shared() { if (locks_) locks_->UnlockShared(); }
+
+   private:
+    Locks* locks_;
+  };
+
+  class Exclusive {
+   public:
+    explicit Exclusive(Locks* locks) : locks_(locks) {
+      if (locks_) locks_->Lock();
+    }
+    ~Exclusive() { if (locks_) locks_->Unlock(); }
+
+   private:
+    Locks* locks_;
+  };
+
+  // Held while fetching and loading symbols, so that concurrent misses on
+  // the same module load it only once.
+  std::mutex load_mutex;
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  int readers_;
+  int writers_waiting_;
+  bool writing_;
+};
+
+// The modules loaded through a StackFrameSymbolizer.  Entries are added and
+// removed under an exclusive lock, and used under a shared one, which is
+// enough to update their last use and use count.
+class StackFrameSymbolizer::Cache {
+ public:
+  struct Entry {
+    Entry() : size(0), last_use(0), uses(0) { }
+
+    // A copy of the module, to unload it with.
+    scoped_ptr<const CodeModule> module;
+    size_t size;
+    std::atomic<uint64_t> last_use;
+    std::atomic<uint64_t> uses;
+  };
+
+  // Keyed by code file, as in the resolver.
+  typedef std::map<string, Entry> EntryMap;
+
+  // An entry that may be unloaded, and its place in the eviction order:
+  // lower keys go first.
+  typedef std::pair<uint64_t, uint64_t> EvictionKey;
+  typedef std::pair<EvictionKey, EntryMap::iterator> Candidate;
+
+  Cache()
+      : budget(0), policy(kLeastRecentlyUsed), bytes(0), clock(0), hits(0),
+        misses(0), evictions(0) { }
+
+  void Touch(const string& code_file) {
+    EntryMap::iterator it = entries.find(code_file);
+    if (it != entries.end()) {
+      it->second.last_use.store(++clock, std::memory_order_relaxed);
+      it->second.uses.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  EvictionKey GetEvictionKey(const Entry& entry) const {
+    uint64_t last_use = entry.last_use.load(std::memory_order_relaxed);
+    if (policy == kLeastFrequentlyUsed)
+      return EvictionKey(entry.uses.load(std::memory_order_relaxed), last_use);
+    return EvictionKey(last_use, 0);
+  }
+
+  // Orders candidates for a min-heap on their keys.
+  static bool EvictLater(const Candidate& a, const Candidate& b) {
+    return a.first > b.first;
+  }
+
+  uint64_t budget;
+  SymbolCachePolicy policy;
+  uint64_t bytes;
+  EntryMap entries;
+  std::atomic<uint64_t> clock;
+  std::atomic<uint64_t> hits;
+  std::atomic<uint64_t> misses;
+  std::atomic<uint64_t> evictions;
+};
+
 StackFrameSymbolizer::StackFrameSymbolizer(
     SymbolSupplier* supplier,
     SourceLineResolverInterface* resolver) : supplier_(supplier),
-                                             resolver_(resolver) { }
+                                             resolver_(resolver),
+                                             locks_(new Locks),
+                                             cache_(new Cache) { }
+
+StackFrameSymbolizer::~StackFrameSymbolizer() {
+  delete cache_;
+  delete locks_;
+}
+
+StackFrameSymbolizer::Locks* StackFrameSymbolizer::ResolverLocks() {
+  return resolver_->IsThreadSafe() && !cache_->budget ? NULL : locks_;
+}
+
+void StackFrameSymbolizer::set_symbol_cache_budget(uint64_t bytes) {
+  cache_->budget = bytes;
+}
+
+void StackFrameSymbolizer::set_symbol_cache_policy(SymbolCachePolicy policy) {
+  cache_->policy = policy;
+}
+
+StackFrameSymbolizer::CacheStats StackFrameSymbolizer::GetCacheStats() const {
+  Locks::Shared lock(locks_);
+  CacheStats stats;
+  stats.hits = cache_->hits;
+  stats.misses = cache_->misses;
+  stats.evictions = cache_->evictions;
+  stats.modules = cache_->entries.size();
+  stats.bytes = cache_->bytes;
+  return stats;
+}
+
+void StackFrameSymbolizer::AddToCache(const CodeModule* module, size_t size) {
+  Cache::Entry& added = cache_->entries[module->code_file()];
+  if (!added.module.get()) {
+    added.module.reset(new BasicCodeModule(module));
+    added.size = size;
+    cache_->bytes += size;
+  }
+  added.last_use = ++cache_->clock;
+  ++added.uses;
+
+  if (!cache_->budget || cache_->bytes <= cache_->budget)
+    return;
+
+  // Order the other modules once, in a heap, rather than searching them all
+  // again for each one unloaded.
+  std::vector<Cache::Candidate> candidates;
+  candidates.reserve(cache_->entries.size());
+  for (Cache::EntryMap::iterator it = cache_->entries.begin();
+       it != cache_->entries.end(); ++it) {
+    if (&it->second != &added) {
+      candidates.push_back(
+          Cache::Candidate(cache_->GetEvictionKey(it->second), it));
+    }
+  }
+  std::make_heap(candidates.begin(), candidates.end(), Cache::EvictLater);
+
+  while (cache_->bytes > cache_->budget && !candidates.empty()) {
+    std::pop_heap(candidates.begin(), candidates.end(), Cache::EvictLater);
+    Cache::EntryMap::iterator victim = candidates.back().second;
+    candidates.pop_back();
+
+    const CodeModule* victim_module = victim->second.module.get();
+    resolver_->UnloadModule(victim_module);
+    // The resolver was using the supplier's copy of the symbol data.
+    if (!resolver_->ShouldDeleteMemoryBufferAfterLoadModule())
+      supplier_->FreeSymbolData(victim_module);
+    cache_->bytes -= victim->second.size;
+    ++cache_->evictions;
+    cache_->entries.erase(victim);
+  }
+}
+
+void StackFrameSymbolizer::Reset() {
+  Locks::Exclusive lock(locks_);
+  no_symbol_modules_.clear();
+}
+
+bool StackFrameSymbolizer::FillFromLoadedModule(StackFrame* frame,
+                                                SymbolizerResult* result) {
+  // If module is known to have missing symbol file, return.
+  if (no_symbol_modules_.find(frame->module->code_file()) !=
+      no_symbol_modules_.end()) {
+    *result = kError;
+    return true;
+  }
+
+  // If module is already loaded, go ahead to fill source line info and return.
+  if (resolver_->HasModule(frame->module)) {
+    cache_->Touch(frame->module->code_file());
+    ++cache_->hits;
+    resolver_->FillSourceLineInfo(frame);
+    *result = resolver_->IsModuleCorrupt(frame->module) ?
+        kWarningCorruptSymbols : kNoError;
+    return true;
+  }
+  return false;
+}
 
 StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::FillSourceLineInfo(
     const CodeModules* modules,
@@ -72,25 +307,39 @@ StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::FillSourceLineInfo(
   frame->module = module;
 
   if (!resolver_) return kError;  // no resolver.
-  // If module is known to have missing symbol file, return.
-  if (no_symbol_modules_.find(module->code_file()) !=
-      no_symbol_modules_.end()) {
-    return kError;
-  }
 
-  // If module is already loaded, go ahead to fill source line info and return.
-  if (resolver_->HasModule(frame->module)) {
+  // A thread-safe resolver is asked first, and without locking, as most
+  // frames are in modules that are already loaded.
+  if (!ResolverLocks() && resolver_->HasModule(module)) {
+    ++cache_->hits;
     resolver_->FillSourceLineInfo(frame);
-    return resolver_->IsModuleCorrupt(frame->module) ?
+    return resolver_->IsModuleCorrupt(module) ?
         kWarningCorruptSymbols : kNoError;
   }
 
+  SymbolizerResult result;
+  {
+    Locks::Shared lock(locks_);
+    if (FillFromLoadedModule(frame, &result))
+      return result;
+  }
+
   // Module needs to fetch symbol file. First check to see if supplier exists.
   if (!supplier_) {
     return kError;
   }
 
+  // Another thread may have loaded the module, or found it has no symbols,
+  // while this one waited for its turn.
+  std::lock_guard<std::mutex> load_lock(locks_->load_mutex);
+  {
+    Locks::Shared lock(locks_);
+    if (FillFromLoadedModule(frame, &result))
+      return result;
+  }
+
   // Start fetching symbol from supplier.
+  ++cache_->misses;
   string symbol_file;
   char* symbol_data = NULL;
   size_t symbol_data_size;
@@ -99,28 +348,55 @@ StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::FillSourceLineInfo(
 
   switch (symbol_result) {
     case SymbolSupplier::FOUND: {
-      bool load_success = resolver_->LoadModuleUsingMemoryBuffer(
-          frame->module,
-          symbol_data,
-          symbol_data_size);
+      bool load_success;
+      {
+        Locks::Exclusive lock(ResolverLocks());
+        load_success = resolver_->LoadModuleUsingMemoryBuffer(
+            frame->module,
+            symbol_data,
+            symbol_data_size);
+      }
+      if (load_success) {
+        // Charge the module for the memory its symbols take, and the
+        // symbol data if the resolver keeps it.
+        size_t size;
+        {
+          Locks::Shared lock(ResolverLocks());
+          size = resolver_->GetModuleMemoryUsage(module);
+        }
+        if (!size || !resolver_->ShouldDeleteMemoryBufferAfterLoadModule())
+          size += symbol_data_size;
+        Locks::Exclusive lock(locks_);
+        AddToCache(module, size);
+      } else if (resolver_->IsThreadSafe()) {
+        // A thread-safe resolver may be shared with other symbolizers, one
+        // of which loaded the module first.
+        load_success = resolver_->HasModule(module);
+      }
+      if (!load_success) {
+        Locks::Exclusive lock(locks_);
+        no_symbol_modules_.insert(module->code_file());
+      }
       if (resolver_->ShouldDeleteMemoryBufferAfterLoadModule()) {
         supplier_->FreeSymbolData(module);
       }
 
       if (load_success) {
+        Locks::Shared lock(ResolverLocks());
         resolver_->FillSourceLineInfo(frame);
         return resolver_->IsModuleCorrupt(frame->module) ?
             kWarningCorruptSymbols : kNoError;
       } else {
         BPLOG(ERROR) << "Failed to load symbol file in resolver.";
-        no_symbol_modules_.insert(module->code_file());
         return kError;
       }
     }
 
-    case SymbolSupplier::NOT_FOUND:
+    case SymbolSupplier::NOT_FOUND: {
+      Locks::Exclusive lock(locks_);
       no_symbol_modules_.insert(module->code_file());
       return kError;
+    }
 
     case SymbolSupplier::INTERRUPT:
       return kInterrupt;
@@ -134,12 +410,22 @@ StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::FillSourceLineInfo(
 
 WindowsFrameInfo* StackFrameSymbolizer::FindWindowsFrameInfo(
     const StackFrame* frame) {
-  return resolver_ ? resolver_->FindWindowsFrameInfo(frame) : NULL;
+  if (!resolver_)
+    return NULL;
+  Locks::Shared lock(ResolverLocks());
+  if (frame->module && cache_->budget)
+    cache_->Touch(frame->module->code_file());
+  return resolver_->FindWindowsFrameInfo(frame);
 }
 
 CFIFrameInfo* StackFrameSymbolizer::FindCFIFrameInfo(
     const StackFrame* frame) {
-  return resolver_ ? resolver_->FindCFIFrameInfo(frame) : NULL;
+  if (!resolver_)
+    return NULL;
+  Locks::Shared lock(ResolverLocks());
+  if (frame->module && cache_->budget)
+    cache_->Touch(frame->module->code_file());
+  return resolver_->FindCFIFrameInfo(frame);
 }
 
 }  // namespace google_breakpad
@@ -195,3 +195,68 @@ TEST_F(StackwalkerAddressListTest, ScanWithSymbols) {
   ASSERT_EQ("mod1func1", frames->at(4)->function_name);
   ASSERT_EQ(0x40001000u, frames->at(4)->function_base);
 }
+
+TEST_F(StackwalkerAddressListTest, ScanWithSymbolCacheBudget) {
+  const string module1_symbols = "FUNC 2000 200 10 mod1func2\n"
+                                 "FUNC 1000 300 10 mod1func1\n";
+  const string module2_symbols = "FUNC 3000 100 10 mod2func3\n"
+                                 "FUNC 2000 200 10 mod2func2\n"
+                                 "FUNC 1000 300 10 mod2func1\n";
+  // The resolver parses symbol data in place, so each load gets a fresh copy.
+  size_t size;
+  char *module1_copies[2], *module2_copies[2];
+  for (int i = 0; i < 2; ++i) {
+    module1_copies[i] =
+        supplier.CopySymbolDataAndOwnTheCopy(module1_symbols, &size);
+    module2_copies[i] =
+        supplier.CopySymbolDataAndOwnTheCopy(module2_symbols, &size);
+  }
+  EXPECT_CALL(supplier, GetCStringSymbolData(&module1, NULL, _, _, _))
+    .WillOnce(DoAll(SetArgumentPointee<3>(module1_copies[0]),
+                    SetArgumentPointee<4>(module1_symbols.size() + 1),
+                    Return(MockSymbolSupplier::FOUND)))
+    .WillOnce(DoAll(SetArgumentPointee<3>(module1_copies[1]),
+                    SetArgumentPointee<4>(module1_symbols.size() + 1),
+                    Return(MockSymbolSupplier::FOUND)));
+  EXPECT_CALL(supplier, GetCStringSymbolData(&module2, NULL, _, _, _))
+    .WillOnce(DoAll(SetArgumentPointee<3>(module2_copies[0]),
+                    SetArgumentPointee<4>(module2_symbols.size() + 1),
+                    Return(MockSymbolSupplier::FOUND)))
+    .WillOnce(DoAll(SetArgumentPointee<3>(module2_copies[1]),
+                    SetArgumentPointee<4>(module2_symbols.size() + 1),
+                    Return(MockSymbolSupplier::FOUND)));
+
+  // Only one module's symbols fit at a time.
+  StackFrameSymbolizer frame_symbolizer(&supplier, &resolver);
+  frame_symbolizer.set_symbol_cache_budget(1);
+
+  for (int walk = 0; walk < 2; ++walk) {
+    StackwalkerAddressList walker(kDummyFrames, arraysize(kDummyFrames),
+                                  &modules, &frame_symbolizer);
+    CallStack call_stack;
+    vector<const CodeModule*> modules_without_symbols;
+    vector<const CodeModule*> modules_with_corrupt_symbols;
+    ASSERT_TRUE(walker.Walk(&call_stack, &modules_without_symbols,
+                            &modules_with_corrupt_symbols));
+    ASSERT_EQ(0u, modules_without_symbols.size());
+    ASSERT_NO_FATAL_FAILURE(CheckCallStack(call_stack));
+
+    // Every frame is symbolized, though module2 was unloaded to make room
+    // for module1.
+    const std::vector<StackFrame*>* frames = call_stack.frames();
+    ASSERT_EQ("mod2func3", frames->at(0)->function_name);
+    ASSERT_EQ("mod1func1", frames->at(4)->function_name);
+    ASSERT_FALSE(resolver.HasModule(&module2));
+    ASSERT_TRUE(resolver.HasModule(&module1));
+  }
+
+  StackFrameSymbolizer::CacheStats stats = frame_symbolizer.GetCacheStats();
+  ASSERT_EQ(6u, stats.hits);
+  ASSERT_EQ(4u, stats.misses);
+  ASSERT_EQ(3u, stats.evictions);
+  ASSERT_EQ(1u, stats.modules);
+  // Each module counts for its parsed symbols, which take more memory
+  // than their text.
+  ASSERT_EQ(resolver.GetModuleMemoryUsage(&module1), stats.bytes);
+  ASSERT_LT(module1_symbols.size() + 1, stats.bytes);
+}
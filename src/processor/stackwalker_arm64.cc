@@ -80,37 +80,43 @@ StackFrameARM64* StackwalkerARM64::GetCallerByCFIFrameInfo(
     CFIFrameInfo* cfi_frame_info) {
   StackFrameARM64* last_frame = static_cast<StackFrameARM64*>(frames.back());
 
-  static const char* register_names[] = {
+  // The names STACK CFI rules give the registers, numbered as in the
+  // context, then where FindCallerRegs puts the return address and the
+  // call frame address.
+  static const char* const register_names[] = {
     "x0",  "x1",  "x2",  "x3",  "x4",  "x5",  "x6",  "x7",
     "x8",  "x9",  "x10", "x11", "x12", "x13", "x14", "x15",
     "x16", "x17", "x18", "x19", "x20", "x21", "x22", "x23",
     "x24", "x25", "x26", "x27", "x28", "x29", "x30", "sp",
-    "pc",  NULL
+    "pc",  ".ra", ".cfa"
   };
+  static const int kRegisterCount = MD_CONTEXT_ARM64_GPR_COUNT;
+  static const int kRA = kRegisterCount;
+  static const int kCFA = kRegisterCount + 1;
 
-  // Populate a dictionary with the valid register values in last_frame.
-  CFIFrameInfo::RegisterValueMap<uint64_t> callee_registers;
-  for (int i = 0; register_names[i]; i++) {
+  // Fill a register file with the valid register values in last_frame.
+  PostfixRegisterFile<uint64_t> callee_registers;
+  for (int i = 0; i < kRegisterCount; i++) {
     if (last_frame->context_validity & StackFrameARM64::RegisterValidFlag(i))
-      callee_registers[register_names[i]] = last_frame->context.iregs[i];
+      callee_registers.Set(i, last_frame->context.iregs[i]);
   }
 
   // Use the STACK CFI data to recover the caller's register values.
-  CFIFrameInfo::RegisterValueMap<uint64_t> caller_registers;
-  if (!cfi_frame_info->FindCallerRegs(callee_registers, *memory_,
-                                      &caller_registers)) {
+  PostfixRegisterFile<uint64_t> caller_registers;
+  if (!cfi_frame_info->FindCallerRegs<uint64_t>(
+          register_names, kCFA + 1, callee_registers, *memory_,
+          &caller_registers)) {
     return NULL;
   }
   // Construct a new stack frame given the values the CFI recovered.
   scoped_ptr<StackFrameARM64> frame(new StackFrameARM64());
-  for (int i = 0; register_names[i]; i++) {
-    CFIFrameInfo::RegisterValueMap<uint64_t>::iterator entry =
-      caller_registers.find(register_names[i]);
-    if (entry != caller_registers.end()) {
+  for (int i = 0; i < kRegisterCount; i++) {
+    uint64_t value;
+    if (caller_registers.Get(i, &value)) {
       // We recovered the value of this register; fill the context with the
       // value from caller_registers.
       frame->context_validity |= StackFrameARM64::RegisterValidFlag(i);
-      frame->context.iregs[i] = entry->second;
+      frame->context.iregs[i] = value;
     } else if (19 <= i && i <= 29 && (last_frame->context_validity &
                                       StackFrameARM64::RegisterValidFlag(i))) {
       // If the STACK CFI data doesn't mention some callee-saves register, and
@@ -124,20 +130,18 @@ StackFrameARM64* StackwalkerARM64::GetCallerByCFIFrameInfo(
   }
   // If the CFI doesn't recover the PC explicitly, then use .ra.
   if (!(frame->context_validity & StackFrameARM64::CONTEXT_VALID_PC)) {
-    CFIFrameInfo::RegisterValueMap<uint64_t>::iterator entry =
-      caller_registers.find(".ra");
-    if (entry != caller_registers.end()) {
+    uint64_t ra;
+    if (caller_registers.Get(kRA, &ra)) {
       frame->context_validity |= StackFrameARM64::CONTEXT_VALID_PC;
-      frame->context.iregs[MD_CONTEXT_ARM64_REG_PC] = entry->second;
+      frame->context.iregs[MD_CONTEXT_ARM64_REG_PC] = ra;
     }
   }
   // If the CFI doesn't recover the SP explicitly, then use .cfa.
   if (!(frame->context_validity & StackFrameARM64::CONTEXT_VALID_SP)) {
-    CFIFrameInfo::RegisterValueMap<uint64_t>::iterator entry =
-      caller_registers.find(".cfa");
-    if (entry != caller_registers.end()) {
+    uint64_t cfa;
+    if (caller_registers.Get(kCFA, &cfa)) {
       frame->context_validity |= StackFrameARM64::CONTEXT_VALID_SP;
-      frame->context.iregs[MD_CONTEXT_ARM64_REG_SP] = entry->second;
+      frame->context.iregs[MD_CONTEXT_ARM64_REG_SP] = cfa;
     }
   }
 
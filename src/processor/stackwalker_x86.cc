@@ -43,7 +43,7 @@
 #include "google_breakpad/processor/source_line_resolver_interface.h"
 #include "google_breakpad/processor/stack_frame_cpu.h"
 #include "processor/logging.h"
-#include "processor/postfix_evaluator-inl.h"
+#include "processor/postfix_program.h"
 #include "processor/stackwalker_x86.h"
 #include "processor/windows_frame_info.h"
 #include "processor/cfi_frame_info.h"
@@ -200,23 +200,30 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
     }
   }
 
-  // Set up the dictionary for the PostfixEvaluator.  %ebp, %esp, and sometimes
+  // Set up the registers for the program string.  %ebp, %esp, and sometimes
   // %ebx are used in program strings, and their previous values are known, so
-  // set them here.
-  PostfixEvaluator<uint32_t>::DictionaryType dictionary;
+  // set them here.  The register file is indexed by
+  // WindowsFrameInfo::ProgramRegister, as program strings are compiled.
+  PostfixRegisterFile<uint32_t> registers;
   // Provide the current register values.
-  dictionary["$ebp"] = last_frame->context.ebp;
-  dictionary["$esp"] = last_frame->context.esp;
+  registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_EBP,
+                last_frame->context.ebp);
+  registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_ESP,
+                last_frame->context.esp);
   if (last_frame->context_validity & StackFrameX86::CONTEXT_VALID_EBX)
-    dictionary["$ebx"] = last_frame->context.ebx;
+    registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_EBX,
+                  last_frame->context.ebx);
   // Provide constants from the debug info for last_frame and its callee.
   // .cbCalleeParams is a Breakpad extension that allows us to use the
   // PostfixEvaluator engine when certain types of debugging information
   // are present without having to write the constants into the program
   // string as literals.
-  dictionary[".cbCalleeParams"] = last_frame_callee_parameter_size;
-  dictionary[".cbSavedRegs"] = last_frame_info->saved_register_size;
-  dictionary[".cbLocals"] = last_frame_info->local_size;
+  registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_CB_CALLEE_PARAMS,
+                last_frame_callee_parameter_size);
+  registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_CB_SAVED_REGS,
+                last_frame_info->saved_register_size);
+  registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_CB_LOCALS,
+                last_frame_info->local_size);
 
   uint32_t raSearchStart = last_frame->context.esp +
                            last_frame_callee_parameter_size +
@@ -256,26 +263,28 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
     ScanForReturnAddress(raSearchStart, &raSearchStart, &found, 3);
   }
 
-  dictionary[".cbParams"] = last_frame_info->parameter_size;
+  registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_CB_PARAMS,
+                last_frame_info->parameter_size);
 
   // Decide what type of program string to use. The program string is in
-  // postfix notation and will be passed to PostfixEvaluator::Evaluate.
-  // Given the dictionary and the program string, it is possible to compute
+  // postfix notation and will be evaluated as a PostfixProgram.
+  // Given the registers and the program string, it is possible to compute
   // the return address and the values of other registers in the calling
   // function. Because of bugs described below, the stack may need to be
   // scanned for these values. The results of program string evaluation
   // will be used to determine whether to scan for better values.
-  string program_string;
+  const PostfixProgram *program = &last_frame_info->program;
+  PostfixProgram synthesized_program;
   bool recover_ebp = true;
 
   trust = StackFrame::FRAME_TRUST_CFI;
-  if (!last_frame_info->program_string.empty()) {
+  if (!last_frame_info->program.empty()) {
     // The FPO data has its own program string, which will tell us how to
     // get to the caller frame, and may even fill in the values of
     // nonvolatile registers and provide pointers to local variables and
     // parameters.  In some cases, particularly with program strings that use
-    // .raSearchStart, the stack may need to be scanned afterward.
-    program_string = last_frame_info->program_string;
+    // .raSearchStart, the stack may need to be scanned afterward.  It was
+    // compiled when the symbols were loaded.
   } else if (last_frame_info->allocates_base_pointer) {
     // The function corresponding to the last frame doesn't use the frame
     // pointer for conventional purposes, but it does allocate a new
@@ -312,9 +321,12 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
     // %eip_new = *(%esp_old + callee_params + saved_regs + locals)
     // %ebp_new = *(%esp_old + callee_params + saved_regs - 8)
     // %esp_new = %esp_old + callee_params + saved_regs + locals + 4
-    program_string = "$eip .raSearchStart ^ = "
+    WindowsFrameInfo::CompileProgram(
+        "$eip .raSearchStart ^ = "
         "$ebp $esp .cbCalleeParams + .cbSavedRegs + 8 - ^ = "
-        "$esp .raSearchStart 4 + =";
+        "$esp .raSearchStart 4 + =",
+        &synthesized_program);
+    program = &synthesized_program;
   } else {
     // The function corresponding to the last frame doesn't use %ebp at
     // all.  The callee frame is located relative to %esp.
@@ -341,10 +353,12 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
     // %esp_new = %esp_old + callee_params + saved_regs + locals + 4
     // %ebp_new = %ebp_old
     // %ebx_new = %ebx_old  // If available.
-    program_string = "$eip .raSearchStart ^ = "
-                     "$esp .raSearchStart 4 + =";
+    string program_string = "$eip .raSearchStart ^ = "
+                            "$esp .raSearchStart 4 + =";
     if (last_frame->context_validity & StackFrameX86::CONTEXT_VALID_EBX)
       program_string += " $ebx $ebx =";
+    WindowsFrameInfo::CompileProgram(program_string, &synthesized_program);
+    program = &synthesized_program;
     recover_ebp = false;
   }
 
@@ -360,23 +374,21 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
   // For some more details on this topic, take a look at the following thread:
   // https://groups.google.com/forum/#!topic/google-breakpad-dev/ZP1FA9B1JjM
   if ((StackFrameX86::CONTEXT_VALID_EBP & last_frame->context_validity) != 0 &&
-      program_string.find('@') != string::npos) {
+      program->expression().find('@') != string::npos) {
     raSearchStart = last_frame->context.ebp + 4;
   }
 
   // The difference between raSearch and raSearchStart is unknown,
   // but making them the same seems to work well in practice.
-  dictionary[".raSearchStart"] = raSearchStart;
-  dictionary[".raSearch"] = raSearchStart;
+  registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_RA_SEARCH_START,
+                raSearchStart);
+  registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_RA_SEARCH, raSearchStart);
 
   // Now crank it out, making sure that the program string set at least the
   // two required variables.
-  PostfixEvaluator<uint32_t> evaluator =
-      PostfixEvaluator<uint32_t>(&dictionary, memory_);
-  PostfixEvaluator<uint32_t>::DictionaryValidityType dictionary_validity;
-  if (!evaluator.Evaluate(program_string, &dictionary_validity) ||
-      dictionary_validity.find("$eip") == dictionary_validity.end() ||
-      dictionary_validity.find("$esp") == dictionary_validity.end()) {
+  if (!program->Evaluate(&registers, memory_, static_cast<uint32_t *>(NULL)) ||
+      !registers.assigned(WindowsFrameInfo::PROGRAM_REGISTER_EIP) ||
+      !registers.assigned(WindowsFrameInfo::PROGRAM_REGISTER_ESP)) {
     // Program string evaluation failed. It may be that %eip is not somewhere
     // with stack frame info, and %ebp is pointing to non-stack memory, so
     // our evaluation couldn't succeed. We'll scan the stack for a return
@@ -396,8 +408,8 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
     // This seems like a reasonable return address. Since program string
     // evaluation failed, use it and set %esp to the location above the
     // one where the return address was found.
-    dictionary["$eip"] = eip;
-    dictionary["$esp"] = location + 4;
+    registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_EIP, eip);
+    registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_ESP, location + 4);
     trust = StackFrame::FRAME_TRUST_SCAN;
   }
 
@@ -408,7 +420,8 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
   // However, if program string evaluation resulted in both %eip and
   // %ebp values of 0, trust that the end of the stack has been
   // reached and don't scan for anything else.
-  if (dictionary["$eip"] != 0 || dictionary["$ebp"] != 0) {
+  if (registers.value(WindowsFrameInfo::PROGRAM_REGISTER_EIP) != 0 ||
+      registers.value(WindowsFrameInfo::PROGRAM_REGISTER_EBP) != 0) {
     int offset = 0;
 
     // This scan can only be done if a CodeModules object is available, to
@@ -423,11 +436,13 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
     // ability, older OSes (pre-XP SP2) and CPUs (pre-P4) don't enforce
     // an independent execute privilege on memory pages.
 
-    uint32_t eip = dictionary["$eip"];
+    uint32_t eip = registers.value(WindowsFrameInfo::PROGRAM_REGISTER_EIP);
     if (modules_ && !modules_->GetModuleForAddress(eip)) {
       // The instruction pointer at .raSearchStart was invalid, so start
       // looking one 32-bit word above that location.
-      uint32_t location_start = dictionary[".raSearchStart"] + 4;
+      uint32_t location_start =
+          registers.value(WindowsFrameInfo::PROGRAM_REGISTER_RA_SEARCH_START) +
+          4;
       uint32_t location;
       if (stack_scan_allowed
           && ScanForReturnAddress(location_start, &location, &eip,
@@ -435,8 +450,8 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
         // This is a better return address that what program string
         // evaluation found.  Use it, and set %esp to the location above the
         // one where the return address was found.
-        dictionary["$eip"] = eip;
-        dictionary["$esp"] = location + 4;
+        registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_EIP, eip);
+        registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_ESP, location + 4);
         offset = location - location_start;
         trust = StackFrame::FRAME_TRUST_CFI_SCAN;
       }
@@ -450,7 +465,7 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
       // stack.  The scan is performed from the highest possible address to
       // the lowest, because the expectation is that the function's prolog
       // would have saved %ebp early.
-      uint32_t ebp = dictionary["$ebp"];
+      uint32_t ebp = registers.value(WindowsFrameInfo::PROGRAM_REGISTER_EBP);
 
       // When a scan for return address is used, it is possible to skip one or
       // more frames (when return address is not in a known module).  One
@@ -474,7 +489,7 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
           if (memory_->GetMemoryAtAddress(ebp, &value)) {
             // The candidate value is a pointer to the same memory region
             // (the stack).  Prefer it as a recovered %ebp result.
-            dictionary["$ebp"] = ebp;
+            registers.Set(WindowsFrameInfo::PROGRAM_REGISTER_EBP, ebp);
             break;
           }
         }
@@ -488,25 +503,28 @@ StackFrameX86* StackwalkerX86::GetCallerByWindowsFrameInfo(
 
   frame->trust = trust;
   frame->context = last_frame->context;
-  frame->context.eip = dictionary["$eip"];
-  frame->context.esp = dictionary["$esp"];
-  frame->context.ebp = dictionary["$ebp"];
+  frame->context.eip = registers.value(WindowsFrameInfo::PROGRAM_REGISTER_EIP);
+  frame->context.esp = registers.value(WindowsFrameInfo::PROGRAM_REGISTER_ESP);
+  frame->context.ebp = registers.value(WindowsFrameInfo::PROGRAM_REGISTER_EBP);
   frame->context_validity = StackFrameX86::CONTEXT_VALID_EIP |
                                 StackFrameX86::CONTEXT_VALID_ESP |
                                 StackFrameX86::CONTEXT_VALID_EBP;
 
   // These are nonvolatile (callee-save) registers, and the program string
   // may have filled them in.
-  if (dictionary_validity.find("$ebx") != dictionary_validity.end()) {
-    frame->context.ebx = dictionary["$ebx"];
+  if (registers.assigned(WindowsFrameInfo::PROGRAM_REGISTER_EBX)) {
+    frame->context.ebx =
+        registers.value(WindowsFrameInfo::PROGRAM_REGISTER_EBX);
     frame->context_validity |= StackFrameX86::CONTEXT_VALID_EBX;
   }
-  if (dictionary_validity.find("$esi") != dictionary_validity.end()) {
-    frame->context.esi = dictionary["$esi"];
+  if (registers.assigned(WindowsFrameInfo::PROGRAM_REGISTER_ESI)) {
+    frame->context.esi =
+        registers.value(WindowsFrameInfo::PROGRAM_REGISTER_ESI);
     frame->context_validity |= StackFrameX86::CONTEXT_VALID_ESI;
   }
-  if (dictionary_validity.find("$edi") != dictionary_validity.end()) {
-    frame->context.edi = dictionary["$edi"];
+  if (registers.assigned(WindowsFrameInfo::PROGRAM_REGISTER_EDI)) {
+    frame->context.edi =
+        registers.value(WindowsFrameInfo::PROGRAM_REGISTER_EDI);
     frame->context_validity |= StackFrameX86::CONTEXT_VALID_EDI;
   }
 
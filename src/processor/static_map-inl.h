@@ -36,8 +36,11 @@
 #ifndef PROCESSOR_STATIC_MAP_INL_H__
 #define PROCESSOR_STATIC_MAP_INL_H__
 
+#include <type_traits>
+
 #include "processor/static_map.h"
 #include "processor/static_map_iterator-inl.h"
+#include "processor/static_map_search_index.h"
 #include "processor/logging.h"
 
 namespace google_breakpad {
@@ -45,21 +48,58 @@ namespace google_breakpad {
 template<typename Key, typename Value, typename Compare>
 StaticMap<Key, Value, Compare>::StaticMap(const char* raw_data)
     : raw_data_(raw_data),
+      num_search_levels_(0),
+      search_(0),
       compare_() {
-  // First 4 Bytes store the number of nodes.
-  num_nodes_ = *(reinterpret_cast<const uint32_t*>(raw_data_));
+  // First 4 Bytes store the number of nodes, and whether the keys are
+  // followed by a search index.
+  uint32_t header = *(reinterpret_cast<const uint32_t*>(raw_data_));
+  num_nodes_ = header & ~kStaticMapSearchIndexFlag;
 
   offsets_ = reinterpret_cast<const uint32_t*>(
       raw_data_ + sizeof(num_nodes_));
 
   keys_ = reinterpret_cast<const Key*>(
-      raw_data_ + (1 + num_nodes_) * sizeof(uint32_t));
+      raw_data_ + (1 + static_cast<size_t>(num_nodes_)) * sizeof(uint32_t));
+
+  // The index orders keys as DefaultCompare does.  With any other Compare,
+  // ignore it and binary search the keys.
+  if ((header & kStaticMapSearchIndexFlag) &&
+      SearchIndex::Wanted(num_nodes_) &&
+      std::is_same<Compare, DefaultCompare<Key> >::value) {
+    uint32_t sizes[SearchIndex::kMaxLevels + 1];
+    num_search_levels_ = SearchIndex::LevelSizes(num_nodes_, sizes);
+    search_ = SearchIndex::SearchForCPU();
+    const Key *level = keys_ + sizes[0];
+    for (int i = 0; i < num_search_levels_; ++i) {
+      search_levels_[i] = level;
+      level += sizes[num_search_levels_ - i];
+    }
+  }
+}
+
+template<typename Key, typename Value, typename Compare>
+int StaticMap<Key, Value, Compare>::SearchIndexLowerBound(
+    const Key &key) const {
+  // Every level's padding compares greater than |key| unless |key| is
+  // greater than every key, so check for that first.
+  if (keys_[num_nodes_ - 1] < key)
+    return num_nodes_;
+
+  return search_(search_levels_, num_search_levels_, keys_, key);
 }
 
 // find(), lower_bound() and upper_bound() implement binary search algorithm.
 template<typename Key, typename Value, typename Compare>
 StaticMapIterator<Key, Value, Compare>
 StaticMap<Key, Value, Compare>::find(const Key &key) const {
+  if (num_search_levels_) {
+    int index = SearchIndexLowerBound(key);
+    if (index < num_nodes_ && keys_[index] == key)
+      return IteratorAtIndex(index);
+    return this->end();
+  }
+
   int begin = 0;
   int end = num_nodes_;
   int middle;
@@ -81,6 +121,9 @@ StaticMap<Key, Value, Compare>::find(const Key &key) const {
 template<typename Key, typename Value, typename Compare>
 StaticMapIterator<Key, Value, Compare>
 StaticMap<Key, Value, Compare>::lower_bound(const Key &key) const {
+  if (num_search_levels_)
+    return IteratorAtIndex(SearchIndexLowerBound(key));
+
   int begin = 0;
   int end = num_nodes_;
   int middle;
@@ -102,6 +145,13 @@ StaticMap<Key, Value, Compare>::lower_bound(const Key &key) const {
 template<typename Key, typename Value, typename Compare>
 StaticMapIterator<Key, Value, Compare>
 StaticMap<Key, Value, Compare>::upper_bound(const Key &key) const {
+  if (num_search_levels_) {
+    int index = SearchIndexLowerBound(key);
+    if (index < num_nodes_ && keys_[index] == key)
+      ++index;
+    return IteratorAtIndex(index);
+  }
+
   int begin = 0;
   int end = num_nodes_;
   int middle;
@@ -122,18 +172,23 @@ StaticMap<Key, Value, Compare>::upper_bound(const Key &key) const {
 
 template<typename Key, typename Value, typename Compare>
 bool StaticMap<Key, Value, Compare>::ValidateInMemoryStructure() const {
-  // check the number of nodes is non-negative:
+  // check the number of nodes is non-negative, which it is once the
+  // search index flag is masked off, and that only maps that want a search
+  // index have one:
   if (!raw_data_) return false;
-  int32_t num_nodes = *(reinterpret_cast<const int32_t*>(raw_data_));
-  if (num_nodes < 0) {
-    BPLOG(INFO) << "StaticMap check failed: negative number of nodes";
+  uint32_t header = *(reinterpret_cast<const uint32_t*>(raw_data_));
+  bool has_search_index = (header & kStaticMapSearchIndexFlag) != 0;
+  if (has_search_index && !SearchIndex::Wanted(num_nodes_)) {
+    BPLOG(INFO) << "StaticMap check failed: unexpected search index";
     return false;
   }
 
   int node_index = 0;
   if (num_nodes_) {
-    uint64_t first_offset = sizeof(int32_t) * (num_nodes_ + 1)
-                           + sizeof(Key) * num_nodes_;
+    uint64_t stored_keys = has_search_index ?
+        SearchIndex::StoredKeys(num_nodes_) : num_nodes_;
+    uint64_t first_offset = sizeof(int32_t) * (num_nodes_ + 1ULL)
+                           + sizeof(Key) * stored_keys;
     // Num_nodes_ is too large.
     if (first_offset > 0xffffffffUL) {
       BPLOG(INFO) << "StaticMap check failed: size exceeds limit";
@@ -158,6 +213,61 @@ bool StaticMap<Key, Value, Compare>::ValidateInMemoryStructure() const {
       return false;
     }
   }
+
+  if (num_search_levels_ && !ValidateSearchIndex()) {
+    BPLOG(INFO) << "StaticMap check failed: search index doesn't match keys";
+    return false;
+  }
+  return true;
+}
+
+template<typename Key, typename Value, typename Compare>
+bool StaticMap<Key, Value, Compare>::ValidateInMemoryStructure(
+    uint32_t size) const {
+  if (!raw_data_ || size < sizeof(uint32_t)) return false;
+  uint32_t header = *(reinterpret_cast<const uint32_t*>(raw_data_));
+  bool has_search_index = (header & kStaticMapSearchIndexFlag) != 0;
+  uint64_t stored_keys =
+      has_search_index && SearchIndex::Wanted(num_nodes_) ?
+      SearchIndex::StoredKeys(num_nodes_) : num_nodes_;
+  uint64_t values_offset = sizeof(int32_t) * (num_nodes_ + 1ULL)
+                           + sizeof(Key) * stored_keys;
+  if (values_offset > size) {
+    BPLOG(INFO) << "StaticMap check failed: keys exceed the map's size";
+    return false;
+  }
+  // The offsets are strictly increasing, so only the last can be too big.
+  if (num_nodes_ && offsets_[num_nodes_ - 1] >= size) {
+    BPLOG(INFO) << "StaticMap check failed: value exceeds the map's size";
+    return false;
+  }
+  return ValidateInMemoryStructure();
+}
+
+template<typename Key, typename Value, typename Compare>
+bool StaticMap<Key, Value, Compare>::ValidateSearchIndex() const {
+  uint32_t sizes[SearchIndex::kMaxLevels + 1];
+  SearchIndex::LevelSizes(num_nodes_, sizes);
+  for (uint32_t i = num_nodes_; i < sizes[0]; ++i) {
+    if (keys_[i] != std::numeric_limits<Key>::max())
+      return false;
+  }
+
+  // Each level holds the last key of each block of the one below it.
+  const Key *below = keys_;
+  for (int level = num_search_levels_ - 1; level >= 0; --level) {
+    uint32_t size = sizes[num_search_levels_ - level];
+    uint32_t blocks = sizes[num_search_levels_ - level - 1] /
+                      SearchIndex::kBlockSize;
+    for (uint32_t block = 0; block < size; ++block) {
+      Key expected = block < blocks ?
+          below[(block + 1) * SearchIndex::kBlockSize - 1] :
+          std::numeric_limits<Key>::max();
+      if (search_levels_[level][block] != expected)
+        return false;
+    }
+    below = search_levels_[level];
+  }
   return true;
 }
 
@@ -55,6 +55,11 @@
 // REQUIREMENT: Key type MUST be primitive type or pointers so that:
 // X = sizeof(typename Key);
 //
+// If the top bit of the number of nodes (kStaticMapSearchIndexFlag) is set,
+// the key array is followed by a search index, which lookups use in place
+// of a binary search.  See static_map_search_index.h.  Maps without an
+// index, like all maps serialized before there was one, read as before.
+//
 // Note: since address offset is stored as uint32, user should keep in mind that
 // StaticMap only supports up to 4GB size of memory data.
 
@@ -65,6 +70,7 @@
 #define PROCESSOR_STATIC_MAP_H__
 
 #include "processor/static_map_iterator-inl.h"
+#include "processor/static_map_search_index.h"
 
 namespace google_breakpad {
 
@@ -88,6 +94,9 @@ class StaticMap {
   StaticMap() : raw_data_(0),
                 num_nodes_(0),
                 offsets_(0),
+                keys_(0),
+                num_search_levels_(0),
+                search_(0),
                 compare_() { }
 
   explicit StaticMap(const char* raw_data);
@@ -116,12 +125,28 @@ class StaticMap {
 
   // Checks if the underlying memory data conforms to the predefined pattern:
   // first check the number of nodes is non-negative,
-  // then check both offsets and keys are strictly increasing (sorted).
+  // then check both offsets and keys are strictly increasing (sorted),
+  // and that the search index, if there is one, indexes the keys.
   bool ValidateInMemoryStructure() const;
 
+  // Checks that the map's offsets, keys and search index fit in the |size|
+  // bytes at its raw data, and that each value starts inside them, before
+  // checking the pattern as above.  Use this on untrusted data, where the
+  // map's header may claim more than there is.
+  bool ValidateInMemoryStructure(uint32_t size) const;
+
  private:
+  typedef StaticMapSearchIndex<Key> SearchIndex;
+
   const Key GetKeyAtIndex(int i) const;
 
+  // Returns the index of the first key not less than |key|, using the
+  // search index.
+  int SearchIndexLowerBound(const Key &key) const;
+
+  // Checks the padding and levels of the search index.
+  bool ValidateSearchIndex() const;
+
   // Start address of a raw memory chunk with serialized data.
   const char* raw_data_;
 
@@ -136,6 +161,14 @@ class StaticMap {
   // keys_[i] = key of i_th node
   const Key* keys_;
 
+  // The levels of the search index, top level first, or none if the map
+  // has no index or it can't be used with Compare.
+  int num_search_levels_;
+  const Key* search_levels_[StaticMapSearchIndex<Key>::kMaxLevels];
+
+  // The version of SearchIndex::Search this CPU runs best.
+  typename SearchIndex::SearchFunction search_;
+
   Compare compare_;
 };
 
@@ -36,6 +36,7 @@
 #define PROCESSOR_STATIC_MAP_ITERATOR_INL_H__
 
 #include "processor/static_map_iterator.h"
+#include "processor/static_map_search_index.h"
 
 #include "processor/logging.h"
 
@@ -45,12 +46,20 @@ template<typename Key, typename Value, typename Compare>
 StaticMapIterator<Key, Value, Compare>::StaticMapIterator(const char* base,
                                                             const int &index):
       index_(index), base_(base) {
+  // A default-constructed StaticMap has no data, and no nodes.
+  if (!base_) {
+    num_nodes_ = 0;
+    offsets_ = NULL;
+    keys_ = NULL;
+    return;
+  }
   // See static_map.h for documentation on
   // bytes format of serialized StaticMap data.
-  num_nodes_ = *(reinterpret_cast<const int32_t*>(base_));
+  num_nodes_ = *(reinterpret_cast<const uint32_t*>(base_)) &
+               ~kStaticMapSearchIndexFlag;
   offsets_ = reinterpret_cast<const uint32_t*>(base_ + sizeof(num_nodes_));
   keys_ = reinterpret_cast<const Key*>(
-      base_ + (1 + num_nodes_) * sizeof(num_nodes_));
+      base_ + (1 + static_cast<size_t>(num_nodes_)) * sizeof(num_nodes_));
 }
 
 // Increment & Decrement operators:
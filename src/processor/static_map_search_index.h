@@ -0,0 +1,289 @@
+// Copyright 2026, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+//
+// static_map_search_index.h: The search index of a StaticMap.
+//
+// A StaticMap's keys are sorted, so lookups can binary search them, but a
+// binary search over a large map misses the cache at nearly every step
+// and mispredicts a branch at half of them.  The search index lays the
+// keys out for a search of kBlockSize keys at a time instead.  The keys
+// are padded to a whole number of blocks; the first level of the index
+// holds the greatest key of each block of keys, again padded; the next
+// level holds the greatest key of each block of the first, and so on, up
+// to a top level of a single block.  A search counts the keys less than
+// the one it looks for in one block per level, which takes no branches,
+// and reads one cache line per level for 8-byte keys.
+//
+// The index follows the keys in the serialized data: the padding of the
+// keys, then the levels, top level first.  Padding is the greatest value
+// of Key, so only maps of integer keys ordered by DefaultCompare can have
+// an index.  See static_map.h for how a map says it has one.
+
+#ifndef PROCESSOR_STATIC_MAP_SEARCH_INDEX_H__
+#define PROCESSOR_STATIC_MAP_SEARCH_INDEX_H__
+
+#include <limits>
+
+#include "google_breakpad/common/breakpad_types.h"
+
+// The vector versions of CountLess, and the searches using them, are
+// compiled for their instruction set whatever the compiler's target, and
+// picked at run time.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STATIC_MAP_SEARCH_INDEX_X86
+#include <immintrin.h>
+#endif
+
+namespace google_breakpad {
+
+// Set in the node count of a serialized StaticMap whose keys are followed
+// by a search index.
+static const uint32_t kStaticMapSearchIndexFlag = 0x80000000U;
+
+template<typename Key>
+class StaticMapSearchIndex {
+ public:
+  // The number of keys a search compares at once.
+  static const uint32_t kBlockSize = 8;
+
+  // The most levels an index of fewer than 2^31 keys can have.
+  static const int kMaxLevels = 11;
+
+  // Returns true if a map of |num_nodes| keys should have an index: one
+  // whose keys don't fit in a single block.
+  static bool Wanted(uint32_t num_nodes) {
+    return std::numeric_limits<Key>::is_integer && num_nodes > kBlockSize;
+  }
+
+  // Sets |sizes| to the padded number of keys, followed by the size of
+  // each level of the index from the bottom up, for a map of |num_nodes|
+  // keys.  Returns the number of levels.
+  static int LevelSizes(uint32_t num_nodes, uint32_t sizes[kMaxLevels + 1]) {
+    sizes[0] = RoundUp(num_nodes);
+    int levels = 0;
+    while (sizes[levels] > kBlockSize && levels < kMaxLevels) {
+      sizes[levels + 1] = RoundUp(sizes[levels] / kBlockSize);
+      ++levels;
+    }
+    return levels;
+  }
+
+  // Returns the number of keys, including the index, that a map of
+  // |num_nodes| keys with an index stores.
+  static uint64_t StoredKeys(uint32_t num_nodes) {
+    uint32_t sizes[kMaxLevels + 1];
+    int levels = LevelSizes(num_nodes, sizes);
+    uint64_t keys = 0;
+    for (int level = 0; level <= levels; ++level)
+      keys += sizes[level];
+    return keys;
+  }
+
+  // Writes the index of the |num_nodes| sorted keys at |keys| after them.
+  static void Write(Key *keys, uint32_t num_nodes) {
+    uint32_t sizes[kMaxLevels + 1];
+    int levels = LevelSizes(num_nodes, sizes);
+    for (uint32_t i = num_nodes; i < sizes[0]; ++i)
+      keys[i] = std::numeric_limits<Key>::max();
+
+    // Each level holds the last key of each block of the one below it.
+    Key *below = keys;
+    Key *level = keys + StoredKeys(num_nodes);
+    for (int i = 1; i <= levels; ++i) {
+      level -= sizes[i];
+      uint32_t blocks = sizes[i - 1] / kBlockSize;
+      for (uint32_t block = 0; block < sizes[i]; ++block) {
+        level[block] = block < blocks ?
+            below[block * kBlockSize + kBlockSize - 1] :
+            std::numeric_limits<Key>::max();
+      }
+      below = level;
+    }
+  }
+
+  // Returns the number of the kBlockSize keys at |block| that are less
+  // than |key|.
+  static uint32_t CountLess(const Key *block, const Key &key) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < kBlockSize; ++i)
+      count += block[i] < key;
+    return count;
+  }
+
+  // Returns the index of the first of the keys at |keys| not less than
+  // |key|, counting with |count_less| in one block of each of the
+  // |num_levels| levels at |levels|, top level first.  |key| must not be
+  // greater than the last key.
+  template<uint32_t (*count_less)(const Key *block, const Key &key)>
+  static uint32_t Search(const Key *const *levels, int num_levels,
+                         const Key *keys, const Key &key) {
+    // |block| is the block of the next level down that holds the first key
+    // not less than |key|.
+    uint32_t block = 0;
+    for (int level = 0; level < num_levels; ++level) {
+      block = block * kBlockSize +
+              count_less(levels[level] + block * kBlockSize, key);
+    }
+    return block * kBlockSize + count_less(keys + block * kBlockSize, key);
+  }
+
+  typedef uint32_t (*SearchFunction)(const Key *const *levels, int num_levels,
+                                     const Key *keys, const Key &key);
+
+  // Returns the fastest version of Search the CPU can run.
+  static SearchFunction SearchForCPU() { return &Search<CountLess>; }
+
+ private:
+  static uint32_t RoundUp(uint32_t count) {
+    return (count + kBlockSize - 1) / kBlockSize * kBlockSize;
+  }
+};
+
+// Vector versions of CountLess for the keys StaticMaps have: addresses
+// and source file ids.
+#ifdef STATIC_MAP_SEARCH_INDEX_X86
+namespace static_map_search_index {
+
+__attribute__((target("avx2")))
+inline uint32_t CountLessAVX2(const uint64_t *block, const uint64_t &key) {
+  // AVX2 compares signed integers; flip the sign bits to compare unsigned.
+  const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+  __m256i k = _mm256_xor_si256(_mm256_set1_epi64x(key), sign);
+  __m256i low = _mm256_xor_si256(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block)), sign);
+  __m256i high = _mm256_xor_si256(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 4)), sign);
+  int less =
+      _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(k, low))) |
+      _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(k, high)))
+          << 4;
+  return __builtin_popcount(less);
+}
+
+__attribute__((target("sse4.2")))
+inline uint32_t CountLessSSE42(const uint64_t *block, const uint64_t &key) {
+  // SSE4.2 compares signed integers; flip the sign bits to compare
+  // unsigned.
+  const __m128i sign = _mm_set1_epi64x(INT64_MIN);
+  __m128i k = _mm_xor_si128(_mm_set1_epi64x(key), sign);
+  int less = 0;
+  for (int i = 0; i < 4; ++i) {
+    __m128i keys = _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 2 * i)),
+        sign);
+    less |= _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(k, keys)))
+            << (2 * i);
+  }
+  return __builtin_popcount(less);
+}
+
+__attribute__((target("avx2")))
+inline uint32_t CountLessAVX2(const int32_t *block, const int32_t &key) {
+  __m256i keys = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+  __m256i less = _mm256_cmpgt_epi32(_mm256_set1_epi32(key), keys);
+  return __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(less)));
+}
+
+__attribute__((target("sse2")))
+inline uint32_t CountLessSSE2(const int32_t *block, const int32_t &key) {
+  __m128i k = _mm_set1_epi32(key);
+  __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+  __m128i high =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 4));
+  int less = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, low))) |
+             _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, high))) << 4;
+  return __builtin_popcount(less);
+}
+
+// Search can't inline a kernel built for another target on its own, so
+// each search is flattened into one function of the kernel's target.
+__attribute__((target("avx2"), flatten))
+inline uint32_t SearchAVX2(const uint64_t *const *levels, int num_levels,
+                           const uint64_t *keys, const uint64_t &key) {
+  return StaticMapSearchIndex<uint64_t>::Search<CountLessAVX2>(
+      levels, num_levels, keys, key);
+}
+
+__attribute__((target("sse4.2"), flatten))
+inline uint32_t SearchSSE42(const uint64_t *const *levels, int num_levels,
+                            const uint64_t *keys, const uint64_t &key) {
+  return StaticMapSearchIndex<uint64_t>::Search<CountLessSSE42>(
+      levels, num_levels, keys, key);
+}
+
+__attribute__((target("avx2"), flatten))
+inline uint32_t SearchAVX2(const int32_t *const *levels, int num_levels,
+                           const int32_t *keys, const int32_t &key) {
+  return StaticMapSearchIndex<int32_t>::Search<CountLessAVX2>(
+      levels, num_levels, keys, key);
+}
+
+__attribute__((target("sse2"), flatten))
+inline uint32_t SearchSSE2(const int32_t *const *levels, int num_levels,
+                           const int32_t *keys, const int32_t &key) {
+  return StaticMapSearchIndex<int32_t>::Search<CountLessSSE2>(
+      levels, num_levels, keys, key);
+}
+
+}  // namespace static_map_search_index
+
+// The CPU is asked once per key type, the first time a map is read.
+template<>
+inline StaticMapSearchIndex<uint64_t>::SearchFunction
+StaticMapSearchIndex<uint64_t>::SearchForCPU() {
+  static const SearchFunction search = []() -> SearchFunction {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      return &static_map_search_index::SearchAVX2;
+    if (__builtin_cpu_supports("sse4.2"))
+      return &static_map_search_index::SearchSSE42;
+    return &Search<CountLess>;
+  }();
+  return search;
+}
+
+template<>
+inline StaticMapSearchIndex<int32_t>::SearchFunction
+StaticMapSearchIndex<int32_t>::SearchForCPU() {
+  static const SearchFunction search = []() -> SearchFunction {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      return &static_map_search_index::SearchAVX2;
+    if (__builtin_cpu_supports("sse2"))
+      return &static_map_search_index::SearchSSE2;
+    return &Search<CountLess>;
+  }();
+  return search;
+}
+#endif  // STATIC_MAP_SEARCH_INDEX_X86
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_STATIC_MAP_SEARCH_INDEX_H__
@@ -47,10 +47,14 @@ template<typename Key, typename Value>
 class SimpleMapSerializer {
  public:
   static char* Serialize(const std::map<Key, Value> &stdmap,
-                   unsigned int* size = NULL) {
-    unsigned int size_per_node =
-        sizeof(uint32_t) + sizeof(Key) + sizeof(Value);
-    unsigned int memsize = sizeof(int32_t) + size_per_node * stdmap.size();
+                   unsigned int* size = NULL, bool search_index = false) {
+    typedef google_breakpad::StaticMapSearchIndex<Key> SearchIndex;
+    search_index = search_index && SearchIndex::Wanted(stdmap.size());
+    unsigned int stored_keys = search_index ?
+        SearchIndex::StoredKeys(stdmap.size()) : stdmap.size();
+    unsigned int size_per_node = sizeof(uint32_t) + sizeof(Value);
+    unsigned int memsize = sizeof(int32_t) + size_per_node * stdmap.size() +
+                           sizeof(Key) * stored_keys;
     if (size) *size = memsize;
 
     // Allocate memory for serialized data:
@@ -58,16 +62,17 @@ class SimpleMapSerializer {
     char* address = mem;
 
     // Writer the number of nodes:
-    new (address) uint32_t(static_cast<uint32_t>(stdmap.size()));
+    new (address) uint32_t(static_cast<uint32_t>(stdmap.size()) |
+        (search_index ? google_breakpad::kStaticMapSearchIndexFlag : 0));
     address += sizeof(uint32_t);
 
     // Nodes' offset:
     uint32_t* offsets = reinterpret_cast<uint32_t*>(address);
     address += sizeof(uint32_t) * stdmap.size();
 
-    // Keys:
+    // Keys, and the search index:
     Key* keys = reinterpret_cast<Key*>(address);
-    address += sizeof(Key) * stdmap.size();
+    address += sizeof(Key) * stored_keys;
 
     // Traversing map:
     typename std::map<Key, Value>::const_iterator iter = stdmap.begin();
@@ -77,6 +82,8 @@ class SimpleMapSerializer {
       new (address) Value(iter->second);
       address += sizeof(Value);
     }
+    if (search_index)
+      SearchIndex::Write(keys, stdmap.size());
     return mem;
   }
 };
@@ -379,6 +386,67 @@ TEST_F(TestValidMap, Test1000RandomElements) {
   LookupTester(test_case);
 }
 
+TEST_F(TestValidMap, TestSearchIndex) {
+  for (int test_case = 0; test_case < kNumberTestCases; ++test_case) {
+    ::operator delete(map_data[test_case]);
+    map_data[test_case] =
+        serializer.Serialize(std_map[test_case], &size[test_case], true);
+    test_map[test_case] = TestMap(map_data[test_case]);
+
+    // Only maps of more than one block of keys get an index.
+    uint32_t header = *reinterpret_cast<uint32_t*>(map_data[test_case]);
+    ASSERT_EQ(std_map[test_case].size() > 8,
+              (header & google_breakpad::kStaticMapSearchIndexFlag) != 0);
+    ASSERT_TRUE(test_map[test_case].ValidateInMemoryStructure());
+    ASSERT_EQ(std_map[test_case].size(), test_map[test_case].size());
+
+    IteratorTester(test_case);
+    LookupTester(test_case);
+  }
+
+  // An index that doesn't match its keys.
+  int test_case = 3;
+  KeyType* keys = reinterpret_cast<KeyType*>(map_data[test_case] +
+      (1 + std_map[test_case].size()) * sizeof(uint32_t));
+  keys[std_map[test_case].size() + 8] += 1;
+  ASSERT_FALSE(test_map[test_case].ValidateInMemoryStructure());
+}
+
+// The version of Search picked for this CPU finds what the scalar one
+// does, for the key types that have vector versions.
+template<typename Key>
+void SearchTester(const Key *values, size_t count) {
+  typedef google_breakpad::StaticMapSearchIndex<Key> SearchIndex;
+  typename SearchIndex::SearchFunction search = SearchIndex::SearchForCPU();
+  Key keys[SearchIndex::kBlockSize];
+  for (size_t first = 0; first + SearchIndex::kBlockSize <= count; ++first) {
+    // Search expects sorted keys, but counts in a block whatever its order.
+    for (uint32_t i = 0; i < SearchIndex::kBlockSize; ++i)
+      keys[i] = values[first + i];
+    for (size_t key = 0; key < count; ++key) {
+      ASSERT_EQ(
+          (SearchIndex::template Search<SearchIndex::CountLess>(
+              NULL, 0, keys, values[key])),
+          search(NULL, 0, keys, values[key]));
+    }
+  }
+}
+
+TEST(TestSearchIndexSearch, MatchesScalar) {
+  const uint64_t addresses[] = {
+    0, 1, 0x7fffffffffffffffULL, 0x8000000000000000ULL,
+    0x8000000000000001ULL, 0xfffffffffffffffeULL, 0xffffffffffffffffULL,
+    0x1000, 0x400000, 0x7f0000001000ULL, 0xffffffff80000000ULL
+  };
+  SearchTester(addresses, sizeof(addresses) / sizeof(addresses[0]));
+
+  const int32_t ids[] = {
+    INT32_MIN, INT32_MIN + 1, -2, -1, 0, 1, 2, 1000, INT32_MAX - 1,
+    INT32_MAX, 77
+  };
+  SearchTester(ids, sizeof(ids) / sizeof(ids[0]));
+}
+
 int main(int argc, char *argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
 
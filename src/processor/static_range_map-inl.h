@@ -36,6 +36,8 @@
 #ifndef PROCESSOR_STATIC_RANGE_MAP_INL_H__
 #define PROCESSOR_STATIC_RANGE_MAP_INL_H__
 
+#include <algorithm>
+
 #include "processor/static_range_map.h"
 #include "processor/logging.h"
 
@@ -101,6 +103,82 @@ bool StaticRangeMap<AddressType, EntryType>::RetrieveNearestRange(
   return true;
 }
 
+
+template<typename AddressType, typename EntryType>
+int StaticRangeMap<AddressType, EntryType>::LowerBoundFrom(
+    const AddressType &address, int *cursor) const {
+  // Every range before |index| ends below |address|.
+  int size = map_.size();
+  int index = *cursor;
+  if (index > size ||
+      (index > 0 && !(map_.IteratorAtIndex(index - 1).GetKey() < address)))
+    index = 0;
+  int step = 1;
+  while (index + step <= size &&
+         map_.IteratorAtIndex(index + step - 1).GetKey() < address) {
+    index += step;
+    step *= 2;
+  }
+  int end = std::min(index + step, size);
+  while (index < end) {
+    int middle = index + (end - index) / 2;
+    if (map_.IteratorAtIndex(middle).GetKey() < address)
+      index = middle + 1;
+    else
+      end = middle;
+  }
+  *cursor = index;
+  return index;
+}
+
+
+// static
+template<typename AddressType, typename EntryType>
+void StaticRangeMap<AddressType, EntryType>::GetRange(
+    const MapConstIterator &iterator, const EntryType *&entry,
+    AddressType *entry_base, AddressType *entry_size) {
+  const Range *range = iterator.GetValuePtr();
+  entry = range->entryptr();
+  if (entry_base)
+    *entry_base = range->base();
+  if (entry_size)
+    *entry_size = iterator.GetKey() - range->base() + 1;
+}
+
+
+template<typename AddressType, typename EntryType>
+bool StaticRangeMap<AddressType, EntryType>::RetrieveRangeFrom(
+    const AddressType &address, int *cursor, const EntryType *&entry,
+    AddressType *entry_base, AddressType *entry_size) const {
+  int index = LowerBoundFrom(address, cursor);
+  if (index == static_cast<int>(map_.size()))
+    return false;
+  MapConstIterator iterator = map_.IteratorAtIndex(index);
+  if (address < iterator.GetValuePtr()->base())
+    return false;
+  GetRange(iterator, entry, entry_base, entry_size);
+  return true;
+}
+
+
+template<typename AddressType, typename EntryType>
+bool StaticRangeMap<AddressType, EntryType>::RetrieveNearestRangeFrom(
+    const AddressType &address, int *cursor, const EntryType *&entry,
+    AddressType *entry_base, AddressType *entry_size) const {
+  int index = LowerBoundFrom(address, cursor);
+  // If |address| isn't within the lower bound, the nearest range below it
+  // is the one before.
+  if (index == static_cast<int>(map_.size()) ||
+      address < map_.IteratorAtIndex(index).GetValuePtr()->base()) {
+    if (index == 0)
+      return false;
+    --index;
+  }
+  GetRange(map_.IteratorAtIndex(index), entry, entry_base, entry_size);
+  return true;
+}
+
+
 template<typename AddressType, typename EntryType>
 bool StaticRangeMap<AddressType, EntryType>::RetrieveRangeAtIndex(
     int index, const EntryType *&entry,
@@ -67,6 +67,21 @@ class StaticRangeMap {
                             AddressType *entry_base, AddressType *entry_size)
                             const;
 
+  // RetrieveRange and RetrieveNearestRange, for a series of addresses
+  // looked up in ascending order.  |*cursor| is where the previous lookup
+  // left off, and must be 0 before the first one.  Each lookup searches
+  // forward from there, in steps that double and then by bisection, so
+  // that m sorted lookups among n ranges cost O(m log(n/m)) rather than
+  // O(m log n).  An address lower than the one before starts over from
+  // the first range.
+  bool RetrieveRangeFrom(const AddressType &address, int *cursor,
+                         const EntryType *&entry, AddressType *entry_base,
+                         AddressType *entry_size) const;
+  bool RetrieveNearestRangeFrom(const AddressType &address, int *cursor,
+                                const EntryType *&entry,
+                                AddressType *entry_base,
+                                AddressType *entry_size) const;
+
   // Treating all ranges as a list ordered by the address spaces that they
   // occupy, locates the range at the index specified by index.  Returns
   // false if index is larger than the number of ranges stored.  entry_base
@@ -98,6 +113,17 @@ class StaticRangeMap {
   typedef StaticMap<AddressType, Range> AddressToRangeMap;
   typedef typename AddressToRangeMap::const_iterator MapConstIterator;
 
+  // Returns the index of the first range whose high address is at or above
+  // |address|, searching forward from the index |*cursor|, and sets
+  // |*cursor| to it.  See RetrieveRangeFrom.
+  int LowerBoundFrom(const AddressType &address, int *cursor) const;
+
+  // Sets the entry, base and size of the range at |iterator| in the manner
+  // of RetrieveRange.
+  static void GetRange(const MapConstIterator &iterator,
+                       const EntryType *&entry, AddressType *entry_base,
+                       AddressType *entry_size);
+
   AddressToRangeMap map_;
 };
 
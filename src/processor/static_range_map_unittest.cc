@@ -31,6 +31,8 @@
 //
 // Author: Siyang Xie (lambxsy@google.com)
 
+#include <stdlib.h>
+
 #include "breakpad_googletest_includes.h"
 #include "common/scoped_ptr.h"
 #include "processor/range_map-inl.h"
@@ -412,6 +414,53 @@ TEST_F(TestStaticRangeMap, RunTestCase0Again) {
   RunTestCase(test_case);
 }
 
+TEST_F(TestStaticRangeMap, CursorLookups) {
+  // Ranges 10 to 19, 30 to 39, ... 1990 to 1999.
+  scoped_ptr<RMap> rmap(new RMap());
+  for (int id = 0; id < 100; ++id)
+    ASSERT_TRUE(rmap->StoreRange(20 * id + 10, 10, id));
+  scoped_array<char> memaddr(serializer_.Serialize(*rmap, NULL));
+  TestMap static_range_map(memaddr.get());
+
+  // Ascending runs with small and large strides, and runs that go back.
+  const int kStrides[] = { 1, 7, 20, 333, -1, -45 };
+  for (int i = 0; i < 6; ++i) {
+    int stride = kStrides[i];
+    int range_cursor = 0;
+    int nearest_cursor = 0;
+    for (int step = 0; step * abs(stride) < 2020; ++step) {
+      AddressType address = stride > 0 ? step * stride : 2019 + step * stride;
+
+      const EntryType* expected = NULL;
+      const EntryType* entry = NULL;
+      bool expected_found = static_range_map.RetrieveRange(address, expected,
+                                                           NULL, NULL);
+      EXPECT_EQ(expected_found,
+                static_range_map.RetrieveRangeFrom(address, &range_cursor,
+                                                   entry, NULL, NULL))
+          << "RetrieveRangeFrom stride " << stride << ", address " << address;
+      if (expected_found)
+        EXPECT_EQ(expected, entry) << "RetrieveRangeFrom stride " << stride
+                                   << ", address " << address;
+
+      AddressType expected_base, base;
+      expected_found = static_range_map.RetrieveNearestRange(
+          address, expected, &expected_base, NULL);
+      EXPECT_EQ(expected_found,
+                static_range_map.RetrieveNearestRangeFrom(
+                    address, &nearest_cursor, entry, &base, NULL))
+          << "RetrieveNearestRangeFrom stride " << stride << ", address "
+          << address;
+      if (expected_found) {
+        EXPECT_EQ(expected, entry) << "RetrieveNearestRangeFrom stride "
+                                   << stride << ", address " << address;
+        EXPECT_EQ(expected_base, base) << "RetrieveNearestRangeFrom stride "
+                                       << stride << ", address " << address;
+      }
+    }
+  }
+}
+
 }  // namespace google_breakpad
 
 int main(int argc, char *argv[]) {
@@ -47,6 +47,7 @@
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
 #include "processor/logging.h"
+#include "processor/postfix_program.h"
 #include "processor/tokenize.h"
 
 namespace google_breakpad {
@@ -77,6 +78,25 @@ struct WindowsFrameInfo {
     STACK_INFO_UNKNOWN = -1
   };
 
+  // The registers and constants StackwalkerX86 provides to program
+  // strings, numbered as PostfixProgram numbers them when program strings
+  // are compiled.
+  enum ProgramRegister {
+    PROGRAM_REGISTER_EIP = 0,
+    PROGRAM_REGISTER_ESP,
+    PROGRAM_REGISTER_EBP,
+    PROGRAM_REGISTER_EBX,
+    PROGRAM_REGISTER_ESI,
+    PROGRAM_REGISTER_EDI,
+    PROGRAM_REGISTER_CB_CALLEE_PARAMS,
+    PROGRAM_REGISTER_CB_SAVED_REGS,
+    PROGRAM_REGISTER_CB_LOCALS,
+    PROGRAM_REGISTER_CB_PARAMS,
+    PROGRAM_REGISTER_RA_SEARCH_START,
+    PROGRAM_REGISTER_RA_SEARCH,
+    PROGRAM_REGISTER_COUNT
+  };
+
   WindowsFrameInfo() : type_(STACK_INFO_UNKNOWN),
                      valid(VALID_NONE),
                      prolog_size(0),
@@ -86,7 +106,8 @@ struct WindowsFrameInfo {
                      local_size(0),
                      max_stack_size(0),
                      allocates_base_pointer(0),
-                     program_string() {}
+                     program_string(),
+                     program() {}
 
   WindowsFrameInfo(StackInfoTypes type,
                  uint32_t set_prolog_size,
@@ -106,7 +127,10 @@ struct WindowsFrameInfo {
         local_size(set_local_size),
         max_stack_size(set_max_stack_size),
         allocates_base_pointer(set_allocates_base_pointer),
-        program_string(set_program_string) {}
+        program_string(set_program_string),
+        program() {
+    CompileProgram(program_string, &program);
+  }
 
   // Parse a textual serialization of a WindowsFrameInfo object from
   // a string. Returns NULL if parsing fails, or a new object
@@ -171,6 +195,7 @@ struct WindowsFrameInfo {
     max_stack_size = that.max_stack_size;
     allocates_base_pointer = that.allocates_base_pointer;
     program_string = that.program_string;
+    program = that.program;
   }
 
   // Clears the WindowsFrameInfo object so that users will see it as though
@@ -179,6 +204,19 @@ struct WindowsFrameInfo {
     type_ = STACK_INFO_UNKNOWN;
     valid = VALID_NONE;
     program_string.erase();
+    program = PostfixProgram();
+  }
+
+  // Compiles the program string |program_string| into *program, numbering
+  // the registers it names as ProgramRegister does.
+  static void CompileProgram(const string &program_string,
+                             PostfixProgram *program) {
+    static const char *const kRegisterNames[PROGRAM_REGISTER_COUNT] = {
+      "$eip", "$esp", "$ebp", "$ebx", "$esi", "$edi",
+      ".cbCalleeParams", ".cbSavedRegs", ".cbLocals", ".cbParams",
+      ".raSearchStart", ".raSearch"
+    };
+    program->Compile(program_string, kRegisterNames, PROGRAM_REGISTER_COUNT);
   }
 
   StackInfoTypes type_;
@@ -201,6 +239,11 @@ struct WindowsFrameInfo {
   // If program_string is empty, use allocates_base_pointer.
   bool allocates_base_pointer;
   string program_string;
+
+  // program_string, compiled when the WindowsFrameInfo is constructed, so
+  // that walking a stack evaluates it without parsing it again.  Code that
+  // changes program_string must recompile it with CompileProgram.
+  PostfixProgram program;
 };
 
 }  // namespace google_breakpad
@@ -29,24 +29,68 @@
 
 #include <paths.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #include <cstring>
 #include <iostream>
+#include <streambuf>
 #include <string>
 #include <vector>
 
 #include "common/linux/dump_symbols.h"
+#include "common/scoped_ptr.h"
+#include "processor/module_serializer.h"
 
+using google_breakpad::ModuleSerializer;
 using google_breakpad::WriteSymbolFile;
 using google_breakpad::WriteSymbolFileHeader;
+using google_breakpad::scoped_array;
+
+namespace {
+
+// A stream buffer that collects everything written to it in one vector,
+// so that the text symbol file can be loaded where it was written.
+class VectorStreamBuf : public std::streambuf {
+ public:
+  explicit VectorStreamBuf(std::vector<char>* data) : data_(data) { }
+
+ protected:
+  virtual int_type overflow(int_type c) {
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+      data_->push_back(traits_type::to_char_type(c));
+    return traits_type::not_eof(c);
+  }
+  virtual std::streamsize xsputn(const char* s, std::streamsize n) {
+    data_->insert(data_->end(), s, s + n);
+    return n;
+  }
+
+ private:
+  std::vector<char>* data_;
+};
+
+}  // namespace
 
 int usage(const char* self) {
   fprintf(stderr, "Usage: %s [OPTION] <binary-with-debugging-info> "
           "[directories-for-debug-file]\n\n", self);
   fprintf(stderr, "Options:\n");
   fprintf(stderr, "  -i:   Output module header information only.\n");
+  fprintf(stderr, "  -b    Output a binary symbol file, which "
+          "FastSourceLineResolver\n"
+          "        can use without parsing it\n");
   fprintf(stderr, "  -c    Do not generate CFI section\n");
+  fprintf(stderr, "  -d    Generate INLINE and INLINE_ORIGIN records for "
+          "inlined code;\n"
+          "        binary symbol files can't hold them, so not with -b\n");
+  fprintf(stderr, "  -j N  Read debugging information, and with -b load "
+          "the text\n"
+          "        symbol file, on N threads; the default is one per "
+          "processor\n");
+  fprintf(stderr, "  -m MB Keep at most about MB megabytes of functions in "
+          "memory,\n"
+          "        spilling the rest and all CFI to temporary files\n");
   fprintf(stderr, "  -r    Do not handle inter-compilation unit references\n");
   fprintf(stderr, "  -v    Print all warnings to stderr\n");
   return 1;
@@ -56,16 +100,32 @@ int main(int argc, char **argv) {
   if (argc < 2)
     return usage(argv[0]);
   bool header_only = false;
+  bool binary_output = false;
   bool cfi = true;
   bool handle_inter_cu_refs = true;
+  bool handle_inlines = false;
   bool log_to_stderr = false;
+  unsigned int threads = 0;
+  size_t memory_budget = 0;
   int arg_index = 1;
   while (arg_index < argc && strlen(argv[arg_index]) > 0 &&
          argv[arg_index][0] == '-') {
     if (strcmp("-i", argv[arg_index]) == 0) {
       header_only = true;
+    } else if (strcmp("-b", argv[arg_index]) == 0) {
+      binary_output = true;
     } else if (strcmp("-c", argv[arg_index]) == 0) {
       cfi = false;
+    } else if (strcmp("-d", argv[arg_index]) == 0) {
+      handle_inlines = true;
+    } else if (strcmp("-j", argv[arg_index]) == 0) {
+      if (arg_index + 1 >= argc)
+        return usage(argv[0]);
+      threads = atoi(argv[++arg_index]);
+    } else if (strcmp("-m", argv[arg_index]) == 0) {
+      if (arg_index + 1 >= argc)
+        return usage(argv[0]);
+      memory_budget = strtoull(argv[++arg_index], NULL, 10) << 20;
     } else if (strcmp("-r", argv[arg_index]) == 0) {
       handle_inter_cu_refs = false;
     } else if (strcmp("-v", argv[arg_index]) == 0) {
@@ -78,6 +138,11 @@ int main(int argc, char **argv) {
   }
   if (arg_index == argc)
     return usage(argv[0]);
+  if (binary_output && handle_inlines) {
+    fprintf(stderr, "-b and -d can't be used together: binary symbol files "
+            "can't hold INLINE and INLINE_ORIGIN records.\n");
+    return 1;
+  }
   // Save stderr so it can be used below.
   FILE* saved_stderr = fdopen(dup(fileno(stderr)), "w");
   if (!log_to_stderr) {
@@ -102,8 +167,31 @@ int main(int argc, char **argv) {
     }
   } else {
     SymbolData symbol_data = cfi ? ALL_SYMBOL_DATA : NO_CFI;
-    google_breakpad::DumpOptions options(symbol_data, handle_inter_cu_refs);
-    if (!WriteSymbolFile(binary, debug_dirs, options, std::cout)) {
+    google_breakpad::DumpOptions options(symbol_data, handle_inter_cu_refs,
+                                         handle_inlines, threads,
+                                         memory_budget);
+    if (binary_output) {
+      // Serialize the text symbol file, as FastSourceLineResolver loads it.
+      // The text is written into one buffer and loaded there, so only one
+      // copy of it is in memory.
+      std::vector<char> text;
+      VectorStreamBuf text_buffer(&text);
+      std::ostream text_stream(&text_buffer);
+      if (!WriteSymbolFile(binary, debug_dirs, options, text_stream)) {
+        fprintf(saved_stderr, "Failed to write symbol file.\n");
+        return 1;
+      }
+      text.push_back('\0');
+      ModuleSerializer serializer;
+      size_t size = 0;
+      scoped_array<char> data(serializer.SerializeBinarySymbolFile(
+          &text[0], text.size(), threads, &size));
+      if (!data.get()) {
+        fprintf(saved_stderr, "Failed to serialize symbol file.\n");
+        return 1;
+      }
+      std::cout.write(data.get(), size);
+    } else if (!WriteSymbolFile(binary, debug_dirs, options, std::cout)) {
       fprintf(saved_stderr, "Failed to write symbol file.\n");
       return 1;
     }
@@ -1,4 +1,8 @@
 #include "md2core.h"
+#include "md2core_aarch64.h"
+#include "md2core_arm.h"
+#include "md2core_x86.h"
+#include "md2core_x86_64.h"
 
 
 namespace md2core {
@@ -33,12 +37,40 @@ namespace md2core {
   }
 
 
-  template<class T, class P, class Prs, class F, class R>
+  template<class T, class P, class Prs, class F, class R, class E>
+  CrashedProcess<T, P, Prs, F, R, E>::~CrashedProcess() {
+  }
+
+  template<class T, class P, class Prs, class F, class R, class E>
   void
-  CrashedProcess<T, P, Prs, F, R>::ParseThreadList(const Options& options,
+  CrashedProcess<T, P, Prs, F, R, E>::Reset() {
+    mappings.clear();
+    crashing_tid = -1;
+    fatal_signal = 0;
+    threads.clear();
+    auxv = NULL;
+    auxv_length = 0;
+    memset(&prps, 0, sizeof(prps));
+    prps.pr_sname = 'R';
+    signatures.clear();
+    dynamic_data.clear();
+    link_map_data.clear();
+    memset(&debug, 0, sizeof(debug));
+    link_map.clear();
+    memset(&siginfo, 0, sizeof(siginfo));
+  }
+
+  template<class T, class P, class Prs, class F, class R, class E>
+  bool
+  CrashedProcess<T, P, Prs, F, R, E>::ParseThreadList(const Options& options,
 						   const MinidumpMemoryRange& range,
 						   const MinidumpMemoryRange& full_file) {
-    const uint32_t num_threads = *range.GetData<uint32_t>(0);
+    const uint32_t* num_threads_ptr = range.GetData<uint32_t>(0);
+    if (!num_threads_ptr) {
+      fprintf(stderr, "Failed to access MD_THREAD_LIST_STREAM\n");
+      return false;
+    }
+    const uint32_t num_threads = *num_threads_ptr;
     if (options.verbose) {
       fprintf(stderr,
 	      "MD_THREAD_LIST_STREAM:\n"
@@ -51,30 +83,44 @@ namespace md2core {
       memset(&thread, 0, sizeof(thread));
       const MDRawThread* rawthread =
         range.GetArrayElement<MDRawThread>(sizeof(uint32_t), i);
+      if (!rawthread) {
+	fprintf(stderr, "Thread %u is out of the thread list\n", i);
+	return false;
+      }
       thread.tid = rawthread->thread_id;
       thread.stack_addr = rawthread->stack.start_of_memory_range;
       MinidumpMemoryRange stack_range =
         full_file.Subrange(rawthread->stack.memory);
-    thread.stack = stack_range.data();
-    thread.stack_length = rawthread->stack.memory.data_size;
-    
-    ParseThreadRegisters(&thread,
-                         full_file.Subrange(rawthread->thread_context));
+      if (!stack_range.data() && rawthread->stack.memory.data_size) {
+	fprintf(stderr, "Stack of thread %u is out of the minidump\n",
+		thread.tid);
+	return false;
+      }
+      thread.stack = stack_range.data();
+      thread.stack_length = stack_range.length();
 
-    threads.push_back(thread);
+      if (!ParseThreadRegisters(&thread,
+				full_file.Subrange(rawthread->thread_context))) {
+	fprintf(stderr, "Failed to read the registers of thread %u\n",
+		thread.tid);
+	return false;
+      }
+
+      threads.push_back(thread);
     }
+    return true;
   }
 
 // only place sysinfo is used. Not inside core
-  template<class T, class P, class Prs, class F, class R>
-  void
-  CrashedProcess<T, P, Prs, F, R>::ParseSystemInfo(const Options& options,
+  template<class T, class P, class Prs, class F, class R, class E>
+  bool
+  CrashedProcess<T, P, Prs, F, R, E>::ParseSystemInfo(const Options& options,
 				  const MinidumpMemoryRange& range,
 				  const MinidumpMemoryRange& full_file) {
     const MDRawSystemInfo* sysinfo = range.GetData<MDRawSystemInfo>(0);
     if (!sysinfo) {
       fprintf(stderr, "Failed to access MD_SYSTEM_INFO_STREAM\n");
-      exit(1);
+      return false;
     }
     if (options.verbose) {
       fprintf(stderr,
@@ -114,11 +160,23 @@ namespace md2core {
 	      full_file.GetAsciiMDString(sysinfo->csd_version_rva).c_str());
       fputs("\n\n", stderr);
     }
+    return true;
+  }
+
+  template<class T, class P, class Prs, class F, class R, class E>
+  void
+  CrashedProcess<T, P, Prs, F, R, E>::ParseCPUInfo(const Options& options,
+				const MinidumpMemoryRange& range) {
+    if (options.verbose) {
+      fputs("MD_LINUX_CPU_INFO:\n", stderr);
+      fwrite(range.data(), range.length(), 1, stderr);
+      fputs("\n\n\n", stderr);
+    }
   }
 
-  template<class T, class P, class Prs, class F, class R>
+  template<class T, class P, class Prs, class F, class R, class E>
   void
-  CrashedProcess<T, P, Prs, F, R>::ParseProcessStatus(const Options& options,
+  CrashedProcess<T, P, Prs, F, R, E>::ParseProcessStatus(const Options& options,
 				     const MinidumpMemoryRange& range) {
     if (options.verbose) {
       fputs("MD_LINUX_PROC_STATUS:\n", stderr);
@@ -127,9 +185,9 @@ namespace md2core {
     }
   }
 
-  template<class T, class P, class Prs, class F, class R>
+  template<class T, class P, class Prs, class F, class R, class E>
   void
-  CrashedProcess<T, P, Prs, F, R>::ParseLSBRelease(const Options& options,
+  CrashedProcess<T, P, Prs, F, R, E>::ParseLSBRelease(const Options& options,
 		  const MinidumpMemoryRange& range) {
     if (options.verbose) {
       fputs("MD_LINUX_LSB_RELEASE:\n", stderr);
@@ -141,9 +199,9 @@ namespace md2core {
 // ANNE create the arrays for NT_FILE here ?and make them crasheprocess attr
 // mappings are augmented elsewhere, the question is,
 // does NT_FILE need to be augmented as well?
-  template<class T, class P, class Prs, class F, class R>
+  template<class T, class P, class Prs, class F, class R, class E>
   void
-  CrashedProcess<T, P, Prs, F, R>::ParseMaps(const Options& options,
+  CrashedProcess<T, P, Prs, F, R, E>::ParseMaps(const Options& options,
 			    const MinidumpMemoryRange& range) {
     if (options.verbose) {
       fputs("MD_LINUX_MAPS:\n", stderr);
@@ -179,7 +237,7 @@ namespace md2core {
 	if (filename) {
 	  mapping.filename = filename;
 	}
-	mappings[mapping.start_address] = mapping;
+	AddMapping(mapping);
       }
       free(permissions);
       free(filename);
@@ -189,9 +247,9 @@ namespace md2core {
     }
   }
 
-  template<class T, class P, class Prs, class F, class R>
+  template<class T, class P, class Prs, class F, class R, class E>
   void
-  CrashedProcess<T, P, Prs, F, R>::ParseEnvironment(const Options& options,
+  CrashedProcess<T, P, Prs, F, R, E>::ParseEnvironment(const Options& options,
 				   const MinidumpMemoryRange& range) {
     if (options.verbose) {
       fputs("MD_LINUX_ENVIRON:\n", stderr);
@@ -229,9 +287,9 @@ namespace md2core {
     }
   }
 
-  template<class T, class P, class Prs, class F, class R>
+  template<class T, class P, class Prs, class F, class R, class E>
   void
-  CrashedProcess<T, P, Prs, F, R>::ParseAuxVector(const Options& options,
+  CrashedProcess<T, P, Prs, F, R, E>::ParseAuxVector(const Options& options,
 				 const MinidumpMemoryRange& range) {
     // Some versions of Chrome erroneously used the MD_LINUX_AUXV stream value
     // when dumping /proc/$x/maps
@@ -252,9 +310,9 @@ namespace md2core {
     auxv_length = range.length();
   }
 
-  template<class T, class P, class Prs, class F, class R>
+  template<class T, class P, class Prs, class F, class R, class E>
   void
-  CrashedProcess<T, P, Prs, F, R>::ParseCmdLine(const Options& options,
+  CrashedProcess<T, P, Prs, F, R, E>::ParseCmdLine(const Options& options,
 			       const MinidumpMemoryRange& range) {
     // The command line is supposed to use NUL bytes to separate arguments.
     // As Chrome rewrites its own command line and (incorrectly) substitutes
@@ -301,9 +359,9 @@ namespace md2core {
     }
   }
 
-  template<class T, class P, class Prs, class F, class R>
+  template<class T, class P, class Prs, class F, class R, class E>
   void
-  CrashedProcess<T, P, Prs, F, R>::ParseDSODebugInfo(const Options& options,
+  CrashedProcess<T, P, Prs, F, R, E>::ParseDSODebugInfo(const Options& options,
 				    const MinidumpMemoryRange& range,
 				    const MinidumpMemoryRange& full_file) {
     const MDRawDebug* debug = range.GetData<MDRawDebug>(0);
@@ -324,7 +382,7 @@ namespace md2core {
 	      static_cast<uint64_t>(debug->ldbase),
 	      static_cast<uint64_t>(debug->dynamic));
     }
-    debug = *debug;
+    this->debug = *debug;
     if (range.length() > sizeof(MDRawDebug)) {
       char* dynamic = (char*)range.data() + sizeof(MDRawDebug);
       dynamic_data.assign(dynamic,
@@ -351,25 +409,30 @@ namespace md2core {
     }
   }
 
-  template<class T, class P, class Prs, class F, class R>
-  void
-  CrashedProcess<T, P, Prs, F, R>::ParseExceptionStream(const Options& options,
+  template<class T, class P, class Prs, class F, class R, class E>
+  bool
+  CrashedProcess<T, P, Prs, F, R, E>::ParseExceptionStream(const Options& options,
 				       const MinidumpMemoryRange& range) {
     const MDRawExceptionStream* exp = range.GetData<MDRawExceptionStream>(0);
+    if (!exp) {
+      fprintf(stderr, "Failed to access MD_EXCEPTION_STREAM\n");
+      return false;
+    }
     crashing_tid = exp->thread_id;
     fatal_signal = (int) exp->exception_record.exception_code;
 
     //siginfo
     int sig_nb = (int) exp->exception_record.exception_code;
-    memset(&(siginfo), 0, sizeof(siginfo_t));
-    siginfo.si_signo = sig_nb;
-    siginfo.si_code = SI_KERNEL; // try non zero, so readelf prints si_addr
-    siginfo.si_addr = reinterpret_cast<void *>(exp->exception_record.exception_address);
+    memset(&(siginfo), 0, sizeof(siginfo));
+    siginfo.fields.signo = sig_nb;
+    siginfo.fields.code = SI_KERNEL; // try non zero, so readelf prints si_addr
+    siginfo.fields.addr = (typename E::Addr) exp->exception_record.exception_address;
+    return true;
   }
 
-  template<class T, class P, class Prs, class F, class R>
+  template<class T, class P, class Prs, class F, class R, class E>
   bool
-  CrashedProcess<T, P, Prs, F, R>::WriteThread(const Options& options, const T& thread,
+  CrashedProcess<T, P, Prs, F, R, E>::WriteThread(CoreWriter* writer, const T& thread,
 			      int fatal_signal) {
     Prs pr;
     memset(&pr, 0, sizeof(pr));
@@ -384,38 +447,51 @@ namespace md2core {
     Nhdr nhdr;
     memset(&nhdr, 0, sizeof(nhdr));
     nhdr.n_namesz = 5;
-    nhdr.n_descsz = sizeof(struct prstatus);
+    nhdr.n_descsz = sizeof(Prs);
     nhdr.n_type = NT_PRSTATUS;
-    if (!writea(options.out_fd, &nhdr, sizeof(nhdr)) ||
-	!writea(options.out_fd, "CORE\0\0\0\0", 8) ||
-	!writea(options.out_fd, &pr, sizeof(Prs))) {
+    if (!writer->Write(&nhdr, sizeof(nhdr)) ||
+	!writer->Write("CORE\0\0\0\0", 8) ||
+	!writer->Write(&pr, sizeof(Prs))) {
       return false;
     }
 
+    // The note names used here all fit in 8 bytes once padded.
+    char name[8] = { 0 };
+    strncpy(name, FPRegsNoteName(), sizeof(name) - 1);
+    nhdr.n_namesz = strlen(name) + 1;
     nhdr.n_descsz = sizeof(F);
-    nhdr.n_type = NT_FPREGSET;
-    if (!writea(options.out_fd, &nhdr, sizeof(nhdr)) ||
-	!writea(options.out_fd, "CORE\0\0\0\0", 8) ||
-	!writea(options.out_fd, &thread.fpregs, sizeof(F))) {
+    nhdr.n_type = FPRegsNoteType();
+    if (!writer->Write(&nhdr, sizeof(nhdr)) ||
+	!writer->Write(name, sizeof(name)) ||
+	!writer->Write(&thread.fpregs, sizeof(F))) {
       return false;
     }
 
     return true;
   }
 
-  template<class T, class P, class Prs, class F, class R>
-  void
-  CrashedProcess<T, P, Prs, F, R>::ParseModuleStream(const Options& options,
+  template<class T, class P, class Prs, class F, class R, class E>
+  bool
+  CrashedProcess<T, P, Prs, F, R, E>::ParseModuleStream(const Options& options,
 				    const MinidumpMemoryRange& range,
 				    const MinidumpMemoryRange& full_file) {
     if (options.verbose) {
       fputs("MD_MODULE_LIST_STREAM:\n", stderr);
     }
-    const uint32_t num_mappings = *range.GetData<uint32_t>(0);
+    const uint32_t* num_mappings_ptr = range.GetData<uint32_t>(0);
+    if (!num_mappings_ptr) {
+      fprintf(stderr, "Failed to access MD_MODULE_LIST_STREAM\n");
+      return false;
+    }
+    const uint32_t num_mappings = *num_mappings_ptr;
     for (unsigned i = 0; i < num_mappings; ++i) {
       Mapping mapping;
       const MDRawModule* rawmodule = reinterpret_cast<const MDRawModule*>(
 	range.GetArrayElement(sizeof(uint32_t), MD_MODULE_SIZE, i));
+      if (!rawmodule) {
+	fprintf(stderr, "Module %u is out of the module list\n", i);
+	return false;
+      }
       mapping.start_address = rawmodule->base_of_image;
       mapping.end_address = rawmodule->size_of_image + rawmodule->base_of_image;
 
@@ -423,19 +499,25 @@ namespace md2core {
 	  mappings.end()) {
 	// We prefer data from MD_LINUX_MAPS over MD_MODULE_LIST_STREAM, as
 	// the former is a strict superset of the latter.
-	mappings[mapping.start_address] = mapping;
+	AddMappingToHoles(mapping);
       }
 
       const MDCVInfoPDB70* record = reinterpret_cast<const MDCVInfoPDB70*>(
 	full_file.GetData(rawmodule->cv_record.rva, MDCVInfoPDB70_minsize));
       char guid[40];
-      sprintf(guid, "%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X",
-	      record->signature.data1, record->signature.data2,
-	      record->signature.data3,
-	      record->signature.data4[0], record->signature.data4[1],
-	      record->signature.data4[2], record->signature.data4[3],
-	      record->signature.data4[4], record->signature.data4[5],
-	      record->signature.data4[6], record->signature.data4[7]);
+      if (record) {
+	sprintf(guid, "%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X",
+		record->signature.data1, record->signature.data2,
+		record->signature.data3,
+		record->signature.data4[0], record->signature.data4[1],
+		record->signature.data4[2], record->signature.data4[3],
+		record->signature.data4[4], record->signature.data4[5],
+		record->signature.data4[6], record->signature.data4[7]);
+      } else {
+	// A module without a CodeView record gets the all zero identifier,
+	// which -i does not add to its name.
+	strcpy(guid, "00000000-0000-0000-0000-000000000000");
+      }
 
       string filename = full_file.GetAsciiMDString(rawmodule->module_name_rva);
 
@@ -455,46 +537,129 @@ namespace md2core {
     if (options.verbose) {
       fputs("\n\n", stderr);
     }
+    return true;
+  }
+
+  void
+  Mapping::Clip(uint64_t start, uint64_t end) {
+    if (start > start_address) {
+      if (!filename.empty())
+	offset += start - start_address;
+    } else {
+      start = start_address;
+    }
+    if (end > end_address)
+      end = end_address;
+    // Keep the part of the data that falls between |start| and |end|.
+    const uint64_t data_start = start_address + data_padding;
+    const uint64_t data_end = data_start + data.length();
+    const uint64_t keep_start = std::max(data_start, start);
+    const uint64_t keep_end = std::min(data_end, end);
+    if (keep_start < keep_end) {
+      data = data.Subrange(keep_start - data_start, keep_end - keep_start);
+      data_padding = keep_start - start;
+    } else {
+      data = MinidumpMemoryRange();
+      data_padding = 0;
+    }
+    start_address = start;
+    end_address = end;
+  }
+
+  template<class T, class P, class Prs, class F, class R, class E>
+  void
+  CrashedProcess<T, P, Prs, F, R, E>::AddMapping(const Mapping& mapping) {
+    const uint64_t start = mapping.start_address;
+    const uint64_t end = mapping.end_address;
+    if (start >= end)
+      return;
+    std::map<uint64_t, Mapping>::iterator iter = mappings.lower_bound(start);
+    if (iter != mappings.begin()) {
+      // The mapping before |mapping| may run into it, or even past it.
+      std::map<uint64_t, Mapping>::iterator before = iter;
+      --before;
+      if (before->second.end_address > start) {
+	if (before->second.end_address > end) {
+	  Mapping after = before->second;
+	  after.Clip(end, after.end_address);
+	  iter = mappings.insert(iter, std::make_pair(end, after));
+	}
+	before->second.Clip(before->second.start_address, start);
+      }
+    }
+    // The mappings starting within |mapping| lose their beginning, or all
+    // of it.
+    while (iter != mappings.end() && iter->first < end) {
+      if (iter->second.end_address > end) {
+	Mapping after = iter->second;
+	after.Clip(end, after.end_address);
+	mappings.erase(iter++);
+	mappings.insert(iter, std::make_pair(end, after));
+	break;
+      }
+      mappings.erase(iter++);
+    }
+    mappings[start] = mapping;
+  }
+
+  template<class T, class P, class Prs, class F, class R, class E>
+  void
+  CrashedProcess<T, P, Prs, F, R, E>::AddMappingToHoles(const Mapping& mapping) {
+    uint64_t start = mapping.start_address;
+    std::map<uint64_t, Mapping>::iterator next = mappings.upper_bound(start);
+    if (next != mappings.begin()) {
+      std::map<uint64_t, Mapping>::iterator before = next;
+      --before;
+      start = std::max(start, before->second.end_address);
+    }
+    while (start < mapping.end_address) {
+      uint64_t end = mapping.end_address;
+      if (next != mappings.end())
+	end = std::min(end, next->first);
+      if (start < end) {
+	Mapping hole = mapping;
+	hole.Clip(start, end);
+	mappings.insert(next, std::make_pair(start, hole));
+      }
+      if (next == mappings.end())
+	break;
+      start = std::max(start, next->second.end_address);
+      ++next;
+    }
   }
 
 // That is where I would need to modify NT_FILE if I where to
 // create it alongside mappings
-  template<class T, class P, class Prs, class F, class R>
+  template<class T, class P, class Prs, class F, class R, class E>
   void
-  CrashedProcess<T, P, Prs, F, R>::AddDataToMapping(const string& data,
+  CrashedProcess<T, P, Prs, F, R, E>::AddDataToMapping(const MinidumpMemoryRange& data,
 				   uintptr_t addr) {
-    for (std::map<uint64_t, Mapping>::iterator
-	   iter = mappings.begin();
-	 iter != mappings.end();
-	 ++iter) {
-      if (addr >= iter->second.start_address &&
-	  addr < iter->second.end_address) {
+    // Mappings do not overlap, so the only one that can contain |addr| is
+    // the last one starting at or before it. Finding it is O(log n) rather
+    // than a walk of the whole map for every thread stack.
+    std::map<uint64_t, Mapping>::iterator iter = mappings.upper_bound(addr);
+    if (iter != mappings.begin()) {
+      --iter;
+      if (addr < iter->second.end_address) {
+	// "mapping" is a copy of "iter->second". We are splitting the
+	// existing mapping into two separate ones when we write the data to
+	// the core file. The first one, made of the memory pages in the
+	// mapping prior to where the data starts, if any, does not have any
+	// associated data in the core file, the second one is backed by
+	// data that is included with the core file. Clip moves the file
+	// offset of the second one along, unless the mapping is anonymous,
+	// and AddMapping truncates the existing mapping so that it ends with
+	// the page immediately preceding the data region.
 	Mapping mapping = iter->second;
-	if ((addr & ~4095) != iter->second.start_address) {
-	  // If there are memory pages in the mapping prior to where the
-	  // data starts, truncate the existing mapping so that it ends with
-	  // the page immediately preceding the data region.
-	  iter->second.end_address = addr & ~4095;
-	  if (!mapping.filename.empty()) {
-	    // "mapping" is a copy of "iter->second". We are splitting the
-	    // existing mapping into two separate ones when we write the data
-	    // to the core file. The first one does not have any associated
-	    // data in the core file, the second one is backed by data that is
-	    // included with the core file.
-	    // If this mapping wasn't supposed to be anonymous, then we also
-	    // have to update the file offset upon splitting the mapping.
-	    mapping.offset += iter->second.end_address -
-	      iter->second.start_address;
-	  }
-	}
+	mapping.Clip(addr & ~4095, mapping.end_address);
 	// Create a new mapping that contains the data contents. We often
 	// limit the amount of data that is actually written to the core
 	// file. But it is OK if the mapping itself extends past the end of
 	// the data.
 	mapping.start_address = addr & ~4095;
-	mapping.data.assign(addr & 4095, 0).append(data);
-	mapping.data.append(-mapping.data.size() & 4095, 0);
-	mappings[mapping.start_address] = mapping;
+	mapping.data = data;
+	mapping.data_padding = addr & 4095;
+	AddMapping(mapping);
 	return;
       }
     }
@@ -503,22 +668,23 @@ namespace md2core {
     mapping.permissions = PF_R | PF_W;
     mapping.start_address = addr & ~4095;
     mapping.end_address =
-      (addr + data.size() + 4095) & ~4095;
-    mapping.data.assign(addr & 4095, 0).append(data);
-    mapping.data.append(-mapping.data.size() & 4095, 0);
-    mappings[mapping.start_address] = mapping;
+      (addr + data.length() + 4095) & ~4095;
+    mapping.data = data;
+    mapping.data_padding = addr & 4095;
+    AddMapping(mapping);
   }
 
-  template<class T, class P, class Prs, class F, class R>
+  template<class T, class P, class Prs, class F, class R, class E>
   void
-  CrashedProcess<T, P, Prs, F, R>::AugmentMappings(const Options& options,
+  CrashedProcess<T, P, Prs, F, R, E>::AugmentMappings(const Options& options,
 				  const MinidumpMemoryRange& full_file) {
     // For each thread, find the memory mapping that matches the thread's stack.
-    // Then adjust the mapping to include the stack dump.
+    // Then adjust the mapping to include the stack dump. The stack stays in
+    // the mapped minidump, the mapping only references it.
     for (unsigned i = 0; i < threads.size(); ++i) {
       const T& thread = threads[i];
-      AddDataToMapping(string((char *)thread.stack,
-			      thread.stack_length),
+      AddDataToMapping(MinidumpMemoryRange(thread.stack,
+					   thread.stack_length),
 		       thread.stack_addr);
     }
 
@@ -526,26 +692,31 @@ namespace md2core {
     // the beginning of the address space, as this area should always be
     // available.
     static const uintptr_t start_addr = 4096;
-    string data;
-    struct r_debug deb = { 0 };
+    // The mapping keeps a view into |link_map_data|, so it must not be
+    // modified once added.
+    string& data = link_map_data;
+    data.clear();
+    TargetRDebug<typename E::Addr> deb;
+    memset(&deb, 0, sizeof(deb));
     deb.r_version = debug.version;
-    deb.r_brk = (ElfW(Addr))debug.brk;
+    deb.r_brk = (typename E::Addr)debug.brk;
     deb.r_state = r_debug::RT_CONSISTENT;
-    deb.r_ldbase = (ElfW(Addr))debug.ldbase;
+    deb.r_ldbase = (typename E::Addr)debug.ldbase;
     deb.r_map = debug.dso_count > 0 ?
-      (struct link_map*)(start_addr + sizeof(deb)) : 0;
+      (typename E::Addr)(start_addr + sizeof(deb)) : 0;
     data.append((char*)&deb, sizeof(deb));
 
-    struct link_map* prev = 0;
-    for (std::vector<MDRawLinkMap>::iterator iter = link_map.begin();
+    typename E::Addr prev = 0;
+    for (typename std::vector<MDRawLinkMap>::iterator iter = link_map.begin();
 	 iter != link_map.end();
 	 ++iter) {
-      struct link_map link_m = { 0 };
-      link_m.l_addr = (ElfW(Addr))iter->addr;
-      link_m.l_name = (char*)(start_addr + data.size() + sizeof(link_m));
-      link_m.l_ld = (ElfW(Dyn)*)iter->ld;
+      TargetLinkMap<typename E::Addr> link_m;
+      memset(&link_m, 0, sizeof(link_m));
+      link_m.l_addr = (typename E::Addr)iter->addr;
+      link_m.l_name = (typename E::Addr)(start_addr + data.size() + sizeof(link_m));
+      link_m.l_ld = (typename E::Addr)iter->ld;
       link_m.l_prev = prev;
-      prev = (struct link_m*)(start_addr + data.size());
+      prev = (typename E::Addr)(start_addr + data.size());
       string filename = full_file.GetAsciiMDString(iter->name);
 
       // Look up signature for this filename. If available, change filename
@@ -604,21 +775,22 @@ namespace md2core {
       if (std::distance(iter, link_map.end()) == 1) {
 	link_m.l_next = 0;
       } else {
-	link_m.l_next = (struct link_map*)(start_addr + data.size() +
-					     sizeof(link_map) +
+	link_m.l_next = (typename E::Addr)(start_addr + data.size() +
+					     sizeof(link_m) +
 					     ((filename.size() + 8) & ~7));
       }
       data.append((char*)&link_m, sizeof(link_m));
       data.append(filename);
       data.append(8 - (filename.size() & 7), 0);
     }
-    AddDataToMapping(data, start_addr);
+    AddDataToMapping(MinidumpMemoryRange(data.data(), data.size()),
+		     start_addr);
 
     // Map the page containing the _DYNAMIC array
     if (!dynamic_data.empty()) {
       // Make _DYNAMIC DT_DEBUG entry point to our link map
       for (int i = 0;; ++i) {
-	ElfW(Dyn) dyn;
+	typename E::Dyn dyn;
 	if ((i+1)*sizeof(dyn) > dynamic_data.length()) {
 	no_dt_debug:
 	  if (options.verbose) {
@@ -629,22 +801,24 @@ namespace md2core {
 	memcpy(&dyn, dynamic_data.c_str() + i*sizeof(dyn),
 	       sizeof(dyn));
 	if (dyn.d_tag == DT_DEBUG) {
+	  typename E::Addr debug_addr = start_addr;
 	  dynamic_data.replace(i*sizeof(dyn) +
-			       offsetof(ElfW(Dyn), d_un.d_ptr),
-			       sizeof(start_addr),
-			       (char*)&start_addr, sizeof(start_addr));
+			       offsetof(typename E::Dyn, d_un.d_ptr),
+			       sizeof(debug_addr),
+			       (char*)&debug_addr, sizeof(debug_addr));
 	  break;
 	} else if (dyn.d_tag == DT_NULL) {
 	  goto no_dt_debug;
 	}
       }
-      AddDataToMapping(dynamic_data,
+      AddDataToMapping(MinidumpMemoryRange(dynamic_data.data(),
+					   dynamic_data.size()),
 		       (uintptr_t)debug.dynamic);
     }
   }
 
-  template<class T, class P, class Prs, class F, class R>
-  size_t CrashedProcess<T, P, Prs, F, R>::get_filesz() {
+  template<class T, class P, class Prs, class F, class R, class E>
+  size_t CrashedProcess<T, P, Prs, F, R, E>::get_filesz() {
     size_t result =  sizeof(P) +
                      sizeof(Nhdr) + 8 + auxv_length +
                      threads.size() * (
@@ -653,32 +827,36 @@ namespace md2core {
     return result;
   }
 
-  template<class T, class P, class Prs, class F, class R>
-  bool CrashedProcess<T, P, Prs, F, R>::write_prpsinfo(const Options& options, Nhdr *nhdr) {
+  template<class T, class P, class Prs, class F, class R, class E>
+  bool CrashedProcess<T, P, Prs, F, R, E>::write_prpsinfo(CoreWriter* writer, Nhdr *nhdr) {
   nhdr->n_namesz = 5;
   nhdr->n_descsz = sizeof(P);
   nhdr->n_type = NT_PRPSINFO;
-  if (!writea(options.out_fd, nhdr, sizeof(*nhdr)) ||
-      !writea(options.out_fd, "CORE\0\0\0\0", 8) ||
-      !writea(options.out_fd, &prps, sizeof(P))) {
+  if (!writer->Write(nhdr, sizeof(*nhdr)) ||
+      !writer->Write("CORE\0\0\0\0", 8) ||
+      !writer->Write(&prps, sizeof(P))) {
     return false;
   }
   return true;
   }
 
-  template<class T, class P, class Prs, class F, class R>
-  void CrashedProcess<T, P, Prs, F, R>::write_threads(const Options& options) {
+  template<class T, class P, class Prs, class F, class R, class E>
+  void CrashedProcess<T, P, Prs, F, R, E>::write_threads(CoreWriter* writer) {
     for (unsigned i = 0; i < threads.size(); ++i) {
       if (threads[i].tid != crashing_tid)
-	WriteThread(options, threads[i], 0);
+	WriteThread(writer, threads[i], 0);
       }
   }
 
-  template<class T, class P, class Prs, class F, class R>
+  template<class T, class P, class Prs, class F, class R, class E>
   int // ?
-  CrashedProcess<T, P, Prs, F, R>::write_core(const Options& options, const MinidumpMemoryRange& dump) {
+  CrashedProcess<T, P, Prs, F, R, E>::write_core(const Options& options, const MinidumpMemoryRange& dump) {
 
     const MDRawHeader* header = dump.GetData<MDRawHeader>(0);
+    if (!header) {
+      fprintf(stderr, "Cannot read minidump header.\n");
+      return 1;
+    }
 
   // Always check the system info first, as that allows us to tell whether
   // this is a minidump file that is compatible with our converter.
@@ -686,10 +864,15 @@ namespace md2core {
     for (unsigned i = 0; i < header->stream_count; ++i) {
       const MDRawDirectory* dirent =
         dump.GetArrayElement<MDRawDirectory>(header->stream_directory_rva, i);
+      if (!dirent) {
+	fprintf(stderr, "Stream %u is out of the stream directory\n", i);
+	return 1;
+      }
       switch (dirent->stream_type) {
       case MD_SYSTEM_INFO_STREAM:
-        this->ParseSystemInfo(options, dump.Subrange(dirent->location),
-			dump);
+        if (!this->ParseSystemInfo(options, dump.Subrange(dirent->location),
+				   dump))
+	  return 1;
         ok = true;
         break;
       default:
@@ -698,16 +881,18 @@ namespace md2core {
     }
     if (!ok) {
       fprintf(stderr, "Cannot determine input file format.\n");
-      exit(1);  // return 1 ?
+      return 1;
     }
 
+    // The first loop has checked that every directory entry is readable.
     for (unsigned i = 0; i < header->stream_count; ++i) {
       const MDRawDirectory* dirent =
         dump.GetArrayElement<MDRawDirectory>(header->stream_directory_rva, i);
       switch (dirent->stream_type) {
       case MD_THREAD_LIST_STREAM:
-	this->ParseThreadList(options, dump.Subrange(dirent->location),
-                        dump);
+	if (!this->ParseThreadList(options, dump.Subrange(dirent->location),
+				   dump))
+	  return 1;
         break;
       case MD_LINUX_CPU_INFO:
         ParseCPUInfo(options, dump.Subrange(dirent->location));
@@ -736,12 +921,14 @@ namespace md2core {
 			  dump);
         break;
       case MD_EXCEPTION_STREAM:
-        ParseExceptionStream(options,
-			     dump.Subrange(dirent->location));
+        if (!ParseExceptionStream(options,
+				  dump.Subrange(dirent->location)))
+	  return 1;
         break;
       case MD_MODULE_LIST_STREAM:
-        ParseModuleStream(options, dump.Subrange(dirent->location),
-				    dump);
+        if (!ParseModuleStream(options, dump.Subrange(dirent->location),
+			       dump))
+	  return 1;
         break;
       default:
         if (options.verbose)
@@ -754,16 +941,23 @@ namespace md2core {
     // Write the ELF header. The file will look like:
     //   ELF header
     //   Phdr for the PT_NOTE
-    //   Phdr for each of the thread stacks
+    //   Phdr for each of the memory mappings
     //   PT_NOTE
-    //   each of the thread stacks
+    //   the data of each of the memory mappings
+    // Everything goes through |writer|. The data of the mappings are views
+    // into the minidump, so they are not copied before reaching the kernel.
+    CoreWriter writer(options.out_fd, options.format);
+    typedef typename E::Ehdr Ehdr;
+    typedef typename E::Phdr Phdr;
+    typedef typename E::Shdr Shdr;
+    typedef typename E::Addr Long;
     Ehdr ehdr;
     memset(&ehdr, 0, sizeof(Ehdr));
     ehdr.e_ident[0] = ELFMAG0;
     ehdr.e_ident[1] = ELFMAG1;
     ehdr.e_ident[2] = ELFMAG2;
     ehdr.e_ident[3] = ELFMAG3;
-    ehdr.e_ident[4] = ELF_CLASS;
+    ehdr.e_ident[4] = E::kClass;
     ehdr.e_ident[5] = sex() ? ELFDATA2MSB : ELFDATA2LSB;
     ehdr.e_ident[6] = EV_CURRENT;
     ehdr.e_type     = ET_CORE;
@@ -775,7 +969,7 @@ namespace md2core {
     ehdr.e_phnum    = 1 +                         // PT_NOTE
                       mappings.size();  // memory mappings
     ehdr.e_shentsize= sizeof(Shdr);
-    if (!writea(options.out_fd, &ehdr, sizeof(Ehdr)))
+    if (!writer.Write(&ehdr, sizeof(Ehdr)))
       return 1;
 
   // https://github.com/torvalds/linux/blob/b9151761021e25c024a6670df4e7c43ffbab0e1d/fs/binfmt_elf.c#L1580
@@ -793,9 +987,9 @@ namespace md2core {
 
   //Need a vector of long
   //And a string buffer. Need string concatenation
-    std::vector<long> filemaps;
+    std::vector<Long> filemaps;
     std::string filenames;
-    long count = 0;
+    Long count = 0;
 
     for (std::map<uint64_t, Mapping>::const_iterator iter =
 	   mappings.begin();
@@ -804,10 +998,10 @@ namespace md2core {
       // printf("-%s-\n", mapping.filename.c_str());
       if (mapping.permissions == 0xFFFFFFFF || mapping.filename.empty())
 	continue;
-      filemaps.push_back((long) mapping.start_address);
+      filemaps.push_back((Long) mapping.start_address);
       // printf("mapping start 0x%x\n", (unsigned int) mapping.start_address);
-      filemaps.push_back((long) mapping.end_address);
-      filemaps.push_back((long) mapping.offset);
+      filemaps.push_back((Long) mapping.end_address);
+      filemaps.push_back((Long) mapping.offset);
       filenames += mapping.filename;
       filenames.append(1, '\0');
       ++count;
@@ -816,7 +1010,7 @@ namespace md2core {
     // the way NT_FILES work means the descsz is obtained by summation of different
     // elements and not just the size of 1 element. The issue there is alignment.
     // so let's try to do it by hand with align_power from binutils
-    size_t file_descsz = (2 + filemaps.size()) * sizeof(long) + filenames.size();
+    size_t file_descsz = (2 + filemaps.size()) * sizeof(Long) + filenames.size();
     size_t file_aligned = align_power(file_descsz, 2);
 
     size_t offset = sizeof(Ehdr) + ehdr.e_phnum * sizeof(Phdr);
@@ -824,12 +1018,14 @@ namespace md2core {
     size_t filesz = sizeof(Nhdr) + 8 +
                     // sizeof(Nhdr) + 8 + sizeof(user) +
                     // siginfo
-                    sizeof(Nhdr) + 8 + sizeof(siginfo_t) +
+                    sizeof(Nhdr) + 8 + sizeof(siginfo) +
                     // NT_FILES:
                     sizeof(Nhdr) + 8 + file_aligned +
                     get_filesz();
 
-    printf("filesz is %lu\n", filesz);
+    // The core may be going to stdout, diagnostics go to stderr.
+    if (options.verbose)
+      fprintf(stderr, "filesz is %lu\n", filesz);
 
 
     Phdr phdr;
@@ -837,7 +1033,7 @@ namespace md2core {
     phdr.p_type = PT_NOTE;
     phdr.p_offset = offset;
     phdr.p_filesz = filesz;
-    if (!writea(options.out_fd, &phdr, sizeof(phdr)))
+    if (!writer.Write(&phdr, sizeof(phdr)))
       return 1;
 
     phdr.p_type = PT_LOAD;
@@ -845,7 +1041,18 @@ namespace md2core {
     size_t note_align = phdr.p_align - ((offset+filesz) % phdr.p_align);
     if (note_align == phdr.p_align)
       note_align = 0;
-    offset += note_align;
+
+    // Lay out the PT_LOAD segments up front: their data follow the page
+    // aligned end of the PT_NOTE, in address order.
+    uint64_t load_offset = offset + filesz + note_align;
+    for (std::map<uint64_t, Mapping>::iterator iter = mappings.begin();
+	 iter != mappings.end(); ++iter) {
+      Mapping& mapping = iter->second;
+      if (mapping.data_size()) {
+	mapping.file_offset = load_offset;
+	load_offset += mapping.data_size();
+      }
+    }
 
     for (std::map<uint64_t, Mapping>::const_iterator iter =
 	   mappings.begin();
@@ -861,42 +1068,40 @@ namespace md2core {
       }
       phdr.p_vaddr = mapping.start_address;
       phdr.p_memsz = mapping.end_address - mapping.start_address;
-      if (mapping.data.size()) {
-	offset += filesz;
-	filesz = mapping.data.size();
-	phdr.p_filesz = mapping.data.size();
-	phdr.p_offset = offset;
+      if (mapping.data_size()) {
+	phdr.p_filesz = mapping.data_size();
+	phdr.p_offset = mapping.file_offset;
       } else {
 	phdr.p_filesz = 0;
 	phdr.p_offset = 0;
       }
-      if (!writea(options.out_fd, &phdr, sizeof(phdr)))
+      if (!writer.Write(&phdr, sizeof(phdr)))
 	return 1;
     }
 
     Nhdr nhdr;
     memset(&nhdr, 0, sizeof(nhdr));
 
-    if (!write_prpsinfo(options, &nhdr))
+    if (!write_prpsinfo(&writer, &nhdr))
       return  1;
 
     nhdr.n_descsz = auxv_length;
     nhdr.n_type = NT_AUXV;
-    if (!writea(options.out_fd, &nhdr, sizeof(nhdr)) ||
-	!writea(options.out_fd, "CORE\0\0\0\0", 8) ||
-	!writea(options.out_fd, auxv, auxv_length)) {
+    if (!writer.Write(&nhdr, sizeof(nhdr)) ||
+	!writer.Write("CORE\0\0\0\0", 8) ||
+	!writer.WriteView(auxv, auxv_length)) {
       return 1;
     }
 
     for (unsigned i = 0; i < threads.size(); ++i) {
       if (threads[i].tid == crashing_tid) {
-	WriteThread(options, threads[i], fatal_signal);
+	WriteThread(&writer, threads[i], fatal_signal);
 	// NT_SIGINFO needs to get crashing thread tid
-	nhdr.n_descsz = sizeof(siginfo_t);
+	nhdr.n_descsz = sizeof(siginfo);
 	nhdr.n_type = NT_SIGINFO;
-	if (!writea(options.out_fd, &nhdr, sizeof(nhdr)) ||
-	    !writea(options.out_fd, "CORE\0\0\0\0", 8) ||
-	    !writea(options.out_fd, &siginfo, sizeof(siginfo_t))) {
+	if (!writer.Write(&nhdr, sizeof(nhdr)) ||
+	    !writer.Write("CORE\0\0\0\0", 8) ||
+	    !writer.Write(&siginfo, sizeof(siginfo))) {
 	  return 1;
 	}
 	break;
@@ -904,54 +1109,67 @@ namespace md2core {
     }
 
     // NT_FILE
-    long page_size = 4096;
+    Long page_size = 4096;
     nhdr.n_descsz = file_descsz;
     nhdr.n_type = NT_FILE;
 
-    if (!writea(options.out_fd, &nhdr, sizeof(nhdr)) ||
-	!writea(options.out_fd, "CORE\0\0\0\0", 8) ||
-	!writea(options.out_fd, &count, sizeof(long)) ||
-	!writea(options.out_fd, &page_size, sizeof(long)) ||
-	!writea(options.out_fd, &(filemaps[0]), filemaps.size() * sizeof(long)) ||
-	!writea(options.out_fd, filenames.data(), filenames.size())) {
-      printf("Failed nt_file\n");
+    if (!writer.Write(&nhdr, sizeof(nhdr)) ||
+	!writer.Write("CORE\0\0\0\0", 8) ||
+	!writer.Write(&count, sizeof(Long)) ||
+	!writer.Write(&page_size, sizeof(Long)) ||
+	!writer.WriteView(filemaps.data(), filemaps.size() * sizeof(Long)) ||
+	!writer.WriteView(filenames.data(), filenames.size())) {
+      fprintf(stderr, "Failed nt_file\n");
       return 1;
     }
     // and do not forget I need to write the alignment to file, but it should not be in descsz.
-    size_t fill_aligned = file_aligned - file_descsz;
-    if (fill_aligned) {
-      google_breakpad::scoped_array<char> scratch(new char[fill_aligned]);
-      memset(scratch.get(), 0, note_align);
-      if (!writea(options.out_fd, scratch.get(), fill_aligned))
-	return 1;
-    }
+    if (!writer.WriteZeros(file_aligned - file_descsz))
+      return 1;
 
-    write_threads(options);
+    write_threads(&writer);
 
-    printf("note_align %lu\n", note_align);
-    if (note_align) {
-      google_breakpad::scoped_array<char> scratch(new char[note_align]);
-      memset(scratch.get(), 0, note_align);
-      if (!writea(options.out_fd, scratch.get(), note_align))
-	return 1;
-    }
+    if (options.verbose)
+      fprintf(stderr, "note_align %lu\n", note_align);
+    if (!writer.WriteZeros(note_align))
+      return 1;
 
     for (std::map<uint64_t, Mapping>::const_iterator iter =
 	   mappings.begin();
 	 iter != mappings.end(); ++iter) {
       const Mapping& mapping = iter->second;
-      if (mapping.data.size()) {
-	if (!writea(options.out_fd, mapping.data.c_str(), mapping.data.size()))
-	  return 1;
+      size_t data_size = mapping.data_size();
+      if (!data_size)
+	continue;
+      if (writer.offset() != mapping.file_offset) {
+	fprintf(stderr, "Core layout mismatch at 0x%" PRIx64 "\n",
+		mapping.start_address);
+	return 1;
       }
+      if (!writer.WriteZeros(mapping.data_padding) ||
+	  !writer.WriteView(mapping.data.data(), mapping.data.length()) ||
+	  !writer.WriteZeros(data_size - mapping.data_padding -
+			     mapping.data.length()))
+	return 1;
     }
 
-    if (options.out_fd != STDOUT_FILENO) {
-      close(options.out_fd);
-    }
+    if (!writer.Finish())
+      return 1;
 
     return 0;
   }
 
+// The template is only used with these, see md2core_registry.cc.
+  template class CrashedProcess<Thread86_64, prpsinfo86_64, prstatus86_64,
+				user_fpregs86_64_struct, user_regs86_64_struct,
+				ElfClass64>;
+  template class CrashedProcess<Threadaarch64, prpsinfoaarch64,
+				prstatusaarch64, user_fpsimd_struct,
+				user_regsaarch64_struct, ElfClass64>;
+  template class CrashedProcess<Threadx86, prpsinfox86, prstatusx86,
+				user_fpregsx86_struct, user_regsx86_struct,
+				ElfClass32>;
+  template class CrashedProcess<Threadarm, prpsinfoarm, prstatusarm,
+				user_vfp_struct, user_regsarm_struct,
+				ElfClass32>;
 
 }
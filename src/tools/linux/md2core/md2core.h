@@ -12,6 +12,7 @@
 // siginfo
 #include <signal.h>
 
+#include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
@@ -23,20 +24,12 @@
 #include "google_breakpad/common/breakpad_types.h"
 #include "google_breakpad/common/minidump_format.h"
 #include "third_party/lss/linux_syscall_support.h"
+#include "tools/linux/md2core/md2core_writer.h"
 #include "tools/linux/md2core/minidump_memory_range.h"
 
-
-#if __WORDSIZE == 64
-  #define ELF_CLASS ELFCLASS64
-#else
-  #define ELF_CLASS ELFCLASS32
-#endif
-
 namespace md2core {
 
-#define Ehdr   ElfW(Ehdr)
-#define Phdr   ElfW(Phdr)
-#define Shdr   ElfW(Shdr)
+// Notes headers are the same for both ELF classes.
 #define Nhdr   ElfW(Nhdr)
 #define auxv_t ElfW(auxv_t)
 
@@ -53,6 +46,13 @@ namespace md2core {
     bool inc_guid;
     string so_basedir;
     string arch;
+    // Sparse or compressed output.
+    CoreFormat format;
+    // Batch mode: a manifest (one minidump path per line) or a directory of
+    // minidumps, converted by |jobs| threads into |output_dir|.
+    string batch_path;
+    string output_dir;
+    int jobs;
   } Options;
 
   bool
@@ -62,9 +62,6 @@ namespace md2core {
   using google_breakpad::MemoryMappedFile;
   using google_breakpad::MinidumpMemoryRange;
 
-  typedef MDTypeHelper<sizeof(ElfW(Addr))>::MDRawDebug MDRawDebug;
-  typedef MDTypeHelper<sizeof(ElfW(Addr))>::MDRawLinkMap MDRawLinkMap;
-
   static const MDRVA kInvalidMDRVA = static_cast<MDRVA>(-1);
 
   typedef struct elf_timeval {    /* Time value with microsecond resolution    */
@@ -72,6 +69,11 @@ namespace md2core {
     long tv_usec;                 /* Microseconds                              */
   } elf_timeval;
 
+  typedef struct elf_timeval32 {  /* elf_timeval of a 32bit process            */
+    int32_t tv_sec;               /* Seconds                                   */
+    int32_t tv_usec;              /* Microseconds                              */
+  } elf_timeval32;
+
   typedef struct _elf_siginfo {   /* Information about signal (unused)         */
     int32_t si_signo;             /* Signal number                             */
     int32_t si_code;              /* Extra code                                */
@@ -84,13 +86,28 @@ namespace md2core {
   : permissions(0xFFFFFFFF),
       start_address(0),
       end_address(0),
-      offset(0) {
+      offset(0),
+      data_padding(0),
+      file_offset(0) {
   }
+    // Size of the data written to the core for this mapping: the data
+    // itself, preceded by |data_padding| zeros and rounded up to a page.
+    size_t data_size() const {
+      return (data_padding + data.length() + 4095) & ~4095;
+    }
+    // Narrows the mapping to the part of it from |start| to |end|, moving
+    // the file offset and the data along.
+    void Clip(uint64_t start, uint64_t end);
     uint32_t permissions;
     uint64_t start_address, end_address, offset;
     // The name we write out to the core.
     string filename;
-    string data;
+    // View into the minidump (or into a buffer owned by the CrashedProcess)
+    // holding the contents of the mapping. It is never copied.
+    MinidumpMemoryRange data;
+    size_t data_padding;
+    // Where |data| goes in the core, computed before anything is written.
+    uint64_t file_offset;
   };
 
   struct Signature {
@@ -98,6 +115,79 @@ namespace md2core {
     string filename;
   };
 
+// The ELF class of the core follows the crashed process, not the machine
+// md2core runs on. These describe the structures whose layout depends on it.
+// A is the address type of the crashed process, which is also its long.
+
+  template <typename A>
+  struct TargetRDebug {           /* struct r_debug                            */
+    int32_t r_version;
+    A r_map;
+    A r_brk;
+    int32_t r_state;
+    A r_ldbase;
+  };
+
+  template <typename A>
+  struct TargetLinkMap {          /* struct link_map                           */
+    A l_addr;
+    A l_name;
+    A l_ld;
+    A l_next;
+    A l_prev;
+  };
+
+  template <typename A>
+  union TargetSiginfo {           /* siginfo_t, only the fields we fill in     */
+    struct {                      /* (si_* are macros in signal.h)             */
+      int32_t signo;
+      int32_t err;
+      int32_t code;
+      A addr;
+    } fields;
+    uint8_t bytes[128];
+  };
+
+  struct ElfClass32 {
+    typedef Elf32_Ehdr Ehdr;
+    typedef Elf32_Phdr Phdr;
+    typedef Elf32_Shdr Shdr;
+    typedef Elf32_Dyn Dyn;
+    typedef uint32_t Addr;
+    typedef MDTypeHelper<sizeof(uint32_t)>::MDRawDebug MDRawDebug;
+    typedef MDTypeHelper<sizeof(uint32_t)>::MDRawLinkMap MDRawLinkMap;
+    static const unsigned char kClass = ELFCLASS32;
+  };
+
+  struct ElfClass64 {
+    typedef Elf64_Ehdr Ehdr;
+    typedef Elf64_Phdr Phdr;
+    typedef Elf64_Shdr Shdr;
+    typedef Elf64_Dyn Dyn;
+    typedef uint64_t Addr;
+    typedef MDTypeHelper<sizeof(uint64_t)>::MDRawDebug MDRawDebug;
+    typedef MDTypeHelper<sizeof(uint64_t)>::MDRawLinkMap MDRawLinkMap;
+    static const unsigned char kClass = ELFCLASS64;
+  };
+
+// What the rest of md2core needs to know about a CrashedProcess, whatever
+// its architecture. See md2core_registry.h for how one is picked.
+
+  class CrashedProcessInterface {
+  public:
+    virtual ~CrashedProcessInterface() {}
+
+    // Forgets everything parsed from the previous minidump, so that one
+    // instance can convert many of them.
+    virtual void
+      Reset() = 0;
+
+    // Converts |dump| into a core written to |options.out_fd|. Returns 0
+    // on success.
+    virtual int
+      write_core(const Options& options, const MinidumpMemoryRange& dump) = 0;
+  };
+
 //This class is template and abstract.
 
 // T will be a thread
@@ -105,23 +195,40 @@ namespace md2core {
 // Prs will be prstatuts
 // F will be fpregs or fpsim
 // R will be user_regs
+// E will be ElfClass32 or ElfClass64
 
   template <typename T, typename P, typename Prs, typename F,
-            typename R >
-    class CrashedProcess {
+            typename R, typename E = ElfClass64 >
+    class CrashedProcess : public CrashedProcessInterface {
   public:
- 
+    typedef typename E::MDRawDebug MDRawDebug;
+    typedef typename E::MDRawLinkMap MDRawLinkMap;
+
     virtual ~CrashedProcess();
- 
+
     virtual void
+      Reset();
+
+    // Each of these returns false if the minidump is too corrupt to
+    // convert.
+    virtual bool
       ParseThreadRegisters(T* thread,
-			   const MinidumpMemoryRange& range);
-    void
+			   const MinidumpMemoryRange& range) = 0;
+
+    // Type and name of the note holding F. Architectures that do not use
+    // NT_FPREGSET override them.
+    virtual uint32_t
+      FPRegsNoteType() const { return NT_FPREGSET; }
+
+    virtual const char*
+      FPRegsNoteName() const { return "CORE"; }
+    bool
       ParseThreadList(const Options& options,
 		      const MinidumpMemoryRange& range,
 		      const MinidumpMemoryRange& full_file);
 
-    void
+    // Overridden by each architecture to reject minidumps it cannot convert.
+    virtual bool
       ParseSystemInfo(const Options& options,
 		      const MinidumpMemoryRange& range,
 		      const MinidumpMemoryRange& full_file);
@@ -159,21 +266,31 @@ namespace md2core {
 			const MinidumpMemoryRange& range,
 			const MinidumpMemoryRange& full_file);
 
-    void
+    bool
       ParseExceptionStream(const Options& options,
 			   const MinidumpMemoryRange& range);
 
     bool
-      WriteThread(const Options& options, const T& thread,
+      WriteThread(CoreWriter* writer, const T& thread,
 		  int fatal_signal);
 
-    void
+    bool
       ParseModuleStream(const Options& options,
 			const MinidumpMemoryRange& range,
 			const MinidumpMemoryRange& full_file);
 
+    // Adds |mapping| to |mappings|. The parts of the mappings already
+    // there that |mapping| overlaps are cut away, so that mappings never
+    // overlap. An empty mapping is ignored.
+    void
+      AddMapping(const Mapping& mapping);
+
+    // Adds the parts of |mapping| that no mapping in |mappings| covers.
+    void
+      AddMappingToHoles(const Mapping& mapping);
+
     void
-      AddDataToMapping(const string& data,
+      AddDataToMapping(const MinidumpMemoryRange& data,
 		       uintptr_t addr);
 
     void
@@ -184,14 +301,17 @@ namespace md2core {
       get_filesz();
 
     bool
-      write_prpsinfo(const Options& options, Nhdr* nhdr);
+      write_prpsinfo(CoreWriter* writer, Nhdr* nhdr);
 
     void
-      write_threads(const Options& options);
+      write_threads(CoreWriter* writer);
 
-    int // ?
+    virtual int
       write_core(const Options& options, const MinidumpMemoryRange& dump);
 
+    // Keyed on the start address. The mappings do not overlap, so the only
+    // one that can contain an address is the last one starting at or
+    // before it.
     std::map<uint64_t, Mapping> mappings;
     pid_t crashing_tid;
     int fatal_signal;
@@ -205,10 +325,13 @@ namespace md2core {
     // We gather them for merging later on into the list of maps.
     std::map<uintptr_t, Signature> signatures;
     string dynamic_data;
+    // The synthetic r_debug and link_map list, mapped at the start of the
+    // address space by AugmentMappings.
+    string link_map_data;
     MDRawDebug debug;
     std::vector<MDRawLinkMap> link_map;
     //siginfo
-    siginfo_t siginfo;
+    TargetSiginfo<typename E::Addr> siginfo;
     int elf_arch;
 
   };
@@ -14,10 +14,16 @@ namespace md2core {
   }
 
 
-  void
+  CrashedProcessAarch64::~CrashedProcessAarch64() {
+  }
+
+
+  bool
   CrashedProcessAarch64::ParseThreadRegisters(Threadaarch64* thread,
 					      const MinidumpMemoryRange& range) {
     const MDRawContextARM64* rawregs = range.GetData<MDRawContextARM64>(0);
+    if (!rawregs)
+      return false;
 
     for (int i = 0; i < 31; ++i)
       thread->regs.regs[i] = rawregs->iregs[i];
@@ -28,40 +34,41 @@ namespace md2core {
     memcpy(thread->fpregs.vregs, rawregs->float_save.regs, 8 * 32);
     thread->fpregs.fpsr = rawregs->float_save.fpsr;
     thread->fpregs.fpcr = rawregs->float_save.fpcr;
+    return true;
   }
 
 
-  void
+  bool
   CrashedProcessAarch64::ParseSystemInfo(const Options& options,
 					 const MinidumpMemoryRange& range,
 					 const MinidumpMemoryRange& full_file) {
     const MDRawSystemInfo* sysinfo = range.GetData<MDRawSystemInfo>(0);
     if (!sysinfo) {
       fprintf(stderr, "Failed to access MD_SYSTEM_INFO_STREAM\n");
-      exit(1);
+      return false;
   }
     if (sysinfo->processor_architecture != MD_CPU_ARCHITECTURE_ARM64) {
       fprintf(stderr,
 	      "This version of minidump-2-core only supports ARM (64bit).\n");
-      exit(1);
+      return false;
     }
     if (!strstr(full_file.GetAsciiMDString(sysinfo->csd_version_rva).c_str(),
 		"Linux") &&
 	sysinfo->platform_id != MD_OS_NACL) {
       fprintf(stderr, "This minidump was not generated by Linux or NaCl.\n");
-      exit(1);
+      return false;
     }
 // call super
-    CrashedProcess<Threadaarch64, prpsinfoaarch64,
+    return CrashedProcess<Threadaarch64, prpsinfoaarch64,
 		   prstatusaarch64, user_fpsimd_struct,
 		   user_regsaarch64_struct>::ParseSystemInfo(options, range, full_file);
   }
 
   
-  void CrashedProcessAarch64::write_threads(const Options& options) {
+  void CrashedProcessAarch64::write_threads(CoreWriter* writer) {
     for (unsigned i = 0; i < threads.size(); ++i) {
       if (threads[i].tid != crashing_tid)
-	WriteThread(options, threads[i], fatal_signal);
+	WriteThread(writer, threads[i], fatal_signal);
     }
   }
   
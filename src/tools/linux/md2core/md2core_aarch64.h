@@ -73,17 +73,17 @@ namespace md2core {
     CrashedProcessAarch64();
     virtual ~CrashedProcessAarch64();
 
-    void
+    bool
       ParseThreadRegisters(Threadaarch64* thread,
 			   const MinidumpMemoryRange& range);
 
-    void
+    bool
       ParseSystemInfo(const Options& options,
 		      const MinidumpMemoryRange& range,
 		      const MinidumpMemoryRange& full_file);
 
     void
-      write_threads(const Options& options);
+      write_threads(CoreWriter* writer);
 
   };
 }
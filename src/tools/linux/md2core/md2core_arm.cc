@@ -0,0 +1,76 @@
+#include "md2core_arm.h"
+
+#ifndef NT_ARM_VFP
+#define NT_ARM_VFP 0x400
+#endif
+
+namespace md2core {
+
+  CrashedProcessArm::CrashedProcessArm() {
+    crashing_tid = -1;
+    auxv = NULL;
+    auxv_length = 0;
+    memset(&prps, 0, sizeof(prps));
+    prps.pr_sname = 'R';
+    memset(&debug, 0, sizeof(debug));
+    elf_arch = EM_ARM;
+  }
+
+
+  bool
+  CrashedProcessArm::ParseThreadRegisters(Threadarm* thread,
+					  const MinidumpMemoryRange& range) {
+    const MDRawContextARM* rawregs = range.GetData<MDRawContextARM>(0);
+    if (!rawregs)
+      return false;
+
+    for (int i = 0; i < MD_CONTEXT_ARM_GPR_COUNT; ++i)
+      thread->regs.uregs[i] = rawregs->iregs[i];
+    thread->regs.uregs[16] = rawregs->cpsr;
+    thread->regs.uregs[17] = 0;  // what is ORIG_r0 exactly?
+
+    memcpy(thread->fpregs.fpregs, rawregs->float_save.regs, 8 * 32);
+    thread->fpregs.fpscr = rawregs->float_save.fpscr;
+    return true;
+  }
+
+
+  bool
+  CrashedProcessArm::ParseSystemInfo(const Options& options,
+				     const MinidumpMemoryRange& range,
+				     const MinidumpMemoryRange& full_file) {
+    const MDRawSystemInfo* sysinfo = range.GetData<MDRawSystemInfo>(0);
+    if (!sysinfo) {
+      fprintf(stderr, "Failed to access MD_SYSTEM_INFO_STREAM\n");
+      return false;
+    }
+    if (sysinfo->processor_architecture != MD_CPU_ARCHITECTURE_ARM) {
+      fprintf(stderr,
+	      "This version of minidump-2-core only supports ARM (32bit).\n");
+      return false;
+    }
+    if (!strstr(full_file.GetAsciiMDString(sysinfo->csd_version_rva).c_str(),
+		"Linux") &&
+	sysinfo->platform_id != MD_OS_NACL) {
+      fprintf(stderr, "This minidump was not generated by Linux or NaCl.\n");
+      return false;
+    }
+// call super
+    return CrashedProcess<Threadarm, prpsinfoarm,
+			  prstatusarm, user_vfp_struct,
+			  user_regsarm_struct, ElfClass32>::ParseSystemInfo(options, range, full_file);
+  }
+
+
+  uint32_t
+  CrashedProcessArm::FPRegsNoteType() const {
+    return NT_ARM_VFP;
+  }
+
+
+  const char*
+  CrashedProcessArm::FPRegsNoteName() const {
+    return "LINUX";
+  }
+
+}
@@ -0,0 +1,93 @@
+#ifndef MD_2_CORE_ARM_H_
+#define MD_2_CORE_ARM_H_
+
+#include "md2core.h"
+
+namespace md2core {
+
+  typedef struct prpsinfoarm {    /* Information about process                 */
+    unsigned char  pr_state;      /* Numeric process state                     */
+    char           pr_sname;      /* Char for pr_state                         */
+    unsigned char  pr_zomb;       /* Zombie                                    */
+    signed char    pr_nice;       /* Nice val                                  */
+    uint32_t       pr_flag;       /* Flags                                     */
+    uint16_t       pr_uid;        /* User ID                                   */
+    uint16_t       pr_gid;        /* Group ID                                  */
+    int32_t        pr_pid;        /* Process ID                                */
+    int32_t        pr_ppid;       /* Parent's process ID                       */
+    int32_t        pr_pgrp;       /* Group ID                                  */
+    int32_t        pr_sid;        /* Session ID                                */
+    char           pr_fname[16];  /* Filename of executable                    */
+    char           pr_psargs[80]; /* Initial part of arg list                  */
+  } prpsinfoarm;
+
+// Contents of the NT_ARM_VFP note. The doubles are kept as pairs of words
+// so that the structure has no padding, like in the kernel.
+  typedef struct user_vfp_struct {
+    uint32_t fpregs[64];
+    uint32_t fpscr;
+  } user_vfp_struct;
+
+// GLibc/ARM and Android/ARM both call it 'user_regs'.
+  typedef struct user_regsarm_struct {
+    uint32_t uregs[18];
+  } user_regsarm_struct;
+
+  typedef struct prstatusarm {    /* Information about thread; includes CPU reg*/
+    _elf_siginfo   pr_info;       /* Info associated with signal               */
+    uint16_t       pr_cursig;     /* Current signal                            */
+    uint32_t       pr_sigpend;    /* Set of pending signals                    */
+    uint32_t       pr_sighold;    /* Set of held signals                       */
+    int32_t        pr_pid;        /* Process ID                                */
+    int32_t        pr_ppid;       /* Parent's process ID                       */
+    int32_t        pr_pgrp;       /* Group ID                                  */
+    int32_t        pr_sid;        /* Session ID                                */
+    elf_timeval32  pr_utime;      /* User time                                 */
+    elf_timeval32  pr_stime;      /* System time                               */
+    elf_timeval32  pr_cutime;     /* Cumulative user time                      */
+    elf_timeval32  pr_cstime;     /* Cumulative system time                    */
+// that is function of architecture
+    user_regsarm_struct pr_reg;   /* CPU registers                             */
+    uint32_t       pr_fpvalid;    /* True if math co-processor being used      */
+  } prstatusarm;
+
+  struct Threadarm {
+    pid_t tid;
+    user_regsarm_struct regs;
+    user_vfp_struct fpregs;
+    uintptr_t stack_addr;
+    const uint8_t* stack;
+    size_t stack_length;
+  };
+
+
+  class CrashedProcessArm: public CrashedProcess<Threadarm,
+                                                 prpsinfoarm,
+                                                 prstatusarm,
+                                                 user_vfp_struct,
+                                                 user_regsarm_struct,
+                                                 ElfClass32> {
+
+  public:
+    CrashedProcessArm();
+
+    bool
+      ParseThreadRegisters(Threadarm* thread,
+			   const MinidumpMemoryRange& range);
+
+    bool
+      ParseSystemInfo(const Options& options,
+		      const MinidumpMemoryRange& range,
+		      const MinidumpMemoryRange& full_file);
+
+    // ARM has no NT_FPREGSET, the VFP registers go in their own note.
+    uint32_t
+      FPRegsNoteType() const;
+
+    const char*
+      FPRegsNoteName() const;
+  };
+
+}
+
+#endif  // MD_2_CORE_ARM_H_
@@ -0,0 +1,228 @@
+#include "md2core_batch.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <algorithm>
+#include <fstream>
+
+namespace md2core {
+
+  Converter::~Converter() {
+    for (std::map<const Backend*, CrashedProcessInterface*>::iterator iter =
+	   processes_.begin();
+	 iter != processes_.end(); ++iter) {
+      delete iter->second;
+    }
+  }
+
+  int
+  Converter::Convert(const Options& options, const MinidumpMemoryRange& dump) {
+    const Backend* backend = NULL;
+    if (!options.arch.empty()) {
+      backend = FindBackend(options.arch);
+      if (!backend) {
+	fprintf(stderr, "Option %s is not one of 86_64, aarch64, i386, arm.\n",
+		options.arch.c_str());
+	return 1;
+      }
+    } else {
+      uint16_t processor_architecture;
+      if (!ReadProcessorArchitecture(dump, &processor_architecture)) {
+	fprintf(stderr, "Cannot determine input file format.\n");
+	return 1;
+      }
+      backend = FindBackend(processor_architecture);
+      if (!backend) {
+	fprintf(stderr, "Unsupported processor architecture %u.\n",
+		processor_architecture);
+	return 1;
+      }
+    }
+
+    CrashedProcessInterface*& process = processes_[backend];
+    if (!process)
+      process = backend->create();
+    process->Reset();
+    return process->write_core(options, dump);
+  }
+
+  bool
+  ReadBatchList(const string& batch_path, std::vector<string>* paths) {
+    struct stat st;
+    if (stat(batch_path.c_str(), &st) == -1) {
+      fprintf(stderr, "%s: %s\n", batch_path.c_str(), strerror(errno));
+      return false;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+      DIR* dir = opendir(batch_path.c_str());
+      if (!dir) {
+	fprintf(stderr, "%s: %s\n", batch_path.c_str(), strerror(errno));
+	return false;
+      }
+      while (struct dirent* entry = readdir(dir)) {
+	string path = batch_path + "/" + entry->d_name;
+	struct stat entry_st;
+	if (stat(path.c_str(), &entry_st) == 0 && S_ISREG(entry_st.st_mode))
+	  paths->push_back(path);
+      }
+      closedir(dir);
+      std::sort(paths->begin(), paths->end());
+      return true;
+    }
+
+    std::ifstream manifest(batch_path.c_str());
+    if (!manifest) {
+      fprintf(stderr, "%s: cannot read manifest\n", batch_path.c_str());
+      return false;
+    }
+    string line;
+    while (std::getline(manifest, line)) {
+      // Drop trailing whitespace, including the '\r' of CRLF manifests.
+      size_t end = line.find_last_not_of(" \t\r");
+      line.erase(end == string::npos ? 0 : end + 1);
+      if (!line.empty() && line[0] != '#')
+	paths->push_back(line);
+    }
+    return true;
+  }
+
+  namespace {
+
+    struct BatchState {
+      const Options* options;
+      const std::vector<string>* paths;
+      // Index of the next minidump to hand to a worker, and number of
+      // failures so far. Both guarded by |lock|, as is stderr reporting.
+      size_t next;
+      int failures;
+      pthread_mutex_t lock;
+    };
+
+    double
+    ElapsedMs(const struct timespec& start) {
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      return (now.tv_sec - start.tv_sec) * 1e3 +
+	(now.tv_nsec - start.tv_nsec) / 1e6;
+    }
+
+    string
+    CorePath(const Options& options, const string& dump_path) {
+      const char* suffix = ".core";
+      if (options.format == CORE_FORMAT_GZIP)
+	suffix = ".core.gz";
+      else if (options.format == CORE_FORMAT_ZSTD)
+	suffix = ".core.zst";
+      if (options.output_dir.empty())
+	return dump_path + suffix;
+      size_t slash = dump_path.find_last_of('/');
+      return options.output_dir + "/" +
+	dump_path.substr(slash == string::npos ? 0 : slash + 1) + suffix;
+    }
+
+    // Converts one minidump. Returns NULL on success, or a description of
+    // the failure.
+    const char*
+    ConvertFile(Converter* converter, const Options& batch_options,
+		const string& dump_path) {
+      MemoryMappedFile mapped_file(dump_path.c_str(), 0);
+      if (!mapped_file.data())
+	return "cannot mmap minidump";
+
+      Options options = batch_options;
+      options.minidump_path = dump_path;
+      string core_path = CorePath(batch_options, dump_path);
+      options.out_fd = open(core_path.c_str(),
+			    O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0664);
+      if (options.out_fd == -1)
+	return "cannot open output";
+
+      MinidumpMemoryRange dump(mapped_file.data(), mapped_file.size());
+      int result = converter->Convert(options, dump);
+      if (close(options.out_fd) == -1 && !result)
+	result = 1;
+      if (result) {
+	unlink(core_path.c_str());
+	return "conversion failed";
+      }
+      return NULL;
+    }
+
+    void*
+    BatchWorker(void* arg) {
+      BatchState* state = static_cast<BatchState*>(arg);
+      Converter converter;
+      for (;;) {
+	pthread_mutex_lock(&state->lock);
+	size_t index = state->next++;
+	pthread_mutex_unlock(&state->lock);
+	if (index >= state->paths->size())
+	  break;
+
+	const string& path = (*state->paths)[index];
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	const char* error = ConvertFile(&converter, *state->options, path);
+	double elapsed = ElapsedMs(start);
+
+	pthread_mutex_lock(&state->lock);
+	if (error) {
+	  ++state->failures;
+	  fprintf(stderr, "%s: FAILED (%s) %.1f ms\n", path.c_str(), error,
+		  elapsed);
+	} else {
+	  fprintf(stderr, "%s: ok %.1f ms\n", path.c_str(), elapsed);
+	}
+	pthread_mutex_unlock(&state->lock);
+      }
+      return NULL;
+    }
+
+  }  // namespace
+
+  int
+  RunBatch(const Options& options) {
+    std::vector<string> paths;
+    if (!ReadBatchList(options.batch_path, &paths))
+      return 1;
+
+    BatchState state;
+    state.options = &options;
+    state.paths = &paths;
+    state.next = 0;
+    state.failures = 0;
+    pthread_mutex_init(&state.lock, NULL);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    size_t jobs = options.jobs > 0 ? options.jobs : 1;
+    if (jobs > paths.size())
+      jobs = paths.size() ? paths.size() : 1;
+    std::vector<pthread_t> workers(jobs);
+    size_t started = 0;
+    for (; started < jobs; ++started) {
+      if (pthread_create(&workers[started], NULL, BatchWorker, &state))
+	break;
+    }
+    if (!started) {
+      // Could not start any thread, do the work on this one.
+      BatchWorker(&state);
+    }
+    for (size_t i = 0; i < started; ++i)
+      pthread_join(workers[i], NULL);
+    pthread_mutex_destroy(&state.lock);
+
+    fprintf(stderr, "%zu minidumps, %d failed, %zu threads, %.1f ms\n",
+	    paths.size(), state.failures, started ? started : 1,
+	    ElapsedMs(start));
+    return state.failures;
+  }
+
+}
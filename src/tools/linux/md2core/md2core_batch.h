@@ -0,0 +1,53 @@
+#ifndef MD_2_CORE_BATCH_H_
+#define MD_2_CORE_BATCH_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common/basictypes.h"
+#include "md2core.h"
+#include "md2core_registry.h"
+
+namespace md2core {
+
+// A Converter creates at most one CrashedProcess per backend, the first
+// time a minidump needs it, and reuses it from one minidump to the next,
+// so that converting many minidumps does not pay for their setup each time.
+// A Converter is not thread safe: batch mode gives one to each worker.
+
+  class Converter {
+  public:
+    Converter() {}
+    ~Converter();
+
+    // Converts the minidump |dump| into a core written to |options.out_fd|,
+    // with the backend named by |options.arch|, or, if it is empty, the one
+    // matching the architecture of |dump|. Returns 0 on success.
+    int
+      Convert(const Options& options, const MinidumpMemoryRange& dump);
+
+  private:
+    std::map<const Backend*, CrashedProcessInterface*> processes_;
+
+    DISALLOW_COPY_AND_ASSIGN(Converter);
+  };
+
+  // Fills |paths| with the minidumps to convert: the regular files of
+  // |batch_path| if it is a directory (sorted by name), or else the
+  // non-empty lines of the |batch_path| manifest that do not start with '#'.
+  bool
+    ReadBatchList(const string& batch_path, std::vector<string>* paths);
+
+  // Converts every minidump of |options.batch_path| on |options.jobs|
+  // threads. Each core is written to |options.output_dir| (or next to its
+  // minidump) with a ".core" suffix, followed by ".gz" or ".zst" when
+  // compressed. A minidump that fails to convert is
+  // reported and skipped. Per-file timings and a summary are printed on
+  // stderr. Returns the number of minidumps that failed.
+  int
+    RunBatch(const Options& options);
+
+}
+
+#endif  // MD_2_CORE_BATCH_H_
@@ -0,0 +1,181 @@
+// Converts a synthetic x86-64 minidump with many threads and many
+// /proc/self/maps entries, and reports how long it takes.
+//
+// Usage: md2core_benchmark [threads [mappings [iterations]]]
+// Defaults to 10000 threads, 50000 mappings and 3 iterations. The thread
+// stacks are spread over the mappings: half of them fall inside a file
+// mapping, which gets split, the other half between mappings, which adds a
+// mapping. Both go through AddDataToMapping, once per thread. The maps also
+// hold one 64 GB file mapping, as a process mapping a large file would,
+// which a lookup bounded by the length of the longest mapping could not
+// skip.
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "md2core.h"
+#include "md2core_batch.h"
+
+namespace md2core {
+
+  namespace {
+
+    const uint64_t kMappingsBase = 0x10000000;
+    // Each mapping is followed by a gap of the same size.
+    const uint64_t kMappingStride = 0x10000;
+    const uint64_t kMappingSize = 0x8000;
+    const uint32_t kStackSize = 1024;
+    const uint64_t kHugeMappingSize = 1ULL << 36;
+
+    // Appends |length| bytes at |data| to |dump|, returns their RVA.
+    MDRVA
+    Append(string* dump, const void* data, size_t length) {
+      MDRVA rva = dump->size();
+      dump->append(reinterpret_cast<const char*>(data), length);
+      return rva;
+    }
+
+    void
+    BuildMinidump(unsigned thread_count, unsigned mapping_count,
+		  string* dump) {
+      // The header and the stream directory are filled in last.
+      const unsigned kStreamCount = 4;
+      dump->assign(sizeof(MDRawHeader) + kStreamCount * sizeof(MDRawDirectory),
+		   '\0');
+      MDRawDirectory directory[kStreamCount];
+      memset(directory, 0, sizeof(directory));
+
+      MDRawSystemInfo sysinfo;
+      memset(&sysinfo, 0, sizeof(sysinfo));
+      sysinfo.processor_architecture = MD_CPU_ARCHITECTURE_AMD64;
+      sysinfo.platform_id = MD_OS_LINUX;
+      uint32_t empty_string = 0;
+      sysinfo.csd_version_rva = Append(dump, &empty_string,
+				       sizeof(empty_string));
+      directory[0].stream_type = MD_SYSTEM_INFO_STREAM;
+      directory[0].location.data_size = sizeof(sysinfo);
+      directory[0].location.rva = Append(dump, &sysinfo, sizeof(sysinfo));
+
+      // All the threads share one context and one stack.
+      MDRawContextAMD64 context;
+      memset(&context, 0, sizeof(context));
+      MDRVA context_rva = Append(dump, &context, sizeof(context));
+      string stack(kStackSize, '\x5a');
+      MDRVA stack_rva = Append(dump, stack.data(), stack.size());
+
+      string threads;
+      threads.append(reinterpret_cast<const char*>(&thread_count),
+		     sizeof(thread_count));
+      for (unsigned i = 0; i < thread_count; ++i) {
+	MDRawThread thread;
+	memset(&thread, 0, sizeof(thread));
+	thread.thread_id = 1000 + i;
+	// Spread the stacks over all the mappings.
+	uint64_t mapping = kMappingsBase +
+	  uint64_t(i / 2) * mapping_count / ((thread_count + 1) / 2) *
+	  kMappingStride;
+	thread.stack.start_of_memory_range = i % 2 ?
+	  mapping + kMappingSize + 0x1100 : mapping + 0x2100;
+	thread.stack.memory.data_size = kStackSize;
+	thread.stack.memory.rva = stack_rva;
+	thread.thread_context.data_size = sizeof(context);
+	thread.thread_context.rva = context_rva;
+	threads.append(reinterpret_cast<const char*>(&thread), sizeof(thread));
+      }
+      directory[1].stream_type = MD_THREAD_LIST_STREAM;
+      directory[1].location.data_size = threads.size();
+      directory[1].location.rva = Append(dump, threads.data(), threads.size());
+
+      string maps;
+      for (unsigned i = 0; i < mapping_count; ++i) {
+	char line[128];
+	uint64_t start = kMappingsBase + i * kMappingStride;
+	snprintf(line, sizeof(line),
+		 "%" PRIx64 "-%" PRIx64 " r-xp 00000000 08:01 %u"
+		 " /usr/lib/libbenchmark%u.so\n",
+		 start, start + kMappingSize, 100 + i, i);
+	maps += line;
+      }
+      char line[128];
+      uint64_t start = kMappingsBase + mapping_count * kMappingStride;
+      snprintf(line, sizeof(line),
+	       "%" PRIx64 "-%" PRIx64 " r--p 00000000 08:01 99"
+	       " /data/benchmark.db\n",
+	       start, start + kHugeMappingSize);
+      maps += line;
+      directory[2].stream_type = MD_LINUX_MAPS;
+      directory[2].location.data_size = maps.size();
+      directory[2].location.rva = Append(dump, maps.data(), maps.size());
+
+      // The first thread crashed.
+      MDRawExceptionStream exception;
+      memset(&exception, 0, sizeof(exception));
+      exception.thread_id = 1000;
+      exception.exception_record.exception_code = MD_EXCEPTION_CODE_LIN_SIGSEGV;
+      exception.thread_context.data_size = sizeof(context);
+      exception.thread_context.rva = context_rva;
+      directory[3].stream_type = MD_EXCEPTION_STREAM;
+      directory[3].location.data_size = sizeof(exception);
+      directory[3].location.rva = Append(dump, &exception, sizeof(exception));
+
+      MDRawHeader header;
+      memset(&header, 0, sizeof(header));
+      header.signature = MD_HEADER_SIGNATURE;
+      header.version = MD_HEADER_VERSION;
+      header.stream_count = kStreamCount;
+      header.stream_directory_rva = sizeof(header);
+      memcpy(&(*dump)[0], &header, sizeof(header));
+      memcpy(&(*dump)[sizeof(header)], directory, sizeof(directory));
+    }
+
+    double
+    NowMs() {
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+    }
+
+  }  // namespace
+
+}
+
+int
+main(int argc, const char* argv[]) {
+  using namespace md2core;
+  unsigned thread_count = argc > 1 ? atoi(argv[1]) : 10000;
+  unsigned mapping_count = argc > 2 ? atoi(argv[2]) : 50000;
+  unsigned iterations = argc > 3 ? atoi(argv[3]) : 3;
+  if (!mapping_count)
+    mapping_count = 1;
+
+  string dump;
+  BuildMinidump(thread_count, mapping_count, &dump);
+
+  Options options;
+  options.verbose = false;
+  options.use_filename = false;
+  options.inc_guid = false;
+  options.format = CORE_FORMAT_PLAIN;
+  options.jobs = 1;
+  options.minidump_path = "synthetic";
+  options.out_fd = open("/dev/null", O_WRONLY);
+  if (options.out_fd == -1) {
+    perror("/dev/null");
+    return 1;
+  }
+
+  Converter converter;
+  MinidumpMemoryRange range(dump.data(), dump.size());
+  for (unsigned i = 0; i < iterations; ++i) {
+    double start = NowMs();
+    if (converter.Convert(options, range)) {
+      fprintf(stderr, "conversion failed\n");
+      return 1;
+    }
+    printf("%u threads, %u mappings: %.1f ms\n", thread_count, mapping_count,
+	   NowMs() - start);
+  }
+  close(options.out_fd);
+  return 0;
+}
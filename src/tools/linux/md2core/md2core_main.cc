@@ -24,11 +24,12 @@
 // // siginfo
 // #include <signal.h>
 
+#include <fcntl.h>
+
 #include <memory>  // unique_ptr
 
 #include "md2core.h"
-#include "md2core_x86_64.h"
-#include "md2core_aarch64.h"
+#include "md2core_batch.h"
 
 
 
@@ -44,6 +45,7 @@ namespace md2core {
     Usage(int argc, const char* argv[]) {
     fprintf(stderr,
 	    "Usage: %s [options] <minidump file>\n"
+	    "       %s [options] -B <manifest or directory>\n"
 	    "\n"
 	    "Convert a minidump file into a core file (often for use by gdb).\n"
 	    "\n"
@@ -68,22 +70,39 @@ namespace md2core {
 	    "             lookups to be done in this directory rather than the filesystem\n"
 	    "             layout as it exists in the crashing image.  This path should end\n"
 	    "             with a slash if it's a directory.  e.g. /var/lib/breakpad/\n"
-	    "  -a         Architecture, either 86_64 or aarch64\n"
-	    "", basename(argv[0]));
+	    "  -a <arch>  Architecture of the minidump: 86_64, aarch64, i386 or arm.\n"
+	    "             By default it is read from the minidump.\n"
+	    "  -s         Write a sparse core: pages of zeros are left as holes in\n"
+	    "             the file. Ignored if the output cannot be seeked.\n"
+	    "  -z <comp>  Compress the core as it is written, with gzip or zstd\n"
+	    "             (gzip only if md2core was built with HAVE_LIBZ, zstd\n"
+	    "             only if it was built with HAVE_LIBZSTD).\n"
+	    "\n"
+	    "Batch mode:\n"
+	    "  -B <path>  Convert every minidump listed in the manifest <path> (one\n"
+	    "             path per line), or found in the directory <path>.\n"
+	    "             Failures are reported and do not stop the run.\n"
+	    "  -O <dir>   Write the cores to <dir> (default: next to each minidump),\n"
+	    "             named after the minidump with a .core suffix (.core.gz or\n"
+	    "             .core.zst with -z).\n"
+	    "  -j <n>     Number of worker threads (default: number of CPUs).\n"
+	    "", basename(argv[0]), basename(argv[0]));
   }
 
   static void
     SetupOptions(int argc, const char* argv[], Options* options) {
-    extern int optind;
     int ch;
     const char* output_file = NULL;
+    bool sparse = false;
 
     // Initialize the options struct as needed.
     options->verbose = false;
     options->use_filename = false;
     options->inc_guid = false;
+    options->format = CORE_FORMAT_PLAIN;
+    options->jobs = sysconf(_SC_NPROCESSORS_ONLN);
 
-    while ((ch = getopt(argc, (char * const *)argv, "fhio:S:va:")) != -1) {
+    while ((ch = getopt(argc, (char * const *)argv, "fhio:S:va:B:O:j:sz:")) != -1) {
       switch (ch) {
       case 'h':
         Usage(argc, argv);
@@ -107,12 +126,60 @@ namespace md2core {
         break;
       case 'v':
         options->verbose = true;
+        break;
       case 'a':
 	options->arch = optarg;
         break;
+      case 'B':
+        options->batch_path = optarg;
+        break;
+      case 'O':
+        options->output_dir = optarg;
+        break;
+      case 'j':
+        options->jobs = atoi(optarg);
+        break;
+      case 's':
+        sparse = true;
+        break;
+      case 'z':
+        if (!strcmp(optarg, "gzip")) {
+          options->format = CORE_FORMAT_GZIP;
+        } else if (!strcmp(optarg, "zstd")) {
+          options->format = CORE_FORMAT_ZSTD;
+        } else {
+          fprintf(stderr, "%s: unknown compression %s\n", argv[0], optarg);
+          Usage(argc, argv);
+          exit(1);
+        }
+        break;
       }
     }
 
+    if (sparse) {
+      if (options->format != CORE_FORMAT_PLAIN) {
+	fprintf(stderr, "%s: -s and -z cannot be combined\n", argv[0]);
+	exit(1);
+      }
+      options->format = CORE_FORMAT_SPARSE;
+    }
+    if (!CoreWriter::IsSupported(options->format)) {
+      fprintf(stderr, "%s: this md2core was built without %s support\n",
+	      argv[0],
+	      options->format == CORE_FORMAT_GZIP ? "zlib" : "zstd");
+      exit(1);
+    }
+
+    if (!options->batch_path.empty()) {
+      if (argc != optind || output_file) {
+	fprintf(stderr, "%s: -B takes no minidump file and no -o\n", argv[0]);
+	Usage(argc, argv);
+	exit(1);
+      }
+      options->out_fd = -1;
+      return;
+    }
+
     if ((argc - optind) != 1) {
       fprintf(stderr, "%s: Missing minidump file\n", argv[0]);
       Usage(argc, argv);
@@ -133,36 +200,31 @@ namespace md2core {
     options->minidump_path = argv[optind];
   }
 
+}
 
-  int
-    main(int argc, const char* argv[]) {
-    Options options;
+int
+main(int argc, const char* argv[]) {
+  using namespace md2core;
+  Options options;
 
-    SetupOptions(argc, argv, &options);
+  SetupOptions(argc, argv, &options);
 
-    MemoryMappedFile mapped_file(options.minidump_path.c_str(), 0);
-    if (!mapped_file.data()) {
-      fprintf(stderr, "Failed to mmap dump file: %s: %s\n",
-	      options.minidump_path.c_str(), strerror(errno));
-      return 1;
-    }
+  if (!options.batch_path.empty())
+    return RunBatch(options) ? 1 : 0;
 
-    MinidumpMemoryRange dump(mapped_file.data(), mapped_file.size());
+  MemoryMappedFile mapped_file(options.minidump_path.c_str(), 0);
+  if (!mapped_file.data()) {
+    fprintf(stderr, "Failed to mmap dump file: %s: %s\n",
+	    options.minidump_path.c_str(), strerror(errno));
+    return 1;
+  }
 
-    if (!options.arch.compare("86_64")) {
-      // create relevant object and call member function
-      CrashedProcessX86_64 crashinfo = CrashedProcessX86_64();
-       return crashinfo.write_core(options, dump);
-    } else if (!options.arch.compare("aarch64")) {
-      // idem
-      CrashedProcessAarch64 c = CrashedProcessAarch64();
-      return c.write_core(options, dump);
-    } else {
-      fprintf(stderr, "Option %s is neither 86_64 nor aarch64.\n",
-	      options.arch.c_str());
-      exit(1);
-    }
+  MinidumpMemoryRange dump(mapped_file.data(), mapped_file.size());
 
+  Converter converter;
+  int result = converter.Convert(options, dump);
+  if (options.out_fd != STDOUT_FILENO) {
+    close(options.out_fd);
   }
-
+  return result;
 }
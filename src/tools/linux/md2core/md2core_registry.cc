@@ -0,0 +1,72 @@
+#include "md2core_registry.h"
+
+#include "md2core_aarch64.h"
+#include "md2core_arm.h"
+#include "md2core_x86.h"
+#include "md2core_x86_64.h"
+
+namespace md2core {
+
+  namespace {
+
+    template <typename C>
+    CrashedProcessInterface*
+    Create() {
+      return new C();
+    }
+
+    // To support another architecture, add its CrashedProcess here and
+    // instantiate the template at the end of md2core.cc.
+    const Backend kBackends[] = {
+      { "86_64", MD_CPU_ARCHITECTURE_AMD64, Create<CrashedProcessX86_64> },
+      { "aarch64", MD_CPU_ARCHITECTURE_ARM64, Create<CrashedProcessAarch64> },
+      { "i386", MD_CPU_ARCHITECTURE_X86, Create<CrashedProcessX86> },
+      { "arm", MD_CPU_ARCHITECTURE_ARM, Create<CrashedProcessArm> },
+    };
+
+    const size_t kBackendCount = sizeof(kBackends) / sizeof(kBackends[0]);
+
+  }  // namespace
+
+  const Backend*
+  FindBackend(uint16_t processor_architecture) {
+    for (size_t i = 0; i < kBackendCount; ++i) {
+      if (kBackends[i].processor_architecture == processor_architecture)
+	return &kBackends[i];
+    }
+    return NULL;
+  }
+
+  const Backend*
+  FindBackend(const string& name) {
+    for (size_t i = 0; i < kBackendCount; ++i) {
+      if (name == kBackends[i].name)
+	return &kBackends[i];
+    }
+    return NULL;
+  }
+
+  bool
+  ReadProcessorArchitecture(const MinidumpMemoryRange& dump,
+			    uint16_t* processor_architecture) {
+    const MDRawHeader* header = dump.GetData<MDRawHeader>(0);
+    if (!header)
+      return false;
+    for (unsigned i = 0; i < header->stream_count; ++i) {
+      const MDRawDirectory* dirent =
+        dump.GetArrayElement<MDRawDirectory>(header->stream_directory_rva, i);
+      if (!dirent)
+	return false;
+      if (dirent->stream_type != MD_SYSTEM_INFO_STREAM)
+	continue;
+      const MDRawSystemInfo* sysinfo =
+	dump.Subrange(dirent->location).GetData<MDRawSystemInfo>(0);
+      if (!sysinfo)
+	return false;
+      *processor_architecture = sysinfo->processor_architecture;
+      return true;
+    }
+    return false;
+  }
+
+}
@@ -0,0 +1,38 @@
+#ifndef MD_2_CORE_REGISTRY_H_
+#define MD_2_CORE_REGISTRY_H_
+
+#include <stdint.h>
+
+#include "md2core.h"
+
+namespace md2core {
+
+// One entry per CrashedProcess specialization md2core can convert with.
+
+  struct Backend {
+    // Name given to -a.
+    const char* name;
+    // The MD_CPU_ARCHITECTURE_* of the minidumps it converts.
+    uint16_t processor_architecture;
+    // Returns a new instance, owned by the caller.
+    CrashedProcessInterface* (*create)();
+  };
+
+  // Returns the backend converting minidumps of |processor_architecture|,
+  // or NULL if there is none.
+  const Backend*
+    FindBackend(uint16_t processor_architecture);
+
+  // Returns the backend called |name|, or NULL if there is none.
+  const Backend*
+    FindBackend(const string& name);
+
+  // Reads the processor architecture of |dump| from its
+  // MD_SYSTEM_INFO_STREAM. Returns false if the minidump has none.
+  bool
+    ReadProcessorArchitecture(const MinidumpMemoryRange& dump,
+			      uint16_t* processor_architecture);
+
+}
+
+#endif  // MD_2_CORE_REGISTRY_H_
@@ -0,0 +1,366 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "md2core_writer.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+namespace md2core {
+
+  // Gaps and paddings are never larger than a page, so one page of zeros
+  // can back all of them. It is also the granularity of sparse holes.
+  static const size_t kZeroPageSize = 4096;
+  static const uint8_t kZeroPage[kZeroPageSize] = { 0 };
+
+  // Size of the buffer receiving compressed output.
+  static const size_t kCompressedChunkSize = 256 * 1024;
+
+  struct CoreWriter::Compressor {
+#ifdef HAVE_LIBZ
+    z_stream zlib;
+#endif
+#ifdef HAVE_LIBZSTD
+    ZSTD_CCtx* zstd;
+#endif
+    std::vector<uint8_t> out;
+  };
+
+  CoreWriter::CoreWriter(int fd, CoreFormat format)
+    : fd_(fd),
+      format_(format),
+      offset_(0),
+      file_offset_(0),
+      compressor_(NULL) {
+#ifdef HAVE_LIBZ
+    if (format_ == CORE_FORMAT_GZIP) {
+      compressor_ = new Compressor;
+      memset(&compressor_->zlib, 0, sizeof(compressor_->zlib));
+      // 16 + 15: a gzip header and trailer around a 32 KiB window.
+      if (deflateInit2(&compressor_->zlib, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                       16 + 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        delete compressor_;
+        compressor_ = NULL;
+      }
+    }
+#endif
+#ifdef HAVE_LIBZSTD
+    if (format_ == CORE_FORMAT_ZSTD) {
+      compressor_ = new Compressor;
+      compressor_->zstd = ZSTD_createCCtx();
+      if (!compressor_->zstd) {
+        delete compressor_;
+        compressor_ = NULL;
+      }
+    }
+#endif
+    if (compressor_)
+      compressor_->out.resize(kCompressedChunkSize);
+  }
+
+  CoreWriter::~CoreWriter() {
+    if (!compressor_)
+      return;
+#ifdef HAVE_LIBZ
+    if (format_ == CORE_FORMAT_GZIP)
+      deflateEnd(&compressor_->zlib);
+#endif
+#ifdef HAVE_LIBZSTD
+    if (format_ == CORE_FORMAT_ZSTD)
+      ZSTD_freeCCtx(compressor_->zstd);
+#endif
+    delete compressor_;
+  }
+
+  bool
+  CoreWriter::IsSupported(CoreFormat format) {
+#ifndef HAVE_LIBZ
+    if (format == CORE_FORMAT_GZIP)
+      return false;
+#endif
+#ifndef HAVE_LIBZSTD
+    if (format == CORE_FORMAT_ZSTD)
+      return false;
+#endif
+    return true;
+  }
+
+  bool
+  CoreWriter::Write(const void* data, size_t length) {
+    size_t staging_offset = staging_.size();
+    staging_.append(reinterpret_cast<const char*>(data), length);
+    return Queue(NULL, staging_offset, length);
+  }
+
+  bool
+  CoreWriter::WriteView(const void* data, size_t length) {
+    return Queue(reinterpret_cast<const uint8_t*>(data), 0, length);
+  }
+
+  bool
+  CoreWriter::WriteZeros(size_t length) {
+    while (length) {
+      size_t chunk = length < kZeroPageSize ? length : kZeroPageSize;
+      if (!WriteView(kZeroPage, chunk))
+	return false;
+      length -= chunk;
+    }
+    return true;
+  }
+
+  bool
+  CoreWriter::Queue(const uint8_t* data, size_t staging_offset,
+		    size_t length) {
+    if (!length)
+      return true;
+    Segment segment = { data, staging_offset, length };
+    segments_.push_back(segment);
+    offset_ += length;
+    // Keep the staging buffer bounded, the views do not need it.
+    if (segments_.size() >= IOV_MAX)
+      return Flush();
+    return true;
+  }
+
+  bool
+  CoreWriter::Flush() {
+    std::vector<struct iovec> iov(segments_.size());
+    for (size_t i = 0; i < segments_.size(); ++i) {
+      const Segment& segment = segments_[i];
+      iov[i].iov_base = const_cast<uint8_t*>(
+        segment.data ? segment.data :
+        reinterpret_cast<const uint8_t*>(staging_.data()) +
+        segment.staging_offset);
+      iov[i].iov_len = segment.length;
+    }
+
+    bool ok = true;
+    if (!iov.empty()) {
+      switch (format_) {
+      case CORE_FORMAT_SPARSE:
+	ok = WriteSparse(iov);
+	break;
+      case CORE_FORMAT_GZIP:
+      case CORE_FORMAT_ZSTD:
+	ok = Compress(&iov[0], iov.size(), false);
+	break;
+      default:
+	ok = WriteIovecs(&iov[0], iov.size());
+	break;
+      }
+    }
+
+    segments_.clear();
+    staging_.clear();
+    return ok;
+  }
+
+  bool
+  CoreWriter::Finish() {
+    if (!Flush())
+      return false;
+    switch (format_) {
+    case CORE_FORMAT_SPARSE:
+      // The file may end with a hole, which only ftruncate() can create.
+      return ftruncate(fd_, file_offset_) == 0;
+    case CORE_FORMAT_GZIP:
+    case CORE_FORMAT_ZSTD:
+      return Compress(NULL, 0, true);
+    default:
+      return true;
+    }
+  }
+
+  bool
+  CoreWriter::WriteIovecs(struct iovec* iov, size_t count) {
+    size_t next = 0;
+    while (next < count) {
+      int chunk = count - next > IOV_MAX ? IOV_MAX : count - next;
+      ssize_t r;
+      do {
+	r = writev(fd_, &iov[next], chunk);
+      } while (r == -1 && errno == EINTR);
+      if (r < 1)
+	return false;
+      // Skip over what was written, and adjust a partially written iovec.
+      size_t done = r;
+      while (next < count && done >= iov[next].iov_len) {
+	done -= iov[next].iov_len;
+	++next;
+      }
+      if (done) {
+	iov[next].iov_base = static_cast<uint8_t*>(iov[next].iov_base) + done;
+	iov[next].iov_len -= done;
+      }
+    }
+    return true;
+  }
+
+  bool
+  CoreWriter::SkipHole(uint64_t length) {
+    if (lseek(fd_, length, SEEK_CUR) != -1)
+      return true;
+    if (errno != ESPIPE)
+      return false;
+    // Not seekable (a pipe): write the zeros, and everything after them.
+    format_ = CORE_FORMAT_PLAIN;
+    std::vector<struct iovec> zeros;
+    while (length) {
+      struct iovec page;
+      page.iov_base = const_cast<uint8_t*>(kZeroPage);
+      page.iov_len = length < kZeroPageSize ? length : kZeroPageSize;
+      zeros.push_back(page);
+      length -= page.iov_len;
+    }
+    return WriteIovecs(&zeros[0], zeros.size());
+  }
+
+  bool
+  CoreWriter::WriteSparse(const std::vector<struct iovec>& iov) {
+    // Data not yet written, and zeros not yet skipped, which follow it.
+    std::vector<struct iovec> pending;
+    uint64_t hole = 0;
+    for (size_t i = 0; i < iov.size(); ++i) {
+      const uint8_t* data = static_cast<const uint8_t*>(iov[i].iov_base);
+      size_t length = iov[i].iov_len;
+      while (length) {
+	// Cut at the page boundaries of the file, only whole pages of zeros
+	// can become holes.
+	size_t in_page = kZeroPageSize - file_offset_ % kZeroPageSize;
+	size_t chunk = length < in_page ? length : in_page;
+	if (chunk == kZeroPageSize &&
+	    (data == kZeroPage || !memcmp(data, kZeroPage, kZeroPageSize))) {
+	  if (!pending.empty()) {
+	    if (!WriteIovecs(&pending[0], pending.size()))
+	      return false;
+	    pending.clear();
+	  }
+	  hole += chunk;
+	} else {
+	  if (hole) {
+	    if (!SkipHole(hole))
+	      return false;
+	    hole = 0;
+	    if (format_ != CORE_FORMAT_SPARSE) {
+	      // SkipHole() found the output is a pipe, write the rest as is.
+	      struct iovec rest;
+	      rest.iov_base = const_cast<uint8_t*>(data);
+	      rest.iov_len = length;
+	      pending.push_back(rest);
+	      pending.insert(pending.end(), iov.begin() + i + 1, iov.end());
+	      file_offset_ += length;
+	      for (size_t j = i + 1; j < iov.size(); ++j)
+		file_offset_ += iov[j].iov_len;
+	      return WriteIovecs(&pending[0], pending.size());
+	    }
+	  }
+	  if (!pending.empty() &&
+	      static_cast<uint8_t*>(pending.back().iov_base) +
+	      pending.back().iov_len == data) {
+	    pending.back().iov_len += chunk;
+	  } else {
+	    struct iovec piece;
+	    piece.iov_base = const_cast<uint8_t*>(data);
+	    piece.iov_len = chunk;
+	    pending.push_back(piece);
+	  }
+	}
+	file_offset_ += chunk;
+	data += chunk;
+	length -= chunk;
+      }
+    }
+    if (!pending.empty() && !WriteIovecs(&pending[0], pending.size()))
+      return false;
+    return !hole || SkipHole(hole);
+  }
+
+  bool
+  CoreWriter::Compress(const struct iovec* iov, size_t count, bool finish) {
+    if (!compressor_)
+      return false;
+
+#ifdef HAVE_LIBZ
+    if (format_ == CORE_FORMAT_GZIP) {
+      std::vector<uint8_t>& out = compressor_->out;
+      z_stream* stream = &compressor_->zlib;
+      size_t i = 0;
+      size_t consumed = 0;
+      for (;;) {
+	// avail_in is an unsigned int, feed large views in slices.
+	if (!stream->avail_in && i < count) {
+	  size_t slice = iov[i].iov_len - consumed;
+	  if (slice > 1U << 30)
+	    slice = 1U << 30;
+	  stream->next_in = static_cast<Bytef*>(iov[i].iov_base) + consumed;
+	  stream->avail_in = slice;
+	  consumed += slice;
+	  if (consumed == iov[i].iov_len) {
+	    ++i;
+	    consumed = 0;
+	  }
+	}
+	bool input_done = !stream->avail_in && i == count;
+	if (input_done && !finish)
+	  return true;
+	stream->next_out = &out[0];
+	stream->avail_out = out.size();
+	int result = deflate(stream, input_done ? Z_FINISH : Z_NO_FLUSH);
+	if (result == Z_STREAM_ERROR)
+	  return false;
+	struct iovec written = { &out[0], out.size() - stream->avail_out };
+	if (written.iov_len && !WriteIovecs(&written, 1))
+	  return false;
+	if (result == Z_STREAM_END)
+	  return true;
+      }
+    }
+#endif
+
+#ifdef HAVE_LIBZSTD
+    if (format_ == CORE_FORMAT_ZSTD) {
+      std::vector<uint8_t>& out = compressor_->out;
+      ZSTD_CCtx* stream = compressor_->zstd;
+      for (size_t i = 0; i <= count; ++i) {
+	ZSTD_inBuffer in = { NULL, 0, 0 };
+	if (i < count) {
+	  in.src = iov[i].iov_base;
+	  in.size = iov[i].iov_len;
+	} else if (!finish) {
+	  break;
+	}
+	ZSTD_EndDirective mode = i < count ? ZSTD_e_continue : ZSTD_e_end;
+	size_t remaining;
+	do {
+	  ZSTD_outBuffer output = { &out[0], out.size(), 0 };
+	  remaining = ZSTD_compressStream2(stream, &output, &in, mode);
+	  if (ZSTD_isError(remaining))
+	    return false;
+	  struct iovec written = { &out[0], output.pos };
+	  if (written.iov_len && !WriteIovecs(&written, 1))
+	    return false;
+	} while (mode == ZSTD_e_continue ? in.pos < in.size : remaining != 0);
+      }
+      return true;
+    }
+#endif
+    return false;
+  }
+
+}
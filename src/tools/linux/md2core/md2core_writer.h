@@ -0,0 +1,108 @@
+#ifndef MD_2_CORE_WRITER_H_
+#define MD_2_CORE_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include <string>
+#include <vector>
+
+namespace md2core {
+
+  // How the core is written to its file descriptor.
+  enum CoreFormat {
+    CORE_FORMAT_PLAIN,
+    // Page-aligned pages of zeros are left as holes. Needs a seekable
+    // output; falls back to CORE_FORMAT_PLAIN otherwise.
+    CORE_FORMAT_SPARSE,
+    // The core is compressed as it is written. Only available when built
+    // with HAVE_LIBZ (and -lz).
+    CORE_FORMAT_GZIP,
+    // Only available when built with HAVE_LIBZSTD (and -lzstd).
+    CORE_FORMAT_ZSTD
+  };
+
+// CoreWriter gathers the pieces of a core file and emits them with as few
+// writev() calls as possible.
+// Small structures (ELF headers, notes) are copied into a staging buffer,
+// while large blobs (thread stacks, link map, _DYNAMIC) are only referenced:
+// they must stay alive, and unchanged, until Flush() returns.
+
+  class CoreWriter {
+  public:
+    explicit CoreWriter(int fd, CoreFormat format = CORE_FORMAT_PLAIN);
+    ~CoreWriter();
+
+    // Returns false if |format| cannot be written by this build.
+    static bool
+      IsSupported(CoreFormat format);
+
+    // Copies |length| bytes at |data| into the staging buffer.
+    bool
+      Write(const void* data, size_t length);
+
+    // Queues |length| bytes at |data| without copying them.
+    bool
+      WriteView(const void* data, size_t length);
+
+    // Queues |length| zero bytes.
+    bool
+      WriteZeros(size_t length);
+
+    // Writes everything queued so far. Handles short writes and EINTR.
+    bool
+      Flush();
+
+    // Flushes, then ends the compressed stream or sets the size of a
+    // sparse file. Nothing can be written afterwards.
+    bool
+      Finish();
+
+    // Number of bytes of the (uncompressed) core queued or written since
+    // construction.
+    uint64_t
+      offset() const { return offset_; }
+
+  private:
+    // A queued piece of output. If |data| is NULL, the bytes live in
+    // |staging_| at |staging_offset|, as |staging_| may be reallocated.
+    struct Segment {
+      const uint8_t* data;
+      size_t staging_offset;
+      size_t length;
+    };
+
+    // State of the zlib or zstd stream, defined in md2core_writer.cc.
+    struct Compressor;
+
+    bool
+      Queue(const uint8_t* data, size_t staging_offset, size_t length);
+
+    bool
+      WriteIovecs(struct iovec* iov, size_t count);
+
+    // Skips |length| bytes of the output, or writes them as zeros if it
+    // cannot be seeked.
+    bool
+      SkipHole(uint64_t length);
+
+    bool
+      WriteSparse(const std::vector<struct iovec>& iov);
+
+    bool
+      Compress(const struct iovec* iov, size_t count, bool finish);
+
+    int fd_;
+    CoreFormat format_;
+    uint64_t offset_;
+    // Sparse output: offset in the file of the next byte Flush() writes.
+    uint64_t file_offset_;
+    Compressor* compressor_;
+    std::vector<Segment> segments_;
+    std::string staging_;
+  };
+
+}
+
+#endif  // MD_2_CORE_WRITER_H_
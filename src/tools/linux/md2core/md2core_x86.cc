@@ -0,0 +1,84 @@
+#include "md2core_x86.h"
+
+
+namespace md2core {
+
+
+  CrashedProcessX86::CrashedProcessX86() {
+    crashing_tid = -1;
+    auxv = NULL;
+    auxv_length = 0;
+    memset(&prps, 0, sizeof(prps));
+    prps.pr_sname = 'R';
+    memset(&debug, 0, sizeof(debug));
+    elf_arch = EM_386;
+  }
+
+
+  bool
+  CrashedProcessX86::ParseThreadRegisters(Threadx86* thread,
+					  const MinidumpMemoryRange& range) {
+    const MDRawContextX86* rawregs = range.GetData<MDRawContextX86>(0);
+    if (!rawregs)
+      return false;
+
+    thread->regs.ebx = rawregs->ebx;
+    thread->regs.ecx = rawregs->ecx;
+    thread->regs.edx = rawregs->edx;
+    thread->regs.esi = rawregs->esi;
+    thread->regs.edi = rawregs->edi;
+    thread->regs.ebp = rawregs->ebp;
+    thread->regs.eax = rawregs->eax;
+    thread->regs.xds = rawregs->ds;
+    thread->regs.xes = rawregs->es;
+    thread->regs.xfs = rawregs->fs;
+    thread->regs.xgs = rawregs->gs;
+    thread->regs.orig_eax = rawregs->eax;
+    thread->regs.eip = rawregs->eip;
+    thread->regs.xcs = rawregs->cs;
+    thread->regs.eflags = rawregs->eflags;
+    thread->regs.esp = rawregs->esp;
+    thread->regs.xss = rawregs->ss;
+
+    thread->fpregs.cwd = rawregs->float_save.control_word;
+    thread->fpregs.swd = rawregs->float_save.status_word;
+    thread->fpregs.twd = rawregs->float_save.tag_word;
+    thread->fpregs.fip = rawregs->float_save.error_offset;
+    thread->fpregs.fcs = rawregs->float_save.error_selector;
+    thread->fpregs.foo = rawregs->float_save.data_offset;
+    thread->fpregs.fos = rawregs->float_save.data_selector;
+    memcpy(thread->fpregs.st_space, rawregs->float_save.register_area,
+	   10 * 8);
+    return true;
+  }
+
+
+  bool
+  CrashedProcessX86::ParseSystemInfo(const Options& options,
+				     const MinidumpMemoryRange& range,
+				     const MinidumpMemoryRange& full_file) {
+    const MDRawSystemInfo* sysinfo = range.GetData<MDRawSystemInfo>(0);
+    if (!sysinfo) {
+      fprintf(stderr, "Failed to access MD_SYSTEM_INFO_STREAM\n");
+      return false;
+    }
+    if (sysinfo->processor_architecture != MD_CPU_ARCHITECTURE_X86) {
+      fprintf(stderr,
+	      "This version of minidump-2-core only supports x86 (32bit)%s.\n",
+	      sysinfo->processor_architecture == MD_CPU_ARCHITECTURE_AMD64 ?
+	      ",\nbut the minidump file is from a 64bit machine" : "");
+      return false;
+    }
+    if (!strstr(full_file.GetAsciiMDString(sysinfo->csd_version_rva).c_str(),
+		"Linux") &&
+	sysinfo->platform_id != MD_OS_NACL) {
+      fprintf(stderr, "This minidump was not generated by Linux or NaCl.\n");
+      return false;
+    }
+// call super
+    return CrashedProcess<Threadx86, prpsinfox86,
+			  prstatusx86, user_fpregsx86_struct,
+			  user_regsx86_struct, ElfClass32>::ParseSystemInfo(options, range, full_file);
+  }
+
+}
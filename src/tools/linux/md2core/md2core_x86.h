@@ -0,0 +1,108 @@
+#ifndef MD_2_CORE_X86_H_
+#define MD_2_CORE_X86_H_
+
+#include "md2core.h"
+
+namespace md2core {
+
+  typedef struct prpsinfox86 {    /* Information about process                 */
+    unsigned char  pr_state;      /* Numeric process state                     */
+    char           pr_sname;      /* Char for pr_state                         */
+    unsigned char  pr_zomb;       /* Zombie                                    */
+    signed char    pr_nice;       /* Nice val                                  */
+    uint32_t       pr_flag;       /* Flags                                     */
+    uint16_t       pr_uid;        /* User ID                                   */
+    uint16_t       pr_gid;        /* Group ID                                  */
+    int32_t        pr_pid;        /* Process ID                                */
+    int32_t        pr_ppid;       /* Parent's process ID                       */
+    int32_t        pr_pgrp;       /* Group ID                                  */
+    int32_t        pr_sid;        /* Session ID                                */
+    char           pr_fname[16];  /* Filename of executable                    */
+    char           pr_psargs[80]; /* Initial part of arg list                  */
+  } prpsinfox86;
+
+// from sys/user.h, as seen by a 32bit process
+  typedef struct user_fpregsx86_struct
+  {
+    uint32_t cwd;
+    uint32_t swd;
+    uint32_t twd;
+    uint32_t fip;
+    uint32_t fcs;
+    uint32_t foo;
+    uint32_t fos;
+    uint32_t st_space[20];
+  } user_fpregsx86_struct;
+
+  typedef struct user_regsx86_struct
+  {
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+    uint32_t esi;
+    uint32_t edi;
+    uint32_t ebp;
+    uint32_t eax;
+    uint32_t xds;
+    uint32_t xes;
+    uint32_t xfs;
+    uint32_t xgs;
+    uint32_t orig_eax;
+    uint32_t eip;
+    uint32_t xcs;
+    uint32_t eflags;
+    uint32_t esp;
+    uint32_t xss;
+  } user_regsx86_struct;
+
+  typedef struct prstatusx86 {    /* Information about thread; includes CPU reg*/
+    _elf_siginfo   pr_info;       /* Info associated with signal               */
+    uint16_t       pr_cursig;     /* Current signal                            */
+    uint32_t       pr_sigpend;    /* Set of pending signals                    */
+    uint32_t       pr_sighold;    /* Set of held signals                       */
+    int32_t        pr_pid;        /* Process ID                                */
+    int32_t        pr_ppid;       /* Parent's process ID                       */
+    int32_t        pr_pgrp;       /* Group ID                                  */
+    int32_t        pr_sid;        /* Session ID                                */
+    elf_timeval32  pr_utime;      /* User time                                 */
+    elf_timeval32  pr_stime;      /* System time                               */
+    elf_timeval32  pr_cutime;     /* Cumulative user time                      */
+    elf_timeval32  pr_cstime;     /* Cumulative system time                    */
+// that is function of architecture
+    user_regsx86_struct pr_reg;   /* CPU registers                             */
+    uint32_t       pr_fpvalid;    /* True if math co-processor being used      */
+  } prstatusx86;
+
+  struct Threadx86 {
+    pid_t tid;
+    user_regsx86_struct regs;
+    user_fpregsx86_struct fpregs;
+    uintptr_t stack_addr;
+    const uint8_t* stack;
+    size_t stack_length;
+  };
+
+
+  class CrashedProcessX86: public CrashedProcess<Threadx86,
+                                                 prpsinfox86,
+                                                 prstatusx86,
+                                                 user_fpregsx86_struct,
+                                                 user_regsx86_struct,
+                                                 ElfClass32> {
+
+  public:
+    CrashedProcessX86();
+
+    bool
+      ParseThreadRegisters(Threadx86* thread,
+			   const MinidumpMemoryRange& range);
+
+    bool
+      ParseSystemInfo(const Options& options,
+		      const MinidumpMemoryRange& range,
+		      const MinidumpMemoryRange& full_file);
+  };
+
+}
+
+#endif  // MD_2_CORE_X86_H_
@@ -15,10 +15,12 @@ namespace md2core {
   }
 
 
-  void
+  bool
   CrashedProcessX86_64::ParseThreadRegisters(Thread86_64* thread,
 					     const MinidumpMemoryRange& range) {
     const MDRawContextAMD64* rawregs = range.GetData<MDRawContextAMD64>(0);
+    if (!rawregs)
+      return false;
 
     thread->regs.r15 = rawregs->r15;
     thread->regs.r14 = rawregs->r14;
@@ -58,27 +60,28 @@ namespace md2core {
     thread->fpregs.mxcr_mask = rawregs->flt_save.mx_csr_mask;
     memcpy(thread->fpregs.st_space, rawregs->flt_save.float_registers, 8 * 16);
     memcpy(thread->fpregs.xmm_space, rawregs->flt_save.xmm_registers, 16 * 16);
+    return true;
   }
 
 
-  void
+  bool
   CrashedProcessX86_64::ParseSystemInfo(const Options& options,
 					const MinidumpMemoryRange& range,
 					const MinidumpMemoryRange& full_file) {
     const MDRawSystemInfo* sysinfo = range.GetData<MDRawSystemInfo>(0);
     if (!sysinfo) {
       fprintf(stderr, "Failed to access MD_SYSTEM_INFO_STREAM\n");
-      exit(1);
+      return false;
     }
     if (sysinfo->processor_architecture != MD_CPU_ARCHITECTURE_AMD64) {
       fprintf(stderr,
 	      "This version of minidump-2-core only supports x86 (64bit)%s.\n",
 	      sysinfo->processor_architecture == MD_CPU_ARCHITECTURE_X86 ?
 	      ",\nbut the minidump file is from a 32bit machine" : "");
-      exit(1);
+      return false;
     }
 // call super
-    CrashedProcess<Thread86_64, prpsinfo86_64,
+    return CrashedProcess<Thread86_64, prpsinfo86_64,
 		   prstatus86_64, user_fpregs86_64_struct,
 		   user_regs86_64_struct>::ParseSystemInfo(options, range, full_file);
   }
@@ -1,5 +1,5 @@
 #ifndef MD_2_CORE_X86_64_H_
-#define MD_2_CORE_x86_64_H_
+#define MD_2_CORE_X86_64_H_
 
 #include "md2core.h"
 
@@ -112,19 +112,19 @@ namespace md2core {
   public:
     CrashedProcessX86_64();
 
-    void
+    bool
       ParseThreadRegisters(Thread86_64* thread,
 			   const MinidumpMemoryRange& range);
 
-    void
+    bool
       ParseSystemInfo(const Options& options,
 		      const MinidumpMemoryRange& range,
 		      const MinidumpMemoryRange& full_file);
 
     void
-      write_threads(const Options& options);
+      write_threads(CoreWriter* writer);
   };
 
 }
 
-#endif // MD_2_CORE_x86_64_H_
+#endif // MD_2_CORE_X86_64_H_
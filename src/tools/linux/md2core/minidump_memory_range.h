@@ -35,6 +35,8 @@
 #ifndef TOOLS_LINUX_MD2CORE_MINIDUMP_MEMORY_RANGE_H_
 #define TOOLS_LINUX_MD2CORE_MINIDUMP_MEMORY_RANGE_H_
 
+#include <stddef.h>
+
 #include <string>
 
 #include "common/memory_range.h"
@@ -75,9 +77,13 @@ class MinidumpMemoryRange : public MemoryRange {
     std::string str;
     const MDString* md_str = GetData<MDString>(sub_offset);
     if (md_str) {
-      const uint16_t* buffer = &md_str->buffer[0];
-      for (uint32_t i = 0; i < md_str->length && buffer[i]; ++i) {
-        str.push_back(buffer[i]);
+      // Stop at the end of the range, as the length may be corrupt.
+      for (uint32_t i = 0; i < md_str->length; ++i) {
+        const uint16_t* c = GetArrayElement<uint16_t>(
+            sub_offset + offsetof(MDString, buffer), i);
+        if (!c || !*c)
+          break;
+        str.push_back(*c);
       }
     }
     return str;